@@ -310,6 +310,44 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
                                   svn_boolean_t allow_blocking_writes,
                                   apr_pool_t *result_pool);
 
+/**
+ * Like svn_cache__membuffer_cache_create() but place the whole cache,
+ * i.e. segment headers, index and data buffers, in anonymous shared
+ * memory.  Every process forked from the current one after this call
+ * will access the very same cache contents.  Hence, this is intended for
+ * pre-forking servers that create the cache in their parent process.
+ *
+ * Access is always serialized across processes and threads.  Since the
+ * shared data contains absolute addresses, it cannot be attached to by
+ * unrelated processes and its contents will be lost once the last process
+ * using it terminates.  The segment count will be capped at a lower limit
+ * than for process-local caches.
+ *
+ * Every child process must call svn_cache__membuffer_cache_child_init()
+ * before using the cache.
+ *
+ * The shared memory will be released when @a result_pool gets cleaned up.
+ * Return #SVN_ERR_UNSUPPORTED_FEATURE if APR has no support for shared
+ * memory or process-shared mutexes.
+ */
+svn_error_t *
+svn_cache__membuffer_cache_create_shared(svn_membuffer_t **cache,
+                                         apr_size_t total_size,
+                                         apr_size_t directory_size,
+                                         apr_size_t segment_count,
+                                         svn_boolean_t allow_blocking_writes,
+                                         apr_pool_t *result_pool);
+
+/**
+ * Re-attach the cross-process locks of the shared @a cache, created by
+ * svn_cache__membuffer_cache_create_shared() in a parent process, in a
+ * freshly forked child process.  Use @a pool for per-process resources.
+ * This is a no-op for process-local caches.
+ */
+svn_error_t *
+svn_cache__membuffer_cache_child_init(svn_membuffer_t *cache,
+                                      apr_pool_t *pool);
+
 /**
  * @defgroup Standard priority classes for #svn_cache__create_membuffer_cache.
  * @{
@@ -554,6 +592,32 @@ svn_cache__format_info(const svn_cache__info_t *info,
 struct svn_membuffer_t *
 svn_cache__get_global_membuffer_cache(void);
 
+/**
+ * Make @a cache the process-global membuffer cache returned by
+ * svn_cache__get_global_membuffer_cache().  This must be called before
+ * the global cache gets used for the first time, e.g. before opening the
+ * first repository.  Setting the same @a cache again is a no-op.  Return
+ * #SVN_ERR_BAD_CONFIG_VALUE if a different global cache is already in use.
+ */
+svn_error_t *
+svn_cache__set_global_membuffer_cache(struct svn_membuffer_t *cache);
+
+/**
+ * Create a membuffer cache in shared memory using the size specified by
+ * the current svn_cache_config_get() settings, allocated in
+ * @a result_pool, and make it the global membuffer cache.  Return the
+ * cache in @a *cache or NULL if the configured cache size is 0.
+ *
+ * Pre-forking servers call this in their parent process before spawning
+ * workers so all of them share a single cache.
+ *
+ * @see svn_cache__membuffer_cache_create_shared
+ */
+svn_error_t *
+svn_cache__create_shared_global_membuffer_cache(
+  struct svn_membuffer_t **cache,
+  apr_pool_t *result_pool);
+
 /**
  * Return total access and size stats over all membuffer caches as they
  * share the underlying data buffer.  The result will be allocated in POOL.
@@ -561,6 +625,19 @@ svn_cache__get_global_membuffer_cache(void);
 svn_cache__info_t *
 svn_cache__membuffer_get_global_info(apr_pool_t *pool);
 
+/**
+ * Set @a *gets and @a *hits to the total number of lookups and cache hits
+ * in the global membuffer cache so far.  Unlike
+ * svn_cache__membuffer_get_global_info(), this does not lock the cache,
+ * so it is cheap enough to be called for every server request.  The
+ * values may be slightly off while other threads use the cache.
+ *
+ * If there is no global membuffer cache, both values will be 0.
+ */
+void
+svn_cache__membuffer_get_global_counters(apr_uint64_t *gets,
+                                         apr_uint64_t *hits);
+
 /**
  * Remove all current contents from CACHE.
  *
@@ -25,6 +25,8 @@
 #ifndef SVN_DAV_PROTOCOL_H
 #define SVN_DAV_PROTOCOL_H
 
+#include "private/svn_frames.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
@@ -55,6 +57,69 @@ extern "C" {
 #define SVN_DAV__OLD_VALUE "old-value"
 #define SVN_DAV__OLD_VALUE__ABSENT "absent"
 
+/** Binary framing of send-all update-report and replay-report responses.
+ *
+ * A client talking to a server that advertises
+ * SVN_DAV_NS_DAV_SVN_BINARY_UPDATE may add the attribute
+ * SVN_DAV__BINARY_FRAMES="true" to the S:update-report or S:replay-report
+ * request element.  A server honoring that request responds with the MIME
+ * type SVN_DAV__BINARY_UPDATE_MIME_TYPE instead of XML.  Clients must
+ * check the response's Content-Type and fall back to XML parsing
+ * otherwise.
+ *
+ * The body is a frame stream as described in svn_frames.h, starting with
+ * SVN_DAV__BINARY_UPDATE_MAGIC.  The ops mirror the elements of the XML
+ * responses.  Frames that refer to a node apply to the innermost open
+ * file or, if there is none, directory.  Update responses identify nodes
+ * by their basename, replay responses by their path relative to the
+ * root of the drive, just like the XML responses do.  Replay responses
+ * never contain SHA1-CHECKSUMs, CHECKED_IN or ABSENT_* frames.  Clients
+ * ignore frames with unknown op codes.
+ */
+#define SVN_DAV__BINARY_FRAMES "binary-frames"
+#define SVN_DAV__BINARY_UPDATE_MIME_TYPE "application/vnd.svn-update-frames"
+#define SVN_DAV__BINARY_UPDATE_MAGIC "SVNU\1"
+#define SVN_DAV__BINARY_UPDATE_MAGIC_LEN 5
+
+/* REV */
+#define SVN_DAV__FRAME_TARGET_REVISION 'T'
+/* REV */
+#define SVN_DAV__FRAME_OPEN_ROOT       'R'
+/* NAME, REV */
+#define SVN_DAV__FRAME_OPEN_DIR        'D'
+/* NAME, COPYFROM-PATH, COPYFROM-REV */
+#define SVN_DAV__FRAME_ADD_DIR         'd'
+/* NAME, REV */
+#define SVN_DAV__FRAME_OPEN_FILE       'F'
+/* NAME, COPYFROM-PATH, COPYFROM-REV, SHA1-CHECKSUM */
+#define SVN_DAV__FRAME_ADD_FILE        'f'
+/* NAME, REV */
+#define SVN_DAV__FRAME_DELETE_ENTRY    'X'
+/* NAME */
+#define SVN_DAV__FRAME_ABSENT_DIR      'A'
+/* NAME */
+#define SVN_DAV__FRAME_ABSENT_FILE     'a'
+/* HREF */
+#define SVN_DAV__FRAME_CHECKED_IN      'U'
+/* NAME, VALUE */
+#define SVN_DAV__FRAME_SET_PROP        'P'
+/* NAME */
+#define SVN_DAV__FRAME_REMOVE_PROP     'p'
+/* BASE-CHECKSUM */
+#define SVN_DAV__FRAME_TXDELTA         'S'
+/* Raw svndiff data, not wrapped into a string. */
+#define SVN_DAV__FRAME_SVNDIFF         'W'
+/* (empty) */
+#define SVN_DAV__FRAME_TXDELTA_END     'w'
+/* MD5-CHECKSUM */
+#define SVN_DAV__FRAME_CLOSE_FILE      'C'
+/* (empty) */
+#define SVN_DAV__FRAME_CLOSE_DIR       'c'
+/* See SVN_FRAMES__ERROR. */
+#define SVN_DAV__FRAME_ERROR           SVN_FRAMES__ERROR
+/* See SVN_FRAMES__END. */
+#define SVN_DAV__FRAME_END             SVN_FRAMES__END
+
 /** Helper typedef for svn_ra_change_rev_prop2() implementation. */
 typedef struct svn_dav__two_props_t {
   const svn_string_t *const *old_value_p;
@@ -101,6 +101,27 @@ svn_delta__delta_from_editor(const svn_delta_editor_t **deditor,
                              struct svn_delta__extra_baton *exb,
                              apr_pool_t *pool);
 
+/** Like svn_txdelta_target_push() but produce delta windows of up to
+ * @a window_size bytes.  @a window_size must not exceed the limit of the
+ * svndiff version used to transmit or store the windows, i.e. windows
+ * larger than the standard size require svndiff version 3.
+ *
+ * If @a slide_source is set, the source view of each window starts where
+ * the data copied from the source by the previous window ended instead
+ * of right after the previous source view.  That keeps data in reach
+ * that insertions or deletions moved further than @a window_size.  The
+ * views may leave gaps in the source, so the windows must only be applied
+ * by readers that support that, i.e. svn_txdelta_apply() or FSFS readers
+ * of svndiff version 3 representations.
+ */
+svn_stream_t *
+svn_txdelta__target_push(svn_txdelta_window_handler_t handler,
+                         void *handler_baton,
+                         svn_stream_t *source,
+                         apr_size_t window_size,
+                         svn_boolean_t slide_source,
+                         apr_pool_t *pool);
+
 /** Read the txdelta window header from @a stream and return the total
     length of the unparsed window data in @a *window_len. */
 svn_error_t *
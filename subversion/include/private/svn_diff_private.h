@@ -30,6 +30,7 @@
 
 #include "svn_types.h"
 #include "svn_io.h"
+#include "svn_diff.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -148,6 +149,62 @@ svn_diff_hunk__create_deletes_single_line(svn_diff_hunk_t **hunk,
 svn_linenum_t
 svn_diff_hunk__get_fuzz_penalty(const svn_diff_hunk_t *hunk);
 
+/** One chunk of blame, i.e. a range of lines attributed to the same
+ * revision.
+ */
+typedef struct svn_diff__blame_t
+{
+  /** Caller-defined data identifying the responsible revision. */
+  const void *rev;
+
+  /** The starting diff-token (line). */
+  apr_off_t start;
+
+  /** The next chunk. */
+  struct svn_diff__blame_t *next;
+} svn_diff__blame_t;
+
+/** A chain of blame chunks, covering all lines of a file.
+ */
+typedef struct svn_diff__blame_chain_t
+{
+  /** Linked list of blame chunks, ordered by their starting token. */
+  svn_diff__blame_t *blame;
+
+  /** Linked list of free blame chunks. */
+  svn_diff__blame_t *avail;
+
+  /** Allocate members from this pool. */
+  apr_pool_t *pool;
+} svn_diff__blame_chain_t;
+
+/** Return a new, empty blame chain allocated in @a pool.
+ */
+svn_diff__blame_chain_t *
+svn_diff__blame_chain_create(apr_pool_t *pool);
+
+/** Return a blame chunk associated with @a rev for a change starting at
+ * token @a start, allocated in @a chain's pool.  The new chunk is not
+ * linked into @a chain.
+ */
+svn_diff__blame_t *
+svn_diff__blame_create(svn_diff__blame_chain_t *chain,
+                       const void *rev,
+                       apr_off_t start);
+
+/** Update @a chain, which describes the original file of @a diff, to
+ * describe the modified file of @a diff instead.  Lines that have been
+ * added or changed get attributed to @a rev.
+ *
+ * Pass @a cancel_func and @a cancel_baton to svn_diff_output2().
+ */
+svn_error_t *
+svn_diff__blame_apply_diff(svn_diff__blame_chain_t *chain,
+                           svn_diff_t *diff,
+                           const void *rev,
+                           svn_cancel_func_t cancel_func,
+                           void *cancel_baton);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -0,0 +1,205 @@
+/**
+ * @copyright
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ * @endcopyright
+ *
+ * @file svn_frames.h
+ * @brief Length-prefixed binary frames for streamed editor drives
+ */
+
+#ifndef SVN_FRAMES_H
+#define SVN_FRAMES_H
+
+#include <apr_pools.h>
+
+#include "svn_types.h"
+#include "svn_string.h"
+#include "svn_io.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/** A frame stream starts with a protocol specific magic header, followed
+ * by a sequence of frames.  Every frame consists of a one byte op code,
+ * the 7b/8b encoded (see svn__encode_uint) length of its payload and
+ * the payload itself.  Within the payload, strings are encoded as their
+ * 7b/8b encoded length followed by their contents and numbers are 7b/8b
+ * encoded signed integers (see svn__encode_int).  Empty strings stand for
+ * @c NULL.
+ *
+ * The meaning of most op codes is up to the protocol but two of them are
+ * handled by the codec itself:  A well-formed stream is terminated by a
+ * #SVN_FRAMES__END frame.  A sender that fails after it started the stream
+ * sends its error chain as #SVN_FRAMES__ERROR frames instead.
+ *
+ * @defgroup svn_frames Binary frames
+ * @{
+ */
+
+/** APR-ERR as signed integer, MESSAGE; one frame per error in the chain,
+ * outermost first.  No other frames follow. */
+#define SVN_FRAMES__ERROR 'Z'
+
+/** Empty payload; terminates the stream. */
+#define SVN_FRAMES__END   'E'
+
+/** Append the string @a data of @a len bytes to the frame @a payload.
+ * @a data may be @c NULL, which is being sent as an empty string.
+ */
+void
+svn_frames__append_string(svn_stringbuf_t *payload,
+                          const char *data,
+                          apr_size_t len);
+
+/** Append the C string @a str, which may be @c NULL, to the frame
+ * @a payload.
+ */
+void
+svn_frames__append_cstring(svn_stringbuf_t *payload,
+                           const char *str);
+
+/** Append the signed number @a val, e.g. a revision, to the frame
+ * @a payload.
+ */
+void
+svn_frames__append_int(svn_stringbuf_t *payload,
+                       apr_int64_t val);
+
+/** Write a frame of type @a op with the @a len bytes of @a payload to
+ * @a out.  @a payload may be @c NULL if @a len is 0.
+ */
+svn_error_t *
+svn_frames__write(svn_stream_t *out,
+                  char op,
+                  const char *payload,
+                  apr_size_t len);
+
+/** Write the error chain @a err as a sequence of #SVN_FRAMES__ERROR frames
+ * to @a out.  Use @a scratch_pool for temporary allocations.
+ */
+svn_error_t *
+svn_frames__write_error(svn_stream_t *out,
+                        const svn_error_t *err,
+                        apr_pool_t *scratch_pool);
+
+/** Return a writable stream, allocated in @a result_pool, that writes
+ * every chunk of data written to it as a frame of type @a data_op to
+ * @a out.  If @a close_op is not 0, closing the stream writes an empty
+ * frame of that type.  @a out does not get closed.
+ */
+svn_stream_t *
+svn_frames__data_stream(svn_stream_t *out,
+                        char data_op,
+                        char close_op,
+                        apr_pool_t *result_pool);
+
+/** Read a string from the frame payload at @a *p, ending at @a end, into
+ * @a *str and advance @a *p behind it.  Allocate the result in
+ * @a result_pool.
+ */
+svn_error_t *
+svn_frames__read_string(const svn_string_t **str,
+                        const unsigned char **p,
+                        const unsigned char *end,
+                        apr_pool_t *result_pool);
+
+/** Like svn_frames__read_string() but return a C string in @a *str,
+ * mapping empty strings to @c NULL.
+ */
+svn_error_t *
+svn_frames__read_cstring(const char **str,
+                         const unsigned char **p,
+                         const unsigned char *end,
+                         apr_pool_t *result_pool);
+
+/** Read a signed number from the frame payload at @a *p, ending at @a end,
+ * into @a *val and advance @a *p behind it.
+ */
+svn_error_t *
+svn_frames__read_int(apr_int64_t *val,
+                     const unsigned char **p,
+                     const unsigned char *end);
+
+/** Like svn_frames__read_int() but return a revision number in @a *rev.
+ */
+svn_error_t *
+svn_frames__read_rev(svn_revnum_t *rev,
+                     const unsigned char **p,
+                     const unsigned char *end);
+
+/** Process the frame @a op with the payload starting at @a payload and
+ * ending at @a end.  @a baton is the baton passed to
+ * svn_frames__parser_create().  Use @a scratch_pool for temporary
+ * allocations.
+ *
+ * This is never called for #SVN_FRAMES__ERROR and #SVN_FRAMES__END frames.
+ */
+typedef svn_error_t *
+(*svn_frames__handler_t)(void *baton,
+                         char op,
+                         const unsigned char *payload,
+                         const unsigned char *end,
+                         apr_pool_t *scratch_pool);
+
+/** Push parser for frame streams. */
+typedef struct svn_frames__parser_t svn_frames__parser_t;
+
+/** Return a new parser for frame streams that start with the @a magic_len
+ * bytes of @a magic and pass all frames to @a handler with @a baton.
+ * Allocate it in @a result_pool.
+ */
+svn_frames__parser_t *
+svn_frames__parser_create(const char *magic,
+                          apr_size_t magic_len,
+                          svn_frames__handler_t handler,
+                          void *baton,
+                          apr_pool_t *result_pool);
+
+/** Append the @a len bytes of @a data to the stream parsed by @a parser
+ * and process all frames that are complete now.  Incomplete frames get
+ * buffered until more data arrives.  Use @a scratch_pool for temporary
+ * allocations.
+ */
+svn_error_t *
+svn_frames__parser_feed(svn_frames__parser_t *parser,
+                        const char *data,
+                        apr_size_t len,
+                        apr_pool_t *scratch_pool);
+
+/** Return whether @a parser has seen the #SVN_FRAMES__END frame. */
+svn_boolean_t
+svn_frames__parser_done(svn_frames__parser_t *parser);
+
+/** Tell @a parser that its stream has ended.  Return the error chain sent
+ * by #SVN_FRAMES__ERROR frames, if any.  Otherwise, return an
+ * #SVN_ERR_STREAM_MALFORMED_DATA error if the stream has not been
+ * terminated by an #SVN_FRAMES__END frame.
+ */
+svn_error_t *
+svn_frames__parser_finish(svn_frames__parser_t *parser);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* SVN_FRAMES_H */
@@ -84,6 +84,30 @@ svn_error_t *
 svn_io__file_lock_autocreate(const char *lock_file,
                              apr_pool_t *pool);
 
+/**
+ * Account for a file of @a added_size bytes that has just been added to
+ * the cache directory @a dir.  The cache entries are the files exactly
+ * @a depth levels below @a dir, which must be at least 1, and their
+ * modification times serve as LRU timestamps.
+ *
+ * The total size of the entries is tracked incrementally in a stamp file
+ * in @a dir.  Once it exceeds @a size_limit bytes, scan the cache and
+ * remove the least recently used entries until it is 10% below the limit.
+ * If there is no valid stamp yet, establish it with a scan.
+ *
+ * Different processes may share the cache, since the stamp gets updated
+ * under a file lock.  Calls from different threads of the same process
+ * must be serialized by the caller, though.
+ *
+ * Use @a scratch_pool for temporary allocations.
+ */
+svn_error_t *
+svn_io__lru_dir_add(const char *dir,
+                    int depth,
+                    apr_int64_t size_limit,
+                    svn_filesize_t added_size,
+                    apr_pool_t *scratch_pool);
+
 
 /** Return the underlying file, if any, associated with the stream, or
  * NULL if not available.  Accessing the file bypasses the stream.
@@ -71,6 +71,12 @@ typedef struct svn_object_pool__t svn_object_pool__t;
  * svn_object_pool__new_item_pool.  Unused objects get destroyed at
  * the object pool's discretion.
  *
+ * If SHARE is set, the same object may be referenced by multiple users
+ * at the same time.  Otherwise, objects get checked out exclusively by
+ * lookup and insert and will only become available to the next lookup
+ * once their reference has been released.  Multiple instances may then
+ * exist for the same key.
+ *
  * If THREAD_SAFE is not set, neither the object pool nor the object
  * references returned from it may be accessed from multiple threads.
  *
@@ -79,6 +85,7 @@ typedef struct svn_object_pool__t svn_object_pool__t;
  */
 svn_error_t *
 svn_object_pool__create(svn_object_pool__t **object_pool,
+                        svn_boolean_t share,
                         svn_boolean_t thread_safe,
                         apr_pool_t *pool);
 
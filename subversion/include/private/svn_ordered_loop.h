@@ -0,0 +1,116 @@
+/**
+ * @copyright
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ * @endcopyright
+ *
+ * @file svn_ordered_loop.h
+ * @brief Run loop iterations in parallel but consume results in order
+ */
+
+#ifndef SVN_ORDERED_LOOP_H
+#define SVN_ORDERED_LOOP_H
+
+#include <apr_pools.h>
+
+#include "svn_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/** Prepare the private state of a worker thread for
+ * svn_ordered_loop__run().  Set @a *thread_baton to that state, allocated
+ * in @a thread_pool, which lives as long as the thread.  @a baton is the
+ * baton passed to svn_ordered_loop__run().
+ *
+ * This function is called from the thread calling svn_ordered_loop__run().
+ * Use @a scratch_pool for temporary allocations.
+ */
+typedef svn_error_t *
+(*svn_ordered_loop__init_t)(void **thread_baton,
+                            void *baton,
+                            apr_pool_t *thread_pool,
+                            apr_pool_t *scratch_pool);
+
+/** Execute iteration @a task of svn_ordered_loop__run() in a worker thread
+ * with the state @a thread_baton.  Set @a *result to its result, allocated
+ * in @a result_pool.  Returned errors are iteration results as well and
+ * don't stop the loop by themselves.
+ *
+ * Use @a scratch_pool for temporary allocations.
+ */
+typedef svn_error_t *
+(*svn_ordered_loop__task_t)(void **result,
+                            void *thread_baton,
+                            apr_int64_t task,
+                            apr_pool_t *result_pool,
+                            apr_pool_t *scratch_pool);
+
+/** Consume the outcome of iteration @a task of svn_ordered_loop__run(),
+ * i.e. @a result and @a task_err, in the calling thread.  @a baton is the
+ * baton passed to svn_ordered_loop__run().  This function takes ownership
+ * of @a task_err.  Returning an error stops the loop.
+ *
+ * Use @a scratch_pool for temporary allocations.
+ */
+typedef svn_error_t *
+(*svn_ordered_loop__result_t)(void *baton,
+                              apr_int64_t task,
+                              void *result,
+                              svn_error_t *task_err,
+                              apr_pool_t *scratch_pool);
+
+/** Execute @a task_func for all iterations from @a first_task up to but
+ * not including @a end_task on up to @a thread_count worker threads and
+ * pass the outcomes to @a result_func strictly in iteration order from
+ * the calling thread.  This keeps observable side-effects, such as
+ * notifications, in the same order as a sequential loop would.
+ *
+ * At most @a window iterations may be started but not consumed yet at any
+ * time, which limits the memory needed for buffering results.  If
+ * @a init_func is not @c NULL, it gets called once for every worker
+ * thread, otherwise the workers' thread batons are @c NULL.
+ *
+ * If @a result_func returns an error or a worker fails to initialize, no
+ * further iterations get started and the first such error is returned.
+ * Outcomes of iterations that have not been consumed by then get
+ * discarded.
+ *
+ * If APR does not support threading or @a thread_count is 1 or less,
+ * all iterations run in the calling thread.
+ *
+ * Use @a scratch_pool for temporary allocations.
+ */
+svn_error_t *
+svn_ordered_loop__run(apr_int64_t first_task,
+                      apr_int64_t end_task,
+                      int thread_count,
+                      int window,
+                      svn_ordered_loop__init_t init_func,
+                      svn_ordered_loop__task_t task_func,
+                      svn_ordered_loop__result_t result_func,
+                      void *baton,
+                      apr_pool_t *scratch_pool);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* SVN_ORDERED_LOOP_H */
@@ -32,6 +32,7 @@
 #include "svn_error.h"
 #include "svn_ra.h"
 #include "svn_delta.h"
+#include "svn_diff.h"
 #include "svn_editor.h"
 #include "svn_io.h"
 
@@ -307,6 +308,57 @@ svn_ra__replay_ev2(svn_ra_session_t *session,
                    svn_editor_t *editor,
                    apr_pool_t *scratch_pool);
 
+/**
+ * One chunk of consecutive lines attributed to the same revision in the
+ * result of svn_ra__get_blame().
+ *
+ * @since New in 1.10.
+ */
+typedef struct svn_ra__blame_chunk_t
+{
+  /** Number of the first line of the chunk, counting from 0.  The chunk
+   * extends up to the @c start of the next chunk or to the end of file. */
+  apr_int64_t start;
+
+  /** Revision that last modified these lines, or @c SVN_INVALID_REVNUM
+   * if they are older than the start revision of the blame. */
+  svn_revnum_t revision;
+
+  /** The revision properties of @c revision, shared between all chunks
+   * of the same revision.  @c NULL if @c revision is invalid. */
+  apr_hash_t *rev_props;
+} svn_ra__blame_chunk_t;
+
+/**
+ * Let the server compute which revision between @a start and @a end last
+ * modified each line of the file at @a path, with lines being compared
+ * according to @a diff_options (may be @c NULL).  Return the result in
+ * @a *chunks as an array of #svn_ra__blame_chunk_t, ordered by line
+ * number and referring to the lines of @a path in revision @a end.
+ *
+ * This produces the same annotation as a client processing the results
+ * of svn_ra_get_file_revs2() for @a start - 1 to @a end without merged
+ * revisions, but the file contents never leave the server.
+ *
+ * @a start must not be younger than @a end.  If the server does not
+ * have the #SVN_RA_CAPABILITY_SERVER_BLAME capability, return
+ * @c SVN_ERR_UNSUPPORTED_FEATURE.
+ *
+ * Allocate the result in @a result_pool and use @a scratch_pool for
+ * temporary allocations.
+ *
+ * @since New in 1.10.
+ */
+svn_error_t *
+svn_ra__get_blame(svn_ra_session_t *session,
+                  apr_array_header_t **chunks,
+                  const char *path,
+                  svn_revnum_t start,
+                  svn_revnum_t end,
+                  const svn_diff_file_options_t *diff_options,
+                  apr_pool_t *result_pool,
+                  apr_pool_t *scratch_pool);
+
 
 #ifdef __cplusplus
 }
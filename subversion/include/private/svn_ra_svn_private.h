@@ -141,6 +141,14 @@ svn_ra_svn__set_shim_callbacks(svn_ra_svn_conn_t *conn,
 apr_pool_t *
 svn_ra_svn__get_pool(svn_ra_svn_conn_t *conn);
 
+/**
+ * Return the svndiff version to use when sending text deltas over @a conn.
+ * That is 0 if compression has been disabled for @a conn, 2 (LZ4) if the
+ * other side accepts it and 1 (zlib) otherwise.
+ */
+int
+svn_ra_svn__svndiff_version(svn_ra_svn_conn_t *conn);
+
 /**
  * @defgroup ra_svn_deprecated ra_svn low-level functions
  * @{
@@ -173,6 +181,28 @@ svn_ra_svn__write_cstring(svn_ra_svn_conn_t *conn,
                           apr_pool_t *pool,
                           const char *s);
 
+/** Write the @a length bytes at @a offset in @a file over the net as a
+ * sequence of strings, just like file contents get sent by e.g. get-file.
+ * The sequence is not terminated.
+ *
+ * Where the platform and the connection allow for it, the data is passed
+ * from @a file to the socket without copying it into user space first.
+ * Otherwise, it gets read into the write buffer.  Pending buffered data
+ * will be flushed in either case.
+ *
+ * If @a file is too short to hold the span, return
+ * #SVN_ERR_STREAM_UNEXPECTED_EOF before writing anything.  If reading
+ * from @a file fails later on, the strings written so far remain
+ * well-formed, so the caller may still terminate the sequence and report
+ * the error as a command failure.
+ */
+svn_error_t *
+svn_ra_svn__write_file_span(svn_ra_svn_conn_t *conn,
+                            apr_pool_t *pool,
+                            apr_file_t *file,
+                            apr_off_t offset,
+                            svn_filesize_t length);
+
 /** Write a word over the net.
  *
  * Writes will be buffered until the next read or flush.
@@ -330,6 +360,31 @@ svn_ra_svn__read_tuple(svn_ra_svn_conn_t *conn,
                        apr_pool_t *pool,
                        const char *fmt, ...);
 
+/** Look at the command word of the command tuple "( word ( params ) )"
+ * that @a conn will read next, without consuming any of it.  Set
+ * @a command to the word, pointing into @a conn's read buffer, i.e. it
+ * is only valid until the next read and not NUL-terminated.  If the next
+ * item is not a command tuple or its word has not been received completely
+ * yet, set @a command's data to @c NULL.  Use @a pool for temporaries.
+ */
+svn_error_t *
+svn_ra_svn__peek_command(svn_string_t *command,
+                         svn_ra_svn_conn_t *conn,
+                         apr_pool_t *pool);
+
+/** Read a command tuple "( word ( params ) )" from @a conn and parse its
+ * params as svn_ra_svn__parse_tuple() would, using @a fmt.  Extra
+ * elements after params are ignored.  Allocate the results in @a pool.
+ *
+ * Unlike svn_ra_svn__read_tuple(), this does not create a list of items
+ * for a command that fits into the read buffer but fills the arguments
+ * straight from the raw data.
+ */
+svn_error_t *
+svn_ra_svn__read_command_tuple(svn_ra_svn_conn_t *conn,
+                               apr_pool_t *pool,
+                               const char *fmt, ...);
+
 /** Parse an array of @c svn_ra_svn__item_t structures as a list of
  * properties, storing the properties in a hash table.
  *
@@ -350,9 +405,13 @@ svn_ra_svn__read_cmd_response(svn_ra_svn_conn_t *conn,
 
 /** Check the receive buffer and socket of @a conn whether there is some
  * unprocessed incoming data without waiting for new data to come in.
- * If data is found, set @a *has_command to TRUE.  If the connection does
+ * If a complete command has been received, or one that is too large for
+ * the receive buffer, set @a *has_command to TRUE.  If the connection does
  * not contain any more data and has been closed, set @a *terminated to
  * TRUE.
+ *
+ * If there is no complete command, @a conn is considered idle and I/O
+ * buffers that grew during bulk transfers are released.
  */
 svn_error_t *
 svn_ra_svn__has_command(svn_boolean_t *has_command,
@@ -375,6 +434,40 @@ svn_ra_svn__handle_command(svn_boolean_t *terminate,
                            svn_boolean_t error_on_disconnect,
                            apr_pool_t *pool);
 
+/** Hook function type, called by svn_ra_svn__handle_command() for every
+ * known command @a cmdname it handles on @a conn, e.g. to collect
+ * statistics.  It gets called once with @a finished set to FALSE right
+ * before the command handler gets executed and once with @a finished set
+ * to TRUE right after it.  In the latter case, @a failed tells whether
+ * the handler returned an error.  @a baton is the value given to
+ * svn_ra_svn__set_command_hook().
+ *
+ * Commands handled from within other command handlers, like the reporter
+ * commands during an update, trigger the hook as well.
+ */
+typedef void
+(*svn_ra_svn__command_hook_t)(void *baton,
+                              svn_ra_svn_conn_t *conn,
+                              const char *cmdname,
+                              svn_boolean_t finished,
+                              svn_boolean_t failed);
+
+/** Make svn_ra_svn__handle_command() call @a hook with @a baton for
+ * every command handled on @a conn.  @a hook may be NULL.
+ */
+void
+svn_ra_svn__set_command_hook(svn_ra_svn_conn_t *conn,
+                             svn_ra_svn__command_hook_t hook,
+                             void *baton);
+
+/** Set @a *bytes_in and @a *bytes_out to the total number of bytes
+ * received and sent over @a conn so far.
+ */
+void
+svn_ra_svn__get_io_totals(svn_ra_svn_conn_t *conn,
+                          apr_uint64_t *bytes_in,
+                          apr_uint64_t *bytes_out);
+
 /** Accept commands over the network and handle them according to @a
  * commands.  Command handlers will be passed @a conn, a subpool of @a
  * pool (cleared after each command is handled), the parameters of the
@@ -765,8 +858,19 @@ svn_ra_svn__write_cmd_get_file(svn_ra_svn_conn_t *conn,
                                svn_boolean_t props,
                                svn_boolean_t stream);
 
-/** Send a "update" command over connection @a conn.
+/** Send a "fetch-many" command over connection @a conn, requesting the
+ * contents of the files at @a paths (const char *) in revision @a rev.
  * Use @a pool for allocations.
+ */
+svn_error_t *
+svn_ra_svn__write_cmd_fetch_many(svn_ra_svn_conn_t *conn,
+                                 apr_pool_t *pool,
+                                 svn_revnum_t rev,
+                                 const apr_array_header_t *paths);
+
+/** Send a "update" command over connection @a conn.  If @a text_deltas
+ * is FALSE, ask the server to not send any text deltas but only signal
+ * content changes.  Use @a pool for allocations.
  *
  * @see #svn_ra_do_update3 for a description.
  */
@@ -778,7 +882,8 @@ svn_ra_svn__write_cmd_update(svn_ra_svn_conn_t *conn,
                              svn_boolean_t recurse,
                              svn_depth_t depth,
                              svn_boolean_t send_copyfrom_args,
-                             svn_boolean_t ignore_ancestry);
+                             svn_boolean_t ignore_ancestry,
+                             svn_boolean_t text_deltas);
 
 /** Send a "switch" command over connection @a conn.
  * Use @a pool for allocations.
@@ -33,6 +33,7 @@
 #include "svn_repos.h"
 #include "svn_editor.h"
 #include "svn_config.h"
+#include "svn_diff.h"
 
 #include "private/svn_object_pool.h"
 #include "private/svn_string_private.h"
@@ -151,6 +152,79 @@ svn_repos__get_logs_compat(svn_repos_t *repos,
                            void *receiver_baton,
                            apr_pool_t *pool);
 
+/**
+ * Default for the largest file that servers will load into memory for
+ * svn_repos__blame().
+ *
+ * @since New in 1.10.
+ */
+#define SVN_REPOS__BLAME_MAX_FILE_SIZE (APR_INT64_C(16) * 0x100000)
+
+/**
+ * One chunk of consecutive lines attributed to the same revision in the
+ * result of svn_repos__blame().
+ *
+ * @since New in 1.10.
+ */
+typedef struct svn_repos__blame_chunk_t
+{
+  /** Number of the first line of the chunk, counting from 0.  The chunk
+   * extends up to the @c start of the next chunk or to the end of file. */
+  apr_int64_t start;
+
+  /** Revision that last modified these lines, or @c SVN_INVALID_REVNUM
+   * if they are older than the start revision of the blame. */
+  svn_revnum_t revision;
+} svn_repos__blame_chunk_t;
+
+/**
+ * Annotate each line of the file at @a path in @a repos with the
+ * revision between @a start and @a end that last modified it, and return
+ * the result as an array of #svn_repos__blame_chunk_t in @a *chunks,
+ * ordered by line number.  The lines are those of the file contents in
+ * the youngest revision <= @a end that changed them.
+ *
+ * This is what a client would compute from the deltas sent by
+ * svn_repos_get_file_revs2() with @a include_merged_revisions set to
+ * @c FALSE and a start revision of @a start - 1, but it requires only
+ * two fulltexts in memory at any time and reads them through the
+ * filesystem caches.  @a diff_options controls how lines are compared
+ * and may be @c NULL for the default.
+ *
+ * Invalid @a start or @a end default to the youngest revision.  If
+ * @a start is younger than @a end, return @c SVN_ERR_UNSUPPORTED_FEATURE.
+ *
+ * Since the fulltexts are held in memory, return
+ * @c SVN_ERR_UNSUPPORTED_FEATURE as well if any of them is binary
+ * according to its svn:mime-type or larger than @a max_file_size bytes.
+ * A @a max_file_size of 0 means no limit.  Clients may then fall back to
+ * svn_repos_get_file_revs2(), which streams the contents.
+ *
+ * If @a authz_read_func is not @c NULL, stop the history walk at the
+ * first revision of @a path that is not readable according to it and
+ * @a authz_read_baton.  Call @a cancel_func with @a cancel_baton
+ * periodically, if not @c NULL.
+ *
+ * Allocate the result in @a result_pool and use @a scratch_pool for
+ * temporary allocations.
+ *
+ * @since New in 1.10.
+ */
+svn_error_t *
+svn_repos__blame(apr_array_header_t **chunks,
+                 svn_repos_t *repos,
+                 const char *path,
+                 svn_revnum_t start,
+                 svn_revnum_t end,
+                 const svn_diff_file_options_t *diff_options,
+                 svn_filesize_t max_file_size,
+                 svn_repos_authz_func_t authz_read_func,
+                 void *authz_read_baton,
+                 svn_cancel_func_t cancel_func,
+                 void *cancel_baton,
+                 apr_pool_t *result_pool,
+                 apr_pool_t *scratch_pool);
+
 /**
  * @defgroup svn_config_pool Configuration object pool API
  * @{
@@ -203,6 +277,59 @@ svn_repos__config_pool_get(svn_config_t **cfg,
 
 /** @} */
 
+/**
+ * @defgroup svn_repos_pool Repository object pool API
+ * @{
+ */
+
+/* Opaque thread-safe factory and container for opened repositories.
+ *
+ * Unlike configuration objects, a repository instance carries per-session
+ * state such as the FS access context.  It is therefore handed out to at
+ * most one caller at a time and returned to the pool once that caller
+ * releases it.  Unused instances may linger for a while before being
+ * cleaned up.
+ */
+typedef svn_object_pool__t svn_repos__repos_pool_t;
+
+/* Create a new repository pool object with a lifetime determined by
+ * POOL and return it in *REPOS_POOL.
+ *
+ * The THREAD_SAFE flag indicates whether the pool actually needs to be
+ * thread-safe and POOL must be also be thread-safe if this flag is set.
+ */
+svn_error_t *
+svn_repos__repos_pool_create(svn_repos__repos_pool_t **repos_pool,
+                             svn_boolean_t thread_safe,
+                             apr_pool_t *pool);
+
+/* Set *REPOS_P to an opened repository at PATH, just like svn_repos_open3
+ * with FS_CONFIG would.  Re-use an unused instance from REPOS_POOL, if
+ * there is one.  Otherwise, open the repository and add it to REPOS_POOL.
+ *
+ * Instances become stale when the repository or filesystem format or
+ * the filesystem UUID change.  Those will not be handed out anymore.
+ *
+ * FS_CONFIG is only used when opening new instances, so all users of
+ * REPOS_POOL should pass the same configuration.
+ *
+ * RESULT_POOL determines how long the caller keeps *REPOS_P checked out
+ * and must not exceed the lifetime of the pool provided to
+ * #svn_repos__repos_pool_create.  Upon release, the FS access context,
+ * the FS warning function and the remembered client capabilities get
+ * reset, so callers must install their own per-session settings again.
+ * Use SCRATCH_POOL for temporaries.
+ */
+svn_error_t *
+svn_repos__repos_pool_get(svn_repos_t **repos_p,
+                          svn_repos__repos_pool_t *repos_pool,
+                          const char *path,
+                          apr_hash_t *fs_config,
+                          apr_pool_t *result_pool,
+                          apr_pool_t *scratch_pool);
+
+/** @} */
+
 /* Adjust mergeinfo paths and revisions in ways that are useful when loading
  * a dump stream.
  *
@@ -325,6 +452,35 @@ svn_repos__dump_node_record(svn_stream_t *dump_stream,
                             svn_boolean_t content_length_always,
                             apr_pool_t *scratch_pool);
 
+/**
+ * Pre-load the caches of the filesystem in @a repos with the data most
+ * likely needed by the first requests after a restart.
+ *
+ * That is the revprops and changed paths lists of the youngest revisions,
+ * back to the start of the most recently packed shard, followed by the
+ * directories and node revisions of the HEAD tree, walked breadth-first.
+ * If @a include_fulltexts is set, also read the file contents.  Reading
+ * that data implicitly loads the index pages of the respective revisions.
+ *
+ * Stop once approximately @a budget bytes have been read; 0 means no
+ * limit.  If not @c NULL, set @a *nodes to the number of nodes and
+ * @a *bytes to the approximate amount of data visited.
+ *
+ * This function is meant to run in a background thread of a long-running
+ * server process.  Use @a scratch_pool for temporary allocations.
+ *
+ * @since New in 1.10.
+ */
+svn_error_t *
+svn_repos__warm_caches(apr_uint64_t *nodes,
+                       apr_uint64_t *bytes,
+                       svn_repos_t *repos,
+                       apr_uint64_t budget,
+                       svn_boolean_t include_fulltexts,
+                       svn_cancel_func_t cancel_func,
+                       void *cancel_baton,
+                       apr_pool_t *scratch_pool);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
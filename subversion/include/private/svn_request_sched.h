@@ -0,0 +1,124 @@
+/**
+ * @copyright
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ * @endcopyright
+ *
+ * @file svn_request_sched.h
+ * @brief Adaptive scheduling of pipelined requests over connections
+ */
+
+#ifndef SVN_REQUEST_SCHED_H
+#define SVN_REQUEST_SCHED_H
+
+#include <apr_time.h>
+
+#include "svn_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/** Lower bound of #svn_request_sched__t.pipeline_depth. */
+#define SVN_REQUEST_SCHED__MIN_PIPELINE_DEPTH 8
+
+/**
+ * The observations and decisions of a request scheduler, which adapts
+ * the number of connections to use and the number of requests pipelined
+ * on each of them to the observed latency and throughput.
+ *
+ * The scheduler measures completed requests in windows of at least 16
+ * requests and 250 ms.  The fastest response in a window is its estimate
+ * for the round trip time.  It keeps enough requests in flight on every
+ * connection to cover the bandwidth-delay product.  When the active
+ * connections are saturated, it activates another one and retires it
+ * again if that did not raise the throughput by 10% within the next
+ * window.  It resumes probing once the throughput dropped by 25%.
+ *
+ * The scheduler does not use the clock itself, so its users can feed it
+ * simulated times.
+ *
+ * Users may read the public fields.  They may only raise @a active_conns
+ * as long as the scheduler has not @a measured anything.
+ */
+typedef struct svn_request_sched__t
+{
+  /** Number of connections that new requests shall be scheduled on. */
+  int active_conns;
+
+  /** Number of requests to keep in flight per active connection. */
+  unsigned int pipeline_depth;
+
+  /** Has at least one measurement window been evaluated? */
+  svn_boolean_t measured;
+
+  /* The remainder is private. */
+
+  /* Upper limit for ACTIVE_CONNS. */
+  int max_conns;
+
+  /* Do all requests share a single multiplexing connection? */
+  svn_boolean_t multiplexed;
+
+  /* Did we activate another connection at the end of the last window? */
+  svn_boolean_t grown;
+
+  /* Did more connections stop paying off? */
+  svn_boolean_t stalled;
+
+  /* Throughput in bytes per second before the last growth or at the time
+     we stalled. */
+  apr_uint64_t reference_throughput;
+
+  /* The current measurement window. */
+  apr_time_t window_start;
+  unsigned int window_requests;
+  apr_uint64_t window_bytes;
+  apr_interval_time_t window_min_latency;
+} svn_request_sched__t;
+
+/** Initialize @a sched to use a single connection and to never activate
+ * more than @a max_conns connections.  If @a multiplexed is set, all
+ * requests go over a single connection and only the pipeline depth, i.e.
+ * the number of concurrent streams, gets adapted.
+ */
+void
+svn_request_sched__init(svn_request_sched__t *sched,
+                        int max_conns,
+                        svn_boolean_t multiplexed);
+
+/** Let @a sched account for a request that completed at time @a now after
+ * @a latency with @a bytes of response data.  @a in_flight is the number
+ * of requests that have been sent but not completed yet.
+ *
+ * If this completes a measurement window, update the public fields of
+ * @a sched.
+ */
+void
+svn_request_sched__request_done(svn_request_sched__t *sched,
+                                apr_time_t now,
+                                apr_interval_time_t latency,
+                                apr_uint64_t bytes,
+                                unsigned int in_flight);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* SVN_REQUEST_SCHED_H */
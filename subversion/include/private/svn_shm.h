@@ -0,0 +1,91 @@
+/**
+ * @copyright
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ * @endcopyright
+ *
+ * @file svn_shm.h
+ * @brief Memory and mutexes shared with forked child processes
+ */
+
+#ifndef SVN_SHM_H
+#define SVN_SHM_H
+
+#include <apr_pools.h>
+#include <apr_global_mutex.h>
+
+#include "svn_error.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * Pre-forking servers may place data in anonymous shared memory before
+ * they fork their workers.  The memory gets inherited at the same address
+ * by every process forked afterwards.  Accessing it requires a mutex that
+ * serializes the threads of all these processes.
+ *
+ * The usage pattern is:
+ *
+ *   - In the parent, allocate the data with svn_shm__alloc() and create
+ *     its mutexes with svn_shm__mutex_create().
+ *   - In every child, call svn_shm__mutex_child_init() for each mutex
+ *     before using it.
+ */
+
+/** Allocate @a size bytes of zero-initialized anonymous shared memory
+ * and return it in @a *result.  The memory remains valid as long as
+ * @a pool does.
+ *
+ * Return #SVN_ERR_UNSUPPORTED_FEATURE if APR has no shared memory support.
+ */
+svn_error_t *
+svn_shm__alloc(void **result,
+               apr_size_t size,
+               apr_pool_t *pool);
+
+/** Create a mutex in @a *mutex that serializes access to shared memory
+ * across the threads of the current process and of all processes forked
+ * from it later.  Allocate it in @a pool.
+ *
+ * The mutex is a process-shared pthread mutex, which needs neither a lock
+ * file nor a name.  Return #SVN_ERR_UNSUPPORTED_FEATURE if APR does not
+ * support those.
+ */
+svn_error_t *
+svn_shm__mutex_create(apr_global_mutex_t **mutex,
+                      apr_pool_t *pool);
+
+/** Re-attach @a mutex, created by svn_shm__mutex_create() in a parent
+ * process, in a freshly forked child process.  Use @a pool for any
+ * per-process resources.
+ *
+ * Only the process-local mutex object gets updated.  So, the pointer
+ * @a mutex itself may be stored in shared memory.
+ */
+svn_error_t *
+svn_shm__mutex_child_init(apr_global_mutex_t *mutex,
+                          apr_pool_t *pool);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* SVN_SHM_H */
@@ -295,6 +295,22 @@ svn_checksum__wrap_write_stream_fnv1a_32x4(apr_uint32_t *digest,
                                            svn_stream_t *inner_stream,
                                            apr_pool_t *pool);
 
+/**
+ * Return a stream that calculates both, the MD5 and the SHA-1 checksum,
+ * in a single pass over all data written to the @a inner_stream.  When
+ * the returned stream gets closed, write the checksums to
+ * @a *md5_checksum and @a *sha1_checksum, respectively.  Neither of them
+ * may be @c NULL.  Allocate the result in @a pool.
+ *
+ * @note The stream returned only supports #svn_stream_write and
+ * #svn_stream_close.
+ */
+svn_stream_t *
+svn_checksum__wrap_write_stream_md5_sha1(svn_checksum_t **md5_checksum,
+                                         svn_checksum_t **sha1_checksum,
+                                         svn_stream_t *inner_stream,
+                                         apr_pool_t *pool);
+
 /**
  * Return a 32 bit FNV-1a checksum for the first @a len bytes in @a input.
  *
@@ -573,6 +589,24 @@ svn__decompress(const void *data, apr_size_t len,
                 svn_stringbuf_t *out,
                 apr_size_t limit);
 
+/* Compress the data from DATA with length LEN using LZ4 and write the
+ * result to OUT.  Like svn__compress(), the original length will be
+ * prepended and the data will be stored uncompressed if LZ4 does not
+ * reduce its size.
+ */
+svn_error_t *
+svn__compress_lz4(const void *data, apr_size_t len,
+                  svn_stringbuf_t *out);
+
+/* Decompress the LZ4 compressed data from DATA with length LEN and write
+ * the result to OUT.  Return an error if the decompressed size is larger
+ * than LIMIT.
+ */
+svn_error_t *
+svn__decompress_lz4(const void *data, apr_size_t len,
+                    svn_stringbuf_t *out,
+                    apr_size_t limit);
+
 /** @} */
 
 /**
@@ -118,6 +118,13 @@ typedef struct svn_config_t svn_config_t;
 /** @since New in 1.9. */
 #define SVN_CONFIG_OPTION_SERF_LOG_LEVEL            "serf-log-level"
 
+/** @since New in 1.10. */
+#define SVN_CONFIG_OPTION_SVN_FETCH_CONNECTIONS     "svn-fetch-connections"
+/** @since New in 1.10. */
+#define SVN_CONFIG_OPTION_HTTP_COMMIT_PIPELINE_SIZE "http-commit-pipeline-size"
+/** @since New in 1.10. */
+#define SVN_CONFIG_OPTION_HTTP_BINARY_FRAMES        "http-binary-frames"
+
 
 #define SVN_CONFIG_CATEGORY_CONFIG          "config"
 #define SVN_CONFIG_SECTION_AUTH                 "auth"
@@ -171,6 +178,10 @@ typedef struct svn_config_t svn_config_t;
 #define SVN_CONFIG_OPTION_SQLITE_EXCLUSIVE_CLIENTS  "exclusive-locking-clients"
 /** @since New in 1.9. */
 #define SVN_CONFIG_OPTION_SQLITE_BUSY_TIMEOUT       "busy-timeout"
+/** @since New in 1.10. */
+#define SVN_CONFIG_OPTION_PRISTINE_CACHE_DIR        "pristine-cache-dir"
+/** @since New in 1.10. */
+#define SVN_CONFIG_OPTION_PRISTINE_CACHE_SIZE       "pristine-cache-size"
 /** @} */
 
 /** @name Repository conf directory configuration files strings
@@ -235,6 +246,8 @@ typedef struct svn_config_t svn_config_t;
 #define SVN_CONFIG_DEFAULT_OPTION_STORE_SSL_CLIENT_CERT_PP_PLAINTEXT \
                                                              SVN_CONFIG_ASK
 #define SVN_CONFIG_DEFAULT_OPTION_HTTP_MAX_CONNECTIONS       4
+#define SVN_CONFIG_DEFAULT_OPTION_SVN_FETCH_CONNECTIONS      0
+#define SVN_CONFIG_DEFAULT_OPTION_HTTP_COMMIT_PIPELINE_SIZE  16384
 
 /** Read configuration information from the standard sources and merge it
  * into the hash @a *cfg_hash.  If @a config_dir is not NULL it specifies a
@@ -395,6 +395,35 @@ extern "C" {
 #define SVN_DAV_NS_DAV_SVN_SVNDIFF1\
             SVN_DAV_PROP_NS_DAV "svn/svndiff1"
 
+/** Presence of this in a DAV header in an OPTIONS response indicates
+ * that the transmitter (in this case, the server) knows how to handle
+ * svndiff3 format encoding, i.e. LZ4 compressed deltas with windows of
+ * up to 1 MB.
+ *
+ * @since New in 1.10.
+ */
+#define SVN_DAV_NS_DAV_SVN_SVNDIFF3\
+            SVN_DAV_PROP_NS_DAV "svn/svndiff3"
+
+/** Presence of this in a DAV header in an OPTIONS response indicates
+ * that the transmitter (in this case, the server) knows how to handle
+ * the blame-report, i.e. computing blame information itself.
+ *
+ * @since New in 1.10.
+ */
+#define SVN_DAV_NS_DAV_SVN_SERVER_BLAME\
+            SVN_DAV_PROP_NS_DAV "svn/server-blame"
+
+/** Presence of this in a DAV header in an OPTIONS response indicates
+ * that the transmitter (in this case, the server) knows how to send
+ * send-all update-report responses as length-prefixed binary frames
+ * carrying raw svndiff instead of XML with base64-encoded svndiff.
+ *
+ * @since New in 1.10.
+ */
+#define SVN_DAV_NS_DAV_SVN_BINARY_UPDATE\
+            SVN_DAV_PROP_NS_DAV "svn/binary-update"
+
 
 /** @} */
 
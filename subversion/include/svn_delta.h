@@ -508,7 +508,16 @@ svn_txdelta_apply(svn_stream_t *source,
  * version is @a svndiff_version. @a compression_level is the zlib
  * compression level from 0 (no compression) and 9 (maximum compression).
  *
- * @since New in 1.7.
+ * Version 0 stores the delta uncompressed, version 1 compresses it
+ * using zlib and version 2 uses LZ4.  For the latter, any non-zero
+ * @a compression_level enables compression.  Version 3 is compressed
+ * like version 2 but also allows for windows of up to 1 MB, i.e. ten
+ * times the size of the windows produced by svn_txdelta2().  It also
+ * encodes copy offsets relative to the previous source copy and to the
+ * current target position, respectively, which makes them shorter.
+ * Receivers that do not understand version 3 would reject such streams.
+ *
+ * @since New in 1.7.  Since 1.10, @a svndiff_version may be 2 or 3.
  */
 void
 svn_txdelta_to_svndiff3(svn_txdelta_window_handler_t *handler,
@@ -2540,6 +2540,33 @@ svn_fs_try_process_file_contents(svn_boolean_t *success,
                                  void* baton,
                                  apr_pool_t *pool);
 
+/** Locate the contents of the file @a path in @a root on disk.  If the
+ * backend stores them verbatim in a single file, set @a *file to that
+ * file, opened for reading, and @a *offset and @a *length to the
+ * position and size of the contents within it.  Otherwise, set @a *file
+ * to @c NULL and leave @a *offset and @a *length untouched.
+ *
+ * This function is intended to support zero copy data transfers such as
+ * sendfile().  Like svn_fs_try_process_file_contents(), it is a
+ * best-effort function and may not be implemented for all data backends
+ * or not be applicable for certain content.  Unlike svn_fs_file_contents(),
+ * the data will not be verified against its checksum.  Backends should
+ * check that @a *file is large enough to hold the span, though.
+ *
+ * Allocate @a *file in @a result_pool and use @a scratch_pool for
+ * temporary allocations.
+ *
+ * @since New in 1.10.
+ */
+svn_error_t *
+svn_fs_file_contents_span(apr_file_t **file,
+                          apr_off_t *offset,
+                          svn_filesize_t *length,
+                          svn_fs_root_t *root,
+                          const char *path,
+                          apr_pool_t *result_pool,
+                          apr_pool_t *scratch_pool);
+
 /** Create a new file named @a path in @a root.  The file's initial contents
  * are the empty string, and it has no properties.  @a root must be the
  * root of a transaction, not a revision.
@@ -3300,12 +3327,55 @@ typedef svn_error_t *(*svn_fs_pack_notify_t)(void *baton,
                                              svn_fs_pack_notify_action_t action,
                                              apr_pool_t *pool);
 
+/** Like #svn_fs_pack_notify_t but with additional statistics.
+ *
+ * For #svn_fs_pack_notify_end, @a bytes is the size of the pack data
+ * written for @a shard and @a duration is the time spent on producing
+ * it.  Both are 0 if the backend does not provide that information and
+ * for all other @a action types.
+ *
+ * @since New in 1.10.
+ */
+typedef svn_error_t *(*svn_fs_pack_notify2_t)(
+  void *baton,
+  apr_int64_t shard,
+  svn_fs_pack_notify_action_t action,
+  apr_off_t bytes,
+  apr_interval_time_t duration,
+  apr_pool_t *pool);
+
 /**
  * Possibly update the filesystem located in the directory @a path
  * to use disk space more efficiently.
  *
+ * If @a jobs is larger than 1, the backend may pack up to that many
+ * shards concurrently.  Notifications will still be sent in shard order
+ * and from the calling thread but @a cancel_func may be called from
+ * other threads.  In that case, #svn_fs_pack_notify_start only marks the
+ * point at which the shard's packed data is about to be committed; the
+ * data itself may already have been written by then.  The statistics
+ * passed with #svn_fs_pack_notify_end still cover all of the packing.
+ * Backends that don't support concurrent packing ignore @a jobs.
+ *
+ * @since New in 1.10.
+ */
+svn_error_t *
+svn_fs_pack2(const char *db_path,
+             int jobs,
+             svn_fs_pack_notify2_t notify_func,
+             void *notify_baton,
+             svn_cancel_func_t cancel_func,
+             void *cancel_baton,
+             apr_pool_t *pool);
+
+/**
+ * Like svn_fs_pack2() but with @a jobs set to 1 and using a
+ * #svn_fs_pack_notify_t notification callback.
+ *
  * @since New in 1.6.
+ * @deprecated Provided for backward compatibility with the 1.9 API.
  */
+SVN_DEPRECATED
 svn_error_t *
 svn_fs_pack(const char *db_path,
             svn_fs_pack_notify_t notify_func,
@@ -2240,6 +2240,14 @@ svn_ra_has_capability(svn_ra_session_t *session,
  */
 #define SVN_RA_CAPABILITY_LIST "list"
 
+/**
+ * The capability of a server to compute blame information itself,
+ * see svn_ra__get_blame().
+ *
+ * @since New in 1.10.
+ */
+#define SVN_RA_CAPABILITY_SERVER_BLAME "server-blame"
+
 
 /*       *** PLEASE READ THIS IF YOU ADD A NEW CAPABILITY ***
  *
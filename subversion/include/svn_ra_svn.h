@@ -70,6 +70,14 @@ extern "C" {
 #define SVN_RA_SVN_CAP_GET_FILE_REVS_REVERSE "file-revs-reverse"
 /* maps to SVN_RA_CAPABILITY_LIST */
 #define SVN_RA_SVN_CAP_LIST "list"
+/* maps to SVN_RA_CAPABILITY_SERVER_BLAME */
+#define SVN_RA_SVN_CAP_SERVER_BLAME "server-blame"
+/* peer can decode LZ4 compressed svndiff2 data */
+#define SVN_RA_SVN_CAP_ACCEPTS_SVNDIFF2 "accepts-svndiff2"
+/* peer can decode svndiff3 data with windows of up to 1 MB */
+#define SVN_RA_SVN_CAP_ACCEPTS_SVNDIFF3 "accepts-svndiff3"
+/* server supports the fetch-many command and updates without text deltas */
+#define SVN_RA_SVN_CAP_FETCH_MANY "fetch-many"
 
 
 /** ra_svn passes @c svn_dirent_t fields over the wire as a list of
@@ -250,7 +250,10 @@ typedef enum svn_repos_notify_action_t
   svn_repos_notify_pack_noop,
 
   /** The revision properties got set. @since New in 1.10. */
-  svn_repos_notify_load_revprop_set
+  svn_repos_notify_load_revprop_set,
+
+  /** A revision has been added to the log index. @since New in 1.10. */
+  svn_repos_notify_log_index_rev_end
 } svn_repos_notify_action_t;
 
 /** The type of warning occurring.
@@ -317,8 +320,9 @@ typedef struct svn_repos_notify_t
   /** Action that describes what happened in the repository. */
   svn_repos_notify_action_t action;
 
-  /** For #svn_repos_notify_dump_rev_end and #svn_repos_notify_verify_rev_end,
-   * the revision which just completed.
+  /** For #svn_repos_notify_dump_rev_end, #svn_repos_notify_verify_rev_end
+   * and #svn_repos_notify_log_index_rev_end, the revision which just
+   * completed.
    * For #svn_fs_upgrade_format_bumped, the new format version. */
   svn_revnum_t revision;
 
@@ -361,6 +365,16 @@ typedef struct svn_repos_notify_t
       @since New in 1.9. */
   svn_revnum_t end_revision;
 
+  /** For #svn_repos_notify_pack_shard_end, the size of the pack data
+      written for @a shard, or 0 if unknown.
+      @since New in 1.10. */
+  apr_off_t bytes;
+
+  /** For #svn_repos_notify_pack_shard_end, the time it took to write
+      that pack data, or 0 if unknown.
+      @since New in 1.10. */
+  apr_interval_time_t duration;
+
   /* NOTE: Add new fields at the end to preserve binary compatibility.
      Also, if you add fields here, you have to update
      svn_repos_notify_create(). */
@@ -712,8 +726,28 @@ svn_repos_hotcopy(const char *src_path,
  * Possibly update the repository, @a repos, to use a more efficient
  * filesystem representation.  Use @a pool for allocations.
  *
+ * Allow the backend to pack up to @a jobs shards concurrently; see
+ * svn_fs_pack2() for details.  Notifications will be sent in shard order
+ * and from the calling thread.
+ *
+ * @since New in 1.10.
+ */
+svn_error_t *
+svn_repos_fs_pack3(svn_repos_t *repos,
+                   int jobs,
+                   svn_repos_notify_func_t notify_func,
+                   void *notify_baton,
+                   svn_cancel_func_t cancel_func,
+                   void *cancel_baton,
+                   apr_pool_t *pool);
+
+/**
+ * Similar to svn_repos_fs_pack3(), but with @a jobs always set to 1.
+ *
  * @since New in 1.7.
+ * @deprecated Provided for backward compatibility with the 1.9 API.
  */
+SVN_DEPRECATED
 svn_error_t *
 svn_repos_fs_pack2(svn_repos_t *repos,
                    svn_repos_notify_func_t notify_func,
@@ -2102,6 +2136,11 @@ typedef svn_error_t *(*svn_repos_log_entry_receiver_t)(
  * @a path_change_receiver is @c NULL, the same filtering is performed
  * just without reporting any path changes.
  *
+ * If @a repos has a log index covering @a end (see
+ * svn_repos_build_log_index()) and @a include_merged_revisions is not set,
+ * the revisions that changed @a paths are looked up in that index instead
+ * of walking the node histories.
+ *
  * Use @a scratch_pool for temporary allocations.
  *
  * @see svn_repos_path_change_receiver_t, svn_repos_log_entry_receiver_t
@@ -2125,6 +2164,32 @@ svn_repos_get_logs5(svn_repos_t *repos,
                     void *revision_receiver_baton,
                     apr_pool_t *scratch_pool);
 
+/**
+ * Create the changed-paths log index of @a repos, if it does not exist
+ * yet, and add all revisions of @a repos to it that it does not cover.
+ *
+ * The index maps every path to the revisions that changed it or any path
+ * below it.  Once it exists, svn_repos_fs_commit_txn() keeps it up to date
+ * and svn_repos_get_logs5() uses it for path-restricted queries.  Commits
+ * made by other means are added on the next call to either function.
+ *
+ * For every revision added, invoke @a notify_func with @a notify_baton
+ * and the action #svn_repos_notify_log_index_rev_end, if @a notify_func
+ * is not @c NULL.
+ *
+ * If @a cancel_func is not @c NULL, call it with @a cancel_baton to check
+ * for cancellation.  Use @a scratch_pool for temporary allocations.
+ *
+ * @since New in 1.10.
+ */
+svn_error_t *
+svn_repos_build_log_index(svn_repos_t *repos,
+                          svn_repos_notify_func_t notify_func,
+                          void *notify_baton,
+                          svn_cancel_func_t cancel_func,
+                          void *cancel_baton,
+                          apr_pool_t *scratch_pool);
+
 /**
  * Similar to svn_repos_get_logs5 but using a #svn_log_entry_receiver_t
  * @a receiver to receive revision properties and changed paths through a
@@ -3064,10 +3129,10 @@ enum svn_repos_load_uuid
   svn_repos_load_uuid_force
 };
 
-/** Callback type for use with svn_repos_verify_fs3().  @a revision
+/** Callback type for use with svn_repos_verify_fs4().  @a revision
  * and @a verify_err are the details of a single verification failure
- * that occurred during the svn_repos_verify_fs3() call.  @a baton is
- * the same baton given to svn_repos_verify_fs3().  @a scratch_pool is
+ * that occurred during the svn_repos_verify_fs4() call.  @a baton is
+ * the same baton given to svn_repos_verify_fs4().  @a scratch_pool is
  * provided for the convenience of the implementor, who should not
  * expect it to live longer than a single callback call.
  *
@@ -3077,7 +3142,7 @@ enum svn_repos_load_uuid
  * should also call svn_error_dup() for @a verify_err.  Implementors of this
  * callback are forbidden to call svn_error_clear() for @a verify_err.
  *
- * @see svn_repos_verify_fs3
+ * @see svn_repos_verify_fs4
  *
  * @since New in 1.9.
  */
@@ -3150,12 +3215,43 @@ typedef svn_error_t *(*svn_repos_verify_callback_t)(void *baton,
  * cancel_baton as argument to see if the caller wishes to cancel the
  * verification.
  *
+ * If @a jobs is larger than 1 and APR supports threads, verify up to
+ * @a jobs revisions (or, for the backend-specific checks, shards)
+ * concurrently, each using its own filesystem object.  @a notify_func
+ * and @a verify_callback will still be called from the calling thread
+ * only and in the same order as for a sequential run.  @a cancel_func,
+ * however, may be called concurrently from multiple threads.  The FS
+ * caches should not be configured as single-threaded in that case, see
+ * svn_cache_config_set().
+ *
  * Use @a scratch_pool for temporary allocation.
  *
  * @see svn_repos_verify_callback_t
  *
+ * @since New in 1.10.
+ */
+svn_error_t *
+svn_repos_verify_fs4(svn_repos_t *repos,
+                     svn_revnum_t start_rev,
+                     svn_revnum_t end_rev,
+                     svn_boolean_t check_normalization,
+                     svn_boolean_t metadata_only,
+                     int jobs,
+                     svn_repos_notify_func_t notify_func,
+                     void *notify_baton,
+                     svn_repos_verify_callback_t verify_callback,
+                     void *verify_baton,
+                     svn_cancel_func_t cancel,
+                     void *cancel_baton,
+                     apr_pool_t *scratch_pool);
+
+/**
+ * Like svn_repos_verify_fs4(), but with @a jobs set to 1.
+ *
  * @since New in 1.9.
+ * @deprecated Provided for backward compatibility with the 1.9 API.
  */
+SVN_DEPRECATED
 svn_error_t *
 svn_repos_verify_fs3(svn_repos_t *repos,
                      svn_revnum_t start_rev,
@@ -3213,7 +3309,7 @@ svn_repos_verify_fs(svn_repos_t *repos,
  * Dump the contents of the filesystem within already-open @a repos into
  * writable @a dumpstream.  If @a dumpstream is
  * @c NULL, this is effectively a primitive verify.  It is not complete,
- * however; see instead svn_repos_verify_fs3().
+ * however; see instead svn_repos_verify_fs4().
  *
  * Begin at revision @a start_rev, and dump every revision up through
  * @a end_rev.  If @a start_rev is #SVN_INVALID_REVNUM, start at revision
@@ -37,7 +37,9 @@
 #include "svn_hash.h"
 #include "svn_sorts.h"
 
+#include "private/svn_diff_private.h"
 #include "private/svn_wc_private.h"
+#include "private/svn_ra_private.h"
 
 #include "svn_private_config.h"
 
@@ -52,28 +54,6 @@ struct rev
   const char *path;      /* the absolute repository path */
 };
 
-/* One chunk of blame */
-struct blame
-{
-  const struct rev *rev;    /* the responsible revision */
-  apr_off_t start;          /* the starting diff-token (line) */
-  struct blame *next;       /* the next chunk */
-};
-
-/* A chain of blame chunks */
-struct blame_chain
-{
-  struct blame *blame;      /* linked list of blame chunks */
-  struct blame *avail;      /* linked list of free blame chunks */
-  struct apr_pool_t *pool;  /* Allocate members from this pool. */
-};
-
-/* The baton use for the diff output routine. */
-struct diff_baton {
-  struct blame_chain *chain;
-  const struct rev *rev;
-};
-
 /* The baton used for a file revision. Lives the entire operation */
 struct file_rev_baton {
   svn_revnum_t start_rev, end_rev;
@@ -84,7 +64,7 @@ struct file_rev_baton {
   /* name of file containing the previous revision of the file */
   const char *last_filename;
   struct rev *last_rev;   /* the rev of the last modification */
-  struct blame_chain *chain;      /* the original blame chain. */
+  svn_diff__blame_chain_t *chain;      /* the original blame chain. */
   const char *repos_root_url;    /* To construct a url */
   apr_pool_t *mainpool;  /* lives during the whole sequence of calls */
   apr_pool_t *lastpool;  /* pool used during previous call */
@@ -92,7 +72,7 @@ struct file_rev_baton {
 
   /* These are used for tracking merged revisions. */
   svn_boolean_t include_merged_revisions;
-  struct blame_chain *merged_chain;  /* the merged blame chain. */
+  svn_diff__blame_chain_t *merged_chain;  /* the merged blame chain. */
   /* name of file containing the previous merged revision of the file */
   const char *last_original_filename;
   /* pools for files which may need to persist for more than one rev. */
@@ -123,172 +103,13 @@ struct delta_baton {
 
 
 
-/* Return a blame chunk associated with REV for a change starting
-   at token START, and allocated in CHAIN->mainpool. */
-static struct blame *
-blame_create(struct blame_chain *chain,
-             const struct rev *rev,
-             apr_off_t start)
-{
-  struct blame *blame;
-  if (chain->avail)
-    {
-      blame = chain->avail;
-      chain->avail = blame->next;
-    }
-  else
-    blame = apr_palloc(chain->pool, sizeof(*blame));
-  blame->rev = rev;
-  blame->start = start;
-  blame->next = NULL;
-  return blame;
-}
-
-/* Destroy a blame chunk. */
-static void
-blame_destroy(struct blame_chain *chain,
-              struct blame *blame)
-{
-  blame->next = chain->avail;
-  chain->avail = blame;
-}
-
-/* Return the blame chunk that contains token OFF, starting the search at
-   BLAME. */
-static struct blame *
-blame_find(struct blame *blame, apr_off_t off)
-{
-  struct blame *prev = NULL;
-  while (blame)
-    {
-      if (blame->start > off) break;
-      prev = blame;
-      blame = blame->next;
-    }
-  return prev;
-}
-
-/* Shift the start-point of BLAME and all subsequence blame-chunks
-   by ADJUST tokens */
-static void
-blame_adjust(struct blame *blame, apr_off_t adjust)
-{
-  while (blame)
-    {
-      blame->start += adjust;
-      blame = blame->next;
-    }
-}
-
-/* Delete the blame associated with the region from token START to
-   START + LENGTH */
-static svn_error_t *
-blame_delete_range(struct blame_chain *chain,
-                   apr_off_t start,
-                   apr_off_t length)
-{
-  struct blame *first = blame_find(chain->blame, start);
-  struct blame *last = blame_find(chain->blame, start + length);
-  struct blame *tail = last->next;
-
-  if (first != last)
-    {
-      struct blame *walk = first->next;
-      while (walk != last)
-        {
-          struct blame *next = walk->next;
-          blame_destroy(chain, walk);
-          walk = next;
-        }
-      first->next = last;
-      last->start = start;
-      if (first->start == start)
-        {
-          *first = *last;
-          blame_destroy(chain, last);
-          last = first;
-        }
-    }
-
-  if (tail && tail->start == last->start + length)
-    {
-      *last = *tail;
-      blame_destroy(chain, tail);
-      tail = last->next;
-    }
-
-  blame_adjust(tail, -length);
-
-  return SVN_NO_ERROR;
-}
-
-/* Insert a chunk of blame associated with REV starting
-   at token START and continuing for LENGTH tokens */
-static svn_error_t *
-blame_insert_range(struct blame_chain *chain,
-                   const struct rev *rev,
-                   apr_off_t start,
-                   apr_off_t length)
-{
-  struct blame *head = chain->blame;
-  struct blame *point = blame_find(head, start);
-  struct blame *insert;
-
-  if (point->start == start)
-    {
-      insert = blame_create(chain, point->rev, point->start + length);
-      point->rev = rev;
-      insert->next = point->next;
-      point->next = insert;
-    }
-  else
-    {
-      struct blame *middle;
-      middle = blame_create(chain, rev, start);
-      insert = blame_create(chain, point->rev, start + length);
-      middle->next = insert;
-      insert->next = point->next;
-      point->next = middle;
-    }
-  blame_adjust(insert->next, length);
-
-  return SVN_NO_ERROR;
-}
-
-/* Callback for diff between subsequent revisions */
-static svn_error_t *
-output_diff_modified(void *baton,
-                     apr_off_t original_start,
-                     apr_off_t original_length,
-                     apr_off_t modified_start,
-                     apr_off_t modified_length,
-                     apr_off_t latest_start,
-                     apr_off_t latest_length)
-{
-  struct diff_baton *db = baton;
-
-  if (original_length)
-    SVN_ERR(blame_delete_range(db->chain, modified_start, original_length));
-
-  if (modified_length)
-    SVN_ERR(blame_insert_range(db->chain, db->rev, modified_start,
-                               modified_length));
-
-  return SVN_NO_ERROR;
-}
-
-static const svn_diff_output_fns_t output_fns = {
-        NULL,
-        output_diff_modified
-};
-
 /* Add the blame for the diffs between LAST_FILE and CUR_FILE to CHAIN,
    for revision REV.  LAST_FILE may be NULL in which
    case blame is added for every line of CUR_FILE. */
 static svn_error_t *
 add_file_blame(const char *last_file,
                const char *cur_file,
-               struct blame_chain *chain,
+               svn_diff__blame_chain_t *chain,
                struct rev *rev,
                const svn_diff_file_options_t *diff_options,
                svn_cancel_func_t cancel_func,
@@ -298,21 +119,17 @@ add_file_blame(const char *last_file,
   if (!last_file)
     {
       SVN_ERR_ASSERT(chain->blame == NULL);
-      chain->blame = blame_create(chain, rev, 0);
+      chain->blame = svn_diff__blame_create(chain, rev, 0);
     }
   else
     {
       svn_diff_t *diff;
-      struct diff_baton diff_baton;
-
-      diff_baton.chain = chain;
-      diff_baton.rev = rev;
 
       /* We have a previous file.  Get the diff and adjust blame info. */
       SVN_ERR(svn_diff_file_diff_2(&diff, last_file, cur_file,
                                    diff_options, pool));
-      SVN_ERR(svn_diff_output2(diff, &diff_baton, &output_fns,
-                               cancel_func, cancel_baton));
+      SVN_ERR(svn_diff__blame_apply_diff(chain, diff, rev,
+                                         cancel_func, cancel_baton));
     }
 
   return SVN_NO_ERROR;
@@ -325,7 +142,7 @@ update_blame(void *baton)
 {
   struct delta_baton *dbaton = baton;
   struct file_rev_baton *frb = dbaton->file_rev_baton;
-  struct blame_chain *chain;
+  svn_diff__blame_chain_t *chain;
 
   /* Close the source file used for the delta.
      It is important to do this early, since otherwise, they will be deleted
@@ -596,11 +413,11 @@ file_rev_handler(void *baton, const char *path, svn_revnum_t revnum,
    same starting value.  Both CHAIN_ORIG and CHAIN_MERGED should not be
    NULL.  */
 static void
-normalize_blames(struct blame_chain *chain,
-                 struct blame_chain *chain_merged,
+normalize_blames(svn_diff__blame_chain_t *chain,
+                 svn_diff__blame_chain_t *chain_merged,
                  apr_pool_t *pool)
 {
-  struct blame *walk, *walk_merged;
+  svn_diff__blame_t *walk, *walk_merged;
 
   /* Walk over the CHAIN's blame chunks and CHAIN_MERGED's blame chunks,
      creating new chunks as needed. */
@@ -614,8 +431,9 @@ normalize_blames(struct blame_chain *chain,
       if (walk->next->start < walk_merged->next->start)
         {
           /* insert a new chunk in CHAIN_MERGED. */
-          struct blame *tmp = blame_create(chain_merged, walk_merged->rev,
-                                           walk->next->start);
+          svn_diff__blame_t *tmp
+            = svn_diff__blame_create(chain_merged, walk_merged->rev,
+                                     walk->next->start);
           tmp->next = walk_merged->next;
           walk_merged->next = tmp;
         }
@@ -623,8 +441,9 @@ normalize_blames(struct blame_chain *chain,
       if (walk->next->start > walk_merged->next->start)
         {
           /* insert a new chunk in CHAIN. */
-          struct blame *tmp = blame_create(chain, walk->rev,
-                                           walk_merged->next->start);
+          svn_diff__blame_t *tmp
+            = svn_diff__blame_create(chain, walk->rev,
+                                     walk_merged->next->start);
           tmp->next = walk->next;
           walk->next = tmp;
         }
@@ -635,8 +454,9 @@ normalize_blames(struct blame_chain *chain,
      to CHAIN_MERGED until its length matches that of CHAIN. */
   while (walk->next != NULL)
     {
-      struct blame *tmp = blame_create(chain_merged, walk_merged->rev,
-                                       walk->next->start);
+      svn_diff__blame_t *tmp
+        = svn_diff__blame_create(chain_merged, walk_merged->rev,
+                                 walk->next->start);
       walk_merged->next = tmp;
 
       walk_merged = walk_merged->next;
@@ -646,8 +466,9 @@ normalize_blames(struct blame_chain *chain,
   /* Same as above, only extend CHAIN to match CHAIN_MERGED. */
   while (walk_merged->next != NULL)
     {
-      struct blame *tmp = blame_create(chain, walk->rev,
-                                       walk_merged->next->start);
+      svn_diff__blame_t *tmp
+        = svn_diff__blame_create(chain, walk->rev,
+                                 walk_merged->next->start);
       walk->next = tmp;
 
       walk = walk->next;
@@ -655,6 +476,63 @@ normalize_blames(struct blame_chain *chain,
     }
 }
 
+/* Let the server calculate the blame of the session URL of RA_SESSION
+   from START_REVNUM to END_REVNUM (START_REVNUM <= END_REVNUM) using
+   DIFF_OPTIONS.  Fill FRB->CHAIN with the result and store the contents
+   of the file at END_REVNUM in a temporary file, whose name is returned
+   in FRB->LAST_FILENAME.  Allocate everything in POOL. */
+static svn_error_t *
+get_server_blame(struct file_rev_baton *frb,
+                 svn_ra_session_t *ra_session,
+                 svn_revnum_t start_revnum,
+                 svn_revnum_t end_revnum,
+                 apr_pool_t *pool)
+{
+  apr_array_header_t *chunks;
+  svn_stream_t *tempfile;
+  const char *temppath;
+  svn_diff__blame_t *last = NULL;
+  struct rev *rev = NULL;
+  int i;
+
+  SVN_ERR(svn_ra__get_blame(ra_session, &chunks, "",
+                            start_revnum, end_revnum, frb->diff_options,
+                            pool, pool));
+
+  /* The annotations refer to the lines of the youngest fulltext. */
+  SVN_ERR(svn_stream_open_unique(&tempfile, &temppath, NULL,
+                                 svn_io_file_del_on_pool_cleanup,
+                                 pool, pool));
+  SVN_ERR(svn_ra_get_file(ra_session, "", end_revnum, tempfile,
+                          NULL, NULL, pool));
+  SVN_ERR(svn_stream_close(tempfile));
+
+  for (i = 0; i < chunks->nelts; ++i)
+    {
+      const svn_ra__blame_chunk_t *chunk
+        = &APR_ARRAY_IDX(chunks, i, svn_ra__blame_chunk_t);
+      svn_diff__blame_t *blame;
+
+      /* Chunks of the same revision share their rev struct. */
+      if (!rev || rev->revision != chunk->revision)
+        {
+          rev = apr_pcalloc(pool, sizeof(*rev));
+          rev->revision = chunk->revision;
+          rev->rev_props = chunk->rev_props;
+        }
+
+      blame = svn_diff__blame_create(frb->chain, rev, chunk->start);
+      if (last)
+        last->next = blame;
+      else
+        frb->chain->blame = blame;
+      last = blame;
+    }
+
+  frb->last_filename = temppath;
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_client_blame5(const char *target,
                   const svn_opt_revision_t *peg_revision,
@@ -671,7 +549,7 @@ svn_client_blame5(const char *target,
   struct file_rev_baton frb;
   svn_ra_session_t *ra_session;
   svn_revnum_t start_revnum, end_revnum;
-  struct blame *walk, *walk_merged = NULL;
+  svn_diff__blame_t *walk, *walk_merged = NULL;
   apr_pool_t *iterpool;
   svn_stream_t *last_stream;
   svn_stream_t *stream;
@@ -776,16 +654,10 @@ svn_client_blame5(const char *target,
   frb.last_filename = NULL;
   frb.last_rev = NULL;
   frb.last_original_filename = NULL;
-  frb.chain = apr_palloc(pool, sizeof(*frb.chain));
-  frb.chain->blame = NULL;
-  frb.chain->avail = NULL;
-  frb.chain->pool = pool;
+  frb.chain = svn_diff__blame_chain_create(pool);
   if (include_merged_revisions)
     {
-      frb.merged_chain = apr_palloc(pool, sizeof(*frb.merged_chain));
-      frb.merged_chain->blame = NULL;
-      frb.merged_chain->avail = NULL;
-      frb.merged_chain->pool = pool;
+      frb.merged_chain = svn_diff__blame_chain_create(pool);
     }
   frb.backwards = (frb.start_rev > frb.end_rev);
   frb.last_revnum = SVN_INVALID_REVNUM;
@@ -806,16 +678,40 @@ svn_client_blame5(const char *target,
       frb.prevfilepool = svn_pool_create(pool);
     }
 
+  /* If the server can annotate the file itself, we only need to fetch
+     the final result instead of every revision of the file. */
+  if (!include_merged_revisions && !frb.backwards)
+    {
+      svn_boolean_t server_blame;
+
+      SVN_ERR(svn_ra_has_capability(ra_session, &server_blame,
+                                    SVN_RA_CAPABILITY_SERVER_BLAME, pool));
+      if (server_blame)
+        {
+          svn_error_t *err = get_server_blame(&frb, ra_session,
+                                              start_revnum, end_revnum,
+                                              pool);
+
+          /* The server refuses to load binary and very large files into
+             memory.  Stream them to us instead. */
+          if (err && svn_error_find_cause(err, SVN_ERR_UNSUPPORTED_FEATURE))
+            svn_error_clear(err);
+          else
+            SVN_ERR(err);
+        }
+    }
+
   /* Collect all blame information.
      We need to ensure that we get one revision before the start_rev,
      if available so that we can know what was actually changed in the start
      revision. */
-  SVN_ERR(svn_ra_get_file_revs2(ra_session, "",
-                                frb.backwards ? start_revnum
-                                              : MAX(0, start_revnum-1),
-                                end_revnum,
-                                include_merged_revisions,
-                                file_rev_handler, &frb, pool));
+  if (!frb.last_filename)
+    SVN_ERR(svn_ra_get_file_revs2(ra_session, "",
+                                  frb.backwards ? start_revnum
+                                                : MAX(0, start_revnum-1),
+                                  end_revnum,
+                                  include_merged_revisions,
+                                  file_rev_handler, &frb, pool));
 
   if (end->kind == svn_opt_revision_working)
     {
@@ -901,7 +797,7 @@ svn_client_blame5(const char *target,
          the most recently changed revision.  ### Is this really what we want
          to do here?  Do the sematics of copy change? */
       if (!frb.chain->blame)
-        frb.chain->blame = blame_create(frb.chain, frb.last_rev, 0);
+        frb.chain->blame = svn_diff__blame_create(frb.chain, frb.last_rev, 0);
 
       normalize_blames(frb.chain, frb.merged_chain, pool);
       walk_merged = frb.merged_chain->blame;
@@ -910,6 +806,7 @@ svn_client_blame5(const char *target,
   /* Process each blame item. */
   for (walk = frb.chain->blame; walk; walk = walk->next)
     {
+      const struct rev *rev = walk->rev;
       apr_off_t line_no;
       svn_revnum_t merged_rev;
       const char *merged_path;
@@ -917,9 +814,11 @@ svn_client_blame5(const char *target,
 
       if (walk_merged)
         {
-          merged_rev = walk_merged->rev->revision;
-          merged_rev_props = walk_merged->rev->rev_props;
-          merged_path = walk_merged->rev->path;
+          const struct rev *merged = walk_merged->rev;
+
+          merged_rev = merged->revision;
+          merged_rev_props = merged->rev_props;
+          merged_path = merged->path;
         }
       else
         {
@@ -941,10 +840,10 @@ svn_client_blame5(const char *target,
             SVN_ERR(ctx->cancel_func(ctx->cancel_baton));
           if (!eof || sb->len)
             {
-              if (walk->rev)
+              if (rev)
                 SVN_ERR(receiver(receiver_baton, start_revnum, end_revnum,
-                                 line_no, walk->rev->revision,
-                                 walk->rev->rev_props, merged_rev,
+                                 line_no, rev->revision,
+                                 rev->rev_props, merged_rev,
                                  merged_rev_props, merged_path,
                                  sb->data, FALSE, iterpool));
               else
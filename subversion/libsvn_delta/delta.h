@@ -44,6 +44,13 @@ extern "C" {
 
 #define SVN_DELTA_WINDOW_SIZE 102400
 
+/* The maximum size of one svndiff window in svndiff version 3 and later.
+   Sliding a source window of this size over the source finds matches
+   that are too far apart for the standard window, e.g. after insertions
+   into binaries or within zip-based documents. */
+
+#define SVN_DELTA_LARGE_WINDOW_SIZE (1024 * 1024)
+
 
 /* Context/baton for building an operation sequence. */
 
@@ -38,6 +38,8 @@
 
 static const char SVNDIFF_V0[] = { 'S', 'V', 'N', 0 };
 static const char SVNDIFF_V1[] = { 'S', 'V', 'N', 1 };
+static const char SVNDIFF_V2[] = { 'S', 'V', 'N', 2 };
+static const char SVNDIFF_V3[] = { 'S', 'V', 'N', 3 };
 
 #define SVNDIFF_HEADER_SIZE (sizeof(SVNDIFF_V0))
 
@@ -46,10 +48,51 @@ get_svndiff_header(int version)
 {
   if (version == 1)
     return SVNDIFF_V1;
+  else if (version == 2)
+    return SVNDIFF_V2;
+  else if (version == 3)
+    return SVNDIFF_V3;
   else
     return SVNDIFF_V0;
 }
 
+/* Compress the LEN bytes at DATA according to the svndiff VERSION and
+   write the result to OUT.  VERSION must be 1, 2 or 3.  COMPRESSION_LEVEL
+   is the zlib compression level for svndiff1; for svndiff2 and svndiff3,
+   any level other than SVN_DELTA_COMPRESSION_LEVEL_NONE enables LZ4. */
+static svn_error_t *
+compress_section(const char *data,
+                 apr_size_t len,
+                 svn_stringbuf_t *out,
+                 int version,
+                 int compression_level)
+{
+  if (version >= 2 && compression_level != SVN_DELTA_COMPRESSION_LEVEL_NONE)
+    return svn_error_trace(svn__compress_lz4(data, len, out));
+
+  /* All formats use the same representation for uncompressed data. */
+  return svn_error_trace(svn__compress(data, len, out,
+                                       version >= 2
+                                         ? SVN__COMPRESSION_NONE
+                                         : compression_level));
+}
+
+/* Decompress the LEN bytes at DATA according to the svndiff VERSION and
+   write the result to OUT.  VERSION must be 1, 2 or 3.  Return an error
+   if the result would be larger than LIMIT. */
+static svn_error_t *
+decompress_section(const unsigned char *data,
+                   apr_size_t len,
+                   svn_stringbuf_t *out,
+                   int version,
+                   apr_size_t limit)
+{
+  if (version >= 2)
+    return svn_error_trace(svn__decompress_lz4(data, len, out, limit));
+
+  return svn_error_trace(svn__decompress(data, len, out, limit));
+}
+
 /* ----- Text delta to svndiff ----- */
 
 /* We make one of these and get it passed back to us in calls to the
@@ -66,10 +109,29 @@ struct encoder_baton {
 
 /* This is at least as big as the largest size for a single instruction. */
 #define MAX_INSTRUCTION_LEN (2*SVN__MAX_ENCODED_UINT_LEN+1)
+/* The largest window allowed in an svndiff stream of the given VERSION.
+   Version 3 is the first one to allow for large windows. */
+#define MAX_WINDOW_SIZE(version) \
+  ((version) >= 3 ? SVN_DELTA_LARGE_WINDOW_SIZE : SVN_DELTA_WINDOW_SIZE)
 /* This is at least as big as the largest possible instructions
-   section: in theory, the instructions could be SVN_DELTA_WINDOW_SIZE
+   section: in theory, the instructions could be MAX_WINDOW_SIZE
    1-byte copy-from-source instructions (though this is very unlikely). */
-#define MAX_INSTRUCTION_SECTION_LEN (SVN_DELTA_WINDOW_SIZE*MAX_INSTRUCTION_LEN)
+#define MAX_INSTRUCTION_SECTION_LEN(version) \
+  (MAX_WINDOW_SIZE(version) * MAX_INSTRUCTION_LEN)
+
+
+/* Position within the current window that svndiff3 encodes instruction
+   offsets relative to.  Source copies tend to continue where the previous
+   one ended and target copies tend to refer to recent data, so storing
+   the distances instead of absolute offsets yields smaller integers. */
+typedef struct instruction_state_t
+{
+  /* End of the latest source copy within the source view. */
+  apr_size_t source_end;
+
+  /* Current position within the target view. */
+  apr_size_t target_pos;
+} instruction_state_t;
 
 
 /* Append an encoded integer to a string.  */
@@ -166,6 +228,7 @@ encode_window(svn_stringbuf_t **instructions_p,
   const svn_string_t *newdata;
   unsigned char ibuf[MAX_INSTRUCTION_LEN], *ip;
   const svn_txdelta_op_t *op;
+  instruction_state_t state = { 0 };
 
   /* create the necessary data buffers */
   instructions = svn_stringbuf_create_empty(pool);
@@ -186,30 +249,46 @@ encode_window(svn_stringbuf_t **instructions_p,
         *ip++ |= (unsigned char)op->length;
       else
         ip = svn__encode_uint(ip + 1, op->length);
-      if (op->action_code != svn_txdelta_new)
-        ip = svn__encode_uint(ip, op->offset);
+      if (version < 3)
+        {
+          if (op->action_code != svn_txdelta_new)
+            ip = svn__encode_uint(ip, op->offset);
+        }
+      else if (op->action_code == svn_txdelta_source)
+        {
+          ip = svn__encode_int(ip, (apr_int64_t)op->offset
+                                   - (apr_int64_t)state.source_end);
+          state.source_end = op->offset + op->length;
+        }
+      else if (op->action_code == svn_txdelta_target)
+        {
+          ip = svn__encode_uint(ip, state.target_pos - op->offset);
+        }
       svn_stringbuf_appendbytes(instructions, (const char *)ibuf, ip - ibuf);
+      state.target_pos += op->length;
     }
 
   /* Encode the header.  */
   append_encoded_int(header, window->sview_offset);
   append_encoded_int(header, window->sview_len);
   append_encoded_int(header, window->tview_len);
-  if (version == 1)
+  if (version > 0)
     {
       svn_stringbuf_t *compressed_instructions;
       compressed_instructions = svn_stringbuf_create_empty(pool);
-      SVN_ERR(svn__compress(instructions->data, instructions->len,
-                            compressed_instructions, compression_level));
+      SVN_ERR(compress_section(instructions->data, instructions->len,
+                               compressed_instructions, version,
+                               compression_level));
       instructions = compressed_instructions;
     }
   append_encoded_int(header, instructions->len);
-  if (version == 1)
+  if (version > 0)
     {
       svn_stringbuf_t *compressed = svn_stringbuf_create_empty(pool);
 
-      SVN_ERR(svn__compress(window->new_data->data, window->new_data->len,
-                            compressed, compression_level));
+      SVN_ERR(compress_section(window->new_data->data,
+                               window->new_data->len,
+                               compressed, version, compression_level));
       newdata = svn_stringbuf__morph_into_string(compressed);
     }
   else
@@ -401,13 +480,17 @@ decode_size(apr_size_t *val,
   return result;
 }
 
-/* Decode an instruction into OP, returning a pointer to the text
-   after the instruction.  Note that if the action code is
+/* Decode an instruction of svndiff VERSION into OP, returning a pointer
+   to the text after the instruction.  STATE tracks the positions that
+   svndiff3 offsets are relative to; it must be zero-initialized for the
+   first instruction of a window.  Note that if the action code is
    svn_txdelta_new, the offset field of *OP will not be set.  */
 static const unsigned char *
 decode_instruction(svn_txdelta_op_t *op,
+                   instruction_state_t *state,
                    const unsigned char *p,
-                   const unsigned char *end)
+                   const unsigned char *end,
+                   int version)
 {
   apr_size_t c;
   apr_size_t action;
@@ -435,13 +518,51 @@ decode_instruction(svn_txdelta_op_t *op,
       if (p == NULL)
         return NULL;
     }
-  if (action != svn_txdelta_new)
+  if (version < 3)
+    {
+      if (action != svn_txdelta_new)
+        {
+          p = decode_size(&op->offset, p, end);
+          if (p == NULL)
+            return NULL;
+        }
+    }
+  else if (action == svn_txdelta_source)
     {
-      p = decode_size(&op->offset, p, end);
+      apr_int64_t distance;
+
+      p = svn__decode_int(&distance, p, end);
       if (p == NULL)
         return NULL;
+
+      /* The offset must neither be negative nor overflow. */
+      if (distance < 0
+          ? (apr_uint64_t)-(distance + 1) >= state->source_end
+          : (apr_uint64_t)distance > APR_SIZE_MAX - state->source_end)
+        return NULL;
+
+      op->offset = (apr_size_t)(state->source_end + distance);
+      if (op->length > APR_SIZE_MAX - op->offset)
+        return NULL;
+
+      state->source_end = op->offset + op->length;
+    }
+  else if (action == svn_txdelta_target)
+    {
+      apr_size_t distance;
+
+      /* Target copies must start before the current position. */
+      p = decode_size(&distance, p, end);
+      if (p == NULL || distance == 0 || distance > state->target_pos)
+        return NULL;
+
+      op->offset = state->target_pos - distance;
     }
 
+  if (op->length > APR_SIZE_MAX - state->target_pos)
+    return NULL;
+
+  state->target_pos += op->length;
   return p;
 }
 
@@ -455,15 +576,17 @@ count_and_verify_instructions(int *ninst,
                               const unsigned char *end,
                               apr_size_t sview_len,
                               apr_size_t tview_len,
-                              apr_size_t new_len)
+                              apr_size_t new_len,
+                              int version)
 {
   int n = 0;
   svn_txdelta_op_t op;
+  instruction_state_t state = { 0 };
   apr_size_t tpos = 0, npos = 0;
 
   while (p < end)
     {
-      p = decode_instruction(&op, p, end);
+      p = decode_instruction(&op, &state, p, end, version);
 
       /* Detect any malformed operations from the instruction stream. */
       if (p == NULL)
@@ -535,6 +658,7 @@ decode_window(svn_txdelta_window_t *window, svn_filesize_t sview_offset,
   apr_size_t npos;
   svn_txdelta_op_t *ops, *op;
   svn_string_t *new_data;
+  instruction_state_t state = { 0 };
 
   window->sview_offset = sview_offset;
   window->sview_len = sview_len;
@@ -542,15 +666,15 @@ decode_window(svn_txdelta_window_t *window, svn_filesize_t sview_offset,
 
   insend = data + inslen;
 
-  if (version == 1)
+  if (version >= 1 && version <= 3)
     {
       svn_stringbuf_t *instout = svn_stringbuf_create_empty(pool);
       svn_stringbuf_t *ndout = svn_stringbuf_create_empty(pool);
 
-      SVN_ERR(svn__decompress(insend, newlen, ndout,
-                              SVN_DELTA_WINDOW_SIZE));
-      SVN_ERR(svn__decompress(data, insend - data, instout,
-                              MAX_INSTRUCTION_SECTION_LEN));
+      SVN_ERR(decompress_section(insend, newlen, ndout, version,
+                                 MAX_WINDOW_SIZE(version)));
+      SVN_ERR(decompress_section(data, insend - data, instout, version,
+                                 MAX_INSTRUCTION_SECTION_LEN(version)));
 
       newlen = ndout->len;
       data = (unsigned char *)instout->data;
@@ -567,7 +691,8 @@ decode_window(svn_txdelta_window_t *window, svn_filesize_t sview_offset,
 
   /* Count the instructions and make sure they are all valid.  */
   SVN_ERR(count_and_verify_instructions(&ninst, data, insend,
-                                        sview_len, tview_len, newlen));
+                                        sview_len, tview_len, newlen,
+                                        version));
 
   /* Allocate a buffer for the instructions and decode them. */
   ops = apr_palloc(pool, ninst * sizeof(*ops));
@@ -575,7 +700,7 @@ decode_window(svn_txdelta_window_t *window, svn_filesize_t sview_offset,
   window->src_ops = 0;
   for (op = ops; op < ops + ninst; op++)
     {
-      data = decode_instruction(op, data, insend);
+      data = decode_instruction(op, &state, data, insend, version);
       if (op->action_code == svn_txdelta_source)
         ++window->src_ops;
       else if (op->action_code == svn_txdelta_new)
@@ -612,6 +737,10 @@ write_handler(void *baton,
         db->version = 0;
       else if (memcmp(buffer, SVNDIFF_V1 + db->header_bytes, nheader) == 0)
         db->version = 1;
+      else if (memcmp(buffer, SVNDIFF_V2 + db->header_bytes, nheader) == 0)
+        db->version = 2;
+      else if (memcmp(buffer, SVNDIFF_V3 + db->header_bytes, nheader) == 0)
+        db->version = 3;
       else
         return svn_error_create(SVN_ERR_SVNDIFF_INVALID_HEADER, NULL,
                                 _("Svndiff has invalid header"));
@@ -669,11 +798,12 @@ write_handler(void *baton,
           if (p == NULL)
               break;
 
-          if (tview_len > SVN_DELTA_WINDOW_SIZE ||
-              sview_len > SVN_DELTA_WINDOW_SIZE ||
-              /* for svndiff1, newlen includes the original length */
-              newlen > SVN_DELTA_WINDOW_SIZE + SVN__MAX_ENCODED_UINT_LEN ||
-              inslen > MAX_INSTRUCTION_SECTION_LEN)
+          if (tview_len > MAX_WINDOW_SIZE(db->version) ||
+              sview_len > MAX_WINDOW_SIZE(db->version) ||
+              /* for svndiff1/2/3, newlen includes the original length */
+              newlen > MAX_WINDOW_SIZE(db->version)
+                       + SVN__MAX_ENCODED_UINT_LEN ||
+              inslen > MAX_INSTRUCTION_SECTION_LEN(db->version))
             return svn_error_create(
                      SVN_ERR_SVNDIFF_CORRUPT_WINDOW, NULL,
                      _("Svndiff contains a too-large window"));
@@ -853,12 +983,13 @@ read_one_size(apr_size_t *size,
   return SVN_NO_ERROR;
 }
 
-/* Read a window header from STREAM and check it for integer overflow. */
+/* Read a window header from STREAM and check it for integer overflow
+   as well as against the window size limits of svndiff VERSION. */
 static svn_error_t *
 read_window_header(svn_stream_t *stream, svn_filesize_t *sview_offset,
                    apr_size_t *sview_len, apr_size_t *tview_len,
                    apr_size_t *inslen, apr_size_t *newlen,
-                   apr_size_t *header_len)
+                   apr_size_t *header_len, int version)
 {
   unsigned char c;
 
@@ -880,11 +1011,11 @@ read_window_header(svn_stream_t *stream, svn_filesize_t *sview_offset,
   SVN_ERR(read_one_size(inslen, header_len, stream));
   SVN_ERR(read_one_size(newlen, header_len, stream));
 
-  if (*tview_len > SVN_DELTA_WINDOW_SIZE ||
-      *sview_len > SVN_DELTA_WINDOW_SIZE ||
-      /* for svndiff1, newlen includes the original length */
-      *newlen > SVN_DELTA_WINDOW_SIZE + SVN__MAX_ENCODED_UINT_LEN ||
-      *inslen > MAX_INSTRUCTION_SECTION_LEN)
+  if (*tview_len > MAX_WINDOW_SIZE(version) ||
+      *sview_len > MAX_WINDOW_SIZE(version) ||
+      /* for svndiff1/2/3, newlen includes the original length */
+      *newlen > MAX_WINDOW_SIZE(version) + SVN__MAX_ENCODED_UINT_LEN ||
+      *inslen > MAX_INSTRUCTION_SECTION_LEN(version))
     return svn_error_create(SVN_ERR_SVNDIFF_CORRUPT_WINDOW, NULL,
                             _("Svndiff contains a too-large window"));
 
@@ -909,7 +1040,8 @@ svn_txdelta_read_svndiff_window(svn_txdelta_window_t **window,
   unsigned char *buf;
 
   SVN_ERR(read_window_header(stream, &sview_offset, &sview_len, &tview_len,
-                             &inslen, &newlen, &header_len));
+                             &inslen, &newlen, &header_len,
+                             svndiff_version));
   len = inslen + newlen;
   buf = apr_palloc(pool, len);
   SVN_ERR(svn_stream_read_full(stream, (char*)buf, &len));
@@ -933,7 +1065,8 @@ svn_txdelta_skip_svndiff_window(apr_file_t *file,
   apr_off_t offset;
 
   SVN_ERR(read_window_header(stream, &sview_offset, &sview_len, &tview_len,
-                             &inslen, &newlen, &header_len));
+                             &inslen, &newlen, &header_len,
+                             svndiff_version));
 
   offset = inslen + newlen;
   return svn_io_file_seek(file, APR_CUR, &offset, pool);
@@ -947,8 +1080,9 @@ svn_txdelta__read_raw_window_len(apr_size_t *window_len,
   svn_filesize_t sview_offset;
   apr_size_t sview_len, tview_len, inslen, newlen, header_len;
 
+  /* The svndiff version is not known here; accept any window size. */
   SVN_ERR(read_window_header(stream, &sview_offset, &sview_len, &tview_len,
-                             &inslen, &newlen, &header_len));
+                             &inslen, &newlen, &header_len, 3));
 
   *window_len = inslen + newlen + header_len;
   return SVN_NO_ERROR;
@@ -34,6 +34,7 @@
 #include "svn_checksum.h"
 
 #include "delta.h"
+#include "private/svn_delta_private.h"
 
 
 /* Text delta stream descriptor. */
@@ -75,11 +76,28 @@ struct tpush_baton {
   apr_pool_t *pool;
 
   /* Private data */
+  apr_size_t window_size;
   char *buf;
   svn_filesize_t source_offset;
   apr_size_t source_len;
   svn_boolean_t source_done;
   apr_size_t target_len;
+
+  /* Set if the source view follows the data matched in the previous
+     windows instead of the target position. */
+  svn_boolean_t slide_source;
+
+  /* Source view of the next window and whether BUF already holds it. */
+  svn_filesize_t next_source_offset;
+  svn_boolean_t view_ready;
+
+  /* Target offset of the next window. */
+  svn_filesize_t target_offset;
+
+  /* Source offset minus target offset at the end of the last copy from
+     the source and the number of windows since then without such copy. */
+  svn_filesize_t drift;
+  int misses;
 };
 
 
@@ -502,6 +520,121 @@ svn_txdelta(svn_txdelta_stream_t **stream,
 
 /* Functions for implementing a "target push" delta. */
 
+/* When sliding the source view, a window without any copy from the source
+ * is assumed to be inserted data and the view stays where it is.  After
+ * this many such windows in a row, assume the data has been replaced
+ * instead and move the view along with the target. */
+#define SLIDE_RESYNC_WINDOWS 4
+
+/* Skip LEN bytes in STREAM. */
+static svn_error_t *
+skip_source(svn_stream_t *stream,
+            svn_filesize_t len)
+{
+  while (len > 0)
+    {
+      apr_size_t chunk = len > APR_SIZE_MAX ? APR_SIZE_MAX : (apr_size_t)len;
+      SVN_ERR(svn_stream_skip(stream, chunk));
+      len -= chunk;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Move the source view of TB to TB->NEXT_SOURCE_OFFSET, which must not
+ * be before the current view, and fill it with up to TB->WINDOW_SIZE
+ * bytes of source data.  Keep the data shared with the current view. */
+static svn_error_t *
+prepare_source_view(struct tpush_baton *tb)
+{
+  svn_filesize_t view_end = tb->source_offset + tb->source_len;
+  apr_size_t len;
+
+  if (tb->next_source_offset < view_end)
+    {
+      apr_size_t shift = (apr_size_t)(tb->next_source_offset
+                                      - tb->source_offset);
+      memmove(tb->buf, tb->buf + shift, tb->source_len - shift);
+      tb->source_len -= shift;
+    }
+  else
+    {
+      if (!tb->source_done)
+        SVN_ERR(skip_source(tb->source, tb->next_source_offset - view_end));
+      tb->source_len = 0;
+    }
+  tb->source_offset = tb->next_source_offset;
+
+  if (!tb->source_done && tb->source_len < tb->window_size)
+    {
+      len = tb->window_size - tb->source_len;
+      SVN_ERR(svn_stream_read_full(tb->source, tb->buf + tb->source_len,
+                                   &len));
+      if (len < tb->window_size - tb->source_len)
+        tb->source_done = TRUE;
+      tb->source_len += len;
+    }
+
+  tb->view_ready = TRUE;
+  return SVN_NO_ERROR;
+}
+
+/* Set the source view of the window following WINDOW in TB.  Without
+ * TB->SLIDE_SOURCE, that is simply the next chunk of the source.  When
+ * sliding, it starts where the copies from the source in WINDOW ended,
+ * such that data moved by insertions or deletions is still found. */
+static void
+advance_source_view(struct tpush_baton *tb,
+                    const svn_txdelta_window_t *window)
+{
+  svn_filesize_t copy_end = -1;
+  svn_filesize_t copy_drift = 0;
+  apr_size_t target_pos = 0;
+  int i;
+
+  tb->view_ready = FALSE;
+  if (!tb->slide_source)
+    {
+      tb->next_source_offset = tb->source_offset + tb->source_len;
+      tb->target_offset += window->tview_len;
+      return;
+    }
+
+  /* Find the copy reaching furthest into the source.  Spurious short
+   * matches may be anywhere in the view; those further back must not
+   * hold the view back. */
+  for (i = 0; i < window->num_ops; ++i)
+    {
+      const svn_txdelta_op_t *op = &window->ops[i];
+      target_pos += op->length;
+
+      if (   op->action_code == svn_txdelta_source
+          && tb->source_offset + op->offset + op->length > copy_end)
+        {
+          copy_end = tb->source_offset + op->offset + op->length;
+          copy_drift = copy_end - (tb->target_offset + target_pos);
+        }
+    }
+
+  tb->target_offset += window->tview_len;
+  if (copy_end >= 0)
+    {
+      tb->next_source_offset = copy_end;
+      tb->drift = copy_drift;
+      tb->misses = 0;
+    }
+  else if (++tb->misses < SLIDE_RESYNC_WINDOWS)
+    {
+      tb->next_source_offset = tb->source_offset;
+    }
+  else
+    {
+      tb->next_source_offset = tb->target_offset + tb->drift;
+      if (tb->next_source_offset < tb->source_offset)
+        tb->next_source_offset = tb->source_offset;
+    }
+}
+
 /* This is the write handler for a target-push delta stream.  It reads
  * source data, buffers target data, and fires off delta windows when
  * the target data buffer is full. */
@@ -517,17 +650,14 @@ tpush_write_handler(void *baton, const char *data, apr_size_t *len)
     {
       svn_pool_clear(pool);
 
-      /* Make sure we're all full up on source data, if possible. */
-      if (tb->source_len == 0 && !tb->source_done)
-        {
-          tb->source_len = SVN_DELTA_WINDOW_SIZE;
-          SVN_ERR(svn_stream_read_full(tb->source, tb->buf, &tb->source_len));
-          if (tb->source_len < SVN_DELTA_WINDOW_SIZE)
-            tb->source_done = TRUE;
-        }
+      /* Make sure we're all full up on source data, if possible.
+         The source view must not change while we collect target data
+         behind it. */
+      if (!tb->view_ready)
+        SVN_ERR(prepare_source_view(tb));
 
-      /* Copy in the target data, up to SVN_DELTA_WINDOW_SIZE. */
-      chunk_len = SVN_DELTA_WINDOW_SIZE - tb->target_len;
+      /* Copy in the target data, up to TB->WINDOW_SIZE. */
+      chunk_len = tb->window_size - tb->target_len;
       if (chunk_len > data_len)
         chunk_len = data_len;
       memcpy(tb->buf + tb->source_len + tb->target_len, data, chunk_len);
@@ -536,13 +666,12 @@ tpush_write_handler(void *baton, const char *data, apr_size_t *len)
       tb->target_len += chunk_len;
 
       /* If we're full of target data, compute and fire off a window. */
-      if (tb->target_len == SVN_DELTA_WINDOW_SIZE)
+      if (tb->target_len == tb->window_size)
         {
           window = compute_window(tb->buf, tb->source_len, tb->target_len,
                                   tb->source_offset, pool);
           SVN_ERR(tb->wh(window, tb->whb));
-          tb->source_offset += tb->source_len;
-          tb->source_len = 0;
+          advance_source_view(tb, window);
           tb->target_len = 0;
         }
     }
@@ -575,9 +704,12 @@ tpush_close_handler(void *baton)
 
 
 svn_stream_t *
-svn_txdelta_target_push(svn_txdelta_window_handler_t handler,
-                        void *handler_baton, svn_stream_t *source,
-                        apr_pool_t *pool)
+svn_txdelta__target_push(svn_txdelta_window_handler_t handler,
+                         void *handler_baton,
+                         svn_stream_t *source,
+                         apr_size_t window_size,
+                         svn_boolean_t slide_source,
+                         apr_pool_t *pool)
 {
   struct tpush_baton *tb;
   svn_stream_t *stream;
@@ -588,11 +720,18 @@ svn_txdelta_target_push(svn_txdelta_window_handler_t handler,
   tb->wh = handler;
   tb->whb = handler_baton;
   tb->pool = pool;
-  tb->buf = apr_palloc(pool, 2 * SVN_DELTA_WINDOW_SIZE);
+  tb->window_size = window_size;
+  tb->buf = apr_palloc(pool, 2 * window_size);
   tb->source_offset = 0;
   tb->source_len = 0;
   tb->source_done = FALSE;
   tb->target_len = 0;
+  tb->slide_source = slide_source;
+  tb->next_source_offset = 0;
+  tb->view_ready = FALSE;
+  tb->target_offset = 0;
+  tb->drift = 0;
+  tb->misses = 0;
 
   /* Create and return writable stream. */
   stream = svn_stream_create(tb, pool);
@@ -601,6 +740,15 @@ svn_txdelta_target_push(svn_txdelta_window_handler_t handler,
   return stream;
 }
 
+svn_stream_t *
+svn_txdelta_target_push(svn_txdelta_window_handler_t handler,
+                        void *handler_baton, svn_stream_t *source,
+                        apr_pool_t *pool)
+{
+  return svn_txdelta__target_push(handler, handler_baton, source,
+                                  SVN_DELTA_WINDOW_SIZE, FALSE, pool);
+}
+
 
 
 /* Functions for applying deltas.  */
@@ -743,9 +891,12 @@ apply_window(svn_txdelta_window_t *window, void *baton)
   /* Make sure there's enough room in the target buffer.  */
   SVN_ERR(size_buffer(&ab->tbuf, &ab->tbuf_size, window->tview_len, ab->pool));
 
-  /* Prepare the source buffer for reading from the input stream.  */
-  if (window->sview_offset != ab->sbuf_offset
-      || window->sview_len > ab->sbuf_size)
+  /* Prepare the source buffer for reading from the input stream.
+     An empty view does not need any source data and must not move
+     our position in the source stream.  */
+  if (window->sview_len > 0
+      && (window->sview_offset != ab->sbuf_offset
+          || window->sview_len > ab->sbuf_size))
     {
       char *old_sbuf = ab->sbuf;
 
@@ -764,7 +915,12 @@ apply_window(svn_txdelta_window_t *window, void *baton)
           ab->sbuf_len -= start;
         }
       else
-        ab->sbuf_len = 0;
+        {
+          /* Skip the source data between the views. */
+          SVN_ERR(skip_source(ab->source, window->sview_offset
+                                          - ab->sbuf_offset - ab->sbuf_len));
+          ab->sbuf_len = 0;
+        }
       ab->sbuf_offset = window->sview_offset;
     }
 
@@ -31,6 +31,13 @@
 #include "svn_delta.h"
 #include "private/svn_string_private.h"
 #include "delta.h"
+
+/* Use SSE2 to calculate the block checksums where available.  It is part
+   of the x86-64 baseline, so there is no need for runtime detection. */
+#if defined(__GNUC__) && defined(__SSE2__)
+#  include <emmintrin.h>
+#  define USE_SSE2 1
+#endif
 
 /* This is pseudo-adler32. It is adler32 without the prime modulus.
    The idea is borrowed from monotone, and is a translation of the C++
@@ -44,15 +51,22 @@
  */
 #define MATCH_BLOCKSIZE 64
 
-/* Size of the checksum presence FLAGS array in BLOCKS_T.  With standard
-   MATCH_BLOCKSIZE and SVN_DELTA_WINDOW_SIZE, 32k entries is about 20x
-   the number of checksums that actually occur, i.e. we expect a >95%
+/* Minimum size of the checksum presence FLAGS array in BLOCKS_T.  With
+   standard MATCH_BLOCKSIZE and SVN_DELTA_WINDOW_SIZE, 32k entries is about
+   20x the number of checksums that actually occur, i.e. we expect a >95%
    probability that non-matching checksums get already detected by checking
-   against the FLAGS array.
+   against the FLAGS array.  Larger source windows get proportionally
+   larger arrays.
    Must be a power of 2.
  */
 #define FLAGS_COUNT (32 * 1024)
 
+/* Upper limit to the size of the FLAGS array.  HASH_FLAGS takes the byte
+   index from the upper 16 bits of the checksum, so there is no point in
+   going beyond this.  Must be a power of 2.
+ */
+#define MAX_FLAGS_COUNT (0x10000 * 8)
+
 /* "no" / "invalid" / "unused" value for positions within the delta windows
  */
 #define NO_POSITION ((apr_uint32_t)-1)
@@ -79,6 +93,57 @@ adler32_replace(apr_uint32_t adler32, const char c_out, const char c_in)
 /* Calculate an pseudo-adler32 checksum for MATCH_BLOCKSIZE bytes starting
    at DATA.  Return the checksum value.  */
 
+#if defined(USE_SSE2) && (MATCH_BLOCKSIZE % 16 == 0)
+
+/* SSE2 variant of the scalar implementation below.  S1 is the plain sum
+   of all bytes while S2 weights the byte at offset I with
+   MATCH_BLOCKSIZE - I, i.e. it is the sum of all intermediate S1 values.
+ */
+static APR_INLINE apr_uint32_t
+init_adler32(const char *data)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i step = _mm_set1_epi16(16);
+
+  /* Weights of the lower and upper 8 bytes of the first 16 byte chunk. */
+  __m128i weights_lo = _mm_set_epi16(MATCH_BLOCKSIZE - 7, MATCH_BLOCKSIZE - 6,
+                                     MATCH_BLOCKSIZE - 5, MATCH_BLOCKSIZE - 4,
+                                     MATCH_BLOCKSIZE - 3, MATCH_BLOCKSIZE - 2,
+                                     MATCH_BLOCKSIZE - 1, MATCH_BLOCKSIZE);
+  __m128i weights_hi = _mm_sub_epi16(weights_lo, _mm_set1_epi16(8));
+  __m128i sum1 = zero;
+  __m128i sum2 = zero;
+  apr_uint32_t s1, s2;
+  int i;
+
+  for (i = 0; i < MATCH_BLOCKSIZE; i += 16)
+    {
+      __m128i chunk = _mm_loadu_si128((const __m128i *)(data + i));
+
+      sum1 = _mm_add_epi64(sum1, _mm_sad_epu8(chunk, zero));
+      sum2 = _mm_add_epi32(sum2,
+                           _mm_madd_epi16(_mm_unpacklo_epi8(chunk, zero),
+                                          weights_lo));
+      sum2 = _mm_add_epi32(sum2,
+                           _mm_madd_epi16(_mm_unpackhi_epi8(chunk, zero),
+                                          weights_hi));
+
+      weights_lo = _mm_sub_epi16(weights_lo, step);
+      weights_hi = _mm_sub_epi16(weights_hi, step);
+    }
+
+  /* Horizontal sums. */
+  s1 = (apr_uint32_t)_mm_cvtsi128_si32(sum1)
+     + (apr_uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(sum1, 8));
+  sum2 = _mm_add_epi32(sum2, _mm_srli_si128(sum2, 8));
+  sum2 = _mm_add_epi32(sum2, _mm_srli_si128(sum2, 4));
+  s2 = (apr_uint32_t)_mm_cvtsi128_si32(sum2);
+
+  return s2 * 0x10000 + s1;
+}
+
+#else
+
 static APR_INLINE apr_uint32_t
 init_adler32(const char *data)
 {
@@ -103,6 +168,8 @@ init_adler32(const char *data)
   return s2 * 0x10000 + s1;
 }
 
+#endif
+
 /* Information for a block of the delta source.  The length of the
    block is the smaller of MATCH_BLOCKSIZE and the difference between
    the size of the source data and the position of this block. */
@@ -135,10 +202,13 @@ struct blocks
      adler32 checksum.  Since FLAGS has much more entries than SLOTS, this
      will indicate most cases of non-matching checksums with a "0" bit, i.e.
      as "known not to have a match".
-     The mapping of adler32 checksum bits is [0..2][16..27] (LSB -> MSB),
+     The mapping of adler32 checksum bits is [0..2][16..27+] (LSB -> MSB),
      i.e. address the byte by the multiplicative part of adler32 and address
      the bits in that byte by the additive part of adler32. */
-  char flags[FLAGS_COUNT / 8];
+  char *flags;
+
+  /* Number of bytes in FLAGS minus 1. */
+  apr_uint32_t flags_mask;
 
   /* The vector of blocks.  A pos value of NO_POSITION represents an unused
      slot. */
@@ -156,13 +226,14 @@ static apr_uint32_t hash_func(apr_uint32_t sum)
   return sum ^ (sum >> 12);
 }
 
-/* Return the offset in BLOCKS.FLAGS for the adler32 SUM. */
-static apr_uint32_t hash_flags(apr_uint32_t sum)
+/* Return the offset in BLOCKS->FLAGS for the adler32 SUM. */
+static APR_INLINE apr_uint32_t
+hash_flags(const struct blocks *blocks, apr_uint32_t sum)
 {
   /* The upper half of SUM has a wider value range than the lower 16 bit.
      Also, we want to a different folding than HASH_FUNC to minimize
      correlation between different hash levels. */
-  return (sum >> 16) & ((FLAGS_COUNT / 8) - 1);
+  return (sum >> 16) & blocks->flags_mask;
 }
 
 /* Insert a block with the checksum ADLERSUM at position POS in the source
@@ -182,7 +253,7 @@ add_block(struct blocks *blocks, apr_uint32_t adlersum, apr_uint32_t pos)
 
   blocks->slots[h].adlersum = adlersum;
   blocks->slots[h].pos = pos;
-  blocks->flags[hash_flags(adlersum)] |= 1 << (adlersum & 7);
+  blocks->flags[hash_flags(blocks, adlersum)] |= 1 << (adlersum & 7);
 }
 
 /* Find a block in BLOCKS with the checksum ADLERSUM and matching the content
@@ -215,6 +286,7 @@ init_blocks_table(const char *data,
 {
   apr_size_t nblocks;
   apr_size_t wnslots = 1;
+  apr_size_t flags_count = FLAGS_COUNT;
   apr_uint32_t nslots;
   apr_uint32_t i;
 
@@ -247,8 +319,13 @@ init_blocks_table(const char *data,
       blocks->slots[i].pos = NO_POSITION;
     }
 
-  /* No checksum entries in SLOTS, yet => reset all checksum flags. */
-  memset(blocks->flags, 0, sizeof(blocks->flags));
+  /* Keep the flags about 20x as numerous as the blocks, such that large
+     source windows don't saturate them.  No checksum entries in SLOTS,
+     yet => reset all checksum flags. */
+  while (flags_count < 20 * nblocks && flags_count < MAX_FLAGS_COUNT)
+    flags_count *= 2;
+  blocks->flags_mask = (apr_uint32_t)(flags_count / 8 - 1);
+  blocks->flags = apr_pcalloc(pool, flags_count / 8);
 
   /* If there is an odd block at the end of the buffer, we will
      not use that shorter block for deltification (only indirectly
@@ -278,7 +355,7 @@ find_match(const struct blocks *blocks,
            apr_size_t pending_insert_start)
 {
   apr_size_t apos, bpos = *bposp;
-  apr_size_t delta, max_delta;
+  apr_size_t delta, max_delta, back;
 
   apos = find_block(blocks, rolling, b + bpos);
 
@@ -294,14 +371,16 @@ find_match(const struct blocks *blocks,
                                     b + bpos + MATCH_BLOCKSIZE,
                                     max_delta);
 
-  /* See if we can extend backwards (max MATCH_BLOCKSIZE-1 steps because A's
-     content has been sampled only every MATCH_BLOCKSIZE positions).  */
-  while (apos > 0 && bpos > pending_insert_start && a[apos-1] == b[bpos-1])
-    {
-      --apos;
-      --bpos;
-      ++delta;
-    }
+  /* See if we can extend backwards, up to the start of A and without
+     reaching into B's data that has already been covered by earlier
+     instructions, i.e. before PENDING_INSERT_START.  */
+  max_delta = apos < bpos - pending_insert_start
+            ? apos
+            : bpos - pending_insert_start;
+  back = svn_cstring__reverse_match_length(a + apos, b + bpos, max_delta);
+  apos -= back;
+  bpos -= back;
+  delta += back;
 
   *aposp = apos;
   *bposp = bpos;
@@ -414,7 +493,8 @@ compute_delta(svn_txdelta__ops_baton_t *build_baton,
 
       /* Quickly skip positions whose respective ROLLING checksums
          definitely do not match any SLOT in BLOCKS. */
-      while (!(blocks.flags[hash_flags(rolling)] & (1 << (rolling & 7)))
+      while (!(blocks.flags[hash_flags(&blocks, rolling)]
+               & (1 << (rolling & 7)))
              && lo < upper)
         {
           rolling = adler32_replace(rolling, b[lo], b[lo+MATCH_BLOCKSIZE]);
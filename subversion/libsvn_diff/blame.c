@@ -0,0 +1,212 @@
+/*
+ * blame.c :  attribute the lines of a file to revisions
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+
+#include <apr_pools.h>
+
+#include "svn_error.h"
+#include "svn_diff.h"
+
+#include "private/svn_diff_private.h"
+
+
+/* The baton used for the diff output routine. */
+struct diff_baton
+{
+  svn_diff__blame_chain_t *chain;
+  const void *rev;
+};
+
+svn_diff__blame_chain_t *
+svn_diff__blame_chain_create(apr_pool_t *pool)
+{
+  return apr_pcalloc(pool, sizeof(svn_diff__blame_chain_t));
+}
+
+svn_diff__blame_t *
+svn_diff__blame_create(svn_diff__blame_chain_t *chain,
+                       const void *rev,
+                       apr_off_t start)
+{
+  svn_diff__blame_t *blame;
+  if (chain->avail)
+    {
+      blame = chain->avail;
+      chain->avail = blame->next;
+    }
+  else
+    blame = apr_palloc(chain->pool, sizeof(*blame));
+  blame->rev = rev;
+  blame->start = start;
+  blame->next = NULL;
+  return blame;
+}
+
+/* Destroy a blame chunk. */
+static void
+blame_destroy(svn_diff__blame_chain_t *chain,
+              svn_diff__blame_t *blame)
+{
+  blame->next = chain->avail;
+  chain->avail = blame;
+}
+
+/* Return the blame chunk that contains token OFF, starting the search at
+   BLAME. */
+static svn_diff__blame_t *
+blame_find(svn_diff__blame_t *blame, apr_off_t off)
+{
+  svn_diff__blame_t *prev = NULL;
+  while (blame)
+    {
+      if (blame->start > off) break;
+      prev = blame;
+      blame = blame->next;
+    }
+  return prev;
+}
+
+/* Shift the start-point of BLAME and all subsequence blame-chunks
+   by ADJUST tokens */
+static void
+blame_adjust(svn_diff__blame_t *blame, apr_off_t adjust)
+{
+  while (blame)
+    {
+      blame->start += adjust;
+      blame = blame->next;
+    }
+}
+
+/* Delete the blame associated with the region from token START to
+   START + LENGTH */
+static void
+blame_delete_range(svn_diff__blame_chain_t *chain,
+                   apr_off_t start,
+                   apr_off_t length)
+{
+  svn_diff__blame_t *first = blame_find(chain->blame, start);
+  svn_diff__blame_t *last = blame_find(chain->blame, start + length);
+  svn_diff__blame_t *tail = last->next;
+
+  if (first != last)
+    {
+      svn_diff__blame_t *walk = first->next;
+      while (walk != last)
+        {
+          svn_diff__blame_t *next = walk->next;
+          blame_destroy(chain, walk);
+          walk = next;
+        }
+      first->next = last;
+      last->start = start;
+      if (first->start == start)
+        {
+          *first = *last;
+          blame_destroy(chain, last);
+          last = first;
+        }
+    }
+
+  if (tail && tail->start == last->start + length)
+    {
+      *last = *tail;
+      blame_destroy(chain, tail);
+      tail = last->next;
+    }
+
+  blame_adjust(tail, -length);
+}
+
+/* Insert a chunk of blame associated with REV starting
+   at token START and continuing for LENGTH tokens */
+static void
+blame_insert_range(svn_diff__blame_chain_t *chain,
+                   const void *rev,
+                   apr_off_t start,
+                   apr_off_t length)
+{
+  svn_diff__blame_t *point = blame_find(chain->blame, start);
+  svn_diff__blame_t *insert;
+
+  if (point->start == start)
+    {
+      insert = svn_diff__blame_create(chain, point->rev,
+                                      point->start + length);
+      point->rev = rev;
+      insert->next = point->next;
+      point->next = insert;
+    }
+  else
+    {
+      svn_diff__blame_t *middle;
+      middle = svn_diff__blame_create(chain, rev, start);
+      insert = svn_diff__blame_create(chain, point->rev, start + length);
+      middle->next = insert;
+      insert->next = point->next;
+      point->next = middle;
+    }
+  blame_adjust(insert->next, length);
+}
+
+/* Callback for the diff between subsequent revisions */
+static svn_error_t *
+output_diff_modified(void *baton,
+                     apr_off_t original_start,
+                     apr_off_t original_length,
+                     apr_off_t modified_start,
+                     apr_off_t modified_length,
+                     apr_off_t latest_start,
+                     apr_off_t latest_length)
+{
+  struct diff_baton *db = baton;
+
+  if (original_length)
+    blame_delete_range(db->chain, modified_start, original_length);
+
+  if (modified_length)
+    blame_insert_range(db->chain, db->rev, modified_start, modified_length);
+
+  return SVN_NO_ERROR;
+}
+
+static const svn_diff_output_fns_t output_fns = {
+        NULL,
+        output_diff_modified
+};
+
+svn_error_t *
+svn_diff__blame_apply_diff(svn_diff__blame_chain_t *chain,
+                           svn_diff_t *diff,
+                           const void *rev,
+                           svn_cancel_func_t cancel_func,
+                           void *cancel_baton)
+{
+  struct diff_baton diff_baton;
+
+  diff_baton.chain = chain;
+  diff_baton.rev = rev;
+
+  return svn_error_trace(svn_diff_output2(diff, &diff_baton, &output_fns,
+                                          cancel_func, cancel_baton));
+}
@@ -58,6 +58,49 @@ svn_fs_hotcopy(const char *src_path, const char *dest_path,
                                          FALSE, NULL, NULL, pool));
 }
 
+/* Baton for pack_notify_wrapper_func(). */
+struct pack_notify_wrapper_baton
+{
+  svn_fs_pack_notify_t notify_func;
+  void *notify_baton;
+};
+
+/* Forward to the svn_fs_pack_notify_t in BATON, dropping the statistics.
+ * Implements svn_fs_pack_notify2_t. */
+static svn_error_t *
+pack_notify_wrapper_func(void *baton,
+                         apr_int64_t shard,
+                         svn_fs_pack_notify_action_t action,
+                         apr_off_t bytes,
+                         apr_interval_time_t duration,
+                         apr_pool_t *pool)
+{
+  struct pack_notify_wrapper_baton *pnwb = baton;
+
+  return svn_error_trace(pnwb->notify_func(pnwb->notify_baton, shard,
+                                           action, pool));
+}
+
+svn_error_t *
+svn_fs_pack(const char *db_path,
+            svn_fs_pack_notify_t notify_func,
+            void *notify_baton,
+            svn_cancel_func_t cancel_func,
+            void *cancel_baton,
+            apr_pool_t *pool)
+{
+  struct pack_notify_wrapper_baton pnwb;
+
+  pnwb.notify_func = notify_func;
+  pnwb.notify_baton = notify_baton;
+
+  return svn_error_trace(svn_fs_pack2(db_path, 1,
+                                      notify_func ? pack_notify_wrapper_func
+                                                  : NULL,
+                                      notify_func ? &pnwb : NULL,
+                                      cancel_func, cancel_baton, pool));
+}
+
 svn_error_t *
 svn_fs_begin_txn(svn_fs_txn_t **txn_p, svn_fs_t *fs, svn_revnum_t rev,
                  apr_pool_t *pool)
@@ -129,8 +129,9 @@ typedef struct fs_library_vtable_t
   svn_error_t *(*recover)(svn_fs_t *fs,
                           svn_cancel_func_t cancel_func, void *cancel_baton,
                           apr_pool_t *pool);
-  svn_error_t *(*pack_fs)(svn_fs_t *fs, const char *path,
-                          svn_fs_pack_notify_t notify_func, void *notify_baton,
+  svn_error_t *(*pack_fs)(svn_fs_t *fs, const char *path, int jobs,
+                          svn_fs_pack_notify2_t notify_func,
+                          void *notify_baton,
                           svn_cancel_func_t cancel_func, void *cancel_baton,
                           svn_mutex__t *common_pool_lock,
                           apr_pool_t *pool, apr_pool_t *common_pool);
@@ -387,6 +388,13 @@ typedef struct root_vtable_t
                                             svn_fs_process_contents_func_t processor,
                                             void* baton,
                                             apr_pool_t *pool);
+  svn_error_t *(*file_contents_span)(apr_file_t **file,
+                                     apr_off_t *offset,
+                                     svn_filesize_t *length,
+                                     svn_fs_root_t *root,
+                                     const char *path,
+                                     apr_pool_t *result_pool,
+                                     apr_pool_t *scratch_pool);
   svn_error_t *(*make_file)(svn_fs_root_t *root, const char *path,
                             apr_pool_t *pool);
   svn_error_t *(*apply_textdelta)(svn_txdelta_window_handler_t *contents_p,
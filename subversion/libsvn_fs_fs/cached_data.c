@@ -26,6 +26,7 @@
 
 #include "svn_hash.h"
 #include "svn_ctype.h"
+#include "svn_dirent_uri.h"
 #include "svn_sorts.h"
 #include "private/svn_delta_private.h"
 #include "private/svn_io_private.h"
@@ -826,6 +827,31 @@ auto_read_diff_version(rep_state_t *rs, apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Set *SLIDING to TRUE if the delta representation RS has been stored
+   as svndiff3.  Its windows may be larger than those of other reps and
+   their source views may slide independently of the target windows.
+   Use POOL for temporary allocations. */
+static svn_error_t *
+uses_sliding_windows(svn_boolean_t *sliding,
+                     rep_state_t *rs,
+                     apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = rs->sfile->fs->fsap_data;
+
+  if (ffd->format < SVN_FS_FS__MIN_SVNDIFF3_FORMAT)
+    {
+      *sliding = FALSE;
+      return SVN_NO_ERROR;
+    }
+
+  SVN_ERR(auto_open_shared_file(rs->sfile));
+  SVN_ERR(auto_set_start_offset(rs, pool));
+  SVN_ERR(auto_read_diff_version(rs, pool));
+  *sliding = rs->ver >= 3;
+
+  return SVN_NO_ERROR;
+}
+
 /* See create_rep_state, which wraps this and adds another error. */
 static svn_error_t *
 create_rep_state_body(rep_state_t **rep_state,
@@ -1079,6 +1105,24 @@ svn_fs_fs__check_rep(representation_t *rep,
                                rep, fs, scratch_pool, scratch_pool));
     }
 
+  /* Out-of-line contents must be present and complete. */
+  if (SVN_FS_FS__REP_IS_LARGE(rep))
+    {
+      apr_finfo_t finfo;
+      const char *path = svn_fs_fs__path_large_rep(fs, rep, scratch_pool);
+
+      SVN_ERR(svn_io_stat(&finfo, path, APR_FINFO_SIZE, scratch_pool));
+      if (finfo.size != rep->expanded_size)
+        return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                                 _("Large representation file '%s' has "
+                                   "size %s instead of %s"),
+                                 svn_dirent_local_style(path, scratch_pool),
+                                 apr_off_t_toa(scratch_pool, finfo.size),
+                                 apr_psprintf(scratch_pool,
+                                              "%" SVN_FILESIZE_T_FMT,
+                                              rep->expanded_size));
+    }
+
   return SVN_NO_ERROR;
 }
 
@@ -1182,6 +1226,21 @@ struct rep_read_baton
   /* The plaintext state, if there is a plaintext. */
   rep_state_t *src_state;
 
+  /* If not NULL, the representation to read, stored as svndiff3.  Its
+     windows do not line up with those of other reps.  They get applied
+     one by one to their source views within BASE_STREAM and RS_LIST is
+     empty. */
+  rep_state_t *sliding_state;
+
+  /* If not NULL, the fulltext of the base below RS_LIST or SLIDING_STATE.
+     This is used when the base has been stored as svndiff3. */
+  svn_stream_t *base_stream;
+
+  /* The current source view of SLIDING_STATE and its offset within
+     BASE_STREAM. */
+  svn_stringbuf_t *source_view;
+  svn_filesize_t source_view_offset;
+
   /* The index of the current delta chunk, if we are reading a delta. */
   int chunk_index;
 
@@ -1268,8 +1327,8 @@ parse_raw_window(void **out,
   stream = svn_stream_from_string(&raw_window, result_pool);
 
   /* parse it */
-  SVN_ERR(svn_txdelta_read_svndiff_window(&result->window, stream, 1,
-                                          result_pool));
+  SVN_ERR(svn_txdelta_read_svndiff_window(&result->window, stream,
+                                          window->ver, result_pool));
 
   /* complete the window and return it */
   result->end_offset = window->end_offset;
@@ -1430,11 +1489,20 @@ set_cached_combined_window(svn_stringbuf_t *window,
    ID, and representation REP.
    Also, set *WINDOW_P to the base window content for *LIST, if it
    could be found in cache. Otherwise, *LIST will contain the base
-   representation for the whole delta chain. */
+   representation for the whole delta chain.
+
+   Reps stored as svndiff3 end the chain as well.  If FIRST_REP is such
+   a delta rep, return its state in *SLIDING_STATE, leave *LIST empty and
+   return its base in *BASE_REP.  Otherwise, return the svndiff3 rep
+   itself in *BASE_REP.  In both cases, *SRC_STATE will be NULL and the
+   caller must read *BASE_REP as a whole.  Set *SLIDING_STATE and
+   *BASE_REP to NULL if there is no svndiff3 rep in the chain. */
 static svn_error_t *
 build_rep_list(apr_array_header_t **list,
                svn_stringbuf_t **window_p,
                rep_state_t **src_state,
+               rep_state_t **sliding_state,
+               representation_t **base_rep,
                svn_fs_t *fs,
                representation_t *first_rep,
                apr_pool_t *pool)
@@ -1443,10 +1511,13 @@ build_rep_list(apr_array_header_t **list,
   rep_state_t *rs = NULL;
   svn_fs_fs__rep_header_t *rep_header;
   svn_boolean_t is_cached = FALSE;
+  svn_boolean_t sliding;
   shared_file_t *shared_file = NULL;
   apr_pool_t *iterpool = svn_pool_create(pool);
 
   *list = apr_array_make(pool, 1, sizeof(rep_state_t *));
+  *sliding_state = NULL;
+  *base_rep = NULL;
   rep = *first_rep;
 
   /* for the top-level rep, we need the rep_args */
@@ -1484,6 +1555,30 @@ build_rep_list(apr_array_header_t **list,
           break;
         }
 
+      /* The windows of svndiff3 reps can't be combined in lockstep
+         with those of other reps.  Only a self-delta on its own can. */
+      if (rep_header->type == svn_fs_fs__rep_delta || (*list)->nelts > 0)
+        {
+          SVN_ERR(uses_sliding_windows(&sliding, rs, iterpool));
+          if (sliding && (*list)->nelts == 0)
+            {
+              *sliding_state = rs;
+              *base_rep = apr_pcalloc(pool, sizeof(**base_rep));
+              (*base_rep)->revision = rep_header->base_revision;
+              (*base_rep)->item_index = rep_header->base_item_index;
+              (*base_rep)->size = rep_header->base_length;
+              svn_fs_fs__id_txn_reset(&(*base_rep)->txn_id);
+              *src_state = NULL;
+              break;
+            }
+          else if (sliding)
+            {
+              *base_rep = apr_pmemdup(pool, &rep, sizeof(rep));
+              *src_state = NULL;
+              break;
+            }
+        }
+
       /* Push this rep onto the list.  If it's self-compressed, we're done. */
       APR_ARRAY_PUSH(*list, rep_state_t *) = rs;
       if (rep_header->type == svn_fs_fs__rep_self_delta)
@@ -1672,6 +1767,45 @@ skip_plain_window(rep_state_t *rs,
   return SVN_NO_ERROR;
 }
 
+/* Read SIZE bytes from the base fulltext STREAM and return them in *NWIN,
+   allocated in RESULT_POOL. */
+static svn_error_t *
+read_base_window(svn_stringbuf_t **nwin,
+                 svn_stream_t *stream,
+                 apr_size_t size,
+                 apr_pool_t *result_pool)
+{
+  apr_size_t len = size;
+
+  *nwin = svn_stringbuf_create_ensure(size, result_pool);
+  SVN_ERR(svn_stream_read_full(stream, (*nwin)->data, &len));
+  if (len != size)
+    return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                            _("svndiff source view exceeds the "
+                              "base representation"));
+
+  (*nwin)->len = len;
+  (*nwin)->data[len] = 0;
+
+  return SVN_NO_ERROR;
+}
+
+/* Skip SIZE bytes in the base fulltext STREAM. */
+static svn_error_t *
+skip_base_window(svn_stream_t *stream,
+                 svn_filesize_t size)
+{
+  while (size > 0)
+    {
+      apr_size_t chunk = size > APR_SIZE_MAX ? APR_SIZE_MAX
+                                             : (apr_size_t)size;
+      SVN_ERR(svn_stream_skip(stream, chunk));
+      size -= chunk;
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* Get the undeltified window that is a result of combining all deltas
    from the current desired representation identified in *RB with its
    base representation.  Store the window in *RESULT. */
@@ -1741,6 +1875,15 @@ get_combined_window(svn_stringbuf_t **result,
           else
             SVN_ERR(skip_plain_window(rb->src_state, window->sview_len));
         }
+      else if (source == NULL && rb->base_stream != NULL)
+        {
+          /* Same for an svndiff3 base that we read as a whole. */
+          if (window->src_ops)
+            SVN_ERR(read_base_window(&source, rb->base_stream,
+                                     window->sview_len, pool));
+          else
+            SVN_ERR(skip_base_window(rb->base_stream, window->sview_len));
+        }
 
       /* Combine this window with the current one. */
       new_pool = svn_pool_create(rb->pool);
@@ -1775,6 +1918,87 @@ get_combined_window(svn_stringbuf_t **result,
   return SVN_NO_ERROR;
 }
 
+/* Get the next window of RB->SLIDING_STATE applied to its source view in
+   RB->BASE_STREAM.  Store the result in *RESULT, allocated in RB->POOL.
+   Unlike in lockstep delta chains, consecutive source views may overlap
+   or leave gaps but they never move backwards. */
+static svn_error_t *
+get_sliding_window(svn_stringbuf_t **result,
+                   struct rep_read_baton *rb)
+{
+  rep_state_t *rs = rb->sliding_state;
+  svn_stringbuf_t *view = rb->source_view;
+  svn_txdelta_window_t *window;
+  svn_stringbuf_t *buf;
+  apr_pool_t *iterpool = svn_pool_create(rb->pool);
+
+  SVN_ERR(read_delta_window(&window, rb->chunk_index, rs, rb->pool,
+                            iterpool));
+  rs->chunk_index++;
+
+  if (window->sview_len > 0)
+    {
+      svn_filesize_t view_end;
+      apr_size_t len;
+
+      if (rb->base_stream == NULL)
+        return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                                _("svndiff window refers to a missing "
+                                  "base representation"));
+
+      view_end = rb->source_view_offset + view->len;
+      if (   window->sview_offset < rb->source_view_offset
+          || window->sview_offset + window->sview_len < view_end)
+        return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                                _("svndiff source view moves backwards"));
+
+      /* Keep what the views have in common and skip any gap. */
+      if (window->sview_offset < view_end)
+        {
+          apr_size_t shift = (apr_size_t)(window->sview_offset
+                                          - rb->source_view_offset);
+          memmove(view->data, view->data + shift, view->len - shift);
+          view->len -= shift;
+        }
+      else
+        {
+          SVN_ERR(skip_base_window(rb->base_stream,
+                                   window->sview_offset - view_end));
+          view->len = 0;
+        }
+      rb->source_view_offset = window->sview_offset;
+
+      /* Read the rest of the view. */
+      svn_stringbuf_ensure(view, window->sview_len);
+      len = window->sview_len - view->len;
+      SVN_ERR(svn_stream_read_full(rb->base_stream, view->data + view->len,
+                                   &len));
+      if (len != window->sview_len - view->len)
+        return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                                _("svndiff source view exceeds the "
+                                  "base representation"));
+
+      view->len = window->sview_len;
+      view->data[view->len] = 0;
+    }
+
+  buf = svn_stringbuf_create_ensure(window->tview_len, rb->pool);
+  buf->len = window->tview_len;
+
+  svn_txdelta_apply_instructions(window,
+                                 window->sview_len ? view->data : NULL,
+                                 buf->data, &buf->len);
+  if (buf->len != window->tview_len)
+    return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                            _("svndiff window length is "
+                              "corrupt"));
+
+  svn_pool_destroy(iterpool);
+
+  *result = buf;
+  return SVN_NO_ERROR;
+}
+
 /* Returns whether or not the expanded fulltext of the file is cachable
  * based on its size SIZE.  The decision depends on the cache used by FFD.
  */
@@ -1811,7 +2035,7 @@ get_contents_from_windows(struct rep_read_baton *rb,
 
   /* Special case for when there are no delta reps, only a plain
      text. */
-  if (rb->rs_list->nelts == 0)
+  if (rb->rs_list->nelts == 0 && rb->sliding_state == NULL)
     {
       copy_len = remaining;
       rs = rb->src_state;
@@ -1877,12 +2101,17 @@ get_contents_from_windows(struct rep_read_baton *rb,
         {
           svn_stringbuf_t *sbuf = NULL;
 
-          rs = APR_ARRAY_IDX(rb->rs_list, 0, rep_state_t *);
+          rs = rb->sliding_state
+             ? rb->sliding_state
+             : APR_ARRAY_IDX(rb->rs_list, 0, rep_state_t *);
           if (rs->current == rs->size)
             break;
 
           /* Get more buffered data by evaluating a chunk. */
-          SVN_ERR(get_combined_window(&sbuf, rb));
+          if (rb->sliding_state)
+            SVN_ERR(get_sliding_window(&sbuf, rb));
+          else
+            SVN_ERR(get_combined_window(&sbuf, rb));
 
           rb->chunk_index++;
           rb->buf_len = sbuf->len;
@@ -1896,6 +2125,48 @@ get_contents_from_windows(struct rep_read_baton *rb,
   return SVN_NO_ERROR;
 }
 
+/* Implements svn_read_fn_t for the base fulltext streams created by
+   open_base_stream().  BATON is a rep_read_baton.  Unlike
+   rep_read_contents(), don't verify the result because we don't know
+   the checksum of a base from the rep header alone. */
+static svn_error_t *
+base_read_contents(void *baton,
+                   char *buf,
+                   apr_size_t *len)
+{
+  return svn_error_trace(get_contents_from_windows(baton, buf, len));
+}
+
+/* Set RB->BASE_STREAM to the fulltext of BASE_REP as returned by
+   build_rep_list().  No-op if BASE_REP is NULL. */
+static svn_error_t *
+open_base_stream(struct rep_read_baton *rb,
+                 representation_t *base_rep)
+{
+  struct rep_read_baton *base_rb;
+  representation_t *next_base_rep;
+  pair_cache_key_t fulltext_cache_key = { SVN_INVALID_REVNUM, 0 };
+
+  if (base_rep == NULL)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(rep_read_get_baton(&base_rb, rb->fs, base_rep, fulltext_cache_key,
+                             rb->filehandle_pool));
+  SVN_ERR(build_rep_list(&base_rb->rs_list, &base_rb->base_window,
+                         &base_rb->src_state, &base_rb->sliding_state,
+                         &next_base_rep, base_rb->fs, &base_rb->rep,
+                         base_rb->filehandle_pool));
+  SVN_ERR(open_base_stream(base_rb, next_base_rep));
+
+  rb->base_stream = svn_stream_create(base_rb, rb->filehandle_pool);
+  svn_stream_set_read2(rb->base_stream, NULL /* only full read support */,
+                       base_read_contents);
+  rb->source_view = svn_stringbuf_create_empty(rb->filehandle_pool);
+  rb->source_view_offset = 0;
+
+  return SVN_NO_ERROR;
+}
+
 /* Baton type for get_fulltext_partial. */
 typedef struct fulltext_baton_t
 {
@@ -2127,11 +2398,14 @@ rep_read_contents(void *baton,
   /* No fulltext cache to help us.  We must read from the window stream. */
   if (!rb->rs_list)
     {
+      representation_t *base_rep;
+
       /* Window stream not initialized, yet.  Do it now. */
       rb->len = rb->rep.expanded_size;
       SVN_ERR(build_rep_list(&rb->rs_list, &rb->base_window,
-                             &rb->src_state, rb->fs, &rb->rep,
-                             rb->filehandle_pool));
+                             &rb->src_state, &rb->sliding_state, &base_rep,
+                             rb->fs, &rb->rep, rb->filehandle_pool));
+      SVN_ERR(open_base_stream(rb, base_rep));
 
       /* In case we did read from the fulltext cache before, make the
        * window stream catch up.  Also, initialize the fulltext buffer
@@ -2188,6 +2462,171 @@ rep_read_contents(void *baton,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_fs_fs__open_large_rep(apr_file_t **file,
+                          svn_fs_t *fs,
+                          representation_t *rep,
+                          apr_pool_t *pool)
+{
+  SVN_ERR_ASSERT(SVN_FS_FS__REP_IS_LARGE(rep));
+
+  return svn_error_trace(svn_io_file_open(file,
+                                          svn_fs_fs__path_large_rep(fs, rep,
+                                                                    pool),
+                                          APR_READ | APR_BUFFERED,
+                                          APR_OS_DEFAULT, pool));
+}
+
+svn_error_t *
+svn_fs_fs__get_contents_span(apr_file_t **file,
+                             apr_off_t *offset,
+                             svn_filesize_t *length,
+                             svn_fs_t *fs,
+                             representation_t *rep,
+                             apr_pool_t *result_pool,
+                             apr_pool_t *scratch_pool)
+{
+  /* File contents in rev and pack files are always stored as svndiff,
+   * even if there is no delta base.  So, only large reps qualify.  Those
+   * get committed before their revision becomes visible. */
+  if (rep && SVN_FS_FS__REP_IS_LARGE(rep)
+      && !svn_fs_fs__id_txn_used(&rep->txn_id))
+    {
+      svn_filesize_t file_size;
+
+      /* The data will bypass the checks in large_rep_read().  Verify
+       * at least the size here, so that a damaged file gets reported
+       * as such instead of as a failure to send it.  The MD5 checksum
+       * is still being verified by the receiving client. */
+      SVN_ERR(svn_fs_fs__open_large_rep(file, fs, rep, result_pool));
+      SVN_ERR(svn_io_file_size_get(&file_size, *file, scratch_pool));
+      if (file_size != rep->expanded_size)
+        {
+          svn_error_t *err
+            = svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                                _("Large representation file has %s "
+                                  "bytes instead of %s"),
+                                apr_psprintf(scratch_pool,
+                                             "%" SVN_FILESIZE_T_FMT,
+                                             file_size),
+                                apr_psprintf(scratch_pool,
+                                             "%" SVN_FILESIZE_T_FMT,
+                                             rep->expanded_size));
+          return svn_error_compose_create(err,
+                                          svn_io_file_close(*file,
+                                                            scratch_pool));
+        }
+
+      *offset = 0;
+      *length = rep->expanded_size;
+    }
+  else
+    {
+      *file = NULL;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Baton for the large rep reader stream created by get_large_contents().
+ */
+typedef struct large_rep_baton_t
+{
+  /* The file containing the fulltext. */
+  svn_stream_t *file_stream;
+
+  /* MD5 checksum calculation and the expected result. */
+  svn_checksum_ctx_t *md5_checksum_ctx;
+  unsigned char md5_digest[APR_MD5_DIGESTSIZE];
+
+  /* Number of bytes read so far and the total fulltext length. */
+  svn_filesize_t off;
+  svn_filesize_t len;
+
+  /* Pool to use for the final checksum and error objects. */
+  apr_pool_t *pool;
+} large_rep_baton_t;
+
+/* Implements svn_read_fn_t for large reps.  Pass the data through from
+ * the underlying file and validate length and checksum at the end. */
+static svn_error_t *
+large_rep_read(void *baton,
+               char *buffer,
+               apr_size_t *len)
+{
+  large_rep_baton_t *lb = baton;
+  apr_size_t requested = *len;
+
+  SVN_ERR(svn_stream_read_full(lb->file_stream, buffer, len));
+  if (lb->off + (svn_filesize_t)*len > lb->len)
+    return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                            _("Large representation file is longer than "
+                              "expected"));
+
+  SVN_ERR(svn_checksum_update(lb->md5_checksum_ctx, buffer, *len));
+  lb->off += *len;
+
+  if (*len < requested && lb->off < lb->len)
+    return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                            _("Large representation file is truncated"));
+
+  if (requested && lb->off == lb->len && lb->md5_checksum_ctx)
+    {
+      svn_checksum_t *md5_checksum;
+      svn_checksum_t expected;
+      expected.kind = svn_checksum_md5;
+      expected.digest = lb->md5_digest;
+
+      SVN_ERR(svn_checksum_final(&md5_checksum, lb->md5_checksum_ctx,
+                                 lb->pool));
+      lb->md5_checksum_ctx = NULL;
+      if (!svn_checksum_match(md5_checksum, &expected))
+        return svn_error_create(SVN_ERR_FS_CORRUPT,
+                svn_checksum_mismatch_err(&expected, md5_checksum,
+                    lb->pool,
+                    _("Checksum mismatch while reading representation")),
+                NULL);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_close_fn_t for large reps. */
+static svn_error_t *
+large_rep_close(void *baton)
+{
+  large_rep_baton_t *lb = baton;
+  return svn_error_trace(svn_stream_close(lb->file_stream));
+}
+
+/* Set *CONTENTS_P to a stream reading the fulltext of the large
+ * representation REP in FS directly from its file.  Those reps never
+ * enter the fulltext cache.  Allocate the result in POOL. */
+static svn_error_t *
+get_large_contents(svn_stream_t **contents_p,
+                   svn_fs_t *fs,
+                   representation_t *rep,
+                   apr_pool_t *pool)
+{
+  apr_file_t *file;
+  large_rep_baton_t *lb = apr_pcalloc(pool, sizeof(*lb));
+
+  SVN_ERR(svn_fs_fs__open_large_rep(&file, fs, rep, pool));
+
+  lb->file_stream = svn_stream_from_aprfile2(file, FALSE, pool);
+  lb->md5_checksum_ctx = svn_checksum_ctx_create(svn_checksum_md5, pool);
+  memcpy(lb->md5_digest, rep->md5_digest, sizeof(lb->md5_digest));
+  lb->len = rep->expanded_size;
+  lb->pool = pool;
+
+  *contents_p = svn_stream_create(lb, pool);
+  svn_stream_set_read2(*contents_p, NULL /* only full read support */,
+                       large_rep_read);
+  svn_stream_set_close(*contents_p, large_rep_close);
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_fs__get_contents(svn_stream_t **contents_p,
                         svn_fs_t *fs,
@@ -2199,6 +2638,10 @@ svn_fs_fs__get_contents(svn_stream_t **contents_p,
     {
       *contents_p = svn_stream_empty(pool);
     }
+  else if (SVN_FS_FS__REP_IS_LARGE(rep))
+    {
+      SVN_ERR(get_large_contents(contents_p, fs, rep, pool));
+    }
   else
     {
       fs_fs_data_t *ffd = fs->fsap_data;
@@ -2247,9 +2690,15 @@ svn_fs_fs__get_contents_from_file(svn_stream_t **contents_p,
 {
   struct rep_read_baton *rb;
   pair_cache_key_t fulltext_cache_key = { SVN_INVALID_REVNUM, 0 };
-  rep_state_t *rs = apr_pcalloc(pool, sizeof(*rs));
+  rep_state_t *rs;
   svn_fs_fs__rep_header_t *rh;
 
+  /* The revision file only contains an empty placeholder for those. */
+  if (SVN_FS_FS__REP_IS_LARGE(rep))
+    return svn_error_trace(get_large_contents(contents_p, fs, rep, pool));
+
+  rs = apr_pcalloc(pool, sizeof(*rs));
+
   /* Initialize the reader baton.  Some members may added lazily
    * while reading from the stream. */
   SVN_ERR(rep_read_get_baton(&rb, fs, rep, fulltext_cache_key, pool));
@@ -2299,6 +2748,8 @@ svn_fs_fs__get_contents_from_file(svn_stream_t **contents_p,
   else
     {
       representation_t next_rep = { 0 };
+      representation_t *base_rep;
+      svn_boolean_t sliding;
 
       /* skip "SVNx" diff marker */
       rs->current = 4;
@@ -2310,12 +2761,40 @@ svn_fs_fs__get_contents_from_file(svn_stream_t **contents_p,
       next_rep.size = rh->base_length;
       svn_fs_fs__id_txn_reset(&next_rep.txn_id);
 
-      SVN_ERR(build_rep_list(&rb->rs_list, &rb->base_window,
-                             &rb->src_state, rb->fs, &next_rep,
-                             rb->filehandle_pool));
+      SVN_ERR(uses_sliding_windows(&sliding, rs, pool));
+      if (sliding)
+        {
+          /* REP gets applied to the base fulltext window by window. */
+          rb->rs_list = apr_array_make(pool, 0, sizeof(rep_state_t *));
+          rb->sliding_state = rs;
+          base_rep = &next_rep;
+        }
+      else
+        {
+          SVN_ERR(build_rep_list(&rb->rs_list, &rb->base_window,
+                                 &rb->src_state, &rb->sliding_state,
+                                 &base_rep, rb->fs, &next_rep,
+                                 rb->filehandle_pool));
+
+          /* An svndiff3 base can't be part of our lockstep chain. */
+          if (!rb->sliding_state && rb->rs_list->nelts > 0)
+            SVN_ERR(uses_sliding_windows(&sliding,
+                                         APR_ARRAY_IDX(rb->rs_list, 0,
+                                                       rep_state_t *),
+                                         pool));
+          if (rb->sliding_state || sliding)
+            {
+              apr_array_clear(rb->rs_list);
+              rb->sliding_state = NULL;
+              base_rep = &next_rep;
+            }
+
+          /* Insert the access to REP as the first element of the delta
+           * chain. */
+          svn_sort__array_insert(rb->rs_list, &rs, 0);
+        }
 
-      /* Insert the access to REP as the first element of the delta chain. */
-      svn_sort__array_insert(rb->rs_list, &rs, 0);
+      SVN_ERR(open_base_stream(rb, base_rep));
     }
 
   /* Now, the baton is complete and we can assemble the stream around it. */
@@ -2460,11 +2939,13 @@ svn_fs_fs__get_file_delta_stream(svn_txdelta_stream_t **stream_p,
   svn_stream_t *source_stream, *target_stream;
   rep_state_t *rep_state;
   svn_fs_fs__rep_header_t *rep_header;
+  svn_boolean_t sliding;
   fs_fs_data_t *ffd = fs->fsap_data;
 
   /* Try a shortcut: if the target is stored as a delta against the source,
      then just use that delta.  However, prefer using the fulltext cache
-     whenever that is available. */
+     whenever that is available.  Deltas with large windows must not be
+     handed out because the consumer may not be able to process them. */
   if (target->data_rep && (source || ! ffd->fulltext_cache))
     {
       /* Read target's base rep if any. */
@@ -2480,8 +2961,13 @@ svn_fs_fs__get_file_delta_stream(svn_txdelta_stream_t **stream_p,
               && rep_header->base_revision == source->data_rep->revision
               && rep_header->base_item_index == source->data_rep->item_index)
             {
-              *stream_p = get_storaged_delta_stream(rep_state, target, pool);
-              return SVN_NO_ERROR;
+              SVN_ERR(uses_sliding_windows(&sliding, rep_state, pool));
+              if (!sliding)
+                {
+                  *stream_p = get_storaged_delta_stream(rep_state, target,
+                                                        pool);
+                  return SVN_NO_ERROR;
+                }
             }
         }
       else if (!source)
@@ -2491,8 +2977,13 @@ svn_fs_fs__get_file_delta_stream(svn_txdelta_stream_t **stream_p,
              format. */
           if (rep_header->type == svn_fs_fs__rep_self_delta)
             {
-              *stream_p = get_storaged_delta_stream(rep_state, target, pool);
-              return SVN_NO_ERROR;
+              SVN_ERR(uses_sliding_windows(&sliding, rep_state, pool));
+              if (!sliding)
+                {
+                  *stream_p = get_storaged_delta_stream(rep_state, target,
+                                                        pool);
+                  return SVN_NO_ERROR;
+                }
             }
         }
 
@@ -3206,7 +3697,7 @@ init_rep_state(rep_state_t *rs,
   rs->start = entry->offset + rs->header_size;
   rs->current = rep_header->type == svn_fs_fs__rep_plain ? 0 : 4;
   rs->size = entry->size - rep_header->header_size - 7;
-  rs->ver = 1;
+  rs->ver = -1;
   rs->chunk_index = 0;
   rs->raw_window_cache = ffd->raw_window_cache;
   rs->window_cache = ffd->txdelta_window_cache;
@@ -3324,6 +3815,7 @@ cache_windows(svn_fs_t *fs,
           window.end_offset = rs->current;
           window.window.len = window_len;
           window.window.data = buf;
+          window.ver = rs->ver;
 
           /* cache the window now */
           SVN_ERR(svn_cache__set(rs->raw_window_cache, &key, &window,
@@ -3402,6 +3894,8 @@ block_read_windows(svn_fs_fs__rep_header_t *rep_header,
     }
   else
     {
+      /* The svndiff version determines how the windows get parsed. */
+      SVN_ERR(auto_read_diff_version(&rs, scratch_pool));
       SVN_ERR(cache_windows(fs, &rs, max_offset, scratch_pool));
     }
 
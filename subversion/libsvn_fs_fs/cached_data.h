@@ -105,6 +105,33 @@ svn_fs_fs__get_contents_from_file(svn_stream_t **contents_p,
                                   apr_off_t offset,
                                   apr_pool_t *pool);
 
+/* Open the file containing the fulltext of the large representation REP
+   in FS (see SVN_FS_FS__REP_IS_LARGE) for reading and return it in *FILE.
+   Unlike svn_fs_fs__get_contents, this bypasses all caches and checksum
+   validation and allows the caller to e.g. sendfile() the contents.
+   Allocate *FILE in POOL. */
+svn_error_t *
+svn_fs_fs__open_large_rep(apr_file_t **file,
+                          svn_fs_t *fs,
+                          representation_t *rep,
+                          apr_pool_t *pool);
+
+/* If the committed representation REP in FS stores the fulltext verbatim
+   in some file, i.e. if it is a large rep, open that file and return it
+   in *FILE, with *OFFSET and *LENGTH describing where the fulltext is.
+   Otherwise, e.g. for svndiff or in-txn reps, set *FILE to NULL.
+   No checksums will be validated.
+
+   Allocate *FILE in RESULT_POOL and use SCRATCH_POOL for temporaries. */
+svn_error_t *
+svn_fs_fs__get_contents_span(apr_file_t **file,
+                             apr_off_t *offset,
+                             svn_filesize_t *length,
+                             svn_fs_t *fs,
+                             representation_t *rep,
+                             apr_pool_t *result_pool,
+                             apr_pool_t *scratch_pool);
+
 /* Attempt to fetch the text representation of node-revision NODEREV as
    seen in filesystem FS and pass it along with the BATON to the PROCESSOR.
    Set *SUCCESS only of the data could be provided and the processing
@@ -426,6 +426,20 @@ svn_fs_fs__dag_try_process_file_contents(svn_boolean_t *success,
                                          void* baton,
                                          apr_pool_t *pool);
 
+/* If the contents of the file NODE are stored verbatim on disk, set *FILE
+   to the file containing them and *OFFSET and *LENGTH to their location
+   within it.  Otherwise, set *FILE to NULL.  See svn_fs_file_contents_span.
+
+   Allocate *FILE in RESULT_POOL and use SCRATCH_POOL for temporaries.
+ */
+svn_error_t *
+svn_fs_fs__dag_get_contents_span(apr_file_t **file,
+                                 apr_off_t *offset,
+                                 svn_filesize_t *length,
+                                 dag_node_t *node,
+                                 apr_pool_t *result_pool,
+                                 apr_pool_t *scratch_pool);
+
 
 /* Set *STREAM_P to a delta stream that will turn the contents of SOURCE into
    the contents of TARGET, allocated in POOL.  If SOURCE is null, the empty
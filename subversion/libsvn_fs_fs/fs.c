@@ -33,6 +33,7 @@
 #include "svn_version.h"
 #include "svn_pools.h"
 #include "fs.h"
+#include "private/svn_batch_fsync.h"
 #include "fs_fs.h"
 #include "tree.h"
 #include "lock.h"
@@ -366,6 +367,36 @@ fs_open(svn_fs_t *fs,
 }
 
 
+svn_error_t *
+svn_fs_fs__open_clone(svn_fs_t **clone,
+                      svn_fs_t *fs,
+                      apr_pool_t *result_pool,
+                      apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_fs_t *new_fs = apr_pcalloc(result_pool, sizeof(*new_fs));
+  fs_fs_data_t *new_ffd;
+
+  /* Mimic what the FS loader would do for a new FS object. */
+  new_fs->pool = result_pool;
+  new_fs->warning = fs->warning;
+  new_fs->warning_baton = fs->warning_baton;
+  new_fs->config = fs->config;
+
+  SVN_ERR(initialize_fs_struct(new_fs));
+  SVN_ERR(svn_fs_fs__open(new_fs, fs->path, scratch_pool));
+  SVN_ERR(svn_fs_fs__initialize_caches(new_fs, scratch_pool));
+
+  /* Both objects refer to the same repository, so they must use the
+     same locks. */
+  new_ffd = new_fs->fsap_data;
+  new_ffd->shared = ffd->shared;
+
+  *clone = new_fs;
+
+  return SVN_NO_ERROR;
+}
+
 
 /* This implements the fs_library_vtable_t.open_for_recovery() API. */
 static svn_error_t *
@@ -466,7 +497,8 @@ fs_verify(svn_fs_t *fs, const char *path,
 static svn_error_t *
 fs_pack(svn_fs_t *fs,
         const char *path,
-        svn_fs_pack_notify_t notify_func,
+        int jobs,
+        svn_fs_pack_notify2_t notify_func,
         void *notify_baton,
         svn_cancel_func_t cancel_func,
         void *cancel_baton,
@@ -475,7 +507,7 @@ fs_pack(svn_fs_t *fs,
         apr_pool_t *common_pool)
 {
   SVN_ERR(fs_open(fs, path, common_pool_lock, pool, common_pool));
-  return svn_fs_fs__pack(fs, 0, notify_func, notify_baton,
+  return svn_fs_fs__pack(fs, 0, jobs, notify_func, notify_baton,
                          cancel_func, cancel_baton, pool);
 }
 
@@ -625,6 +657,8 @@ svn_fs_fs__init(const svn_version_t *loader_version,
                              loader_version->major);
   SVN_ERR(svn_ver_check_list2(fs_version(), checklist, svn_ver_equal));
 
+  SVN_ERR(svn_batch_fsync__init(common_pool));
+
   *vtable = &library_vtable;
   return SVN_NO_ERROR;
 }
@@ -64,6 +64,8 @@ extern "C" {
 #define PATH_TXN_CURRENT      "txn-current"      /* File with next txn key */
 #define PATH_TXN_CURRENT_LOCK "txn-current-lock" /* Lock for txn-current */
 #define PATH_LOCKS_DIR        "locks"            /* Directory of locks */
+#define PATH_LARGE_DIR        "large"            /* Directory of out-of-line
+                                                    large representations */
 #define PATH_MIN_UNPACKED_REV "min-unpacked-rev" /* Oldest revision which
                                                     has not been packed. */
 #define PATH_REVPROP_GENERATION "revprop-generation"
@@ -92,6 +94,10 @@ extern "C" {
 #define PATH_TXN_ITEM_INDEX "itemidx"      /* File containing the current item
                                               index number */
 #define PATH_INDEX          "index"        /* name of index files w/o ext */
+#define PATH_PREFIX_LARGE   "large."       /* Prefix for out-of-line large
+                                              representation files */
+#define PATH_LARGE_TMP      "large.tmp"    /* Large rep currently being
+                                              written */
 
 /* Names of files in legacy FS formats */
 #define PATH_REV           "rev"           /* Proto rev file */
@@ -108,9 +114,13 @@ extern "C" {
 #define CONFIG_OPTION_MAX_DELTIFICATION_WALK     "max-deltification-walk"
 #define CONFIG_OPTION_MAX_LINEAR_DELTIFICATION   "max-linear-deltification"
 #define CONFIG_OPTION_COMPRESSION_LEVEL  "compression-level"
+#define CONFIG_OPTION_COMPRESSION        "compression"
+#define CONFIG_OPTION_LARGE_DELTA_WINDOWS "large-delta-windows"
 #define CONFIG_SECTION_PACKED_REVPROPS   "packed-revprops"
 #define CONFIG_OPTION_REVPROP_PACK_SIZE  "revprop-pack-size"
 #define CONFIG_OPTION_COMPRESS_PACKED_REVPROPS  "compress-packed-revprops"
+#define CONFIG_SECTION_LARGE_FILES       "large-files"
+#define CONFIG_OPTION_LARGE_FILE_THRESHOLD "threshold"
 #define CONFIG_SECTION_IO                "io"
 #define CONFIG_OPTION_BLOCK_SIZE         "block-size"
 #define CONFIG_OPTION_L2P_PAGE_SIZE      "l2p-page-size"
@@ -126,11 +136,22 @@ extern "C" {
    Note: If you bump this, please update the switch statement in
          svn_fs_fs__create() as well.
  */
-#define SVN_FS_FS__FORMAT_NUMBER   7
+#define SVN_FS_FS__FORMAT_NUMBER   8
 
 /* The minimum format number that supports svndiff version 1.  */
 #define SVN_FS_FS__MIN_SVNDIFF1_FORMAT 2
 
+/* The minimum format number that supports svndiff version 2 (LZ4).  */
+#define SVN_FS_FS__MIN_SVNDIFF2_FORMAT 8
+
+/* The minimum format number that supports svndiff version 3 (LZ4 with
+   delta windows of up to 1 MB).  */
+#define SVN_FS_FS__MIN_SVNDIFF3_FORMAT 8
+
+/* The minimum format number that supports storing large file contents
+   outside the revision files. */
+#define SVN_FS_FS__MIN_LARGE_REP_FORMAT 8
+
 /* The minimum format number that supports transaction ID generation
    using a transaction sequence in the txn-current file. */
 #define SVN_FS_FS__MIN_TXN_CURRENT_FORMAT 3
@@ -295,6 +316,19 @@ typedef struct window_cache_key_t
   apr_uint64_t item_index;
 } window_cache_key_t;
 
+/* Compression methods available for the txdelta storage format. */
+typedef enum compression_type_t
+{
+  /* Store deltas uncompressed (svndiff1 with compression level 0). */
+  compression_type_none,
+
+  /* svndiff1, using zlib as secondary compression. */
+  compression_type_zlib,
+
+  /* svndiff2, using LZ4 as secondary compression. */
+  compression_type_lz4
+} compression_type_t;
+
 /* Private (non-shared) FSFS-specific data for each svn_fs_t object.
    Any caches in here may be NULL. */
 typedef struct fs_fs_data_t
@@ -470,9 +504,21 @@ typedef struct fs_fs_data_t
    * deltification history after which skip deltas will be used. */
   apr_int64_t max_linear_deltification;
 
-  /* Compression level to use with txdelta storage format in new revs. */
+  /* Compression method to use with txdelta storage format in new revs. */
+  compression_type_t delta_compression_type;
+
+  /* Compression level to use with txdelta storage format in new revs.
+   * Only used with zlib compression. */
   int delta_compression_level;
 
+  /* Size of the delta windows in new revs.  Anything larger than
+   * SVN_DELTA_WINDOW_SIZE gets stored as svndiff3. */
+  apr_size_t delta_window_size;
+
+  /* File contents of at least this many bytes get stored out-of-line
+   * in separate files instead of the revision files.  0 disables it. */
+  apr_int64_t large_file_threshold;
+
   /* Pack after every commit. */
   svn_boolean_t pack_after_commit;
 
@@ -538,7 +584,8 @@ typedef struct representation_t
   apr_uint64_t item_index;
 
   /* The size of the representation in bytes as seen in the revision
-     file. */
+     file.  This is 0 for large reps stored out-of-line, see
+     SVN_FS_FS__REP_IS_LARGE. */
   svn_filesize_t size;
 
   /* The size of the fulltext of the representation. If this is 0,
@@ -569,6 +616,16 @@ typedef struct representation_t
     } uniquifier;
 } representation_t;
 
+/* Return TRUE, if the contents of representation REP are stored in a
+ * separate file under PATH_LARGE_DIR instead of the revision file.
+ *
+ * Those reps leave an empty PLAIN representation in the revision file,
+ * i.e. they have a 0 SIZE but a non-zero EXPANDED_SIZE.  Normal PLAIN
+ * reps with 0 SIZE are always empty and every DELTA rep has a non-zero
+ * SIZE because of the svndiff header. */
+#define SVN_FS_FS__REP_IS_LARGE(rep) \
+  ((rep)->size == 0 && (rep)->expanded_size > 0)
+
 
 /*** Node-Revision ***/
 /* If you add fields to this, check to see if you need to change
@@ -48,6 +48,7 @@
 #include "private/svn_string_private.h"
 #include "private/svn_subr_private.h"
 #include "../libsvn_fs/fs-loader.h"
+#include "../libsvn_delta/delta.h"  /* for SVN_DELTA_*WINDOW_SIZE */
 
 /* The default maximum number of files per directory to store in the
    rev and revprops directory.  The number below is somewhat arbitrary,
@@ -683,6 +684,45 @@ verify_block_size(apr_int64_t block_size,
   return SVN_NO_ERROR;
 }
 
+/* Parse the fsfs.conf compression method VALUE for a repository of the
+ * given FORMAT and return it in *TYPE.  A NULL VALUE selects zlib.
+ */
+static svn_error_t *
+parse_compression_type(compression_type_t *type,
+                       const char *value,
+                       int format)
+{
+  if (value == NULL || !strcmp(value, "zlib"))
+    {
+      *type = compression_type_zlib;
+    }
+  else if (!strcmp(value, "none"))
+    {
+      *type = compression_type_none;
+    }
+  else if (!strcmp(value, "lz4"))
+    {
+      if (format < SVN_FS_FS__MIN_SVNDIFF2_FORMAT)
+        return svn_error_createf(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                                 _("Compression type '%s' requires FSFS "
+                                   "format %d or later for fsfs.conf "
+                                   "setting '%s'."),
+                                 value, SVN_FS_FS__MIN_SVNDIFF2_FORMAT,
+                                 CONFIG_OPTION_COMPRESSION);
+
+      *type = compression_type_lz4;
+    }
+  else
+    {
+      return svn_error_createf(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                               _("'%s' is not a valid value for fsfs.conf "
+                                 "setting '%s'."),
+                               value, CONFIG_OPTION_COMPRESSION);
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* Read the configuration information of the file system at FS_PATH
  * and set the respective values in FFD.  Use pools as usual.
  */
@@ -710,6 +750,8 @@ read_config(fs_fs_data_t *ffd,
   if (ffd->format >= SVN_FS_FS__MIN_DELTIFICATION_FORMAT)
     {
       apr_int64_t compression_level;
+      const char *compression;
+      svn_boolean_t large_delta_windows;
 
       SVN_ERR(svn_config_get_bool(config, &ffd->deltify_directories,
                                   CONFIG_SECTION_DELTIFICATION,
@@ -735,9 +777,34 @@ read_config(fs_fs_data_t *ffd,
       ffd->delta_compression_level
         = (int)MIN(MAX(SVN_DELTA_COMPRESSION_LEVEL_NONE, compression_level),
                    SVN_DELTA_COMPRESSION_LEVEL_MAX);
+
+      svn_config_get(config, &compression, CONFIG_SECTION_DELTIFICATION,
+                     CONFIG_OPTION_COMPRESSION, NULL);
+      SVN_ERR(parse_compression_type(&ffd->delta_compression_type,
+                                     compression, ffd->format));
+      if (ffd->delta_compression_type == compression_type_none)
+        ffd->delta_compression_level = SVN_DELTA_COMPRESSION_LEVEL_NONE;
+
+      SVN_ERR(svn_config_get_bool(config, &large_delta_windows,
+                                  CONFIG_SECTION_DELTIFICATION,
+                                  CONFIG_OPTION_LARGE_DELTA_WINDOWS,
+                                  FALSE));
+      if (large_delta_windows
+          && ffd->format < SVN_FS_FS__MIN_SVNDIFF3_FORMAT)
+        return svn_error_createf(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                                 _("fsfs.conf setting '%s' requires FSFS "
+                                   "format %d or later."),
+                                 CONFIG_OPTION_LARGE_DELTA_WINDOWS,
+                                 SVN_FS_FS__MIN_SVNDIFF3_FORMAT);
+
+      ffd->delta_window_size = large_delta_windows
+                             ? SVN_DELTA_LARGE_WINDOW_SIZE
+                             : SVN_DELTA_WINDOW_SIZE;
     }
   else
     {
+      ffd->delta_compression_type = compression_type_zlib;
+      ffd->delta_window_size = SVN_DELTA_WINDOW_SIZE;
       ffd->deltify_directories = FALSE;
       ffd->deltify_properties = FALSE;
       ffd->max_deltification_walk = SVN_FS_FS_MAX_DELTIFICATION_WALK;
@@ -805,6 +872,23 @@ read_config(fs_fs_data_t *ffd,
       ffd->p2l_page_size = 0x100000;  /* Matches above default in bytes. */
     }
 
+  if (ffd->format >= SVN_FS_FS__MIN_LARGE_REP_FORMAT)
+    {
+      SVN_ERR(svn_config_get_int64(config, &ffd->large_file_threshold,
+                                   CONFIG_SECTION_LARGE_FILES,
+                                   CONFIG_OPTION_LARGE_FILE_THRESHOLD,
+                                   0));
+
+      /* convert kBytes to bytes; negative values disable the feature */
+      ffd->large_file_threshold = ffd->large_file_threshold > 0
+                                ? ffd->large_file_threshold * 0x400
+                                : 0;
+    }
+  else
+    {
+      ffd->large_file_threshold = 0;
+    }
+
   if (ffd->format >= SVN_FS_FS__MIN_PACKED_FORMAT)
     {
       SVN_ERR(svn_config_get_bool(config, &ffd->pack_after_commit,
@@ -963,6 +1047,29 @@ write_config(svn_fs_t *fs,
 "### and 0 disabling it altogether."                                         NL
 "### The default value is 5."                                                NL
 "# " CONFIG_OPTION_COMPRESSION_LEVEL " = 5"                                  NL
+"###"                                                                        NL
+"### Instead of zlib, LZ4 may be used for compressing the deltas.  LZ4"      NL
+"### typically produces 10% to 30% larger data than zlib but compresses"     NL
+"### about an order of magnitude faster and decompresses at several GB/s."   NL
+"### This makes it a good choice for servers on fast storage whose CPUs"     NL
+"### are the bottleneck during commits and checkouts of large files."        NL
+"### Valid values are 'zlib' (using the level set above), 'lz4' and"         NL
+"### 'none'.  'lz4' requires format 8 repositories and clients / servers"    NL
+"### of version 1.10 or later to read the repository directly."              NL
+"### The default is 'zlib'."                                                 NL
+"# " CONFIG_OPTION_COMPRESSION " = zlib"                                     NL
+"###"                                                                        NL
+"### Deltas are normally computed over windows of 100 kBytes, i.e. changes"  NL
+"### that move data by more than that, e.g. insertions into binaries or"     NL
+"### edits to zip-based office documents, cannot be represented as small"    NL
+"### deltas.  Enabling this option uses windows of up to 1 MByte, stored in" NL
+"### svndiff3 format.  svndiff3 is always LZ4 compressed unless compression" NL
+"### has been set to 'none' above.  Larger windows need more memory and"     NL
+"### CPU when writing and reading the deltas."                               NL
+"### This requires format 8 repositories and clients / servers of version"   NL
+"### 1.10 or later to read the repository directly."                         NL
+"### The default is false."                                                  NL
+"# " CONFIG_OPTION_LARGE_DELTA_WINDOWS " = false"                            NL
 ""                                                                           NL
 "[" CONFIG_SECTION_PACKED_REVPROPS "]"                                       NL
 "### This parameter controls the size (in kBytes) of packed revprop files."  NL
@@ -1032,6 +1139,18 @@ write_config(svn_fs_t *fs,
 "### p2l-page-size is given in kBytes and with a default of 1024 kBytes."    NL
 "# " CONFIG_OPTION_P2L_PAGE_SIZE " = 1024"                                   NL
 ""                                                                           NL
+"[" CONFIG_SECTION_LARGE_FILES "]"                                           NL
+"### File contents at or above this size will be stored in separate files"   NL
+"### in the 'large' folder instead of the revision files.  Such contents"    NL
+"### are never deltified, neither against older versions nor as a base"      NL
+"### for newer ones, and are not put into the fulltext cache.  Servers"      NL
+"### can stream them directly from disk.  This keeps multi-GB artefacts"     NL
+"### from bloating pack files and from evicting more useful cache data."     NL
+"### Rep-sharing still applies to them."                                     NL
+"### The threshold is given in kBytes.  The default is 0, which disables"    NL
+"### the out-of-line storage."                                               NL
+"# " CONFIG_OPTION_LARGE_FILE_THRESHOLD " = 0"                               NL
+""                                                                           NL
 "[" CONFIG_SECTION_DEBUG "]"                                                 NL
 "###"                                                                        NL
 "### Whether to verify each new revision immediately before finalizing"      NL
@@ -1830,6 +1949,9 @@ svn_fs_fs__create(svn_fs_t *fs,
           case 8: format = 6;
                   break;
 
+          case 9: format = 7;
+                  break;
+
           default:format = SVN_FS_FS__FORMAT_NUMBER;
         }
 
@@ -2198,8 +2320,11 @@ svn_fs_fs__info_format(int *fs_format,
     case 7:
       (*supports_version)->minor = 9;
       break;
+    case 8:
+      (*supports_version)->minor = 10;
+      break;
 #ifdef SVN_DEBUG
-# if SVN_FS_FS__FORMAT_NUMBER != 7
+# if SVN_FS_FS__FORMAT_NUMBER != 8
 #  error "Need to add a 'case' statement here"
 # endif
 #endif
@@ -48,6 +48,18 @@ svn_error_t *svn_fs_fs__initialize_shared_data(svn_fs_t *fs,
                                                apr_pool_t *pool,
                                                apr_pool_t *common_pool);
 
+/* Open another filesystem object for the repository that FS has been
+   opened for and return it in *CLONE.  The clone shares the locks with
+   FS but has its own caches and file handles, so it may be used by a
+   different thread than FS.  FS must outlive *CLONE.
+
+   Allocate *CLONE in RESULT_POOL and use SCRATCH_POOL for temporary
+   allocations. */
+svn_error_t *svn_fs_fs__open_clone(svn_fs_t **clone,
+                                   svn_fs_t *fs,
+                                   apr_pool_t *result_pool,
+                                   apr_pool_t *scratch_pool);
+
 /* Upgrade the fsfs filesystem FS.  Indicate progress via the optional
  * NOTIFY_FUNC callback using NOTIFY_BATON.  The optional CANCEL_FUNC
  * will periodically be called with CANCEL_BATON to allow for preemption.
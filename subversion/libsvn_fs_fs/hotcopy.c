@@ -921,6 +921,21 @@ hotcopy_body(void *baton, apr_pool_t *pool)
   if (cancel_func)
     SVN_ERR(cancel_func(cancel_baton));
 
+  /* Copy the out-of-line large reps before any revision referring to
+   * them becomes visible in the destination.  Unchanged files will be
+   * skipped in incremental mode. */
+  if (src_ffd->format >= SVN_FS_FS__MIN_LARGE_REP_FORMAT)
+    {
+      src_subdir = svn_dirent_join(src_fs->path, PATH_LARGE_DIR, pool);
+      SVN_ERR(svn_io_check_path(src_subdir, &kind, pool));
+      if (kind == svn_node_dir)
+        SVN_ERR(hotcopy_io_copy_dir_recursively(NULL, src_subdir,
+                                                dst_fs->path,
+                                                PATH_LARGE_DIR, TRUE,
+                                                cancel_func, cancel_baton,
+                                                pool));
+    }
+
   /* Split the logic for new and old FS formats. The latter is much simpler
    * due to the absense of sharding and packing. However, it requires special
    * care when updating the 'current' file (which contains not just the
@@ -30,7 +30,9 @@
 #include "private/svn_subr_private.h"
 #include "private/svn_string_private.h"
 #include "private/svn_io_private.h"
+#include "private/svn_ordered_loop.h"
 
+#include "private/svn_batch_fsync.h"
 #include "fs_fs.h"
 #include "pack.h"
 #include "util.h"
@@ -79,9 +81,19 @@
  * - same for file representations
  *
  * Step 4 copies the items from the temporary buckets into the final
- * pack file and writes the temporary index files.
+ * pack file and writes the temporary index files.  Since the items are
+ * not stored in bucket order, we read the buckets through a large
+ * read-ahead buffer.  Items placed next to each other usually are close
+ * in their bucket as well, so most of them will be served from memory
+ * instead of requiring a seek & read each.
  *
  * Finally, after the last range of revisions, create the final indexes.
+ *
+ * Large reps stored out-of-line (see SVN_FS_FS__REP_IS_LARGE) only have an
+ * empty placeholder in the revision files, which gets packed like any
+ * other item.  Their contents are addressed by revision and item index,
+ * both of which survive packing.  So, the files under PATH_LARGE_DIR stay
+ * where they are and never bloat the pack files.
  */
 
 /* Maximum amount of memory we allocate for placement information during
@@ -89,6 +101,11 @@
  */
 #define DEFAULT_MAX_MEM (64 * 1024 * 1024)
 
+/* Size of the read-ahead buffer used when copying items from the
+ * temporary buckets into the pack file.  Larger items bypass it.
+ */
+#define READ_AHEAD_SIZE (1024 * 1024)
+
 /* Data structure describing a node change at PATH, REVISION.
  * We will sort these instances by PATH and NODE_ID such that we can combine
  * similar nodes in the same reps container and store containers in path
@@ -234,6 +251,14 @@ typedef struct pack_context_t
    * the next range of revisions is being processed */
   apr_pool_t *info_pool;
 
+  /* READ_AHEAD_SIZE bytes buffer used during phase 4.  It contains
+   * READ_AHEAD_LEN bytes of READ_AHEAD_FILE starting at READ_AHEAD_OFFSET.
+   * READ_AHEAD_FILE is NULL if the buffer contents is invalid. */
+  char *read_ahead_buffer;
+  apr_file_t *read_ahead_file;
+  apr_off_t read_ahead_offset;
+  apr_size_t read_ahead_len;
+
   /* ensure that all filesystem changes are written to disk. */
   svn_boolean_t flush_to_disk;
 } pack_context_t;
@@ -334,6 +359,9 @@ initialize_pack_context(pack_context_t *context,
   SVN_ERR(svn_io_open_unique_file3(&context->reps_file, NULL, temp_dir,
                                    svn_io_file_del_on_close, pool, pool));
 
+  context->read_ahead_buffer = apr_palloc(pool, READ_AHEAD_SIZE);
+  context->read_ahead_file = NULL;
+
   return SVN_NO_ERROR;
 }
 
@@ -361,6 +389,9 @@ reset_pack_context(pack_context_t *context,
 
   svn_pool_clear(context->info_pool);
 
+  /* The file objects may get re-allocated at the same addresses. */
+  context->read_ahead_file = NULL;
+
   /* The new temporary files must live at least as long as any other info
    * object in CONTEXT. */
   SVN_ERR(svn_io_temp_dir(&temp_dir, pool));
@@ -1127,6 +1158,56 @@ auto_pad_block(pack_context_t *context,
   return SVN_NO_ERROR;
 }
 
+/* Copy the contents of ITEM from TEMP_FILE to CONTEXT->PACK_FILE.  Small
+ * items are served from CONTEXT's read-ahead buffer, which gets refilled
+ * with the data following ITEM as necessary.  Use POOL for allocations.
+ */
+static svn_error_t *
+copy_item_from_temp(pack_context_t *context,
+                    apr_file_t *temp_file,
+                    svn_fs_fs__p2l_entry_t *item,
+                    apr_pool_t *pool)
+{
+  apr_off_t offset = item->offset;
+
+  /* Big items would only thrash the buffer. */
+  if (item->size > READ_AHEAD_SIZE / 2)
+    {
+      SVN_ERR(svn_io_file_seek(temp_file, APR_SET, &offset, pool));
+      return svn_error_trace(copy_file_data(context, context->pack_file,
+                                            temp_file, item->size, pool));
+    }
+
+  if (   context->read_ahead_file != temp_file
+      || offset < context->read_ahead_offset
+      || offset + item->size
+           > context->read_ahead_offset + context->read_ahead_len)
+    {
+      svn_boolean_t eof;
+
+      context->read_ahead_file = NULL;
+      SVN_ERR(svn_io_file_seek(temp_file, APR_SET, &offset, pool));
+      SVN_ERR(svn_io_file_read_full2(temp_file, context->read_ahead_buffer,
+                                     READ_AHEAD_SIZE,
+                                     &context->read_ahead_len, &eof, pool));
+
+      if (context->read_ahead_len < item->size)
+        return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                                 _("Unexpected end of temporary pack data "
+                                   "at offset %s"),
+                                 apr_off_t_toa(pool, item->offset));
+
+      context->read_ahead_file = temp_file;
+      context->read_ahead_offset = item->offset;
+    }
+
+  return svn_error_trace(svn_io_file_write_full(
+           context->pack_file,
+           context->read_ahead_buffer
+             + (apr_size_t)(item->offset - context->read_ahead_offset),
+           (apr_size_t)item->size, NULL, pool));
+}
+
 /* Read the contents of ITEM, if not empty, from TEMP_FILE and write it
  * to CONTEXT->PACK_FILE.  Use POOL for allocations.
  */
@@ -1153,9 +1234,7 @@ store_item(pack_context_t *context,
 
   /* select the item in the source file and copy it into the target
     * pack file */
-  SVN_ERR(svn_io_file_seek(temp_file, APR_SET, &item->offset, pool));
-  SVN_ERR(copy_file_data(context, context->pack_file, temp_file,
-                         item->size, pool));
+  SVN_ERR(copy_item_from_temp(context, temp_file, item, pool));
 
   /* write index entry and update current position */
   item->offset = context->pack_offset;
@@ -1781,20 +1860,27 @@ pack_phys_addressed(const char *pack_file_dir,
 
   /* Close stream over APR file. */
   SVN_ERR(svn_stream_close(manifest_stream));
+  SVN_ERR(svn_io_file_close(manifest_file, pool));
+  SVN_ERR(svn_io_file_close(pack_file, pool));
 
-  /* Ensure that pack file is written to disk. */
+  /* Ensure that manifest and pack file are written to disk.  Flush both
+   * of them concurrently. */
   if (flush_to_disk)
-    SVN_ERR(svn_io_file_flush_to_disk(manifest_file, pool));
-  SVN_ERR(svn_io_file_close(manifest_file, pool));
+    {
+      svn_batch_fsync__t *batch;
+
+      SVN_ERR(svn_batch_fsync__create(&batch, TRUE, iterpool));
+      SVN_ERR(svn_batch_fsync__open_file(&manifest_file, batch,
+                                         manifest_file_path,
+                                         iterpool));
+      SVN_ERR(svn_batch_fsync__open_file(&pack_file, batch,
+                                         pack_file_path, iterpool));
+      SVN_ERR(svn_batch_fsync__run(batch, iterpool));
+    }
 
   /* disallow write access to the manifest file */
   SVN_ERR(svn_io_set_file_read_only(manifest_file_path, FALSE, iterpool));
 
-  /* Ensure that pack file is written to disk. */
-  if (flush_to_disk)
-    SVN_ERR(svn_io_file_flush_to_disk(pack_file, pool));
-  SVN_ERR(svn_io_file_close(pack_file, pool));
-
   svn_pool_destroy(iterpool);
 
   return SVN_NO_ERROR;
@@ -1853,6 +1939,39 @@ pack_rev_shard(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
+/* Like pack_rev_shard() but also return the size of the resulting pack
+ * file in *BYTES and the time it took to create it in *DURATION.
+ */
+static svn_error_t *
+pack_rev_shard_timed(apr_off_t *bytes,
+                     apr_interval_time_t *duration,
+                     svn_fs_t *fs,
+                     const char *pack_file_dir,
+                     const char *shard_path,
+                     apr_int64_t shard,
+                     int max_files_per_dir,
+                     apr_size_t max_mem,
+                     svn_boolean_t flush_to_disk,
+                     svn_cancel_func_t cancel_func,
+                     void *cancel_baton,
+                     apr_pool_t *pool)
+{
+  apr_finfo_t finfo;
+  apr_time_t start = apr_time_now();
+
+  SVN_ERR(pack_rev_shard(fs, pack_file_dir, shard_path, shard,
+                         max_files_per_dir, max_mem, flush_to_disk,
+                         cancel_func, cancel_baton, pool));
+  *duration = apr_time_now() - start;
+
+  SVN_ERR(svn_io_stat(&finfo, svn_dirent_join(pack_file_dir, PATH_PACKED,
+                                              pool),
+                      APR_FINFO_SIZE, pool));
+  *bytes = finfo.size;
+
+  return SVN_NO_ERROR;
+}
+
 /* Baton struct used by pack_body(), pack_shard() and synced_pack_shard().
    These calls are nested and for every level additional fields will be
    available. */
@@ -1860,7 +1979,8 @@ struct pack_baton
 {
   /* Valid when entering pack_body(). */
   svn_fs_t *fs;
-  svn_fs_pack_notify_t notify_func;
+  int jobs;
+  svn_fs_pack_notify2_t notify_func;
   void *notify_baton;
   svn_cancel_func_t cancel_func;
   void *cancel_baton;
@@ -1957,40 +2077,40 @@ synced_pack_shard(void *baton,
   return SVN_NO_ERROR;
 }
 
-/* Pack the shard described by BATON.
- *
- * If for some reason we detect a partial packing already performed,
- * we remove the pack file and start again.
+/* Set the REV_SHARD_PATH in BATON and, if not NULL, return the directory
+ * that will contain the packed revision data of BATON->SHARD in
+ * *REV_PACK_FILE_DIR.  Allocate both in POOL.
  */
-static svn_error_t *
-pack_shard(struct pack_baton *baton,
-           apr_pool_t *pool)
+static void
+get_shard_paths(const char **rev_pack_file_dir,
+                struct pack_baton *baton,
+                apr_pool_t *pool)
 {
-  fs_fs_data_t *ffd = baton->fs->fsap_data;
-  const char *rev_pack_file_dir;
-
-  /* Notify caller we're starting to pack this shard. */
-  if (baton->notify_func)
-    SVN_ERR(baton->notify_func(baton->notify_baton, baton->shard,
-                               svn_fs_pack_notify_start, pool));
+  if (rev_pack_file_dir)
+    *rev_pack_file_dir = svn_dirent_join(baton->revs_dir,
+                    apr_psprintf(pool,
+                                 "%" APR_INT64_T_FMT PATH_EXT_PACKED_SHARD,
+                                 baton->shard),
+                    pool);
 
-  /* Some useful paths. */
-  rev_pack_file_dir = svn_dirent_join(baton->revs_dir,
-                  apr_psprintf(pool,
-                               "%" APR_INT64_T_FMT PATH_EXT_PACKED_SHARD,
-                               baton->shard),
-                  pool);
   baton->rev_shard_path = svn_dirent_join(baton->revs_dir,
                                           apr_psprintf(pool,
                                                        "%" APR_INT64_T_FMT,
                                                        baton->shard),
                                           pool);
+}
 
-  /* pack the revision content */
-  SVN_ERR(pack_rev_shard(baton->fs, rev_pack_file_dir, baton->rev_shard_path,
-                         baton->shard, ffd->max_files_per_dir,
-                         baton->max_mem, ffd->flush_to_disk,
-                         baton->cancel_func, baton->cancel_baton, pool));
+/* Switch the shard described by BATON over to the packed revision data
+ * that has already been written.  BYTES and DURATION are the statistics
+ * to report for it.
+ */
+static svn_error_t *
+commit_pack_shard(struct pack_baton *baton,
+                  apr_off_t bytes,
+                  apr_interval_time_t duration,
+                  apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = baton->fs->fsap_data;
 
   /* For newer repo formats, we only acquired the pack lock so far.
      Before modifying the repo state by switching over to the packed
@@ -2001,14 +2121,191 @@ pack_shard(struct pack_baton *baton,
   else
     SVN_ERR(synced_pack_shard(baton, pool));
 
+  /* Notify caller we're done packing this shard. */
+  if (baton->notify_func)
+    SVN_ERR(baton->notify_func(baton->notify_baton, baton->shard,
+                               svn_fs_pack_notify_end, bytes, duration,
+                               pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Pack the shard described by BATON.
+ *
+ * If for some reason we detect a partial packing already performed,
+ * we remove the pack file and start again.
+ */
+static svn_error_t *
+pack_shard(struct pack_baton *baton,
+           apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = baton->fs->fsap_data;
+  const char *rev_pack_file_dir;
+  apr_off_t bytes;
+  apr_interval_time_t duration;
+
   /* Notify caller we're starting to pack this shard. */
   if (baton->notify_func)
     SVN_ERR(baton->notify_func(baton->notify_baton, baton->shard,
-                               svn_fs_pack_notify_end, pool));
+                               svn_fs_pack_notify_start, 0, 0, pool));
+
+  /* Some useful paths. */
+  get_shard_paths(&rev_pack_file_dir, baton, pool);
+
+  /* pack the revision content */
+  SVN_ERR(pack_rev_shard_timed(&bytes, &duration, baton->fs,
+                               rev_pack_file_dir, baton->rev_shard_path,
+                               baton->shard, ffd->max_files_per_dir,
+                               baton->max_mem, ffd->flush_to_disk,
+                               baton->cancel_func, baton->cancel_baton,
+                               pool));
+
+  return svn_error_trace(commit_pack_shard(baton, bytes, duration, pool));
+}
 
+#if APR_HAS_THREADS
+
+/* Size of a pack file and the time it took to create it. */
+typedef struct packed_shard_t
+{
+  apr_off_t bytes;
+  apr_interval_time_t duration;
+} packed_shard_t;
+
+/* Per-thread data. */
+typedef struct pack_worker_t
+{
+  /* Parameters as passed to pack_body().  Workers must not use the
+   * FS object nor the notification callback in it. */
+  struct pack_baton *pb;
+
+  /* Private clone of PB->FS. */
+  svn_fs_t *fs;
+} pack_worker_t;
+
+/* Create the pack_worker_t for a worker thread in THREAD_POOL and return
+ * it in *THREAD_BATON.  BATON is the struct pack_baton *.
+ * Implements svn_ordered_loop__init_t. */
+static svn_error_t *
+init_pack_worker(void **thread_baton,
+                 void *baton,
+                 apr_pool_t *thread_pool,
+                 apr_pool_t *scratch_pool)
+{
+  pack_worker_t *worker = apr_pcalloc(thread_pool, sizeof(*worker));
+  worker->pb = baton;
+
+  /* FS objects must not be shared between threads. */
+  SVN_ERR(svn_fs_fs__open_clone(&worker->fs, worker->pb->fs, thread_pool,
+                                scratch_pool));
+
+  *thread_baton = worker;
   return SVN_NO_ERROR;
 }
 
+/* Pack the revision data of SHARD using the pack_worker_t in THREAD_BATON
+ * and return a packed_shard_t allocated in RESULT_POOL in *RESULT.
+ * Implements svn_ordered_loop__task_t. */
+static svn_error_t *
+pack_shard_task(void **result,
+                void *thread_baton,
+                apr_int64_t shard,
+                apr_pool_t *result_pool,
+                apr_pool_t *scratch_pool)
+{
+  pack_worker_t *worker = thread_baton;
+  struct pack_baton *pb = worker->pb;
+  fs_fs_data_t *ffd = worker->fs->fsap_data;
+  packed_shard_t *packed = apr_pcalloc(result_pool, sizeof(*packed));
+  const char *pack_file_dir;
+  const char *shard_path;
+
+  *result = packed;
+  pack_file_dir = svn_dirent_join(pb->revs_dir,
+                    apr_psprintf(scratch_pool,
+                                 "%" APR_INT64_T_FMT PATH_EXT_PACKED_SHARD,
+                                 shard),
+                    scratch_pool);
+  shard_path = svn_dirent_join(pb->revs_dir,
+                               apr_psprintf(scratch_pool, "%" APR_INT64_T_FMT,
+                                            shard),
+                               scratch_pool);
+
+  return svn_error_trace(pack_rev_shard_timed(&packed->bytes,
+                                              &packed->duration, worker->fs,
+                                              pack_file_dir, shard_path,
+                                              shard, ffd->max_files_per_dir,
+                                              pb->max_mem, ffd->flush_to_disk,
+                                              pb->cancel_func,
+                                              pb->cancel_baton,
+                                              scratch_pool));
+}
+
+/* Send the start notification for SHARD, then commit the pack file
+ * described by RESULT and send the end notification.  BATON is the
+ * struct pack_baton *.  PACK_ERR is the result of packing the shard.
+ * Implements svn_ordered_loop__result_t. */
+static svn_error_t *
+commit_shard_task(void *baton,
+                  apr_int64_t shard,
+                  void *result,
+                  svn_error_t *pack_err,
+                  apr_pool_t *scratch_pool)
+{
+  struct pack_baton *pb = baton;
+  packed_shard_t *packed = result;
+
+  svn_error_t *err = SVN_NO_ERROR;
+
+  pb->shard = shard;
+
+  if (pb->cancel_func)
+    err = pb->cancel_func(pb->cancel_baton);
+
+  /* The worker has already written the pack file at this point.  Sending
+     the start notification only now keeps start and end of each shard
+     adjacent and in order, as documented for svn_fs_pack2(). */
+  if (!err && pb->notify_func)
+    err = pb->notify_func(pb->notify_baton, shard, svn_fs_pack_notify_start,
+                          0, 0, scratch_pool);
+
+  if (err)
+    {
+      svn_error_clear(pack_err);
+      return svn_error_trace(err);
+    }
+
+  SVN_ERR(pack_err);
+
+  get_shard_paths(NULL, pb, scratch_pool);
+  return svn_error_trace(commit_pack_shard(pb, packed->bytes,
+                                           packed->duration, scratch_pool));
+}
+
+/* Like calling pack_shard() for all shards from PB->SHARD up to but not
+ * including END_SHARD, but pack the revision data of up to PB->JOBS
+ * shards concurrently in worker threads.  The packed shards will still
+ * be committed and notified in order from the calling thread, which holds
+ * the pack lock.  Uncommitted pack files will be removed and re-created
+ * by the next pack run.  Use POOL for allocations.
+ */
+static svn_error_t *
+pack_shards_parallel(struct pack_baton *pb,
+                     apr_int64_t end_shard,
+                     apr_pool_t *pool)
+{
+  /* Limit the number of pack files waiting to be committed to one per
+     worker. */
+  return svn_error_trace(svn_ordered_loop__run(pb->shard, end_shard,
+                                               pb->jobs, pb->jobs,
+                                               init_pack_worker,
+                                               pack_shard_task,
+                                               commit_shard_task, pb,
+                                               pool));
+}
+
+#endif /* APR_HAS_THREADS */
+
 /* Read the youngest rev and the first non-packed rev info for FS from disk.
    Set *FULLY_PACKED when there is no completed unpacked shard.
    Use SCRATCH_POOL for temporary allocations.
@@ -2069,7 +2366,7 @@ pack_body(void *baton,
       if (pb->notify_func)
         (*pb->notify_func)(pb->notify_baton,
                            ffd->min_unpacked_rev / ffd->max_files_per_dir,
-                           svn_fs_pack_notify_noop, pool);
+                           svn_fs_pack_notify_noop, 0, 0, pool);
 
       return SVN_NO_ERROR;
     }
@@ -2080,10 +2377,15 @@ pack_body(void *baton,
     pb->revsprops_dir = svn_dirent_join(pb->fs->path, PATH_REVPROPS_DIR,
                                         pool);
 
+  pb->shard = ffd->min_unpacked_rev / ffd->max_files_per_dir;
+
+#if APR_HAS_THREADS
+  if (pb->jobs > 1 && completed_shards - pb->shard > 1)
+    return svn_error_trace(pack_shards_parallel(pb, completed_shards, pool));
+#endif
+
   iterpool = svn_pool_create(pool);
-  for (pb->shard = ffd->min_unpacked_rev / ffd->max_files_per_dir;
-       pb->shard < completed_shards;
-       pb->shard++)
+  for (; pb->shard < completed_shards; pb->shard++)
     {
       svn_pool_clear(iterpool);
 
@@ -2100,7 +2402,8 @@ pack_body(void *baton,
 svn_error_t *
 svn_fs_fs__pack(svn_fs_t *fs,
                 apr_size_t max_mem,
-                svn_fs_pack_notify_t notify_func,
+                int jobs,
+                svn_fs_pack_notify2_t notify_func,
                 void *notify_baton,
                 svn_cancel_func_t cancel_func,
                 void *cancel_baton,
@@ -2122,7 +2425,8 @@ svn_fs_fs__pack(svn_fs_t *fs,
   if (!ffd->max_files_per_dir)
     {
       if (notify_func)
-        (*notify_func)(notify_baton, -1, svn_fs_pack_notify_noop, pool);
+        (*notify_func)(notify_baton, -1, svn_fs_pack_notify_noop, 0, 0,
+                       pool);
 
       return SVN_NO_ERROR;
     }
@@ -2134,13 +2438,14 @@ svn_fs_fs__pack(svn_fs_t *fs,
       if (notify_func)
         (*notify_func)(notify_baton,
                        ffd->min_unpacked_rev / ffd->max_files_per_dir,
-                       svn_fs_pack_notify_noop, pool);
+                       svn_fs_pack_notify_noop, 0, 0, pool);
 
       return SVN_NO_ERROR;
     }
 
   /* Lock the repo and start the pack process. */
   pb.fs = fs;
+  pb.jobs = jobs;
   pb.notify_func = notify_func;
   pb.notify_baton = notify_baton;
   pb.cancel_func = cancel_func;
@@ -32,14 +32,21 @@
    MAX_MEM limits the size of in-memory data structures needed for reordering
    items in format 7 repositories.  0 means use the built-in default.
 
+   If JOBS is larger than 1 and APR supports threads, pack the revision
+   data of up to JOBS shards concurrently.  MAX_MEM applies to each of
+   them.  The packed shards will still be switched over and notified in
+   order by the calling thread.
+
    If given, NOTIFY_FUNC will be called with NOTIFY_BATON to report progress.
-   Use optional CANCEL_FUNC/CANCEL_BATON for cancellation support.
+   Use optional CANCEL_FUNC/CANCEL_BATON for cancellation support.  The
+   latter may be called from multiple threads concurrently.
 
    Existing filesystem references need not change.  */
 svn_error_t *
 svn_fs_fs__pack(svn_fs_t *fs,
                 apr_size_t max_mem,
-                svn_fs_pack_notify_t notify_func,
+                int jobs,
+                svn_fs_pack_notify2_t notify_func,
                 void *notify_baton,
                 svn_cancel_func_t cancel_func,
                 void *cancel_baton,
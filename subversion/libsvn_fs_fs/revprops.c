@@ -1281,6 +1281,10 @@ svn_fs_fs__packed_revprop_available(svn_boolean_t *missing,
 
 /****** Packing FSFS shards *********/
 
+/* Number of revprop pack files that we flush to disk in one batch.  This
+ * limits the number of file handles kept open at the same time. */
+#define MAX_BATCHED_PACK_FILES 64
+
 svn_error_t *
 svn_fs_fs__copy_revprops(const char *pack_file_dir,
                          const char *pack_filename,
@@ -1290,7 +1294,7 @@ svn_fs_fs__copy_revprops(const char *pack_file_dir,
                          apr_array_header_t *sizes,
                          apr_size_t total_size,
                          int compression_level,
-                         svn_boolean_t flush_to_disk,
+                         svn_batch_fsync__t *batch,
                          svn_cancel_func_t cancel_func,
                          void *cancel_baton,
                          apr_pool_t *scratch_pool)
@@ -1311,12 +1315,12 @@ svn_fs_fs__copy_revprops(const char *pack_file_dir,
   SVN_ERR(serialize_revprops_header(pack_stream, start_rev, sizes, 0,
                                     sizes->nelts, iterpool));
 
-  /* Some useful paths. */
-  SVN_ERR(svn_io_file_open(&pack_file, svn_dirent_join(pack_file_dir,
-                                                       pack_filename,
-                                                       scratch_pool),
-                           APR_WRITE | APR_CREATE, APR_OS_DEFAULT,
-                           scratch_pool));
+  /* Create the pack file.  BATCH owns the file handle. */
+  SVN_ERR(svn_batch_fsync__open_file(&pack_file, batch,
+                                     svn_dirent_join(pack_file_dir,
+                                                     pack_filename,
+                                                     scratch_pool),
+                                     scratch_pool));
 
   /* Iterate over the revisions in this shard, squashing them together. */
   for (rev = start_rev; rev <= end_rev; rev++)
@@ -1351,9 +1355,6 @@ svn_fs_fs__copy_revprops(const char *pack_file_dir,
   /* write the pack file content to disk */
   SVN_ERR(svn_io_file_write_full(pack_file, compressed->data, compressed->len,
                                  NULL, scratch_pool));
-  if (flush_to_disk)
-    SVN_ERR(svn_io_file_flush_to_disk(pack_file, scratch_pool));
-  SVN_ERR(svn_io_file_close(pack_file, scratch_pool));
 
   svn_pool_destroy(iterpool);
 
@@ -1374,11 +1375,14 @@ svn_fs_fs__pack_revprops_shard(const char *pack_file_dir,
 {
   const char *manifest_file_path, *pack_filename = NULL;
   apr_file_t *manifest_file;
+  svn_stringbuf_t *manifest;
   svn_stream_t *manifest_stream;
   svn_revnum_t start_rev, end_rev, rev;
   apr_size_t total_size;
   apr_pool_t *iterpool = svn_pool_create(scratch_pool);
   apr_array_header_t *sizes;
+  svn_batch_fsync__t *batch;
+  int batched_files = 0;
 
   /* Sanitize config file values. */
   apr_size_t max_size = (apr_size_t)MIN(MAX(max_pack_size, 1),
@@ -1395,11 +1399,13 @@ svn_fs_fs__pack_revprops_shard(const char *pack_file_dir,
   /* Create the new directory and manifest file stream. */
   SVN_ERR(svn_io_dir_make(pack_file_dir, APR_OS_DEFAULT, scratch_pool));
 
-  SVN_ERR(svn_io_file_open(&manifest_file, manifest_file_path,
-                           APR_WRITE | APR_BUFFERED | APR_CREATE | APR_EXCL,
-                           APR_OS_DEFAULT, scratch_pool));
-  manifest_stream = svn_stream_from_aprfile2(manifest_file, TRUE,
-                                             scratch_pool);
+  /* All files get flushed to disk through this instance such that the
+   * fsyncs of the individual pack files overlap.  The manifest is small;
+   * collect it in memory and write it at the end. */
+  SVN_ERR(svn_batch_fsync__create(&batch, flush_to_disk,
+                                  scratch_pool));
+  manifest = svn_stringbuf_create_empty(scratch_pool);
+  manifest_stream = svn_stream_from_stringbuf(manifest, scratch_pool);
 
   /* revisions to handle. Special case: revision 0 */
   start_rev = (svn_revnum_t) (shard * max_files_per_dir);
@@ -1439,10 +1445,17 @@ svn_fs_fs__pack_revprops_shard(const char *pack_file_dir,
           SVN_ERR(svn_fs_fs__copy_revprops(pack_file_dir, pack_filename,
                                            shard_path, start_rev, rev-1,
                                            sizes, total_size,
-                                           compression_level, flush_to_disk,
+                                           compression_level, batch,
                                            cancel_func, cancel_baton,
                                            iterpool));
 
+          /* Don't accumulate too many open pack files. */
+          if (++batched_files == MAX_BATCHED_PACK_FILES)
+            {
+              SVN_ERR(svn_batch_fsync__run(batch, iterpool));
+              batched_files = 0;
+            }
+
           /* next pack file starts empty again */
           apr_array_clear(sizes);
           total_size = 2 * SVN_INT64_BUFFER_SIZE;
@@ -1467,14 +1480,17 @@ svn_fs_fs__pack_revprops_shard(const char *pack_file_dir,
     SVN_ERR(svn_fs_fs__copy_revprops(pack_file_dir, pack_filename,
                                      shard_path, start_rev, rev-1,
                                      sizes, (apr_size_t)total_size,
-                                     compression_level, flush_to_disk,
+                                     compression_level, batch,
                                      cancel_func, cancel_baton, iterpool));
 
-  /* flush the manifest file to disk and update permissions */
+  /* write the manifest file, flush all remaining files to disk and
+   * update permissions */
   SVN_ERR(svn_stream_close(manifest_stream));
-  if (flush_to_disk)
-    SVN_ERR(svn_io_file_flush_to_disk(manifest_file, iterpool));
-  SVN_ERR(svn_io_file_close(manifest_file, iterpool));
+  SVN_ERR(svn_batch_fsync__open_file(&manifest_file, batch,
+                                     manifest_file_path, iterpool));
+  SVN_ERR(svn_io_file_write_full(manifest_file, manifest->data,
+                                 manifest->len, NULL, iterpool));
+  SVN_ERR(svn_batch_fsync__run(batch, iterpool));
   SVN_ERR(svn_io_copy_perms(shard_path, pack_file_dir, iterpool));
 
   svn_pool_destroy(iterpool);
@@ -32,6 +32,7 @@
 #include "svn_time.h"
 #include "svn_dirent_uri.h"
 
+#include "private/svn_batch_fsync.h"
 #include "fs_fs.h"
 #include "index.h"
 #include "tree.h"
@@ -44,11 +45,13 @@
 #include "rep-cache.h"
 
 #include "private/svn_fs_util.h"
+#include "private/svn_delta_private.h"
 #include "private/svn_fspath.h"
 #include "private/svn_sorts_private.h"
 #include "private/svn_subr_private.h"
 #include "private/svn_string_private.h"
 #include "../libsvn_fs/fs-loader.h"
+#include "../libsvn_delta/delta.h"  /* for SVN_DELTA_WINDOW_SIZE */
 
 #include "svn_private_config.h"
 
@@ -1531,6 +1534,33 @@ reset_txn_in_rep(representation_t *rep)
   svn_fs_fs__id_txn_reset(&rep->txn_id);
 }
 
+/* If REP has been written in a transaction of FS, no other node revision
+   can share it and its contents reside in a large rep file, remove that
+   file.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+remove_unshared_large_rep(svn_fs_t *fs,
+                          const representation_t *rep,
+                          apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  if (   !rep
+      || !is_txn_rep(rep)
+      || !SVN_FS_FS__REP_IS_LARGE(rep)
+      || ffd->format < SVN_FS_FS__MIN_LARGE_REP_FORMAT)
+    return SVN_NO_ERROR;
+
+  /* Other node revisions in the same txn may have picked up REP through
+     its SHA1 mapping.  move_large_reps_into_place will drop the file at
+     commit time if it turns out to be unused. */
+  if (ffd->rep_sharing_allowed && rep->has_sha1)
+    return SVN_NO_ERROR;
+
+  return svn_error_trace(svn_io_remove_file2(
+                           svn_fs_fs__path_large_rep(fs, rep, scratch_pool),
+                           TRUE, scratch_pool));
+}
+
 svn_error_t *
 svn_fs_fs__set_entry(svn_fs_t *fs,
                      const svn_fs_fs__id_part_t *txn_id,
@@ -1941,6 +1971,13 @@ struct rep_write_baton
   /* calculate a modified FNV-1a checksum of the on-disk representation */
   svn_checksum_ctx_t *fnv1a_checksum_ctx;
 
+  /* If not NULL, the fulltext also gets written to this temporary file
+     because the rep might turn out to be a large rep. */
+  svn_stream_t *large_stream;
+
+  /* Fulltexts of at least this size become large reps. */
+  svn_filesize_t large_threshold;
+
   /* Local / scratch pool, available for temporary allocations. */
   apr_pool_t *scratch_pool;
 
@@ -1962,6 +1999,15 @@ rep_write_contents(void *baton,
   SVN_ERR(svn_checksum_update(b->sha1_checksum_ctx, data, *len));
   b->rep_size += *len;
 
+  /* Keep a copy of the fulltext.  Once we know that this is going to be
+     a large rep, there is no point in deltifying the rest of it. */
+  if (b->large_stream)
+    {
+      SVN_ERR(svn_stream_write(b->large_stream, data, len));
+      if (b->rep_size >= b->large_threshold)
+        return SVN_NO_ERROR;
+    }
+
   /* If we are writing a delta, use that stream. */
   if (b->delta_stream)
     return svn_stream_write(b->delta_stream, data, len);
@@ -2102,6 +2148,14 @@ choose_delta_base(representation_t **rep,
           return SVN_NO_ERROR;
         }
 
+      /* Large reps are stored out-of-line to keep them out of delta
+       * chains, which includes not being used as delta bases. */
+      if (SVN_FS_FS__REP_IS_LARGE(*rep))
+        {
+          *rep = NULL;
+          return SVN_NO_ERROR;
+        }
+
       /* Check whether the length of the deltification chain is acceptable.
        * Otherwise, shared reps may form a non-skipping delta chain in
        * extreme cases. */
@@ -2141,6 +2195,14 @@ rep_write_cleanup(void *data)
   err = svn_error_compose_create(err, svn_io_file_close(b->file,
                                                         b->scratch_pool));
 
+  /* Get rid of the fulltext copy, if any. */
+  if (b->large_stream)
+    err = svn_error_compose_create(err,
+            svn_io_remove_file2(svn_fs_fs__path_txn_large_tmp(b->fs,
+                                  svn_fs_fs__id_txn_id(b->noderev->id),
+                                  b->scratch_pool),
+                                TRUE, b->scratch_pool));
+
   /* Remove our lock regardless of any preceding errors so that the
      being_written flag is always removed and stays consistent with the
      file lock which will be removed no matter what since the pool is
@@ -2159,6 +2221,52 @@ rep_write_cleanup(void *data)
   return APR_SUCCESS;
 }
 
+/* Set *WH and *WHB to a txdelta window handler that writes svndiff data
+   to OUTPUT, using the svndiff version and compression settings selected
+   for new representations in filesystem FS.  Allocate it in POOL. */
+static void
+txdelta_to_svndiff(svn_txdelta_window_handler_t *wh,
+                   void **whb,
+                   svn_stream_t *output,
+                   svn_fs_t *fs,
+                   apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  int svndiff_version;
+  int compression_level;
+
+  if (ffd->delta_window_size > SVN_DELTA_WINDOW_SIZE)
+    {
+      /* Only svndiff3 allows for windows of that size.  It always uses
+         LZ4 for compression. */
+      SVN_ERR_ASSERT_NO_RETURN(ffd->format >= SVN_FS_FS__MIN_SVNDIFF3_FORMAT);
+      svndiff_version = 3;
+      compression_level
+        = ffd->delta_compression_type == compression_type_none
+        ? SVN_DELTA_COMPRESSION_LEVEL_NONE
+        : SVN_DELTA_COMPRESSION_LEVEL_DEFAULT;
+    }
+  else if (ffd->delta_compression_type == compression_type_lz4)
+    {
+      SVN_ERR_ASSERT_NO_RETURN(ffd->format >= SVN_FS_FS__MIN_SVNDIFF2_FORMAT);
+      svndiff_version = 2;
+      compression_level = SVN_DELTA_COMPRESSION_LEVEL_DEFAULT;
+    }
+  else if (ffd->format >= SVN_FS_FS__MIN_SVNDIFF1_FORMAT)
+    {
+      svndiff_version = 1;
+      compression_level = ffd->delta_compression_level;
+    }
+  else
+    {
+      svndiff_version = 0;
+      compression_level = SVN_DELTA_COMPRESSION_LEVEL_NONE;
+    }
+
+  svn_txdelta_to_svndiff3(wh, whb, output, svndiff_version,
+                          compression_level, pool);
+}
+
 /* Get a rep_write_baton and store it in *WB_P for the representation
    indicated by NODEREV in filesystem FS.  Perform allocations in
    POOL.  Only appropriate for file contents, not for props or
@@ -2169,14 +2277,13 @@ rep_write_get_baton(struct rep_write_baton **wb_p,
                     node_revision_t *noderev,
                     apr_pool_t *pool)
 {
+  fs_fs_data_t *ffd = fs->fsap_data;
   struct rep_write_baton *b;
   apr_file_t *file;
   representation_t *base_rep;
   svn_stream_t *source;
   svn_txdelta_window_handler_t wh;
   void *whb;
-  fs_fs_data_t *ffd = fs->fsap_data;
-  int diff_version = ffd->format >= SVN_FS_FS__MIN_SVNDIFF1_FORMAT ? 1 : 0;
   svn_fs_fs__rep_header_t header = { 0 };
 
   b = apr_pcalloc(pool, sizeof(*b));
@@ -2227,20 +2334,38 @@ rep_write_get_baton(struct rep_write_baton **wb_p,
   SVN_ERR(svn_io_file_get_offset(&b->delta_start, file,
                                  b->scratch_pool));
 
+  /* We don't know the size of the contents, yet.  So, if large reps are
+     enabled, keep a copy of the fulltext in case it reaches the limit. */
+  if (ffd->large_file_threshold)
+    {
+      apr_file_t *large_file;
+      const char *large_path
+        = svn_fs_fs__path_txn_large_tmp(fs, svn_fs_fs__id_txn_id(noderev->id),
+                                        b->scratch_pool);
+
+      SVN_ERR(svn_io_file_open(&large_file, large_path,
+                               APR_WRITE | APR_CREATE | APR_TRUNCATE
+                               | APR_BUFFERED,
+                               APR_OS_DEFAULT, b->scratch_pool));
+      b->large_stream = svn_stream_from_aprfile2(large_file, FALSE,
+                                                 b->scratch_pool);
+      b->large_threshold = ffd->large_file_threshold;
+    }
+
   /* Cleanup in case something goes wrong. */
   apr_pool_cleanup_register(b->scratch_pool, b, rep_write_cleanup,
                             apr_pool_cleanup_null);
 
   /* Prepare to write the svndiff data. */
-  svn_txdelta_to_svndiff3(&wh,
-                          &whb,
-                          b->rep_stream,
-                          diff_version,
-                          ffd->delta_compression_level,
-                          pool);
+  txdelta_to_svndiff(&wh, &whb, b->rep_stream, fs, pool);
 
-  b->delta_stream = svn_txdelta_target_push(wh, whb, source,
-                                            b->scratch_pool);
+  /* Large windows get stored as svndiff3, whose readers allow the
+     source view to slide along the data actually matched. */
+  b->delta_stream = svn_txdelta__target_push(wh, whb, source,
+                                             ffd->delta_window_size,
+                                             ffd->delta_window_size
+                                               > SVN_DELTA_WINDOW_SIZE,
+                                             b->scratch_pool);
 
   *wb_p = b;
 
@@ -2422,8 +2547,20 @@ get_shared_rep(representation_t **old_rep,
       /* Compare the two representations.
        * Note that the stream comparison might also produce MD5 checksum
        * errors or other failures in case of SHA1 collisions. */
-      SVN_ERR(svn_fs_fs__get_contents_from_file(&contents, fs, rep, file,
-                                                offset, scratch_pool));
+      if (SVN_FS_FS__REP_IS_LARGE(rep) && is_txn_rep(rep))
+        {
+          /* The fulltext has not been moved to its final location, yet. */
+          const char *large_path
+            = svn_fs_fs__path_txn_large_tmp(fs, &rep->txn_id, scratch_pool);
+          SVN_ERR(svn_stream_open_readonly(&contents, large_path,
+                                           scratch_pool, scratch_pool));
+        }
+      else
+        {
+          SVN_ERR(svn_fs_fs__get_contents_from_file(&contents, fs, rep,
+                                                    file, offset,
+                                                    scratch_pool));
+        }
       SVN_ERR(svn_fs_fs__get_contents(&old_contents, fs, &old_rep_norm,
                                       FALSE, scratch_pool));
       err = svn_stream_contents_same2(&same, contents, old_contents,
@@ -2485,6 +2622,33 @@ digests_final(representation_t *rep,
   return SVN_NO_ERROR;
 }
 
+/* Replace the representation being written by B with an empty PLAIN rep
+   in the proto-rev file.  The actual contents already reside in the large
+   rep's temporary fulltext file.  Afterwards, B's on-disk rep size will
+   be 0, marking it as a large rep. */
+static svn_error_t *
+write_large_rep_placeholder(struct rep_write_baton *b)
+{
+  svn_fs_fs__rep_header_t header = { 0 };
+
+  /* Drop the (partial) delta data written so far. */
+  SVN_ERR(svn_io_file_trunc(b->file, b->rep_offset, b->scratch_pool));
+
+  /* Restart the on-disk checksum for the new rep header. */
+  b->rep_stream = svn_stream_from_aprfile2(b->file, TRUE, b->scratch_pool);
+  if (svn_fs_fs__use_log_addressing(b->fs))
+    b->rep_stream = fnv1a_wrap_stream(&b->fnv1a_checksum_ctx, b->rep_stream,
+                                      b->scratch_pool);
+
+  header.type = svn_fs_fs__rep_plain;
+  SVN_ERR(svn_fs_fs__write_rep_header(&header, b->rep_stream,
+                                      b->scratch_pool));
+  SVN_ERR(svn_io_file_get_offset(&b->delta_start, b->file,
+                                 b->scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* Close handler for the representation write stream.  BATON is a
    rep_write_baton.  Writes out a new node-rev that correctly
    references the representation we just finished writing. */
@@ -2494,13 +2658,28 @@ rep_write_contents_close(void *baton)
   struct rep_write_baton *b = baton;
   representation_t *rep;
   representation_t *old_rep;
+  representation_t *old_data_rep = b->noderev->data_rep;
   apr_off_t offset;
+  const char *large_path = NULL;
+  svn_boolean_t is_large = b->large_stream
+                        && b->rep_size >= b->large_threshold;
 
   rep = apr_pcalloc(b->result_pool, sizeof(*rep));
 
-  /* Close our delta stream so the last bits of svndiff are written
-     out. */
-  if (b->delta_stream)
+  if (b->large_stream)
+    {
+      SVN_ERR(svn_stream_close(b->large_stream));
+      large_path = svn_fs_fs__path_txn_large_tmp(b->fs,
+                                      svn_fs_fs__id_txn_id(b->noderev->id),
+                                      b->scratch_pool);
+    }
+
+  /* Large reps only leave a placeholder in the proto-rev file.
+     Otherwise, close our delta stream so the last bits of svndiff are
+     written out. */
+  if (is_large)
+    SVN_ERR(write_large_rep_placeholder(b));
+  else if (b->delta_stream)
     SVN_ERR(svn_stream_close(b->delta_stream));
 
   /* Determine the length of the svndiff data. */
@@ -2537,9 +2716,31 @@ rep_write_contents_close(void *baton)
       SVN_ERR(allocate_item_index(&rep->item_index, b->fs, &rep->txn_id,
                                   b->rep_offset, b->scratch_pool));
 
+      /* The fulltext file now becomes the contents of REP. */
+      if (is_large)
+        {
+          SVN_ERR(svn_io_file_rename2(large_path,
+                                      svn_fs_fs__path_large_rep(b->fs, rep,
+                                                          b->scratch_pool),
+                                      FALSE, b->scratch_pool));
+          large_path = NULL;
+        }
+
       b->noderev->data_rep = rep;
     }
 
+  /* Remove the fulltext copy if we didn't need it. */
+  if (large_path)
+    SVN_ERR(svn_io_remove_file2(large_path, FALSE, b->scratch_pool));
+
+  /* The previous contents of this txn node have been superseded. */
+  if (   old_data_rep
+      && (   !svn_fs_fs__id_part_eq(&old_data_rep->txn_id,
+                                    &b->noderev->data_rep->txn_id)
+          || old_data_rep->item_index != b->noderev->data_rep->item_index))
+    SVN_ERR(remove_unshared_large_rep(b->fs, old_data_rep,
+                                      b->scratch_pool));
+
   /* Remove cleanup callback. */
   apr_pool_cleanup_kill(b->scratch_pool, b, rep_write_cleanup);
 
@@ -2876,6 +3077,7 @@ write_container_delta_rep(representation_t *rep,
                           apr_uint32_t item_type,
                           apr_pool_t *scratch_pool)
 {
+  fs_fs_data_t *ffd = fs->fsap_data;
   svn_txdelta_window_handler_t diff_wh;
   void *diff_whb;
 
@@ -2891,8 +3093,6 @@ write_container_delta_rep(representation_t *rep,
   apr_off_t offset = 0;
 
   struct write_container_baton *whb;
-  fs_fs_data_t *ffd = fs->fsap_data;
-  int diff_version = ffd->format >= SVN_FS_FS__MIN_SVNDIFF1_FORMAT ? 1 : 0;
   svn_boolean_t is_props = (item_type == SVN_FS_FS__ITEM_TYPE_FILE_PROPS)
                         || (item_type == SVN_FS_FS__ITEM_TYPE_DIR_PROPS);
 
@@ -2925,16 +3125,14 @@ write_container_delta_rep(representation_t *rep,
   SVN_ERR(svn_io_file_get_offset(&delta_start, file, scratch_pool));
 
   /* Prepare to write the svndiff data. */
-  svn_txdelta_to_svndiff3(&diff_wh,
-                          &diff_whb,
-                          file_stream,
-                          diff_version,
-                          ffd->delta_compression_level,
-                          scratch_pool);
+  txdelta_to_svndiff(&diff_wh, &diff_whb, file_stream, fs, scratch_pool);
 
   whb = apr_pcalloc(scratch_pool, sizeof(*whb));
-  whb->stream = svn_txdelta_target_push(diff_wh, diff_whb, source,
-                                        scratch_pool);
+  whb->stream = svn_txdelta__target_push(diff_wh, diff_whb, source,
+                                         ffd->delta_window_size,
+                                         ffd->delta_window_size
+                                           > SVN_DELTA_WINDOW_SIZE,
+                                         scratch_pool);
   whb->size = 0;
   whb->md5_ctx = svn_checksum_ctx_create(svn_checksum_md5, scratch_pool);
   if (item_type != SVN_FS_FS__ITEM_TYPE_DIR_REP)
@@ -3559,14 +3757,16 @@ verify_locks(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
-/* Writes final revision properties to file PATH applying permissions
-   from file PERMS_REFERENCE. This involves setting svn:date and
-   removing any temporary properties associated with the commit flags. */
+/* Writes final revision properties to file PATH and schedule its fsync
+   in BATCH.  This involves setting svn:date and removing any temporary
+   properties associated with the commit flags.
+
+   Note that the file remains open and writable until BATCH has been run,
+   i.e. the caller should copy the final permissions only after that. */
 static svn_error_t *
 write_final_revprop(const char *path,
-                    const char *perms_reference,
                     svn_fs_txn_t *txn,
-                    svn_boolean_t flush_to_disk,
+                    svn_batch_fsync__t *batch,
                     apr_pool_t *pool)
 {
   apr_hash_t *txnprops;
@@ -3574,6 +3774,7 @@ write_final_revprop(const char *path,
   svn_string_t *client_date;
   apr_file_t *revprop_file;
   svn_stream_t *stream;
+  apr_off_t offset;
 
   SVN_ERR(svn_fs_fs__txn_proplist(&txnprops, txn, pool));
 
@@ -3596,21 +3797,18 @@ write_final_revprop(const char *path,
       svn_hash_sets(txnprops, SVN_PROP_REVISION_DATE, &date);
     }
 
-  /* Create new revprops file. Tell OS to truncate existing file,
-     since  file may already exists from failed transaction. */
-  SVN_ERR(svn_io_file_open(&revprop_file, path,
-                           APR_WRITE | APR_CREATE | APR_TRUNCATE
-                           | APR_BUFFERED, APR_OS_DEFAULT, pool));
+  /* Create new revprops file.  BATCH owns the file handle. */
+  SVN_ERR(svn_batch_fsync__open_file(&revprop_file, batch, path,
+                                     pool));
 
   stream = svn_stream_from_aprfile2(revprop_file, TRUE, pool);
   SVN_ERR(svn_hash_write2(txnprops, stream, SVN_HASH_TERMINATOR, pool));
   SVN_ERR(svn_stream_close(stream));
 
-  if (flush_to_disk)
-    SVN_ERR(svn_io_file_flush_to_disk(revprop_file, pool));
-  SVN_ERR(svn_io_file_close(revprop_file, pool));
-
-  SVN_ERR(svn_io_copy_perms(perms_reference, path, pool));
+  /* The file may already exist from a failed transaction.  Truncate any
+     old contents beyond what we just wrote. */
+  SVN_ERR(svn_io_file_get_offset(&offset, revprop_file, pool));
+  SVN_ERR(svn_io_file_trunc(revprop_file, offset, pool));
 
   return SVN_NO_ERROR;
 }
@@ -3691,6 +3889,102 @@ promote_cached_directories(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
+/* Move the fulltext files of all large reps written in transaction TXN_ID
+   of FS to their final location as part of revision NEW_REV.  Schedule
+   the necessary fsyncs in BATCH.
+
+   If REPS_TO_CACHE is not NULL, it lists all reps that revision NEW_REV
+   introduces.  Remove any fulltext file of a rep not in that list, e.g.
+   because its contents have been replaced within the transaction.
+
+   Use POOL for temporary allocations. */
+static svn_error_t *
+move_large_reps_into_place(svn_fs_t *fs,
+                           const svn_fs_fs__id_part_t *txn_id,
+                           svn_revnum_t new_rev,
+                           const apr_array_header_t *reps_to_cache,
+                           svn_batch_fsync__t *batch,
+                           apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_hash_t *dirents;
+  apr_hash_t *used_items = NULL;
+  apr_hash_index_t *hi;
+  const char *txn_dir = svn_fs_fs__path_txn_dir(fs, txn_id, pool);
+  svn_boolean_t shard_created = FALSE;
+  apr_pool_t *iterpool;
+  int i;
+
+  if (ffd->format < SVN_FS_FS__MIN_LARGE_REP_FORMAT)
+    return SVN_NO_ERROR;
+
+  if (reps_to_cache)
+    {
+      used_items = apr_hash_make(pool);
+      for (i = 0; i < reps_to_cache->nelts; ++i)
+        {
+          const representation_t *rep
+            = APR_ARRAY_IDX(reps_to_cache, i, const representation_t *);
+
+          if (SVN_FS_FS__REP_IS_LARGE(rep))
+            apr_hash_set(used_items, &rep->item_index,
+                         sizeof(rep->item_index), rep);
+        }
+    }
+
+  SVN_ERR(svn_io_get_dirents3(&dirents, txn_dir, TRUE, pool, pool));
+  iterpool = svn_pool_create(pool);
+  for (hi = apr_hash_first(pool, dirents); hi; hi = apr_hash_next(hi))
+    {
+      const char *name = apr_hash_this_key(hi);
+      representation_t rep = { 0 };
+      const char *final_path;
+      apr_file_t *file;
+
+      if (   strncmp(name, PATH_PREFIX_LARGE, strlen(PATH_PREFIX_LARGE))
+          || !strcmp(name, PATH_LARGE_TMP))
+        continue;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_cstring_atoui64(&rep.item_index,
+                                  name + strlen(PATH_PREFIX_LARGE)));
+      rep.revision = new_rev;
+
+      /* Superseded contents don't make it into the revision. */
+      if (used_items && !apr_hash_get(used_items, &rep.item_index,
+                                      sizeof(rep.item_index)))
+        {
+          SVN_ERR(svn_io_remove_file2(svn_dirent_join(txn_dir, name,
+                                                      iterpool),
+                                      FALSE, iterpool));
+          continue;
+        }
+
+      if (!shard_created)
+        {
+          const char *shard_path
+            = svn_fs_fs__path_large_shard(fs, new_rev, iterpool);
+
+          SVN_ERR(svn_io_make_dir_recursively(shard_path, iterpool));
+          SVN_ERR(svn_batch_fsync__new_path(batch, shard_path,
+                                            iterpool));
+          shard_created = TRUE;
+        }
+
+      final_path = svn_fs_fs__path_large_rep(fs, &rep, iterpool);
+      SVN_ERR(svn_io_file_rename2(svn_dirent_join(txn_dir, name, iterpool),
+                                  final_path, FALSE, iterpool));
+
+      /* Both, the new directory entry and the contents must be flushed. */
+      SVN_ERR(svn_batch_fsync__new_path(batch, final_path, iterpool));
+      SVN_ERR(svn_batch_fsync__open_file(&file, batch, final_path,
+                                         iterpool));
+    }
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 /* Baton used for commit_body below. */
 struct commit_baton {
   svn_revnum_t *new_rev_p;
@@ -3722,6 +4016,8 @@ commit_body(void *baton, apr_pool_t *pool)
   apr_hash_t *changed_paths;
   apr_array_header_t *directory_ids = apr_array_make(pool, 4,
                                                      sizeof(pair_cache_key_t));
+  svn_batch_fsync__t *batch;
+  apr_file_t *rev_file;
 
   /* Re-Read the current repository format.  All our repo upgrade and
      config evaluation strategies are such that existing information in
@@ -3766,6 +4062,11 @@ commit_body(void *baton, apr_pool_t *pool)
   /* We are going to be one better than this puny old revision. */
   new_rev = old_rev + 1;
 
+  /* Collect all files and directories that need to be flushed to disk
+     before we may bump 'current', such that they get fsync'ed in parallel
+     instead of one after the other. */
+  SVN_ERR(svn_batch_fsync__create(&batch, ffd->flush_to_disk, pool));
+
   /* Get a write handle on the proto revision file. */
   SVN_ERR(get_writable_proto_rev(&proto_file, &proto_file_lockcookie,
                                  cb->fs, txn_id, pool));
@@ -3804,8 +4105,7 @@ commit_body(void *baton, apr_pool_t *pool)
                                      NULL, pool));
     }
 
-  if (ffd->flush_to_disk)
-    SVN_ERR(svn_io_file_flush_to_disk(proto_file, pool));
+  /* The actual fsync happens below as part of BATCH. */
   SVN_ERR(svn_io_file_close(proto_file, pool));
 
   /* We don't unlock the prototype revision file immediately to avoid a
@@ -3830,6 +4130,7 @@ commit_body(void *baton, apr_pool_t *pool)
                                                     PATH_REVS_DIR,
                                                     pool),
                                     new_dir, pool));
+          SVN_ERR(svn_batch_fsync__new_path(batch, new_dir, pool));
         }
 
       /* Create the revprops shard. */
@@ -3846,9 +4147,14 @@ commit_body(void *baton, apr_pool_t *pool)
                                                     PATH_REVPROPS_DIR,
                                                     pool),
                                     new_dir, pool));
+          SVN_ERR(svn_batch_fsync__new_path(batch, new_dir, pool));
         }
     }
 
+  /* The large reps must be in place before their revision appears. */
+  SVN_ERR(move_large_reps_into_place(cb->fs, txn_id, new_rev,
+                                     cb->reps_to_cache, batch, pool));
+
   /* Move the finished rev file into place.
 
      ### This "breaks" the transaction by removing the protorev file
@@ -3857,8 +4163,10 @@ commit_body(void *baton, apr_pool_t *pool)
   old_rev_filename = svn_fs_fs__path_rev_absolute(cb->fs, old_rev, pool);
   rev_filename = svn_fs_fs__path_rev(cb->fs, new_rev, pool);
   proto_filename = svn_fs_fs__path_txn_proto_rev(cb->fs, txn_id, pool);
-  SVN_ERR(svn_fs_fs__move_into_place(proto_filename, rev_filename,
-                                     old_rev_filename, ffd->flush_to_disk,
+  SVN_ERR(svn_fs_fs__move_into_place(proto_filename, rev_filename, NULL,
+                                     FALSE, pool));
+  SVN_ERR(svn_batch_fsync__new_path(batch, rev_filename, pool));
+  SVN_ERR(svn_batch_fsync__open_file(&rev_file, batch, rev_filename,
                                      pool));
 
   /* Now that we've moved the prototype revision file out of the way,
@@ -3870,8 +4178,16 @@ commit_body(void *baton, apr_pool_t *pool)
   /* Write final revprops file. */
   SVN_ERR_ASSERT(! svn_fs_fs__is_packed_revprop(cb->fs, new_rev));
   revprop_filename = svn_fs_fs__path_revprops(cb->fs, new_rev, pool);
-  SVN_ERR(write_final_revprop(revprop_filename, old_rev_filename,
-                              cb->txn, ffd->flush_to_disk, pool));
+  SVN_ERR(write_final_revprop(revprop_filename, cb->txn, batch, pool));
+
+  /* Flush the rev file, the revprops, the large reps and any new
+     directory entries to disk - concurrently, if possible. */
+  SVN_ERR(svn_batch_fsync__run(batch, pool));
+
+  /* Now that all handles have been closed, make the new files read-only
+     just like the previous revision. */
+  SVN_ERR(svn_io_copy_perms(old_rev_filename, rev_filename, pool));
+  SVN_ERR(svn_io_copy_perms(old_rev_filename, revprop_filename, pool));
 
   /* Run paranoia checks. */
   if (ffd->verify_before_commit)
@@ -4100,6 +4416,9 @@ svn_fs_fs__delete_node_revision(svn_fs_t *fs,
                                 FALSE, pool));
 
   /* Delete any mutable data representation. */
+  if (noderev->kind == svn_node_file)
+    SVN_ERR(remove_unshared_large_rep(fs, noderev->data_rep, pool));
+
   if (noderev->data_rep && is_txn_rep(noderev->data_rep)
       && noderev->kind == svn_node_dir)
     {
@@ -278,6 +278,50 @@ svn_fs_fs__path_txn_item_index(svn_fs_t *fs,
                          PATH_TXN_ITEM_INDEX, pool);
 }
 
+const char *
+svn_fs_fs__path_large_shard(svn_fs_t *fs,
+                            svn_revnum_t rev,
+                            apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  if (ffd->max_files_per_dir)
+    return svn_dirent_join_many(pool, fs->path, PATH_LARGE_DIR,
+                                apr_psprintf(pool, "%ld",
+                                             rev / ffd->max_files_per_dir),
+                                SVN_VA_NULL);
+
+  return svn_dirent_join(fs->path, PATH_LARGE_DIR, pool);
+}
+
+const char *
+svn_fs_fs__path_large_rep(svn_fs_t *fs,
+                          const representation_t *rep,
+                          apr_pool_t *pool)
+{
+  if (svn_fs_fs__id_txn_used(&rep->txn_id))
+    return svn_dirent_join(svn_fs_fs__path_txn_dir(fs, &rep->txn_id, pool),
+                           apr_psprintf(pool, PATH_PREFIX_LARGE
+                                              "%" APR_UINT64_T_FMT,
+                                        rep->item_index),
+                           pool);
+
+  return svn_dirent_join(svn_fs_fs__path_large_shard(fs, rep->revision,
+                                                     pool),
+                         apr_psprintf(pool, "%ld.%" APR_UINT64_T_FMT,
+                                      rep->revision, rep->item_index),
+                         pool);
+}
+
+const char *
+svn_fs_fs__path_txn_large_tmp(svn_fs_t *fs,
+                              const svn_fs_fs__id_part_t *txn_id,
+                              apr_pool_t *pool)
+{
+  return svn_dirent_join(svn_fs_fs__path_txn_dir(fs, txn_id, pool),
+                         PATH_LARGE_TMP, pool);
+}
+
 const char *
 svn_fs_fs__path_txn_proto_revs(svn_fs_t *fs,
                                apr_pool_t *pool)
@@ -628,7 +672,8 @@ svn_fs_fs__move_into_place(const char *old_filename,
   apr_file_t *file;
 
   /* Copying permissions is a no-op on WIN32. */
-  SVN_ERR(svn_io_copy_perms(perms_reference, old_filename, pool));
+  if (perms_reference)
+    SVN_ERR(svn_io_copy_perms(perms_reference, old_filename, pool));
 
   /* Move the file into place. */
   err = svn_io_file_rename2(old_filename, new_filename, flush_to_disk, pool);
@@ -279,6 +279,33 @@ svn_fs_fs__path_txn_item_index(svn_fs_t *fs,
                                const svn_fs_fs__id_part_t *txn_id,
                                apr_pool_t *pool);
 
+/* Return the full path of the directory that holds the out-of-line large
+ * representations of revision REV in FS.  For sharded repositories, this
+ * is a shard directory within PATH_LARGE_DIR.  Allocate the result in POOL.
+ */
+const char *
+svn_fs_fs__path_large_shard(svn_fs_t *fs,
+                            svn_revnum_t rev,
+                            apr_pool_t *pool);
+
+/* Return the path of the file containing the contents of the large
+ * representation REP in FS.  REP may be committed or still be part of
+ * a transaction.  Allocate the result in POOL.
+ */
+const char *
+svn_fs_fs__path_large_rep(svn_fs_t *fs,
+                          const struct representation_t *rep,
+                          apr_pool_t *pool);
+
+/* Return the path of the temporary file that receives the contents of
+ * a potentially large representation while it is being written within
+ * transaction TXN_ID in FS.  Allocate the result in POOL.
+ */
+const char *
+svn_fs_fs__path_txn_large_tmp(svn_fs_t *fs,
+                              const svn_fs_fs__id_part_t *txn_id,
+                              apr_pool_t *pool);
+
 /* Return the path of the file containing the node origins cachs for
  * the given NODE_ID in FS.  The result will be allocated in POOL.
  */
@@ -385,7 +412,8 @@ svn_fs_fs__read_number_from_stream(apr_int64_t *result,
 /* Move a file into place from OLD_FILENAME in the transactions
    directory to its final location NEW_FILENAME in the repository.  On
    Unix, match the permissions of the new file to the permissions of
-   PERMS_REFERENCE.  Temporary allocations are from POOL.
+   PERMS_REFERENCE, unless that is NULL.  Temporary allocations are from
+   POOL.
 
    This function almost duplicates svn_io_file_move(), but it tries to
    guarantee a flush if FLUSH_TO_DISK is non-zero. */
@@ -32,7 +32,7 @@
 #include "svn_delta.h"
 #include "svn_version.h"
 #include "svn_pools.h"
-#include "batch_fsync.h"
+#include "private/svn_batch_fsync.h"
 #include "fs.h"
 #include "fs_x.h"
 #include "pack.h"
@@ -496,10 +496,33 @@ x_verify(svn_fs_t *fs,
                           cancel_func, cancel_baton, scratch_pool);
 }
 
+/* Baton for x_pack_notify(). */
+typedef struct x_pack_notify_baton_t
+{
+  svn_fs_pack_notify2_t notify_func;
+  void *notify_baton;
+} x_pack_notify_baton_t;
+
+/* Forward to the svn_fs_pack_notify2_t in BATON.  We don't collect any
+ * statistics, hence report them as 0.  Implements svn_fs_pack_notify_t. */
+static svn_error_t *
+x_pack_notify(void *baton,
+              apr_int64_t shard,
+              svn_fs_pack_notify_action_t action,
+              apr_pool_t *pool)
+{
+  x_pack_notify_baton_t *b = baton;
+  return svn_error_trace(b->notify_func(b->notify_baton, shard, action,
+                                        0, 0, pool));
+}
+
+/* This implements the fs_library_vtable_t.pack_fs() API.
+ * FSX packs one shard at a time and ignores JOBS. */
 static svn_error_t *
 x_pack(svn_fs_t *fs,
        const char *path,
-       svn_fs_pack_notify_t notify_func,
+       int jobs,
+       svn_fs_pack_notify2_t notify_func,
        void *notify_baton,
        svn_cancel_func_t cancel_func,
        void *cancel_baton,
@@ -507,8 +530,12 @@ x_pack(svn_fs_t *fs,
        apr_pool_t *scratch_pool,
        apr_pool_t *common_pool)
 {
+  x_pack_notify_baton_t b;
+  b.notify_func = notify_func;
+  b.notify_baton = notify_baton;
+
   SVN_ERR(x_open(fs, path, common_pool_lock, scratch_pool, common_pool));
-  return svn_fs_x__pack(fs, 0, notify_func, notify_baton,
+  return svn_fs_x__pack(fs, 0, notify_func ? x_pack_notify : NULL, &b,
                         cancel_func, cancel_baton, scratch_pool);
 }
 
@@ -665,7 +692,7 @@ svn_fs_x__init(const svn_version_t *loader_version,
                              loader_version->major);
   SVN_ERR(svn_ver_check_list2(x_version(), checklist, svn_ver_equal));
 
-  SVN_ERR(svn_fs_x__batch_fsync_init(common_pool));
+  SVN_ERR(svn_batch_fsync__init(common_pool));
 
   *vtable = &library_vtable;
   return SVN_NO_ERROR;
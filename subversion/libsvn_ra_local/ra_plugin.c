@@ -1673,6 +1673,7 @@ svn_ra_local__has_capability(svn_ra_session_t *session,
       || strcmp(capability, SVN_RA_CAPABILITY_EPHEMERAL_TXNPROPS) == 0
       || strcmp(capability, SVN_RA_CAPABILITY_GET_FILE_REVS_REVERSE) == 0
       || strcmp(capability, SVN_RA_CAPABILITY_LIST) == 0
+      || strcmp(capability, SVN_RA_CAPABILITY_SERVER_BLAME) == 0
       )
     {
       *has = TRUE;
@@ -1863,6 +1864,64 @@ svn_ra_local__list(svn_ra_session_t *session,
                                         sess->callback_baton, pool));
 }
 
+static svn_error_t *
+svn_ra_local__get_blame(svn_ra_session_t *session,
+                        apr_array_header_t **chunks,
+                        const char *path,
+                        svn_revnum_t start,
+                        svn_revnum_t end,
+                        const svn_diff_file_options_t *diff_options,
+                        apr_pool_t *result_pool,
+                        apr_pool_t *scratch_pool)
+{
+  svn_ra_local__session_baton_t *sess = session->priv;
+  const char *abs_path = svn_fspath__join(sess->fs_path->data, path,
+                                          scratch_pool);
+  apr_array_header_t *repos_chunks;
+  apr_hash_t *rev_props = apr_hash_make(scratch_pool);
+  int i;
+
+  /* The fulltexts end up in our own memory either way. */
+  SVN_ERR(svn_repos__blame(&repos_chunks, sess->repos, abs_path, start, end,
+                           diff_options, 0, NULL, NULL,
+                           sess->callbacks ? sess->callbacks->cancel_func
+                                           : NULL,
+                           sess->callback_baton,
+                           scratch_pool, scratch_pool));
+
+  *chunks = apr_array_make(result_pool, repos_chunks->nelts,
+                           sizeof(svn_ra__blame_chunk_t));
+  for (i = 0; i < repos_chunks->nelts; ++i)
+    {
+      const svn_repos__blame_chunk_t *repos_chunk
+        = &APR_ARRAY_IDX(repos_chunks, i, svn_repos__blame_chunk_t);
+      svn_ra__blame_chunk_t *chunk = apr_array_push(*chunks);
+
+      chunk->start = repos_chunk->start;
+      chunk->revision = repos_chunk->revision;
+      chunk->rev_props = NULL;
+
+      /* Fetch the revprops only once per revision. */
+      if (SVN_IS_VALID_REVNUM(chunk->revision))
+        {
+          chunk->rev_props = apr_hash_get(rev_props, &chunk->revision,
+                                          sizeof(chunk->revision));
+          if (!chunk->rev_props)
+            {
+              SVN_ERR(svn_repos_fs_revision_proplist(&chunk->rev_props,
+                                                     sess->repos,
+                                                     chunk->revision,
+                                                     NULL, NULL,
+                                                     result_pool));
+              apr_hash_set(rev_props, &chunk->revision,
+                           sizeof(chunk->revision), chunk->rev_props);
+            }
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /*----------------------------------------------------------------*/
 
 static const svn_version_t *
@@ -1914,6 +1973,7 @@ static const svn_ra__vtable_t ra_local_vtable =
   svn_ra_local__get_inherited_props,
   NULL /* set_svn_ra_open */,
   svn_ra_local__list ,
+  svn_ra_local__get_blame,
   svn_ra_local__register_editor_shim_callbacks,
   svn_ra_local__get_commit_ev2,
   NULL /* replay_range_ev2 */
@@ -72,6 +72,17 @@ typedef struct commit_context_t {
   const char *vcc_url;           /* vcc url */
 
   int open_batons;               /* Number of open batons */
+
+  /* Pipelined file changes (HTTP v2 only), oldest first.  Their requests
+     have been scheduled on the default connection but may not have been
+     answered yet. */
+  struct put_context_t *first_put;
+  struct put_context_t *last_put;
+  int pipelined_files;           /* Number of entries in the list */
+  apr_size_t pipelined_bytes;    /* Size of their request bodies */
+
+  /* Failure of the oldest pipelined file change that did not succeed. */
+  svn_error_t *pipeline_error;
 } commit_context_t;
 
 #define USING_HTTPV2_COMMIT_SUPPORT(commit_ctx) ((commit_ctx)->txn_url != NULL)
@@ -188,8 +199,52 @@ typedef struct file_context_t {
   /* URL to PUT the file at. */
   const char *url;
 
+  /* If the changes get pipelined, the pool that will hold the requests
+     until the server responded.  Outlives this baton. */
+  apr_pool_t *put_pool;
+
 } file_context_t;
 
+/* The pipelined PUT and PROPPATCH requests for a single file. */
+/* Wraps the response handler of a pipelined request to keep failures while
+   processing the response body with that request. */
+typedef struct pipelined_response_t {
+  /* The request and its original response handler. */
+  svn_ra_serf__handler_t *handler;
+  svn_ra_serf__response_handler_t inner_handler;
+  void *inner_baton;
+
+  /* The first error returned by INNER_HANDLER. */
+  svn_error_t *error;
+} pipelined_response_t;
+
+typedef struct put_context_t {
+  /* Pool holding this structure, the requests and their bodies. */
+  apr_pool_t *pool;
+
+  /* Copy of the file baton that the requests refer to. */
+  file_context_t *file;
+
+  /* The PUT request and the status it should return.  May be NULL. */
+  svn_ra_serf__handler_t *put_handler;
+  pipelined_response_t *put_response;
+  int put_expected_result;
+
+  /* The PROPPATCH request following the PUT.  May be NULL. */
+  svn_ra_serf__handler_t *proppatch_handler;
+  pipelined_response_t *proppatch_response;
+
+  /* Size of the PUT request body. */
+  apr_size_t size;
+
+  /* Next younger file in commit_context_t's list. */
+  struct put_context_t *next;
+} put_context_t;
+
+/* Maximum number of files that may have pipelined requests outstanding.
+   Each of them may hold an open file handle for a spilled request body. */
+#define MAX_PIPELINED_FILES 64
+
 
 /* Setup routines and handlers for various requests we'll invoke. */
 
@@ -823,13 +878,14 @@ create_proppatch_body(serf_bucket_t **bkt,
   return SVN_NO_ERROR;
 }
 
-static svn_error_t*
-proppatch_resource(svn_ra_serf__session_t *session,
-                   proppatch_context_t *proppatch,
-                   apr_pool_t *pool)
+/* Return a new handler for the PROPPATCH request described by PROPPATCH.
+   Allocate it in POOL. */
+static svn_ra_serf__handler_t *
+create_proppatch_handler(svn_ra_serf__session_t *session,
+                         proppatch_context_t *proppatch,
+                         apr_pool_t *pool)
 {
   svn_ra_serf__handler_t *handler;
-  svn_error_t *err;
 
   handler = svn_ra_serf__create_handler(session, pool);
 
@@ -846,11 +902,14 @@ proppatch_resource(svn_ra_serf__session_t *session,
   handler->response_handler = svn_ra_serf__handle_multistatus_only;
   handler->response_baton = handler;
 
-  err = svn_ra_serf__context_run_one(handler, pool);
-
-  if (!err && handler->sline.code != 207)
-    err = svn_error_trace(svn_ra_serf__unexpected_status(handler));
+  return handler;
+}
 
+/* Return ERR, a failure of a PROPPATCH request, with a more specific error
+   code. */
+static svn_error_t *
+proppatch_failed(svn_error_t *err)
+{
   /* Use specific error code for property handling errors.
      Use loop to provide the right result with tracing */
   if (err && err->apr_err == SVN_ERR_RA_DAV_REQUEST_FAILED)
@@ -867,6 +926,23 @@ proppatch_resource(svn_ra_serf__session_t *session,
   return svn_error_trace(err);
 }
 
+static svn_error_t*
+proppatch_resource(svn_ra_serf__session_t *session,
+                   proppatch_context_t *proppatch,
+                   apr_pool_t *pool)
+{
+  svn_ra_serf__handler_t *handler;
+  svn_error_t *err;
+
+  handler = create_proppatch_handler(session, proppatch, pool);
+  err = svn_ra_serf__context_run_one(handler, pool);
+
+  if (!err && handler->sline.code != 207)
+    err = svn_error_trace(svn_ra_serf__unexpected_status(handler));
+
+  return svn_error_trace(proppatch_failed(err));
+}
+
 /* Implements svn_ra_serf__request_body_delegate_t */
 static svn_error_t *
 create_empty_put_body(serf_bucket_t **body_bkt,
@@ -911,6 +987,74 @@ setup_put_headers(serf_bucket_t *headers,
   return APR_SUCCESS;
 }
 
+/* Set *HANDLER to a new handler for the PUT request of the file CTX and
+   *EXPECTED_RESULT to the status it should return.  If PUT_EMPTY_FILE is
+   set, send an empty body, otherwise send the svndiff collected in CTX.
+   Allocate the handler in POOL. */
+static svn_error_t *
+create_put_handler(svn_ra_serf__handler_t **handler,
+                   int *expected_result,
+                   file_context_t *ctx,
+                   svn_boolean_t put_empty_file,
+                   apr_pool_t *pool)
+{
+  svn_ra_serf__handler_t *new_handler;
+
+  new_handler = svn_ra_serf__create_handler(ctx->commit_ctx->session, pool);
+
+  new_handler->method = "PUT";
+  new_handler->path = ctx->url;
+
+  new_handler->response_handler = svn_ra_serf__expect_empty_body;
+  new_handler->response_baton = new_handler;
+
+  if (put_empty_file)
+    {
+      new_handler->body_delegate = create_empty_put_body;
+      new_handler->body_delegate_baton = ctx;
+      new_handler->body_type = "text/plain";
+    }
+  else
+    {
+      SVN_ERR(svn_stream_close(ctx->stream));
+
+      svn_ra_serf__request_body_get_delegate(&new_handler->body_delegate,
+                                             &new_handler->body_delegate_baton,
+                                             ctx->svndiff);
+      new_handler->body_type = SVN_SVNDIFF_MIME_TYPE;
+    }
+
+  new_handler->header_delegate = setup_put_headers;
+  new_handler->header_delegate_baton = ctx;
+
+  if (ctx->added && ! ctx->copy_path)
+    *expected_result = 201; /* Created */
+  else
+    *expected_result = 204; /* Updated */
+
+  *handler = new_handler;
+  return SVN_NO_ERROR;
+}
+
+/* Return a new PROPPATCH context for the property changes of the file CTX,
+   allocated in POOL. */
+static proppatch_context_t *
+create_file_proppatch(file_context_t *ctx,
+                      apr_pool_t *pool)
+{
+  proppatch_context_t *proppatch;
+
+  proppatch = apr_pcalloc(pool, sizeof(*proppatch));
+  proppatch->pool = pool;
+  proppatch->relpath = ctx->relpath;
+  proppatch->path = ctx->url;
+  proppatch->commit_ctx = ctx->commit_ctx;
+  proppatch->prop_changes = ctx->prop_changes;
+  proppatch->base_revision = ctx->base_revision;
+
+  return proppatch;
+}
+
 static svn_error_t *
 setup_copy_file_headers(serf_bucket_t *headers,
                         void *baton,
@@ -1859,6 +2003,314 @@ open_file(const char *path,
   return SVN_NO_ERROR;
 }
 
+/* Pipelined commits.
+ *
+ * Over high-latency links, waiting for the response to each PUT and
+ * PROPPATCH before the next file gets sent dominates the commit time.
+ * With HTTP v2, the file changes address the transaction directly and
+ * don't depend on each other's results, so we send them ahead and only
+ * look at the responses later.
+ *
+ * All requests still go over the default connection such that the server
+ * processes them in the order of the editor drive: the FS does not
+ * support concurrent modifications of the same transaction.  For the same
+ * reason, we don't pipeline over HTTP/2.
+ *
+ * Failures of the file changes, including errors while processing their
+ * response bodies, are reported by close_edit().  It returns the error of
+ * the oldest file change that failed, independent of timing.  Only errors
+ * that affect the whole session, such as connection failures or malformed
+ * server error responses, are returned by the editor call that happens to
+ * wait for the server.
+ */
+
+/* Return TRUE if file changes in CTX shall be pipelined. */
+static svn_boolean_t
+use_pipelining(const commit_context_t *ctx)
+{
+  return USING_HTTPV2_COMMIT_SUPPORT(ctx)
+      && ctx->session->commit_pipeline_size > 0
+      && !ctx->session->http10
+      && !ctx->session->http20;
+}
+
+/* Return TRUE if the server responded to all requests of PUT. */
+static svn_boolean_t
+put_done(const put_context_t *put)
+{
+  return (!put->put_handler || put->put_handler->done)
+      && (!put->proppatch_handler || put->proppatch_handler->done);
+}
+
+/* Implements svn_ra_serf__response_handler_t for pipelined requests.
+   Keep errors from the wrapped response handler in the
+   pipelined_response_t BATON instead of failing the session and
+   discard the remainder of the response. */
+static svn_error_t *
+handle_pipelined_response(serf_request_t *request,
+                          serf_bucket_t *response,
+                          void *baton,
+                          apr_pool_t *scratch_pool)
+{
+  pipelined_response_t *pr = baton;
+  svn_error_t *err;
+
+  err = pr->inner_handler(request, response, pr->inner_baton, scratch_pool);
+
+  /* EOF, EAGAIN and connection failures are for the serf loop. */
+  if (err
+      && SERF_BUCKET_READ_ERROR(err->apr_err)
+      && !APR_STATUS_IS_ECONNRESET(err->apr_err)
+      && !APR_STATUS_IS_ECONNABORTED(err->apr_err))
+    {
+      pr->error = err;
+      pr->handler->discard_body = TRUE;
+
+      return SVN_NO_ERROR;
+    }
+
+  return svn_error_trace(err);
+}
+
+/* Make the response handler of HANDLER keep its errors in a new
+   pipelined_response_t allocated in RESULT_POOL and return it. */
+static pipelined_response_t *
+wrap_pipelined_response(svn_ra_serf__handler_t *handler,
+                        apr_pool_t *result_pool)
+{
+  pipelined_response_t *pr = apr_pcalloc(result_pool, sizeof(*pr));
+
+  pr->handler = handler;
+  pr->inner_handler = handler->response_handler;
+  pr->inner_baton = handler->response_baton;
+
+  handler->no_fail_on_http_failure_status = TRUE;
+  handler->response_handler = handle_pipelined_response;
+  handler->response_baton = pr;
+
+  return pr;
+}
+
+/* Return the result of the finished request HANDLER that should have
+   returned EXPECTED_RESULT.  RESPONSE is its pipelined_response_t and
+   gets reset.  Use SCRATCH_POOL for temporaries. */
+static svn_error_t *
+pipelined_result(svn_ra_serf__handler_t *handler,
+                 pipelined_response_t *response,
+                 int expected_result,
+                 apr_pool_t *scratch_pool)
+{
+  if (response->error)
+    {
+      svn_error_t *err = response->error;
+
+      response->error = SVN_NO_ERROR;
+      return svn_error_trace(err);
+    }
+
+  if (handler->server_error)
+    return svn_error_trace(svn_ra_serf__server_error_create(handler,
+                                                            scratch_pool));
+
+  if (handler->sline.code != expected_result)
+    return svn_error_trace(svn_ra_serf__unexpected_status(handler));
+
+  return SVN_NO_ERROR;
+}
+
+/* Release all file changes at the head of the pipeline in CTX that the
+   server responded to.  Remember the first failure in CTX->PIPELINE_ERROR.
+   Use SCRATCH_POOL for temporaries. */
+static void
+reap_pipelined_files(commit_context_t *ctx,
+                     apr_pool_t *scratch_pool)
+{
+  while (ctx->first_put && put_done(ctx->first_put))
+    {
+      put_context_t *put = ctx->first_put;
+      svn_error_t *err = SVN_NO_ERROR;
+
+      if (put->put_handler)
+        err = pipelined_result(put->put_handler, put->put_response,
+                               put->put_expected_result, scratch_pool);
+
+      if (put->proppatch_handler)
+        {
+          svn_error_t *proppatch_err
+            = proppatch_failed(pipelined_result(put->proppatch_handler,
+                                                put->proppatch_response,
+                                                207, scratch_pool));
+
+          /* Report the PUT failure, if any. */
+          if (err)
+            svn_error_clear(proppatch_err);
+          else
+            err = proppatch_err;
+        }
+
+      if (err && !ctx->pipeline_error)
+        ctx->pipeline_error = err;
+      else
+        svn_error_clear(err);
+
+      ctx->first_put = put->next;
+      if (!ctx->first_put)
+        ctx->last_put = NULL;
+
+      ctx->pipelined_files--;
+      ctx->pipelined_bytes -= put->size;
+
+      svn_pool_destroy(put->pool);
+    }
+}
+
+/* Run the serf context of CTX until no more than MAX_FILES file changes
+   with no more than MAX_BYTES of data are waiting for a response.
+   Use SCRATCH_POOL for temporaries. */
+static svn_error_t *
+wait_for_pipelined_files(commit_context_t *ctx,
+                         int max_files,
+                         apr_size_t max_bytes,
+                         apr_pool_t *scratch_pool)
+{
+  apr_interval_time_t waittime_left = ctx->session->timeout;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+  reap_pipelined_files(ctx, iterpool);
+  while (ctx->pipelined_files > max_files
+         || ctx->pipelined_bytes > max_bytes)
+    {
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(svn_ra_serf__context_run(ctx->session, &waittime_left,
+                                       iterpool));
+      reap_pipelined_files(ctx, iterpool);
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+/* Drop all pipelined file changes in CTX without waiting for the server.
+ * Note that this resets the default connection if requests are pending. */
+static void
+discard_pipelined_files(commit_context_t *ctx)
+{
+  while (ctx->first_put)
+    {
+      put_context_t *put = ctx->first_put;
+      ctx->first_put = put->next;
+
+      if (put->put_response)
+        svn_error_clear(put->put_response->error);
+      if (put->proppatch_response)
+        svn_error_clear(put->proppatch_response->error);
+
+      svn_pool_destroy(put->pool);
+    }
+
+  ctx->last_put = NULL;
+  ctx->pipelined_files = 0;
+  ctx->pipelined_bytes = 0;
+
+  svn_error_clear(ctx->pipeline_error);
+  ctx->pipeline_error = SVN_NO_ERROR;
+}
+
+/* Schedule the PUT and PROPPATCH requests for the file CTX, whose pipeline
+   pool has been set, without waiting for the responses.  Send an empty
+   body if PUT_EMPTY_FILE is set.  Use SCRATCH_POOL for temporaries. */
+static svn_error_t *
+pipeline_file_changes(file_context_t *ctx,
+                      svn_boolean_t put_empty_file,
+                      apr_pool_t *scratch_pool)
+{
+  commit_context_t *commit_ctx = ctx->commit_ctx;
+  apr_pool_t *pool = ctx->put_pool;
+  apr_hash_index_t *hi;
+  file_context_t *file;
+  put_context_t *put;
+
+  ctx->put_pool = NULL;
+
+  /* Nothing to send?  Also, the commit will fail anyway once a file
+     change failed; don't keep sending data for it. */
+  if (!(ctx->svndiff || put_empty_file || apr_hash_count(ctx->prop_changes))
+      || commit_ctx->pipeline_error)
+    {
+      svn_pool_destroy(pool);
+      return SVN_NO_ERROR;
+    }
+
+  /* The requests will outlive the file baton.  The svndiff already lives
+     in POOL. */
+  file = apr_pmemdup(pool, ctx, sizeof(*ctx));
+  file->pool = pool;
+  file->parent_dir = NULL;
+  file->relpath = apr_pstrdup(pool, ctx->relpath);
+  file->name = svn_relpath_basename(file->relpath, NULL);
+  file->copy_path = apr_pstrdup(pool, ctx->copy_path);
+  file->base_checksum = apr_pstrdup(pool, ctx->base_checksum);
+  file->result_checksum = apr_pstrdup(pool, ctx->result_checksum);
+  file->url = apr_pstrdup(pool, ctx->url);
+
+  file->prop_changes = apr_hash_make(pool);
+  for (hi = apr_hash_first(scratch_pool, ctx->prop_changes);
+       hi;
+       hi = apr_hash_next(hi))
+    {
+      svn_prop_t *prop = svn_prop_dup(apr_hash_this_val(hi), pool);
+      svn_hash_sets(file->prop_changes, prop->name, prop);
+    }
+
+  put = apr_pcalloc(pool, sizeof(*put));
+  put->pool = pool;
+  put->file = file;
+
+  /* Errors get reported through pipelined_result(). */
+  if (ctx->svndiff || put_empty_file)
+    {
+      SVN_ERR(create_put_handler(&put->put_handler,
+                                 &put->put_expected_result,
+                                 file, put_empty_file, pool));
+      put->put_response = wrap_pipelined_response(put->put_handler, pool);
+
+      if (ctx->svndiff)
+        put->size = svn_ra_serf__request_body_get_size(ctx->svndiff);
+    }
+
+  if (apr_hash_count(file->prop_changes))
+    {
+      put->proppatch_handler
+        = create_proppatch_handler(commit_ctx->session,
+                                   create_file_proppatch(file, pool),
+                                   pool);
+      put->proppatch_response
+        = wrap_pipelined_response(put->proppatch_handler, pool);
+    }
+
+  if (put->put_handler)
+    svn_ra_serf__request_create(put->put_handler);
+  if (put->proppatch_handler)
+    svn_ra_serf__request_create(put->proppatch_handler);
+
+  if (commit_ctx->last_put)
+    commit_ctx->last_put->next = put;
+  else
+    commit_ctx->first_put = put;
+
+  commit_ctx->last_put = put;
+  commit_ctx->pipelined_files++;
+  commit_ctx->pipelined_bytes += put->size;
+
+  /* Limit the amount of data in flight. */
+  return svn_error_trace(wait_for_pipelined_files(
+                              commit_ctx, MAX_PIPELINED_FILES,
+                              (apr_size_t)commit_ctx->session
+                                ->commit_pipeline_size * 1024,
+                              scratch_pool));
+}
+
 static svn_error_t *
 apply_textdelta(void *file_baton,
                 const char *base_checksum,
@@ -1888,13 +2340,25 @@ apply_textdelta(void *file_baton,
    *     for sure after the request is completely available.
    */
 
+  if (use_pipelining(ctx->commit_ctx))
+    ctx->put_pool = svn_pool_create(ctx->commit_ctx->pool);
+
   ctx->svndiff =
     svn_ra_serf__request_body_create(SVN_RA_SERF__REQUEST_BODY_IN_MEM_SIZE,
-                                     ctx->pool);
+                                     ctx->put_pool ? ctx->put_pool
+                                                   : ctx->pool);
   ctx->stream = svn_ra_serf__request_body_get_stream(ctx->svndiff);
 
-  if (ctx->commit_ctx->session->supports_svndiff1 &&
+  if (ctx->commit_ctx->session->supports_svndiff3 &&
       ctx->commit_ctx->session->using_compression)
+    {
+      /* LZ4 compressed svndiff3 is cheaper to produce and to consume
+       * than zlib compressed svndiff1. */
+      svndiff_version = 3;
+      compression_level = SVN_DELTA_COMPRESSION_LEVEL_DEFAULT;
+    }
+  else if (ctx->commit_ctx->session->supports_svndiff1 &&
+           ctx->commit_ctx->session->using_compression)
     {
       /* Use compressed svndiff1 format, if possible. */
       svndiff_version = 1;
@@ -1962,47 +2426,30 @@ close_file(void *file_baton,
   if ((!ctx->svndiff) && ctx->added && (!ctx->copy_path))
     put_empty_file = TRUE;
 
+  /* Send the changes ahead, if we may.  close_edit() will check the
+     responses. */
+  if (!ctx->put_pool && !ctx->svndiff && use_pipelining(ctx->commit_ctx))
+    ctx->put_pool = svn_pool_create(ctx->commit_ctx->pool);
+
+  if (ctx->put_pool)
+    {
+      SVN_ERR(pipeline_file_changes(ctx, put_empty_file, scratch_pool));
+      ctx->commit_ctx->open_batons--;
+
+      return SVN_NO_ERROR;
+    }
+
   /* If we had a stream of changes, push them to the server... */
   if (ctx->svndiff || put_empty_file)
     {
       svn_ra_serf__handler_t *handler;
       int expected_result;
 
-      handler = svn_ra_serf__create_handler(ctx->commit_ctx->session,
-                                            scratch_pool);
-
-      handler->method = "PUT";
-      handler->path = ctx->url;
-
-      handler->response_handler = svn_ra_serf__expect_empty_body;
-      handler->response_baton = handler;
-
-      if (put_empty_file)
-        {
-          handler->body_delegate = create_empty_put_body;
-          handler->body_delegate_baton = ctx;
-          handler->body_type = "text/plain";
-        }
-      else
-        {
-          SVN_ERR(svn_stream_close(ctx->stream));
-
-          svn_ra_serf__request_body_get_delegate(&handler->body_delegate,
-                                                 &handler->body_delegate_baton,
-                                                 ctx->svndiff);
-          handler->body_type = SVN_SVNDIFF_MIME_TYPE;
-        }
-
-      handler->header_delegate = setup_put_headers;
-      handler->header_delegate_baton = ctx;
+      SVN_ERR(create_put_handler(&handler, &expected_result, ctx,
+                                 put_empty_file, scratch_pool));
 
       SVN_ERR(svn_ra_serf__context_run_one(handler, scratch_pool));
 
-      if (ctx->added && ! ctx->copy_path)
-        expected_result = 201; /* Created */
-      else
-        expected_result = 204; /* Updated */
-
       if (handler->sline.code != expected_result)
         return svn_error_trace(svn_ra_serf__unexpected_status(handler));
     }
@@ -2016,14 +2463,7 @@ close_file(void *file_baton,
     {
       proppatch_context_t *proppatch;
 
-      proppatch = apr_pcalloc(scratch_pool, sizeof(*proppatch));
-      proppatch->pool = scratch_pool;
-      proppatch->relpath = ctx->relpath;
-      proppatch->path = ctx->url;
-      proppatch->commit_ctx = ctx->commit_ctx;
-      proppatch->prop_changes = ctx->prop_changes;
-      proppatch->base_revision = ctx->base_revision;
-
+      proppatch = create_file_proppatch(ctx, scratch_pool);
       SVN_ERR(proppatch_resource(ctx->commit_ctx->session,
                                  proppatch, scratch_pool));
     }
@@ -2048,6 +2488,16 @@ close_edit(void *edit_baton,
               SVN_ERR_FS_INCORRECT_EDITOR_COMPLETION, NULL,
               _("Closing editor with directories or files open"));
 
+  /* Collect the responses to all pipelined file changes. */
+  SVN_ERR(wait_for_pipelined_files(ctx, 0, 0, pool));
+  if (ctx->pipeline_error)
+    {
+      err = ctx->pipeline_error;
+      ctx->pipeline_error = SVN_NO_ERROR;
+
+      return svn_error_trace(err);
+    }
+
   /* MERGE our activity */
   SVN_ERR(svn_ra_serf__run_merge(&commit_info,
                                  ctx->session,
@@ -2097,6 +2547,9 @@ abort_edit(void *edit_baton,
   commit_context_t *ctx = edit_baton;
   svn_ra_serf__handler_t *handler;
 
+  /* We don't care about the outcome of pipelined requests anymore. */
+  discard_pipelined_files(ctx);
+
   /* If an activity or transaction wasn't even created, don't bother
      trying to delete it. */
   if (! (ctx->activity_url || ctx->txn_url))
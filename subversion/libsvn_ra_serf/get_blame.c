@@ -0,0 +1,270 @@
+/*
+ * get_blame.c :  entry point for server-side blame for ra_serf
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+
+
+#include <serf.h>
+
+#include "svn_hash.h"
+#include "svn_pools.h"
+#include "svn_ra.h"
+#include "svn_xml.h"
+#include "svn_base64.h"
+#include "svn_private_config.h"
+
+#include "../libsvn_ra/ra_loader.h"
+
+#include "ra_serf.h"
+
+
+/*
+ * This enum represents the current state of our XML parsing for a REPORT.
+ */
+enum blame_state_e {
+  INITIAL = XML_STATE_INITIAL,
+  REPORT,
+  CHUNK,
+  REVISION,
+  REV_PROP
+};
+
+typedef struct blame_context_t {
+  /* pool to allocate the results in */
+  apr_pool_t *pool;
+
+  /* parameters set by our caller */
+  const char *path;
+  svn_revnum_t start;
+  svn_revnum_t end;
+  const svn_diff_file_options_t *diff_options;
+
+  /* Returned array of svn_ra__blame_chunk_t */
+  apr_array_header_t *chunks;
+
+  /* Maps svn_revnum_t to the revprops hash of that revision. */
+  apr_hash_t *rev_props;
+
+  /* Revprops of the REVISION being parsed; NULL before its first one. */
+  apr_hash_t *current_props;
+
+} blame_context_t;
+
+#define D_ "DAV:"
+#define S_ SVN_XML_NAMESPACE
+static const svn_ra_serf__xml_transition_t blame_ttable[] = {
+  { INITIAL, S_, "blame-report", REPORT,
+    FALSE, { NULL }, FALSE },
+
+  { REPORT, S_, "chunk", CHUNK,
+    FALSE, { "start", "?rev", NULL }, TRUE },
+
+  { REPORT, S_, "revision", REVISION,
+    FALSE, { "rev", NULL }, TRUE },
+
+  { REVISION, S_, "rev-prop", REV_PROP,
+    TRUE, { "name", "?encoding", NULL }, TRUE },
+
+  { 0 }
+};
+
+
+/* Conforms to svn_ra_serf__xml_closed_t  */
+static svn_error_t *
+blame_closed(svn_ra_serf__xml_estate_t *xes,
+             void *baton,
+             int leaving_state,
+             const svn_string_t *cdata,
+             apr_hash_t *attrs,
+             apr_pool_t *scratch_pool)
+{
+  blame_context_t *blame_ctx = baton;
+
+  if (leaving_state == CHUNK)
+    {
+      svn_ra__blame_chunk_t *chunk = apr_array_push(blame_ctx->chunks);
+      const char *rev_str = svn_hash_gets(attrs, "rev");
+
+      SVN_ERR(svn_cstring_atoi64(&chunk->start,
+                                 svn_hash_gets(attrs, "start")));
+      chunk->revision = rev_str ? SVN_STR_TO_REV(rev_str)
+                                : SVN_INVALID_REVNUM;
+      chunk->rev_props = NULL;
+    }
+  else if (leaving_state == REVISION)
+    {
+      svn_revnum_t rev = SVN_STR_TO_REV(svn_hash_gets(attrs, "rev"));
+
+      if (!blame_ctx->current_props)
+        blame_ctx->current_props = apr_hash_make(blame_ctx->pool);
+
+      apr_hash_set(blame_ctx->rev_props,
+                   apr_pmemdup(blame_ctx->pool, &rev, sizeof(rev)),
+                   sizeof(rev), blame_ctx->current_props);
+      blame_ctx->current_props = NULL;
+    }
+  else
+    {
+      const char *name;
+      const char *encoding;
+      const svn_string_t *value;
+
+      SVN_ERR_ASSERT(leaving_state == REV_PROP);
+
+      name = apr_pstrdup(blame_ctx->pool, svn_hash_gets(attrs, "name"));
+      encoding = svn_hash_gets(attrs, "encoding");
+
+      if (encoding && strcmp(encoding, "base64") == 0)
+        value = svn_base64_decode_string(cdata, blame_ctx->pool);
+      else
+        value = svn_string_dup(cdata, blame_ctx->pool);
+
+      if (!blame_ctx->current_props)
+        blame_ctx->current_props = apr_hash_make(blame_ctx->pool);
+
+      svn_hash_sets(blame_ctx->current_props, name, value);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+
+/* Implements svn_ra_serf__request_body_delegate_t */
+static svn_error_t *
+create_blame_body(serf_bucket_t **body_bkt,
+                  void *baton,
+                  serf_bucket_alloc_t *alloc,
+                  apr_pool_t *pool /* request pool */,
+                  apr_pool_t *scratch_pool)
+{
+  serf_bucket_t *buckets;
+  blame_context_t *blame_ctx = baton;
+  const svn_diff_file_options_t *diff_options = blame_ctx->diff_options;
+
+  buckets = serf_bucket_aggregate_create(alloc);
+
+  svn_ra_serf__add_open_tag_buckets(buckets, alloc,
+                                    "S:blame-report",
+                                    "xmlns:S", SVN_XML_NAMESPACE,
+                                    SVN_VA_NULL);
+
+  svn_ra_serf__add_tag_buckets(buckets,
+                               "S:start-revision",
+                               apr_ltoa(pool, blame_ctx->start),
+                               alloc);
+
+  svn_ra_serf__add_tag_buckets(buckets,
+                               "S:end-revision",
+                               apr_ltoa(pool, blame_ctx->end),
+                               alloc);
+
+  /* The diff options use the syntax of svn_diff_file_options_parse(). */
+  if (diff_options)
+    {
+      if (diff_options->ignore_space == svn_diff_file_ignore_space_change)
+        svn_ra_serf__add_tag_buckets(buckets, "S:diff-option", "-b", alloc);
+      else if (diff_options->ignore_space == svn_diff_file_ignore_space_all)
+        svn_ra_serf__add_tag_buckets(buckets, "S:diff-option", "-w", alloc);
+      if (diff_options->ignore_eol_style)
+        svn_ra_serf__add_tag_buckets(buckets, "S:diff-option",
+                                     "--ignore-eol-style", alloc);
+    }
+
+  svn_ra_serf__add_tag_buckets(buckets,
+                               "S:path", blame_ctx->path,
+                               alloc);
+
+  svn_ra_serf__add_close_tag_buckets(buckets, alloc,
+                                     "S:blame-report");
+
+  *body_bkt = buckets;
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_ra_serf__get_blame(svn_ra_session_t *ra_session,
+                       apr_array_header_t **chunks,
+                       const char *path,
+                       svn_revnum_t start,
+                       svn_revnum_t end,
+                       const svn_diff_file_options_t *diff_options,
+                       apr_pool_t *result_pool,
+                       apr_pool_t *scratch_pool)
+{
+  blame_context_t *blame_ctx;
+  svn_ra_serf__session_t *session = ra_session->priv;
+  svn_ra_serf__handler_t *handler;
+  svn_ra_serf__xml_context_t *xmlctx;
+  const char *req_url;
+  int i;
+
+  blame_ctx = apr_pcalloc(scratch_pool, sizeof(*blame_ctx));
+  blame_ctx->pool = result_pool;
+  blame_ctx->path = path;
+  blame_ctx->start = start;
+  blame_ctx->end = end;
+  blame_ctx->diff_options = diff_options;
+  blame_ctx->chunks = apr_array_make(result_pool, 16,
+                                     sizeof(svn_ra__blame_chunk_t));
+  blame_ctx->rev_props = apr_hash_make(scratch_pool);
+
+  SVN_ERR(svn_ra_serf__get_stable_url(&req_url, NULL /* latest_revnum */,
+                                      session, NULL /* url */, end,
+                                      scratch_pool, scratch_pool));
+
+  xmlctx = svn_ra_serf__xml_context_create(blame_ttable,
+                                           NULL, blame_closed, NULL,
+                                           blame_ctx,
+                                           scratch_pool);
+  handler = svn_ra_serf__create_expat_handler(session, xmlctx, NULL,
+                                              scratch_pool);
+
+  handler->method = "REPORT";
+  handler->path = req_url;
+  handler->body_delegate = create_blame_body;
+  handler->body_delegate_baton = blame_ctx;
+  handler->body_type = "text/xml";
+
+  SVN_ERR(svn_ra_serf__context_run_one(handler, scratch_pool));
+
+  if (handler->sline.code != 200)
+    return svn_error_trace(svn_ra_serf__unexpected_status(handler));
+
+  /* The revprops follow the chunks in the report. */
+  for (i = 0; i < blame_ctx->chunks->nelts; ++i)
+    {
+      svn_ra__blame_chunk_t *chunk = &APR_ARRAY_IDX(blame_ctx->chunks, i,
+                                                    svn_ra__blame_chunk_t);
+
+      if (!SVN_IS_VALID_REVNUM(chunk->revision))
+        continue;
+
+      chunk->rev_props = apr_hash_get(blame_ctx->rev_props,
+                                      &chunk->revision,
+                                      sizeof(chunk->revision));
+      if (!chunk->rev_props)
+        chunk->rev_props = apr_hash_make(result_pool);
+    }
+
+  *chunks = blame_ctx->chunks;
+  return SVN_NO_ERROR;
+}
@@ -33,6 +33,7 @@
 #include "svn_pools.h"
 #include "svn_ra.h"
 #include "svn_delta.h"
+#include "svn_diff.h"
 #include "svn_version.h"
 #include "svn_dav.h"
 #include "svn_dirent_uri.h"
@@ -85,11 +86,15 @@ typedef struct svn_ra_serf__connection_t {
 } svn_ra_serf__connection_t;
 
 /** Maximum value we'll allow for the http-max-connections config option.
+ *
+ * Updates only use as many of them as keep increasing the throughput,
+ * so this may be generous enough for links with a high bandwidth-delay
+ * product.
  *
  * Note: minimum 2 connections are required for ra_serf to function
  * correctly!
  */
-#define SVN_RA_SERF__MAX_CONNECTIONS_LIMIT 8
+#define SVN_RA_SERF__MAX_CONNECTIONS_LIMIT 32
 
 /*
  * The master serf RA session.
@@ -110,6 +115,10 @@ struct svn_ra_serf__session_t {
      fetch operations (updates, etc.) */
   apr_int64_t max_connections;
 
+  /* The maximum number of kilobytes of file changes a commit may send
+     ahead of the server's responses.  0 disables pipelined commits. */
+  apr_int64_t commit_pipeline_size;
+
   /* Are we using ssl */
   svn_boolean_t using_ssl;
 
@@ -261,6 +270,16 @@ struct svn_ra_serf__session_t {
 
   /* Indicates whether the server can understand svndiff version 1. */
   svn_boolean_t supports_svndiff1;
+
+  /* Indicates whether the server can understand svndiff version 3. */
+  svn_boolean_t supports_svndiff3;
+
+  /* Indicates whether the server can send send-all update-report and
+     replay-report responses as binary frames. */
+  svn_boolean_t supports_binary_update;
+
+  /* Should we ask the server for binary frames if it supports them? */
+  svn_boolean_t binary_frames;
 };
 
 #define SVN_RA_SERF__HAVE_HTTPV2_SUPPORT(sess) ((sess)->me_resource != NULL)
@@ -812,6 +831,28 @@ svn_ra_serf__expect_empty_body(serf_request_t *request,
                                apr_pool_t *scratch_pool);
 
 
+/* Return TRUE if HANDLER got a successful RESPONSE whose body is a binary
+   frame stream, i.e. of type SVN_DAV__BINARY_UPDATE_MIME_TYPE, rather
+   than XML. */
+svn_boolean_t
+svn_ra_serf__is_frames_response(svn_ra_serf__handler_t *handler,
+                                serf_bucket_t *response);
+
+/* Handler that feeds the @a response body associated with a @a request
+   to the svn_frames__parser_t @a baton.  At the end of the body, it
+   returns the error sent by the server, if any, and checks that the frame
+   stream is complete.
+
+   Implements svn_ra_serf__response_handler_t.
+
+   All temporary allocations will be made in SCRATCH_POOL.  */
+svn_error_t *
+svn_ra_serf__handle_frames(serf_request_t *request,
+                           serf_bucket_t *response,
+                           void *baton,
+                           apr_pool_t *scratch_pool);
+
+
 /*
  * This function sets up error parsing for an existing request
  */
@@ -1308,6 +1349,17 @@ svn_ra_serf__get_file_revs(svn_ra_session_t *session,
                            void *handler_baton,
                            apr_pool_t *pool);
 
+/* Implements svn_ra__vtable_t.get_blame(). */
+svn_error_t *
+svn_ra_serf__get_blame(svn_ra_session_t *ra_session,
+                       apr_array_header_t **chunks,
+                       const char *path,
+                       svn_revnum_t start,
+                       svn_revnum_t end,
+                       const svn_diff_file_options_t *diff_options,
+                       apr_pool_t *result_pool,
+                       apr_pool_t *scratch_pool);
+
 /* Implements svn_ra__vtable_t.get_dated_revision(). */
 svn_error_t *
 svn_ra_serf__get_dated_revision(svn_ra_session_t *session,
@@ -1592,6 +1644,10 @@ svn_ra_serf__request_body_create(apr_size_t in_memory_size,
 svn_stream_t *
 svn_ra_serf__request_body_get_stream(svn_ra_serf__request_body_t *body);
 
+/* Return the number of bytes written to BODY so far. */
+apr_size_t
+svn_ra_serf__request_body_get_size(svn_ra_serf__request_body_t *body);
+
 /* Get a svn_ra_serf__request_body_delegate_t and baton for BODY. */
 void
 svn_ra_serf__request_body_get_delegate(svn_ra_serf__request_body_delegate_t *del,
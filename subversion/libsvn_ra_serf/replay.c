@@ -168,8 +168,284 @@ typedef struct revision_report_t {
 
   svn_boolean_t using_compression;
 
+  /* Did we ask the server to send binary frames instead of XML? */
+  svn_boolean_t binary_frames;
+
+  /* Did we check the response format yet?  If the server sends binary
+     frames, FRAME_PARSER is their parser. */
+  svn_boolean_t format_checked;
+  svn_frames__parser_t *frame_parser;
+
+  /* The XML response handler and baton, used unless we get frames. */
+  svn_ra_serf__response_handler_t xml_handler;
+  void *xml_handler_baton;
+
 } revision_report_t;
 
+/* Return an error about a malformed replay-report response. */
+static svn_error_t *
+malformed_error(void)
+{
+  return svn_error_create(SVN_ERR_RA_DAV_MALFORMED_DATA, NULL,
+                          _("Malformed replay-report response"));
+}
+
+/* Call CTX's revstart callback at the start of the response. */
+static svn_error_t *
+start_revision(struct revision_report_t *ctx,
+               apr_pool_t *scratch_pool)
+{
+  /* Before we can continue, we need the revision properties. */
+  SVN_ERR_ASSERT(!ctx->propfind_handler || ctx->propfind_handler->done);
+
+  svn_ra_serf__keep_only_regular_props(ctx->rev_props, scratch_pool);
+
+  if (ctx->revstart_func)
+    {
+      SVN_ERR(ctx->revstart_func(ctx->revision, ctx->replay_baton,
+                                 &ctx->editor, &ctx->editor_baton,
+                                 ctx->rev_props,
+                                 ctx->pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Call CTX's revfinish callback at the end of a complete response. */
+static svn_error_t *
+finish_revision(struct revision_report_t *ctx,
+                apr_pool_t *scratch_pool)
+{
+  if (ctx->current_node)
+    return svn_error_trace(malformed_error());
+
+  if (ctx->revfinish_func)
+    {
+      SVN_ERR(ctx->revfinish_func(ctx->revision, ctx->replay_baton,
+                                  ctx->editor, ctx->editor_baton,
+                                  ctx->rev_props, scratch_pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Open the root directory of CTX's edit with base revision REV. */
+static svn_error_t *
+open_root_node(struct revision_report_t *ctx,
+               svn_revnum_t rev)
+{
+  apr_pool_t *root_pool;
+
+  if (ctx->current_node || ctx->root_node)
+    return svn_error_trace(malformed_error());
+
+  root_pool = svn_pool_create(ctx->pool);
+  ctx->root_node = apr_pcalloc(root_pool, sizeof(*ctx->root_node));
+  ctx->root_node->pool = root_pool;
+
+  ctx->current_node = ctx->root_node;
+
+  return svn_error_trace(ctx->editor->open_root(ctx->editor_baton, rev,
+                                                root_pool,
+                                                &ctx->current_node->baton));
+}
+
+/* Open (or, if ADD is set, add) the FILE or directory NAME within CTX's
+   current directory and make it the current node.  REV is the base
+   revision or, when adding, the copyfrom revision of COPYFROM_PATH. */
+static svn_error_t *
+open_child_node(struct revision_report_t *ctx,
+                svn_boolean_t file,
+                svn_boolean_t add,
+                const char *name,
+                svn_revnum_t rev,
+                const char *copyfrom_path)
+{
+  struct replay_node_t *node;
+  apr_pool_t *node_pool;
+
+  if (!ctx->current_node || ctx->current_node->file || !name)
+    return svn_error_trace(malformed_error());
+
+  node_pool = svn_pool_create(ctx->current_node->pool);
+  node = apr_pcalloc(node_pool, sizeof(*node));
+  node->pool = node_pool;
+  node->parent = ctx->current_node;
+  node->file = file;
+
+  if (add && !SVN_IS_VALID_REVNUM(rev))
+    copyfrom_path = NULL;
+
+  if (file && add)
+    SVN_ERR(ctx->editor->add_file(name, ctx->current_node->baton,
+                                  copyfrom_path, rev, node->pool,
+                                  &node->baton));
+  else if (file)
+    SVN_ERR(ctx->editor->open_file(name, ctx->current_node->baton,
+                                   rev, node->pool, &node->baton));
+  else if (add)
+    SVN_ERR(ctx->editor->add_directory(name, ctx->current_node->baton,
+                                       copyfrom_path, rev, node->pool,
+                                       &node->baton));
+  else
+    SVN_ERR(ctx->editor->open_directory(name, ctx->current_node->baton,
+                                        rev, node->pool, &node->baton));
+
+  ctx->current_node = node;
+  return SVN_NO_ERROR;
+}
+
+/* Close CTX's current node, which must be a FILE or directory.
+   CHECKSUM is the file's text checksum. */
+static svn_error_t *
+close_node(struct revision_report_t *ctx,
+           svn_boolean_t file,
+           const char *checksum)
+{
+  struct replay_node_t *node = ctx->current_node;
+
+  if (! node || node->file != file)
+    return svn_error_trace(malformed_error());
+
+  if (file)
+    SVN_ERR(ctx->editor->close_file(node->baton, checksum, node->pool));
+  else
+    SVN_ERR(ctx->editor->close_directory(node->baton, node->pool));
+
+  ctx->current_node = node->parent;
+  svn_pool_destroy(node->pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Delete NAME at revision REV within CTX's current directory. */
+static svn_error_t *
+delete_child(struct revision_report_t *ctx,
+             const char *name,
+             svn_revnum_t rev,
+             apr_pool_t *scratch_pool)
+{
+  struct replay_node_t *parent_node = ctx->current_node;
+
+  if (! parent_node || parent_node->file || !name)
+    return svn_error_trace(malformed_error());
+
+  return svn_error_trace(ctx->editor->delete_entry(name, rev,
+                                                   parent_node->baton,
+                                                   scratch_pool));
+}
+
+/* Set the property NAME of CTX's current node to VALUE. */
+static svn_error_t *
+change_node_prop(struct revision_report_t *ctx,
+                 const char *name,
+                 const svn_string_t *value,
+                 apr_pool_t *scratch_pool)
+{
+  struct replay_node_t *node = ctx->current_node;
+
+  if (! node || !name)
+    return svn_error_trace(malformed_error());
+
+  if (node->file)
+    SVN_ERR(ctx->editor->change_file_prop(node->baton, name, value,
+                                          scratch_pool));
+  else
+    SVN_ERR(ctx->editor->change_dir_prop(node->baton, name, value,
+                                         scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Start applying a text delta against the text with CHECKSUM to CTX's
+   current file.  The svndiff data will be written to the node's stream;
+   if BASE64 is set, it is expected to be base64 encoded. */
+static svn_error_t *
+start_textdelta(struct revision_report_t *ctx,
+                const char *checksum,
+                svn_boolean_t base64)
+{
+  struct replay_node_t *node = ctx->current_node;
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+
+  if (! node || ! node->file || node->stream)
+    return svn_error_trace(malformed_error());
+
+  SVN_ERR(ctx->editor->apply_textdelta(node->baton, checksum, node->pool,
+                                       &handler, &handler_baton));
+
+  if (handler != svn_delta_noop_window_handler)
+    {
+      node->stream = svn_txdelta_parse_svndiff(handler, handler_baton,
+                                               TRUE, node->pool);
+      if (base64)
+        node->stream = svn_base64_decode(node->stream, node->pool);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Write the LEN bytes of svndiff DATA to CTX's current file. */
+static svn_error_t *
+write_textdelta(struct revision_report_t *ctx,
+                const char *data,
+                apr_size_t len)
+{
+  struct replay_node_t *node = ctx->current_node;
+
+  if (! node || ! node->file)
+    return svn_error_trace(malformed_error());
+
+  if (node->stream)
+    {
+      apr_size_t written = len;
+
+      SVN_ERR(svn_stream_write(node->stream, data, &written));
+      if (written != len)
+        return svn_error_create(SVN_ERR_STREAM_UNEXPECTED_EOF, NULL,
+                                _("Error writing stream: unexpected EOF"));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Finish applying the text delta to CTX's current file. */
+static svn_error_t *
+end_textdelta(struct revision_report_t *ctx)
+{
+  struct replay_node_t *node = ctx->current_node;
+
+  if (! node || ! node->file)
+    return svn_error_trace(malformed_error());
+
+  if (node->stream)
+    SVN_ERR(svn_stream_close(node->stream));
+
+  node->stream = NULL;
+  return SVN_NO_ERROR;
+}
+
+/* Parse the revision number REVSTR into *REV.  Map NULL to
+   SVN_INVALID_REVNUM. */
+static svn_error_t *
+parse_rev(svn_revnum_t *rev,
+          const char *revstr)
+{
+  apr_int64_t val;
+
+  if (! revstr)
+    {
+      *rev = SVN_INVALID_REVNUM;
+      return SVN_NO_ERROR;
+    }
+
+  SVN_ERR(svn_cstring_atoi64(&val, revstr));
+  *rev = (svn_revnum_t)val;
+
+  return SVN_NO_ERROR;
+}
+
 /* Conforms to svn_ra_serf__xml_opened_t */
 static svn_error_t *
 replay_opened(svn_ra_serf__xml_estate_t *xes,
@@ -182,46 +458,17 @@ replay_opened(svn_ra_serf__xml_estate_t *xes,
 
   if (entered_state == REPLAY_REPORT)
     {
-      /* Before we can continue, we need the revision properties. */
-      SVN_ERR_ASSERT(!ctx->propfind_handler || ctx->propfind_handler->done);
-
-      svn_ra_serf__keep_only_regular_props(ctx->rev_props, scratch_pool);
-
-      if (ctx->revstart_func)
-        {
-          SVN_ERR(ctx->revstart_func(ctx->revision, ctx->replay_baton,
-                                     &ctx->editor, &ctx->editor_baton,
-                                     ctx->rev_props,
-                                     ctx->pool));
-        }
+      SVN_ERR(start_revision(ctx, scratch_pool));
     }
   else if (entered_state == REPLAY_APPLY_TEXTDELTA)
     {
-       struct replay_node_t *node = ctx->current_node;
        apr_hash_t *attrs;
-       const char *checksum;
-       svn_txdelta_window_handler_t handler;
-       void *handler_baton;
-
-       if (! node || ! node->file || node->stream)
-         return svn_error_create(SVN_ERR_XML_MALFORMED, NULL, NULL);
 
        /* ### Is there a better way to access a specific attr here? */
        attrs = svn_ra_serf__xml_gather_since(xes, REPLAY_APPLY_TEXTDELTA);
-       checksum = svn_hash_gets(attrs, "checksum");
-
-       SVN_ERR(ctx->editor->apply_textdelta(node->baton, checksum, node->pool,
-                                            &handler, &handler_baton));
-
-       if (handler != svn_delta_noop_window_handler)
-         {
-            node->stream = svn_base64_decode(
-                                    svn_txdelta_parse_svndiff(handler,
-                                                              handler_baton,
-                                                              TRUE,
-                                                              node->pool),
-                                    node->pool);
-         }
+
+       SVN_ERR(start_textdelta(ctx, svn_hash_gets(attrs, "checksum"),
+                               TRUE /* base64 */));
     }
 
   return SVN_NO_ERROR;
@@ -237,239 +484,255 @@ replay_closed(svn_ra_serf__xml_estate_t *xes,
               apr_pool_t *scratch_pool)
 {
   struct revision_report_t *ctx = baton;
+  svn_revnum_t rev;
 
-  if (leaving_state == REPLAY_REPORT)
+  switch (leaving_state)
     {
-      if (ctx->current_node)
-        return svn_error_create(SVN_ERR_XML_MALFORMED, NULL, NULL);
-
-      if (ctx->revfinish_func)
+      case REPLAY_REPORT:
+        SVN_ERR(finish_revision(ctx, scratch_pool));
+        break;
+
+      case REPLAY_TARGET_REVISION:
+        SVN_ERR(parse_rev(&rev, svn_hash_gets(attrs, "rev")));
+        SVN_ERR(ctx->editor->set_target_revision(ctx->editor_baton, rev,
+                                                 scratch_pool));
+        break;
+
+      case REPLAY_OPEN_ROOT:
+        SVN_ERR(parse_rev(&rev, svn_hash_gets(attrs, "rev")));
+        SVN_ERR(open_root_node(ctx, rev));
+        break;
+
+      case REPLAY_OPEN_DIRECTORY:
+      case REPLAY_OPEN_FILE:
+        SVN_ERR(parse_rev(&rev, svn_hash_gets(attrs, "rev")));
+        SVN_ERR(open_child_node(ctx, leaving_state == REPLAY_OPEN_FILE,
+                                FALSE, svn_hash_gets(attrs, "name"),
+                                rev, NULL));
+        break;
+
+      case REPLAY_ADD_DIRECTORY:
+      case REPLAY_ADD_FILE:
+        SVN_ERR(parse_rev(&rev, svn_hash_gets(attrs, "copyfrom-rev")));
+        SVN_ERR(open_child_node(ctx, leaving_state == REPLAY_ADD_FILE,
+                                TRUE, svn_hash_gets(attrs, "name"),
+                                rev, svn_hash_gets(attrs, "copyfrom-path")));
+        break;
+
+      case REPLAY_CLOSE_FILE:
+        SVN_ERR(close_node(ctx, TRUE, svn_hash_gets(attrs, "checksum")));
+        break;
+
+      case REPLAY_CLOSE_DIRECTORY:
+        SVN_ERR(close_node(ctx, FALSE, NULL));
+        break;
+
+      case REPLAY_DELETE_ENTRY:
+        SVN_ERR(parse_rev(&rev, svn_hash_gets(attrs, "rev")));
+        SVN_ERR(delete_child(ctx, svn_hash_gets(attrs, "name"), rev,
+                             scratch_pool));
+        break;
+
+      case REPLAY_CHANGE_FILE_PROP:
+      case REPLAY_CHANGE_DIRECTORY_PROP:
         {
-          SVN_ERR(ctx->revfinish_func(ctx->revision, ctx->replay_baton,
-                                      ctx->editor, ctx->editor_baton,
-                                      ctx->rev_props, scratch_pool));
-        }
-    }
-  else if (leaving_state == REPLAY_TARGET_REVISION)
-    {
-      const char *revstr = svn_hash_gets(attrs, "rev");
-      apr_int64_t rev;
-
-      SVN_ERR(svn_cstring_atoi64(&rev, revstr));
-      SVN_ERR(ctx->editor->set_target_revision(ctx->editor_baton,
-                                               (svn_revnum_t)rev,
-                                               scratch_pool));
-    }
-  else if (leaving_state == REPLAY_OPEN_ROOT)
-    {
-      const char *revstr = svn_hash_gets(attrs, "rev");
-      apr_int64_t rev;
-      apr_pool_t *root_pool = svn_pool_create(ctx->pool);
+          struct replay_node_t *node = ctx->current_node;
+          const svn_string_t *value;
 
-      if (ctx->current_node || ctx->root_node)
-        return svn_error_create(SVN_ERR_XML_MALFORMED, NULL, NULL);
+          if (! node
+              || node->file != (leaving_state == REPLAY_CHANGE_FILE_PROP))
+            return svn_error_trace(malformed_error());
 
-      ctx->root_node = apr_pcalloc(root_pool, sizeof(*ctx->root_node));
-      ctx->root_node->pool = root_pool;
+          if (svn_hash_gets(attrs, "del"))
+            value = NULL;
+          else
+            value = svn_base64_decode_string(cdata, scratch_pool);
 
-      ctx->current_node = ctx->root_node;
+          SVN_ERR(change_node_prop(ctx, svn_hash_gets(attrs, "name"), value,
+                                   scratch_pool));
+        }
+        break;
 
-      SVN_ERR(svn_cstring_atoi64(&rev, revstr));
-      SVN_ERR(ctx->editor->open_root(ctx->editor_baton, (svn_revnum_t)rev,
-                                     root_pool,
-                                     &ctx->current_node->baton));
+      case REPLAY_APPLY_TEXTDELTA:
+        SVN_ERR(end_textdelta(ctx));
+        break;
     }
-  else if (leaving_state == REPLAY_OPEN_DIRECTORY
-           || leaving_state == REPLAY_OPEN_FILE
-           || leaving_state == REPLAY_ADD_DIRECTORY
-           || leaving_state == REPLAY_ADD_FILE)
-    {
-      struct replay_node_t *node;
-      apr_pool_t *node_pool;
-      const char *name = svn_hash_gets(attrs, "name");
-      const char *rev_str;
-      apr_int64_t rev;
-
-      if (!ctx->current_node || ctx->current_node->file)
-        return svn_error_create(SVN_ERR_XML_MALFORMED, NULL, NULL);
-
-      node_pool = svn_pool_create(ctx->current_node->pool);
-      node = apr_pcalloc(node_pool, sizeof(*node));
-      node->pool = node_pool;
-      node->parent = ctx->current_node;
-
-      if (leaving_state == REPLAY_OPEN_DIRECTORY
-          || leaving_state == REPLAY_OPEN_FILE)
-        {
-          rev_str = svn_hash_gets(attrs, "rev");
-        }
-      else
-        rev_str = svn_hash_gets(attrs, "copyfrom-rev");
 
-      if (rev_str)
-        SVN_ERR(svn_cstring_atoi64(&rev, rev_str));
-      else
-        rev = SVN_INVALID_REVNUM;
+  return SVN_NO_ERROR;
+}
 
-      switch (leaving_state)
-        {
-          case REPLAY_OPEN_DIRECTORY:
-            node->file = FALSE;
-            SVN_ERR(ctx->editor->open_directory(name,
-                                    ctx->current_node->baton,
-                                    (svn_revnum_t)rev,
-                                    node->pool,
-                                    &node->baton));
-            break;
-          case REPLAY_OPEN_FILE:
-            node->file = TRUE;
-            SVN_ERR(ctx->editor->open_file(name,
-                                    ctx->current_node->baton,
-                                    (svn_revnum_t)rev,
-                                    node->pool,
-                                    &node->baton));
-            break;
-          case REPLAY_ADD_DIRECTORY:
-            node->file = FALSE;
-            SVN_ERR(ctx->editor->add_directory(
-                                    name,
-                                    ctx->current_node->baton,
-                                    SVN_IS_VALID_REVNUM(rev)
-                                        ? svn_hash_gets(attrs, "copyfrom-path")
-                                        : NULL,
-                                    (svn_revnum_t)rev,
-                                    node->pool,
-                                    &node->baton));
-            break;
-          case REPLAY_ADD_FILE:
-            node->file = TRUE;
-            SVN_ERR(ctx->editor->add_file(
-                                    name,
-                                    ctx->current_node->baton,
-                                    SVN_IS_VALID_REVNUM(rev)
-                                        ? svn_hash_gets(attrs, "copyfrom-path")
-                                        : NULL,
-                                    (svn_revnum_t)rev,
-                                    node->pool,
-                                    &node->baton));
-            break;
-          /* default: unreachable */
-        }
-      ctx->current_node = node;
-    }
-  else if (leaving_state == REPLAY_CLOSE_FILE)
-    {
-      struct replay_node_t *node = ctx->current_node;
+/* Conforms to svn_ra_serf__xml_cdata_t  */
+static svn_error_t *
+replay_cdata(svn_ra_serf__xml_estate_t *xes,
+             void *baton,
+             int current_state,
+             const char *data,
+             apr_size_t len,
+             apr_pool_t *scratch_pool)
+{
+  struct revision_report_t *ctx = baton;
 
-      if (! node || ! node->file)
-        return svn_error_create(SVN_ERR_XML_MALFORMED, NULL, NULL);
+  if (current_state == REPLAY_APPLY_TEXTDELTA)
+    SVN_ERR(write_textdelta(ctx, data, len));
 
-      SVN_ERR(ctx->editor->close_file(node->baton,
-                                      svn_hash_gets(attrs, "checksum"),
-                                      node->pool));
-      ctx->current_node = node->parent;
-      svn_pool_destroy(node->pool);
-    }
-  else if (leaving_state == REPLAY_CLOSE_DIRECTORY)
-    {
-      struct replay_node_t *node = ctx->current_node;
+  return SVN_NO_ERROR;
+}
 
-      if (! node || node->file)
-        return svn_error_create(SVN_ERR_XML_MALFORMED, NULL, NULL);
+/* Implements svn_frames__handler_t for replay-report responses.  BATON
+   is the revision_report_t.  This drives the editor just like
+   replay_opened() and replay_closed() do for the XML response. */
+static svn_error_t *
+replay_frame(void *baton,
+             char op,
+             const unsigned char *p,
+             const unsigned char *end,
+             apr_pool_t *scratch_pool)
+{
+  struct revision_report_t *ctx = baton;
+  const char *name;
+  const char *copyfrom_path;
+  svn_revnum_t rev;
 
-      SVN_ERR(ctx->editor->close_directory(node->baton, node->pool));
-      ctx->current_node = node->parent;
-      svn_pool_destroy(node->pool);
-    }
-  else if (leaving_state == REPLAY_DELETE_ENTRY)
-    {
-      struct replay_node_t *parent_node = ctx->current_node;
-      const char *name = svn_hash_gets(attrs, "name");
-      const char *revstr = svn_hash_gets(attrs, "rev");
-      apr_int64_t rev;
-
-      if (! parent_node || parent_node->file)
-        return svn_error_create(SVN_ERR_XML_MALFORMED, NULL, NULL);
-
-      SVN_ERR(svn_cstring_atoi64(&rev, revstr));
-      SVN_ERR(ctx->editor->delete_entry(name,
-                                        (svn_revnum_t)rev,
-                                        parent_node->baton,
-                                        scratch_pool));
-    }
-  else if (leaving_state == REPLAY_CHANGE_FILE_PROP
-           || leaving_state == REPLAY_CHANGE_DIRECTORY_PROP)
+  switch (op)
     {
-      struct replay_node_t *node = ctx->current_node;
-      const char *name;
-      const svn_string_t *value;
-
-      if (! node || node->file != (leaving_state == REPLAY_CHANGE_FILE_PROP))
-        return svn_error_create(SVN_ERR_XML_MALFORMED, NULL, NULL);
+      case SVN_DAV__FRAME_TARGET_REVISION:
+        SVN_ERR(svn_frames__read_rev(&rev, &p, end));
+        SVN_ERR(ctx->editor->set_target_revision(ctx->editor_baton, rev,
+                                                 scratch_pool));
+        break;
+
+      case SVN_DAV__FRAME_OPEN_ROOT:
+        SVN_ERR(svn_frames__read_rev(&rev, &p, end));
+        SVN_ERR(open_root_node(ctx, rev));
+        break;
+
+      case SVN_DAV__FRAME_OPEN_DIR:
+      case SVN_DAV__FRAME_OPEN_FILE:
+        SVN_ERR(svn_frames__read_cstring(&name, &p, end, scratch_pool));
+        SVN_ERR(svn_frames__read_rev(&rev, &p, end));
+        SVN_ERR(open_child_node(ctx, op == SVN_DAV__FRAME_OPEN_FILE, FALSE,
+                                name, rev, NULL));
+        break;
+
+      case SVN_DAV__FRAME_ADD_DIR:
+      case SVN_DAV__FRAME_ADD_FILE:
+        SVN_ERR(svn_frames__read_cstring(&name, &p, end, scratch_pool));
+        SVN_ERR(svn_frames__read_cstring(&copyfrom_path, &p, end,
+                                         scratch_pool));
+        SVN_ERR(svn_frames__read_rev(&rev, &p, end));
+        SVN_ERR(open_child_node(ctx, op == SVN_DAV__FRAME_ADD_FILE, TRUE,
+                                name, rev, copyfrom_path));
+        break;
+
+      case SVN_DAV__FRAME_DELETE_ENTRY:
+        SVN_ERR(svn_frames__read_cstring(&name, &p, end, scratch_pool));
+        SVN_ERR(svn_frames__read_rev(&rev, &p, end));
+        SVN_ERR(delete_child(ctx, name, rev, scratch_pool));
+        break;
+
+      case SVN_DAV__FRAME_SET_PROP:
+      case SVN_DAV__FRAME_REMOVE_PROP:
+        {
+          const svn_string_t *value = NULL;
 
-      name = svn_hash_gets(attrs, "name");
+          SVN_ERR(svn_frames__read_cstring(&name, &p, end, scratch_pool));
+          if (op == SVN_DAV__FRAME_SET_PROP)
+            SVN_ERR(svn_frames__read_string(&value, &p, end, scratch_pool));
 
-      if (svn_hash_gets(attrs, "del"))
-        value = NULL;
-      else
-        value = svn_base64_decode_string(cdata, scratch_pool);
+          SVN_ERR(change_node_prop(ctx, name, value, scratch_pool));
+        }
+        break;
 
-      if (node->file)
+      case SVN_DAV__FRAME_TXDELTA:
         {
-          SVN_ERR(ctx->editor->change_file_prop(node->baton, name, value,
-                                                scratch_pool));
+          const char *checksum;
+
+          SVN_ERR(svn_frames__read_cstring(&checksum, &p, end,
+                                           scratch_pool));
+          SVN_ERR(start_textdelta(ctx, checksum, FALSE /* base64 */));
         }
-      else
+        break;
+
+      case SVN_DAV__FRAME_SVNDIFF:
+        SVN_ERR(write_textdelta(ctx, (const char *)p, end - p));
+        break;
+
+      case SVN_DAV__FRAME_TXDELTA_END:
+        SVN_ERR(end_textdelta(ctx));
+        break;
+
+      case SVN_DAV__FRAME_CLOSE_FILE:
         {
-          SVN_ERR(ctx->editor->change_dir_prop(node->baton, name, value,
-                                               scratch_pool));
-        }
-    }
-  else if (leaving_state == REPLAY_APPLY_TEXTDELTA)
-    {
-      struct replay_node_t *node = ctx->current_node;
+          const char *checksum;
 
-      if (! node || ! node->file)
-        return svn_error_create(SVN_ERR_XML_MALFORMED, NULL, NULL);
+          SVN_ERR(svn_frames__read_cstring(&checksum, &p, end,
+                                           scratch_pool));
+          SVN_ERR(close_node(ctx, TRUE, checksum));
+        }
+        break;
 
-      if (node->stream)
-        SVN_ERR(svn_stream_close(node->stream));
+      case SVN_DAV__FRAME_CLOSE_DIR:
+        SVN_ERR(close_node(ctx, FALSE, NULL));
+        break;
 
-      node->stream = NULL;
+      default:
+        /* Ignore unknown frames for forward compatibility. */
+        break;
     }
+
   return SVN_NO_ERROR;
 }
 
-/* Conforms to svn_ra_serf__xml_cdata_t  */
+/* Implements svn_ra_serf__response_handler_t for replay-report responses.
+   BATON is the revision_report_t.  Depending on the Content-Type, this
+   parses binary frames or passes the response on to the XML parser. */
 static svn_error_t *
-replay_cdata(svn_ra_serf__xml_estate_t *xes,
-             void *baton,
-             int current_state,
-             const char *data,
-             apr_size_t len,
-             apr_pool_t *scratch_pool)
+replay_response_handler(serf_request_t *request,
+                        serf_bucket_t *response,
+                        void *baton,
+                        apr_pool_t *scratch_pool)
 {
   struct revision_report_t *ctx = baton;
+  svn_error_t *err;
 
-  if (current_state == REPLAY_APPLY_TEXTDELTA)
+  if (! ctx->format_checked)
     {
-      struct replay_node_t *node = ctx->current_node;
+      ctx->format_checked = TRUE;
 
-      if (! node || ! node->file)
-        return svn_error_create(SVN_ERR_XML_MALFORMED, NULL, NULL);
-
-      if (node->stream)
+      if (ctx->binary_frames
+          && svn_ra_serf__is_frames_response(ctx->report_handler, response))
         {
-          apr_size_t written = len;
+          SVN_ERR(start_revision(ctx, scratch_pool));
+          ctx->frame_parser = svn_frames__parser_create(
+                                        SVN_DAV__BINARY_UPDATE_MAGIC,
+                                        SVN_DAV__BINARY_UPDATE_MAGIC_LEN,
+                                        replay_frame, ctx, ctx->pool);
+        }
+    }
 
-          SVN_ERR(svn_stream_write(node->stream, data, &written));
-          if (written != len)
-            return svn_error_create(SVN_ERR_STREAM_UNEXPECTED_EOF, NULL,
-                                    _("Error writing stream: unexpected EOF"));
+  if (! ctx->frame_parser)
+    return svn_error_trace(ctx->xml_handler(request, response,
+                                            ctx->xml_handler_baton,
+                                            scratch_pool));
+
+  err = svn_ra_serf__handle_frames(request, response, ctx->frame_parser,
+                                   scratch_pool);
+
+  /* svn_ra_serf__handle_frames() reports EOF only for complete responses.
+     Finish the revision just like replay_closed() does at the end of the
+     XML document. */
+  if (err && APR_STATUS_IS_EOF(err->apr_err))
+    {
+      svn_error_t *finish_err = finish_revision(ctx, scratch_pool);
+
+      if (finish_err)
+        {
+          svn_error_clear(err);
+          return svn_error_trace(finish_err);
         }
     }
 
-  return SVN_NO_ERROR;
+  return svn_error_trace(err);
 }
 
 /* Implements svn_ra_serf__request_body_delegate_t */
@@ -488,6 +751,8 @@ create_replay_body(serf_bucket_t **bkt,
   svn_ra_serf__add_open_tag_buckets(body_bkt, alloc,
                                     "S:replay-report",
                                     "xmlns:S", SVN_XML_NAMESPACE,
+                                    SVN_DAV__BINARY_FRAMES,
+                                    ctx->binary_frames ? "true" : NULL,
                                     SVN_VA_NULL);
 
   /* If we have a non-NULL include path, we add it to the body and
@@ -548,6 +813,8 @@ svn_ra_serf__replay(svn_ra_session_t *ra_session,
   ctx.low_water_mark = low_water_mark;
   ctx.send_deltas = send_deltas;
   ctx.rev_props = apr_hash_make(scratch_pool);
+  ctx.binary_frames = (session->supports_binary_update
+                       && session->binary_frames);
 
   xmlctx = svn_ra_serf__xml_context_create(replay_ttable,
                                            replay_opened, replay_closed,
@@ -564,6 +831,13 @@ svn_ra_serf__replay(svn_ra_session_t *ra_session,
   handler->body_delegate_baton = &ctx;
   handler->body_type = "text/xml";
 
+  /* Look at the response format before parsing the response as XML. */
+  ctx.report_handler = handler;
+  ctx.xml_handler = handler->response_handler;
+  ctx.xml_handler_baton = handler->response_baton;
+  handler->response_handler = replay_response_handler;
+  handler->response_baton = &ctx;
+
   /* Not setting up done handler as we don't use a global context */
 
   SVN_ERR(svn_ra_serf__context_run_one(handler, scratch_pool));
@@ -742,6 +1016,8 @@ svn_ra_serf__replay_range(svn_ra_session_t *ra_session,
           rev_ctx->low_water_mark = low_water_mark;
           rev_ctx->send_deltas = send_deltas;
           rev_ctx->using_compression = session->using_compression;
+          rev_ctx->binary_frames = (session->supports_binary_update
+                                    && session->binary_frames);
 
           /* Request all properties of a certain revision. */
           rev_ctx->rev_props = apr_hash_make(rev_ctx->pool);
@@ -803,6 +1079,13 @@ svn_ra_serf__replay_range(svn_ra_session_t *ra_session,
           handler->header_delegate = setup_headers;
           handler->header_delegate_baton = rev_ctx;
 
+          /* Look at the response format before parsing the response as
+             XML. */
+          rev_ctx->xml_handler = handler->response_handler;
+          rev_ctx->xml_handler_baton = handler->response_baton;
+          handler->response_handler = replay_response_handler;
+          handler->response_baton = rev_ctx;
+
           rev_ctx->report_handler = handler;
           svn_ra_serf__request_create(handler);
 
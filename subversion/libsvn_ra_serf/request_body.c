@@ -212,6 +212,12 @@ svn_ra_serf__request_body_get_stream(svn_ra_serf__request_body_t *body)
   return body->stream;
 }
 
+apr_size_t
+svn_ra_serf__request_body_get_size(svn_ra_serf__request_body_t *body)
+{
+  return body->total_bytes;
+}
+
 void
 svn_ra_serf__request_body_get_delegate(svn_ra_serf__request_body_delegate_t *del,
                                        void **baton,
@@ -238,12 +238,24 @@ load_config(svn_ra_serf__session_t *session,
                                   "auto",
                                   svn_tristate_unknown));
 
+  /* Should we ask for binary frames instead of XML responses. */
+  SVN_ERR(svn_config_get_bool(config, &session->binary_frames,
+                              SVN_CONFIG_SECTION_GLOBAL,
+                              SVN_CONFIG_OPTION_HTTP_BINARY_FRAMES,
+                              TRUE));
+
   /* Load the maximum number of parallel session connections. */
   SVN_ERR(svn_config_get_int64(config, &session->max_connections,
                                SVN_CONFIG_SECTION_GLOBAL,
                                SVN_CONFIG_OPTION_HTTP_MAX_CONNECTIONS,
                                SVN_CONFIG_DEFAULT_OPTION_HTTP_MAX_CONNECTIONS));
 
+  /* Load the amount of data to send ahead during commits. */
+  SVN_ERR(svn_config_get_int64(config, &session->commit_pipeline_size,
+                               SVN_CONFIG_SECTION_GLOBAL,
+                               SVN_CONFIG_OPTION_HTTP_COMMIT_PIPELINE_SIZE,
+                               SVN_CONFIG_DEFAULT_OPTION_HTTP_COMMIT_PIPELINE_SIZE));
+
   /* Should we use chunked transfer encoding. */
   SVN_ERR(svn_config_get_tristate(config, &chunked_requests,
                                   SVN_CONFIG_SECTION_GLOBAL,
@@ -304,6 +316,12 @@ load_config(svn_ra_serf__session_t *session,
                                       "auto",
                                       session->bulk_updates));
 
+      /* Load the group binary frames flag. */
+      SVN_ERR(svn_config_get_bool(config, &session->binary_frames,
+                                  server_group,
+                                  SVN_CONFIG_OPTION_HTTP_BINARY_FRAMES,
+                                  session->binary_frames));
+
       /* Load the maximum number of parallel session connections,
          overriding global values. */
       SVN_ERR(svn_config_get_int64(config, &session->max_connections,
@@ -311,6 +329,12 @@ load_config(svn_ra_serf__session_t *session,
                                    SVN_CONFIG_OPTION_HTTP_MAX_CONNECTIONS,
                                    session->max_connections));
 
+      /* Load the commit pipeline size, overriding global values. */
+      SVN_ERR(svn_config_get_int64(config, &session->commit_pipeline_size,
+                                   server_group,
+                                   SVN_CONFIG_OPTION_HTTP_COMMIT_PIPELINE_SIZE,
+                                   session->commit_pipeline_size));
+
       /* Should we use chunked transfer encoding. */
       SVN_ERR(svn_config_get_tristate(config, &chunked_requests,
                                       server_group,
@@ -752,6 +776,8 @@ ra_serf_dup_session(svn_ra_session_t *new_session,
   /* svn_boolean_t supports_inline_props */
   /* supports_rev_rsrc_replay */
   /* supports_svndiff1 */
+  /* supports_svndiff3 */
+  /* supports_binary_update */
 
   new_sess->context = serf_context_create(result_pool);
 
@@ -1056,6 +1082,7 @@ static const svn_ra__vtable_t serf_vtable = {
   svn_ra_serf__get_inherited_props,
   NULL /* set_svn_ra_open */,
   NULL /* svn_ra_list */,
+  svn_ra_serf__get_blame,
   svn_ra_serf__register_editor_shim_callbacks,
   NULL /* commit_ev2 */,
   NULL /* replay_range_ev2 */
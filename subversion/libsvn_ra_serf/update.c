@@ -44,7 +44,9 @@
 #include "svn_private_config.h"
 #include "private/svn_dep_compat.h"
 #include "private/svn_fspath.h"
+#include "private/svn_request_sched.h"
 #include "private/svn_string_private.h"
+#include "private/svn_subr_private.h"
 
 #include "ra_serf.h"
 #include "../libsvn_ra/ra_loader.h"
@@ -251,7 +253,11 @@ static const svn_ra_serf__xml_transition_t update_ttable[] = {
    can make the measurements quite imprecise.
 
    We measure outstanding requests as the sum of NUM_ACTIVE_FETCHES and
-   NUM_ACTIVE_PROPFINDS in the report_context_t structure.  */
+   NUM_ACTIVE_PROPFINDS in the report_context_t structure.
+
+   REQUEST_COUNT_TO_RESUME is only the lower bound.  On fast links with
+   a high latency, the request scheduler will allow for more outstanding
+   requests; see max_active_requests(). */
 #define REQUEST_COUNT_TO_PAUSE 50
 #define REQUEST_COUNT_TO_RESUME 40
 
@@ -388,6 +394,9 @@ typedef struct fetch_ctx_t {
   /* The base-rev header  */
   const char *delta_base;
 
+  /* When we created the request; for the request scheduler. */
+  apr_time_t start_time;
+
 } fetch_ctx_t;
 
 /*
@@ -426,6 +435,12 @@ struct report_context_t {
      files/dirs? */
   svn_boolean_t add_props_included;
 
+  /* Did we ask the server to send binary frames instead of XML? */
+  svn_boolean_t binary_requested;
+
+  /* Parser for the binary frames, if the server sends them. */
+  svn_frames__parser_t *frame_parser;
+
   /* Path -> const char *repos_relpath mapping */
   apr_hash_t *switched_paths;
 
@@ -445,6 +460,11 @@ struct report_context_t {
   /* number of pending PROPFIND requests */
   unsigned int num_active_propfinds;
 
+  /* Decides how to spread these requests across connections. */
+  /* Adapts the number of auxiliary connections (i.e. not counting the one
+     that carries the REPORT) and the pipelining depth to the link. */
+  svn_request_sched__t sched;
+
   /* Are we done parsing the REPORT response? */
   svn_boolean_t done;
 
@@ -548,17 +568,37 @@ create_file_baton(file_baton_t **new_file,
  *  opened. */
 #define REQS_PER_CONN 8
 
+/* Return the maximum number of GET and PROPFIND requests that CTX shall
+   keep in flight. */
+static unsigned int
+max_active_requests(report_context_t *ctx)
+{
+  unsigned int limit = ctx->sched.active_conns * ctx->sched.pipeline_depth;
+
+  return limit > REQUEST_COUNT_TO_RESUME ? limit : REQUEST_COUNT_TO_RESUME;
+}
+
 /** This function creates a new connection for this serf session, but only
- * if the number of NUM_ACTIVE_REQS > REQS_PER_CONN or if there currently is
- * only one main connection open.
+ * if CTX's request scheduler wants to use more connections than are open
+ * or if there currently is only one main connection open.
  */
 static svn_error_t *
-open_connection_if_needed(svn_ra_serf__session_t *sess, int num_active_reqs)
+open_connection_if_needed(report_context_t *ctx)
 {
-  /* For each REQS_PER_CONN outstanding requests open a new connection, with
-   * a minimum of 1 extra connection. */
-  if (sess->num_conns == 1 ||
-      ((num_active_reqs / REQS_PER_CONN) > sess->num_conns))
+  svn_ra_serf__session_t *sess = ctx->sess;
+  svn_request_sched__t *sched = &ctx->sched;
+  unsigned int num_active_reqs = ctx->num_active_fetches
+                               + ctx->num_active_propfinds;
+
+  /* Until the scheduler measured anything, open a new connection for each
+   * REQS_PER_CONN outstanding requests. */
+  if (!sched->measured && !sess->http20
+      && (num_active_reqs / REQS_PER_CONN) > (unsigned int)sess->num_conns)
+    sched->active_conns = sess->num_conns;
+
+  /* Always open a minimum of 1 extra connection. */
+  if ((sess->num_conns == 1 || sess->num_conns <= sched->active_conns)
+      && sess->num_conns < sess->max_connections)
     {
       int cur = sess->num_conns;
       apr_status_t status;
@@ -591,6 +631,11 @@ get_best_connection(report_context_t *ctx)
 {
   svn_ra_serf__connection_t *conn;
   int first_conn = 1;
+  int num_conns = ctx->sess->num_conns;
+
+  /* Don't schedule on connections the request scheduler retired. */
+  if (num_conns > 1 + ctx->sched.active_conns)
+    num_conns = 1 + ctx->sched.active_conns;
 
   /* Skip the first connection if the REPORT response hasn't been completely
      received yet or if we're being told to limit our connections to
@@ -610,7 +655,7 @@ get_best_connection(report_context_t *ctx)
 
   /* If there's only one available auxiliary connection to use, don't bother
      doing all the cur_conn math -- just return that one connection.  */
-  if (ctx->sess->num_conns - first_conn == 1)
+  if (num_conns - first_conn == 1)
     {
       conn = ctx->sess->conns[first_conn];
     }
@@ -629,7 +674,7 @@ get_best_connection(report_context_t *ctx)
        */
       int i, best_conn = first_conn;
       unsigned int min = INT_MAX;
-      for (i = first_conn; i < ctx->sess->num_conns; i++)
+      for (i = first_conn; i < num_conns; i++)
         {
           serf_connection_t *sc = ctx->sess->conns[i]->conn;
           unsigned int pending = serf_connection_pending_requests(sc);
@@ -642,10 +687,15 @@ get_best_connection(report_context_t *ctx)
       conn = ctx->sess->conns[best_conn];
 #else
     /* We don't know how many requests are pending per connection, so just
-       cycle them. */
+       cycle them.  Start over if CUR_CONN points to a connection that
+       the request scheduler retired or that we shall skip. */
+      if (ctx->sess->cur_conn < first_conn
+          || ctx->sess->cur_conn >= num_conns)
+        ctx->sess->cur_conn = first_conn;
+
       conn = ctx->sess->conns[ctx->sess->cur_conn];
       ctx->sess->cur_conn++;
-      if (ctx->sess->cur_conn >= ctx->sess->num_conns)
+      if (ctx->sess->cur_conn >= num_conns)
         ctx->sess->cur_conn = first_conn;
 #endif
     }
@@ -1182,6 +1232,8 @@ file_fetch_done(serf_request_t *request,
   fetch_ctx_t *fetch_ctx = baton;
   file_baton_t *file = fetch_ctx->file;
   svn_ra_serf__handler_t *handler = fetch_ctx->handler;
+  report_context_t *ctx = file->parent_dir->ctx;
+  apr_time_t now;
 
   if (handler->server_error)
       return svn_error_trace(svn_ra_serf__server_error_create(handler,
@@ -1190,6 +1242,13 @@ file_fetch_done(serf_request_t *request,
   if (handler->sline.code != 200)
     return svn_error_trace(svn_ra_serf__unexpected_status(handler));
 
+  now = apr_time_now();
+  svn_request_sched__request_done(&ctx->sched, now,
+                                  now - fetch_ctx->start_time,
+                                  fetch_ctx->read_size,
+                                  ctx->num_active_fetches
+                                  + ctx->num_active_propfinds);
+
   file->parent_dir->ctx->num_active_fetches--;
 
   file->fetch_file = FALSE;
@@ -1217,9 +1276,7 @@ fetch_for_file(file_baton_t *file,
   svn_ra_serf__handler_t *handler;
 
   /* Open extra connections if we have enough requests to send. */
-  if (ctx->sess->num_conns < ctx->sess->max_connections)
-    SVN_ERR(open_connection_if_needed(ctx->sess, ctx->num_active_fetches +
-                                                 ctx->num_active_propfinds));
+  SVN_ERR(open_connection_if_needed(ctx));
 
   /* What connection should we go on? */
   conn = get_best_connection(ctx);
@@ -1347,6 +1404,7 @@ fetch_for_file(file_baton_t *file,
           handler->done_delegate_baton = fetch_ctx;
 
           fetch_ctx->handler = handler;
+          fetch_ctx->start_time = apr_time_now();
 
           svn_ra_serf__request_create(handler);
 
@@ -1445,9 +1503,7 @@ fetch_for_dir(dir_baton_t *dir,
   svn_ra_serf__connection_t *conn;
 
   /* Open extra connections if we have enough requests to send. */
-  if (ctx->sess->num_conns < ctx->sess->max_connections)
-    SVN_ERR(open_connection_if_needed(ctx->sess, ctx->num_active_fetches +
-                                                 ctx->num_active_propfinds));
+  SVN_ERR(open_connection_if_needed(ctx));
 
   /* What connection should we go on? */
   conn = get_best_connection(ctx);
@@ -2044,6 +2100,335 @@ update_cdata(svn_ra_serf__xml_estate_t *xes,
 }
 
 
+/** Binary frame callbacks for our update-report response parsing */
+
+/* Return an error about a malformed binary update-report response. */
+static svn_error_t *
+malformed_frame_error(void)
+{
+  return svn_error_create(SVN_ERR_RA_DAV_MALFORMED_DATA, NULL,
+                          _("Malformed binary frame in update-report "
+                            "response"));
+}
+
+/* Implements svn_frames__handler_t for update-report responses.  BATON
+   is the report_context_t.  This drives the editor just like
+   update_opened() and update_closed() do for the XML response. */
+static svn_error_t *
+process_frame(void *baton,
+              char op,
+              const unsigned char *p,
+              const unsigned char *end,
+              apr_pool_t *scratch_pool)
+{
+  report_context_t *ctx = baton;
+  const char *name;
+  svn_revnum_t rev;
+
+  /* Frames about children of the current directory or about the current
+     file require the respective context. */
+  switch (op)
+    {
+      case SVN_DAV__FRAME_OPEN_DIR:
+      case SVN_DAV__FRAME_ADD_DIR:
+      case SVN_DAV__FRAME_OPEN_FILE:
+      case SVN_DAV__FRAME_ADD_FILE:
+      case SVN_DAV__FRAME_DELETE_ENTRY:
+      case SVN_DAV__FRAME_ABSENT_DIR:
+      case SVN_DAV__FRAME_ABSENT_FILE:
+      case SVN_DAV__FRAME_CLOSE_DIR:
+        if (!ctx->cur_dir || ctx->cur_file)
+          return svn_error_trace(malformed_frame_error());
+        break;
+
+      case SVN_DAV__FRAME_TXDELTA:
+      case SVN_DAV__FRAME_SVNDIFF:
+      case SVN_DAV__FRAME_TXDELTA_END:
+      case SVN_DAV__FRAME_CLOSE_FILE:
+        if (!ctx->cur_file)
+          return svn_error_trace(malformed_frame_error());
+        break;
+
+      case SVN_DAV__FRAME_CHECKED_IN:
+      case SVN_DAV__FRAME_SET_PROP:
+      case SVN_DAV__FRAME_REMOVE_PROP:
+        if (!ctx->cur_dir)
+          return svn_error_trace(malformed_frame_error());
+        break;
+    }
+
+  switch (op)
+    {
+      case SVN_DAV__FRAME_TARGET_REVISION:
+        SVN_ERR(svn_frames__read_rev(&rev, &p, end));
+        SVN_ERR(ctx->editor->set_target_revision(ctx->editor_baton, rev,
+                                                 scratch_pool));
+        break;
+
+      case SVN_DAV__FRAME_OPEN_ROOT:
+        {
+          dir_baton_t *dir;
+
+          if (ctx->cur_dir)
+            return svn_error_trace(malformed_frame_error());
+
+          SVN_ERR(svn_frames__read_rev(&rev, &p, end));
+          SVN_ERR(create_dir_baton(&dir, ctx, "", scratch_pool));
+          dir->base_rev = rev;
+        }
+        break;
+
+      case SVN_DAV__FRAME_OPEN_DIR:
+      case SVN_DAV__FRAME_ADD_DIR:
+        {
+          dir_baton_t *dir;
+
+          SVN_ERR(svn_frames__read_cstring(&name, &p, end, scratch_pool));
+          if (!name)
+            return svn_error_trace(malformed_frame_error());
+
+          SVN_ERR(create_dir_baton(&dir, ctx, name, scratch_pool));
+
+          if (op == SVN_DAV__FRAME_OPEN_DIR)
+            {
+              SVN_ERR(svn_frames__read_rev(&dir->base_rev, &p, end));
+            }
+          else
+            {
+              SVN_ERR(svn_frames__read_cstring(&dir->copyfrom_path, &p, end,
+                                               dir->pool));
+              SVN_ERR(svn_frames__read_rev(&rev, &p, end));
+
+              if (dir->copyfrom_path)
+                {
+                  dir->copyfrom_path = svn_fspath__canonicalize(
+                                                        dir->copyfrom_path,
+                                                        dir->pool);
+                  dir->copyfrom_rev = rev;
+                }
+            }
+        }
+        break;
+
+      case SVN_DAV__FRAME_OPEN_FILE:
+      case SVN_DAV__FRAME_ADD_FILE:
+        {
+          file_baton_t *file;
+
+          SVN_ERR(svn_frames__read_cstring(&name, &p, end, scratch_pool));
+          if (!name)
+            return svn_error_trace(malformed_frame_error());
+
+          SVN_ERR(create_file_baton(&file, ctx, name, scratch_pool));
+
+          if (op == SVN_DAV__FRAME_OPEN_FILE)
+            {
+              SVN_ERR(svn_frames__read_rev(&file->base_rev, &p, end));
+            }
+          else
+            {
+              const char *sha1_checksum;
+
+              SVN_ERR(svn_frames__read_cstring(&file->copyfrom_path, &p, end,
+                                               file->pool));
+              SVN_ERR(svn_frames__read_rev(&rev, &p, end));
+
+              if (file->copyfrom_path)
+                {
+                  file->copyfrom_path = svn_fspath__canonicalize(
+                                                        file->copyfrom_path,
+                                                        file->pool);
+                  file->copyfrom_rev = rev;
+                }
+
+              SVN_ERR(svn_frames__read_cstring(&sha1_checksum, &p, end,
+                                               scratch_pool));
+              if (sha1_checksum)
+                SVN_ERR(svn_checksum_parse_hex(&file->final_sha1_checksum,
+                                               svn_checksum_sha1,
+                                               sha1_checksum,
+                                               file->pool));
+            }
+        }
+        break;
+
+      case SVN_DAV__FRAME_CHECKED_IN:
+        {
+          const char *href;
+
+          SVN_ERR(svn_frames__read_cstring(&href, &p, end, scratch_pool));
+          if (ctx->cur_file)
+            ctx->cur_file->url = apr_pstrdup(ctx->cur_file->pool, href);
+          else
+            ctx->cur_dir->url = apr_pstrdup(ctx->cur_dir->pool, href);
+        }
+        break;
+
+      case SVN_DAV__FRAME_SET_PROP:
+      case SVN_DAV__FRAME_REMOVE_PROP:
+        {
+          const svn_string_t *value = NULL;
+
+          SVN_ERR(svn_frames__read_cstring(&name, &p, end, scratch_pool));
+          if (!name)
+            return svn_error_trace(malformed_frame_error());
+
+          if (op == SVN_DAV__FRAME_SET_PROP)
+            SVN_ERR(svn_frames__read_string(&value, &p, end, scratch_pool));
+
+          /* Binary frames imply send-all mode, so there is no need to
+             defer property removals as update_closed() does. */
+          if (ctx->cur_file)
+            {
+              SVN_ERR(ensure_file_opened(ctx->cur_file, scratch_pool));
+              SVN_ERR(ctx->editor->change_file_prop(ctx->cur_file->file_baton,
+                                                    name, value,
+                                                    scratch_pool));
+            }
+          else
+            {
+              SVN_ERR(ensure_dir_opened(ctx->cur_dir, scratch_pool));
+              SVN_ERR(ctx->editor->change_dir_prop(ctx->cur_dir->dir_baton,
+                                                   name, value,
+                                                   scratch_pool));
+            }
+        }
+        break;
+
+      case SVN_DAV__FRAME_TXDELTA:
+        {
+          file_baton_t *file = ctx->cur_file;
+          const char *base_checksum;
+
+          SVN_ERR(svn_frames__read_cstring(&base_checksum, &p, end,
+                                           scratch_pool));
+          if (base_checksum)
+            SVN_ERR(svn_checksum_parse_hex(&file->base_md5_checksum,
+                                           svn_checksum_md5, base_checksum,
+                                           file->pool));
+
+          SVN_ERR(open_file_txdelta(file, scratch_pool));
+
+          /* Unlike the XML response, the svndiff data is not base64
+             encoded. */
+          if (file->txdelta != svn_delta_noop_window_handler)
+            file->txdelta_stream = svn_txdelta_parse_svndiff(
+                                                  file->txdelta,
+                                                  file->txdelta_baton,
+                                                  TRUE /* error early close*/,
+                                                  file->pool);
+        }
+        break;
+
+      case SVN_DAV__FRAME_SVNDIFF:
+        if (ctx->cur_file->txdelta_stream)
+          {
+            apr_size_t len = end - p;
+
+            SVN_ERR(svn_stream_write(ctx->cur_file->txdelta_stream,
+                                     (const char *)p, &len));
+          }
+        break;
+
+      case SVN_DAV__FRAME_TXDELTA_END:
+        if (ctx->cur_file->txdelta_stream)
+          {
+            SVN_ERR(svn_stream_close(ctx->cur_file->txdelta_stream));
+            ctx->cur_file->txdelta_stream = NULL;
+          }
+        break;
+
+      case SVN_DAV__FRAME_CLOSE_FILE:
+        {
+          file_baton_t *file = ctx->cur_file;
+          const char *md5_checksum;
+
+          SVN_ERR(svn_frames__read_cstring(&md5_checksum, &p, end,
+                                           scratch_pool));
+          if (md5_checksum)
+            SVN_ERR(svn_checksum_parse_hex(&file->final_md5_checksum,
+                                           svn_checksum_md5, md5_checksum,
+                                           file->pool));
+
+          ctx->cur_file = NULL;
+          SVN_ERR(close_file(file, scratch_pool));
+        }
+        break;
+
+      case SVN_DAV__FRAME_CLOSE_DIR:
+        {
+          dir_baton_t *dir = ctx->cur_dir;
+
+          ctx->cur_dir = dir->parent_dir;
+          SVN_ERR(maybe_close_dir(dir));
+        }
+        break;
+
+      case SVN_DAV__FRAME_DELETE_ENTRY:
+        SVN_ERR(svn_frames__read_cstring(&name, &p, end, scratch_pool));
+        SVN_ERR(svn_frames__read_rev(&rev, &p, end));
+        if (!name)
+          return svn_error_trace(malformed_frame_error());
+
+        SVN_ERR(ensure_dir_opened(ctx->cur_dir, scratch_pool));
+        SVN_ERR(ctx->editor->delete_entry(
+                                  svn_relpath_join(ctx->cur_dir->relpath,
+                                                   name, scratch_pool),
+                                  rev, ctx->cur_dir->dir_baton,
+                                  scratch_pool));
+        break;
+
+      case SVN_DAV__FRAME_ABSENT_DIR:
+      case SVN_DAV__FRAME_ABSENT_FILE:
+        {
+          const char *relpath;
+
+          SVN_ERR(svn_frames__read_cstring(&name, &p, end, scratch_pool));
+          if (!name)
+            return svn_error_trace(malformed_frame_error());
+
+          SVN_ERR(ensure_dir_opened(ctx->cur_dir, scratch_pool));
+          relpath = svn_relpath_join(ctx->cur_dir->relpath, name,
+                                     scratch_pool);
+
+          if (op == SVN_DAV__FRAME_ABSENT_DIR)
+            SVN_ERR(ctx->editor->absent_directory(relpath,
+                                                  ctx->cur_dir->dir_baton,
+                                                  scratch_pool));
+          else
+            SVN_ERR(ctx->editor->absent_file(relpath,
+                                             ctx->cur_dir->dir_baton,
+                                             scratch_pool));
+        }
+        break;
+
+      default:
+        /* Ignore unknown frames for forward compatibility. */
+        break;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_ra_serf__response_handler_t for update-report responses
+   consisting of binary frames.  BATON is the report_context_t. */
+static svn_error_t *
+handle_update_frames(serf_request_t *request,
+                     serf_bucket_t *response,
+                     void *baton,
+                     apr_pool_t *scratch_pool)
+{
+  report_context_t *ctx = baton;
+  svn_error_t *err;
+
+  err = svn_ra_serf__handle_frames(request, response, ctx->frame_parser,
+                                   scratch_pool);
+  ctx->done = svn_frames__parser_done(ctx->frame_parser);
+
+  return svn_error_trace(err);
+}
+
+
 /** Editor callbacks given to callers to create request body */
 
 /* Helper to create simple xml tag without attributes. */
@@ -2179,11 +2564,40 @@ setup_update_report_headers(serf_bucket_t *headers,
 typedef struct update_delay_baton_t
 {
   report_context_t *report;
+  svn_ra_serf__handler_t *handler;
   svn_spillbuf_t *spillbuf;
   svn_ra_serf__response_handler_t inner_handler;
   void *inner_handler_baton;
+
+  /* Did we check the response format yet? */
+  svn_boolean_t format_checked;
 } update_delay_baton_t;
 
+/* If we asked for binary frames and the server sent them, according to
+   the Content-Type of RESPONSE, make UDB parse them instead of XML. */
+static void
+maybe_use_binary_frames(update_delay_baton_t *udb,
+                        serf_bucket_t *response)
+{
+  report_context_t *report = udb->report;
+
+  if (report->binary_requested
+      && svn_ra_serf__is_frames_response(udb->handler, response))
+    {
+      /* Binary frames are only sent in send-all mode. */
+      report->send_all_mode = TRUE;
+      report->add_props_included = TRUE;
+      report->frame_parser = svn_frames__parser_create(
+                                        SVN_DAV__BINARY_UPDATE_MAGIC,
+                                        SVN_DAV__BINARY_UPDATE_MAGIC_LEN,
+                                        process_frame, report,
+                                        report->pool);
+
+      udb->inner_handler = handle_update_frames;
+      udb->inner_handler_baton = report;
+    }
+}
+
 /* Helper for update_delay_handler() and process_pending() to
    call UDB->INNER_HANDLER with buffer pointed by DATA. */
 static svn_error_t *
@@ -2237,6 +2651,12 @@ update_delay_handler(serf_request_t *request,
   apr_status_t status;
   apr_pool_t *iterpool = NULL;
 
+  if (! udb->format_checked)
+    {
+      maybe_use_binary_frames(udb, response);
+      udb->format_checked = TRUE;
+    }
+
   if (! udb->spillbuf)
     {
       if (udb->report->send_all_mode)
@@ -2253,7 +2673,7 @@ update_delay_handler(serf_request_t *request,
         }
 
       while ((udb->report->num_active_fetches + udb->report->num_active_propfinds)
-                 < REQUEST_COUNT_TO_RESUME)
+                 < max_active_requests(udb->report))
         {
           const char *data;
           apr_size_t len;
@@ -2337,7 +2757,7 @@ process_pending(update_delay_baton_t *udb,
   serf_bucket_alloc_t *alloc = NULL;
 
   while ((udb->report->num_active_fetches + udb->report->num_active_propfinds)
-            < REQUEST_COUNT_TO_RESUME)
+            < max_active_requests(udb->report))
     {
       const char *data;
       apr_size_t len;
@@ -2401,6 +2821,7 @@ process_editor_report(report_context_t *ctx,
      out too many requests at once */
   ud = apr_pcalloc(scratch_pool, sizeof(*ud));
   ud->report = ctx;
+  ud->handler = handler;
 
   ud->inner_handler = handler->response_handler;
   ud->inner_handler_baton = handler->response_baton;
@@ -2409,7 +2830,7 @@ process_editor_report(report_context_t *ctx,
   handler->response_baton = ud;
 
   /* Open the first extra connection. */
-  SVN_ERR(open_connection_if_needed(sess, 0));
+  SVN_ERR(open_connection_if_needed(ctx));
 
   sess->cur_conn = 1;
 
@@ -2607,6 +3028,9 @@ make_update_reporter(svn_ra_session_t *ra_session,
   report->editor_baton = update_baton;
   report->done = FALSE;
 
+  svn_request_sched__init(&report->sched, sess->max_connections - 1,
+                          sess->http20);
+
   *reporter = &ra_serf_reporter;
   *report_baton = report;
 
@@ -2676,9 +3100,17 @@ make_update_reporter(svn_ra_session_t *ra_session,
 
   if (use_bulk_updates)
     {
+      /* Binary frames avoid base64 encoding the deltas and the XML
+         overhead.  We check the response type, so older servers can
+         safely ignore this request. */
+      report->binary_requested = (sess->supports_binary_update
+                                  && sess->binary_frames);
+
       svn_xml_make_open_tag(&buf, scratch_pool, svn_xml_normal,
                             "S:update-report",
                             "xmlns:S", SVN_XML_NAMESPACE, "send-all", "true",
+                            SVN_DAV__BINARY_FRAMES,
+                            report->binary_requested ? "true" : NULL,
                             SVN_VA_NULL);
     }
   else
@@ -1070,6 +1070,54 @@ svn_ra_serf__handle_discard_body(serf_request_t *request,
   return SVN_NO_ERROR;
 }
 
+svn_boolean_t
+svn_ra_serf__is_frames_response(svn_ra_serf__handler_t *handler,
+                                serf_bucket_t *response)
+{
+  serf_bucket_t *hdrs;
+  const char *val;
+
+  if (handler->sline.code != 200)
+    return FALSE;
+
+  hdrs = serf_bucket_response_get_headers(response);
+  val = serf_bucket_headers_get(hdrs, "Content-Type");
+
+  return val && strncmp(val, SVN_DAV__BINARY_UPDATE_MIME_TYPE,
+                        sizeof(SVN_DAV__BINARY_UPDATE_MIME_TYPE) - 1) == 0;
+}
+
+/* Implements svn_ra_serf__response_handler_t */
+svn_error_t *
+svn_ra_serf__handle_frames(serf_request_t *request,
+                           serf_bucket_t *response,
+                           void *baton,
+                           apr_pool_t *scratch_pool)
+{
+  svn_frames__parser_t *parser = baton;
+
+  while (1)
+    {
+      apr_status_t status;
+      const char *data;
+      apr_size_t len;
+
+      status = serf_bucket_read(response, SERF_READ_ALL_AVAIL, &data, &len);
+      if (SERF_BUCKET_READ_ERROR(status))
+        return svn_ra_serf__wrap_err(status, NULL);
+
+      SVN_ERR(svn_frames__parser_feed(parser, data, len, scratch_pool));
+
+      if (APR_STATUS_IS_EOF(status))
+        SVN_ERR(svn_frames__parser_finish(parser));
+
+      if (status)
+        return svn_ra_serf__wrap_err(status, NULL);
+    }
+
+  /* NOTREACHED */
+}
+
 apr_status_t
 svn_ra_serf__response_discard_handler(serf_request_t *request,
                                       serf_bucket_t *response,
@@ -2031,7 +2079,8 @@ svn_ra_serf__setup_svndiff_accept_encoding(serf_bucket_t *headers,
   if (using_compression)
     {
       serf_bucket_headers_setn(headers, "Accept-Encoding",
-                               "gzip,svndiff1;q=0.9,svndiff;q=0.8");
+                               "gzip,svndiff3;q=0.95,svndiff1;q=0.9,"
+                               "svndiff;q=0.8");
     }
   else
     {
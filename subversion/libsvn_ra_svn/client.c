@@ -86,6 +86,11 @@ typedef struct ra_svn_reporter_baton_t {
   apr_pool_t *pool;
   const svn_delta_editor_t *editor;
   void *edit_baton;
+
+  /* The update target and, if we fetch file contents over additional
+     connections, the fetch editor. */
+  const char *target;
+  svn_ra_svn__fetch_baton_t *fetch;
 } ra_svn_reporter_baton_t;
 
 /* Parse an svn URL's tunnel portion into tunnel, if there is a tunnel
@@ -251,6 +256,13 @@ static svn_error_t *handle_auth_request(svn_ra_svn__session_baton_t *sess,
   return DO_AUTH(sess, mechlist, realm, pool);
 }
 
+svn_error_t *
+svn_ra_svn__handle_auth_request(svn_ra_svn__session_baton_t *sess,
+                                apr_pool_t *pool)
+{
+  return svn_error_trace(handle_auth_request(sess, pool));
+}
+
 /* --- REPORTER IMPLEMENTATION --- */
 
 static svn_error_t *ra_svn_set_path(void *baton, const char *path,
@@ -288,6 +300,20 @@ static svn_error_t *ra_svn_link_path(void *baton, const char *path,
 
   SVN_ERR(svn_ra_svn__write_cmd_link_path(b->conn, pool, path, url, rev,
                                           start_empty, lock_token, depth));
+
+  /* The server will update this sub-tree to URL, so that's where we
+     must fetch the file contents from. */
+  if (b->fetch)
+    {
+      const char *repos_relpath
+        = svn_uri_skip_ancestor(b->conn->repos_root, url, pool);
+
+      if (repos_relpath)
+        svn_ra_svn__fetch_link_path(b->fetch,
+                                    svn_relpath_join(b->target, path, pool),
+                                    repos_relpath);
+    }
+
   return SVN_NO_ERROR;
 }
 
@@ -322,7 +348,9 @@ static svn_ra_reporter3_t ra_svn_reporter = {
 };
 
 /* Set *REPORTER and *REPORT_BATON to a new reporter which will drive
- * EDITOR/EDIT_BATON when it gets the finish_report() call.
+ * EDITOR/EDIT_BATON when it gets the finish_report() call.  If FETCH is
+ * not NULL, EDITOR wraps the fetch editor FETCH, which needs to know
+ * about linked paths.
  *
  * Allocate the new reporter in POOL.
  */
@@ -333,6 +361,7 @@ ra_svn_get_reporter(svn_ra_svn__session_baton_t *sess_baton,
                     void *edit_baton,
                     const char *target,
                     svn_depth_t depth,
+                    svn_ra_svn__fetch_baton_t *fetch,
                     const svn_ra_reporter3_t **reporter,
                     void **report_baton)
 {
@@ -361,6 +390,8 @@ ra_svn_get_reporter(svn_ra_svn__session_baton_t *sess_baton,
   b->pool = pool;
   b->editor = editor;
   b->edit_baton = edit_baton;
+  b->target = target;
+  b->fetch = fetch;
 
   *reporter = &ra_svn_reporter;
   *report_baton = b;
@@ -603,6 +634,38 @@ static apr_status_t close_tunnel_cleanup(void *baton)
   return APR_SUCCESS; /* ignored */
 }
 
+/* Set *FETCH_CONNECTIONS to the number of additional connections that
+   updates shall fetch file contents over, as configured in the servers
+   section of CONFIG for the server group found in AUTH_BATON. */
+static svn_error_t *
+get_fetch_connections(int *fetch_connections,
+                      apr_hash_t *config,
+                      svn_auth_baton_t *auth_baton)
+{
+  svn_config_t *cfg = config
+                    ? svn_hash_gets(config, SVN_CONFIG_CATEGORY_SERVERS)
+                    : NULL;
+  const char *server_group = svn_auth_get_parameter(auth_baton,
+                                                 SVN_AUTH_PARAM_SERVER_GROUP);
+  apr_int64_t value;
+
+  SVN_ERR(svn_config_get_int64(cfg, &value, SVN_CONFIG_SECTION_GLOBAL,
+                               SVN_CONFIG_OPTION_SVN_FETCH_CONNECTIONS,
+                               SVN_CONFIG_DEFAULT_OPTION_SVN_FETCH_CONNECTIONS));
+  if (server_group)
+    SVN_ERR(svn_config_get_int64(cfg, &value, server_group,
+                                 SVN_CONFIG_OPTION_SVN_FETCH_CONNECTIONS,
+                                 value));
+
+  if (value < 0)
+    value = 0;
+  else if (value > SVN_RA_SVN__MAX_FETCH_CONNECTIONS)
+    value = SVN_RA_SVN__MAX_FETCH_CONNECTIONS;
+
+  *fetch_connections = (int)value;
+  return SVN_NO_ERROR;
+}
+
 /* Open a session to URL, returning it in *SESS_P, allocating it in POOL.
    URI is a parsed version of URL.  CALLBACKS and CALLBACKS_BATON
    are provided by the caller of ra_svn_open. If TUNNEL_NAME is not NULL,
@@ -654,6 +717,9 @@ static svn_error_t *open_session(svn_ra_svn__session_baton_t **sess_p,
   else
     sess->config = NULL;
 
+  SVN_ERR(get_fetch_connections(&sess->fetch_connections, config,
+                                auth_baton));
+
   if (tunnel_name)
     {
       sess->realm_prefix = apr_psprintf(pool, "<svn+%s://%s:%d>",
@@ -746,10 +812,12 @@ static svn_error_t *open_session(svn_ra_svn__session_baton_t **sess_p,
    * capability list, and the URL, and subsequently there is an auth
    * request. */
   /* Client-side capabilities list: */
-  SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "n(wwwwww)cc(?c)",
+  SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "n(wwwwwwww)cc(?c)",
                                   (apr_uint64_t) 2,
                                   SVN_RA_SVN_CAP_EDIT_PIPELINE,
                                   SVN_RA_SVN_CAP_SVNDIFF1,
+                                  SVN_RA_SVN_CAP_ACCEPTS_SVNDIFF2,
+                                  SVN_RA_SVN_CAP_ACCEPTS_SVNDIFF3,
                                   SVN_RA_SVN_CAP_ABSENT_ENTRIES,
                                   SVN_RA_SVN_CAP_DEPTH,
                                   SVN_RA_SVN_CAP_MERGEINFO,
@@ -786,6 +854,28 @@ static svn_error_t *open_session(svn_ra_svn__session_baton_t **sess_p,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_ra_svn__open_aux_session(svn_ra_svn__session_baton_t **aux_p,
+                             svn_ra_svn__session_baton_t *sess,
+                             apr_pool_t *result_pool,
+                             apr_pool_t *scratch_pool)
+{
+  const char *url = sess->conn->repos_root;
+  svn_ra_callbacks2_t *callbacks;
+  apr_uri_t uri;
+
+  /* The caller accounts for the traffic on the new connection. */
+  callbacks = apr_pmemdup(result_pool, sess->callbacks, sizeof(*callbacks));
+  callbacks->progress_func = NULL;
+
+  SVN_ERR(parse_url(url, &uri, result_pool));
+  SVN_ERR(open_session(aux_p, url, &uri, sess->tunnel_name, sess->tunnel_argv,
+                       sess->config, callbacks, sess->callbacks_baton,
+                       sess->auth_baton, result_pool, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
 
 #ifdef SVN_HAVE_SASL
 #define RA_SVN_DESCRIPTION \
@@ -1679,20 +1769,50 @@ static svn_error_t *ra_svn_update(svn_ra_session_t *session,
   svn_ra_svn__session_baton_t *sess_baton = session->priv;
   svn_ra_svn_conn_t *conn = sess_baton->conn;
   svn_boolean_t recurse = DEPTH_TO_RECURSE(depth);
+  svn_ra_svn__fetch_baton_t *fetch = NULL;
 
   /* Callbacks may assume that all data is relative the sessions's URL. */
   SVN_ERR(ensure_exact_server_parent(session, scratch_pool));
 
+  /* If configured, let the server send the tree structure only and fetch
+   * the file contents over additional connections.  Make sure we can
+   * open the first one before we decide on that. */
+  if (sess_baton->fetch_connections > 0
+      && conn->repos_root
+      && svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_FETCH_MANY))
+    {
+      const char *base_relpath
+        = svn_uri_skip_ancestor(conn->repos_root,
+                                sess_baton->parent->client_url->data, pool);
+      svn_ra_svn__session_baton_t *aux_sess;
+      svn_error_t *err = SVN_NO_ERROR;
+
+      if (base_relpath)
+        err = svn_ra_svn__open_aux_session(&aux_sess, sess_baton, pool,
+                                           scratch_pool);
+      if (err)
+        svn_error_clear(err);
+      else if (base_relpath)
+        {
+          SVN_ERR(svn_ra_svn__get_fetch_editor(&update_editor, &fetch,
+                                               sess_baton, aux_sess,
+                                               base_relpath,
+                                               update_editor, update_baton,
+                                               pool));
+          update_baton = fetch;
+        }
+    }
+
   /* Tell the server we want to start an update. */
   SVN_ERR(svn_ra_svn__write_cmd_update(conn, pool, rev, target, recurse,
                                        depth, send_copyfrom_args,
-                                       ignore_ancestry));
+                                       ignore_ancestry, fetch == NULL));
   SVN_ERR(handle_auth_request(sess_baton, pool));
 
   /* Fetch a reporter for the caller to drive.  The reporter will drive
    * update_editor upon finish_report(). */
   SVN_ERR(ra_svn_get_reporter(sess_baton, pool, update_editor, update_baton,
-                              target, depth, reporter, report_baton));
+                              target, depth, fetch, reporter, report_baton));
   return SVN_NO_ERROR;
 }
 
@@ -1726,7 +1846,7 @@ ra_svn_switch(svn_ra_session_t *session,
   /* Fetch a reporter for the caller to drive.  The reporter will drive
    * update_editor upon finish_report(). */
   SVN_ERR(ra_svn_get_reporter(sess_baton, pool, update_editor, update_baton,
-                              target, depth, reporter, report_baton));
+                              target, depth, NULL, reporter, report_baton));
   return SVN_NO_ERROR;
 }
 
@@ -1753,7 +1873,7 @@ static svn_error_t *ra_svn_status(svn_ra_session_t *session,
   /* Fetch a reporter for the caller to drive.  The reporter will drive
    * status_editor upon finish_report(). */
   SVN_ERR(ra_svn_get_reporter(sess_baton, pool, status_editor, status_baton,
-                              target, depth, reporter, report_baton));
+                              target, depth, NULL, reporter, report_baton));
   return SVN_NO_ERROR;
 }
 
@@ -1784,7 +1904,7 @@ static svn_error_t *ra_svn_diff(svn_ra_session_t *session,
   /* Fetch a reporter for the caller to drive.  The reporter will drive
    * diff_editor upon finish_report(). */
   SVN_ERR(ra_svn_get_reporter(sess_baton, pool, diff_editor, diff_baton,
-                              target, depth, reporter, report_baton));
+                              target, depth, NULL, reporter, report_baton));
   return SVN_NO_ERROR;
 }
 
@@ -3035,6 +3155,7 @@ ra_svn_has_capability(svn_ra_session_t *session,
       {SVN_RA_CAPABILITY_GET_FILE_REVS_REVERSE,
                                        SVN_RA_SVN_CAP_GET_FILE_REVS_REVERSE},
       {SVN_RA_CAPABILITY_LIST, SVN_RA_SVN_CAP_LIST},
+      {SVN_RA_CAPABILITY_SERVER_BLAME, SVN_RA_SVN_CAP_SERVER_BLAME},
 
       {NULL, NULL} /* End of list marker */
   };
@@ -3204,6 +3325,88 @@ ra_svn_list(svn_ra_session_t *session,
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+ra_svn_get_blame(svn_ra_session_t *session,
+                 apr_array_header_t **chunks,
+                 const char *path,
+                 svn_revnum_t start,
+                 svn_revnum_t end,
+                 const svn_diff_file_options_t *diff_options,
+                 apr_pool_t *result_pool,
+                 apr_pool_t *scratch_pool)
+{
+  svn_ra_svn__session_baton_t *sess_baton = session->priv;
+  svn_ra_svn_conn_t *conn = sess_baton->conn;
+  svn_ra_svn__list_t *chunk_list, *revprop_list;
+  apr_hash_t *rev_props = apr_hash_make(scratch_pool);
+  int i;
+
+  path = reparent_path(session, path, scratch_pool);
+
+  /* Send the request.  The diff options use the syntax understood by
+     svn_diff_file_options_parse(). */
+  SVN_ERR(svn_ra_svn__write_tuple(conn, scratch_pool, "w(c(?r)(?r)(!",
+                                  "get-blame", path, start, end));
+  if (diff_options)
+    {
+      if (diff_options->ignore_space == svn_diff_file_ignore_space_change)
+        SVN_ERR(svn_ra_svn__write_cstring(conn, scratch_pool, "-b"));
+      else if (diff_options->ignore_space == svn_diff_file_ignore_space_all)
+        SVN_ERR(svn_ra_svn__write_cstring(conn, scratch_pool, "-w"));
+      if (diff_options->ignore_eol_style)
+        SVN_ERR(svn_ra_svn__write_cstring(conn, scratch_pool,
+                                          "--ignore-eol-style"));
+    }
+  SVN_ERR(svn_ra_svn__write_tuple(conn, scratch_pool, "!))"));
+
+  SVN_ERR(handle_auth_request(sess_baton, scratch_pool));
+  SVN_ERR(svn_ra_svn__read_cmd_response(conn, scratch_pool, "ll",
+                                        &chunk_list, &revprop_list));
+
+  /* The revision properties come once per revision. */
+  for (i = 0; i < revprop_list->nelts; ++i)
+    {
+      svn_ra_svn__item_t *elt = &SVN_RA_SVN__LIST_ITEM(revprop_list, i);
+      svn_ra_svn__list_t *proplist;
+      apr_hash_t *props;
+      svn_revnum_t rev;
+
+      if (elt->kind != SVN_RA_SVN_LIST)
+        return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                                _("Blame revision element not a list"));
+      SVN_ERR(svn_ra_svn__parse_tuple(&elt->u.list, "rl", &rev, &proplist));
+      SVN_ERR(svn_ra_svn__parse_proplist(proplist, result_pool, &props));
+      apr_hash_set(rev_props, apr_pmemdup(scratch_pool, &rev, sizeof(rev)),
+                   sizeof(rev), props);
+    }
+
+  *chunks = apr_array_make(result_pool, chunk_list->nelts,
+                           sizeof(svn_ra__blame_chunk_t));
+  for (i = 0; i < chunk_list->nelts; ++i)
+    {
+      svn_ra_svn__item_t *elt = &SVN_RA_SVN__LIST_ITEM(chunk_list, i);
+      svn_ra__blame_chunk_t *chunk;
+      apr_uint64_t line;
+      svn_revnum_t rev;
+
+      if (elt->kind != SVN_RA_SVN_LIST)
+        return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                                _("Blame chunk element not a list"));
+      SVN_ERR(svn_ra_svn__parse_tuple(&elt->u.list, "n(?r)", &line, &rev));
+
+      chunk = apr_array_push(*chunks);
+      chunk->start = (apr_int64_t)line;
+      chunk->revision = rev;
+      chunk->rev_props = SVN_IS_VALID_REVNUM(rev)
+                       ? apr_hash_get(rev_props, &rev, sizeof(rev))
+                       : NULL;
+      if (SVN_IS_VALID_REVNUM(rev) && !chunk->rev_props)
+        chunk->rev_props = apr_hash_make(result_pool);
+    }
+
+  return SVN_NO_ERROR;
+}
+
 static const svn_ra__vtable_t ra_svn_vtable = {
   svn_ra_svn_version,
   ra_svn_get_description,
@@ -3244,6 +3447,7 @@ static const svn_ra__vtable_t ra_svn_vtable = {
   ra_svn_get_inherited_props,
   NULL /* ra_set_svn_ra_open */,
   ra_svn_list,
+  ra_svn_get_blame,
   ra_svn_register_editor_shim_callbacks,
   NULL /* commit_ev2 */,
   NULL /* replay_range_ev2 */
@@ -784,6 +784,7 @@ svn_error_t *svn_ra_svn__enable_sasl_encryption(svn_ra_svn_conn_t *conn,
           }
           /* Yay, we have a security layer! */
           conn->encrypted = TRUE;
+          conn->sendfile_sock = NULL;
         }
     }
   return SVN_NO_ERROR;
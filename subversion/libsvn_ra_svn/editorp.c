@@ -351,15 +351,10 @@ static svn_error_t *ra_svn_apply_textdelta(void *file_baton,
   svn_stream_set_write(diff_stream, ra_svn_svndiff_handler);
   svn_stream_set_close(diff_stream, ra_svn_svndiff_close_handler);
 
-  /* If the connection does not support SVNDIFF1 or if we don't want to use
-   * compression, use the non-compressing "version 0" implementation */
-  if (   svn_ra_svn_compression_level(b->conn) > 0
-      && svn_ra_svn_has_capability(b->conn, SVN_RA_SVN_CAP_SVNDIFF1))
-    svn_txdelta_to_svndiff3(wh, wh_baton, diff_stream, 1,
-                            b->conn->compression_level, pool);
-  else
-    svn_txdelta_to_svndiff3(wh, wh_baton, diff_stream, 0,
-                            b->conn->compression_level, pool);
+  /* Use the most efficient compression that the other side supports. */
+  svn_txdelta_to_svndiff3(wh, wh_baton, diff_stream,
+                          svn_ra_svn__svndiff_version(b->conn),
+                          b->conn->compression_level, pool);
   return SVN_NO_ERROR;
 }
 
@@ -749,8 +744,12 @@ ra_svn_handle_open_file(svn_ra_svn_conn_t *conn,
   svn_revnum_t rev;
   ra_svn_token_entry_t *entry, *file_entry;
 
-  SVN_ERR(svn_ra_svn__parse_tuple(params, "css(?r)", &path, &token,
-                                  &file_token, &rev));
+  if (params)
+    SVN_ERR(svn_ra_svn__parse_tuple(params, "css(?r)", &path, &token,
+                                    &file_token, &rev));
+  else
+    SVN_ERR(svn_ra_svn__read_command_tuple(conn, pool, "css(?r)", &path,
+                                           &token, &file_token, &rev));
   SVN_ERR(lookup_token(ds, token, FALSE, &entry));
   ds->file_refs++;
 
@@ -801,7 +800,10 @@ ra_svn_handle_textdelta_chunk(svn_ra_svn_conn_t *conn,
   svn_string_t *str;
 
   /* Parse arguments and look up the token. */
-  SVN_ERR(svn_ra_svn__parse_tuple(params, "ss", &token, &str));
+  if (params)
+    SVN_ERR(svn_ra_svn__parse_tuple(params, "ss", &token, &str));
+  else
+    SVN_ERR(svn_ra_svn__read_command_tuple(conn, pool, "ss", &token, &str));
   SVN_ERR(lookup_token(ds, token, TRUE, &entry));
   if (!entry->dstream)
     return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
@@ -841,8 +843,12 @@ ra_svn_handle_change_file_prop(svn_ra_svn_conn_t *conn,
   svn_string_t *token, *value;
   ra_svn_token_entry_t *entry;
 
-  SVN_ERR(svn_ra_svn__parse_tuple(params, "sc(?s)", &token, &name,
-                                  &value));
+  if (params)
+    SVN_ERR(svn_ra_svn__parse_tuple(params, "sc(?s)", &token, &name,
+                                    &value));
+  else
+    SVN_ERR(svn_ra_svn__read_command_tuple(conn, pool, "sc(?s)", &token,
+                                           &name, &value));
   SVN_ERR(lookup_token(ds, token, TRUE, &entry));
   SVN_CMD_ERR(ds->editor->change_file_prop(entry->baton, name, value, pool));
   return SVN_NO_ERROR;
@@ -859,8 +865,12 @@ ra_svn_handle_close_file(svn_ra_svn_conn_t *conn,
   const char *text_checksum;
 
   /* Parse arguments and look up the file token. */
-  SVN_ERR(svn_ra_svn__parse_tuple(params, "s(?c)",
-                                  &token, &text_checksum));
+  if (params)
+    SVN_ERR(svn_ra_svn__parse_tuple(params, "s(?c)",
+                                    &token, &text_checksum));
+  else
+    SVN_ERR(svn_ra_svn__read_command_tuple(conn, pool, "s(?c)",
+                                           &token, &text_checksum));
   SVN_ERR(lookup_token(ds, token, TRUE, &entry));
 
   /* Close the file and destroy the baton. */
@@ -940,21 +950,32 @@ ra_svn_handle_finish_replay(svn_ra_svn_conn_t *conn,
   return SVN_NO_ERROR;
 }
 
-/* Common function signature for all editor command handlers. */
+/* Common function signature for all editor command handlers.
+
+   PARAMS is the parameter list of the command.  Handlers flagged as
+   UNPARSED in ra_svn_edit_cmds may also be called with PARAMS being NULL.
+   The command is then still unread and the handler has to read it from
+   CONN using svn_ra_svn__read_command_tuple(). */
 typedef svn_error_t *(*cmd_handler_t)(svn_ra_svn_conn_t *conn,
                                       apr_pool_t *pool,
                                       const svn_ra_svn__list_t *params,
                                       ra_svn_driver_state_t *ds);
 
+/* Marks the commands that make up the bulk of a typical edit.  Their
+   parameters get parsed straight from the read buffer instead of being
+   turned into a list of items first. */
+#define UNPARSED TRUE
+
 static const struct {
   const char *cmd;
   cmd_handler_t handler;
+  svn_boolean_t unparsed;
 } ra_svn_edit_cmds[] = {
-  { "change-file-prop", ra_svn_handle_change_file_prop },
-  { "open-file",        ra_svn_handle_open_file },
+  { "change-file-prop", ra_svn_handle_change_file_prop, UNPARSED },
+  { "open-file",        ra_svn_handle_open_file,        UNPARSED },
   { "apply-textdelta",  ra_svn_handle_apply_textdelta },
-  { "textdelta-chunk",  ra_svn_handle_textdelta_chunk },
-  { "close-file",       ra_svn_handle_close_file },
+  { "textdelta-chunk",  ra_svn_handle_textdelta_chunk,  UNPARSED },
+  { "close-file",       ra_svn_handle_close_file,       UNPARSED },
   { "add-dir",          ra_svn_handle_add_dir },
   { "open-dir",         ra_svn_handle_open_dir },
   { "change-dir-prop",  ra_svn_handle_change_dir_prop },
@@ -979,6 +1000,7 @@ static const struct {
 typedef struct cmd_t {
   svn_string_t cmd;
   cmd_handler_t handler;
+  svn_boolean_t unparsed;
 } cmd_t;
 
 /* The actual hash table.  It will be filled once before first usage.
@@ -1027,18 +1049,20 @@ init_cmd_hash(void *baton,
       cmd_hash[value].cmd.data = ra_svn_edit_cmds[i].cmd;
       cmd_hash[value].cmd.len = len;
       cmd_hash[value].handler = ra_svn_edit_cmds[i].handler;
+      cmd_hash[value].unparsed = ra_svn_edit_cmds[i].unparsed;
     }
 
   return SVN_NO_ERROR;
 }
 
-/* Return the command handler function for the command name CMD.
-   Return NULL if no such handler exists */
-static cmd_handler_t
-cmd_lookup(const char *cmd)
+/* Return the hash table entry for the command name CMD of LEN chars.
+   CMD does not need to be NUL-terminated.
+   Return NULL if no such command exists */
+static const cmd_t *
+cmd_lookup(const char *cmd,
+           apr_size_t len)
 {
   apr_size_t value;
-  apr_size_t len = strlen(cmd);
 
   /* Malicious data that our hash function may not like? */
   if (len == 0)
@@ -1055,7 +1079,7 @@ cmd_lookup(const char *cmd)
     return NULL;
 
   /* Yes! */
-  return cmd_hash[value].handler;
+  return &cmd_hash[value];
 }
 
 static svn_error_t *blocked_write(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
@@ -1112,12 +1136,25 @@ svn_error_t *svn_ra_svn_drive_editor2(svn_ra_svn_conn_t *conn,
       svn_ra_svn__reset_command_io_counters(conn);
       if (editor)
         {
-          cmd_handler_t handler;
-          SVN_ERR(svn_ra_svn__read_tuple(conn, subpool, "wl", &cmd, &params));
-          handler = cmd_lookup(cmd);
+          const cmd_t *entry;
+          svn_string_t next_cmd;
+
+          /* Let the handlers of frequent commands read the whole command
+           * themselves.  All others get the parsed parameter list. */
+          SVN_ERR(svn_ra_svn__peek_command(&next_cmd, conn, subpool));
+          entry = next_cmd.data ? cmd_lookup(next_cmd.data, next_cmd.len)
+                                : NULL;
+
+          params = NULL;
+          if (!entry || !entry->unparsed)
+            {
+              SVN_ERR(svn_ra_svn__read_tuple(conn, subpool, "wl",
+                                             &cmd, &params));
+              entry = cmd_lookup(cmd, strlen(cmd));
+            }
 
-          if (handler)
-            err = (*handler)(conn, subpool, params, &state);
+          if (entry)
+            err = (*entry->handler)(conn, subpool, params, &state);
           else if (strcmp(cmd, "failure") == 0)
             {
               /* While not really an editor command this can occur when
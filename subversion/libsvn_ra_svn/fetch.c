@@ -0,0 +1,774 @@
+/*
+ * fetch.c :  fetching file contents of an update over additional
+ *            connections
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+
+
+#include <string.h>
+#include <apr_strings.h>
+
+#include "svn_hash.h"
+#include "svn_types.h"
+#include "svn_string.h"
+#include "svn_error.h"
+#include "svn_delta.h"
+#include "svn_dirent_uri.h"
+#include "svn_ra_svn.h"
+#include "svn_pools.h"
+#include "svn_sorts.h"
+#include "svn_private_config.h"
+
+#include "ra_svn.h"
+
+/*
+ * A single svnserve thread produces the whole edit of an update,
+ * including all text deltas.  For large checkouts, that thread becomes
+ * the bottleneck.  Instead, the client may ask the server to send the
+ * tree structure without any text deltas, i.e. with just a NULL window
+ * for every changed file, and fetch the actual file contents with
+ * fetch-many commands over a few additional connections.  Each of these
+ * is served by a separate server thread or process.
+ *
+ * The fetch editor implemented here sits between the editor driver and
+ * the actual update editor.  It passes all edit operations through but
+ * holds back the files whose contents need to be fetched.  Those get
+ * requested in batches of FETCH_BATCH_SIZE files, one batch per
+ * connection at a time, and are being closed once their contents have
+ * been received.  Just like ra_serf, we defer closing a directory until
+ * all of its children have been closed.
+ */
+
+/* Number of files to request with a single fetch-many command. */
+#define FETCH_BATCH_SIZE 64
+
+/* While all connections are busy, let up to this many files wait for
+ * their contents before we wait for the oldest request to complete. */
+#define MAX_WAITING_FILES 1024
+
+typedef struct dir_baton_t
+{
+  struct svn_ra_svn__fetch_baton_t *eb;
+  struct dir_baton_t *parent;
+
+  /* The wrapped editor's directory baton. */
+  void *baton;
+
+  /* Lives until the wrapped directory has been closed. */
+  apr_pool_t *pool;
+
+  /* 1 until close_directory() got called plus 1 for every child that
+   * has not been closed, yet. */
+  int ref_count;
+} dir_baton_t;
+
+typedef struct file_baton_t
+{
+  struct svn_ra_svn__fetch_baton_t *eb;
+  dir_baton_t *parent;
+
+  /* The wrapped editor's file baton. */
+  void *baton;
+
+  /* Lives until the wrapped file has been closed. */
+  apr_pool_t *pool;
+
+  /* Path of the file within the edit. */
+  const char *path;
+
+  /* Set when we received an empty text delta, i.e. the contents must be
+   * fetched.  BASE_CHECKSUM is what we got with apply_textdelta() and
+   * TEXT_CHECKSUM what we got with close_file(). */
+  svn_boolean_t fetch;
+  const char *base_checksum;
+  const char *text_checksum;
+
+  /* The wrapped editor's window handler, if we received an actual delta
+   * and pass it through. */
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+} file_baton_t;
+
+/* An additional connection and the files requested over it. */
+typedef struct fetch_conn_t
+{
+  /* NULL until opened. */
+  svn_ra_svn__session_baton_t *sess;
+
+  /* The files (file_baton_t *) whose contents have been requested but
+   * not received, yet.  Empty if the connection is idle. */
+  apr_array_header_t *files;
+} fetch_conn_t;
+
+struct svn_ra_svn__fetch_baton_t
+{
+  const svn_delta_editor_t *wrapped_editor;
+  void *wrapped_baton;
+
+  /* The main session.  Its settings are used for additional connections
+   * and we account the traffic of these to it. */
+  svn_ra_svn__session_baton_t *sess;
+
+  /* Repository path that the edit paths are relative to. */
+  const char *base_relpath;
+
+  /* Maps edit paths to the repository paths they have been linked to. */
+  apr_hash_t *links;
+
+  /* Revision that the edit updates to. */
+  svn_revnum_t revision;
+
+  /* The additional connections.  We use them round-robin, so the one at
+   * index NEXT is the idle one or the one with the oldest request. */
+  fetch_conn_t *conns;
+  int conn_count;
+  int next;
+
+  /* Files (file_baton_t *) that still need to be requested. */
+  apr_array_header_t *queue;
+
+  /* Number of files that have been closed by the driver but not in the
+   * wrapped editor, yet. */
+  int waiting;
+
+  apr_pool_t *pool;
+};
+
+/* Return the repository path of the file at edit path PATH in EB's edit.
+ * Allocate the result in RESULT_POOL. */
+static const char *
+get_repos_relpath(svn_ra_svn__fetch_baton_t *eb,
+                  const char *path,
+                  apr_pool_t *result_pool)
+{
+  if (apr_hash_count(eb->links))
+    {
+      const char *dir = path;
+
+      /* The closest linked parent determines the repository location. */
+      while (TRUE)
+        {
+          const char *linked = svn_hash_gets(eb->links, dir);
+          if (linked)
+            return svn_relpath_join(linked,
+                                    svn_relpath_skip_ancestor(dir, path),
+                                    result_pool);
+          if (*dir == '\0')
+            break;
+
+          dir = svn_relpath_dirname(dir, result_pool);
+        }
+    }
+
+  return svn_relpath_join(eb->base_relpath, path, result_pool);
+}
+
+/* Drop a reference to DB and close it in the wrapped editor, if that was
+ * the last one.  Do the same for its parents as necessary. */
+static svn_error_t *
+release_dir(dir_baton_t *db)
+{
+  while (db && --db->ref_count == 0)
+    {
+      dir_baton_t *parent = db->parent;
+
+      SVN_ERR(db->eb->wrapped_editor->close_directory(db->baton, db->pool));
+      svn_pool_destroy(db->pool);
+      db = parent;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Close FB in the wrapped editor with checksum TEXT_CHECKSUM and release
+ * its parent.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+close_wrapped_file(file_baton_t *fb,
+                   const char *text_checksum,
+                   apr_pool_t *scratch_pool)
+{
+  dir_baton_t *parent = fb->parent;
+
+  SVN_ERR(fb->eb->wrapped_editor->close_file(fb->baton, text_checksum,
+                                             scratch_pool));
+  svn_pool_destroy(fb->pool);
+
+  return svn_error_trace(release_dir(parent));
+}
+
+/* Add the traffic on AUX_SESS to the main session of EB and report the
+ * progress. */
+static void
+account_traffic(svn_ra_svn__fetch_baton_t *eb,
+                svn_ra_svn__session_baton_t *aux_sess,
+                apr_pool_t *scratch_pool)
+{
+  const svn_ra_callbacks2_t *cb = eb->sess->callbacks;
+
+  eb->sess->bytes_read += aux_sess->bytes_read;
+  eb->sess->bytes_written += aux_sess->bytes_written;
+  aux_sess->bytes_read = 0;
+  aux_sess->bytes_written = 0;
+
+  if (cb && cb->progress_func)
+    (cb->progress_func)(eb->sess->bytes_read + eb->sess->bytes_written, -1,
+                        cb->progress_baton, scratch_pool);
+}
+
+/* Receive the contents of all files requested over FC, pass them to the
+ * wrapped editor and close the files.  Use SCRATCH_POOL for temporary
+ * allocations. */
+static svn_error_t *
+receive_files(svn_ra_svn__fetch_baton_t *eb,
+              fetch_conn_t *fc,
+              apr_pool_t *scratch_pool)
+{
+  svn_ra_svn_conn_t *conn = fc->sess->conn;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_pool_t *chunkpool = svn_pool_create(scratch_pool);
+  int i;
+
+  SVN_ERR(svn_ra_svn__handle_auth_request(fc->sess, iterpool));
+  SVN_ERR(svn_ra_svn__read_cmd_response(conn, iterpool, ""));
+
+  for (i = 0; i < fc->files->nelts; ++i)
+    {
+      file_baton_t *fb = APR_ARRAY_IDX(fc->files, i, file_baton_t *);
+      svn_txdelta_window_handler_t handler;
+      void *handler_baton;
+      svn_stream_t *stream;
+
+      svn_pool_clear(iterpool);
+
+      /* Send the contents as a delta against the empty stream. */
+      SVN_ERR(eb->wrapped_editor->apply_textdelta(fb->baton,
+                                                  fb->base_checksum,
+                                                  fb->pool, &handler,
+                                                  &handler_baton));
+      stream = svn_txdelta_target_push(handler, handler_baton,
+                                       svn_stream_empty(iterpool), iterpool);
+
+      while (1)
+        {
+          svn_ra_svn__item_t *item;
+
+          svn_pool_clear(chunkpool);
+          SVN_ERR(svn_ra_svn__read_item(conn, chunkpool, &item));
+          if (item->kind != SVN_RA_SVN_STRING)
+            return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                                    _("Non-string as part of file contents"));
+          if (item->u.string.len == 0)
+            break;
+
+          SVN_ERR(svn_stream_write(stream, item->u.string.data,
+                                   &item->u.string.len));
+        }
+
+      SVN_ERR(svn_ra_svn__read_cmd_response(conn, iterpool, ""));
+      SVN_ERR(svn_stream_close(stream));
+
+      SVN_ERR(close_wrapped_file(fb, fb->text_checksum, iterpool));
+      --eb->waiting;
+    }
+
+  apr_array_clear(fc->files);
+  account_traffic(eb, fc->sess, iterpool);
+
+  svn_pool_destroy(chunkpool);
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Request the contents of up to FETCH_BATCH_SIZE queued files over FC.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+request_files(svn_ra_svn__fetch_baton_t *eb,
+              fetch_conn_t *fc,
+              apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *paths;
+  int count = MIN(eb->queue->nelts, FETCH_BATCH_SIZE);
+  int i;
+
+  paths = apr_array_make(scratch_pool, count, sizeof(const char *));
+  for (i = 0; i < count; ++i)
+    {
+      file_baton_t *fb = APR_ARRAY_IDX(eb->queue, i, file_baton_t *);
+
+      APR_ARRAY_PUSH(paths, const char *)
+        = get_repos_relpath(eb, fb->path, scratch_pool);
+      APR_ARRAY_PUSH(fc->files, file_baton_t *) = fb;
+    }
+
+  /* Remove the requested files from the queue. */
+  memmove(eb->queue->elts, eb->queue->elts + count * eb->queue->elt_size,
+          (eb->queue->nelts - count) * eb->queue->elt_size);
+  eb->queue->nelts -= count;
+
+  SVN_ERR(svn_ra_svn__write_cmd_fetch_many(fc->sess->conn, scratch_pool,
+                                           eb->revision, paths));
+  SVN_ERR(svn_ra_svn__flush(fc->sess->conn, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the connection to use next in *FC, opening it if necessary.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+get_next_conn(fetch_conn_t **fc,
+              svn_ra_svn__fetch_baton_t *eb,
+              apr_pool_t *scratch_pool)
+{
+  fetch_conn_t *next = &eb->conns[eb->next];
+
+  if (next->sess == NULL)
+    {
+      svn_error_t *err = svn_ra_svn__open_aux_session(&next->sess, eb->sess,
+                                                      eb->pool,
+                                                      scratch_pool);
+
+      /* The first connection has been opened up-front, so we can always
+       * continue with the ones that we already have. */
+      if (err)
+        {
+          svn_error_clear(err);
+          next->sess = NULL;
+          eb->conn_count = eb->next;
+          eb->next = 0;
+          next = &eb->conns[0];
+        }
+      else
+        next->files = apr_array_make(eb->pool, FETCH_BATCH_SIZE,
+                                     sizeof(file_baton_t *));
+    }
+
+  *fc = next;
+  return SVN_NO_ERROR;
+}
+
+/* Request queued files in batches.  Unless FLUSH is set, do so only for
+ * complete batches and wait for the oldest request to complete only when
+ * too many files are waiting.  Use SCRATCH_POOL for temporary
+ * allocations. */
+static svn_error_t *
+process_queue(svn_ra_svn__fetch_baton_t *eb,
+              svn_boolean_t flush,
+              apr_pool_t *scratch_pool)
+{
+  while (eb->queue->nelts >= FETCH_BATCH_SIZE
+         || (flush && eb->queue->nelts > 0))
+    {
+      fetch_conn_t *fc;
+
+      SVN_ERR(get_next_conn(&fc, eb, scratch_pool));
+      if (fc->files->nelts > 0)
+        {
+          /* All connections are busy. */
+          if (!flush && eb->waiting < MAX_WAITING_FILES)
+            break;
+
+          SVN_ERR(receive_files(eb, fc, scratch_pool));
+        }
+
+      SVN_ERR(request_files(eb, fc, scratch_pool));
+      eb->next = (eb->next + 1) % eb->conn_count;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Request all queued files and receive their contents. */
+static svn_error_t *
+fetch_all(svn_ra_svn__fetch_baton_t *eb,
+          apr_pool_t *scratch_pool)
+{
+  int i;
+
+  SVN_ERR(process_queue(eb, TRUE, scratch_pool));
+
+  /* Complete the requests in the order they have been sent. */
+  for (i = 0; i < eb->conn_count; ++i)
+    {
+      fetch_conn_t *fc = &eb->conns[(eb->next + i) % eb->conn_count];
+
+      if (fc->sess && fc->files->nelts > 0)
+        SVN_ERR(receive_files(eb, fc, scratch_pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Return a new directory baton for the child of PB with the wrapped
+ * baton to be set by the caller. */
+static dir_baton_t *
+make_dir_baton(svn_ra_svn__fetch_baton_t *eb,
+               dir_baton_t *pb)
+{
+  apr_pool_t *pool = svn_pool_create(pb ? pb->pool : eb->pool);
+  dir_baton_t *db = apr_pcalloc(pool, sizeof(*db));
+
+  db->eb = eb;
+  db->parent = pb;
+  db->pool = pool;
+  db->ref_count = 1;
+
+  if (pb)
+    ++pb->ref_count;
+
+  return db;
+}
+
+/* Return a new file baton for the file PATH within PB with the wrapped
+ * baton to be set by the caller. */
+static file_baton_t *
+make_file_baton(dir_baton_t *pb,
+                const char *path)
+{
+  apr_pool_t *pool = svn_pool_create(pb->pool);
+  file_baton_t *fb = apr_pcalloc(pool, sizeof(*fb));
+
+  fb->eb = pb->eb;
+  fb->parent = pb;
+  fb->pool = pool;
+  fb->path = apr_pstrdup(pool, path);
+
+  ++pb->ref_count;
+
+  return fb;
+}
+
+/* --- The editor --- */
+
+static svn_error_t *
+set_target_revision(void *edit_baton,
+                    svn_revnum_t target_revision,
+                    apr_pool_t *pool)
+{
+  svn_ra_svn__fetch_baton_t *eb = edit_baton;
+
+  eb->revision = target_revision;
+  return svn_error_trace(eb->wrapped_editor->set_target_revision(
+                           eb->wrapped_baton, target_revision, pool));
+}
+
+static svn_error_t *
+open_root(void *edit_baton,
+          svn_revnum_t base_revision,
+          apr_pool_t *dir_pool,
+          void **root_baton)
+{
+  svn_ra_svn__fetch_baton_t *eb = edit_baton;
+  dir_baton_t *db = make_dir_baton(eb, NULL);
+
+  SVN_ERR(eb->wrapped_editor->open_root(eb->wrapped_baton, base_revision,
+                                        db->pool, &db->baton));
+  *root_baton = db;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+delete_entry(const char *path,
+             svn_revnum_t revision,
+             void *parent_baton,
+             apr_pool_t *pool)
+{
+  dir_baton_t *pb = parent_baton;
+
+  return svn_error_trace(pb->eb->wrapped_editor->delete_entry(path, revision,
+                                                              pb->baton,
+                                                              pool));
+}
+
+static svn_error_t *
+add_directory(const char *path,
+              void *parent_baton,
+              const char *copyfrom_path,
+              svn_revnum_t copyfrom_revision,
+              apr_pool_t *dir_pool,
+              void **child_baton)
+{
+  dir_baton_t *pb = parent_baton;
+  dir_baton_t *db = make_dir_baton(pb->eb, pb);
+
+  SVN_ERR(pb->eb->wrapped_editor->add_directory(path, pb->baton,
+                                                copyfrom_path,
+                                                copyfrom_revision,
+                                                db->pool, &db->baton));
+  *child_baton = db;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+open_directory(const char *path,
+               void *parent_baton,
+               svn_revnum_t base_revision,
+               apr_pool_t *dir_pool,
+               void **child_baton)
+{
+  dir_baton_t *pb = parent_baton;
+  dir_baton_t *db = make_dir_baton(pb->eb, pb);
+
+  SVN_ERR(pb->eb->wrapped_editor->open_directory(path, pb->baton,
+                                                 base_revision,
+                                                 db->pool, &db->baton));
+  *child_baton = db;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+change_dir_prop(void *dir_baton,
+                const char *name,
+                const svn_string_t *value,
+                apr_pool_t *pool)
+{
+  dir_baton_t *db = dir_baton;
+
+  return svn_error_trace(db->eb->wrapped_editor->change_dir_prop(db->baton,
+                                                                 name, value,
+                                                                 pool));
+}
+
+static svn_error_t *
+close_directory(void *dir_baton,
+                apr_pool_t *pool)
+{
+  dir_baton_t *db = dir_baton;
+
+  return svn_error_trace(release_dir(db));
+}
+
+static svn_error_t *
+absent_directory(const char *path,
+                 void *parent_baton,
+                 apr_pool_t *pool)
+{
+  dir_baton_t *pb = parent_baton;
+
+  return svn_error_trace(pb->eb->wrapped_editor->absent_directory(path,
+                                                                  pb->baton,
+                                                                  pool));
+}
+
+static svn_error_t *
+add_file(const char *path,
+         void *parent_baton,
+         const char *copyfrom_path,
+         svn_revnum_t copyfrom_revision,
+         apr_pool_t *file_pool,
+         void **file_baton)
+{
+  dir_baton_t *pb = parent_baton;
+  file_baton_t *fb = make_file_baton(pb, path);
+
+  SVN_ERR(pb->eb->wrapped_editor->add_file(path, pb->baton, copyfrom_path,
+                                           copyfrom_revision, fb->pool,
+                                           &fb->baton));
+  *file_baton = fb;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+open_file(const char *path,
+          void *parent_baton,
+          svn_revnum_t base_revision,
+          apr_pool_t *file_pool,
+          void **file_baton)
+{
+  dir_baton_t *pb = parent_baton;
+  file_baton_t *fb = make_file_baton(pb, path);
+
+  SVN_ERR(pb->eb->wrapped_editor->open_file(path, pb->baton, base_revision,
+                                            fb->pool, &fb->baton));
+  *file_baton = fb;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_txdelta_window_handler_t.  An empty delta marks the
+ * file for fetching its contents; actual deltas are passed through. */
+static svn_error_t *
+window_handler(svn_txdelta_window_t *window,
+               void *baton)
+{
+  file_baton_t *fb = baton;
+
+  if (window == NULL && fb->handler == NULL)
+    {
+      fb->fetch = TRUE;
+      return SVN_NO_ERROR;
+    }
+
+  if (fb->handler == NULL)
+    SVN_ERR(fb->eb->wrapped_editor->apply_textdelta(fb->baton,
+                                                    fb->base_checksum,
+                                                    fb->pool, &fb->handler,
+                                                    &fb->handler_baton));
+
+  return svn_error_trace(fb->handler(window, fb->handler_baton));
+}
+
+static svn_error_t *
+apply_textdelta(void *file_baton,
+                const char *base_checksum,
+                apr_pool_t *pool,
+                svn_txdelta_window_handler_t *handler,
+                void **handler_baton)
+{
+  file_baton_t *fb = file_baton;
+
+  fb->base_checksum = apr_pstrdup(fb->pool, base_checksum);
+  *handler = window_handler;
+  *handler_baton = fb;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+change_file_prop(void *file_baton,
+                 const char *name,
+                 const svn_string_t *value,
+                 apr_pool_t *pool)
+{
+  file_baton_t *fb = file_baton;
+
+  return svn_error_trace(fb->eb->wrapped_editor->change_file_prop(fb->baton,
+                                                                  name, value,
+                                                                  pool));
+}
+
+static svn_error_t *
+close_file(void *file_baton,
+           const char *text_checksum,
+           apr_pool_t *pool)
+{
+  file_baton_t *fb = file_baton;
+  svn_ra_svn__fetch_baton_t *eb = fb->eb;
+
+  if (!fb->fetch)
+    return svn_error_trace(close_wrapped_file(fb, text_checksum, pool));
+
+  fb->text_checksum = apr_pstrdup(fb->pool, text_checksum);
+  APR_ARRAY_PUSH(eb->queue, file_baton_t *) = fb;
+  ++eb->waiting;
+
+  return svn_error_trace(process_queue(eb, FALSE, pool));
+}
+
+static svn_error_t *
+absent_file(const char *path,
+            void *parent_baton,
+            apr_pool_t *pool)
+{
+  dir_baton_t *pb = parent_baton;
+
+  return svn_error_trace(pb->eb->wrapped_editor->absent_file(path, pb->baton,
+                                                             pool));
+}
+
+static svn_error_t *
+close_edit(void *edit_baton,
+           apr_pool_t *pool)
+{
+  svn_ra_svn__fetch_baton_t *eb = edit_baton;
+
+  SVN_ERR(fetch_all(eb, pool));
+
+  return svn_error_trace(eb->wrapped_editor->close_edit(eb->wrapped_baton,
+                                                        pool));
+}
+
+static svn_error_t *
+abort_edit(void *edit_baton,
+           apr_pool_t *pool)
+{
+  svn_ra_svn__fetch_baton_t *eb = edit_baton;
+
+  return svn_error_trace(eb->wrapped_editor->abort_edit(eb->wrapped_baton,
+                                                        pool));
+}
+
+svn_error_t *
+svn_ra_svn__get_fetch_editor(const svn_delta_editor_t **editor,
+                             svn_ra_svn__fetch_baton_t **edit_baton,
+                             svn_ra_svn__session_baton_t *sess,
+                             svn_ra_svn__session_baton_t *aux_sess,
+                             const char *base_relpath,
+                             const svn_delta_editor_t *wrapped_editor,
+                             void *wrapped_baton,
+                             apr_pool_t *pool)
+{
+  svn_delta_editor_t *fetch_editor = svn_delta_default_editor(pool);
+  svn_ra_svn__fetch_baton_t *eb = apr_pcalloc(pool, sizeof(*eb));
+
+  eb->wrapped_editor = wrapped_editor;
+  eb->wrapped_baton = wrapped_baton;
+  eb->sess = sess;
+  eb->base_relpath = apr_pstrdup(pool, base_relpath);
+  eb->links = apr_hash_make(pool);
+  eb->revision = SVN_INVALID_REVNUM;
+  eb->conn_count = sess->fetch_connections;
+  eb->conns = apr_pcalloc(pool, eb->conn_count * sizeof(*eb->conns));
+  eb->queue = apr_array_make(pool, FETCH_BATCH_SIZE, sizeof(file_baton_t *));
+  eb->pool = pool;
+
+  eb->conns[0].sess = aux_sess;
+  eb->conns[0].files = apr_array_make(pool, FETCH_BATCH_SIZE,
+                                      sizeof(file_baton_t *));
+
+  fetch_editor->set_target_revision = set_target_revision;
+  fetch_editor->open_root = open_root;
+  fetch_editor->delete_entry = delete_entry;
+  fetch_editor->add_directory = add_directory;
+  fetch_editor->open_directory = open_directory;
+  fetch_editor->change_dir_prop = change_dir_prop;
+  fetch_editor->close_directory = close_directory;
+  fetch_editor->absent_directory = absent_directory;
+  fetch_editor->add_file = add_file;
+  fetch_editor->open_file = open_file;
+  fetch_editor->apply_textdelta = apply_textdelta;
+  fetch_editor->change_file_prop = change_file_prop;
+  fetch_editor->close_file = close_file;
+  fetch_editor->absent_file = absent_file;
+  fetch_editor->close_edit = close_edit;
+  fetch_editor->abort_edit = abort_edit;
+
+  *editor = fetch_editor;
+  *edit_baton = eb;
+
+  return SVN_NO_ERROR;
+}
+
+void
+svn_ra_svn__fetch_link_path(svn_ra_svn__fetch_baton_t *edit_baton,
+                            const char *edit_relpath,
+                            const char *repos_relpath)
+{
+  apr_pool_t *pool = edit_baton->pool;
+
+  svn_hash_sets(edit_baton->links, apr_pstrdup(pool, edit_relpath),
+                apr_pstrdup(pool, repos_relpath));
+}
@@ -27,6 +27,7 @@
 #include <stdlib.h>
 
 #define APR_WANT_STRFUNC
+#define APR_WANT_IOVEC
 #include <apr_want.h>
 #include <apr_general.h>
 #include <apr_lib.h>
@@ -36,6 +37,7 @@
 #include "svn_types.h"
 #include "svn_string.h"
 #include "svn_error.h"
+#include "svn_io.h"
 #include "svn_pools.h"
 #include "svn_ra_svn.h"
 #include "svn_private_config.h"
@@ -58,6 +60,12 @@
 
 #define SUSPICIOUSLY_HUGE_STRING_SIZE_THRESHOLD (0x100000)
 
+/* Number of file content bytes that svn_ra_svn__write_file_span will put
+ * into a single string.  Keep this below the threshold above, so clients
+ * will accept these strings without hesitation. */
+
+#define FILE_SPAN_CHUNK_SIZE (0x40000)
+
 /* We don't use "words" longer than this in our protocol.  The longest word
  * we are currently using is only about 16 chars long but we leave room for
  * longer future capability and command names.  See read_item() to understand
@@ -190,8 +198,17 @@ svn_ra_svn_conn_t *svn_ra_svn_create_conn5(apr_socket_t *sock,
                                            apr_pool_t *result_pool)
 {
   svn_ra_svn_conn_t *conn;
-  void *mem = apr_palloc(result_pool, sizeof(*conn) + SVN_RA_SVN__PAGE_SIZE);
-  conn = (void*)APR_ALIGN((apr_uintptr_t)mem, SVN_RA_SVN__PAGE_SIZE);
+  char *buffers;
+  void *mem = apr_palloc(result_pool, SVN_RA_SVN__WRITEBUF_SIZE
+                                      + SVN_RA_SVN__READBUF_SIZE
+                                      + sizeof(*conn)
+                                      + SVN_RA_SVN__PAGE_SIZE);
+
+  /* Allocate the initial I/O buffers together with the connection
+     and keep them page-aligned. */
+  buffers = (void*)APR_ALIGN((apr_uintptr_t)mem, SVN_RA_SVN__PAGE_SIZE);
+  conn = (void*)(buffers + SVN_RA_SVN__WRITEBUF_SIZE
+                         + SVN_RA_SVN__READBUF_SIZE);
 
   assert((sock && !in_stream && !out_stream)
          || (!sock && in_stream && out_stream));
@@ -200,9 +217,17 @@ svn_ra_svn_conn_t *svn_ra_svn_create_conn5(apr_socket_t *sock,
   conn->encrypted = FALSE;
 #endif
   conn->session = NULL;
+  conn->sendfile_sock = sock;
+  conn->write_buf = buffers;
+  conn->write_buf_size = SVN_RA_SVN__WRITEBUF_SIZE;
+  conn->read_buf = buffers + SVN_RA_SVN__WRITEBUF_SIZE;
+  conn->read_buf_size = SVN_RA_SVN__READBUF_SIZE;
   conn->read_ptr = conn->read_buf;
   conn->read_end = conn->read_buf;
   conn->write_pos = 0;
+  conn->initial_write_buf = conn->write_buf;
+  conn->initial_read_buf = conn->read_buf;
+  conn->buf_pool = NULL;
   conn->written_since_error_check = 0;
   conn->error_check_interval = error_check_interval;
   conn->may_check_for_error = error_check_interval == 0;
@@ -210,6 +235,10 @@ svn_ra_svn_conn_t *svn_ra_svn_create_conn5(apr_socket_t *sock,
   conn->current_in = 0;
   conn->max_out = max_out;
   conn->current_out = 0;
+  conn->total_in = 0;
+  conn->total_out = 0;
+  conn->command_hook = NULL;
+  conn->command_hook_baton = NULL;
   conn->block_handler = NULL;
   conn->block_baton = NULL;
   conn->capabilities = apr_hash_make(result_pool);
@@ -297,6 +326,28 @@ svn_ra_svn_zero_copy_limit(svn_ra_svn_conn_t *conn)
   return conn->zero_copy_limit;
 }
 
+int
+svn_ra_svn__svndiff_version(svn_ra_svn_conn_t *conn)
+{
+  /* Don't compress at all, if the user does not want it. */
+  if (conn->compression_level <= 0)
+    return 0;
+
+  /* svndiff3 is LZ4 compressed like svndiff2 and allows for larger
+   * delta windows to be sent. */
+  if (svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_ACCEPTS_SVNDIFF3))
+    return 3;
+
+  /* LZ4 is much cheaper than zlib at both ends of the connection. */
+  if (svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_ACCEPTS_SVNDIFF2))
+    return 2;
+
+  if (svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_SVNDIFF1))
+    return 1;
+
+  return 0;
+}
+
 const char *svn_ra_svn_conn_remote_host(svn_ra_svn_conn_t *conn)
 {
   return conn->remote_ip;
@@ -325,6 +376,24 @@ svn_ra_svn__reset_command_io_counters(svn_ra_svn_conn_t *conn)
   conn->current_out = 0;
 }
 
+void
+svn_ra_svn__set_command_hook(svn_ra_svn_conn_t *conn,
+                             svn_ra_svn__command_hook_t hook,
+                             void *baton)
+{
+  conn->command_hook = hook;
+  conn->command_hook_baton = baton;
+}
+
+void
+svn_ra_svn__get_io_totals(svn_ra_svn_conn_t *conn,
+                          apr_uint64_t *bytes_in,
+                          apr_uint64_t *bytes_out)
+{
+  *bytes_in = conn->total_in;
+  *bytes_out = conn->total_out;
+}
+
 
 /* --- WRITE BUFFER MANAGEMENT --- */
 
@@ -345,29 +414,44 @@ check_io_limits(svn_ra_svn_conn_t *conn)
   return SVN_NO_ERROR;
 }
 
-/* Write data to socket or output file as appropriate. */
-static svn_error_t *writebuf_output(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
-                                    const char *data, apr_size_t len)
+/* Write the NVEC buffers in VEC to the socket or output file as
+ * appropriate.  VEC will be modified. */
+static svn_error_t *writebuf_outputv(svn_ra_svn_conn_t *conn,
+                                     apr_pool_t *pool,
+                                     struct iovec *vec, int nvec)
 {
-  const char *end = data + len;
+  apr_size_t len = 0;
   apr_size_t count;
   apr_pool_t *subpool = NULL;
   svn_ra_svn__session_baton_t *session = conn->session;
+  int i;
+
+  for (i = 0; i < nvec; ++i)
+    len += vec[i].iov_len;
 
   /* Limit the size of the response, if a limit has been configured.
    * This is to limit the server load in case users e.g. accidentally ran
    * an export on the root folder. */
   conn->current_out += len;
+  conn->total_out += len;
   SVN_ERR(check_io_limits(conn));
 
-  while (data < end)
+  while (TRUE)
     {
-      count = end - data;
+      /* Skip everything that has been written already. */
+      while (nvec > 0 && vec->iov_len == 0)
+        {
+          ++vec;
+          --nvec;
+        }
+
+      if (nvec == 0)
+        break;
 
       if (session && session->callbacks && session->callbacks->cancel_func)
         SVN_ERR((session->callbacks->cancel_func)(session->callbacks_baton));
 
-      SVN_ERR(svn_ra_svn__stream_write(conn->stream, data, &count));
+      SVN_ERR(svn_ra_svn__stream_writev(conn->stream, vec, nvec, &count));
       if (count == 0)
         {
           if (!subpool)
@@ -376,7 +460,6 @@ static svn_error_t *writebuf_output(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
             svn_pool_clear(subpool);
           SVN_ERR(conn->block_handler(conn, subpool, conn->block_baton));
         }
-      data += count;
 
       if (session)
         {
@@ -387,6 +470,15 @@ static svn_error_t *writebuf_output(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
             (cb->progress_func)(session->bytes_written + session->bytes_read,
                                 -1, cb->progress_baton, subpool);
         }
+
+      /* Advance past the data that has been written. */
+      for (i = 0; count > 0; ++i)
+        {
+          apr_size_t written = MIN(count, vec[i].iov_len);
+          vec[i].iov_base = (char *)vec[i].iov_base + written;
+          vec[i].iov_len -= written;
+          count -= written;
+        }
     }
 
   conn->written_since_error_check += len;
@@ -398,6 +490,18 @@ static svn_error_t *writebuf_output(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
   return SVN_NO_ERROR;
 }
 
+/* Write data to socket or output file as appropriate. */
+static svn_error_t *writebuf_output(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
+                                    const char *data, apr_size_t len)
+{
+  struct iovec vec;
+
+  vec.iov_base = (void *)data;
+  vec.iov_len = len;
+
+  return svn_error_trace(writebuf_outputv(conn, pool, &vec, 1));
+}
+
 /* Write data from the write buffer out to the socket. */
 static svn_error_t *writebuf_flush(svn_ra_svn_conn_t *conn, apr_pool_t *pool)
 {
@@ -409,21 +513,106 @@ static svn_error_t *writebuf_flush(svn_ra_svn_conn_t *conn, apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Return the pool to allocate grown I/O buffers of CONN in. */
+static apr_pool_t *
+get_buf_pool(svn_ra_svn_conn_t *conn)
+{
+  if (conn->buf_pool == NULL)
+    conn->buf_pool = svn_pool_create(conn->pool);
+
+  return conn->buf_pool;
+}
+
+/* If the I/O buffers of CONN have grown, switch back to the initial
+ * buffers allocated with CONN and release the grown ones.  Data still
+ * buffered is retained; if it does not fit into the initial buffers,
+ * this is a no-op. */
+static void
+reset_buffers(svn_ra_svn_conn_t *conn)
+{
+  char *write_buf = conn->initial_write_buf;
+  char *read_buf = conn->initial_read_buf;
+  apr_size_t buffered = conn->read_end - conn->read_ptr;
+
+  if (   conn->buf_pool == NULL
+      || conn->write_pos > SVN_RA_SVN__WRITEBUF_SIZE
+      || buffered > SVN_RA_SVN__READBUF_SIZE)
+    return;
+
+  if (conn->write_buf != write_buf)
+    {
+      memcpy(write_buf, conn->write_buf, conn->write_pos);
+      conn->write_buf = write_buf;
+      conn->write_buf_size = SVN_RA_SVN__WRITEBUF_SIZE;
+    }
+
+  if (conn->read_buf != read_buf)
+    {
+      memcpy(read_buf, conn->read_ptr, buffered);
+      conn->read_buf = read_buf;
+      conn->read_buf_size = SVN_RA_SVN__READBUF_SIZE;
+      conn->read_ptr = read_buf;
+      conn->read_end = read_buf + buffered;
+    }
+
+  svn_pool_clear(conn->buf_pool);
+}
+
+/* Make room for at least LEN more bytes in the write buffer of CONN.
+ * A buffer that runs full before we get to flush it otherwise indicates
+ * a bulk transfer.  Grow it then, up to SVN_RA_SVN__MAX_BUF_SIZE, instead
+ * of sending many small chunks. */
+static svn_error_t *writebuf_make_room(svn_ra_svn_conn_t *conn,
+                                       apr_pool_t *pool,
+                                       apr_size_t len)
+{
+  if (conn->write_buf_size < SVN_RA_SVN__MAX_BUF_SIZE
+      && conn->write_pos + len <= SVN_RA_SVN__MAX_BUF_SIZE)
+    {
+      /* Old buffers remain in the buffer pool until the connection goes
+       * idle.  Due to the doubling, they add up to less than
+       * SVN_RA_SVN__MAX_BUF_SIZE. */
+      apr_size_t new_size = conn->write_buf_size * 2;
+      char *new_buf;
+
+      while (new_size < conn->write_pos + len)
+        new_size *= 2;
+
+      new_buf = apr_palloc(get_buf_pool(conn), new_size);
+      memcpy(new_buf, conn->write_buf, conn->write_pos);
+      conn->write_buf = new_buf;
+      conn->write_buf_size = new_size;
+
+      return SVN_NO_ERROR;
+    }
+
+  return svn_error_trace(writebuf_flush(conn, pool));
+}
+
 static svn_error_t *writebuf_write(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
                                    const char *data, apr_size_t len)
 {
-  /* data >= 8k is sent immediately */
-  if (len >= sizeof(conn->write_buf) / 2)
+  /* data of half the buffer size or more is sent immediately */
+  if (len >= conn->write_buf_size / 2)
     {
-      if (conn->write_pos > 0)
-        SVN_ERR(writebuf_flush(conn, pool));
-
-      return writebuf_output(conn, pool, data, len);
+      /* Send what we have buffered together with DATA, such that e.g.
+       * the header of a textdelta chunk does not need a system call of
+       * its own.  Clear conn->write_pos first in case the block handler
+       * does a read. */
+      struct iovec vec[2];
+
+      vec[0].iov_base = conn->write_buf;
+      vec[0].iov_len = conn->write_pos;
+      vec[1].iov_base = (void *)data;
+      vec[1].iov_len = len;
+      conn->write_pos = 0;
+
+      return svn_error_trace(writebuf_outputv(conn, pool, vec, 2));
     }
 
   /* ensure room for the data to add */
-  if (conn->write_pos + len > sizeof(conn->write_buf))
-    SVN_ERR(writebuf_flush(conn, pool));
+  if (conn->write_pos + len > conn->write_buf_size)
+    SVN_ERR(writebuf_make_room(conn, pool, len));
 
   /* buffer the new data block as well */
   memcpy(conn->write_buf + conn->write_pos, data, len);
@@ -443,7 +632,7 @@ static svn_error_t *writebuf_write(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
 static APR_INLINE svn_error_t *
 writebuf_writechar(svn_ra_svn_conn_t *conn, apr_pool_t *pool, char data)
 {
-  if (conn->write_pos < sizeof(conn->write_buf))
+  if (conn->write_pos < conn->write_buf_size)
   {
     conn->write_buf[conn->write_pos] = data;
     conn->write_pos++;
@@ -491,6 +680,7 @@ static svn_error_t *readbuf_input(svn_ra_svn_conn_t *conn, char *data,
   if (*len == 0)
     return svn_error_create(SVN_ERR_RA_SVN_CONNECTION_CLOSED, NULL, NULL);
   conn->current_in += *len;
+  conn->total_in += *len;
 
   if (session)
     {
@@ -517,7 +707,7 @@ static svn_error_t *readbuf_skip(svn_ra_svn_conn_t *conn, apr_uint64_t len)
     if (len == 0)
       break;
 
-    buflen = sizeof(conn->read_buf);
+    buflen = conn->read_buf_size;
     SVN_ERR(svn_ra_svn__stream_read(conn->stream, conn->read_buf, &buflen));
     if (buflen == 0)
       return svn_error_create(SVN_ERR_RA_SVN_CONNECTION_CLOSED, NULL, NULL);
@@ -542,8 +732,18 @@ static svn_error_t *readbuf_fill(svn_ra_svn_conn_t *conn, apr_pool_t *pool)
   if (conn->write_pos)
     SVN_ERR(writebuf_flush(conn, pool));
 
+  /* If the previous data filled the whole buffer, the other side is
+   * most likely sending bulk data.  Read it in larger chunks. */
+  if (   conn->read_end == conn->read_buf + conn->read_buf_size
+      && conn->read_buf_size < SVN_RA_SVN__MAX_BUF_SIZE)
+    {
+      /* As with the write buffer, old buffers stay in the pool. */
+      conn->read_buf_size *= 2;
+      conn->read_buf = apr_palloc(get_buf_pool(conn), conn->read_buf_size);
+    }
+
   /* Fill (some of the) buffer. */
-  len = sizeof(conn->read_buf);
+  len = conn->read_buf_size;
   SVN_ERR(readbuf_input(conn, conn->read_buf, &len, pool));
   conn->read_ptr = conn->read_buf;
   conn->read_end = conn->read_buf + len;
@@ -584,7 +784,7 @@ static svn_error_t *readbuf_read(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
   data = readbuf_drain(conn, data, end);
 
   /* Read large chunks directly into buffer. */
-  while (end - data > (apr_ssize_t)sizeof(conn->read_buf))
+  while (end - data > (apr_ssize_t)conn->read_buf_size)
     {
       SVN_ERR(writebuf_flush(conn, pool));
       count = end - data;
@@ -606,7 +806,7 @@ static svn_error_t *readbuf_read(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
 static svn_error_t *readbuf_skip_leading_garbage(svn_ra_svn_conn_t *conn,
                                                  apr_pool_t *pool)
 {
-  char buf[256];  /* Must be smaller than sizeof(conn->read_buf) - 1. */
+  char buf[256];  /* Must be smaller than SVN_RA_SVN__READBUF_SIZE - 1. */
   const char *p, *end;
   apr_size_t len;
   svn_boolean_t lparen = FALSE;
@@ -650,8 +850,8 @@ static svn_error_t *write_number(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
 
   /* SVN_INT64_BUFFER_SIZE includes space for a terminating NUL that
    * svn__ui64toa will always append. */
-  if (conn->write_pos + SVN_INT64_BUFFER_SIZE >= sizeof(conn->write_buf))
-    SVN_ERR(writebuf_flush(conn, pool));
+  if (conn->write_pos + SVN_INT64_BUFFER_SIZE >= conn->write_buf_size)
+    SVN_ERR(writebuf_make_room(conn, pool, SVN_INT64_BUFFER_SIZE + 1));
 
   written = svn__ui64toa(conn->write_buf + conn->write_pos, number);
   conn->write_buf[conn->write_pos + written] = follow;
@@ -710,7 +910,7 @@ svn_ra_svn__write_ncstring(svn_ra_svn_conn_t *conn,
 {
   /* Apart from LEN bytes of string contents, we need room for a number,
      a colon and a space. */
-  apr_size_t max_fill = sizeof(conn->write_buf) - SVN_INT64_BUFFER_SIZE - 2;
+  apr_size_t max_fill = conn->write_buf_size - SVN_INT64_BUFFER_SIZE - 2;
 
   /* In most cases, there is enough left room in the WRITE_BUF
      the we can serialize directly into it.  On platforms with
@@ -753,6 +953,144 @@ svn_ra_svn__write_cstring(svn_ra_svn_conn_t *conn,
   return SVN_NO_ERROR;
 }
 
+#if APR_HAS_SENDFILE
+/* Send LEN bytes at OFFSET in FILE directly to the socket of CONN.  The
+   write buffer must be empty.  Use POOL for temporaries. */
+static svn_error_t *
+sendfile_output(svn_ra_svn_conn_t *conn,
+                apr_pool_t *pool,
+                apr_file_t *file,
+                apr_off_t offset,
+                apr_size_t len)
+{
+  apr_size_t remaining = len;
+  apr_pool_t *subpool = NULL;
+  svn_ra_svn__session_baton_t *session = conn->session;
+
+  /* Same accounting as in writebuf_output. */
+  conn->current_out += len;
+  conn->total_out += len;
+  SVN_ERR(check_io_limits(conn));
+
+  while (remaining > 0)
+    {
+      apr_size_t count = remaining;
+      apr_off_t file_offset = offset;
+      apr_status_t status;
+
+      if (session && session->callbacks && session->callbacks->cancel_func)
+        SVN_ERR((session->callbacks->cancel_func)(session->callbacks_baton));
+
+      status = apr_socket_sendfile(conn->sendfile_sock, file, NULL,
+                                   &file_offset, &count, 0);
+      if (status && !(APR_STATUS_IS_EAGAIN(status) && conn->block_handler))
+        return svn_error_wrap_apr(status, _("Can't write to connection"));
+
+      /* A blocking sendfile() that moves nothing without reporting an
+         error ran into the end of FILE.  Keep the string that we already
+         announced well-formed and report the early EOF instead of a
+         broken connection. */
+      if (count == 0 && !status && !conn->block_handler)
+        {
+          char padding[1024] = { 0 };
+          while (remaining > 0)
+            {
+              apr_size_t pad_len = MIN(remaining, sizeof(padding));
+              SVN_ERR(writebuf_write(conn, pool, padding, pad_len));
+              remaining -= pad_len;
+            }
+
+          return svn_error_create(SVN_ERR_STREAM_UNEXPECTED_EOF, NULL,
+                                  _("File ended before the data announced "
+                                    "for it"));
+        }
+
+      if (count == 0)
+        {
+          if (!conn->block_handler)
+            return svn_error_create(SVN_ERR_RA_SVN_CONNECTION_CLOSED, NULL,
+                                    _("Can't write to connection"));
+
+          if (!subpool)
+            subpool = svn_pool_create(pool);
+          else
+            svn_pool_clear(subpool);
+          SVN_ERR(conn->block_handler(conn, subpool, conn->block_baton));
+        }
+
+      offset += count;
+      remaining -= count;
+    }
+
+  conn->written_since_error_check += len;
+  conn->may_check_for_error
+    = conn->written_since_error_check >= conn->error_check_interval;
+
+  if (subpool)
+    svn_pool_destroy(subpool);
+  return SVN_NO_ERROR;
+}
+#endif
+
+svn_error_t *
+svn_ra_svn__write_file_span(svn_ra_svn_conn_t *conn,
+                            apr_pool_t *pool,
+                            apr_file_t *file,
+                            apr_off_t offset,
+                            svn_filesize_t length)
+{
+  char *buffer = NULL;
+  svn_filesize_t file_size;
+
+  /* Don't announce data that the file does not hold.  This catches
+     truncated files before anything went out on the wire. */
+  SVN_ERR(svn_io_file_size_get(&file_size, file, pool));
+  if (offset < 0 || length < 0 || offset + length > file_size)
+    return svn_error_createf(SVN_ERR_STREAM_UNEXPECTED_EOF, NULL,
+                             _("File of %s bytes is too short for %s bytes "
+                               "at offset %s"),
+                             apr_psprintf(pool, "%" SVN_FILESIZE_T_FMT,
+                                          file_size),
+                             apr_psprintf(pool, "%" SVN_FILESIZE_T_FMT,
+                                          length),
+                             apr_off_t_toa(pool, offset));
+
+  while (length > 0)
+    {
+      apr_size_t len = (apr_size_t)MIN(length, FILE_SPAN_CHUNK_SIZE);
+
+#if APR_HAS_SENDFILE
+      if (conn->sendfile_sock)
+        {
+          SVN_ERR(write_number(conn, pool, len, ':'));
+          SVN_ERR(writebuf_flush(conn, pool));
+          SVN_ERR(sendfile_output(conn, pool, file, offset, len));
+        }
+      else
+#endif
+        {
+          if (buffer == NULL)
+            {
+              buffer = apr_palloc(pool, FILE_SPAN_CHUNK_SIZE);
+              SVN_ERR(svn_io_file_seek(file, APR_SET, &offset, pool));
+            }
+
+          /* Don't announce data that we fail to read.  Then, the strings
+             sent so far remain well-formed. */
+          SVN_ERR(svn_io_file_read_full2(file, buffer, len, NULL, NULL,
+                                         pool));
+          SVN_ERR(write_number(conn, pool, len, ':'));
+          SVN_ERR(writebuf_write(conn, pool, buffer, len));
+        }
+
+      SVN_ERR(writebuf_writechar(conn, pool, ' '));
+      offset += len;
+      length -= len;
+    }
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_ra_svn__write_word(svn_ra_svn_conn_t *conn,
                        apr_pool_t *pool,
@@ -812,7 +1150,7 @@ svn_error_t *
 svn_ra_svn__start_list(svn_ra_svn_conn_t *conn,
                        apr_pool_t *pool)
 {
-  if (conn->write_pos + 2 <= sizeof(conn->write_buf))
+  if (conn->write_pos + 2 <= conn->write_buf_size)
     {
       conn->write_buf[conn->write_pos] = '(';
       conn->write_buf[conn->write_pos+1] = ' ';
@@ -827,7 +1165,7 @@ svn_error_t *
 svn_ra_svn__end_list(svn_ra_svn_conn_t *conn,
                      apr_pool_t *pool)
 {
-  if (conn->write_pos + 2 <= sizeof(conn->write_buf))
+  if (conn->write_pos + 2 <= conn->write_buf_size)
   {
     conn->write_buf[conn->write_pos] = ')';
     conn->write_buf[conn->write_pos+1] = ' ';
@@ -972,7 +1310,7 @@ write_tuple_string_opt_list(svn_ra_svn_conn_t *conn,
 
   /* If this how far we can fill the WRITE_BUF with string data and still
      guarantee that the length info will fit in as well. */
-  max_fill = sizeof(conn->write_buf)
+  max_fill = conn->write_buf_size
            - 2                       /* open list */
            - SVN_INT64_BUFFER_SIZE   /* string length + separator */
            - 2;                      /* close list */
@@ -1531,17 +1869,319 @@ read_command_only(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
   return SVN_NO_ERROR;
 }
 
+/* Outcome of scan_item(). */
+typedef enum scan_result_t
+{
+  /* The item is fully contained in the scanned data. */
+  scan_complete,
+
+  /* The data ends before the item does. */
+  scan_incomplete,
+
+  /* The item is malformed or too large to be parsed from the read buffer.
+   * Leave it to read_item() to process it or to report the error. */
+  scan_unsupported
+} scan_result_t;
+
+/* Numbers with up to this many decimal digits fit into 64 bits. */
+#define MAX_SCANNED_NUMBER_DIGITS 19
+
+/* Check whether the item starting with the non-whitespace char at *P is
+ * completely contained in the data ending at END.  If so, set *P to the
+ * position just behind the whitespace terminating the item and add the
+ * number of items, including all list elements at any depth, to *COUNT.
+ * LEVEL is the current nesting level and should be 0 for the first call.
+ *
+ * This does not allocate memory and does not read from the connection. */
+static scan_result_t
+scan_item(const char **p,
+          const char *end,
+          apr_size_t *count,
+          int level)
+{
+  const char *s = *p;
+
+  if (++level >= ITEM_NESTING_LIMIT)
+    return scan_unsupported;
+
+  ++*count;
+  if (svn_ctype_isdigit(*s))
+    {
+      /* It's a number or a string. */
+      apr_uint64_t val = 0;
+      const char *first = s;
+
+      for (; s < end && svn_ctype_isdigit(*s); ++s)
+        {
+          if (s - first == MAX_SCANNED_NUMBER_DIGITS)
+            return scan_unsupported;
+          val = val * 10 + (*s - '0');
+        }
+
+      if (s < end && *s == ':')
+        {
+          /* It's a string.  Long ones get special treatment by
+           * read_string() and would not fit into the buffer anyway. */
+          ++s;
+          if (val > SVN_RA_SVN__READBUF_SIZE)
+            return scan_unsupported;
+          if (val >= (apr_uint64_t)(end - s))
+            return scan_incomplete;
+          s += val;
+        }
+    }
+  else if (svn_ctype_isalpha(*s))
+    {
+      /* It's a word. */
+      const char *first = s;
+      for (++s; s < end && (svn_ctype_isalnum(*s) || *s == '-'); ++s)
+        ;
+
+      if (s - first >= MAX_WORD_LENGTH)
+        return scan_unsupported;
+    }
+  else if (*s == '(')
+    {
+      /* It's a list. */
+      ++s;
+      while (TRUE)
+        {
+          scan_result_t result;
+
+          while (s < end && svn_iswhitespace(*s))
+            ++s;
+          if (s == end)
+            return scan_incomplete;
+          if (*s == ')')
+            break;
+
+          result = scan_item(&s, end, count, level);
+          if (result != scan_complete)
+            return result;
+        }
+      ++s;
+    }
+  else
+    {
+      return scan_unsupported;
+    }
+
+  if (s == end)
+    return scan_incomplete;
+  if (!svn_iswhitespace(*s))
+    return scan_unsupported;
+
+  *p = s + 1;
+  return scan_complete;
+}
+
+/* Parse the item starting at *P into ITEM.  The data must have been
+ * validated by scan_item().  Strings and words will point into that data,
+ * i.e. the whitespace terminating them gets replaced by NUL.  Set *P to
+ * the position just behind that whitespace.
+ *
+ * The elements of any list will be taken from *SLAB, which will be
+ * advanced accordingly.  Only lists with an unusually large number of
+ * elements will require temporary allocations in SCRATCH_POOL. */
+static void
+parse_item(svn_ra_svn__item_t *item,
+           char **p,
+           svn_ra_svn__item_t **slab,
+           apr_pool_t *scratch_pool)
+{
+  char *s = *p;
+
+  if (svn_ctype_isdigit(*s))
+    {
+      apr_uint64_t val = 0;
+      for (; svn_ctype_isdigit(*s); ++s)
+        val = val * 10 + (*s - '0');
+
+      if (*s == ':')
+        {
+          ++s;
+          item->kind = SVN_RA_SVN_STRING;
+          item->u.string.data = s;
+          item->u.string.len = (apr_size_t)val;
+          s += val;
+        }
+      else
+        {
+          item->kind = SVN_RA_SVN_NUMBER;
+          item->u.number = val;
+        }
+    }
+  else if (svn_ctype_isalpha(*s))
+    {
+      item->kind = SVN_RA_SVN_WORD;
+      item->u.word.data = s;
+      for (++s; svn_ctype_isalnum(*s) || *s == '-'; ++s)
+        ;
+      item->u.word.len = s - item->u.word.data;
+    }
+  else
+    {
+      /* Collect the list elements on the stack first because their own
+       * sub-lists will be taken from *SLAB as well.  See read_item() for
+       * the sizing rationale. */
+      svn_ra_svn__item_t stack_items[12];
+      svn_ra_svn__item_t *items = stack_items;
+      int capacity = sizeof(stack_items) / sizeof(stack_items[0]);
+      int count = 0;
+
+      for (++s; TRUE; )
+        {
+          while (svn_iswhitespace(*s))
+            ++s;
+          if (*s == ')')
+            break;
+
+          if (count == capacity)
+            {
+              svn_ra_svn__item_t *new_items
+                = apr_palloc(scratch_pool, 2 * capacity * sizeof(*new_items));
+              memcpy(new_items, items, capacity * sizeof(*new_items));
+              items = new_items;
+              capacity = 2 * capacity;
+            }
+
+          parse_item(&items[count], &s, slab, scratch_pool);
+          ++count;
+        }
+      ++s;
+
+      item->kind = SVN_RA_SVN_LIST;
+      item->u.list.nelts = count;
+      if (count)
+        {
+          item->u.list.items = *slab;
+          memcpy(*slab, items, count * sizeof(*items));
+          *slab += count;
+        }
+      else
+        {
+          item->u.list.items = NULL;
+        }
+    }
+
+  *s = '\0';
+  *p = s + 1;
+}
+
+/* The first char of an item has just been read from CONN.  If the whole
+ * item fits into CONN's read buffer, make sure it is in there, set *END to
+ * the position just behind the whitespace terminating it, set *COUNT to the
+ * number of items it contains, including itself, and set *BUFFERED to TRUE.
+ * Otherwise, set *BUFFERED to FALSE.  In both cases, the item starts at
+ * CONN->READ_PTR - 1, i.e. nothing gets consumed.
+ *
+ * If the buffer ends before the item does, move the unread data to the
+ * start of the buffer and read more data from CONN to fill it up. */
+static svn_error_t *
+buffer_item(svn_boolean_t *buffered,
+            const char **end,
+            apr_size_t *count,
+            svn_ra_svn_conn_t *conn,
+            apr_pool_t *pool)
+{
+  char *start = conn->read_ptr - 1;
+
+  while (TRUE)
+    {
+      scan_result_t result;
+      apr_size_t len;
+
+      *end = start;
+      *count = 0;
+      result = scan_item(end, conn->read_end, count, 0);
+      if (result == scan_complete)
+        break;
+
+      /* Don't try to parse items that don't fit into the buffer. */
+      if (   result == scan_unsupported
+          || (   start == conn->read_buf
+              && conn->read_end == conn->read_buf + conn->read_buf_size))
+        {
+          *buffered = FALSE;
+          return SVN_NO_ERROR;
+        }
+
+      /* Make room for the rest of the item and wait for it to arrive. */
+      if (start != conn->read_buf)
+        {
+          memmove(conn->read_buf, start, conn->read_end - start);
+          conn->read_end -= start - conn->read_buf;
+          start = conn->read_buf;
+          conn->read_ptr = start + 1;
+        }
+
+      if (conn->write_pos)
+        SVN_ERR(writebuf_flush(conn, pool));
+
+      len = conn->read_buf + conn->read_buf_size - conn->read_end;
+      SVN_ERR(readbuf_input(conn, conn->read_end, &len, pool));
+      conn->read_end += len;
+    }
+
+  *buffered = TRUE;
+  return SVN_NO_ERROR;
+}
+
+/* The first char of an item has just been read from CONN.  If the whole
+ * item can be parsed from CONN's read buffer, do so, allocate the result
+ * in POOL, return it in *ITEM and set *PARSED to TRUE.  Otherwise, leave
+ * the read position unchanged and set *PARSED to FALSE.
+ *
+ * This is the fast path for svn_ra_svn__read_item():  Rather than fetching
+ * every byte through readbuf_getchar() and allocating every string and
+ * every list separately, we scan the raw data once, copy it into POOL
+ * and let all strings and words point into that copy.  The elements of all
+ * lists are taken from a single array.  So, reading a typical command or
+ * response takes only two allocations. */
+static svn_error_t *
+read_item_from_buffer(svn_boolean_t *parsed,
+                      svn_ra_svn__item_t **item,
+                      svn_ra_svn_conn_t *conn,
+                      apr_pool_t *pool)
+{
+  const char *start, *end;
+  apr_size_t count;
+  svn_ra_svn__item_t *slab;
+  char *data;
+
+  SVN_ERR(buffer_item(parsed, &end, &count, conn, pool));
+  if (!*parsed)
+    return SVN_NO_ERROR;
+
+  start = conn->read_ptr - 1;
+  data = apr_pmemdup(pool, start, end - start);
+  slab = apr_palloc(pool, count * sizeof(*slab));
+  conn->read_ptr += end - conn->read_ptr;
+
+  *item = slab++;
+  parse_item(*item, &data, &slab, pool);
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_ra_svn__read_item(svn_ra_svn_conn_t *conn,
                       apr_pool_t *pool,
                       svn_ra_svn__item_t **item)
 {
   char c;
+  svn_boolean_t parsed;
 
-  /* Allocate space, read the first character, and then do the rest of
-   * the work.  This makes sense because of the way lists are read. */
-  *item = apr_palloc(pool, sizeof(**item));
+  /* Read the first character, and then do the rest of the work.  This
+   * makes sense because of the way lists are read. */
   SVN_ERR(readbuf_getchar_skip_whitespace(conn, pool, &c));
+
+  /* Most items can be parsed directly from the read buffer. */
+  SVN_ERR(read_item_from_buffer(&parsed, item, conn, pool));
+  if (parsed)
+    return SVN_NO_ERROR;
+
+  *item = apr_palloc(pool, sizeof(**item));
   return read_item(conn, pool, *item, c, 0);
 }
 
@@ -1584,6 +2224,113 @@ svn_ra_svn__skip_leading_garbage(svn_ra_svn_conn_t *conn,
 
 /* --- READING AND PARSING TUPLES --- */
 
+/* *FMT points to a '?' in a tuple specification.  Set the arguments for
+ * all remaining elements of the tuple to their "unspecified" values.
+ * Advance *FMT to the ')' that closes the tuple or to the end of the
+ * specification and advance AP by the corresponding arguments. */
+static svn_error_t *
+vparse_tuple_defaults(const char **fmt,
+                      va_list *ap)
+{
+  int nesting_level = 0;
+
+  for (; **fmt; (*fmt)++)
+    {
+      switch (**fmt)
+        {
+        case '?':
+          break;
+        case 'r':
+          *va_arg(*ap, svn_revnum_t *) = SVN_INVALID_REVNUM;
+          break;
+        case 's':
+          *va_arg(*ap, svn_string_t **) = NULL;
+          break;
+        case 'c':
+        case 'w':
+          *va_arg(*ap, const char **) = NULL;
+          break;
+        case 'l':
+          *va_arg(*ap, svn_ra_svn__list_t **) = NULL;
+          break;
+        case 'B':
+        case 'n':
+          *va_arg(*ap, apr_uint64_t *) = SVN_RA_SVN_UNSPECIFIED_NUMBER;
+          break;
+        case '3':
+          *va_arg(*ap, svn_tristate_t *) = svn_tristate_unknown;
+          break;
+        case 'b':
+          *va_arg(*ap, svn_boolean_t *) = FALSE;
+          break;
+        case '(':
+          nesting_level++;
+          break;
+        case ')':
+          if (--nesting_level < 0)
+            return SVN_NO_ERROR;
+          break;
+        default:
+          SVN_ERR_MALFUNCTION();
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* If ELT matches the tuple specification char FMT, which must not be '?',
+ * set the next argument in AP accordingly and return TRUE.  Otherwise,
+ * return FALSE. */
+static svn_boolean_t
+vparse_tuple_item(svn_ra_svn__item_t *elt,
+                  char fmt,
+                  va_list *ap)
+{
+  if (fmt == 'c' && elt->kind == SVN_RA_SVN_STRING)
+    *va_arg(*ap, const char **) = elt->u.string.data;
+  else if (fmt == 's' && elt->kind == SVN_RA_SVN_STRING)
+    *va_arg(*ap, svn_string_t **) = &elt->u.string;
+  else if (fmt == 'w' && elt->kind == SVN_RA_SVN_WORD)
+    *va_arg(*ap, const char **) = elt->u.word.data;
+  else if (fmt == 'b' && elt->kind == SVN_RA_SVN_WORD)
+    {
+      if (svn_string_compare(&elt->u.word, &str_true))
+        *va_arg(*ap, svn_boolean_t *) = TRUE;
+      else if (svn_string_compare(&elt->u.word, &str_false))
+        *va_arg(*ap, svn_boolean_t *) = FALSE;
+      else
+        return FALSE;
+    }
+  else if (fmt == 'n' && elt->kind == SVN_RA_SVN_NUMBER)
+    *va_arg(*ap, apr_uint64_t *) = elt->u.number;
+  else if (fmt == 'r' && elt->kind == SVN_RA_SVN_NUMBER)
+    *va_arg(*ap, svn_revnum_t *) = (svn_revnum_t) elt->u.number;
+  else if (fmt == 'B' && elt->kind == SVN_RA_SVN_WORD)
+    {
+      if (svn_string_compare(&elt->u.word, &str_true))
+        *va_arg(*ap, apr_uint64_t *) = TRUE;
+      else if (svn_string_compare(&elt->u.word, &str_false))
+        *va_arg(*ap, apr_uint64_t *) = FALSE;
+      else
+        return FALSE;
+    }
+  else if (fmt == '3' && elt->kind == SVN_RA_SVN_WORD)
+    {
+      if (svn_string_compare(&elt->u.word, &str_true))
+        *va_arg(*ap, svn_tristate_t *) = svn_tristate_true;
+      else if (svn_string_compare(&elt->u.word, &str_false))
+        *va_arg(*ap, svn_tristate_t *) = svn_tristate_false;
+      else
+        return FALSE;
+    }
+  else if (fmt == 'l' && elt->kind == SVN_RA_SVN_LIST)
+    *va_arg(*ap, svn_ra_svn__list_t **) = &elt->u.list;
+  else
+    return FALSE;
+
+  return TRUE;
+}
+
 /* Parse a tuple of svn_ra_svn__item_t *'s.  Advance *FMT to the end of the
  * tuple specification and advance AP by the corresponding arguments. */
 static svn_error_t *
@@ -1591,7 +2338,7 @@ vparse_tuple(const svn_ra_svn__list_t *items,
              const char **fmt,
              va_list *ap)
 {
-  int count, nesting_level;
+  int count;
   svn_ra_svn__item_t *elt;
 
   for (count = 0; **fmt && count < items->nelts; (*fmt)++, count++)
@@ -1605,94 +2352,13 @@ vparse_tuple(const svn_ra_svn__list_t *items,
           (*fmt)++;
           SVN_ERR(vparse_tuple(&elt->u.list, fmt, ap));
         }
-      else if (**fmt == 'c' && elt->kind == SVN_RA_SVN_STRING)
-        *va_arg(*ap, const char **) = elt->u.string.data;
-      else if (**fmt == 's' && elt->kind == SVN_RA_SVN_STRING)
-        *va_arg(*ap, svn_string_t **) = &elt->u.string;
-      else if (**fmt == 'w' && elt->kind == SVN_RA_SVN_WORD)
-        *va_arg(*ap, const char **) = elt->u.word.data;
-      else if (**fmt == 'b' && elt->kind == SVN_RA_SVN_WORD)
-        {
-          if (svn_string_compare(&elt->u.word, &str_true))
-            *va_arg(*ap, svn_boolean_t *) = TRUE;
-          else if (svn_string_compare(&elt->u.word, &str_false))
-            *va_arg(*ap, svn_boolean_t *) = FALSE;
-          else
-            break;
-        }
-      else if (**fmt == 'n' && elt->kind == SVN_RA_SVN_NUMBER)
-        *va_arg(*ap, apr_uint64_t *) = elt->u.number;
-      else if (**fmt == 'r' && elt->kind == SVN_RA_SVN_NUMBER)
-        *va_arg(*ap, svn_revnum_t *) = (svn_revnum_t) elt->u.number;
-      else if (**fmt == 'B' && elt->kind == SVN_RA_SVN_WORD)
-        {
-          if (svn_string_compare(&elt->u.word, &str_true))
-            *va_arg(*ap, apr_uint64_t *) = TRUE;
-          else if (svn_string_compare(&elt->u.word, &str_false))
-            *va_arg(*ap, apr_uint64_t *) = FALSE;
-          else
-            break;
-        }
-      else if (**fmt == '3' && elt->kind == SVN_RA_SVN_WORD)
-        {
-          if (svn_string_compare(&elt->u.word, &str_true))
-            *va_arg(*ap, svn_tristate_t *) = svn_tristate_true;
-          else if (svn_string_compare(&elt->u.word, &str_false))
-            *va_arg(*ap, svn_tristate_t *) = svn_tristate_false;
-          else
-            break;
-        }
-      else if (**fmt == 'l' && elt->kind == SVN_RA_SVN_LIST)
-        *va_arg(*ap, svn_ra_svn__list_t **) = &elt->u.list;
       else if (**fmt == ')')
         return SVN_NO_ERROR;
-      else
+      else if (!vparse_tuple_item(elt, **fmt, ap))
         break;
     }
   if (**fmt == '?')
-    {
-      nesting_level = 0;
-      for (; **fmt; (*fmt)++)
-        {
-          switch (**fmt)
-            {
-            case '?':
-              break;
-            case 'r':
-              *va_arg(*ap, svn_revnum_t *) = SVN_INVALID_REVNUM;
-              break;
-            case 's':
-              *va_arg(*ap, svn_string_t **) = NULL;
-              break;
-            case 'c':
-            case 'w':
-              *va_arg(*ap, const char **) = NULL;
-              break;
-            case 'l':
-              *va_arg(*ap, svn_ra_svn__list_t **) = NULL;
-              break;
-            case 'B':
-            case 'n':
-              *va_arg(*ap, apr_uint64_t *) = SVN_RA_SVN_UNSPECIFIED_NUMBER;
-              break;
-            case '3':
-              *va_arg(*ap, svn_tristate_t *) = svn_tristate_unknown;
-              break;
-            case 'b':
-              *va_arg(*ap, svn_boolean_t *) = FALSE;
-              break;
-            case '(':
-              nesting_level++;
-              break;
-            case ')':
-              if (--nesting_level < 0)
-                return SVN_NO_ERROR;
-              break;
-            default:
-              SVN_ERR_MALFUNCTION();
-            }
-        }
-    }
+    SVN_ERR(vparse_tuple_defaults(fmt, ap));
   if (**fmt && **fmt != ')')
     return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
                             _("Malformed network data"));
@@ -1731,6 +2397,193 @@ svn_ra_svn__read_tuple(svn_ra_svn_conn_t *conn,
   return err;
 }
 
+/* Parse the elements of the tuple starting at *P, just behind its opening
+ * parenthesis, as vparse_tuple() would parse them once read into a list.
+ * The data must have been validated by scan_item() and ends at END.  Like
+ * parse_item(), let strings and words point into that data.  Set *P to
+ * the position just behind the whitespace following the closing
+ * parenthesis.  Advance *FMT and AP as vparse_tuple() does.
+ *
+ * Only 's' and 'l' elements need allocations in POOL; all other elements
+ * are converted on the stack. */
+static svn_error_t *
+vparse_raw_tuple(char **p,
+                 const char *end,
+                 const char **fmt,
+                 va_list *ap,
+                 apr_pool_t *pool)
+{
+  char *s = *p;
+  svn_ra_svn__item_t local_elt;
+  svn_ra_svn__item_t *elt;
+
+  for (; **fmt; (*fmt)++)
+    {
+      while (svn_iswhitespace(*s))
+        ++s;
+      if (*s == ')')
+        break;
+
+      /* '?' just means the tuple may stop; skip past it. */
+      if (**fmt == '?')
+        (*fmt)++;
+      if (**fmt == '(' && *s == '(')
+        {
+          ++s;
+          (*fmt)++;
+          SVN_ERR(vparse_raw_tuple(&s, end, fmt, ap, pool));
+          continue;
+        }
+      else if (**fmt == ')')
+        break;
+
+      if (*s == '(')
+        {
+          /* A list that is not a sub-tuple needs its full item tree. */
+          const char *list_end = s;
+          apr_size_t count = 0;
+          svn_ra_svn__item_t *slab;
+
+          scan_item(&list_end, end, &count, 0);
+          slab = apr_palloc(pool, count * sizeof(*slab));
+          elt = slab++;
+          parse_item(elt, &s, &slab, pool);
+        }
+      else
+        {
+          /* The caller will keep a pointer to 's' elements. */
+          elt = **fmt == 's' ? apr_palloc(pool, sizeof(*elt)) : &local_elt;
+          parse_item(elt, &s, NULL, pool);
+        }
+
+      if (!vparse_tuple_item(elt, **fmt, ap))
+        break;
+    }
+  if (**fmt == '?')
+    SVN_ERR(vparse_tuple_defaults(fmt, ap));
+  if (**fmt && **fmt != ')')
+    return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                            _("Malformed network data"));
+
+  /* Skip any elements not covered by *FMT and the closing parenthesis. */
+  while (TRUE)
+    {
+      const char *next;
+      apr_size_t count = 0;
+
+      while (svn_iswhitespace(*s))
+        ++s;
+      if (*s == ')')
+        break;
+
+      next = s;
+      scan_item(&next, end, &count, 0);
+      s += next - s;
+    }
+
+  *p = s + 2;
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_ra_svn__peek_command(svn_string_t *command,
+                         svn_ra_svn_conn_t *conn,
+                         apr_pool_t *pool)
+{
+  char c;
+  const char *p, *word;
+
+  command->data = NULL;
+  command->len = 0;
+
+  /* C is still in the buffer, right before READ_PTR.  Un-read it. */
+  SVN_ERR(readbuf_getchar_skip_whitespace(conn, pool, &c));
+  --conn->read_ptr;
+  if (c != '(')
+    return SVN_NO_ERROR;
+
+  for (p = conn->read_ptr + 1; p < conn->read_end && svn_iswhitespace(*p); ++p)
+    ;
+  if (p == conn->read_end || !svn_ctype_isalpha(*p))
+    return SVN_NO_ERROR;
+
+  /* If the word reaches the end of the buffer, it might be longer. */
+  for (word = p++; p < conn->read_end && (svn_ctype_isalnum(*p) || *p == '-');
+       ++p)
+    ;
+  if (p == conn->read_end)
+    return SVN_NO_ERROR;
+
+  command->data = word;
+  command->len = p - word;
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_ra_svn__read_command_tuple(svn_ra_svn_conn_t *conn,
+                               apr_pool_t *pool,
+                               const char *fmt, ...)
+{
+  va_list ap;
+  char c;
+  svn_boolean_t buffered;
+  const char *end;
+  apr_size_t count;
+  svn_ra_svn__item_t *item;
+  svn_error_t *err;
+
+  SVN_ERR(readbuf_getchar_skip_whitespace(conn, pool, &c));
+  SVN_ERR(buffer_item(&buffered, &end, &count, conn, pool));
+  if (buffered && c == '(')
+    {
+      /* Parse a copy of the raw data because the handler may read other
+       * commands before it is done with the parameters. */
+      const char *start = conn->read_ptr - 1;
+      char *p = apr_pmemdup(pool, start, end - start);
+      const char *copy_end = p + (end - start);
+      conn->read_ptr += end - conn->read_ptr;
+
+      /* Skip the opening parenthesis and the command word. */
+      for (++p; svn_iswhitespace(*p); ++p)
+        ;
+      if (svn_ctype_isalpha(*p))
+        {
+          while (!svn_iswhitespace(*p))
+            ++p;
+          while (svn_iswhitespace(*p))
+            ++p;
+          if (*p == '(')
+            {
+              ++p;
+              va_start(ap, fmt);
+              err = vparse_raw_tuple(&p, copy_end, &fmt, &ap, pool);
+              va_end(ap);
+              return err;
+            }
+        }
+
+      return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                              _("Malformed network data"));
+    }
+
+  /* Commands that are too large for the buffer, e.g. because of a long
+   * string, take the slow path. */
+  item = apr_palloc(pool, sizeof(*item));
+  SVN_ERR(read_item(conn, pool, item, c, 0));
+  if (   item->kind != SVN_RA_SVN_LIST
+      || item->u.list.nelts < 2
+      || SVN_RA_SVN__LIST_ITEM(&item->u.list, 0).kind != SVN_RA_SVN_WORD
+      || SVN_RA_SVN__LIST_ITEM(&item->u.list, 1).kind != SVN_RA_SVN_LIST)
+    return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                            _("Malformed network data"));
+
+  va_start(ap, fmt);
+  err = vparse_tuple(&SVN_RA_SVN__LIST_ITEM(&item->u.list, 1).u.list,
+                     &fmt, &ap);
+  va_end(ap);
+  return err;
+}
+
 svn_error_t *
 svn_ra_svn__read_command_only(svn_ra_svn_conn_t *conn,
                               apr_pool_t *pool,
@@ -1862,6 +2715,105 @@ svn_ra_svn__read_cmd_response(svn_ra_svn_conn_t *conn,
                            status);
 }
 
+/* Return TRUE if the read buffer of CONN contains a complete item,
+ * not counting leading whitespace.  Malformed data counts as complete
+ * such that the parser gets to report it.
+ */
+static svn_boolean_t
+readbuf_has_complete_item(svn_ra_svn_conn_t *conn)
+{
+  const char *p = conn->read_ptr;
+  const char *end = conn->read_end;
+  int depth = 0;
+
+  while (p < end)
+    {
+      if (svn_iswhitespace(*p))
+        {
+          ++p;
+        }
+      else if (*p == '(')
+        {
+          ++depth;
+          ++p;
+        }
+      else if (*p == ')')
+        {
+          if (--depth <= 0)
+            return TRUE;
+          ++p;
+        }
+      else if (svn_ctype_isdigit(*p))
+        {
+          /* Number or length-prefixed string. */
+          apr_uint64_t val = 0;
+          for (; p < end && svn_ctype_isdigit(*p); ++p)
+            {
+              val = val * 10 + (*p - '0');
+              if (val > SVN_RA_SVN__MAX_BUF_SIZE)
+                return TRUE;
+            }
+
+          if (p == end)
+            return FALSE;
+
+          if (*p == ':')
+            {
+              if (val >= (apr_uint64_t)(end - p))
+                return FALSE;
+              p += (apr_size_t)val + 1;
+            }
+
+          if (depth == 0)
+            return TRUE;
+        }
+      else if (svn_ctype_isalpha(*p))
+        {
+          /* Word. */
+          while (p < end && (svn_ctype_isalnum(*p) || *p == '-'))
+            ++p;
+
+          if (p == end)
+            return FALSE;
+
+          if (depth == 0)
+            return TRUE;
+        }
+      else
+        {
+          return TRUE;
+        }
+    }
+
+  return FALSE;
+}
+
+/* Move the unprocessed data in the read buffer of CONN to its start and
+ * append as much data as the socket provides in a single read.  Set
+ * *APPENDED to FALSE if there is no space left in the buffer.
+ */
+static svn_error_t *
+readbuf_append(svn_boolean_t *appended,
+               svn_ra_svn_conn_t *conn,
+               apr_pool_t *pool)
+{
+  apr_size_t buffered = conn->read_end - conn->read_ptr;
+  apr_size_t len = conn->read_buf_size - buffered;
+
+  *appended = len > 0;
+  if (!*appended)
+    return SVN_NO_ERROR;
+
+  memmove(conn->read_buf, conn->read_ptr, buffered);
+  conn->read_ptr = conn->read_buf;
+  conn->read_end = conn->read_buf + buffered;
+
+  SVN_ERR(readbuf_input(conn, conn->read_end, &len, pool));
+  conn->read_end += len;
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_ra_svn__has_command(svn_boolean_t *has_command,
                         svn_boolean_t *terminated,
@@ -1874,6 +2826,30 @@ svn_ra_svn__has_command(svn_boolean_t *has_command,
   svn_ra_svn__reset_command_io_counters(conn);
 
   err = svn_ra_svn__has_item(has_command, conn, pool);
+
+  /* Reading a partially received command would block.  So, pull in what
+   * has arrived so far and only report the command once it is complete.
+   * Commands exceeding the buffer will have to be read blockingly. */
+  while (!err && *has_command && !readbuf_has_complete_item(conn))
+    {
+      svn_boolean_t available;
+      svn_boolean_t appended = TRUE;
+
+      err = svn_ra_svn__data_available(conn, &available);
+      if (!err && !available)
+        *has_command = FALSE;
+      else if (!err)
+        err = readbuf_append(&appended, conn, pool);
+
+      if (!err && available && !appended)
+        break;
+    }
+
+  /* The connection will be waiting for the next command now.  Don't let
+   * it keep the large buffers of a previous bulk transfer. */
+  if (!err && !*has_command)
+    reset_buffers(conn);
+
   if (err && err->apr_err == SVN_ERR_RA_SVN_CONNECTION_CLOSED)
     {
       *terminated = TRUE;
@@ -1922,6 +2898,10 @@ svn_ra_svn__handle_command(svn_boolean_t *terminate,
       /* Call the standard command handler.
        * If that is not set, then this is a lecagy API call and we invoke
        * the legacy command handler. */
+      if (conn->command_hook)
+        conn->command_hook(conn->command_hook_baton, conn, cmdname,
+                           FALSE, FALSE);
+
       if (command->handler)
         {
           err = (*command->handler)(conn, pool, params, baton);
@@ -1941,6 +2921,10 @@ svn_ra_svn__handle_command(svn_boolean_t *terminate,
        * processing quickly if we may have truncated data. */
       err = svn_error_compose_create(check_io_limits(conn), err);
 
+      if (conn->command_hook)
+        conn->command_hook(conn->command_hook_baton, conn, cmdname,
+                           TRUE, err != NULL);
+
       *terminate = command->terminate;
     }
   else
@@ -2437,6 +3421,26 @@ svn_ra_svn__write_cmd_get_file(svn_ra_svn_conn_t *conn,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_ra_svn__write_cmd_fetch_many(svn_ra_svn_conn_t *conn,
+                                 apr_pool_t *pool,
+                                 svn_revnum_t rev,
+                                 const apr_array_header_t *paths)
+{
+  int i;
+
+  SVN_ERR(writebuf_write_literal(conn, pool, "( fetch-many ( "));
+  SVN_ERR(write_tuple_revision(conn, pool, rev));
+  SVN_ERR(write_tuple_start_list(conn, pool));
+  for (i = 0; i < paths->nelts; ++i)
+    SVN_ERR(write_tuple_cstring(conn, pool,
+                                APR_ARRAY_IDX(paths, i, const char *)));
+  SVN_ERR(write_tuple_end_list(conn, pool));
+  SVN_ERR(writebuf_write_literal(conn, pool, ") ) "));
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_ra_svn__write_cmd_update(svn_ra_svn_conn_t *conn,
                              apr_pool_t *pool,
@@ -2445,7 +3449,8 @@ svn_ra_svn__write_cmd_update(svn_ra_svn_conn_t *conn,
                              svn_boolean_t recurse,
                              svn_depth_t depth,
                              svn_boolean_t send_copyfrom_args,
-                             svn_boolean_t ignore_ancestry)
+                             svn_boolean_t ignore_ancestry,
+                             svn_boolean_t text_deltas)
 {
   SVN_ERR(writebuf_write_literal(conn, pool, "( update ( "));
   SVN_ERR(write_tuple_start_list(conn, pool));
@@ -2456,6 +3461,7 @@ svn_ra_svn__write_cmd_update(svn_ra_svn_conn_t *conn,
   SVN_ERR(write_tuple_depth(conn, pool, depth));
   SVN_ERR(write_tuple_boolean(conn, pool, send_copyfrom_args));
   SVN_ERR(write_tuple_boolean(conn, pool, ignore_ancestry));
+  SVN_ERR(write_tuple_boolean(conn, pool, text_deltas));
   SVN_ERR(writebuf_write_literal(conn, pool, ") ) "));
 
   return SVN_NO_ERROR;
@@ -2830,7 +3836,7 @@ svn_ra_svn__write_data_log_changed_path(svn_ra_svn_conn_t *conn,
   apr_size_t flags_len = flags_str->len;
 
   /* How much buffer space can we use for non-string data (worst case)? */
-  apr_size_t max_fill = sizeof(conn->write_buf)
+  apr_size_t max_fill = conn->write_buf_size
                       - 2                          /* list start */
                       - 2 - SVN_INT64_BUFFER_SIZE  /* path */
                       - 2                          /* action */
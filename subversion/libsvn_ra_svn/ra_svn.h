@@ -62,11 +62,18 @@ typedef svn_error_t *(*ra_svn_block_handler_t)(svn_ra_svn_conn_t *conn,
 #define SVN_RA_SVN__DEFAULT_USERAGENT  "SVN/" SVN_VER_NUMBER\
                                        " (" SVN_BUILD_TARGET ")"
 
-/* The size of our per-connection read and write buffers. */
+/* The initial size of our per-connection read and write buffers. */
 #define SVN_RA_SVN__PAGE_SIZE 4096
 #define SVN_RA_SVN__READBUF_SIZE (4 * SVN_RA_SVN__PAGE_SIZE)
 #define SVN_RA_SVN__WRITEBUF_SIZE (4 * SVN_RA_SVN__PAGE_SIZE)
 
+/* During bulk transfers, the buffers grow up to this size. */
+#define SVN_RA_SVN__MAX_BUF_SIZE (64 * SVN_RA_SVN__PAGE_SIZE)
+
+/* The maximum number of additional connections that an update may use
+ * to fetch file contents. */
+#define SVN_RA_SVN__MAX_FETCH_CONNECTIONS 8
+
 /* Create forward reference */
 typedef struct svn_ra_svn__session_baton_t svn_ra_svn__session_baton_t;
 
@@ -74,15 +81,34 @@ typedef struct svn_ra_svn__session_baton_t svn_ra_svn__session_baton_t;
  * first few fields during setup and cleanup. */
 struct svn_ra_svn_conn_st {
 
-  /* I/O buffers */
-  char write_buf[SVN_RA_SVN__WRITEBUF_SIZE];
-  char read_buf[SVN_RA_SVN__READBUF_SIZE];
+  /* I/O buffers.  They start at SVN_RA_SVN__WRITEBUF_SIZE and
+     SVN_RA_SVN__READBUF_SIZE, respectively, and grow while bulk data
+     passes through them. */
+  char *write_buf;
+  apr_size_t write_buf_size;
+  char *read_buf;
+  apr_size_t read_buf_size;
   char *read_ptr;
   char *read_end;
   apr_size_t write_pos;
 
+  /* The buffers of SVN_RA_SVN__WRITEBUF_SIZE and SVN_RA_SVN__READBUF_SIZE
+     allocated with the connection.  They get used again once the grown
+     buffers have been released. */
+  char *initial_write_buf;
+  char *initial_read_buf;
+
+  /* Sub-pool of POOL holding the grown I/O buffers.  It gets cleared
+     once the connection is idle.  NULL until the first buffer grows. */
+  apr_pool_t *buf_pool;
+
   svn_ra_svn__stream_t *stream;
   svn_ra_svn__session_baton_t *session;
+
+  /* The socket that STREAM writes to, if file contents may be sent to it
+     directly.  NULL for tunnels and once SASL encryption is active. */
+  apr_socket_t *sendfile_sock;
+
 #ifdef SVN_HAVE_SASL
   /* Although all reads and writes go through the svn_ra_svn__stream_t
      interface, SASL still needs direct access to the underlying socket
@@ -102,6 +128,14 @@ struct svn_ra_svn_conn_st {
   apr_uint64_t max_out;
   apr_uint64_t current_out;
 
+  /* I/O over the whole lifetime of the connection */
+  apr_uint64_t total_in;
+  apr_uint64_t total_out;
+
+  /* command hook, see svn_ra_svn__set_command_hook() */
+  svn_ra_svn__command_hook_t command_hook;
+  void *command_hook_baton;
+
   /* repository info */
   const char *uuid;
   const char *repos_root;
@@ -160,6 +194,10 @@ struct svn_ra_svn__session_baton_t {
   apr_off_t bytes_read, bytes_written; /* apr_off_t's because that's what
                                           the callback interface uses */
   const char *useragent;
+
+  /* Number of additional connections to fetch file contents over during
+     updates.  0 if updates shall receive the contents inline. */
+  int fetch_connections;
 };
 
 /* Set a callback for blocked writes on conn.  This handler may
@@ -222,6 +260,14 @@ svn_ra_svn__stream_t *svn_ra_svn__stream_create(svn_stream_t *in_stream,
 svn_error_t *svn_ra_svn__stream_write(svn_ra_svn__stream_t *stream,
                                       const char *data, apr_size_t *len);
 
+/* Write the NVEC buffers in VEC to STREAM, in that order, using as few
+ * system calls as possible.  Return the total number of bytes written in
+ * *LEN, which may be less than the size of all buffers combined.
+ */
+svn_error_t *svn_ra_svn__stream_writev(svn_ra_svn__stream_t *stream,
+                                       const struct iovec *vec, int nvec,
+                                       apr_size_t *len);
+
 /* Read *LEN bytes from STREAM into DATA, returning the number of bytes
  * read in *LEN.
  */
@@ -275,6 +321,55 @@ svn_boolean_t svn_ra_svn__find_mech(const svn_ra_svn__list_t *mechlist,
 /* Initialize the SASL library. */
 svn_error_t *svn_ra_svn__sasl_init(void);
 
+/* Read an auth request from SESS's connection and perform the
+ * authentication it asks for.  Use POOL for temporary allocations. */
+svn_error_t *
+svn_ra_svn__handle_auth_request(svn_ra_svn__session_baton_t *sess,
+                                apr_pool_t *pool);
+
+/* Open a new connection to the repository root of SESS, using the same
+ * tunnel, callbacks, authentication and configuration as SESS.  Return
+ * the new session in *AUX_P, allocated in RESULT_POOL.  Use SCRATCH_POOL
+ * for temporary allocations. */
+svn_error_t *
+svn_ra_svn__open_aux_session(svn_ra_svn__session_baton_t **aux_p,
+                             svn_ra_svn__session_baton_t *sess,
+                             apr_pool_t *result_pool,
+                             apr_pool_t *scratch_pool);
+
+/* Opaque edit baton of the fetch editor. */
+typedef struct svn_ra_svn__fetch_baton_t svn_ra_svn__fetch_baton_t;
+
+/* Return in *EDITOR and *EDIT_BATON an editor that receives an update
+ * edit sent without text deltas and drives EDITOR / EDIT_BATON with it.
+ * The contents of all changed files get fetched with fetch-many commands
+ * over up to SESS->FETCH_CONNECTIONS additional connections, starting with
+ * the already open AUX_SESS.  Files may therefore be closed after their
+ * siblings have been opened; parent directories will be closed only
+ * after all their children.
+ *
+ * BASE_RELPATH is the repository path that edit paths are relative to.
+ * Allocate the editor in POOL.
+ */
+svn_error_t *
+svn_ra_svn__get_fetch_editor(const svn_delta_editor_t **editor,
+                             svn_ra_svn__fetch_baton_t **edit_baton,
+                             svn_ra_svn__session_baton_t *sess,
+                             svn_ra_svn__session_baton_t *aux_sess,
+                             const char *base_relpath,
+                             const svn_delta_editor_t *wrapped_editor,
+                             void *wrapped_baton,
+                             apr_pool_t *pool);
+
+/* Tell the fetch editor EDIT_BATON that the edit path EDIT_RELPATH and
+ * everything below it corresponds to REPOS_RELPATH in the repository.
+ * This is what link_path reports do to an update.
+ */
+void
+svn_ra_svn__fetch_link_path(svn_ra_svn__fetch_baton_t *edit_baton,
+                            const char *edit_relpath,
+                            const char *repos_relpath);
+
 
 #ifdef __cplusplus
 }
@@ -140,8 +140,8 @@ synchronized_authz_initialize(void *baton, apr_pool_t *pool)
   svn_boolean_t multi_threaded = FALSE;
 #endif
 
-  SVN_ERR(svn_object_pool__create(&authz_pool, multi_threaded, pool));
-  SVN_ERR(svn_object_pool__create(&filtered_pool, multi_threaded, pool));
+  SVN_ERR(svn_object_pool__create(&authz_pool, TRUE, multi_threaded, pool));
+  SVN_ERR(svn_object_pool__create(&filtered_pool, TRUE, multi_threaded, pool));
 
   return SVN_NO_ERROR;
 }
@@ -100,7 +100,7 @@ svn_repos__config_pool_create(svn_repos__config_pool_t **config_pool,
                               svn_boolean_t thread_safe,
                               apr_pool_t *pool)
 {
-  return svn_error_trace(svn_object_pool__create(config_pool,
+  return svn_error_trace(svn_object_pool__create(config_pool, TRUE,
                                                  thread_safe, pool));
 }
 
@@ -44,6 +44,7 @@
 #include "private/svn_sorts_private.h"
 #include "private/svn_utf_private.h"
 #include "private/svn_cache.h"
+#include "private/svn_ordered_loop.h"
 
 #define ARE_VALID_COPY_ARGS(p,r) ((p) && SVN_IS_VALID_REVNUM(r))
 
@@ -2391,8 +2392,11 @@ report_error(svn_revnum_t revision,
     }
 }
 
-svn_error_t *
-svn_repos_verify_fs3(svn_repos_t *repos,
+/* Verify the revisions START_REV to END_REV in FS one after another.
+ * The parameters are the same as for svn_repos_verify_fs4().
+ */
+static svn_error_t *
+verify_fs_sequential(svn_fs_t *fs,
                      svn_revnum_t start_rev,
                      svn_revnum_t end_rev,
                      svn_boolean_t check_normalization,
@@ -2405,8 +2409,6 @@ svn_repos_verify_fs3(svn_repos_t *repos,
                      void *cancel_baton,
                      apr_pool_t *pool)
 {
-  svn_fs_t *fs = svn_repos_fs(repos);
-  svn_revnum_t youngest;
   svn_revnum_t rev;
   apr_pool_t *iterpool = svn_pool_create(pool);
   svn_repos_notify_t *notify;
@@ -2414,31 +2416,6 @@ svn_repos_verify_fs3(svn_repos_t *repos,
   struct verify_fs_notify_func_baton_t *verify_notify_baton = NULL;
   svn_error_t *err;
 
-  /* Make sure we catch up on the latest revprop changes.  This is the only
-   * time we will refresh the revprop data in this query. */
-  SVN_ERR(svn_fs_refresh_revision_props(fs, pool));
-
-  /* Determine the current youngest revision of the filesystem. */
-  SVN_ERR(svn_fs_youngest_rev(&youngest, fs, pool));
-
-  /* Use default vals if necessary. */
-  if (! SVN_IS_VALID_REVNUM(start_rev))
-    start_rev = 0;
-  if (! SVN_IS_VALID_REVNUM(end_rev))
-    end_rev = youngest;
-
-  /* Validate the revisions. */
-  if (start_rev > end_rev)
-    return svn_error_createf(SVN_ERR_REPOS_BAD_ARGS, NULL,
-                             _("Start revision %ld"
-                               " is greater than end revision %ld"),
-                             start_rev, end_rev);
-  if (end_rev > youngest)
-    return svn_error_createf(SVN_ERR_REPOS_BAD_ARGS, NULL,
-                             _("End revision %ld is invalid "
-                               "(youngest revision is %ld)"),
-                             end_rev, youngest);
-
   /* Create a notify object that we can reuse within the loop and a
      forwarding structure for notifications from inside svn_fs_verify(). */
   if (notify_func)
@@ -2497,14 +2474,386 @@ svn_repos_verify_fs3(svn_repos_t *repos,
           }
       }
 
-  /* We're done. */
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+#if APR_HAS_THREADS
+
+/* Parallel verification.
+ *
+ * The work gets split into "tasks" that are executed by a number of
+ * worker threads through svn_ordered_loop__run().  During the metadata
+ * phase, a task is a shard-aligned range of revisions passed to
+ * svn_fs_verify().  Afterwards, every task is a single revision passed
+ * to verify_one_revision().
+ *
+ * Workers buffer their notifications per task.  The calling thread then
+ * reports notifications and results strictly in task order, such that
+ * the output is the same as for a sequential run.
+ */
+
+/* Number of buffered results per worker thread. */
+#define VERIFY_RESULTS_PER_JOB 16
+
+/* Number of revisions per metadata task if we don't know the shard size
+ * of the repository. */
+#define VERIFY_DEFAULT_CHUNK_SIZE 1000
+
+/* Parameters of a verification run, shared by all workers. */
+typedef struct verify_jobs_t
+{
+  /* Repository to verify.  Every worker opens its own FS object. */
+  const char *fs_path;
+  apr_hash_t *fs_config;
+
+  /* Parameters as passed to svn_repos_verify_fs4(). */
+  svn_revnum_t start_rev;
+  svn_revnum_t end_rev;
+  svn_boolean_t check_normalization;
+  svn_repos_notify_func_t notify_func;
+  void *notify_baton;
+  svn_repos_verify_callback_t verify_callback;
+  void *verify_baton;
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+
+  /* TRUE while running the backend-specific checks, FALSE while running
+   * the per-revision checks. */
+  svn_boolean_t metadata_phase;
+
+  /* During the metadata phase, task I covers revisions CHUNK_BASE +
+   * I * CHUNK_SIZE to CHUNK_BASE + (I+1) * CHUNK_SIZE - 1, clipped to
+   * START_REV .. END_REV. */
+  svn_revnum_t chunk_base;
+  svn_revnum_t chunk_size;
+
+  /* Set by the reporting thread if some task sent a notification about
+   * global metadata. */
+  svn_boolean_t global_notified;
+
+  /* Reusable svn_repos_notify_verify_rev_end notification. */
+  svn_repos_notify_t *notify;
+} verify_jobs_t;
+
+/* Append a copy of NOTIFY to the svn_repos_notify_t * array in BATON.
+ * Implements svn_repos_notify_func_t. */
+static void
+buffer_notification(void *baton,
+                    const svn_repos_notify_t *notify,
+                    apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *notifications = baton;
+  apr_pool_t *pool = notifications->pool;
+  svn_repos_notify_t *copy = apr_pmemdup(pool, notify, sizeof(*notify));
+
+  if (notify->warning_str)
+    copy->warning_str = apr_pstrdup(pool, notify->warning_str);
+  if (notify->path)
+    copy->path = apr_pstrdup(pool, notify->path);
+
+  APR_ARRAY_PUSH(notifications, svn_repos_notify_t *) = copy;
+}
+
+/* Buffer a svn_repos_notify_verify_rev_structure notification for
+ * REVISION in the svn_repos_notify_t * array in BATON.
+ * Implements svn_fs_progress_notify_func_t. */
+static void
+buffer_fs_notification(svn_revnum_t revision,
+                       void *baton,
+                       apr_pool_t *pool)
+{
+  apr_array_header_t *notifications = baton;
+  svn_repos_notify_t *notify
+    = svn_repos_notify_create(svn_repos_notify_verify_rev_structure,
+                              notifications->pool);
+
+  notify->revision = revision;
+  APR_ARRAY_PUSH(notifications, svn_repos_notify_t *) = notify;
+}
+
+/* Per-thread data. */
+typedef struct verify_worker_t
+{
+  /* Shared parameters. */
+  verify_jobs_t *jobs;
+
+  /* Private FS object, NULL during the metadata phase. */
+  svn_fs_t *fs;
+} verify_worker_t;
+
+/* Create the verify_worker_t for a worker thread in THREAD_POOL and
+ * return it in *THREAD_BATON.  BATON is a verify_jobs_t *.
+ * Implements svn_ordered_loop__init_t. */
+static svn_error_t *
+init_verify_worker(void **thread_baton,
+                   void *baton,
+                   apr_pool_t *thread_pool,
+                   apr_pool_t *scratch_pool)
+{
+  verify_worker_t *worker = apr_pcalloc(thread_pool, sizeof(*worker));
+  worker->jobs = baton;
+
+  /* FS objects must not be shared between threads. */
+  if (!worker->jobs->metadata_phase)
+    SVN_ERR(svn_fs_open2(&worker->fs, worker->jobs->fs_path,
+                         worker->jobs->fs_config, thread_pool, scratch_pool));
+
+  *thread_baton = worker;
+  return SVN_NO_ERROR;
+}
+
+/* Execute TASK using the verify_worker_t in THREAD_BATON, buffer all
+ * notifications in a new array allocated in RESULT_POOL, return that
+ * in *RESULT and return the verification result.
+ * Implements svn_ordered_loop__task_t. */
+static svn_error_t *
+run_verify_task(void **result,
+                void *thread_baton,
+                apr_int64_t task,
+                apr_pool_t *result_pool,
+                apr_pool_t *scratch_pool)
+{
+  verify_worker_t *worker = thread_baton;
+  verify_jobs_t *jobs = worker->jobs;
+  svn_boolean_t want_notifications = jobs->notify_func != NULL;
+  apr_array_header_t *notifications
+    = apr_array_make(result_pool, 0, sizeof(svn_repos_notify_t *));
+
+  *result = notifications;
+
+  if (jobs->metadata_phase)
+    {
+      svn_revnum_t first = jobs->chunk_base
+                         + (svn_revnum_t)task * jobs->chunk_size;
+      svn_revnum_t last = first + jobs->chunk_size - 1;
+
+      first = MAX(first, jobs->start_rev);
+      last = MIN(last, jobs->end_rev);
+
+      return svn_error_trace(svn_fs_verify(jobs->fs_path, jobs->fs_config,
+                                           first, last,
+                                           want_notifications
+                                             ? buffer_fs_notification
+                                             : NULL,
+                                           notifications,
+                                           jobs->cancel_func,
+                                           jobs->cancel_baton,
+                                           scratch_pool));
+    }
+
+  return svn_error_trace(verify_one_revision(worker->fs,
+                                             jobs->start_rev
+                                               + (svn_revnum_t)task,
+                                             want_notifications
+                                               ? buffer_notification
+                                               : NULL,
+                                             notifications,
+                                             jobs->start_rev,
+                                             jobs->check_normalization,
+                                             jobs->cancel_func,
+                                             jobs->cancel_baton,
+                                             scratch_pool));
+}
+
+/* Report the buffered notifications in RESULT and the verification result
+ * TASK_ERR of TASK through the callbacks in the verify_jobs_t in BATON.
+ * Notifications about global metadata only set the GLOBAL_NOTIFIED flag.
+ * Implements svn_ordered_loop__result_t. */
+static svn_error_t *
+report_verify_task(void *baton,
+                   apr_int64_t task,
+                   void *result,
+                   svn_error_t *task_err,
+                   apr_pool_t *scratch_pool)
+{
+  verify_jobs_t *jobs = baton;
+  apr_array_header_t *notifications = result;
+  svn_revnum_t rev = jobs->metadata_phase
+                   ? SVN_INVALID_REVNUM
+                   : jobs->start_rev + (svn_revnum_t)task;
+  int i;
+
+  for (i = 0; jobs->notify_func && i < notifications->nelts; ++i)
+    {
+      const svn_repos_notify_t *buffered
+        = APR_ARRAY_IDX(notifications, i, svn_repos_notify_t *);
+
+      if (jobs->metadata_phase && !SVN_IS_VALID_REVNUM(buffered->revision))
+        jobs->global_notified = TRUE;
+      else
+        jobs->notify_func(jobs->notify_baton, buffered, scratch_pool);
+    }
+
+  if (task_err && task_err->apr_err == SVN_ERR_CANCELLED)
+    return svn_error_trace(task_err);
+
+  if (task_err)
+    return svn_error_trace(report_error(rev, task_err, jobs->verify_callback,
+                                        jobs->verify_baton, scratch_pool));
+
+  if (jobs->notify_func && !jobs->metadata_phase)
+    {
+      /* Tell the caller that we're done with this revision. */
+      jobs->notify->revision = rev;
+      jobs->notify_func(jobs->notify_baton, jobs->notify, scratch_pool);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Like verify_fs_sequential() but use up to THREAD_COUNT threads. */
+static svn_error_t *
+verify_fs_parallel(svn_fs_t *fs,
+                   svn_revnum_t start_rev,
+                   svn_revnum_t end_rev,
+                   svn_boolean_t check_normalization,
+                   svn_boolean_t metadata_only,
+                   int thread_count,
+                   svn_repos_notify_func_t notify_func,
+                   void *notify_baton,
+                   svn_repos_verify_callback_t verify_callback,
+                   void *verify_baton,
+                   svn_cancel_func_t cancel_func,
+                   void *cancel_baton,
+                   apr_pool_t *scratch_pool)
+{
+  verify_jobs_t *jobs = apr_pcalloc(scratch_pool, sizeof(*jobs));
+  const svn_fs_info_placeholder_t *info;
+  int window = thread_count * VERIFY_RESULTS_PER_JOB;
+
+  jobs->fs_path = svn_fs_path(fs, scratch_pool);
+  jobs->fs_config = svn_fs_config(fs, scratch_pool);
+  jobs->start_rev = start_rev;
+  jobs->end_rev = end_rev;
+  jobs->check_normalization = check_normalization;
+  jobs->notify_func = notify_func;
+  jobs->notify_baton = notify_baton;
+  jobs->verify_callback = verify_callback;
+  jobs->verify_baton = verify_baton;
+  jobs->cancel_func = cancel_func;
+  jobs->cancel_baton = cancel_baton;
   if (notify_func)
+    jobs->notify = svn_repos_notify_create(svn_repos_notify_verify_rev_end,
+                                           scratch_pool);
+
+  /* Split the backend-specific checks at shard boundaries, such that no
+     two tasks need to read the same pack file.  Backends that we don't
+     know to support partial range checks get a single task. */
+  SVN_ERR(svn_fs_info(&info, fs, scratch_pool, scratch_pool));
+  if (strcmp(info->fs_type, SVN_FS_TYPE_FSFS) == 0)
+    jobs->chunk_size = ((const svn_fs_fsfs_info_t *)info)->shard_size;
+  else if (strcmp(info->fs_type, SVN_FS_TYPE_FSX) == 0)
+    jobs->chunk_size = ((const svn_fs_fsx_info_t *)info)->shard_size;
+  else
+    jobs->chunk_size = end_rev - start_rev + 1;
+
+  if (jobs->chunk_size <= 0)
+    jobs->chunk_size = VERIFY_DEFAULT_CHUNK_SIZE;
+
+  jobs->metadata_phase = TRUE;
+  jobs->chunk_base = start_rev - start_rev % jobs->chunk_size;
+
+  SVN_ERR(svn_ordered_loop__run(0,
+                                (end_rev - jobs->chunk_base)
+                                  / jobs->chunk_size + 1,
+                                thread_count, window,
+                                init_verify_worker, run_verify_task,
+                                report_verify_task, jobs, scratch_pool));
+
+  /* Every task checked global metadata (e.g. the rep-cache) for its own
+     range.  Report that only once. */
+  if (jobs->global_notified)
     {
-      notify = svn_repos_notify_create(svn_repos_notify_verify_end, iterpool);
-      notify_func(notify_baton, notify, iterpool);
+      svn_repos_notify_t *notify
+        = svn_repos_notify_create(svn_repos_notify_verify_rev_structure,
+                                  scratch_pool);
+      notify->revision = SVN_INVALID_REVNUM;
+      notify_func(notify_baton, notify, scratch_pool);
     }
 
-  svn_pool_destroy(iterpool);
+  if (!metadata_only)
+    {
+      jobs->metadata_phase = FALSE;
+
+      SVN_ERR(svn_ordered_loop__run(0, end_rev - start_rev + 1,
+                                    thread_count, window,
+                                    init_verify_worker, run_verify_task,
+                                    report_verify_task, jobs,
+                                    scratch_pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+#endif /* APR_HAS_THREADS */
+
+svn_error_t *
+svn_repos_verify_fs4(svn_repos_t *repos,
+                     svn_revnum_t start_rev,
+                     svn_revnum_t end_rev,
+                     svn_boolean_t check_normalization,
+                     svn_boolean_t metadata_only,
+                     int jobs,
+                     svn_repos_notify_func_t notify_func,
+                     void *notify_baton,
+                     svn_repos_verify_callback_t verify_callback,
+                     void *verify_baton,
+                     svn_cancel_func_t cancel_func,
+                     void *cancel_baton,
+                     apr_pool_t *pool)
+{
+  svn_fs_t *fs = svn_repos_fs(repos);
+  svn_revnum_t youngest;
+
+  /* Make sure we catch up on the latest revprop changes.  This is the only
+   * time we will refresh the revprop data in this query. */
+  SVN_ERR(svn_fs_refresh_revision_props(fs, pool));
+
+  /* Determine the current youngest revision of the filesystem. */
+  SVN_ERR(svn_fs_youngest_rev(&youngest, fs, pool));
+
+  /* Use default vals if necessary. */
+  if (! SVN_IS_VALID_REVNUM(start_rev))
+    start_rev = 0;
+  if (! SVN_IS_VALID_REVNUM(end_rev))
+    end_rev = youngest;
+
+  /* Validate the revisions. */
+  if (start_rev > end_rev)
+    return svn_error_createf(SVN_ERR_REPOS_BAD_ARGS, NULL,
+                             _("Start revision %ld"
+                               " is greater than end revision %ld"),
+                             start_rev, end_rev);
+  if (end_rev > youngest)
+    return svn_error_createf(SVN_ERR_REPOS_BAD_ARGS, NULL,
+                             _("End revision %ld is invalid "
+                               "(youngest revision is %ld)"),
+                             end_rev, youngest);
+
+#if APR_HAS_THREADS
+  if (jobs > 1)
+    SVN_ERR(verify_fs_parallel(fs, start_rev, end_rev,
+                               check_normalization, metadata_only, jobs,
+                               notify_func, notify_baton,
+                               verify_callback, verify_baton,
+                               cancel_func, cancel_baton, pool));
+  else
+#endif
+    SVN_ERR(verify_fs_sequential(fs, start_rev, end_rev,
+                                 check_normalization, metadata_only,
+                                 notify_func, notify_baton,
+                                 verify_callback, verify_baton,
+                                 cancel_func, cancel_baton, pool));
+
+  /* We're done. */
+  if (notify_func)
+    {
+      svn_repos_notify_t *notify
+        = svn_repos_notify_create(svn_repos_notify_verify_end, pool);
+      notify_func(notify_baton, notify, pool);
+    }
 
   return SVN_NO_ERROR;
 }
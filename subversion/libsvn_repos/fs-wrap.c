@@ -110,6 +110,18 @@ svn_repos_fs_commit_txn(const char **conflict_p,
       return err;
     }
 
+  /* Keep the log index current.  The commit itself succeeded, so report
+     failures like other post commit FS processing errors.  The log code
+     ignores an index that lags behind. */
+  err2 = svn_repos__log_index_update(repos, *new_rev, pool);
+  if (err2)
+    err = svn_error_compose_create(
+            err,
+            svn_error_quick_wrap(err2,
+                                 _("Updating the log index failed; run "
+                                   "'svnadmin build-log-index' to catch "
+                                   "up")));
+
   /* Run post-commit hooks. */
   if ((err2 = svn_repos__hooks_post_commit(repos, hooks_env,
                                            *new_rev, txn_name, pool)))
@@ -973,11 +985,13 @@ struct pack_notify_baton
   void *notify_baton;
 };
 
-/* Implements svn_fs_pack_notify_t. */
+/* Implements svn_fs_pack_notify2_t. */
 static svn_error_t *
 pack_notify_func(void *baton,
                  apr_int64_t shard,
                  svn_fs_pack_notify_action_t pack_action,
+                 apr_off_t bytes,
+                 apr_interval_time_t duration,
                  apr_pool_t *pool)
 {
   struct pack_notify_baton *pnb = baton;
@@ -995,13 +1009,16 @@ pack_notify_func(void *baton,
 
   notify = svn_repos_notify_create(repos_action, pool);
   notify->shard = shard;
+  notify->bytes = bytes;
+  notify->duration = duration;
   pnb->notify_func(pnb->notify_baton, notify, pool);
 
   return SVN_NO_ERROR;
 }
 
 svn_error_t *
-svn_repos_fs_pack2(svn_repos_t *repos,
+svn_repos_fs_pack3(svn_repos_t *repos,
+                   int jobs,
                    svn_repos_notify_func_t notify_func,
                    void *notify_baton,
                    svn_cancel_func_t cancel_func,
@@ -1013,10 +1030,10 @@ svn_repos_fs_pack2(svn_repos_t *repos,
   pnb.notify_func = notify_func;
   pnb.notify_baton = notify_baton;
 
-  return svn_fs_pack(repos->db_path,
-                     notify_func ? pack_notify_func : NULL,
-                     notify_func ? &pnb : NULL,
-                     cancel_func, cancel_baton, pool);
+  return svn_fs_pack2(repos->db_path, jobs,
+                      notify_func ? pack_notify_func : NULL,
+                      notify_func ? &pnb : NULL,
+                      cancel_func, cancel_baton, pool);
 }
 
 svn_error_t *
@@ -0,0 +1,60 @@
+/* log-index-db.sql -- schema of the changed-paths log index
+ *   This is intended for use with SQLite 3
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+-- STMT_CREATE_SCHEMA
+/* Every revision that changed PATH or any path below it.  PATH is an
+   fspath.  The root path is not recorded, since every revision
+   changes it. */
+CREATE TABLE changed_path (
+  path TEXT NOT NULL,
+  revision INTEGER NOT NULL,
+  PRIMARY KEY (path, revision)
+  );
+
+/* A single row holding the youngest revision that has been indexed. */
+CREATE TABLE indexed_revision (
+  revision INTEGER NOT NULL
+  );
+
+INSERT INTO indexed_revision (revision) VALUES (-1);
+
+PRAGMA USER_VERSION = 1;
+
+
+-- STMT_GET_INDEXED_REVISION
+SELECT revision
+FROM indexed_revision
+
+-- STMT_SET_INDEXED_REVISION
+UPDATE indexed_revision
+SET revision = ?1
+
+-- STMT_INSERT_CHANGED_PATH
+INSERT OR IGNORE INTO changed_path (path, revision)
+VALUES (?1, ?2)
+
+-- STMT_GET_REVISIONS_FOR_PATH
+SELECT revision
+FROM changed_path
+WHERE path = ?1 AND revision >= ?2 AND revision <= ?3
+ORDER BY revision DESC
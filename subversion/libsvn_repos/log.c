@@ -2252,6 +2252,147 @@ get_paths_history_as_mergeinfo(svn_mergeinfo_t *paths_history_mergeinfo,
   return SVN_NO_ERROR;
 }
 
+/* Like svn_repos_get_logs5() without merged revisions, but use the log
+   index of REPOS to find the revisions that changed PATHS.  START and END
+   are valid, with START <= END, and DESCENDING_ORDER tells us in which
+   order to send the log entries.  Set *HANDLED to FALSE and don't send
+   anything, if there is no index covering END or if one of PATHS does not
+   exist in END, leaving the error reporting to the history walk. */
+static svn_error_t *
+get_logs_from_index(svn_boolean_t *handled,
+                    svn_repos_t *repos,
+                    const apr_array_header_t *paths,
+                    svn_revnum_t start,
+                    svn_revnum_t end,
+                    int limit,
+                    svn_boolean_t strict_node_history,
+                    const apr_array_header_t *revprops,
+                    svn_boolean_t descending_order,
+                    const log_callbacks_t *callbacks,
+                    apr_pool_t *scratch_pool)
+{
+  svn_sqlite__db_t *sdb;
+  svn_revnum_t indexed_rev;
+  svn_fs_root_t *root;
+  apr_array_header_t *revisions;
+  apr_pool_t *iterpool;
+  svn_revnum_t last_sent = SVN_INVALID_REVNUM;
+  int send_count = 0;
+  int i;
+
+  *handled = FALSE;
+
+  SVN_ERR(svn_repos__log_index_open(&sdb, &indexed_rev, repos,
+                                    scratch_pool, scratch_pool));
+  if (!sdb || indexed_rev < end)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_fs_revision_root(&root, repos->fs, end, scratch_pool));
+  revisions = apr_array_make(scratch_pool, 64, sizeof(svn_revnum_t));
+  iterpool = svn_pool_create(scratch_pool);
+
+  for (i = 0; i < paths->nelts; i++)
+    {
+      const char *this_path = APR_ARRAY_IDX(paths, i, const char *);
+      struct location_segment_baton loc_seg_baton;
+      svn_node_kind_t kind;
+      int k;
+
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(svn_fs_check_path(&kind, root, this_path, iterpool));
+      if (kind == svn_node_none)
+        return svn_error_trace(svn_sqlite__close(sdb));
+
+      if (callbacks->authz_read_func)
+        {
+          svn_boolean_t readable;
+          SVN_ERR(callbacks->authz_read_func(&readable, root, this_path,
+                                             callbacks->authz_read_baton,
+                                             iterpool));
+          if (! readable)
+            return svn_error_compose_create(
+                     svn_error_create(SVN_ERR_AUTHZ_UNREADABLE, NULL, NULL),
+                     svn_sqlite__close(sdb));
+        }
+
+      /* Find all locations of the node.  A segment starts where the node
+         appeared at that path, which means that the segment's first
+         revision is part of the node history even if the index does not
+         list the path for it, e.g. because one of its parents got copied.
+         We need the full history to tell those starts from the ones we
+         clipped at START. */
+      loc_seg_baton.pool = iterpool;
+      loc_seg_baton.history_segments =
+        apr_array_make(iterpool, 4, sizeof(svn_location_segment_t *));
+      SVN_ERR(svn_repos_node_location_segments(repos, this_path, end,
+                                               end, 0,
+                                               location_segment_receiver,
+                                               &loc_seg_baton,
+                                               callbacks->authz_read_func,
+                                               callbacks->authz_read_baton,
+                                               iterpool));
+
+      /* Segments come youngest first. */
+      for (k = 0; k < loc_seg_baton.history_segments->nelts; k++)
+        {
+          svn_location_segment_t *segment
+            = APR_ARRAY_IDX(loc_seg_baton.history_segments, k,
+                            svn_location_segment_t *);
+          svn_revnum_t seg_start = MAX(segment->range_start, start);
+          svn_revnum_t seg_end = MIN(segment->range_end, end);
+
+          if (!segment->path)
+            continue;
+
+          if (seg_start <= seg_end)
+            {
+              if (segment->range_start >= start)
+                APR_ARRAY_PUSH(revisions, svn_revnum_t)
+                  = segment->range_start;
+
+              SVN_ERR(svn_repos__log_index_get_revs(
+                        revisions, sdb,
+                        svn_fspath__canonicalize(segment->path, iterpool),
+                        seg_start, seg_end, iterpool));
+            }
+
+          /* Strict node history ends at the first copy. */
+          if (strict_node_history)
+            break;
+        }
+    }
+
+  SVN_ERR(svn_sqlite__close(sdb));
+
+  /* Now, send the revisions in the requested order, without duplicates. */
+  svn_sort__array(revisions, svn_sort_compare_revisions);
+  for (i = 0; i < revisions->nelts; i++)
+    {
+      svn_revnum_t rev = APR_ARRAY_IDX(revisions,
+                                       descending_order
+                                         ? i
+                                         : revisions->nelts - 1 - i,
+                                       svn_revnum_t);
+      if (rev == last_sent)
+        continue;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(send_log(rev, repos->fs, NULL, NULL,
+                       FALSE, FALSE, revprops, FALSE,
+                       callbacks, iterpool));
+      last_sent = rev;
+
+      if (limit > 0 && ++send_count >= limit)
+        break;
+    }
+
+  svn_pool_destroy(iterpool);
+  *handled = TRUE;
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_repos_get_logs5(svn_repos_t *repos,
                     const apr_array_header_t *paths,
@@ -2392,6 +2533,20 @@ svn_repos_get_logs5(svn_repos_t *repos,
       return SVN_NO_ERROR;
     }
 
+  /* Without merged revisions, a log index lets us skip the history
+     walk entirely. */
+  if (! include_merged_revisions)
+    {
+      svn_boolean_t handled;
+
+      SVN_ERR(get_logs_from_index(&handled, repos, paths, start, end, limit,
+                                  strict_node_history, revprops,
+                                  descending_order, &callbacks,
+                                  scratch_pool));
+      if (handled)
+        return SVN_NO_ERROR;
+    }
+
   /* If we are including merged revisions, then create mergeinfo that
      represents all of PATHS' history between START and END.  We will use
      this later to squelch duplicate log revisions that might exist in
@@ -0,0 +1,406 @@
+/* log_index.c : maintaining and querying the changed-paths log index
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include "svn_pools.h"
+#include "svn_error.h"
+#include "svn_dirent_uri.h"
+#include "svn_hash.h"
+#include "svn_fs.h"
+#include "svn_repos.h"
+#include "svn_private_config.h"
+
+#include "private/svn_fspath.h"
+#include "private/svn_sqlite.h"
+
+#include "repos.h"
+#include "log-index-db.h"
+
+/* A few magic values */
+#define LOG_INDEX_SCHEMA_FORMAT   1
+
+/* Number of revisions to add to the index per SQLite transaction. */
+#define LOG_INDEX_BATCH_SIZE      1000
+
+/* Maximum number of revisions that a commit will add to the index.
+   Concurrent commits may update the index out of order, so the commit
+   path has to catch up with a few revisions now and then. */
+#define LOG_INDEX_COMMIT_CATCH_UP 16
+
+LOG_INDEX_DB_SQL_DECLARE_STATEMENTS(statements);
+
+
+
+/** Helper functions. **/
+
+/* Return the path of the log index database of REPOS. */
+static const char *
+path_log_index_db(svn_repos_t *repos,
+                  apr_pool_t *result_pool)
+{
+  return svn_dirent_join(repos->db_path, SVN_REPOS__LOG_INDEX_DB,
+                         result_pool);
+}
+
+/* Open the log index database of REPOS in MODE and return it in *SDB.
+   If MODE is svn_sqlite__mode_rwcreate, create the database and its
+   schema as needed.  Allocate *SDB in RESULT_POOL and use SCRATCH_POOL
+   for temporary allocations. */
+static svn_error_t *
+open_log_index(svn_sqlite__db_t **sdb,
+               svn_repos_t *repos,
+               svn_sqlite__mode_t mode,
+               apr_pool_t *result_pool,
+               apr_pool_t *scratch_pool)
+{
+  const char *db_path = path_log_index_db(repos, scratch_pool);
+  int version;
+
+  SVN_ERR(svn_sqlite__open(sdb, db_path, mode, statements,
+                           0, NULL, 0,
+                           result_pool, scratch_pool));
+
+  SVN_SQLITE__ERR_CLOSE(svn_sqlite__read_schema_version(&version, *sdb,
+                                                        scratch_pool),
+                        *sdb);
+  if (version < LOG_INDEX_SCHEMA_FORMAT)
+    {
+      if (mode != svn_sqlite__mode_rwcreate)
+        return svn_error_compose_create(
+                 svn_error_createf(SVN_ERR_SQLITE_ERROR, NULL,
+                                   _("Log index '%s' has not been "
+                                     "initialized"),
+                                   svn_dirent_local_style(db_path,
+                                                          scratch_pool)),
+                 svn_sqlite__close(*sdb));
+
+      /* Must be 0 -- an uninitialized (no schema) database.  Create
+         the schema.  Results in schema version of 1.  */
+      SVN_SQLITE__ERR_CLOSE(svn_sqlite__exec_statements(*sdb,
+                                                        STMT_CREATE_SCHEMA),
+                            *sdb);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *REVISION to the youngest revision covered by the index in SDB. */
+static svn_error_t *
+get_indexed_revision(svn_revnum_t *revision,
+                     svn_sqlite__db_t *sdb)
+{
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_GET_INDEXED_REVISION));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+  *revision = have_row ? svn_sqlite__column_revnum(stmt, 0)
+                       : SVN_INVALID_REVNUM;
+
+  return svn_error_trace(svn_sqlite__reset(stmt));
+}
+
+/* Add all paths changed in REVISION of FS to the index in SDB, together
+   with all their parent directories except for the root.  Use
+   SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+index_revision(svn_sqlite__db_t *sdb,
+               svn_fs_t *fs,
+               svn_revnum_t revision,
+               apr_pool_t *scratch_pool)
+{
+  svn_fs_root_t *root;
+  svn_fs_path_change_iterator_t *iterator;
+  svn_fs_path_change3_t *change;
+  apr_hash_t *indexed = apr_hash_make(scratch_pool);
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, revision, scratch_pool));
+  SVN_ERR(svn_fs_paths_changed3(&iterator, root, scratch_pool,
+                                scratch_pool));
+  SVN_ERR(svn_fs_path_change_get(&change, iterator));
+
+  while (change)
+    {
+      const char *path = apr_pstrmemdup(scratch_pool, change->path.data,
+                                        change->path.len);
+
+      /* Once we reach a path that we already indexed, all its parents
+         have been indexed as well. */
+      while (!svn_fspath__is_root(path, strlen(path))
+             && !svn_hash_gets(indexed, path))
+        {
+          svn_sqlite__stmt_t *stmt;
+
+          SVN_ERR(svn_sqlite__get_statement(&stmt, sdb,
+                                            STMT_INSERT_CHANGED_PATH));
+          SVN_ERR(svn_sqlite__bindf(stmt, "sr", path, revision));
+          SVN_ERR(svn_sqlite__insert(NULL, stmt));
+
+          svn_hash_sets(indexed, path, path);
+          path = svn_fspath__dirname(path, scratch_pool);
+        }
+
+      SVN_ERR(svn_fs_path_change_get(&change, iterator));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Add the revisions following the youngest indexed one in SDB up to and
+   including END, but no more than LOG_INDEX_BATCH_SIZE of them, to the
+   index.  Set *INDEXED_REV to the youngest revision covered by the index
+   afterwards.  Notify NOTIFY_FUNC / NOTIFY_BATON of every revision added.
+   Use SCRATCH_POOL for temporary allocations.
+
+   This is meant to run inside a SQLite transaction such that concurrent
+   updaters will not index the same revisions twice. */
+static svn_error_t *
+index_revisions(svn_revnum_t *indexed_rev,
+                svn_sqlite__db_t *sdb,
+                svn_fs_t *fs,
+                svn_revnum_t end,
+                svn_repos_notify_func_t notify_func,
+                void *notify_baton,
+                svn_cancel_func_t cancel_func,
+                void *cancel_baton,
+                apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  svn_sqlite__stmt_t *stmt;
+  svn_revnum_t revision;
+  svn_revnum_t last;
+
+  SVN_ERR(get_indexed_revision(&revision, sdb));
+  last = revision + LOG_INDEX_BATCH_SIZE;
+  if (last > end)
+    last = end;
+
+  for (++revision; revision <= last; ++revision)
+    {
+      svn_pool_clear(iterpool);
+
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+
+      SVN_ERR(index_revision(sdb, fs, revision, iterpool));
+
+      if (notify_func)
+        {
+          svn_repos_notify_t *notify
+            = svn_repos_notify_create(svn_repos_notify_log_index_rev_end,
+                                      iterpool);
+          notify->revision = revision;
+          notify_func(notify_baton, notify, iterpool);
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_SET_INDEXED_REVISION));
+  SVN_ERR(svn_sqlite__bind_revnum(stmt, 1, revision - 1));
+  SVN_ERR(svn_sqlite__update(NULL, stmt));
+
+  *indexed_rev = revision - 1;
+  return SVN_NO_ERROR;
+}
+
+/* Add all revisions of REPOS that are not yet covered by the index in SDB
+   to it.  The other parameters are the same as for index_revisions. */
+static svn_error_t *
+update_log_index(svn_sqlite__db_t *sdb,
+                 svn_repos_t *repos,
+                 svn_repos_notify_func_t notify_func,
+                 void *notify_baton,
+                 svn_cancel_func_t cancel_func,
+                 void *cancel_baton,
+                 apr_pool_t *scratch_pool)
+{
+  svn_revnum_t youngest;
+  svn_revnum_t indexed_rev;
+
+  SVN_ERR(svn_fs_youngest_rev(&youngest, repos->fs, scratch_pool));
+  SVN_ERR(get_indexed_revision(&indexed_rev, sdb));
+
+  /* An index ahead of the repository belongs to some other history. */
+  if (indexed_rev > youngest)
+    return svn_error_createf(SVN_ERR_REPOS_BAD_ARGS, NULL,
+                             _("Log index '%s' covers r%ld but the "
+                               "repository ends at r%ld; remove the index "
+                               "and build it again"),
+                             svn_dirent_local_style(
+                               path_log_index_db(repos, scratch_pool),
+                               scratch_pool),
+                             indexed_rev, youngest);
+
+  while (indexed_rev < youngest)
+    SVN_SQLITE__WITH_IMMEDIATE_TXN(index_revisions(&indexed_rev, sdb,
+                                                   repos->fs, youngest,
+                                                   notify_func, notify_baton,
+                                                   cancel_func, cancel_baton,
+                                                   scratch_pool),
+                                   sdb);
+
+  return SVN_NO_ERROR;
+}
+
+/* Add all revisions of FS up to and including REVISION that the index
+   in SDB does not cover yet.  Commits may call this out of order because
+   the FS write lock has been released by then.  So, the revisions
+   preceding REVISION may still be missing and get indexed here as well.
+   If there are more than LOG_INDEX_COMMIT_CATCH_UP revisions to add,
+   leave the index alone such that the commit path never does more than
+   a bounded amount of work; svn_repos_build_log_index() catches up with
+   the rest.  Use SCRATCH_POOL for temporary allocations.
+
+   This is meant to run inside a SQLite transaction. */
+static svn_error_t *
+index_next_revision(svn_sqlite__db_t *sdb,
+                    svn_fs_t *fs,
+                    svn_revnum_t revision,
+                    apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool;
+  svn_sqlite__stmt_t *stmt;
+  svn_revnum_t indexed_rev;
+  svn_revnum_t rev;
+
+  SVN_ERR(get_indexed_revision(&indexed_rev, sdb));
+  if (indexed_rev >= revision
+      || revision - indexed_rev > LOG_INDEX_COMMIT_CATCH_UP)
+    return SVN_NO_ERROR;
+
+  iterpool = svn_pool_create(scratch_pool);
+  for (rev = indexed_rev + 1; rev <= revision; ++rev)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(index_revision(sdb, fs, rev, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_SET_INDEXED_REVISION));
+  SVN_ERR(svn_sqlite__bind_revnum(stmt, 1, revision));
+  return svn_error_trace(svn_sqlite__update(NULL, stmt));
+}
+
+
+
+/** Library-private API's. **/
+
+svn_error_t *
+svn_repos__log_index_update(svn_repos_t *repos,
+                            svn_revnum_t revision,
+                            apr_pool_t *scratch_pool)
+{
+  svn_sqlite__db_t *sdb;
+  svn_node_kind_t kind;
+
+  /* The index is optional.  Don't create it implicitly. */
+  SVN_ERR(svn_io_check_path(path_log_index_db(repos, scratch_pool), &kind,
+                            scratch_pool));
+  if (kind == svn_node_none)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(open_log_index(&sdb, repos, svn_sqlite__mode_readwrite,
+                         scratch_pool, scratch_pool));
+  SVN_SQLITE__ERR_CLOSE(svn_sqlite__begin_immediate_transaction(sdb), sdb);
+  SVN_SQLITE__ERR_CLOSE(svn_sqlite__finish_transaction(
+                          sdb,
+                          index_next_revision(sdb, repos->fs, revision,
+                                              scratch_pool)),
+                        sdb);
+
+  return svn_error_trace(svn_sqlite__close(sdb));
+}
+
+svn_error_t *
+svn_repos__log_index_open(svn_sqlite__db_t **sdb,
+                          svn_revnum_t *indexed_rev,
+                          svn_repos_t *repos,
+                          apr_pool_t *result_pool,
+                          apr_pool_t *scratch_pool)
+{
+  svn_node_kind_t kind;
+
+  *sdb = NULL;
+  *indexed_rev = SVN_INVALID_REVNUM;
+
+  SVN_ERR(svn_io_check_path(path_log_index_db(repos, scratch_pool), &kind,
+                            scratch_pool));
+  if (kind == svn_node_none)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(open_log_index(sdb, repos, svn_sqlite__mode_readonly,
+                         result_pool, scratch_pool));
+  SVN_SQLITE__ERR_CLOSE(get_indexed_revision(indexed_rev, *sdb), *sdb);
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_repos__log_index_get_revs(apr_array_header_t *revisions,
+                              svn_sqlite__db_t *sdb,
+                              const char *path,
+                              svn_revnum_t start,
+                              svn_revnum_t end,
+                              apr_pool_t *scratch_pool)
+{
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb,
+                                    STMT_GET_REVISIONS_FOR_PATH));
+  SVN_ERR(svn_sqlite__bindf(stmt, "srr", path, start, end));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+  while (have_row)
+    {
+      APR_ARRAY_PUSH(revisions, svn_revnum_t)
+        = svn_sqlite__column_revnum(stmt, 0);
+      SVN_ERR(svn_sqlite__step(&have_row, stmt));
+    }
+
+  return svn_error_trace(svn_sqlite__reset(stmt));
+}
+
+
+
+/** Public API's. **/
+
+svn_error_t *
+svn_repos_build_log_index(svn_repos_t *repos,
+                          svn_repos_notify_func_t notify_func,
+                          void *notify_baton,
+                          svn_cancel_func_t cancel_func,
+                          void *cancel_baton,
+                          apr_pool_t *scratch_pool)
+{
+  svn_sqlite__db_t *sdb;
+
+  SVN_ERR(open_log_index(&sdb, repos, svn_sqlite__mode_rwcreate,
+                         scratch_pool, scratch_pool));
+  SVN_SQLITE__ERR_CLOSE(update_log_index(sdb, repos,
+                                         notify_func, notify_baton,
+                                         cancel_func, cancel_baton,
+                                         scratch_pool),
+                        sdb);
+
+  return svn_error_trace(svn_sqlite__close(sdb));
+}
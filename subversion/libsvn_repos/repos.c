@@ -997,16 +997,20 @@ svn_repos_hooks_setenv(svn_repos_t *repos,
                        const char *hooks_env_path,
                        apr_pool_t *scratch_pool)
 {
+  const char *path;
+
   if (hooks_env_path == NULL)
-    repos->hooks_env_path = svn_dirent_join(repos->conf_path,
-                                            SVN_REPOS__CONF_HOOKS_ENV,
-                                            repos->pool);
+    path = svn_dirent_join(repos->conf_path, SVN_REPOS__CONF_HOOKS_ENV,
+                           scratch_pool);
   else if (!svn_dirent_is_absolute(hooks_env_path))
-    repos->hooks_env_path = svn_dirent_join(repos->conf_path,
-                                            hooks_env_path,
-                                            repos->pool);
+    path = svn_dirent_join(repos->conf_path, hooks_env_path, scratch_pool);
   else
-    repos->hooks_env_path = apr_pstrdup(repos->pool, hooks_env_path);
+    path = hooks_env_path;
+
+  /* Pooled repository instances get this called for every session.
+     Don't let REPOS->POOL grow if nothing changes. */
+  if (!repos->hooks_env_path || strcmp(repos->hooks_env_path, path))
+    repos->hooks_env_path = apr_pstrdup(repos->pool, path);
 
   return SVN_NO_ERROR;
 }
@@ -29,6 +29,8 @@
 #include "svn_fs.h"
 #include "svn_config.h"
 
+#include "private/svn_sqlite.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
@@ -66,6 +68,9 @@ extern "C" {
 #define SVN_REPOS__HOOK_DIR    "hooks"      /* Hook programs. */
 #define SVN_REPOS__CONF_DIR    "conf"       /* Configuration files. */
 
+/* The optional changed-paths log index lives in the db dir. */
+#define SVN_REPOS__LOG_INDEX_DB "log-index.db"
+
 /* Things for which we keep lockfiles. */
 #define SVN_REPOS__DB_LOCKFILE "db.lock" /* Our Berkeley lockfile. */
 #define SVN_REPOS__DB_LOGS_LOCKFILE "db-logs.lock" /* BDB logs lockfile. */
@@ -387,6 +392,44 @@ svn_repos__prev_location(svn_revnum_t *appeared_rev,
                          const char *path,
                          apr_pool_t *pool);
 
+
+/*** Changed-paths log index ***/
+
+/* If REPOS has a log index, add REVISION to it together with any
+   preceding revisions that it does not cover yet, e.g. because concurrent
+   commits finished out of order.  If that would be more than a few
+   revisions, do nothing; a lagging index gets ignored by the log code
+   until svn_repos_build_log_index() catches up.  Use SCRATCH_POOL for
+   temporary allocations. */
+svn_error_t *
+svn_repos__log_index_update(svn_repos_t *repos,
+                            svn_revnum_t revision,
+                            apr_pool_t *scratch_pool);
+
+/* Open the log index of REPOS for reading and return it in *SDB, or set
+   *SDB to NULL if REPOS has no log index.  Set *INDEXED_REV to the
+   youngest revision covered by the index.  Allocate *SDB in RESULT_POOL
+   and use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_repos__log_index_open(svn_sqlite__db_t **sdb,
+                          svn_revnum_t *indexed_rev,
+                          svn_repos_t *repos,
+                          apr_pool_t *result_pool,
+                          apr_pool_t *scratch_pool);
+
+/* Append to REVISIONS, an array of svn_revnum_t, all revisions between
+   START and END (inclusive, START <= END) that changed the fspath PATH
+   or anything below it, according to the log index SDB.  The revisions
+   get appended youngest first.  Use SCRATCH_POOL for temporary
+   allocations. */
+svn_error_t *
+svn_repos__log_index_get_revs(apr_array_header_t *revisions,
+                              svn_sqlite__db_t *sdb,
+                              const char *path,
+                              svn_revnum_t start,
+                              svn_revnum_t end,
+                              apr_pool_t *scratch_pool);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -0,0 +1,211 @@
+/*
+ * repos_pool.c :  pool of opened repository objects
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include <apr_file_info.h>
+
+#include "svn_dirent_uri.h"
+#include "svn_fs.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+#include "svn_repos.h"
+
+#include "private/svn_subr_private.h"
+#include "private/svn_repos_private.h"
+
+#include "repos.h"
+
+
+/* Identity of a file that gets replaced whenever the repository format
+ * or the filesystem identity changes.
+ */
+typedef struct file_stamp_t
+{
+  apr_ino_t inode;
+  apr_time_t mtime;
+  apr_off_t size;
+} file_stamp_t;
+
+/* Files whose stamps make up the key.  A repository instance becomes stale
+ * as soon as any of them changes.  Not all FS backends use all of them.
+ */
+static const char *const stamp_files[] =
+{
+  SVN_REPOS__FORMAT,
+  SVN_REPOS__DB_DIR "/format",
+  SVN_REPOS__DB_DIR "/uuid"
+};
+
+#define STAMP_COUNT (sizeof(stamp_files) / sizeof(stamp_files[0]))
+
+/* Set *STAMP to the identity of the file at PATH.  Missing files will
+ * result in an all-zero stamp.  Use SCRATCH_POOL for temporaries.
+ */
+static svn_error_t *
+get_file_stamp(file_stamp_t *stamp,
+               const char *path,
+               apr_pool_t *scratch_pool)
+{
+  apr_finfo_t finfo;
+  svn_error_t *err = svn_io_stat(&finfo, path,
+                                 APR_FINFO_INODE | APR_FINFO_MTIME
+                                 | APR_FINFO_SIZE,
+                                 scratch_pool);
+
+  memset(stamp, 0, sizeof(*stamp));
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+
+  SVN_ERR(err);
+  stamp->inode = finfo.inode;
+  stamp->mtime = finfo.mtime;
+  stamp->size = finfo.size;
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *KEY to a memory buffer allocated in RESULT_POOL and containing the
+ * stamps of the format and UUID files of the repository at PATH followed
+ * by the path itself.  Use SCRATCH_POOL for temporaries.
+ */
+static svn_error_t *
+repos_as_key(svn_membuf_t **key,
+             const char *path,
+             apr_pool_t *result_pool,
+             apr_pool_t *scratch_pool)
+{
+  svn_membuf_t *result = apr_pcalloc(result_pool, sizeof(*result));
+  apr_size_t path_len = strlen(path);
+  apr_size_t size = STAMP_COUNT * sizeof(file_stamp_t) + path_len;
+  file_stamp_t *stamps;
+  apr_size_t i;
+
+  svn_membuf__create(result, size, result_pool);
+  result->size = size; /* exact length is required! */
+
+  /* Zero-initialize any padding within the stamps. */
+  stamps = result->data;
+  memset(stamps, 0, STAMP_COUNT * sizeof(*stamps));
+  for (i = 0; i < STAMP_COUNT; ++i)
+    SVN_ERR(get_file_stamp(&stamps[i],
+                           svn_dirent_join(path, stamp_files[i],
+                                           scratch_pool),
+                           scratch_pool));
+
+  memcpy(stamps + STAMP_COUNT, path, path_len);
+
+  *key = result;
+  return SVN_NO_ERROR;
+}
+
+/* Warning function installed on repository instances that are not
+ * checked out.  Like the FS layer's default, don't fail silently.
+ */
+static void
+unowned_warning_func(void *baton,
+                     svn_error_t *err)
+{
+  if (svn_error_get_malfunction_handler()
+      == svn_error_abort_on_malfunction)
+    svn_handle_error2(err, stderr, FALSE /* fatal */, "svn: repos-pool: ");
+  SVN_ERR_MALFUNCTION_NO_RETURN();
+}
+
+/* Pool cleanup function called when the svn_repos_t given by BATON gets
+ * released.  Clear all per-session state, which has been allocated in the
+ * releasing session's pools, before the instance becomes available to the
+ * next user.
+ */
+static apr_status_t
+reset_session_state(void *baton)
+{
+  svn_repos_t *repos = baton;
+
+  repos->client_capabilities = NULL;
+  svn_fs_set_warning_func(repos->fs, unowned_warning_func, NULL);
+  svn_error_clear(svn_fs_set_access(repos->fs, NULL));
+
+  return APR_SUCCESS;
+}
+
+/* API implementation */
+
+svn_error_t *
+svn_repos__repos_pool_create(svn_repos__repos_pool_t **repos_pool,
+                             svn_boolean_t thread_safe,
+                             apr_pool_t *pool)
+{
+  return svn_error_trace(svn_object_pool__create(repos_pool, FALSE,
+                                                 thread_safe, pool));
+}
+
+svn_error_t *
+svn_repos__repos_pool_get(svn_repos_t **repos_p,
+                          svn_repos__repos_pool_t *repos_pool,
+                          const char *path,
+                          apr_hash_t *fs_config,
+                          apr_pool_t *result_pool,
+                          apr_pool_t *scratch_pool)
+{
+  svn_membuf_t *key;
+  svn_repos_t *repos;
+
+  /* First, attempt the cache lookup. */
+  SVN_ERR(repos_as_key(&key, path, scratch_pool, scratch_pool));
+  SVN_ERR(svn_object_pool__lookup((void **)&repos, repos_pool, key,
+                                  result_pool));
+
+  if (!repos)
+    {
+      /* Not found? => open a new instance in its own pool */
+      apr_pool_t *item_pool = svn_object_pool__new_item_pool(repos_pool);
+      svn_repos_t *new_repos;
+      svn_error_t *err = svn_repos_open3(&new_repos, path, fs_config,
+                                         item_pool, scratch_pool);
+      if (err)
+        {
+          svn_pool_destroy(item_pool);
+          return svn_error_trace(err);
+        }
+
+      SVN_ERR(svn_object_pool__insert((void **)&repos, repos_pool, key,
+                                      new_repos, item_pool,
+                                      result_pool));
+    }
+
+  /* Registered after the object pool's own cleanup, this runs before the
+   * instance goes back into REPOS_POOL. */
+  apr_pool_cleanup_register(result_pool, repos, reset_session_state,
+                            apr_pool_cleanup_null);
+
+  *repos_p = repos;
+  return SVN_NO_ERROR;
+}
@@ -25,6 +25,7 @@
 #include <string.h>
 #include "svn_compat.h"
 #include "svn_private_config.h"
+#include "svn_diff.h"
 #include "svn_hash.h"
 #include "svn_pools.h"
 #include "svn_error.h"
@@ -37,8 +38,10 @@
 #include "svn_props.h"
 #include "svn_mergeinfo.h"
 #include "repos.h"
+#include "private/svn_diff_private.h"
 #include "private/svn_fspath.h"
 #include "private/svn_fs_private.h"
+#include "private/svn_repos_private.h"
 #include "private/svn_sorts_private.h"
 
 
@@ -1745,3 +1748,197 @@ svn_repos_get_file_revs2(svn_repos_t *repos,
 
   return SVN_NO_ERROR;
 }
+
+
+/* Set *TEXT to the contents of the file at PATH in ROOT, allocated in
+   POOL.  This reads through the fulltext cache of the filesystem.
+
+   Refuse to load binary files, which can't be blamed anyway, and files
+   larger than MAX_FILE_SIZE bytes unless that is 0.  Clients may then
+   fall back to svn_repos_get_file_revs2(), which streams the data. */
+static svn_error_t *
+read_fulltext(svn_string_t **text,
+              svn_fs_root_t *root,
+              const char *path,
+              svn_filesize_t max_file_size,
+              apr_pool_t *pool)
+{
+  svn_filesize_t length;
+  svn_stream_t *stream;
+  svn_string_t *mime_type;
+
+  SVN_ERR(svn_fs_node_prop(&mime_type, root, path, SVN_PROP_MIME_TYPE,
+                           pool));
+  if (mime_type && svn_mime_type_is_binary(mime_type->data))
+    return svn_error_createf(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                             _("Server-side blame does not support binary "
+                               "file '%s' in r%ld"),
+                             path, svn_fs_revision_root_revision(root));
+
+  SVN_ERR(svn_fs_file_length(&length, root, path, pool));
+  if (max_file_size && length > max_file_size)
+    return svn_error_createf(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                             _("File '%s' in r%ld is too large for "
+                               "server-side blame"),
+                             path, svn_fs_revision_root_revision(root));
+
+  SVN_ERR(svn_fs_file_contents(&stream, root, path, pool));
+
+  return svn_error_trace(svn_string_from_stream2(text, stream,
+                                                 (apr_size_t)length, pool));
+}
+
+svn_error_t *
+svn_repos__blame(apr_array_header_t **chunks,
+                 svn_repos_t *repos,
+                 const char *path,
+                 svn_revnum_t start,
+                 svn_revnum_t end,
+                 const svn_diff_file_options_t *diff_options,
+                 svn_filesize_t max_file_size,
+                 svn_repos_authz_func_t authz_read_func,
+                 void *authz_read_baton,
+                 svn_cancel_func_t cancel_func,
+                 void *cancel_baton,
+                 apr_pool_t *result_pool,
+                 apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *path_revisions;
+  svn_diff__blame_chain_t *chain;
+  svn_diff__blame_t *walk;
+  svn_fs_root_t *last_root = NULL;
+  const char *last_path = NULL;
+  svn_string_t *last_text = NULL;
+  apr_pool_t *iterpool, *last_pool;
+  int i;
+
+  if (!SVN_IS_VALID_REVNUM(start)
+      || !SVN_IS_VALID_REVNUM(end))
+    {
+      svn_revnum_t youngest_rev;
+      SVN_ERR(svn_fs_youngest_rev(&youngest_rev, repos->fs, scratch_pool));
+
+      if (!SVN_IS_VALID_REVNUM(start))
+        start = youngest_rev;
+      if (!SVN_IS_VALID_REVNUM(end))
+        end = youngest_rev;
+    }
+
+  if (end < start)
+    return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                            _("Server-side blame requires the start "
+                              "revision not to be younger than the end "
+                              "revision"));
+
+  if (!diff_options)
+    diff_options = svn_diff_file_options_create(scratch_pool);
+
+  /* We switch between two pools while looping, since we need the
+     previous fulltext while diffing against the current one. */
+  iterpool = svn_pool_create(scratch_pool);
+  last_pool = svn_pool_create(scratch_pool);
+
+  /* Get the revisions we are interested in, including the one before
+     START, which provides the lines that we don't blame. */
+  path_revisions = apr_array_make(scratch_pool, 100,
+                                  sizeof(struct path_revision *));
+  SVN_ERR(find_interesting_revisions(path_revisions, repos, path,
+                                     start > 0 ? start - 1 : 0, end,
+                                     FALSE, FALSE,
+                                     apr_hash_make(scratch_pool),
+                                     authz_read_func, authz_read_baton,
+                                     scratch_pool, iterpool));
+
+  /* We must have at least one revision to annotate. */
+  SVN_ERR_ASSERT(path_revisions->nelts > 0);
+
+  chain = svn_diff__blame_chain_create(scratch_pool);
+
+  /* Walk the revisions from oldest to youngest. */
+  for (i = path_revisions->nelts - 1; i >= 0; --i)
+    {
+      struct path_revision *path_rev = APR_ARRAY_IDX(path_revisions, i,
+                                                     struct path_revision *);
+      /* Lines from before START don't get blamed. */
+      const struct path_revision *blamed = path_rev->revnum >= start
+                                         ? path_rev
+                                         : NULL;
+      svn_fs_root_t *root;
+      svn_string_t *text;
+      apr_pool_t *tmp_pool;
+
+      svn_pool_clear(iterpool);
+
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+
+      SVN_ERR(svn_fs_revision_root(&root, repos->fs, path_rev->revnum,
+                                   iterpool));
+
+      /* Property-only changes don't affect the blame.  Skip them without
+         reading the contents. */
+      if (last_root)
+        {
+          svn_boolean_t changed;
+
+          SVN_ERR(svn_fs_contents_different(&changed, last_root, last_path,
+                                            root, path_rev->path, iterpool));
+          if (!changed)
+            continue;
+        }
+
+      SVN_ERR(read_fulltext(&text, root, path_rev->path, max_file_size,
+                            iterpool));
+
+      if (!last_text)
+        {
+          chain->blame = svn_diff__blame_create(chain, blamed, 0);
+        }
+      else
+        {
+          svn_diff_t *diff;
+
+          SVN_ERR(svn_diff_mem_string_diff(&diff, last_text, text,
+                                           diff_options, iterpool));
+          SVN_ERR(svn_diff__blame_apply_diff(chain, diff, blamed,
+                                             cancel_func, cancel_baton));
+        }
+
+      last_root = root;
+      last_path = path_rev->path;
+      last_text = text;
+
+      /* Swap pools. */
+      tmp_pool = iterpool;
+      iterpool = last_pool;
+      last_pool = tmp_pool;
+    }
+
+  /* Return the chain without empty chunks, merging neighbours that
+     belong to the same revision. */
+  *chunks = apr_array_make(result_pool, 16, sizeof(svn_repos__blame_chunk_t));
+  for (walk = chain->blame; walk; walk = walk->next)
+    {
+      const struct path_revision *blamed = walk->rev;
+      svn_revnum_t revision = blamed ? blamed->revnum : SVN_INVALID_REVNUM;
+      svn_repos__blame_chunk_t *chunk;
+
+      if (walk->next && walk->next->start == walk->start)
+        continue;
+
+      if ((*chunks)->nelts
+          && APR_ARRAY_IDX(*chunks, (*chunks)->nelts - 1,
+                           svn_repos__blame_chunk_t).revision
+             == revision)
+        continue;
+
+      chunk = apr_array_push(*chunks);
+      chunk->start = walk->start;
+      chunk->revision = revision;
+    }
+
+  svn_pool_destroy(last_pool);
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
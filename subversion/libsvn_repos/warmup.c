@@ -0,0 +1,316 @@
+/* warmup.c : pre-loading the repository caches
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <string.h>
+
+#include "svn_pools.h"
+#include "svn_error.h"
+#include "svn_hash.h"
+#include "svn_fs.h"
+#include "svn_repos.h"
+#include "svn_io.h"
+#include "svn_sorts.h"
+#include "private/svn_fspath.h"
+#include "private/svn_repos_private.h"
+
+#include "repos.h"
+
+/* Number of youngest revisions to pre-load if the FS backend does not
+   tell us about its shard size. */
+#define WARMUP_DEFAULT_REVISIONS 1000
+
+/* Rough estimate of the cache space needed per directory entry or changed
+   path on top of its name. */
+#define WARMUP_ENTRY_OVERHEAD    64
+
+/* Progress of a warm-up run. */
+typedef struct warmup_baton_t
+{
+  svn_fs_t *fs;
+
+  /* Remaining number of bytes that we may pre-load. */
+  apr_uint64_t budget;
+
+  /* Pre-load fulltexts as well. */
+  svn_boolean_t include_fulltexts;
+
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+
+  /* Statistics. */
+  apr_uint64_t nodes;
+  apr_uint64_t bytes;
+} warmup_baton_t;
+
+/* Account for SIZE bytes pre-loaded through B.  Return FALSE if that
+   exhausted the budget. */
+static svn_boolean_t
+consume(warmup_baton_t *b,
+        apr_uint64_t size)
+{
+  b->bytes += size;
+  if (size >= b->budget)
+    {
+      b->budget = 0;
+      return FALSE;
+    }
+
+  b->budget -= size;
+  return TRUE;
+}
+
+/* Return a rough estimate of the cache space needed for PROPS. */
+static apr_uint64_t
+get_props_size(apr_hash_t *props)
+{
+  apr_uint64_t size = 0;
+  apr_hash_index_t *hi;
+
+  for (hi = apr_hash_first(NULL, props); hi; hi = apr_hash_next(hi))
+    {
+      const svn_string_t *value = apr_hash_this_val(hi);
+      size += apr_hash_this_key_len(hi) + value->len + WARMUP_ENTRY_OVERHEAD;
+    }
+
+  return size;
+}
+
+/* Return the oldest revision to pre-load the changes of in B->FS, whose
+   youngest revision is YOUNGEST.  That is the first revision of the most
+   recently packed shard or, if nothing has been packed yet, one shard
+   below YOUNGEST.  Never go back more than two shards, even if packing
+   lags behind.  If the backend does not tell us about its sharding, use
+   WARMUP_DEFAULT_REVISIONS below YOUNGEST. */
+static svn_error_t *
+get_oldest_recent_rev(svn_revnum_t *oldest,
+                      warmup_baton_t *b,
+                      svn_revnum_t youngest,
+                      apr_pool_t *scratch_pool)
+{
+  const svn_fs_info_placeholder_t *info;
+  svn_revnum_t min_unpacked_rev = SVN_INVALID_REVNUM;
+  int shard_size = 0;
+
+  SVN_ERR(svn_fs_info(&info, b->fs, scratch_pool, scratch_pool));
+  if (strcmp(info->fs_type, SVN_FS_TYPE_FSFS) == 0)
+    {
+      const svn_fs_fsfs_info_t *fsfs_info = (const void *)info;
+      shard_size = fsfs_info->shard_size;
+      min_unpacked_rev = fsfs_info->min_unpacked_rev;
+    }
+  else if (strcmp(info->fs_type, SVN_FS_TYPE_FSX) == 0)
+    {
+      const svn_fs_fsx_info_t *fsx_info = (const void *)info;
+      shard_size = fsx_info->shard_size;
+      min_unpacked_rev = fsx_info->min_unpacked_rev;
+    }
+
+  if (shard_size > 0)
+    {
+      /* In an unpacked repository, MIN_UNPACKED_REV is 0 and would make
+         us walk the whole history. */
+      if (SVN_IS_VALID_REVNUM(min_unpacked_rev) && min_unpacked_rev > 0)
+        *oldest = min_unpacked_rev - shard_size;
+      else
+        *oldest = youngest - shard_size;
+
+      *oldest = MAX(*oldest, youngest - 2 * (svn_revnum_t)shard_size);
+    }
+  else
+    {
+      *oldest = youngest - WARMUP_DEFAULT_REVISIONS;
+    }
+
+  if (*oldest < 0)
+    *oldest = 0;
+
+  return SVN_NO_ERROR;
+}
+
+/* Pre-load the revprops and changed paths lists of the recent revisions
+   up to YOUNGEST.  Newer revisions come first.  Return early if the
+   budget in B runs out. */
+static svn_error_t *
+warm_recent_revisions(warmup_baton_t *b,
+                      svn_revnum_t youngest,
+                      apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  svn_revnum_t oldest;
+  svn_revnum_t revision;
+
+  SVN_ERR(get_oldest_recent_rev(&oldest, b, youngest, scratch_pool));
+
+  for (revision = youngest; revision >= oldest && b->budget; --revision)
+    {
+      svn_fs_root_t *root;
+      svn_fs_path_change_iterator_t *iterator;
+      svn_fs_path_change3_t *change;
+      apr_hash_t *props;
+
+      svn_pool_clear(iterpool);
+
+      if (b->cancel_func)
+        SVN_ERR(b->cancel_func(b->cancel_baton));
+
+      SVN_ERR(svn_fs_revision_proplist2(&props, b->fs, revision, FALSE,
+                                        iterpool, iterpool));
+      if (!consume(b, get_props_size(props)))
+        break;
+
+      SVN_ERR(svn_fs_revision_root(&root, b->fs, revision, iterpool));
+      SVN_ERR(svn_fs_paths_changed3(&iterator, root, iterpool, iterpool));
+      SVN_ERR(svn_fs_path_change_get(&change, iterator));
+      while (change)
+        {
+          if (!consume(b, change->path.len + WARMUP_ENTRY_OVERHEAD))
+            break;
+
+          SVN_ERR(svn_fs_path_change_get(&change, iterator));
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+/* Pre-load the file at PATH in ROOT.  Skip its contents unless B asks
+   for fulltexts and they fit into the remaining budget. */
+static svn_error_t *
+warm_file(warmup_baton_t *b,
+          svn_fs_root_t *root,
+          const char *path,
+          apr_pool_t *scratch_pool)
+{
+  svn_filesize_t length;
+  svn_stream_t *contents;
+
+  /* This reads the noderev. */
+  SVN_ERR(svn_fs_file_length(&length, root, path, scratch_pool));
+  if (!b->include_fulltexts || length >= b->budget)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_fs_file_contents(&contents, root, path, scratch_pool));
+  SVN_ERR(svn_stream_copy3(contents, svn_stream_empty(scratch_pool),
+                           b->cancel_func, b->cancel_baton, scratch_pool));
+  consume(b, length);
+
+  return SVN_NO_ERROR;
+}
+
+/* Pre-load the tree of ROOT, breadth-first such that the top-level
+   directories make it into the cache if the budget in B is too small for
+   the whole tree. */
+static svn_error_t *
+warm_tree(warmup_baton_t *b,
+          svn_fs_root_t *root,
+          apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_pool_t *filepool = svn_pool_create(scratch_pool);
+  apr_array_header_t *queue = apr_array_make(scratch_pool, 16,
+                                             sizeof(const char *));
+  int next = 0;
+
+  APR_ARRAY_PUSH(queue, const char *) = "/";
+
+  while (next < queue->nelts && b->budget)
+    {
+      const char *path = APR_ARRAY_IDX(queue, next, const char *);
+      apr_hash_t *entries;
+      apr_hash_t *props;
+      apr_hash_index_t *hi;
+
+      svn_pool_clear(iterpool);
+      ++next;
+
+      if (b->cancel_func)
+        SVN_ERR(b->cancel_func(b->cancel_baton));
+
+      SVN_ERR(svn_fs_dir_entries(&entries, root, path, iterpool));
+      SVN_ERR(svn_fs_node_proplist(&props, root, path, iterpool));
+      ++b->nodes;
+
+      for (hi = apr_hash_first(iterpool, entries); hi; hi = apr_hash_next(hi))
+        {
+          svn_fs_dirent_t *dirent = apr_hash_this_val(hi);
+          const char *child;
+
+          if (!consume(b, strlen(dirent->name) + WARMUP_ENTRY_OVERHEAD))
+            break;
+
+          /* The queue must outlive the ITERPOOL. */
+          child = svn_fspath__join(path, dirent->name, scratch_pool);
+          if (dirent->kind == svn_node_dir)
+            {
+              APR_ARRAY_PUSH(queue, const char *) = child;
+            }
+          else
+            {
+              svn_pool_clear(filepool);
+              SVN_ERR(warm_file(b, root, child, filepool));
+              ++b->nodes;
+            }
+        }
+    }
+
+  svn_pool_destroy(filepool);
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_repos__warm_caches(apr_uint64_t *nodes,
+                       apr_uint64_t *bytes,
+                       svn_repos_t *repos,
+                       apr_uint64_t budget,
+                       svn_boolean_t include_fulltexts,
+                       svn_cancel_func_t cancel_func,
+                       void *cancel_baton,
+                       apr_pool_t *scratch_pool)
+{
+  warmup_baton_t b = { 0 };
+  svn_revnum_t youngest;
+  svn_fs_root_t *root;
+
+  b.fs = repos->fs;
+  b.budget = budget ? budget : APR_UINT64_MAX;
+  b.include_fulltexts = include_fulltexts;
+  b.cancel_func = cancel_func;
+  b.cancel_baton = cancel_baton;
+
+  SVN_ERR(svn_fs_youngest_rev(&youngest, b.fs, scratch_pool));
+
+  /* Recent history first.  It is small and covers log, diff and the
+     index pages of the youngest shards. */
+  SVN_ERR(warm_recent_revisions(&b, youngest, scratch_pool));
+
+  SVN_ERR(svn_fs_revision_root(&root, b.fs, youngest, scratch_pool));
+  SVN_ERR(warm_tree(&b, root, scratch_pool));
+
+  if (nodes)
+    *nodes = b.nodes;
+  if (bytes)
+    *bytes = b.bytes;
+
+  return SVN_NO_ERROR;
+}
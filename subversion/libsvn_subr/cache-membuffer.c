@@ -24,6 +24,7 @@
 #include <assert.h>
 #include <apr_md5.h>
 #include <apr_thread_rwlock.h>
+#include <apr_global_mutex.h>
 
 #include "svn_pools.h"
 #include "svn_checksum.h"
@@ -35,6 +36,7 @@
 #include "private/svn_atomic.h"
 #include "private/svn_dep_compat.h"
 #include "private/svn_mutex.h"
+#include "private/svn_shm.h"
 #include "private/svn_subr_private.h"
 #include "private/svn_string_private.h"
 
@@ -63,8 +65,23 @@
  * Only the start address of these two data parts are given as a native
  * pointer. All other references are expressed as offsets to these pointers.
  * With that design, it is relatively easy to share the same data structure
- * between different processes and / or to persist them on disk. These
- * out-of-process features have not been implemented, yet.
+ * between different processes and / or to persist them on disk.
+ *
+ * Sharing between processes is supported for pre-forking servers: a cache
+ * created by svn_cache__membuffer_cache_create_shared() places all segment
+ * headers, directories and data buffers in anonymous shared memory.  All
+ * processes forked after the cache's creation see the same cache contents
+ * at the same addresses.  Access is then serialized by per-segment global
+ * (cross-process) mutexes and the prefix pool is not being used since its
+ * indexes would be process-specific.  This covers svnserve in forking mode
+ * as well as httpd's prefork and worker MPMs, where mod_dav_svn creates
+ * the cache in the parent process and keeps it across graceful restarts.
+ *
+ * Named or file-backed segments, which unrelated processes could attach
+ * to and which would survive a full server restart, are not supported:
+ * the segment headers still contain native pointers to their directory
+ * and data buffers as well as process-specific mutex handles.  Those would
+ * first have to be replaced by offsets and per-process lock tables.
  *
  * Superficially, cache levels are being used as usual: insertion happens
  * into L1 and evictions will promote items to L2.  But their whole point
@@ -125,10 +142,19 @@
  * is then unique, too, and can never conflict.  No full key construction,
  * storage and comparison is needed in that case.
  *
- * All access to the cached data needs to be serialized. Because we want
- * to scale well despite that bottleneck, we simply segment the cache into
- * a number of independent caches (segments). Items will be multiplexed based
- * on their hash key.
+ * All modifications to the cached data need to be serialized. Because we
+ * want to scale well despite that bottleneck, we simply segment the cache
+ * into a number of independent caches (segments). Items will be multiplexed
+ * based on their hash key.
+ *
+ * Plain lookups don't take the segment lock if the compiler provides the
+ * necessary atomics.  Instead, every segment has a sequence counter that
+ * writers increment when acquiring and releasing the write lock, i.e. it
+ * is odd while the segment is being modified.  Readers look up and copy
+ * the item without any lock and simply discard the result (and retry or
+ * fall back to the read lock) if the counter changed in the meantime.
+ * Hit counters and access statistics are only updated for a sample of
+ * these lookups to keep readers from writing to shared cache lines.
  */
 
 /* APR's read-write lock implementation on Windows is horribly inefficient.
@@ -146,6 +172,34 @@
 #  define USE_SIMPLE_MUTEX 0
 #endif
 
+/* Optimistic, lock-free lookups require loads with acquire semantics.
+ * APR only provides atomic operations with full barriers, so we use the
+ * compiler intrinsics where available.  Tagged debug builds need to access
+ * the entry meta data under the lock.
+ */
+#if !defined(SVN_DEBUG_CACHE_MEMBUFFER) \
+    && (defined(__clang__) \
+        || (defined(__GNUC__) \
+            && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7))))
+#  define USE_OPTIMISTIC_READS 1
+#  define LOAD_ACQUIRE(value) __atomic_load_n(&(value), __ATOMIC_ACQUIRE)
+#  define LOAD_RELAXED(value) __atomic_load_n(&(value), __ATOMIC_RELAXED)
+#  define FENCE_ACQUIRE() __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#else
+#  define USE_OPTIMISTIC_READS 0
+#endif
+
+/* Number of lock-free lookup attempts before we fall back to taking the
+ * segment's read lock.
+ */
+#define OPTIMISTIC_READ_ATTEMPTS 4
+
+/* Lock-free lookups don't update hit counters and access statistics.
+ * Instead, every this many lookups take the locked path and get counted
+ * with this weight.  Must be a power of 2.
+ */
+#define HIT_SAMPLING_RATE 16
+
 /* For more efficient copy operations, let's align all data items properly.
  * Since we can't portably align pointers, this is rather the item size
  * granularity which ensures *relative* alignment within the cache - still
@@ -172,6 +226,12 @@
  */
 #define MAX_SEGMENT_COUNT 0x10000
 
+/* The maximum number of segments in a cache shared between processes.
+ * Each segment requires its own shared memory region and cross-process
+ * mutex, both of which are relatively expensive OS resources.
+ */
+#define MAX_SHARED_SEGMENT_COUNT 0x40
+
 /* As of today, APR won't allocate chunks of 4GB or more. So, limit the
  * segment size to slightly below that.
  */
@@ -813,10 +873,27 @@ struct svn_membuffer_t
   svn_boolean_t allow_blocking_writes;
 #endif
 
+  /* A lock for inter-process synchronization if the cache lives in
+   * shared memory, NULL otherwise.  If set, it takes precedence over LOCK
+   * and also serializes access between threads of the same process.
+   */
+  apr_global_mutex_t *shared_lock;
+
+  /* If SHARED_LOCK is set, this controls how write access is handled
+   * in the same way as ALLOW_BLOCKING_WRITES does for r/w locks.
+   */
+  svn_boolean_t shared_blocking_writes;
+
   /* A write lock counter, must be either 0 or 1.
    * This one is only used in debug assertions to verify that you used
    * the correct multi-threading settings. */
   svn_atomic_t write_lock_count;
+
+  /* Sequence counter for lock-free readers.  Incremented when acquiring
+   * and again when releasing the write lock, i.e. odd while the segment
+   * is being modified.
+   */
+  svn_atomic_t sequence;
 };
 
 /* Align integer VALUE to the next ITEM_ALIGNMENT boundary.
@@ -828,6 +905,15 @@ struct svn_membuffer_t
 static svn_error_t *
 read_lock_cache(svn_membuffer_t *cache)
 {
+  if (cache->shared_lock)
+    {
+      apr_status_t status = apr_global_mutex_lock(cache->shared_lock);
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't lock cache mutex"));
+
+      return SVN_NO_ERROR;
+    }
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__lock(cache->lock);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
@@ -851,6 +937,30 @@ read_lock_cache(svn_membuffer_t *cache)
 static svn_error_t *
 write_lock_cache(svn_membuffer_t *cache, svn_boolean_t *success)
 {
+  if (cache->shared_lock)
+    {
+      apr_status_t status;
+      if (cache->shared_blocking_writes)
+        {
+          status = apr_global_mutex_lock(cache->shared_lock);
+        }
+      else
+        {
+          status = apr_global_mutex_trylock(cache->shared_lock);
+          if (SVN_LOCK_IS_BUSY(status))
+            {
+              *success = FALSE;
+              status = APR_SUCCESS;
+            }
+        }
+
+      if (status)
+        return svn_error_wrap_apr(status,
+                                  _("Can't write-lock cache mutex"));
+
+      return SVN_NO_ERROR;
+    }
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__lock(cache->lock);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
@@ -888,13 +998,26 @@ write_lock_cache(svn_membuffer_t *cache, svn_boolean_t *success)
 static svn_error_t *
 force_write_lock_cache(svn_membuffer_t *cache)
 {
+  if (cache->shared_lock)
+    {
+      apr_status_t status = apr_global_mutex_lock(cache->shared_lock);
+      if (status)
+        return svn_error_wrap_apr(status,
+                                  _("Can't write-lock cache mutex"));
+
+      return SVN_NO_ERROR;
+    }
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__lock(cache->lock);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
-  apr_status_t status = apr_thread_rwlock_wrlock(cache->lock);
-  if (status)
-    return svn_error_wrap_apr(status,
-                              _("Can't write-lock cache mutex"));
+  if (cache->lock)
+    {
+      apr_status_t status = apr_thread_rwlock_wrlock(cache->lock);
+      if (status)
+        return svn_error_wrap_apr(status,
+                                  _("Can't write-lock cache mutex"));
+    }
 
   return SVN_NO_ERROR;
 #else
@@ -908,6 +1031,18 @@ force_write_lock_cache(svn_membuffer_t *cache)
 static svn_error_t *
 unlock_cache(svn_membuffer_t *cache, svn_error_t *err)
 {
+  if (cache->shared_lock)
+    {
+      apr_status_t status = apr_global_mutex_unlock(cache->shared_lock);
+      if (err)
+        return err;
+
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't unlock cache mutex"));
+
+      return SVN_NO_ERROR;
+    }
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__unlock(cache->lock, err);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
@@ -927,6 +1062,25 @@ unlock_cache(svn_membuffer_t *cache, svn_error_t *err)
 #endif
 }
 
+/* Notify lock-free readers that CACHE is about to be modified.
+ * The caller must hold the write lock.
+ */
+static APR_INLINE void
+begin_write(svn_membuffer_t *cache)
+{
+  svn_atomic_inc(&cache->sequence);
+}
+
+/* Notify lock-free readers that the modification of CACHE is complete,
+ * then release the write lock.  Return ERR upon success.
+ */
+static svn_error_t *
+write_unlock_cache(svn_membuffer_t *cache, svn_error_t *err)
+{
+  svn_atomic_inc(&cache->sequence);
+  return unlock_cache(cache, err);
+}
+
 /* If supported, guard the execution of EXPR with a read lock to CACHE.
  * The macro has been modeled after SVN_MUTEX__WITH_LOCK.
  */
@@ -959,7 +1113,8 @@ do {                                                            \
       else                                                      \
         break;                                                  \
     }                                                           \
-  SVN_ERR(unlock_cache(cache, (expr)));                         \
+  begin_write(cache);                                           \
+  SVN_ERR(write_unlock_cache(cache, (expr)));                   \
 } while (0)
 
 /* Returns 0 if the entry group identified by GROUP_INDEX in CACHE has not
@@ -1832,17 +1987,47 @@ ensure_data_insertable_l1(svn_membuffer_t *cache, apr_size_t size)
    * right answer. */
 }
 
-svn_error_t *
-svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
-                                  apr_size_t total_size,
-                                  apr_size_t directory_size,
-                                  apr_size_t segment_count,
-                                  svn_boolean_t thread_safe,
-                                  svn_boolean_t allow_blocking_writes,
-                                  apr_pool_t *pool)
+/* Allocate SIZE bytes for a membuffer cache and return them in *RESULT.
+ * If SHARED is set, the memory will be taken from a new anonymous shared
+ * memory region that remains valid as long as POOL does and that will be
+ * inherited by all child processes forked while it is valid.  Otherwise,
+ * simply allocate from POOL.  Shared memory will be zero-initialized;
+ * pool memory only if CLEAR has been set.
+ */
+static svn_error_t *
+membuffer_alloc(void **result,
+                apr_size_t size,
+                svn_boolean_t clear,
+                svn_boolean_t shared,
+                apr_pool_t *pool)
+{
+  if (shared)
+    return svn_error_trace(svn_shm__alloc(result, size, pool));
+
+  *result = clear ? apr_pcalloc(pool, size) : apr_palloc(pool, size);
+  if (*result == NULL)
+    return svn_error_wrap_apr(APR_ENOMEM, "OOM");
+
+  return SVN_NO_ERROR;
+}
+
+/* Implement svn_cache__membuffer_cache_create and
+ * svn_cache__membuffer_cache_create_shared.  If SHARED is set, place all
+ * cache data in shared memory and use cross-process locks; THREAD_SAFE
+ * is being ignored in that case.
+ */
+static svn_error_t *
+membuffer_cache_create(svn_membuffer_t **cache,
+                       apr_size_t total_size,
+                       apr_size_t directory_size,
+                       apr_size_t segment_count,
+                       svn_boolean_t thread_safe,
+                       svn_boolean_t allow_blocking_writes,
+                       svn_boolean_t shared,
+                       apr_pool_t *pool)
 {
   svn_membuffer_t *c;
-  prefix_pool_t *prefix_pool;
+  prefix_pool_t *prefix_pool = NULL;
 
   apr_uint32_t seg;
   apr_uint32_t group_count;
@@ -1853,22 +2038,30 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
   apr_uint64_t max_entry_size;
 
   /* Allocate 1% of the cache capacity to the prefix string pool.
+   * Prefix indexes are process-local, so shared caches can't use them.
    */
-  SVN_ERR(prefix_pool_create(&prefix_pool, total_size / 100, thread_safe,
-                             pool));
-  total_size -= total_size / 100;
+  if (!shared)
+    {
+      SVN_ERR(prefix_pool_create(&prefix_pool, total_size / 100,
+                                 thread_safe, pool));
+      total_size -= total_size / 100;
+    }
 
   /* Limit the total size (only relevant if we can address > 4GB)
    */
 #if APR_SIZEOF_VOIDP > 4
   if (total_size > MAX_SEGMENT_SIZE * MAX_SEGMENT_COUNT)
     total_size = MAX_SEGMENT_SIZE * MAX_SEGMENT_COUNT;
+  if (shared && total_size > MAX_SEGMENT_SIZE * MAX_SHARED_SEGMENT_COUNT)
+    total_size = MAX_SEGMENT_SIZE * MAX_SHARED_SEGMENT_COUNT;
 #endif
 
   /* Limit the segment count
    */
   if (segment_count > MAX_SEGMENT_COUNT)
     segment_count = MAX_SEGMENT_COUNT;
+  if (shared && segment_count > MAX_SHARED_SEGMENT_COUNT)
+    segment_count = MAX_SHARED_SEGMENT_COUNT;
   if (segment_count * MIN_SEGMENT_SIZE > total_size)
     segment_count = total_size / MIN_SEGMENT_SIZE;
 
@@ -1911,7 +2104,8 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
     segment_count *= 2;
 
   /* allocate cache as an array of segments / cache objects */
-  c = apr_palloc(pool, segment_count * sizeof(*c));
+  SVN_ERR(membuffer_alloc((void **)&c, segment_count * sizeof(*c), FALSE,
+                          shared, pool));
 
   /* Split total cache size into segments of equal size
    */
@@ -1978,12 +2172,14 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
       /* Allocate but don't clear / zero the directory because it would add
          significantly to the server start-up time if the caches are large.
          Group initialization will take care of that in stead. */
-      c[seg].directory = apr_palloc(pool,
-                                    group_count * sizeof(entry_group_t));
+      SVN_ERR(membuffer_alloc((void **)&c[seg].directory,
+                              group_count * sizeof(entry_group_t), FALSE,
+                              shared, pool));
 
       /* Allocate and initialize directory entries as "not initialized",
          hence "unused" */
-      c[seg].group_initialized = apr_pcalloc(pool, group_init_size);
+      SVN_ERR(membuffer_alloc((void **)&c[seg].group_initialized,
+                              group_init_size, TRUE, shared, pool));
 
       /* Allocate 1/4th of the data buffer to L1
        */
@@ -2004,7 +2200,9 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
       c[seg].l2.current_data = c[seg].l2.start_offset;
 
       /* This cast is safe because DATA_SIZE <= MAX_SEGMENT_SIZE. */
-      c[seg].data = apr_palloc(pool, (apr_size_t)ALIGN_VALUE(data_size));
+      SVN_ERR(membuffer_alloc((void **)&c[seg].data,
+                              (apr_size_t)ALIGN_VALUE(data_size), FALSE,
+                              shared, pool));
       c[seg].data_used = 0;
       c[seg].max_entry_size = max_entry_size;
 
@@ -2013,14 +2211,17 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
       c[seg].total_writes = 0;
       c[seg].total_hits = 0;
 
-      /* were allocations successful?
-       * If not, initialize a minimal cache structure.
+      /* In shared mode, a single cross-process mutex per segment
+       * serializes all access, including that of threads within the
+       * same process.  Child processes must re-attach it with
+       * svn_cache__membuffer_cache_child_init().
        */
-      if (c[seg].data == NULL || c[seg].directory == NULL)
+      c[seg].shared_lock = NULL;
+      c[seg].shared_blocking_writes = allow_blocking_writes;
+      if (shared)
         {
-          /* We are OOM. There is no need to proceed with "half a cache".
-           */
-          return svn_error_wrap_apr(APR_ENOMEM, "OOM");
+          SVN_ERR(svn_shm__mutex_create(&c[seg].shared_lock, pool));
+          thread_safe = FALSE;
         }
 
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
@@ -2046,6 +2247,7 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
 #endif
       /* No writers at the moment. */
       c[seg].write_lock_count = 0;
+      c[seg].sequence = 0;
     }
 
   /* done here
@@ -2054,6 +2256,50 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
+                                  apr_size_t total_size,
+                                  apr_size_t directory_size,
+                                  apr_size_t segment_count,
+                                  svn_boolean_t thread_safe,
+                                  svn_boolean_t allow_blocking_writes,
+                                  apr_pool_t *pool)
+{
+  return svn_error_trace(membuffer_cache_create(cache, total_size,
+                                                directory_size,
+                                                segment_count, thread_safe,
+                                                allow_blocking_writes,
+                                                FALSE, pool));
+}
+
+svn_error_t *
+svn_cache__membuffer_cache_create_shared(svn_membuffer_t **cache,
+                                         apr_size_t total_size,
+                                         apr_size_t directory_size,
+                                         apr_size_t segment_count,
+                                         svn_boolean_t allow_blocking_writes,
+                                         apr_pool_t *pool)
+{
+  return svn_error_trace(membuffer_cache_create(cache, total_size,
+                                                directory_size,
+                                                segment_count, TRUE,
+                                                allow_blocking_writes,
+                                                TRUE, pool));
+}
+
+svn_error_t *
+svn_cache__membuffer_cache_child_init(svn_membuffer_t *cache,
+                                      apr_pool_t *pool)
+{
+  apr_size_t seg;
+
+  for (seg = 0; seg < cache->segment_count; ++seg)
+    if (cache[seg].shared_lock)
+      SVN_ERR(svn_shm__mutex_child_init(cache[seg].shared_lock, pool));
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_cache__membuffer_clear(svn_membuffer_t *cache)
 {
@@ -2078,6 +2324,7 @@ svn_cache__membuffer_clear(svn_membuffer_t *cache)
     {
       /* Unconditionally acquire the write lock. */
       SVN_ERR(force_write_lock_cache(&cache[seg]));
+      begin_write(&cache[seg]);
 
       /* Mark all groups as "not initialized", which implies "empty". */
       cache[seg].first_spare_group = NO_INDEX;
@@ -2102,7 +2349,7 @@ svn_cache__membuffer_clear(svn_membuffer_t *cache)
       cache[seg].used_entries = 0;
 
       /* Segment may be used again. */
-      SVN_ERR(unlock_cache(&cache[seg], SVN_NO_ERROR));
+      SVN_ERR(write_unlock_cache(&cache[seg], SVN_NO_ERROR));
     }
 
   /* done here */
@@ -2374,7 +2621,7 @@ increment_hit_counters(svn_membuffer_t *cache, entry_t *entry)
  * by the hash value TO_FIND. If no item has been stored for KEY,
  * *BUFFER will be NULL. Otherwise, return a copy of the serialized
  * data in *BUFFER and return its size in *ITEM_SIZE. Allocations will
- * be done in POOL.
+ * be done in POOL.  Count the lookup WEIGHT times in the statistics.
  *
  * Note: This function requires the caller to serialization access.
  * Don't call it directly, call membuffer_cache_get instead.
@@ -2385,6 +2632,7 @@ membuffer_cache_get_internal(svn_membuffer_t *cache,
                              const full_key_t *to_find,
                              char **buffer,
                              apr_size_t *item_size,
+                             apr_uint32_t weight,
                              DEBUG_CACHE_MEMBUFFER_TAG_ARG
                              apr_pool_t *result_pool)
 {
@@ -2394,7 +2642,7 @@ membuffer_cache_get_internal(svn_membuffer_t *cache,
   /* The actual cache data access needs to sync'ed
    */
   entry = find_entry(cache, group_index, to_find, FALSE);
-  cache->total_reads++;
+  cache->total_reads += weight;
   if (entry == NULL)
     {
       /* no such entry found.
@@ -2427,40 +2675,211 @@ membuffer_cache_get_internal(svn_membuffer_t *cache,
 
   /* update hit statistics
    */
-  increment_hit_counters(cache, entry);
+  if (weight == 1)
+    increment_hit_counters(cache, entry);
+  else if (weight)
+    {
+      apr_atomic_add32(&entry->hit_count, weight);
+      cache->total_hits += weight;
+    }
+
   *item_size = entry->size - entry->key.key_len;
 
   return SVN_NO_ERROR;
 }
 
+#if USE_OPTIMISTIC_READS
+
+/* Lock-free variant of find_entry with FIND_EMPTY not set.  The contents
+ * of CACHE may be modified concurrently, so all indexes and offsets read
+ * from the directory are validated before being used.
+ *
+ * If the entry identified by TO_FIND within the group chain starting at
+ * GROUP_INDEX could be found, return it in *ENTRY together with a snapshot
+ * of its data OFFSET and SIZE.  Set *ENTRY to NULL if there is no such
+ * entry.  Return FALSE if inconsistent data has been encountered, TRUE
+ * otherwise.  In either case, the result is only valid if CACHE's sequence
+ * counter did not change since before the call.
+ */
+static svn_boolean_t
+find_entry_optimistic(svn_membuffer_t *cache,
+                      apr_uint32_t group_index,
+                      const full_key_t *to_find,
+                      entry_t **entry,
+                      apr_uint64_t *offset,
+                      apr_size_t *size)
+{
+  /* These don't change after cache construction. */
+  apr_uint32_t group_total = cache->group_count + cache->spare_group_count;
+  apr_uint64_t data_size = cache->l2.start_offset + cache->l2.size;
+  apr_size_t key_len = to_find->entry_key.key_len;
+  apr_uint32_t chain_length;
+  apr_uint32_t i;
+
+  *entry = NULL;
+  if (! is_group_initialized(cache, group_index))
+    return TRUE;
+
+  for (chain_length = 0;
+       chain_length < MAX_GROUP_CHAIN_LENGTH;
+       ++chain_length)
+    {
+      entry_group_t *group = &cache->directory[group_index];
+      const volatile group_header_t *header = &group->header;
+      apr_uint32_t used = header->used;
+      apr_uint32_t next = header->next;
+
+      if (used > GROUP_SIZE)
+        return FALSE;
+
+      for (i = 0; i < used; ++i)
+        if (entry_keys_match(&group->entries[i].key, &to_find->entry_key))
+          {
+            const volatile entry_t *found = &group->entries[i];
+            apr_uint64_t entry_offset = found->offset;
+            apr_size_t entry_size = found->size;
+
+            /* Everything we are going to copy must be within the buffer. */
+            if (   entry_size < key_len
+                || entry_offset > data_size
+                || ALIGN_VALUE(entry_size) > data_size - entry_offset)
+              return FALSE;
+
+            /* Compare the full key, if there is one.  A mismatch means
+             * that the item is not cached. */
+            if (key_len
+                && memcmp(to_find->full_key.data,
+                          cache->data + entry_offset, key_len) != 0)
+              return TRUE;
+
+            *entry = &group->entries[i];
+            *offset = entry_offset;
+            *size = entry_size;
+            return TRUE;
+          }
+
+      /* end of chain? */
+      if (next == NO_INDEX)
+        return TRUE;
+
+      /* only full groups may chain */
+      if (used != GROUP_SIZE || next >= group_total)
+        return FALSE;
+
+      group_index = next;
+    }
+
+  /* Chains can't be that long. */
+  return FALSE;
+}
+
+/* Lock-free variant of membuffer_cache_get_internal.  Return TRUE if the
+ * lookup succeeded, i.e. *BUFFER and *ITEM_SIZE are valid, and FALSE if
+ * the caller needs to repeat the lookup under the read lock.
+ *
+ * Neither hit counters nor statistics get updated because the entry may
+ * get replaced at any time and there is no lock to protect them.
+ */
+static svn_boolean_t
+membuffer_cache_get_optimistic(svn_membuffer_t *cache,
+                               apr_uint32_t group_index,
+                               const full_key_t *to_find,
+                               char **buffer,
+                               apr_size_t *item_size,
+                               apr_pool_t *result_pool)
+{
+  apr_size_t key_len = to_find->entry_key.key_len;
+  int attempt;
+
+  for (attempt = 0; attempt < OPTIMISTIC_READ_ATTEMPTS; ++attempt)
+    {
+      entry_t *entry;
+      apr_uint64_t offset = 0;
+      apr_size_t size = 0;
+      char *data = NULL;
+      apr_uint32_t sequence = LOAD_ACQUIRE(cache->sequence);
+
+      /* Some writer is active.  Waiting for the lock is cheaper than
+       * spinning here. */
+      if (sequence & 1)
+        return FALSE;
+
+      if (! find_entry_optimistic(cache, group_index, to_find, &entry,
+                                  &offset, &size))
+        continue;
+
+      if (entry)
+        {
+          apr_size_t to_copy = ALIGN_VALUE(size) - key_len;
+          data = apr_palloc(result_pool, to_copy);
+          memcpy(data, cache->data + offset + key_len, to_copy);
+        }
+
+      /* Did we see consistent data? */
+      FENCE_ACQUIRE();
+      if (LOAD_RELAXED(cache->sequence) != sequence)
+        continue;
+
+      *buffer = data;
+      *item_size = entry ? size - key_len : 0;
+      return TRUE;
+    }
+
+  return FALSE;
+}
+
+#endif
+
 /* Look for the *ITEM identified by KEY. If no item has been stored
  * for KEY, *ITEM will be NULL. Otherwise, the DESERIALIZER is called
  * to re-construct the proper object from the serialized data.
- * Allocations will be done in POOL.
+ * Allocations will be done in POOL.  SAMPLE_COUNTER is used to
+ * sample lock-free lookups for statistics.
  */
 static svn_error_t *
 membuffer_cache_get(svn_membuffer_t *cache,
                     const full_key_t *key,
                     void **item,
                     svn_cache__deserialize_func_t deserializer,
+                    apr_uint32_t *sample_counter,
                     DEBUG_CACHE_MEMBUFFER_TAG_ARG
                     apr_pool_t *result_pool)
 {
   apr_uint32_t group_index;
   char *buffer;
   apr_size_t size;
+  svn_boolean_t found = FALSE;
+  apr_uint32_t weight = 1;
 
   /* find the entry group that will hold the key.
    */
   group_index = get_group_index(&cache, &key->entry_key);
-  WITH_READ_LOCK(cache,
-                 membuffer_cache_get_internal(cache,
-                                              group_index,
-                                              key,
-                                              &buffer,
-                                              &size,
-                                              DEBUG_CACHE_MEMBUFFER_TAG
-                                              result_pool));
+
+#if USE_OPTIMISTIC_READS
+  /* Statistics only get updated under the lock.  So, send every
+   * HIT_SAMPLING_RATE-th lookup down the locked path and count it for all
+   * lookups since the last one, including any that fell back to the lock.
+   * *SAMPLE_COUNTER should not be shared by many threads. */
+  if ((++*sample_counter & (HIT_SAMPLING_RATE - 1)) == 0)
+    weight = HIT_SAMPLING_RATE;
+  else
+    {
+      weight = 0;
+      found = membuffer_cache_get_optimistic(cache, group_index, key,
+                                             &buffer, &size, result_pool);
+    }
+#endif
+
+  if (! found)
+    WITH_READ_LOCK(cache,
+                   membuffer_cache_get_internal(cache,
+                                                group_index,
+                                                key,
+                                                &buffer,
+                                                &size,
+                                                weight,
+                                                DEBUG_CACHE_MEMBUFFER_TAG
+                                                result_pool));
 
   /* re-construct the original data object from its serialized form.
    */
@@ -2806,6 +3225,12 @@ typedef struct svn_membuffer_cache_t
   /* if enabled, this will serialize the access to this instance.
    */
   svn_mutex__t *mutex;
+
+  /* Number of lock-free lookups made through this instance.  Used to
+   * sample them for hit statistics.  Since cache instances are usually
+   * not shared between threads, this is effectively a per-thread counter.
+   */
+  apr_uint32_t sample_counter;
 } svn_membuffer_cache_t;
 
 /* Return the prefix key used by CACHE. */
@@ -2949,6 +3374,7 @@ svn_membuffer_cache_get(void **value_p,
                               &cache->combined_key,
                               value_p,
                               cache->deserializer,
+                              &cache->sample_counter,
                               DEBUG_CACHE_MEMBUFFER_TAG
                               result_pool));
 
@@ -3400,7 +3826,8 @@ svn_cache__create_membuffer_cache(svn_cache__t **cache_p,
    * full key separately for each item. */
   if (   (klen != APR_HASH_KEY_STRING)
       && (klen <= sizeof(cache->combined_key.entry_key.fingerprint))
-      && !short_lived)
+      && !short_lived
+      && membuffer->prefix_pool)
     SVN_ERR(prefix_pool_get(&cache->prefix.prefix_idx,
                             membuffer->prefix_pool,
                             prefix));
@@ -3478,3 +3905,24 @@ svn_cache__membuffer_get_global_info(apr_pool_t *pool)
 
   return info;
 }
+
+void
+svn_cache__membuffer_get_global_counters(apr_uint64_t *gets,
+                                         apr_uint64_t *hits)
+{
+  apr_uint32_t i;
+  svn_membuffer_t *membuffer = svn_cache__get_global_membuffer_cache();
+
+  *gets = 0;
+  *hits = 0;
+  if (membuffer == NULL)
+    return;
+
+  /* These are plain statistics counters.  Reading them without holding
+   * the segment locks may miss concurrent updates but that is o.k. */
+  for (i = 0; i < membuffer->segment_count; ++i)
+    {
+      *gets += membuffer[i].total_reads;
+      *hits += membuffer[i].total_hits;
+    }
+}
@@ -28,6 +28,7 @@
 
 #include "svn_pools.h"
 #include "svn_sorts.h"
+#include "svn_private_config.h"
 
 /* The cache settings as a process-wide singleton.
  */
@@ -64,6 +65,12 @@ static svn_cache_config_t cache_settings =
 #endif
 };
 
+/* The process-global (singleton) membuffer cache and its initialization
+ * state as used by svn_atomic__init_once.
+ */
+static svn_membuffer_t *global_cache = NULL;
+static svn_atomic_t global_cache_initialized = 0;
+
 /* Get the current FSFS cache configuration. */
 const svn_cache_config_t *
 svn_cache_config_get(void)
@@ -158,11 +165,9 @@ initialize_cache(void *baton, apr_pool_t *unused_pool)
 svn_membuffer_t *
 svn_cache__get_global_membuffer_cache(void)
 {
-  static svn_membuffer_t *cache = NULL;
-  static svn_atomic_t initialized = 0;
-
   svn_error_t *err
-    = svn_atomic__init_once(&initialized, initialize_cache, &cache, NULL);
+    = svn_atomic__init_once(&global_cache_initialized, initialize_cache,
+                            &global_cache, NULL);
   if (err)
     {
       /* no caches today ... */
@@ -170,7 +175,54 @@ svn_cache__get_global_membuffer_cache(void)
       return NULL;
     }
 
-  return cache;
+  return global_cache;
+}
+
+/* Initializer function as required by svn_atomic__init_once.  Make the
+ * svn_membuffer_t given in BATON the process-global membuffer cache.
+ * UNUSED_POOL is unused and should be NULL.
+ */
+static svn_error_t *
+install_cache(void *baton, apr_pool_t *unused_pool)
+{
+  global_cache = baton;
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_cache__set_global_membuffer_cache(svn_membuffer_t *cache)
+{
+  SVN_ERR(svn_atomic__init_once(&global_cache_initialized, install_cache,
+                                cache, NULL));
+  if (global_cache != cache)
+    return svn_error_create(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                            _("The global membuffer cache has already "
+                              "been initialized"));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_cache__create_shared_global_membuffer_cache(svn_membuffer_t **cache,
+                                                apr_pool_t *result_pool)
+{
+  /* Same size limits as for the per-process cache. */
+  apr_uint64_t cache_size = MIN(cache_settings.cache_size,
+                                (apr_uint64_t)SVN_MAX_OBJECT_SIZE / 2);
+
+  *cache = NULL;
+  if (cache_size == 0)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_cache__membuffer_cache_create_shared(
+              cache,
+              (apr_size_t)cache_size,
+              (apr_size_t)(cache_size / 5),
+              0,
+              FALSE,
+              result_pool));
+
+  return svn_error_trace(svn_cache__set_global_membuffer_cache(*cache));
 }
 
 void
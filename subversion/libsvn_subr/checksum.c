@@ -35,6 +35,7 @@
 
 #include "checksum.h"
 #include "fnv1a.h"
+#include "sha1.h"
 
 #include "private/svn_subr_private.h"
 
@@ -475,8 +476,6 @@ svn_checksum(svn_checksum_t **checksum,
              apr_size_t len,
              apr_pool_t *pool)
 {
-  apr_sha1_ctx_t sha1_ctx;
-
   SVN_ERR(validate_kind(kind));
   *checksum = svn_checksum_create(kind, pool);
 
@@ -487,9 +486,7 @@ svn_checksum(svn_checksum_t **checksum,
         break;
 
       case svn_checksum_sha1:
-        apr_sha1_init(&sha1_ctx);
-        apr_sha1_update(&sha1_ctx, data, (unsigned int)len);
-        apr_sha1_final((unsigned char *)(*checksum)->digest, &sha1_ctx);
+        svn_sha1__digest((unsigned char *)(*checksum)->digest, data, len);
         break;
 
       case svn_checksum_fnv1a_32:
@@ -550,8 +547,7 @@ svn_checksum_ctx_create(svn_checksum_kind_t kind,
         break;
 
       case svn_checksum_sha1:
-        ctx->apr_ctx = apr_palloc(pool, sizeof(apr_sha1_ctx_t));
-        apr_sha1_init(ctx->apr_ctx);
+        ctx->apr_ctx = svn_sha1__context_create(pool);
         break;
 
       case svn_checksum_fnv1a_32:
@@ -581,7 +577,7 @@ svn_checksum_update(svn_checksum_ctx_t *ctx,
         break;
 
       case svn_checksum_sha1:
-        apr_sha1_update(ctx->apr_ctx, data, (unsigned int)len);
+        svn_sha1__update(ctx->apr_ctx, data, len);
         break;
 
       case svn_checksum_fnv1a_32:
@@ -614,7 +610,8 @@ svn_checksum_final(svn_checksum_t **checksum,
         break;
 
       case svn_checksum_sha1:
-        apr_sha1_final((unsigned char *)(*checksum)->digest, ctx->apr_ctx);
+        svn_sha1__finalize((unsigned char *)(*checksum)->digest,
+                           ctx->apr_ctx);
         break;
 
       case svn_checksum_fnv1a_32:
@@ -693,7 +690,8 @@ svn_checksum_is_empty_checksum(svn_checksum_t *checksum)
 
 /* Baton used by write_handler and close_handler to calculate the checksum
  * and return the result to the stream creator.  It accommodates the data
- * needed by svn_checksum__wrap_write_stream_fnv1a_32x4 as well as
+ * needed by svn_checksum__wrap_write_stream_fnv1a_32x4,
+ * svn_checksum__wrap_write_stream_md5_sha1 as well as
  * svn_checksum__wrap_write_stream.
  */
 typedef struct stream_baton_t
@@ -710,6 +708,11 @@ typedef struct stream_baton_t
   /* Copy the digest of the final checksum. May be NULL. */
   unsigned char *digest;
 
+  /* Second checksum to build in the same pass over the data and where to
+   * write its final value.  Both are NULL if there is none. */
+  svn_checksum_ctx_t *context2;
+  svn_checksum_t **checksum2;
+
   /* Allocate the resulting checksum here. */
   apr_pool_t *pool;
 } stream_baton_t;
@@ -725,6 +728,8 @@ write_handler(void *baton,
   stream_baton_t *b = baton;
 
   SVN_ERR(svn_checksum_update(b->context, data, *len));
+  if (b->context2)
+    SVN_ERR(svn_checksum_update(b->context2, data, *len));
   SVN_ERR(svn_stream_write(b->inner_stream, data, len));
 
   return SVN_NO_ERROR;
@@ -753,6 +758,9 @@ close_handler(void *baton)
       memcpy(b->digest, (*b->checksum)->digest, digest_size);
     }
 
+  if (b->context2)
+    SVN_ERR(svn_checksum_final(b->checksum2, b->context2, b->pool));
+
   /* Done here.  Now, close the underlying stream as well. */
   return svn_error_trace(svn_stream_close(b->inner_stream));
 }
@@ -824,3 +832,28 @@ svn_checksum__wrap_write_stream_fnv1a_32x4(apr_uint32_t *digest,
 
   return result;
 }
+
+svn_stream_t *
+svn_checksum__wrap_write_stream_md5_sha1(svn_checksum_t **md5_checksum,
+                                         svn_checksum_t **sha1_checksum,
+                                         svn_stream_t *inner_stream,
+                                         apr_pool_t *pool)
+{
+  svn_stream_t *outer_stream;
+
+  /* Hash each chunk with both algorithms while it is still in the CPU
+   * caches instead of running the data through two separate wrappers. */
+  stream_baton_t *baton = apr_pcalloc(pool, sizeof(*baton));
+  baton->inner_stream = inner_stream;
+  baton->context = svn_checksum_ctx_create(svn_checksum_md5, pool);
+  baton->checksum = md5_checksum;
+  baton->context2 = svn_checksum_ctx_create(svn_checksum_sha1, pool);
+  baton->checksum2 = sha1_checksum;
+  baton->pool = pool;
+
+  outer_stream = svn_stream_create(baton, pool);
+  svn_stream_set_write(outer_stream, write_handler);
+  svn_stream_set_close(outer_stream, close_handler);
+
+  return outer_stream;
+}
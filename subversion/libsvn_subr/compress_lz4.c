@@ -0,0 +1,377 @@
+/*
+ * compress_lz4.c:  LZ4 data compression routines
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+
+#include <string.h>
+#include <assert.h>
+
+#include "private/svn_subr_private.h"
+
+#include "svn_private_config.h"
+
+/* This file contains a self-contained implementation of the LZ4 block
+ * format (see https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md).
+ * We only use a single fast compression mode, i.e. a greedy parser with
+ * a small hash table of recent 4-byte sequences.  That is the trade-off
+ * the LZ4 format was designed for:  compression takes only a fraction of
+ * the time zlib needs at level 1, while decompression is essentially
+ * bound by memory bandwidth.
+ *
+ * The output can be read by any conforming LZ4 block decoder and we
+ * accept any valid LZ4 block as input.
+ */
+
+/* Minimum length of a match in the LZ4 format. */
+#define LZ4_MIN_MATCH 4
+
+/* The last LZ4_LAST_LITERALS bytes of a block are always literals. */
+#define LZ4_LAST_LITERALS 5
+
+/* A match must not start within the last LZ4_MF_LIMIT bytes of a block. */
+#define LZ4_MF_LIMIT 12
+
+/* Largest distance between a match and its reference. */
+#define LZ4_MAX_DISTANCE 0xffff
+
+/* Number of bits used to index the match finder hash table.
+ * 2^12 32 bit entries are 16kB, i.e. fit into the L1 cache. */
+#define LZ4_HASH_LOG 12
+
+/* Largest input we will try to compress in a single block.  The match
+ * finder table stores 32 bit offsets. */
+#define LZ4_MAX_INPUT_SIZE 0x7e000000
+
+/* Upper limit for the size of the compressed representation of LEN bytes
+ * (worst case: all literals with length extension bytes). */
+#define LZ4_COMPRESS_BOUND(LEN) ((LEN) + (LEN) / 255 + 16)
+
+/* Data under this size will not be compressed.  The LZ4 per-block overhead
+   is much lower than zlib's, so this is smaller than the zlib threshold. */
+#define MIN_COMPRESS_SIZE 32
+
+/* Return the 4 bytes starting at P as an unaligned 32 bit word. */
+static APR_INLINE apr_uint32_t
+read32(const unsigned char *p)
+{
+  apr_uint32_t value;
+  memcpy(&value, p, sizeof(value));
+
+  return value;
+}
+
+/* Return the match finder hash table index for the 4-byte SEQUENCE. */
+static APR_INLINE apr_size_t
+hash_sequence(apr_uint32_t sequence)
+{
+  return (apr_size_t)((sequence * 2654435761U) >> (32 - LZ4_HASH_LOG));
+}
+
+/* Write the LZ4 length extension for LEN (i.e. the part exceeding the
+ * 4 bit field in the token) to OP and return the incremented OP.
+ */
+static unsigned char *
+write_length(unsigned char *op, apr_size_t len)
+{
+  while (len >= 255)
+    {
+      *op++ = 255;
+      len -= 255;
+    }
+
+  *op++ = (unsigned char)len;
+  return op;
+}
+
+/* Write a sequence with LITERAL_LEN literals starting at LITERALS to OP,
+ * followed by a match of MATCH_LEN bytes at DISTANCE, unless MATCH_LEN is 0.
+ * Return the incremented OP.
+ */
+static unsigned char *
+write_sequence(unsigned char *op,
+               const unsigned char *literals,
+               apr_size_t literal_len,
+               apr_size_t match_len,
+               apr_size_t distance)
+{
+  unsigned char *token = op++;
+
+  *token = (unsigned char)((literal_len < 15 ? literal_len : 15) << 4);
+  if (literal_len >= 15)
+    op = write_length(op, literal_len - 15);
+
+  memcpy(op, literals, literal_len);
+  op += literal_len;
+
+  if (match_len)
+    {
+      match_len -= LZ4_MIN_MATCH;
+
+      *op++ = (unsigned char)(distance & 0xff);
+      *op++ = (unsigned char)(distance >> 8);
+
+      *token |= (unsigned char)(match_len < 15 ? match_len : 15);
+      if (match_len >= 15)
+        op = write_length(op, match_len - 15);
+    }
+
+  return op;
+}
+
+/* Compress the LEN bytes at SRC into the LZ4 block format and write the
+ * result to DST.  DST must provide at least LZ4_COMPRESS_BOUND(LEN) bytes.
+ * Return the number of bytes written.
+ */
+static apr_size_t
+lz4_compress_block(unsigned char *dst,
+                   const unsigned char *src,
+                   apr_size_t len)
+{
+  apr_uint32_t table[1 << LZ4_HASH_LOG];
+  const unsigned char *ip = src;
+  const unsigned char *anchor = src;
+  const unsigned char *end = src + len;
+  unsigned char *op = dst;
+
+  if (len > LZ4_MF_LIMIT)
+    {
+      const unsigned char *mf_limit = end - LZ4_MF_LIMIT;
+      const unsigned char *match_limit = end - LZ4_LAST_LITERALS;
+
+      memset(table, 0, sizeof(table));
+      while (ip < mf_limit)
+        {
+          apr_uint32_t sequence = read32(ip);
+          apr_size_t hash = hash_sequence(sequence);
+          const unsigned char *ref = src + table[hash];
+          const unsigned char *match_end;
+
+          table[hash] = (apr_uint32_t)(ip - src);
+          if (   ref >= ip
+              || ip - ref > LZ4_MAX_DISTANCE
+              || read32(ref) != sequence)
+            {
+              ++ip;
+              continue;
+            }
+
+          /* Extend the match backwards into the pending literals. */
+          while (ip > anchor && ref > src && ip[-1] == ref[-1])
+            {
+              --ip;
+              --ref;
+            }
+
+          /* Extend the match forward but not into the last literals. */
+          match_end = ip + LZ4_MIN_MATCH;
+          ref += LZ4_MIN_MATCH;
+          while (match_end < match_limit && *match_end == *ref)
+            {
+              ++match_end;
+              ++ref;
+            }
+
+          op = write_sequence(op, anchor, ip - anchor, match_end - ip,
+                              match_end - ref);
+          ip = match_end;
+          anchor = ip;
+        }
+    }
+
+  /* Remaining data is stored as literals. */
+  return write_sequence(op, anchor, end - anchor, 0, 0) - dst;
+}
+
+/* Decode the LZ4 block of SRC_LEN bytes at SRC into DST.  Return TRUE,
+ * if the block is valid and expands to exactly DST_LEN bytes.
+ */
+static svn_boolean_t
+lz4_decompress_block(unsigned char *dst,
+                     apr_size_t dst_len,
+                     const unsigned char *src,
+                     apr_size_t src_len)
+{
+  const unsigned char *ip = src;
+  const unsigned char *in_end = src + src_len;
+  unsigned char *op = dst;
+  unsigned char *out_end = dst + dst_len;
+
+  while (ip < in_end)
+    {
+      unsigned int token = *ip++;
+      apr_size_t len = token >> 4;
+      apr_size_t distance;
+      const unsigned char *ref;
+
+      /* Literals */
+      if (len == 15)
+        {
+          unsigned int c;
+          do
+            {
+              if (ip == in_end || len > dst_len)
+                return FALSE;
+
+              c = *ip++;
+              len += c;
+            }
+          while (c == 255);
+        }
+
+      if (len > (apr_size_t)(in_end - ip) || len > (apr_size_t)(out_end - op))
+        return FALSE;
+
+      memcpy(op, ip, len);
+      op += len;
+      ip += len;
+
+      /* The last sequence has no match part. */
+      if (ip == in_end)
+        break;
+
+      /* Match */
+      if (in_end - ip < 2)
+        return FALSE;
+
+      distance = ip[0] | ((apr_size_t)ip[1] << 8);
+      ip += 2;
+      if (distance == 0 || distance > (apr_size_t)(op - dst))
+        return FALSE;
+
+      len = token & 15;
+      if (len == 15)
+        {
+          unsigned int c;
+          do
+            {
+              if (ip == in_end || len > dst_len)
+                return FALSE;
+
+              c = *ip++;
+              len += c;
+            }
+          while (c == 255);
+        }
+
+      len += LZ4_MIN_MATCH;
+      if (len > (apr_size_t)(out_end - op))
+        return FALSE;
+
+      /* Source and target may overlap, so copy byte by byte. */
+      ref = op - distance;
+      while (len--)
+        *op++ = *ref++;
+    }
+
+  return op == out_end;
+}
+
+svn_error_t *
+svn__compress_lz4(const void *data, apr_size_t len,
+                  svn_stringbuf_t *out)
+{
+  apr_size_t hdrlen;
+  unsigned char buf[SVN__MAX_ENCODED_UINT_LEN], *p;
+
+  svn_stringbuf_setempty(out);
+  p = svn__encode_uint(buf, (apr_uint64_t)len);
+  svn_stringbuf_appendbytes(out, (const char *)buf, p - buf);
+
+  hdrlen = out->len;
+
+  /* Short buffers don't compress and very large ones are beyond what we
+     want to handle in a single block.  Store them as-is. */
+  if (len < MIN_COMPRESS_SIZE || len > LZ4_MAX_INPUT_SIZE)
+    {
+      svn_stringbuf_appendbytes(out, data, len);
+    }
+  else
+    {
+      apr_size_t compressed_len;
+
+      svn_stringbuf_ensure(out, hdrlen + LZ4_COMPRESS_BOUND(len));
+      compressed_len = lz4_compress_block((unsigned char *)out->data + hdrlen,
+                                          data, len);
+
+      /* Compression didn't help :(, just append the original text */
+      if (compressed_len >= len)
+        {
+          svn_stringbuf_appendbytes(out, data, len);
+          return SVN_NO_ERROR;
+        }
+
+      out->len = hdrlen + compressed_len;
+      out->data[out->len] = 0;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn__decompress_lz4(const void *data, apr_size_t len,
+                    svn_stringbuf_t *out,
+                    apr_size_t limit)
+{
+  apr_size_t orig_len;
+  apr_uint64_t size;
+  const unsigned char *in = data;
+  const unsigned char *oldplace = in;
+
+  /* First thing in the string is the original length.  */
+  if (len == 0)
+    return svn_error_create(SVN_ERR_SVNDIFF_INVALID_COMPRESSED_DATA, NULL,
+                            _("Decompression of lz4 compressed data failed: "
+                              "no size"));
+
+  in = svn__decode_uint(&size, in, in + len);
+  if (in == NULL || size > APR_SIZE_MAX)
+    return svn_error_create(SVN_ERR_SVNDIFF_INVALID_COMPRESSED_DATA, NULL,
+                            _("Decompression of lz4 compressed data failed: "
+                              "no size"));
+
+  orig_len = (apr_size_t)size;
+  if (orig_len > limit)
+    return svn_error_create(SVN_ERR_SVNDIFF_INVALID_COMPRESSED_DATA, NULL,
+                            _("Decompression of lz4 compressed data failed: "
+                              "size too large"));
+
+  /* We need to subtract the size of the encoded original length off the
+     still remaining input length.  */
+  len -= (in - oldplace);
+  svn_stringbuf_ensure(out, orig_len);
+  if (len == orig_len)
+    {
+      memcpy(out->data, in, orig_len);
+    }
+  else if (! lz4_decompress_block((unsigned char *)out->data, orig_len,
+                                  in, len))
+    {
+      return svn_error_create(SVN_ERR_SVNDIFF_INVALID_COMPRESSED_DATA, NULL,
+                              _("Decompression of lz4 compressed data "
+                                "failed"));
+    }
+
+  out->data[orig_len] = 0;
+  out->len = orig_len;
+
+  return SVN_NO_ERROR;
+}
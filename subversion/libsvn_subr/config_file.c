@@ -1150,9 +1150,18 @@ svn_config_ensure(const char *config_dir, apr_pool_t *pool)
         "###   http-compression           Whether to compress HTTP requests" NL
         "###   http-max-connections       Maximum number of parallel server" NL
         "###                              connections to use for any given"  NL
-        "###                              HTTP operation."                   NL
+        "###                              HTTP operation (at most 32)."      NL
+        "###                              Updates only open as many of them" NL
+        "###                              as increase the throughput."       NL
         "###   http-chunked-requests      Whether to use chunked transfer"   NL
         "###                              encoding for HTTP requests body."  NL
+        "###   http-commit-pipeline-size  Maximum number of kilobytes of"    NL
+        "###                              file changes to send ahead of the" NL
+        "###                              server's responses during HTTP"    NL
+        "###                              commits (0 to disable)."           NL
+        "###   http-binary-frames         Whether to let capable servers"    NL
+        "###                              send update and replay responses"  NL
+        "###                              as binary frames instead of XML."  NL
         "###   ssl-authority-files        List of files, each of a trusted CA"
                                                                              NL
         "###   ssl-trust-default-ca       Trust the system 'default' CAs"    NL
@@ -1166,6 +1175,9 @@ svn_config_ensure(const char *config_dir, apr_pool_t *pool)
         "###   http-bulk-updates          Whether to request bulk update"    NL
         "###                              responses or to fetch each file"   NL
         "###                              in an individual request. "        NL
+        "###   svn-fetch-connections      Number of additional connections"  NL
+        "###                              to fetch file contents over during"NL
+        "###                              svn:// updates (0 to disable)."    NL
         "###   store-passwords            Specifies whether passwords used"  NL
         "###                              to authenticate against a"         NL
         "###                              Subversion server may be cached"   NL
@@ -1552,6 +1564,18 @@ svn_config_ensure(const char *config_dir, apr_pool_t *pool)
         "### returning an error.  The default is 10000, i.e. 10 seconds."    NL
         "### Longer values may be useful when exclusive locking is enabled." NL
         "# busy-timeout = 10000"                                             NL
+        "### Set to the path of a directory to share pristine file"          NL
+        "### contents between all working copies of this machine.  Before"   NL
+        "### fetching a file's full text from the server, the client looks"  NL
+        "### it up there by its SHA-1 checksum; newly installed pristines"   NL
+        "### get hard-linked (or copied) into that directory.  The"          NL
+        "### directory must be writable by all users sharing it.  The"       NL
+        "### default is not to use a shared cache."                          NL
+        "# pristine-cache-dir = /var/cache/svn-pristine"                     NL
+        "### Set the size limit of the shared pristine cache in MB.  The"    NL
+        "### least recently used contents get removed when it is exceeded."  NL
+        "### The default is 1024, i.e. 1 GB."                                NL
+        "# pristine-cache-size = 1024"                                       NL
         ;
 
       err = svn_io_file_open(&f, path,
@@ -0,0 +1,389 @@
+/* frames.c --- length-prefixed binary frames for streamed editor drives
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <string.h>
+
+#include "svn_pools.h"
+#include "svn_private_config.h"
+
+#include "private/svn_error_private.h"
+#include "private/svn_frames.h"
+#include "private/svn_subr_private.h"
+
+
+struct svn_frames__parser_t
+{
+  /* The header expected at the start of the stream. */
+  const char *magic;
+  apr_size_t magic_len;
+
+  /* Receives all frames but error and end frames. */
+  svn_frames__handler_t handler;
+  void *baton;
+
+  /* Data received but not processed yet. */
+  svn_stringbuf_t *buffer;
+
+  /* Did we get past the MAGIC already? */
+  svn_boolean_t magic_seen;
+
+  /* Did we see the SVN_FRAMES__END frame? */
+  svn_boolean_t done;
+
+  /* Error chain sent by SVN_FRAMES__ERROR frames. */
+  svn_error_t *err;
+
+  /* Allocates ERR. */
+  apr_pool_t *pool;
+};
+
+/* Return an error about a malformed frame stream. */
+static svn_error_t *
+malformed_error(void)
+{
+  return svn_error_create(SVN_ERR_STREAM_MALFORMED_DATA, NULL,
+                          _("Malformed binary frame stream"));
+}
+
+void
+svn_frames__append_string(svn_stringbuf_t *payload,
+                          const char *data,
+                          apr_size_t len)
+{
+  unsigned char length[SVN__MAX_ENCODED_UINT_LEN];
+  unsigned char *end = svn__encode_uint(length, data ? len : 0);
+
+  svn_stringbuf_appendbytes(payload, (const char *)length, end - length);
+  if (data)
+    svn_stringbuf_appendbytes(payload, data, len);
+}
+
+void
+svn_frames__append_cstring(svn_stringbuf_t *payload,
+                           const char *str)
+{
+  svn_frames__append_string(payload, str, str ? strlen(str) : 0);
+}
+
+void
+svn_frames__append_int(svn_stringbuf_t *payload,
+                       apr_int64_t val)
+{
+  unsigned char number[SVN__MAX_ENCODED_UINT_LEN];
+  unsigned char *end = svn__encode_int(number, val);
+
+  svn_stringbuf_appendbytes(payload, (const char *)number, end - number);
+}
+
+svn_error_t *
+svn_frames__write(svn_stream_t *out,
+                  char op,
+                  const char *payload,
+                  apr_size_t len)
+{
+  unsigned char header[1 + SVN__MAX_ENCODED_UINT_LEN];
+  apr_size_t header_len;
+
+  header[0] = (unsigned char)op;
+  header_len = svn__encode_uint(header + 1, len) - header;
+
+  SVN_ERR(svn_stream_write(out, (const char *)header, &header_len));
+  if (len)
+    SVN_ERR(svn_stream_write(out, payload, &len));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_frames__write_error(svn_stream_t *out,
+                        const svn_error_t *err,
+                        apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *payload = svn_stringbuf_create_empty(scratch_pool);
+
+  for (; err; err = err->child)
+    {
+      char errbuf[256];
+      const char *message;
+
+      if (svn_error__is_tracing_link(err))
+        continue;
+
+      message = err->message;
+      if (!message)
+        message = svn_err_best_message(err, errbuf, sizeof(errbuf));
+
+      svn_stringbuf_setempty(payload);
+      svn_frames__append_int(payload, err->apr_err);
+      svn_frames__append_cstring(payload, message);
+      SVN_ERR(svn_frames__write(out, SVN_FRAMES__ERROR,
+                                payload->data, payload->len));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Baton for the stream returned by svn_frames__data_stream(). */
+typedef struct data_stream_baton_t
+{
+  svn_stream_t *out;
+  char data_op;
+  char close_op;
+} data_stream_baton_t;
+
+/* Implements svn_write_fn_t for svn_frames__data_stream(). */
+static svn_error_t *
+data_stream_write(void *baton,
+                  const char *data,
+                  apr_size_t *len)
+{
+  data_stream_baton_t *dsb = baton;
+
+  return svn_error_trace(svn_frames__write(dsb->out, dsb->data_op,
+                                           data, *len));
+}
+
+/* Implements svn_close_fn_t for svn_frames__data_stream(). */
+static svn_error_t *
+data_stream_close(void *baton)
+{
+  data_stream_baton_t *dsb = baton;
+
+  if (dsb->close_op)
+    SVN_ERR(svn_frames__write(dsb->out, dsb->close_op, NULL, 0));
+
+  return SVN_NO_ERROR;
+}
+
+svn_stream_t *
+svn_frames__data_stream(svn_stream_t *out,
+                        char data_op,
+                        char close_op,
+                        apr_pool_t *result_pool)
+{
+  data_stream_baton_t *dsb = apr_palloc(result_pool, sizeof(*dsb));
+  svn_stream_t *stream = svn_stream_create(dsb, result_pool);
+
+  dsb->out = out;
+  dsb->data_op = data_op;
+  dsb->close_op = close_op;
+
+  svn_stream_set_write(stream, data_stream_write);
+  svn_stream_set_close(stream, data_stream_close);
+
+  return stream;
+}
+
+svn_error_t *
+svn_frames__read_string(const svn_string_t **str,
+                        const unsigned char **p,
+                        const unsigned char *end,
+                        apr_pool_t *result_pool)
+{
+  apr_uint64_t len;
+  const unsigned char *data = svn__decode_uint(&len, *p, end);
+
+  if (!data || len > (apr_uint64_t)(end - data))
+    return svn_error_trace(malformed_error());
+
+  *str = svn_string_ncreate((const char *)data, (apr_size_t)len,
+                            result_pool);
+  *p = data + len;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_frames__read_cstring(const char **str,
+                         const unsigned char **p,
+                         const unsigned char *end,
+                         apr_pool_t *result_pool)
+{
+  const svn_string_t *value;
+
+  SVN_ERR(svn_frames__read_string(&value, p, end, result_pool));
+  *str = value->len ? value->data : NULL;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_frames__read_int(apr_int64_t *val,
+                     const unsigned char **p,
+                     const unsigned char *end)
+{
+  const unsigned char *next = svn__decode_int(val, *p, end);
+
+  if (!next)
+    return svn_error_trace(malformed_error());
+
+  *p = next;
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_frames__read_rev(svn_revnum_t *rev,
+                     const unsigned char **p,
+                     const unsigned char *end)
+{
+  apr_int64_t val;
+
+  SVN_ERR(svn_frames__read_int(&val, p, end));
+  *rev = (svn_revnum_t)val;
+
+  return SVN_NO_ERROR;
+}
+
+svn_frames__parser_t *
+svn_frames__parser_create(const char *magic,
+                          apr_size_t magic_len,
+                          svn_frames__handler_t handler,
+                          void *baton,
+                          apr_pool_t *result_pool)
+{
+  svn_frames__parser_t *parser = apr_pcalloc(result_pool, sizeof(*parser));
+
+  parser->magic = magic;
+  parser->magic_len = magic_len;
+  parser->handler = handler;
+  parser->baton = baton;
+  parser->buffer = svn_stringbuf_create_empty(result_pool);
+  parser->pool = result_pool;
+
+  return parser;
+}
+
+/* Process the frame OP of PARSER with the payload starting at P and
+   ending at END.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+process_frame(svn_frames__parser_t *parser,
+              char op,
+              const unsigned char *p,
+              const unsigned char *end,
+              apr_pool_t *scratch_pool)
+{
+  /* Nothing may follow the end of the stream and only more errors may
+     follow an error. */
+  if (parser->done || (parser->err && op != SVN_FRAMES__ERROR))
+    return svn_error_trace(malformed_error());
+
+  if (op == SVN_FRAMES__ERROR)
+    {
+      apr_int64_t apr_err;
+      const char *message;
+      svn_error_t *err;
+
+      SVN_ERR(svn_frames__read_int(&apr_err, &p, end));
+      SVN_ERR(svn_frames__read_cstring(&message, &p, end, parser->pool));
+
+      /* The sender starts with the outermost error. */
+      err = svn_error_create((apr_status_t)apr_err, NULL, message);
+      if (parser->err)
+        svn_error_compose(parser->err, err);
+      else
+        parser->err = err;
+    }
+  else if (op == SVN_FRAMES__END)
+    {
+      parser->done = TRUE;
+    }
+  else
+    {
+      SVN_ERR(parser->handler(parser->baton, op, p, end, scratch_pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_frames__parser_feed(svn_frames__parser_t *parser,
+                        const char *data,
+                        apr_size_t len,
+                        apr_pool_t *scratch_pool)
+{
+  const unsigned char *start;
+  const unsigned char *end;
+  const unsigned char *p;
+  apr_pool_t *iterpool;
+
+  svn_stringbuf_appendbytes(parser->buffer, data, len);
+  start = (const unsigned char *)parser->buffer->data;
+  end = start + parser->buffer->len;
+  p = start;
+
+  if (!parser->magic_seen)
+    {
+      if (parser->buffer->len < parser->magic_len)
+        return SVN_NO_ERROR;
+
+      if (memcmp(p, parser->magic, parser->magic_len) != 0)
+        return svn_error_trace(malformed_error());
+
+      p += parser->magic_len;
+      parser->magic_seen = TRUE;
+    }
+
+  iterpool = svn_pool_create(scratch_pool);
+  while (p < end)
+    {
+      apr_uint64_t frame_len;
+      const unsigned char *payload = svn__decode_uint(&frame_len, p + 1, end);
+
+      /* Incomplete frame?  Wait for more data. */
+      if (!payload || frame_len > (apr_uint64_t)(end - payload))
+        break;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(process_frame(parser, (char)*p, payload,
+                            payload + frame_len, iterpool));
+      p = payload + frame_len;
+    }
+  svn_pool_destroy(iterpool);
+
+  svn_stringbuf_leftchop(parser->buffer, p - start);
+
+  return SVN_NO_ERROR;
+}
+
+svn_boolean_t
+svn_frames__parser_done(svn_frames__parser_t *parser)
+{
+  return parser->done;
+}
+
+svn_error_t *
+svn_frames__parser_finish(svn_frames__parser_t *parser)
+{
+  /* Errors reported by the sender take precedence. */
+  if (parser->err)
+    {
+      svn_error_t *err = parser->err;
+
+      parser->err = NULL;
+      return svn_error_trace(err);
+    }
+
+  if (parser->buffer->len || !parser->done)
+    return svn_error_trace(malformed_error());
+
+  return SVN_NO_ERROR;
+}
@@ -0,0 +1,262 @@
+/*
+ * lru_dir.c: size-limited directories of cache files with LRU eviction
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* The total size of the cache files is kept in a size stamp file at the
+ * top of the cache directory, which gets updated under a file lock with
+ * every addition.  Only when that total exceeds the limit, we scan the
+ * directory, remove the least recently used files until the total is 10%
+ * below the limit and record the exact total found by the scan.  So, the
+ * cost of the scans is amortized over many additions and the stamp never
+ * drifts far from the actual size, even if files get removed behind our
+ * back.
+ */
+
+#include <apr_file_io.h>
+
+#include "svn_dirent_uri.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+#include "svn_string.h"
+
+#include "private/svn_io_private.h"
+#include "private/svn_sorts_private.h"
+#include "private/svn_string_private.h"
+
+/* Name of the size stamp file at the top of the cache directory. */
+#define SIZE_STAMP_NAME "lru-size"
+
+/* A file found while scanning the cache directory. */
+typedef struct cache_file_t
+{
+  const char *path;
+  apr_time_t mtime;
+  svn_filesize_t size;
+} cache_file_t;
+
+/* Sort cache_file_t elements by ascending MTIME, i.e. least recently
+   used first. */
+static int
+compare_cache_files(const void *a,
+                    const void *b)
+{
+  const cache_file_t *lhs = a;
+  const cache_file_t *rhs = b;
+
+  if (lhs->mtime == rhs->mtime)
+    return 0;
+
+  return lhs->mtime < rhs->mtime ? -1 : 1;
+}
+
+/* Append all files DEPTH levels below DIR to FILES and add their sizes
+   to *TOTAL.  Allocate the elements in RESULT_POOL. */
+static svn_error_t *
+collect_files(apr_array_header_t *files,
+              apr_int64_t *total,
+              const char *dir,
+              int depth,
+              apr_pool_t *result_pool,
+              apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_hash_t *dirents;
+  apr_hash_index_t *hi;
+
+  SVN_ERR(svn_io_get_dirents3(&dirents, dir, FALSE,
+                              scratch_pool, scratch_pool));
+
+  for (hi = apr_hash_first(scratch_pool, dirents); hi; hi = apr_hash_next(hi))
+    {
+      const char *name = apr_hash_this_key(hi);
+      const svn_io_dirent2_t *dirent = apr_hash_this_val(hi);
+
+      svn_pool_clear(iterpool);
+
+      if (depth > 0 && dirent->kind == svn_node_dir)
+        {
+          SVN_ERR(collect_files(files, total,
+                                svn_dirent_join(dir, name, iterpool),
+                                depth - 1, result_pool, iterpool));
+        }
+      else if (depth == 0 && dirent->kind == svn_node_file)
+        {
+          cache_file_t *file = apr_array_push(files);
+
+          file->path = svn_dirent_join(dir, name, result_pool);
+          file->mtime = dirent->mtime;
+          file->size = dirent->filesize;
+          *total += dirent->filesize;
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Scan the files DEPTH levels below DIR and, if they exceed SIZE_LIMIT
+   bytes, remove the least recently used ones until they are 10% below
+   that.  Set *TOTAL to the size of the remaining files.  Use SCRATCH_POOL
+   for temporary allocations. */
+static svn_error_t *
+evict_files(apr_int64_t *total,
+            const char *dir,
+            int depth,
+            apr_int64_t size_limit,
+            apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool;
+  apr_array_header_t *files;
+  apr_int64_t target = size_limit - size_limit / 10;
+  int i;
+
+  *total = 0;
+  files = apr_array_make(scratch_pool, 0, sizeof(cache_file_t));
+  SVN_ERR(collect_files(files, total, dir, depth,
+                        scratch_pool, scratch_pool));
+  if (*total <= size_limit)
+    return SVN_NO_ERROR;
+
+  svn_sort__array(files, compare_cache_files);
+
+  iterpool = svn_pool_create(scratch_pool);
+  for (i = 0; i < files->nelts && *total > target; ++i)
+    {
+      const cache_file_t *file = &APR_ARRAY_IDX(files, i, cache_file_t);
+      svn_error_t *err;
+
+      svn_pool_clear(iterpool);
+
+      /* Other processes may be evicting concurrently or still have
+         the file open. */
+      err = svn_io_remove_file2(file->path, TRUE, iterpool);
+      if (err)
+        svn_error_clear(err);
+      else
+        *total -= file->size;
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Read the total recorded in the locked size stamp FILE into *TOTAL.
+   Set it to -1 if the stamp is empty or invalid.  Use SCRATCH_POOL for
+   temporary allocations. */
+static svn_error_t *
+read_size_stamp(apr_int64_t *total,
+                apr_file_t *file,
+                apr_pool_t *scratch_pool)
+{
+  char buf[SVN_INT64_BUFFER_SIZE];
+  apr_size_t len;
+  svn_boolean_t hit_eof;
+  svn_error_t *err;
+
+  SVN_ERR(svn_io_file_read_full2(file, buf, sizeof(buf) - 1, &len, &hit_eof,
+                                 scratch_pool));
+  buf[len] = '\0';
+
+  err = svn_cstring_atoi64(total, buf);
+  if (err || *total < 0)
+    {
+      svn_error_clear(err);
+      *total = -1;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Replace the contents of the locked size stamp FILE by TOTAL.  Use
+   SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+write_size_stamp(apr_file_t *file,
+                 apr_int64_t total,
+                 apr_pool_t *scratch_pool)
+{
+  char buf[SVN_INT64_BUFFER_SIZE];
+  apr_size_t len = svn__i64toa(buf, total);
+  apr_off_t offset = 0;
+
+  SVN_ERR(svn_io_file_trunc(file, 0, scratch_pool));
+  SVN_ERR(svn_io_file_seek(file, APR_SET, &offset, scratch_pool));
+
+  return svn_error_trace(svn_io_file_write_full(file, buf, len, NULL,
+                                                scratch_pool));
+}
+
+/* Implement svn_io__lru_dir_add() for the already opened and locked size
+   stamp FILE. */
+static svn_error_t *
+update_size_stamp(apr_file_t *file,
+                  const char *dir,
+                  int depth,
+                  apr_int64_t size_limit,
+                  svn_filesize_t added_size,
+                  apr_pool_t *scratch_pool)
+{
+  apr_int64_t total;
+
+  SVN_ERR(read_size_stamp(&total, file, scratch_pool));
+
+  /* Without a valid stamp, the scan establishes the total. */
+  if (total < 0)
+    SVN_ERR(evict_files(&total, dir, depth, size_limit, scratch_pool));
+  else if ((total += added_size) > size_limit)
+    SVN_ERR(evict_files(&total, dir, depth, size_limit, scratch_pool));
+
+  return svn_error_trace(write_size_stamp(file, total, scratch_pool));
+}
+
+svn_error_t *
+svn_io__lru_dir_add(const char *dir,
+                    int depth,
+                    apr_int64_t size_limit,
+                    svn_filesize_t added_size,
+                    apr_pool_t *scratch_pool)
+{
+  const char *stamp_path = svn_dirent_join(dir, SIZE_STAMP_NAME,
+                                           scratch_pool);
+  apr_file_t *file;
+  svn_error_t *err;
+
+  SVN_ERR_ASSERT(depth > 0);
+
+  SVN_ERR(svn_io_file_open(&file, stamp_path,
+                           APR_READ | APR_WRITE | APR_CREATE | APR_BINARY,
+                           APR_OS_DEFAULT, scratch_pool));
+
+  err = svn_io_lock_open_file(file, TRUE, FALSE, scratch_pool);
+  if (! err)
+    {
+      err = update_size_stamp(file, dir, depth, size_limit, added_size,
+                              scratch_pool);
+      err = svn_error_compose_create(err,
+                                     svn_io_unlock_open_file(file,
+                                                             scratch_pool));
+    }
+
+  return svn_error_compose_create(err,
+                                  svn_io_file_close(file, scratch_pool));
+}
@@ -25,6 +25,7 @@
 
 
 #include <assert.h>
+#include <stdlib.h>
 
 #include "svn_error.h"
 #include "svn_hash.h"
@@ -57,6 +58,13 @@ typedef struct object_ref_t
 
   /* Number of references to this data struct */
   volatile svn_atomic_t ref_count;
+
+  /* In exclusive mode, the next unused instance for the same KEY. */
+  struct object_ref_t *next;
+
+  /* Value of OBJECT_POOL->USE_COUNTER when this instance got handed out
+   * the last time. */
+  apr_uint64_t last_use;
 } object_ref_t;
 
 
@@ -83,6 +91,13 @@ struct svn_object_pool__t
      Hence we must not strictly depend on it. */
   volatile svn_atomic_t unused_count;
 
+  /* whether references to the same object may be handed out to
+   * multiple users at the same time */
+  svn_boolean_t share;
+
+  /* incremented whenever a reference gets handed out */
+  apr_uint64_t use_counter;
+
   /* the root pool owning this structure */
   apr_pool_t *pool;
 };
@@ -102,7 +117,60 @@ object_pool_cleanup(void *baton)
   return APR_SUCCESS;
 }
 
-/* Remove entries from OBJECTS in OBJECT_POOL that have a ref-count of 0.
+/* Remove the unused OBJECT_REF from OBJECT_POOL and destroy it.
+ *
+ * Requires external serialization on OBJECT_POOL.
+ */
+static void
+remove_object(svn_object_pool__t *object_pool,
+              object_ref_t *object_ref)
+{
+  object_ref_t *head = apr_hash_get(object_pool->objects,
+                                    object_ref->key.data,
+                                    object_ref->key.size);
+
+  /* Unlink it from the chain of unused instances for its key.
+   * In shared mode, that chain has only one element. */
+  if (head == object_ref)
+    {
+      apr_hash_set(object_pool->objects, object_ref->key.data,
+                   object_ref->key.size, NULL);
+      if (object_ref->next)
+        apr_hash_set(object_pool->objects, object_ref->next->key.data,
+                     object_ref->next->key.size, object_ref->next);
+    }
+  else
+    {
+      while (head->next != object_ref)
+        head = head->next;
+
+      head->next = object_ref->next;
+    }
+
+  svn_atomic_dec(&object_pool->object_count);
+  svn_atomic_dec(&object_pool->unused_count);
+  svn_pool_destroy(object_ref->pool);
+}
+
+/* Implements the comparison function for qsort.  Order object_ref_t *
+ * by ascending LAST_USE.
+ */
+static int
+compare_last_use(const void *lhs,
+                 const void *rhs)
+{
+  const object_ref_t *lhs_ref = *(const object_ref_t * const *)lhs;
+  const object_ref_t *rhs_ref = *(const object_ref_t * const *)rhs;
+
+  if (lhs_ref->last_use == rhs_ref->last_use)
+    return 0;
+
+  return lhs_ref->last_use < rhs_ref->last_use ? -1 : 1;
+}
+
+/* Remove the least recently used entries with a ref-count of 0 from
+ * OBJECTS in OBJECT_POOL until no more than about half of all entries
+ * are unused.
  *
  * Requires external serialization on OBJECT_POOL.
  */
@@ -110,31 +178,68 @@ static void
 remove_unused_objects(svn_object_pool__t *object_pool)
 {
   apr_pool_t *subpool = svn_pool_create(object_pool->pool);
-
-  /* process all hash buckets */
+  apr_array_header_t *unused
+    = apr_array_make(subpool, (int)object_pool->unused_count,
+                     sizeof(object_ref_t *));
   apr_hash_index_t *hi;
+  int excess;
+  int i;
+
+  /* collect the unused entries from all hash buckets.
+   * Note that we won't hand out new references while access to the
+   * hash is serialized. */
   for (hi = apr_hash_first(subpool, object_pool->objects);
        hi != NULL;
        hi = apr_hash_next(hi))
     {
-      object_ref_t *object_ref = apr_hash_this_val(hi);
+      object_ref_t *object_ref;
+
+      /* in exclusive mode, all objects in the hash are unused */
+      for (object_ref = apr_hash_this_val(hi);
+           object_ref != NULL;
+           object_ref = object_ref->next)
+        if (   !object_pool->share
+            || svn_atomic_read(&object_ref->ref_count) == 0)
+          APR_ARRAY_PUSH(unused, object_ref_t *) = object_ref;
+    }
 
-      /* note that we won't hand out new references while access
-         to the hash is serialized */
-      if (svn_atomic_read(&object_ref->ref_count) == 0)
-        {
-          apr_hash_set(object_pool->objects, object_ref->key.data,
-                       object_ref->key.size, NULL);
-          svn_atomic_dec(&object_pool->object_count);
-          svn_atomic_dec(&object_pool->unused_count);
+  /* Just drop as many of the oldest ones as necessary to get back to
+   * the limit checked by insert(). */
+  excess = 2 * unused->nelts
+         - (int)svn_atomic_read(&object_pool->object_count) - 2;
+  if (excess > 0)
+    {
+      qsort(unused->elts, unused->nelts, unused->elt_size,
+            compare_last_use);
 
-          svn_pool_destroy(object_ref->pool);
-        }
+      for (i = 0; i < excess && i < unused->nelts; ++i)
+        remove_object(object_pool, APR_ARRAY_IDX(unused, i, object_ref_t *));
     }
 
   svn_pool_destroy(subpool);
 }
 
+/* In exclusive mode, make the OBJECT_REF that is no longer in use
+ * available to the next lookup.
+ *
+ * Requires external serialization on OBJECT_REF->OBJECT_POOL.
+ */
+static void
+put_back(object_ref_t *object_ref)
+{
+  svn_object_pool__t *object_pool = object_ref->object_pool;
+
+  object_ref->next = apr_hash_get(object_pool->objects, object_ref->key.data,
+                                  object_ref->key.size);
+
+  /* The hash keeps the key pointer of the first entry.  Make sure it
+   * belongs to the new head of the chain. */
+  apr_hash_set(object_pool->objects, object_ref->key.data,
+               object_ref->key.size, NULL);
+  apr_hash_set(object_pool->objects, object_ref->key.data,
+               object_ref->key.size, object_ref);
+}
+
 /* Cleanup function called when an object_ref_t gets released.
  */
 static apr_status_t
@@ -143,6 +248,30 @@ object_ref_cleanup(void *baton)
   object_ref_t *object = baton;
   svn_object_pool__t *object_pool = object->object_pool;
 
+  /* An exclusively used object is unused now and must become available
+     again.  Objects still in use don't show up in OBJECTS. */
+  if (!object_pool->share)
+    {
+      svn_error_t *err = svn_mutex__lock(object_pool->mutex);
+      if (!err)
+        {
+          svn_atomic_set(&object->ref_count, 0);
+          svn_atomic_inc(&object_pool->unused_count);
+          put_back(object);
+
+          err = svn_mutex__unlock(object_pool->mutex, SVN_NO_ERROR);
+        }
+
+      if (err)
+        {
+          apr_status_t status = err->apr_err;
+          svn_error_clear(err);
+          return status;
+        }
+
+      return APR_SUCCESS;
+    }
+
   /* If we released the last reference to object, there is one more
      unused entry.
 
@@ -172,6 +301,9 @@ add_object_ref(object_ref_t *object_ref,
   if (svn_atomic_inc(&object_ref->ref_count) == 0)
     svn_atomic_dec(&object_ref->object_pool->unused_count);
 
+  /* remember the order of use for remove_unused_objects */
+  object_ref->last_use = ++object_ref->object_pool->use_counter;
+
   /* make sure the reference gets released automatically */
   apr_pool_cleanup_register(pool, object_ref, object_ref_cleanup,
                             apr_pool_cleanup_null);
@@ -192,6 +324,18 @@ lookup(void **object,
 
   if (object_ref)
     {
+      /* Exclusively used objects must be taken out of the container
+       * while in use.  Any other unused instance becomes the new head. */
+      if (!object_pool->share)
+        {
+          apr_hash_set(object_pool->objects, key->data, key->size, NULL);
+          if (object_ref->next)
+            apr_hash_set(object_pool->objects, object_ref->next->key.data,
+                         object_ref->next->key.size, object_ref->next);
+
+          object_ref->next = NULL;
+        }
+
       *object = object_ref->object;
       add_object_ref(object_ref, result_pool);
     }
@@ -215,8 +359,12 @@ insert(void **object,
        apr_pool_t *item_pool,
        apr_pool_t *result_pool)
 {
+  /* Exclusively used objects are never shared, so there is no point in
+   * looking for an existing instance. */
   object_ref_t *object_ref
-    = apr_hash_get(object_pool->objects, key->data, key->size);
+    = object_pool->share
+    ? apr_hash_get(object_pool->objects, key->data, key->size)
+    : NULL;
   if (object_ref)
     {
       /* Destroy the new one and return a reference to the existing one
@@ -236,8 +384,10 @@ insert(void **object,
       object_ref->key.size = key->size;
       memcpy(object_ref->key.data, key->data, key->size);
 
-      apr_hash_set(object_pool->objects, object_ref->key.data,
-                   object_ref->key.size, object_ref);
+      /* exclusively used objects enter the container upon release */
+      if (object_pool->share)
+        apr_hash_set(object_pool->objects, object_ref->key.data,
+                     object_ref->key.size, object_ref);
       svn_atomic_inc(&object_pool->object_count);
 
       /* the new entry is *not* in use yet.
@@ -252,7 +402,7 @@ insert(void **object,
 
   /* limit memory usage */
   if (svn_atomic_read(&object_pool->unused_count) * 2
-      > apr_hash_count(object_pool->objects) + 2)
+      > svn_atomic_read(&object_pool->object_count) + 2)
     remove_unused_objects(object_pool);
 
   return SVN_NO_ERROR;
@@ -263,6 +413,7 @@ insert(void **object,
 
 svn_error_t *
 svn_object_pool__create(svn_object_pool__t **object_pool,
+                        svn_boolean_t share,
                         svn_boolean_t thread_safe,
                         apr_pool_t *pool)
 {
@@ -274,6 +425,7 @@ svn_object_pool__create(svn_object_pool__t **object_pool,
   result = apr_pcalloc(pool, sizeof(*result));
   SVN_ERR(svn_mutex__init(&result->mutex, thread_safe, pool));
 
+  result->share = share;
   result->pool = pool;
   result->objects = svn_hash__make(result->pool);
 
@@ -0,0 +1,421 @@
+/*
+ * ordered_loop.c: run loop iterations in parallel, consume them in order
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <apr_thread_proc.h>
+
+#include "svn_pools.h"
+
+#include "private/svn_mutex.h"
+#include "private/svn_ordered_loop.h"
+#include "private/svn_thread_cond.h"
+
+#include "svn_private_config.h"
+
+/* Run the loop described by the svn_ordered_loop__run() parameters in the
+ * calling thread. */
+static svn_error_t *
+run_sequential(apr_int64_t first_task,
+               apr_int64_t end_task,
+               svn_ordered_loop__init_t init_func,
+               svn_ordered_loop__task_t task_func,
+               svn_ordered_loop__result_t result_func,
+               void *baton,
+               apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  void *thread_baton = NULL;
+  apr_int64_t task;
+
+  if (init_func)
+    SVN_ERR(init_func(&thread_baton, baton, scratch_pool, iterpool));
+
+  for (task = first_task; task < end_task; ++task)
+    {
+      void *result = NULL;
+      svn_error_t *task_err;
+
+      svn_pool_clear(iterpool);
+      task_err = task_func(&result, thread_baton, task, iterpool, iterpool);
+      SVN_ERR(result_func(baton, task, result, task_err, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+#if APR_HAS_THREADS
+
+/* Outcome of a single iteration. */
+typedef struct slot_t
+{
+  /* Set to TRUE once the iteration has been completed. */
+  svn_boolean_t done;
+
+  /* Return value and result of the task function. */
+  svn_error_t *err;
+  void *result;
+
+  /* Root pool containing RESULT. */
+  apr_pool_t *pool;
+} slot_t;
+
+/* State shared between the calling thread and all workers. */
+typedef struct loop_t
+{
+  /* Parameters as passed to svn_ordered_loop__run(). */
+  apr_int64_t end_task;
+  svn_ordered_loop__task_t task_func;
+
+  /* All members below are protected by MUTEX. */
+  svn_mutex__t *mutex;
+
+  /* Broadcast whenever an iteration got completed, a result got consumed
+   * or ABORTED got set. */
+  svn_thread_cond__t *cond;
+
+  /* Next iteration to hand out to a worker. */
+  apr_int64_t next_task;
+
+  /* Oldest iteration whose outcome has not been consumed yet. */
+  apr_int64_t first_unconsumed;
+
+  /* Ring buffer of SLOT_COUNT slots.  Iteration I uses slot
+   * I % SLOT_COUNT. */
+  slot_t *slots;
+  int slot_count;
+
+  /* If set, workers shall not start new iterations. */
+  svn_boolean_t aborted;
+} loop_t;
+
+/* Per-thread data. */
+typedef struct worker_t
+{
+  /* Shared state. */
+  loop_t *loop;
+
+  /* As returned by the svn_ordered_loop__init_t function. */
+  void *thread_baton;
+
+  /* The thread running this worker. */
+  apr_thread_t *thread;
+
+  /* Private, thread-safe root pool. */
+  apr_pool_t *pool;
+
+  /* Fatal error, i.e. any error that is not an iteration result. */
+  svn_error_t *err;
+} worker_t;
+
+/* Wake up all threads waiting on LOOP and tell them to stop.
+ * The caller must hold LOOP->MUTEX. */
+static svn_error_t *
+abort_loop_locked(loop_t *loop)
+{
+  loop->aborted = TRUE;
+  return svn_error_trace(svn_thread_cond__broadcast(loop->cond));
+}
+
+/* Lock LOOP and tell all workers to stop. */
+static svn_error_t *
+abort_loop(loop_t *loop)
+{
+  SVN_MUTEX__WITH_LOCK(loop->mutex, abort_loop_locked(loop));
+  return SVN_NO_ERROR;
+}
+
+/* Set *TASK to the next iteration to execute and *HAVE_TASK to TRUE.
+ * Block while the slot for that iteration is still in use.  If there are
+ * no more iterations or LOOP got aborted, set *HAVE_TASK to FALSE.
+ * The caller must hold LOOP->MUTEX. */
+static svn_error_t *
+claim_task_locked(svn_boolean_t *have_task,
+                  apr_int64_t *task,
+                  loop_t *loop)
+{
+  while (   !loop->aborted
+         && loop->next_task < loop->end_task
+         && loop->next_task >= loop->first_unconsumed + loop->slot_count)
+    SVN_ERR(svn_thread_cond__wait(loop->cond, loop->mutex));
+
+  *have_task = !loop->aborted && loop->next_task < loop->end_task;
+  if (*have_task)
+    *task = loop->next_task++;
+
+  return SVN_NO_ERROR;
+}
+
+/* Store ERR and RESULT allocated in POOL as the outcome of TASK in LOOP
+ * and wake up the calling thread.
+ * The caller must hold LOOP->MUTEX. */
+static svn_error_t *
+store_result_locked(loop_t *loop,
+                    apr_int64_t task,
+                    svn_error_t *err,
+                    void *result,
+                    apr_pool_t *pool)
+{
+  slot_t *slot = &loop->slots[task % loop->slot_count];
+
+  slot->err = err;
+  slot->result = result;
+  slot->pool = pool;
+  slot->done = TRUE;
+
+  return svn_error_trace(svn_thread_cond__broadcast(loop->cond));
+}
+
+/* Execute iterations from WORKER->LOOP until there are none left or the
+ * loop got aborted.  Return fatal errors only. */
+static svn_error_t *
+worker_loop(worker_t *worker)
+{
+  loop_t *loop = worker->loop;
+  apr_pool_t *iterpool = svn_pool_create(worker->pool);
+
+  while (TRUE)
+    {
+      svn_boolean_t have_task;
+      apr_int64_t task;
+      apr_pool_t *result_pool;
+      void *result = NULL;
+      svn_error_t *err;
+
+      SVN_ERR(svn_mutex__lock(loop->mutex));
+      SVN_ERR(svn_mutex__unlock(loop->mutex,
+                                claim_task_locked(&have_task, &task, loop)));
+      if (!have_task)
+        break;
+
+      /* The result will be released by the calling thread, so it must
+         live in a separate root pool. */
+      svn_pool_clear(iterpool);
+      result_pool = svn_pool_create(NULL);
+
+      err = loop->task_func(&result, worker->thread_baton, task,
+                            result_pool, iterpool);
+
+      SVN_ERR(svn_mutex__lock(loop->mutex));
+      SVN_ERR(svn_mutex__unlock(loop->mutex,
+                                store_result_locked(loop, task, err, result,
+                                                    result_pool)));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Thread entry point.  DATA is a worker_t *. */
+static void * APR_THREAD_FUNC
+worker_thread(apr_thread_t *thread, void *data)
+{
+  worker_t *worker = data;
+
+  worker->err = worker_loop(worker);
+
+  /* Don't let the calling thread wait for results that won't come. */
+  if (worker->err)
+    svn_error_clear(abort_loop(worker->loop));
+
+  apr_thread_exit(thread, APR_SUCCESS);
+  return NULL;
+}
+
+/* Wait for the outcome of TASK in LOOP and return its slot in *SLOT.  If
+ * the loop got aborted before that iteration has been completed, set
+ * *SLOT to NULL.  The caller must hold LOOP->MUTEX. */
+static svn_error_t *
+wait_for_result_locked(slot_t **slot,
+                       loop_t *loop,
+                       apr_int64_t task)
+{
+  slot_t *candidate = &loop->slots[task % loop->slot_count];
+
+  while (!candidate->done && !loop->aborted)
+    SVN_ERR(svn_thread_cond__wait(loop->cond, loop->mutex));
+
+  *slot = candidate->done ? candidate : NULL;
+
+  return SVN_NO_ERROR;
+}
+
+/* Mark SLOT, the outcome of the oldest unconsumed iteration in LOOP, as
+ * consumed and wake up any worker waiting for a free slot.
+ * The caller must hold LOOP->MUTEX. */
+static svn_error_t *
+release_result_locked(loop_t *loop,
+                      slot_t *slot)
+{
+  slot->done = FALSE;
+  slot->err = SVN_NO_ERROR;
+  slot->result = NULL;
+  slot->pool = NULL;
+  loop->first_unconsumed++;
+
+  return svn_error_trace(svn_thread_cond__broadcast(loop->cond));
+}
+
+#endif /* APR_HAS_THREADS */
+
+svn_error_t *
+svn_ordered_loop__run(apr_int64_t first_task,
+                      apr_int64_t end_task,
+                      int thread_count,
+                      int window,
+                      svn_ordered_loop__init_t init_func,
+                      svn_ordered_loop__task_t task_func,
+                      svn_ordered_loop__result_t result_func,
+                      void *baton,
+                      apr_pool_t *scratch_pool)
+{
+#if APR_HAS_THREADS
+  loop_t loop = { 0 };
+  worker_t *workers;
+  apr_pool_t *iterpool;
+  svn_error_t *err = SVN_NO_ERROR;
+  apr_int64_t task;
+  int i;
+#endif
+
+  if (first_task >= end_task)
+    return SVN_NO_ERROR;
+
+#if APR_HAS_THREADS
+  if (thread_count > end_task - first_task)
+    thread_count = (int)(end_task - first_task);
+  if (window < thread_count)
+    window = thread_count;
+
+  if (thread_count <= 1)
+#endif
+    return svn_error_trace(run_sequential(first_task, end_task, init_func,
+                                          task_func, result_func, baton,
+                                          scratch_pool));
+
+#if APR_HAS_THREADS
+  loop.end_task = end_task;
+  loop.task_func = task_func;
+  loop.next_task = first_task;
+  loop.first_unconsumed = first_task;
+  loop.slot_count = window;
+  loop.slots = apr_pcalloc(scratch_pool, window * sizeof(*loop.slots));
+
+  SVN_ERR(svn_mutex__init(&loop.mutex, TRUE, scratch_pool));
+  SVN_ERR(svn_thread_cond__create(&loop.cond, scratch_pool));
+
+  iterpool = svn_pool_create(scratch_pool);
+  workers = apr_pcalloc(scratch_pool, thread_count * sizeof(*workers));
+  for (i = 0; i < thread_count; ++i)
+    {
+      apr_status_t status;
+
+      svn_pool_clear(iterpool);
+      workers[i].loop = &loop;
+      workers[i].pool = svn_pool_create(NULL);
+
+      if (init_func)
+        {
+          err = init_func(&workers[i].thread_baton, baton, workers[i].pool,
+                          iterpool);
+          if (err)
+            {
+              svn_pool_destroy(workers[i].pool);
+              workers[i].pool = NULL;
+              break;
+            }
+        }
+
+      status = apr_thread_create(&workers[i].thread, NULL, worker_thread,
+                                 &workers[i], workers[i].pool);
+      if (status)
+        {
+          svn_pool_destroy(workers[i].pool);
+          workers[i].pool = NULL;
+          err = svn_error_wrap_apr(status, _("Can't create thread"));
+          break;
+        }
+    }
+
+  /* Consume the outcomes in order. */
+  for (task = first_task; !err && task < end_task; ++task)
+    {
+      slot_t *slot;
+      svn_error_t *task_err;
+      void *result;
+      apr_pool_t *result_pool;
+
+      svn_pool_clear(iterpool);
+
+      err = svn_mutex__lock(loop.mutex);
+      if (!err)
+        err = svn_mutex__unlock(loop.mutex,
+                                wait_for_result_locked(&slot, &loop, task));
+
+      /* A worker died.  Its error will be returned below. */
+      if (err || !slot)
+        break;
+
+      task_err = slot->err;
+      result = slot->result;
+      result_pool = slot->pool;
+
+      err = svn_mutex__lock(loop.mutex);
+      if (!err)
+        err = svn_mutex__unlock(loop.mutex,
+                                release_result_locked(&loop, slot));
+
+      if (err)
+        svn_error_clear(task_err);
+      else
+        err = result_func(baton, task, result, task_err, iterpool);
+
+      svn_pool_destroy(result_pool);
+    }
+
+  /* Stop and collect all workers. */
+  err = svn_error_compose_create(err, abort_loop(&loop));
+  for (i = 0; i < thread_count && workers[i].pool; ++i)
+    {
+      apr_status_t retval;
+
+      apr_thread_join(&retval, workers[i].thread);
+      err = svn_error_compose_create(err, workers[i].err);
+      svn_pool_destroy(workers[i].pool);
+    }
+
+  /* Discard outcomes that have not been consumed. */
+  for (i = 0; i < loop.slot_count; ++i)
+    if (loop.slots[i].done)
+      {
+        svn_error_clear(loop.slots[i].err);
+        svn_pool_destroy(loop.slots[i].pool);
+        loop.slots[i].done = FALSE;
+      }
+
+  svn_pool_destroy(iterpool);
+
+  return svn_error_trace(err);
+#endif /* APR_HAS_THREADS */
+}
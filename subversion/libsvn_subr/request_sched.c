@@ -0,0 +1,154 @@
+/*
+ * request_sched.c: adaptive scheduling of pipelined requests
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <string.h>
+
+#include "private/svn_request_sched.h"
+
+/* Measurement windows span at least this many completed requests and
+   this much time. */
+#define WINDOW_REQUESTS 16
+#define WINDOW_TIME (APR_USEC_PER_SEC / 4)
+
+/* Upper bounds for the number of requests kept in flight per connection
+   and for the number of concurrent streams on a multiplexed connection,
+   respectively. */
+#define MAX_PIPELINE_DEPTH 32
+#define MAX_STREAMS 100
+
+/* An additional connection must improve the throughput by this many percent
+   to be kept in use.  Once the scheduler stopped adding connections, it
+   starts probing again after the throughput dropped by this many percent. */
+#define GAIN_PERCENT 10
+#define LOSS_PERCENT 25
+
+void
+svn_request_sched__init(svn_request_sched__t *sched,
+                        int max_conns,
+                        svn_boolean_t multiplexed)
+{
+  memset(sched, 0, sizeof(*sched));
+  sched->active_conns = 1;
+  sched->pipeline_depth = SVN_REQUEST_SCHED__MIN_PIPELINE_DEPTH;
+  sched->max_conns = max_conns;
+  sched->multiplexed = multiplexed;
+}
+
+/* Evaluate the measurement window of SCHED, if it is complete at time NOW,
+   and adapt the number of active connections and the pipelining depth
+   accordingly.  IN_FLIGHT is the number of requests not completed yet. */
+static void
+adapt(svn_request_sched__t *sched,
+      apr_time_t now,
+      unsigned int in_flight)
+{
+  apr_interval_time_t elapsed = now - sched->window_start;
+  apr_uint64_t throughput;
+  apr_uint64_t avg_size;
+  apr_uint64_t depth;
+  unsigned int max_depth;
+  svn_boolean_t busy;
+
+  if (sched->window_requests < WINDOW_REQUESTS || elapsed < WINDOW_TIME)
+    return;
+
+  throughput = sched->window_bytes * APR_USEC_PER_SEC / elapsed;
+  avg_size = sched->window_bytes / sched->window_requests;
+  if (avg_size == 0)
+    avg_size = 1;
+
+  /* Were the active connections saturated with requests?  If not, more
+     connections won't help: whatever feeds us the requests is the
+     bottleneck. */
+  busy = (in_flight >= sched->active_conns * sched->pipeline_depth);
+
+  /* Keep enough requests in flight on each connection to cover a full
+     round trip, i.e. the bandwidth-delay product.  The fastest response
+     in the window is our best guess for the round trip time. */
+  depth = 1 + (throughput / sched->active_conns)
+              * sched->window_min_latency / APR_USEC_PER_SEC / avg_size;
+  max_depth = sched->multiplexed ? MAX_STREAMS : MAX_PIPELINE_DEPTH;
+  if (depth < SVN_REQUEST_SCHED__MIN_PIPELINE_DEPTH)
+    depth = SVN_REQUEST_SCHED__MIN_PIPELINE_DEPTH;
+  else if (depth > max_depth)
+    depth = max_depth;
+  sched->pipeline_depth = (unsigned int)depth;
+
+  /* Multiplexing puts all requests on a single connection, so only
+     the number of streams (above) matters there. */
+  if (sched->multiplexed)
+    {
+      /* Nothing to do. */
+    }
+  else if (sched->grown)
+    {
+      /* Revert the last growth if it didn't pay off. */
+      sched->grown = FALSE;
+      if (throughput * 100
+            < sched->reference_throughput * (100 + GAIN_PERCENT))
+        {
+          sched->active_conns--;
+          sched->stalled = TRUE;
+          sched->reference_throughput = throughput;
+        }
+    }
+  else if (sched->stalled)
+    {
+      /* Network conditions changed?  Then probe again. */
+      if (throughput * 100
+            < sched->reference_throughput * (100 - LOSS_PERCENT))
+        sched->stalled = FALSE;
+    }
+  else if (busy && sched->active_conns < sched->max_conns)
+    {
+      sched->active_conns++;
+      sched->grown = TRUE;
+      sched->reference_throughput = throughput;
+    }
+
+  sched->measured = TRUE;
+
+  /* Start the next window. */
+  sched->window_start = now;
+  sched->window_requests = 0;
+  sched->window_bytes = 0;
+  sched->window_min_latency = 0;
+}
+
+void
+svn_request_sched__request_done(svn_request_sched__t *sched,
+                                apr_time_t now,
+                                apr_interval_time_t latency,
+                                apr_uint64_t bytes,
+                                unsigned int in_flight)
+{
+  if (sched->window_start == 0)
+    sched->window_start = now - latency;
+
+  sched->window_requests++;
+  sched->window_bytes += bytes;
+  if (sched->window_min_latency == 0 || latency < sched->window_min_latency)
+    sched->window_min_latency = latency;
+
+  adapt(sched, now, in_flight);
+}
@@ -0,0 +1,457 @@
+/*
+ * sha1.c :  SHA-1 implementation with optional hardware acceleration
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <string.h>
+
+#include <apr_sha1.h>
+
+#include "sha1.h"
+
+/* The x86 SHA extensions compute one SHA-1 block in a few dozen cycles,
+ * i.e. several times faster than APR's portable C code.  We compile the
+ * respective code with a function-specific target attribute and only
+ * call it if CPUID tells us that the CPU supports those instructions.
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) \
+    && (defined(__clang__) || __GNUC__ >= 5)
+#  include <cpuid.h>
+#  include <immintrin.h>
+#  define USE_SHA_NI 1
+#endif
+
+/* Size of a SHA-1 input block in bytes. */
+#define SHA1_BLOCK_SIZE 64
+
+/* APR's update function takes an unsigned int length.  Feed it chunks of
+ * at most this many bytes. */
+#define APR_SHA1_MAX_CHUNK 0x40000000
+
+struct svn_sha1__context_t
+{
+  /* If set, use the SHA extensions and the members below the APR context.
+   * Otherwise, use only the APR context. */
+  svn_boolean_t accelerated;
+
+  /* Portable implementation. */
+  apr_sha1_ctx_t apr_ctx;
+
+#ifdef USE_SHA_NI
+  /* Current hash state H0 .. H4. */
+  apr_uint32_t state[5];
+
+  /* Total number of bytes fed into this context so far. */
+  apr_uint64_t length;
+
+  /* Incomplete input block and the number of bytes used in it. */
+  unsigned char buffer[SHA1_BLOCK_SIZE];
+  apr_size_t buffered;
+#endif
+};
+
+#ifdef USE_SHA_NI
+
+/* Return TRUE, if the CPU supports the SHA extensions as well as the
+ * SSSE3 and SSE4.1 instructions that we use alongside them.
+ */
+static svn_boolean_t
+detect_sha_ni(void)
+{
+  unsigned int eax, ebx, ecx, edx;
+
+  if (__get_cpuid_max(0, NULL) < 7)
+    return FALSE;
+
+  __cpuid(1, eax, ebx, ecx, edx);
+  if (!(ecx & (1u << 9)) || !(ecx & (1u << 19)))
+    return FALSE;
+
+  __cpuid_count(7, 0, eax, ebx, ecx, edx);
+  return (ebx & (1u << 29)) != 0;
+}
+
+/* Process BLOCKS full 64 byte input blocks at DATA and update STATE
+ * accordingly, using the SHA extensions.
+ */
+__attribute__((target("sha,ssse3,sse4.1")))
+static void
+sha1_blocks_ni(apr_uint32_t state[5],
+               const unsigned char *data,
+               apr_size_t blocks)
+{
+  const __m128i byte_swap = _mm_set_epi64x(0x0001020304050607ULL,
+                                           0x08090a0b0c0d0e0fULL);
+  __m128i abcd, e0, e1, abcd_save, e0_save;
+  __m128i msg0, msg1, msg2, msg3;
+
+  abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)state), 0x1b);
+  e0 = _mm_set_epi32((int)state[4], 0, 0, 0);
+
+  for (; blocks > 0; --blocks, data += SHA1_BLOCK_SIZE)
+    {
+      abcd_save = abcd;
+      e0_save = e0;
+
+      /* Rounds 0 to 3 */
+      msg0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 0)),
+                              byte_swap);
+      e0 = _mm_add_epi32(e0, msg0);
+      e1 = abcd;
+      abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+
+      /* Rounds 4 to 7 */
+      msg1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 16)),
+                              byte_swap);
+      e1 = _mm_sha1nexte_epu32(e1, msg1);
+      e0 = abcd;
+      abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+      msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+
+      /* Rounds 8 to 11 */
+      msg2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 32)),
+                              byte_swap);
+      e0 = _mm_sha1nexte_epu32(e0, msg2);
+      e1 = abcd;
+      abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+      msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+      msg0 = _mm_xor_si128(msg0, msg2);
+
+      /* Rounds 12 to 15 */
+      msg3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 48)),
+                              byte_swap);
+      e1 = _mm_sha1nexte_epu32(e1, msg3);
+      e0 = abcd;
+      msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+      abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+      msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+      msg1 = _mm_xor_si128(msg1, msg3);
+
+      /* Rounds 16 to 19 */
+      e0 = _mm_sha1nexte_epu32(e0, msg0);
+      e1 = abcd;
+      msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+      abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+      msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+      msg2 = _mm_xor_si128(msg2, msg0);
+
+      /* Rounds 20 to 23 */
+      e1 = _mm_sha1nexte_epu32(e1, msg1);
+      e0 = abcd;
+      msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+      abcd = _mm_sha1rnds4_epu32(abcd, e1, 1);
+      msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+      msg3 = _mm_xor_si128(msg3, msg1);
+
+      /* Rounds 24 to 27 */
+      e0 = _mm_sha1nexte_epu32(e0, msg2);
+      e1 = abcd;
+      msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+      abcd = _mm_sha1rnds4_epu32(abcd, e0, 1);
+      msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+      msg0 = _mm_xor_si128(msg0, msg2);
+
+      /* Rounds 28 to 31 */
+      e1 = _mm_sha1nexte_epu32(e1, msg3);
+      e0 = abcd;
+      msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+      abcd = _mm_sha1rnds4_epu32(abcd, e1, 1);
+      msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+      msg1 = _mm_xor_si128(msg1, msg3);
+
+      /* Rounds 32 to 35 */
+      e0 = _mm_sha1nexte_epu32(e0, msg0);
+      e1 = abcd;
+      msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+      abcd = _mm_sha1rnds4_epu32(abcd, e0, 1);
+      msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+      msg2 = _mm_xor_si128(msg2, msg0);
+
+      /* Rounds 36 to 39 */
+      e1 = _mm_sha1nexte_epu32(e1, msg1);
+      e0 = abcd;
+      msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+      abcd = _mm_sha1rnds4_epu32(abcd, e1, 1);
+      msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+      msg3 = _mm_xor_si128(msg3, msg1);
+
+      /* Rounds 40 to 43 */
+      e0 = _mm_sha1nexte_epu32(e0, msg2);
+      e1 = abcd;
+      msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+      abcd = _mm_sha1rnds4_epu32(abcd, e0, 2);
+      msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+      msg0 = _mm_xor_si128(msg0, msg2);
+
+      /* Rounds 44 to 47 */
+      e1 = _mm_sha1nexte_epu32(e1, msg3);
+      e0 = abcd;
+      msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+      abcd = _mm_sha1rnds4_epu32(abcd, e1, 2);
+      msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+      msg1 = _mm_xor_si128(msg1, msg3);
+
+      /* Rounds 48 to 51 */
+      e0 = _mm_sha1nexte_epu32(e0, msg0);
+      e1 = abcd;
+      msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+      abcd = _mm_sha1rnds4_epu32(abcd, e0, 2);
+      msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+      msg2 = _mm_xor_si128(msg2, msg0);
+
+      /* Rounds 52 to 55 */
+      e1 = _mm_sha1nexte_epu32(e1, msg1);
+      e0 = abcd;
+      msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+      abcd = _mm_sha1rnds4_epu32(abcd, e1, 2);
+      msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+      msg3 = _mm_xor_si128(msg3, msg1);
+
+      /* Rounds 56 to 59 */
+      e0 = _mm_sha1nexte_epu32(e0, msg2);
+      e1 = abcd;
+      msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+      abcd = _mm_sha1rnds4_epu32(abcd, e0, 2);
+      msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+      msg0 = _mm_xor_si128(msg0, msg2);
+
+      /* Rounds 60 to 63 */
+      e1 = _mm_sha1nexte_epu32(e1, msg3);
+      e0 = abcd;
+      msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+      abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+      msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+      msg1 = _mm_xor_si128(msg1, msg3);
+
+      /* Rounds 64 to 67 */
+      e0 = _mm_sha1nexte_epu32(e0, msg0);
+      e1 = abcd;
+      msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+      abcd = _mm_sha1rnds4_epu32(abcd, e0, 3);
+      msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+      msg2 = _mm_xor_si128(msg2, msg0);
+
+      /* Rounds 68 to 71 */
+      e1 = _mm_sha1nexte_epu32(e1, msg1);
+      e0 = abcd;
+      msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+      abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+      msg3 = _mm_xor_si128(msg3, msg1);
+
+      /* Rounds 72 to 75 */
+      e0 = _mm_sha1nexte_epu32(e0, msg2);
+      e1 = abcd;
+      msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+      abcd = _mm_sha1rnds4_epu32(abcd, e0, 3);
+
+      /* Rounds 76 to 79 */
+      e1 = _mm_sha1nexte_epu32(e1, msg3);
+      e0 = abcd;
+      abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+
+      /* Add this block's result to the state. */
+      e0 = _mm_sha1nexte_epu32(e0, e0_save);
+      abcd = _mm_add_epi32(abcd, abcd_save);
+    }
+
+  _mm_storeu_si128((__m128i *)state, _mm_shuffle_epi32(abcd, 0x1b));
+  state[4] = (apr_uint32_t)_mm_extract_epi32(e0, 3);
+}
+
+/* Feed LEN bytes from DATA into the hardware-accelerated CONTEXT.
+ */
+static void
+update_ni(svn_sha1__context_t *context,
+          const unsigned char *data,
+          apr_size_t len)
+{
+  context->length += len;
+
+  /* Complete a partially filled block first. */
+  if (context->buffered)
+    {
+      apr_size_t to_copy = SHA1_BLOCK_SIZE - context->buffered;
+      if (to_copy > len)
+        to_copy = len;
+
+      memcpy(context->buffer + context->buffered, data, to_copy);
+      context->buffered += to_copy;
+      data += to_copy;
+      len -= to_copy;
+
+      if (context->buffered < SHA1_BLOCK_SIZE)
+        return;
+
+      sha1_blocks_ni(context->state, context->buffer, 1);
+      context->buffered = 0;
+    }
+
+  /* Process full blocks directly from the input. */
+  if (len >= SHA1_BLOCK_SIZE)
+    {
+      apr_size_t blocks = len / SHA1_BLOCK_SIZE;
+      sha1_blocks_ni(context->state, data, blocks);
+      data += blocks * SHA1_BLOCK_SIZE;
+      len -= blocks * SHA1_BLOCK_SIZE;
+    }
+
+  /* Keep the remainder for later. */
+  memcpy(context->buffer, data, len);
+  context->buffered = len;
+}
+
+/* Write the final digest of the hardware-accelerated CONTEXT to DIGEST.
+ */
+static void
+finalize_ni(unsigned char *digest,
+            svn_sha1__context_t *context)
+{
+  unsigned char padding[2 * SHA1_BLOCK_SIZE];
+  apr_uint64_t bits = context->length * 8;
+  apr_size_t pad_len;
+  int i;
+
+  /* Append a 1 bit, zeros up to 56 mod 64 bytes and the message length
+   * in bits as big-endian 64 bit number. */
+  pad_len = context->buffered < SHA1_BLOCK_SIZE - 8
+          ? SHA1_BLOCK_SIZE - 8 - context->buffered
+          : 2 * SHA1_BLOCK_SIZE - 8 - context->buffered;
+
+  memset(padding, 0, pad_len);
+  padding[0] = 0x80;
+  for (i = 0; i < 8; ++i)
+    padding[pad_len + i] = (unsigned char)(bits >> (56 - 8 * i));
+
+  update_ni(context, padding, pad_len + 8);
+
+  for (i = 0; i < 5; ++i)
+    {
+      digest[4 * i + 0] = (unsigned char)(context->state[i] >> 24);
+      digest[4 * i + 1] = (unsigned char)(context->state[i] >> 16);
+      digest[4 * i + 2] = (unsigned char)(context->state[i] >> 8);
+      digest[4 * i + 3] = (unsigned char)(context->state[i]);
+    }
+}
+
+#endif /* USE_SHA_NI */
+
+svn_boolean_t
+svn_sha1__is_accelerated(void)
+{
+#ifdef USE_SHA_NI
+  /* 0 = not checked yet, 1 = not supported, 2 = supported.
+   * Concurrent initialization is harmless as all threads come to the
+   * same conclusion. */
+  static volatile int sha_ni_status = 0;
+
+  if (sha_ni_status == 0)
+    sha_ni_status = detect_sha_ni() ? 2 : 1;
+
+  return sha_ni_status == 2;
+#else
+  return FALSE;
+#endif
+}
+
+/* Initialize the pre-allocated CONTEXT.
+ */
+static void
+context_init(svn_sha1__context_t *context)
+{
+  context->accelerated = svn_sha1__is_accelerated();
+
+#ifdef USE_SHA_NI
+  if (context->accelerated)
+    {
+      context->state[0] = 0x67452301;
+      context->state[1] = 0xefcdab89;
+      context->state[2] = 0x98badcfe;
+      context->state[3] = 0x10325476;
+      context->state[4] = 0xc3d2e1f0;
+      context->length = 0;
+      context->buffered = 0;
+      return;
+    }
+#endif
+
+  apr_sha1_init(&context->apr_ctx);
+}
+
+svn_sha1__context_t *
+svn_sha1__context_create(apr_pool_t *pool)
+{
+  svn_sha1__context_t *context = apr_palloc(pool, sizeof(*context));
+  context_init(context);
+
+  return context;
+}
+
+void
+svn_sha1__update(svn_sha1__context_t *context,
+                 const void *data,
+                 apr_size_t len)
+{
+  const char *input = data;
+
+#ifdef USE_SHA_NI
+  if (context->accelerated)
+    {
+      update_ni(context, data, len);
+      return;
+    }
+#endif
+
+  while (len > APR_SHA1_MAX_CHUNK)
+    {
+      apr_sha1_update(&context->apr_ctx, input, APR_SHA1_MAX_CHUNK);
+      input += APR_SHA1_MAX_CHUNK;
+      len -= APR_SHA1_MAX_CHUNK;
+    }
+
+  apr_sha1_update(&context->apr_ctx, input, (unsigned int)len);
+}
+
+void
+svn_sha1__finalize(unsigned char *digest,
+                   svn_sha1__context_t *context)
+{
+#ifdef USE_SHA_NI
+  if (context->accelerated)
+    {
+      finalize_ni(digest, context);
+      return;
+    }
+#endif
+
+  apr_sha1_final(digest, &context->apr_ctx);
+}
+
+void
+svn_sha1__digest(unsigned char *digest,
+                 const void *data,
+                 apr_size_t len)
+{
+  svn_sha1__context_t context;
+
+  context_init(&context);
+  svn_sha1__update(&context, data, len);
+  svn_sha1__finalize(digest, &context);
+}
@@ -0,0 +1,87 @@
+/*
+ * shm.c: memory and mutexes shared with forked child processes
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <apr_shm.h>
+
+#include "svn_private_config.h"
+#include "private/svn_shm.h"
+
+svn_error_t *
+svn_shm__alloc(void **result,
+               apr_size_t size,
+               apr_pool_t *pool)
+{
+#if APR_HAS_SHARED_MEMORY
+  apr_shm_t *shm;
+  apr_status_t status;
+
+  /* Anonymous shared memory gets inherited by forked processes and is
+   * zero-initialized. */
+  status = apr_shm_create(&shm, size, NULL, pool);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create shared memory"));
+
+  *result = apr_shm_baseaddr_get(shm);
+  return SVN_NO_ERROR;
+#else
+  return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                          _("Shared memory is not supported on this "
+                            "platform"));
+#endif
+}
+
+svn_error_t *
+svn_shm__mutex_create(apr_global_mutex_t **mutex,
+                      apr_pool_t *pool)
+{
+#if APR_HAS_PROC_PTHREAD_SERIALIZE
+  /* Other mechanisms would need a lock file, which we don't have, and
+   * some of them would silently stop working in child processes that
+   * fail to re-open it.  So, don't fall back to them. */
+  apr_status_t status = apr_global_mutex_create(mutex, NULL,
+                                                APR_LOCK_PROC_PTHREAD, pool);
+  if (status)
+    return svn_error_wrap_apr(status,
+                              _("Can't create process-shared mutex"));
+
+  return SVN_NO_ERROR;
+#else
+  return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                          _("Process-shared mutexes are not supported on "
+                            "this platform"));
+#endif
+}
+
+svn_error_t *
+svn_shm__mutex_child_init(apr_global_mutex_t *mutex,
+                          apr_pool_t *pool)
+{
+  /* APR only updates the process-local parts of the mutex object, so
+   * working on a copy of the pointer is safe. */
+  apr_status_t status = apr_global_mutex_child_init(&mutex, NULL, pool);
+  if (status)
+    return svn_error_wrap_apr(status,
+                              _("Can't re-attach process-shared mutex"));
+
+  return SVN_NO_ERROR;
+}
@@ -37,6 +37,19 @@
 
 #include "svn_private_config.h"
 
+/* SIMD versions of the common prefix / suffix scans.  SSE2 is part of the
+ * x86-64 baseline while AVX2 gets selected at runtime if the CPU supports
+ * it.  Other platforms use the word-wise scalar scans.
+ */
+#if defined(__GNUC__) && defined(__SSE2__) && SVN_UNALIGNED_ACCESS_IS_OK
+#  include <emmintrin.h>
+#  define USE_SSE2 1
+#  if defined(__x86_64__) && (defined(__clang__) || __GNUC__ >= 5)
+#    include <immintrin.h>
+#    define USE_AVX2 1
+#  endif
+#endif
+
 
 
 /* Allocate the space for a memory buffer from POOL.
@@ -1495,6 +1508,126 @@ svn_string__similarity(const svn_string_t *stringa,
     return SVN_STRING__SIM_RANGE_MAX;
 }
 
+#ifdef USE_SSE2
+
+#ifdef USE_AVX2
+
+/* Like match_length_simd() but compare 32 bytes at a time using AVX2.
+ * Must only be called if the CPU supports AVX2.
+ */
+__attribute__((target("avx2")))
+static apr_size_t
+match_length_avx2(const char *a,
+                  const char *b,
+                  apr_size_t max_len)
+{
+  apr_size_t pos;
+
+  for (pos = 0; max_len - pos >= 32; pos += 32)
+    {
+      __m256i va = _mm256_loadu_si256((const __m256i *)(a + pos));
+      __m256i vb = _mm256_loadu_si256((const __m256i *)(b + pos));
+      unsigned int equal
+        = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb));
+
+      if (equal != 0xffffffffu)
+        return pos + __builtin_ctz(~equal);
+    }
+
+  return pos;
+}
+
+/* Like reverse_match_length_simd() but compare 32 bytes at a time using
+ * AVX2.  Must only be called if the CPU supports AVX2.
+ */
+__attribute__((target("avx2")))
+static apr_size_t
+reverse_match_length_avx2(const char *a,
+                          const char *b,
+                          apr_size_t max_len)
+{
+  apr_size_t pos;
+
+  for (pos = 0; max_len - pos >= 32; pos += 32)
+    {
+      __m256i va = _mm256_loadu_si256((const __m256i *)(a - pos - 32));
+      __m256i vb = _mm256_loadu_si256((const __m256i *)(b - pos - 32));
+      unsigned int equal
+        = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb));
+
+      if (equal != 0xffffffffu)
+        return pos + __builtin_clz(~equal);
+    }
+
+  return pos;
+}
+
+#endif /* USE_AVX2 */
+
+/* Compare A and B in chunks of up to MAX_LEN bytes and return the position
+ * of the first mismatch.  Trailing bytes that do not fill a whole chunk
+ * are not compared, i.e. the caller has to continue the scan from the
+ * position returned.
+ */
+static APR_INLINE apr_size_t
+match_length_simd(const char *a,
+                  const char *b,
+                  apr_size_t max_len)
+{
+  apr_size_t pos = 0;
+
+#ifdef USE_AVX2
+  if (max_len >= 32 && __builtin_cpu_supports("avx2"))
+    return match_length_avx2(a, b, max_len);
+#endif
+
+  for (; max_len - pos >= 16; pos += 16)
+    {
+      __m128i va = _mm_loadu_si128((const __m128i *)(a + pos));
+      __m128i vb = _mm_loadu_si128((const __m128i *)(b + pos));
+      unsigned int equal
+        = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb));
+
+      if (equal != 0xffff)
+        return pos + __builtin_ctz(~equal);
+    }
+
+  return pos;
+}
+
+/* Compare the MAX_LEN bytes before A and B backwards in chunks and return
+ * the number of matching bytes found.  Like match_length_simd(), leftover
+ * bytes that do not fill a whole chunk are left to the caller.
+ */
+static APR_INLINE apr_size_t
+reverse_match_length_simd(const char *a,
+                          const char *b,
+                          apr_size_t max_len)
+{
+  apr_size_t pos = 0;
+
+#ifdef USE_AVX2
+  if (max_len >= 32 && __builtin_cpu_supports("avx2"))
+    return reverse_match_length_avx2(a, b, max_len);
+#endif
+
+  for (; max_len - pos >= 16; pos += 16)
+    {
+      __m128i va = _mm_loadu_si128((const __m128i *)(a - pos - 16));
+      __m128i vb = _mm_loadu_si128((const __m128i *)(b - pos - 16));
+      unsigned int equal
+        = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb));
+
+      /* The highest bit corresponds to the last byte of the chunk. */
+      if (equal != 0xffff)
+        return pos + __builtin_clz((~equal) << 16);
+    }
+
+  return pos;
+}
+
+#endif /* USE_SSE2 */
+
 apr_size_t
 svn_cstring__match_length(const char *a,
                           const char *b,
@@ -1502,7 +1635,11 @@ svn_cstring__match_length(const char *a,
 {
   apr_size_t pos = 0;
 
-#if SVN_UNALIGNED_ACCESS_IS_OK
+#if defined(USE_SSE2)
+
+  pos = match_length_simd(a, b, max_len);
+
+#elif SVN_UNALIGNED_ACCESS_IS_OK
 
   /* Chunky processing is so much faster ...
    *
@@ -1530,7 +1667,11 @@ svn_cstring__reverse_match_length(const char *a,
 {
   apr_size_t pos = 0;
 
-#if SVN_UNALIGNED_ACCESS_IS_OK
+#if defined(USE_SSE2)
+
+  pos = reverse_match_length_simd(a, b, max_len);
+
+#elif SVN_UNALIGNED_ACCESS_IS_OK
 
   /* Chunky processing is so much faster ...
    *
@@ -856,12 +856,13 @@ svn_wc__get_pristine_contents_by_checksum(svn_stream_t **contents,
                                           apr_pool_t *result_pool,
                                           apr_pool_t *scratch_pool)
 {
-  svn_boolean_t present;
+  svn_boolean_t present = FALSE;
 
   *contents = NULL;
 
-  SVN_ERR(svn_wc__db_pristine_check(&present, wc_ctx->db, wri_abspath,
-                                    checksum, scratch_pool));
+  if (wri_abspath)
+    SVN_ERR(svn_wc__db_pristine_check(&present, wc_ctx->db, wri_abspath,
+                                      checksum, scratch_pool));
 
   if (present)
     {
@@ -875,6 +876,12 @@ svn_wc__get_pristine_contents_by_checksum(svn_stream_t **contents,
       *contents = svn_stream_lazyopen_create(get_pristine_lazyopen_func,
                                              gpl_baton, FALSE, result_pool);
     }
+  else
+    {
+      /* Maybe another working copy on this machine has it. */
+      SVN_ERR(svn_wc__db_pristine_cache_read(contents, wc_ctx->db, checksum,
+                                             result_pool, scratch_pool));
+    }
 
   return SVN_NO_ERROR;
 }
@@ -945,6 +945,20 @@ svn_wc__db_pristine_read(svn_stream_t **contents,
                          apr_pool_t *result_pool,
                          apr_pool_t *scratch_pool);
 
+/* Set *CONTENTS to a readable stream that will yield the text identified
+   by SHA1_CHECKSUM from the machine-wide pristine cache configured for DB.
+   Set *CONTENTS to NULL if that cache is disabled or does not contain the
+   text.  Entries whose contents don't match SHA1_CHECKSUM get removed from
+   the cache and are reported as missing.
+
+   Allocate the stream in RESULT_POOL. */
+svn_error_t *
+svn_wc__db_pristine_cache_read(svn_stream_t **contents,
+                               svn_wc__db_t *db,
+                               const svn_checksum_t *sha1_checksum,
+                               apr_pool_t *result_pool,
+                               apr_pool_t *scratch_pool);
+
 /* Baton for svn_wc__db_pristine_install */
 typedef struct svn_wc__db_install_data_t
                svn_wc__db_install_data_t;
@@ -972,7 +986,9 @@ svn_wc__db_pristine_prepare_install(svn_stream_t **stream,
 
 /* Install the file created via svn_wc__db_pristine_prepare_install() into
    the pristine data store, to be identified by the SHA-1 checksum of its
-   contents, SHA1_CHECKSUM, and whose MD-5 checksum is MD5_CHECKSUM. */
+   contents, SHA1_CHECKSUM, and whose MD-5 checksum is MD5_CHECKSUM.
+   If a machine-wide pristine cache is configured, add the text to it
+   as well. */
 svn_error_t *
 svn_wc__db_pristine_install(svn_wc__db_install_data_t *install_data,
                             const svn_checksum_t *sha1_checksum,
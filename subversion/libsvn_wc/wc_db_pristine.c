@@ -25,11 +25,16 @@
 
 #define SVN_WC__I_AM_WC_DB
 
+#include <apr_file_io.h>
+
 #include "svn_pools.h"
 #include "svn_io.h"
 #include "svn_dirent_uri.h"
+#include "svn_path.h"
+#include "svn_config.h"
 
 #include "private/svn_io_private.h"
+#include "private/svn_subr_private.h"
 
 #include "wc.h"
 #include "wc_db.h"
@@ -40,6 +45,9 @@
 #define PRISTINE_STORAGE_RELPATH "pristine"
 #define PRISTINE_TEMPDIR_RELPATH "tmp"
 
+/* Size limit of the shared pristine cache in MB, if not configured. */
+#define PRISTINE_CACHE_DEFAULT_SIZE 1024
+
 
 
 /* Returns in PRISTINE_ABSPATH a new string allocated from RESULT_POOL,
@@ -350,8 +358,210 @@ pristine_install_txn(svn_sqlite__db_t *sdb,
   return SVN_NO_ERROR;
 }
 
+
+/*** The shared pristine cache.
+ *
+ * Working copies of the same machine may share the texts of their pristine
+ * stores through a common directory.  It uses the same SHA-1 based layout
+ * as the pristine store itself, i.e. CACHE_DIR/XX/XXYYZZ...svn-base, but has
+ * no database.  Entries are hard links to, or copies of, the pristine files
+ * and get added whenever a pristine gets installed.  Their modification
+ * times serve as the LRU timestamps used by svn_io__lru_dir_add() for
+ * evicting entries once the cache grows beyond its size limit.
+ *
+ * Every operation on the cache is best effort: it may be modified
+ * concurrently by other processes and none of its failures must affect
+ * the working copy.  Since anybody may write to it, entries get verified
+ * against their checksums before use.
+ */
+
+svn_error_t *
+svn_wc__db_pristine_cache_init(svn_wc__db_t *db,
+                               svn_config_t *config,
+                               apr_pool_t *result_pool,
+                               apr_pool_t *scratch_pool)
+{
+  const char *cache_dir;
+  apr_int64_t size_mb;
+  svn_error_t *err;
+
+  svn_config_get(config, &cache_dir, SVN_CONFIG_SECTION_WORKING_COPY,
+                 SVN_CONFIG_OPTION_PRISTINE_CACHE_DIR, NULL);
+  if (! cache_dir || ! *cache_dir)
+    return SVN_NO_ERROR;
+
+  err = svn_config_get_int64(config, &size_mb,
+                             SVN_CONFIG_SECTION_WORKING_COPY,
+                             SVN_CONFIG_OPTION_PRISTINE_CACHE_SIZE,
+                             PRISTINE_CACHE_DEFAULT_SIZE);
+  if (err)
+    {
+      svn_error_clear(err);
+      size_mb = PRISTINE_CACHE_DEFAULT_SIZE;
+    }
+
+  /* A zero limit disables the cache. */
+  if (size_mb <= 0)
+    return SVN_NO_ERROR;
+
+  if (size_mb > APR_INT64_MAX / (1024 * 1024))
+    size_mb = APR_INT64_MAX / (1024 * 1024);
+
+  SVN_ERR(svn_dirent_get_absolute(&db->pristine_cache_abspath,
+                                  svn_dirent_internal_style(cache_dir,
+                                                            scratch_pool),
+                                  result_pool));
+  db->pristine_cache_size = size_mb * 1024 * 1024;
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the location of the text identified by SHA1_CHECKSUM in the
+   shared pristine cache of DB, allocated in RESULT_POOL.  If SUBDIR_ABSPATH
+   is not NULL, set it to the directory containing that location. */
+static const char *
+get_cache_fname(const char **subdir_abspath,
+                svn_wc__db_t *db,
+                const svn_checksum_t *sha1_checksum,
+                apr_pool_t *result_pool)
+{
+  const char *hexdigest = svn_checksum_to_cstring(sha1_checksum,
+                                                  result_pool);
+  const char *subdir = svn_dirent_join(db->pristine_cache_abspath,
+                                       apr_pstrndup(result_pool,
+                                                    hexdigest, 2),
+                                       result_pool);
+
+  if (subdir_abspath)
+    *subdir_abspath = subdir;
+
+  return svn_dirent_join(subdir,
+                         apr_pstrcat(result_pool, hexdigest,
+                                     PRISTINE_STORAGE_EXT, SVN_VA_NULL),
+                         result_pool);
+}
+
+svn_error_t *
+svn_wc__db_pristine_cache_read(svn_stream_t **contents,
+                               svn_wc__db_t *db,
+                               const svn_checksum_t *sha1_checksum,
+                               apr_pool_t *result_pool,
+                               apr_pool_t *scratch_pool)
+{
+  const char *cache_abspath;
+  apr_file_t *file;
+  svn_stream_t *stream;
+  svn_checksum_t *actual_checksum;
+  apr_off_t offset = 0;
+  svn_error_t *err;
+
+  *contents = NULL;
+  if (! db->pristine_cache_abspath)
+    return SVN_NO_ERROR;
+
+  SVN_ERR_ASSERT(sha1_checksum->kind == svn_checksum_sha1);
+
+  cache_abspath = get_cache_fname(NULL, db, sha1_checksum, scratch_pool);
+  err = svn_io_file_open(&file, cache_abspath, APR_READ | APR_BUFFERED,
+                         APR_OS_DEFAULT, result_pool);
+  if (err)
+    {
+      /* Missing entries and inaccessible caches simply mean that the
+         caller has to get the text elsewhere. */
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+
+  /* Anybody on this machine may write to the cache, so verify the entry
+     before it makes its way into our pristine store. */
+  stream = svn_stream_from_aprfile2(file, TRUE, scratch_pool);
+  stream = svn_stream_checksummed2(stream, &actual_checksum, NULL,
+                                   svn_checksum_sha1, TRUE, scratch_pool);
+  err = svn_stream_close(stream);
+  if (! err)
+    err = svn_io_file_seek(file, APR_SET, &offset, scratch_pool);
+
+  if (err || ! svn_checksum_match(actual_checksum, sha1_checksum))
+    {
+      svn_error_clear(err);
+      svn_error_clear(svn_io_file_close(file, scratch_pool));
+
+      /* Corrupt entries would only keep us from fetching the text. */
+      if (! err)
+        svn_error_clear(svn_io_remove_file2(cache_abspath, TRUE,
+                                            scratch_pool));
+
+      return SVN_NO_ERROR;
+    }
+
+  *contents = svn_stream_from_aprfile2(file, FALSE, result_pool);
+
+  /* Mark the entry as recently used. */
+  svn_error_clear(svn_io_set_file_affected_time(apr_time_now(),
+                                                cache_abspath,
+                                                scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Add the pristine file PRISTINE_ABSPATH, whose contents are identified by
+   SHA1_CHECKSUM, to the shared pristine cache of DB unless it is already
+   present there.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+pristine_cache_add(svn_wc__db_t *db,
+                   const char *pristine_abspath,
+                   const svn_checksum_t *sha1_checksum,
+                   apr_pool_t *scratch_pool)
+{
+  const char *subdir_abspath;
+  const char *cache_abspath;
+  const char *pristine_path_apr;
+  const char *cache_path_apr;
+  svn_node_kind_t kind;
+  apr_status_t status;
+  apr_finfo_t finfo;
+
+  cache_abspath = get_cache_fname(&subdir_abspath, db, sha1_checksum,
+                                  scratch_pool);
+  SVN_ERR(svn_io_check_path(cache_abspath, &kind, scratch_pool));
+  if (kind != svn_node_none)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_io_make_dir_recursively(subdir_abspath, scratch_pool));
+
+  /* Pristines never change once installed, so a hard link is as good as
+     a copy and much cheaper. */
+  SVN_ERR(svn_path_cstring_from_utf8(&pristine_path_apr, pristine_abspath,
+                                     scratch_pool));
+  SVN_ERR(svn_path_cstring_from_utf8(&cache_path_apr, cache_abspath,
+                                     scratch_pool));
+  status = apr_file_link(pristine_path_apr, cache_path_apr);
+  if (APR_STATUS_IS_EEXIST(status))
+    {
+      /* Somebody else was faster and accounted for it. */
+      return SVN_NO_ERROR;
+    }
+  else if (status)
+    {
+      /* E.g. the cache lives on a different file system.
+         svn_io_copy_file() atomically moves the copy into place. */
+      SVN_ERR(svn_io_copy_file(pristine_abspath, cache_abspath, FALSE,
+                               scratch_pool));
+      SVN_ERR(svn_io_set_file_read_only(cache_abspath, FALSE,
+                                        scratch_pool));
+    }
+
+  SVN_ERR(svn_io_stat(&finfo, cache_abspath, APR_FINFO_SIZE, scratch_pool));
+
+  return svn_error_trace(svn_io__lru_dir_add(db->pristine_cache_abspath, 1,
+                                             db->pristine_cache_size,
+                                             finfo.size, scratch_pool));
+}
+
+
 struct svn_wc__db_install_data_t
 {
+  svn_wc__db_t *db;
   svn_wc__db_wcroot_t *wcroot;
   svn_stream_t *inner_stream;
 };
@@ -379,6 +589,7 @@ svn_wc__db_pristine_prepare_install(svn_stream_t **stream,
   temp_dir_abspath = pristine_get_tempdir(wcroot, scratch_pool, scratch_pool);
 
   *install_data = apr_pcalloc(result_pool, sizeof(**install_data));
+  (*install_data)->db = db;
   (*install_data)->wcroot = wcroot;
 
   SVN_ERR_W(svn_stream__create_for_install(stream,
@@ -388,10 +599,14 @@ svn_wc__db_pristine_prepare_install(svn_stream_t **stream,
 
   (*install_data)->inner_stream = *stream;
 
-  if (md5_checksum)
+  if (md5_checksum && sha1_checksum)
+    *stream = svn_checksum__wrap_write_stream_md5_sha1(md5_checksum,
+                                                       sha1_checksum,
+                                                       *stream, result_pool);
+  else if (md5_checksum)
     *stream = svn_stream_checksummed2(*stream, NULL, md5_checksum,
                                       svn_checksum_md5, FALSE, result_pool);
-  if (sha1_checksum)
+  else if (sha1_checksum)
     *stream = svn_stream_checksummed2(*stream, NULL, sha1_checksum,
                                       svn_checksum_sha1, FALSE, result_pool);
 
@@ -425,6 +640,11 @@ svn_wc__db_pristine_install(svn_wc__db_install_data_t *install_data,
                          scratch_pool),
     wcroot->sdb);
 
+  /* The shared cache is just an optimization. */
+  if (install_data->db->pristine_cache_abspath)
+    svn_error_clear(pristine_cache_add(install_data->db, pristine_abspath,
+                                       sha1_checksum, scratch_pool));
+
   return SVN_NO_ERROR;
 }
 
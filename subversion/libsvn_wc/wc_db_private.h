@@ -52,6 +52,13 @@ struct svn_wc__db_t {
   /* Busy timeout in ms., 0 for the libsvn_subr default. */
   apr_int32_t timeout;
 
+  /* Absolute path of the machine-wide pristine cache shared between
+     working copies, NULL if that cache is disabled. */
+  const char *pristine_cache_abspath;
+
+  /* Size limit of that cache in bytes. */
+  apr_int64_t pristine_cache_size;
+
   /* Map a given working copy directory to its relevant data.
      const char *local_abspath -> svn_wc__db_wcroot_t *wcroot  */
   apr_hash_t *dir_data;
@@ -539,4 +546,12 @@ svn_wc__db_verify_db_full_internal(svn_wc__db_wcroot_t *wcroot,
                                    void *baton,
                                    apr_pool_t *scratch_pool);
 
+/* Read the shared pristine cache settings for DB from CONFIG.  Allocate
+   the results in RESULT_POOL. */
+svn_error_t *
+svn_wc__db_pristine_cache_init(svn_wc__db_t *db,
+                               svn_config_t *config,
+                               apr_pool_t *result_pool,
+                               apr_pool_t *scratch_pool);
+
 #endif /* WC_DB_PRIVATE_H */
@@ -261,6 +261,9 @@ svn_wc__db_open(svn_wc__db_t **db,
         svn_error_clear(err);
       else
         (*db)->timeout = (apr_int32_t)timeout;
+
+      SVN_ERR(svn_wc__db_pristine_cache_init(*db, config, result_pool,
+                                             scratch_pool));
     }
 
   return SVN_NO_ERROR;
@@ -303,6 +303,11 @@ struct dav_resource_private {
   /* whether this resource parameters are fixed and won't change
      between requests. */
   svn_boolean_t idempotent;
+
+  /* the GET response body from the on-disk response cache, if any, and
+     its length.  Set by set_headers() and sent by deliver(). */
+  apr_file_t *cached_body;
+  apr_off_t cached_body_size;
 };
 
 
@@ -429,6 +434,14 @@ const char *dav_svn__get_root_dir(request_rec *r);
 /* Return the data compression level to be used over the wire. */
 int dav_svn__get_compression_level(request_rec *r);
 
+/* Return the directory of the on-disk response cache, or NULL if that
+   cache is disabled.  Comes from the <SVNResponseCacheDir> directive. */
+const char *dav_svn__get_response_cache_dir(request_rec *r);
+
+/* Return the size budget in bytes of the on-disk response cache.
+   Comes from the <SVNResponseCacheSize> directive. */
+apr_int64_t dav_svn__get_response_cache_size(request_rec *r);
+
 /* Return the hook script environment parsed from the configuration. */
 const char *dav_svn__get_hooks_env(request_rec *r);
 
@@ -700,6 +713,7 @@ static const dav_report_elem dav_svn__reports_list[] = {
   { SVN_XML_NAMESPACE, "get-locations" },
   { SVN_XML_NAMESPACE, "get-location-segments" },
   { SVN_XML_NAMESPACE, "file-revs-report" },
+  { SVN_XML_NAMESPACE, "blame-report" },
   { SVN_XML_NAMESPACE, "get-locks-report" },
   { SVN_XML_NAMESPACE, "replay-report" },
   { SVN_XML_NAMESPACE, "get-deleted-rev-report" },
@@ -735,6 +749,10 @@ dav_svn__file_revs_report(const dav_resource *resource,
                           const apr_xml_doc *doc,
                           dav_svn__output *output);
 dav_error *
+dav_svn__blame_report(const dav_resource *resource,
+                      const apr_xml_doc *doc,
+                      dav_svn__output *output);
+dav_error *
 dav_svn__replay_report(const dav_resource *resource,
                        const apr_xml_doc *doc,
                        dav_svn__output *output);
@@ -1028,6 +1046,14 @@ dav_svn__sanitize_error(svn_error_t *serr,
                         request_rec *r);
 
 
+/* Return a writable generic stream that will send its output to OUTPUT
+   using BB, just like dav_svn__brigade_write() does.  Allocate the stream
+   in POOL. */
+svn_stream_t *
+dav_svn__make_output_stream(apr_bucket_brigade *bb,
+                            dav_svn__output *output,
+                            apr_pool_t *pool);
+
 /* Return a writable generic stream that will encode its output to base64
    and send it to OUTPUT using BB.  Allocate the stream in POOL. */
 svn_stream_t *
@@ -1114,6 +1140,32 @@ dav_svn__get_youngest_rev(svn_revnum_t *youngest_p,
                           dav_svn_repos *repos,
                           apr_pool_t *scratch_pool);
 
+/*** response_cache.c ***/
+
+/* Look up the body of a GET response for RESOURCE, a file at a fixed
+   revision without keyword expansion, in the on-disk response cache.
+
+   If found, set *FILE to the cached body opened for reading, *SIZE to its
+   length and *GZIPPED to whether it is the gzip-encoded variant, which is
+   only used if the client accepts it.  Otherwise, set *FILE to NULL and,
+   unless this is a HEAD request, queue the body for addition to the cache
+   in the background.
+
+   Allocate *FILE in POOL. */
+svn_error_t *
+dav_svn__response_cache_open(apr_file_t **file,
+                             apr_off_t *size,
+                             svn_boolean_t *gzipped,
+                             const dav_resource *resource,
+                             apr_pool_t *pool);
+
+/* Start the background thread of the response cache in the child process
+   whose pool is P.  Log failures for server S. */
+void
+dav_svn__response_cache_child_init(apr_pool_t *p,
+                                   server_rec *s);
+
+
 /*** mirror.c ***/
 
 /* Perform the fixup hook for the R request.  */
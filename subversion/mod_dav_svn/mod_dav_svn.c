@@ -26,6 +26,8 @@
 
 #include <apr_strings.h>
 #include <apr_hash.h>
+#include <apr_shm.h>
+#include <apr_thread_proc.h>
 
 #include <httpd.h>
 #include <http_config.h>
@@ -35,6 +37,7 @@
 #include <mod_dav.h>
 
 #include "svn_hash.h"
+#include "svn_pools.h"
 #include "svn_version.h"
 #include "svn_cache_config.h"
 #include "svn_utf.h"
@@ -42,7 +45,10 @@
 #include "svn_dso.h"
 #include "mod_dav_svn.h"
 
+#include "private/svn_atomic.h"
+#include "private/svn_cache.h"
 #include "private/svn_fspath.h"
+#include "private/svn_repos_private.h"
 #include "private/svn_subr_private.h"
 
 #include "dav_svn.h"
@@ -67,6 +73,12 @@ typedef struct server_conf_t {
      compression level. */
   int compression_level;
 
+  /* Directory of the on-disk response cache, NULL if disabled. */
+  const char *response_cache_dir;
+
+  /* Size budget of that cache in bytes, 0 for the default. */
+  apr_int64_t response_cache_size;
+
 } server_conf_t;
 
 
@@ -120,6 +132,80 @@ extern module AP_MODULE_DECLARE_DATA dav_svn_module;
 /* The authz_svn provider for bypassing path authz. */
 static authz_svn__subreq_bypass_func_t pathauthz_bypass_func = NULL;
 
+/* Size budget of the on-disk response cache if SVNResponseCacheSize has
+ * not been given. */
+#define DEFAULT_RESPONSE_CACHE_SIZE (APR_INT64_C(1024) * 0x100000)
+
+/* Whether the in-memory cache shall be shared between all httpd child
+ * processes (see SVNInMemoryCacheShared). */
+static svn_boolean_t shared_memory_cache = FALSE;
+
+/* Local paths of the repositories to pre-load into the shared in-memory
+ * cache after a (re-)start (see SVNCacheWarmup).  NULL if none. */
+static apr_array_header_t *warm_cache_paths = NULL;
+
+/* Flag in shared memory that the first child process of the current
+ * server generation sets when it starts the cache warm-up.  NULL if
+ * there is nothing to warm up. */
+static volatile svn_atomic_t *warm_cache_claim = NULL;
+
+/* Maximum number of bytes to pre-load per repository (see
+ * SVNCacheWarmupBudget).  0 means the size of the in-memory cache. */
+static apr_uint64_t warm_cache_budget = 0;
+
+/* Key under which the shared membuffer cache gets stored in the httpd
+ * process pool.  That pool survives graceful restarts and so does the
+ * cache. */
+#define SHARED_CACHE_USERDATA_KEY "mod_dav_svn-shared-membuffer-cache"
+
+/* Key under which the size in bytes of that cache gets stored next to it. */
+#define SHARED_CACHE_SIZE_USERDATA_KEY "mod_dav_svn-shared-membuffer-size"
+
+/* Create the shared membuffer cache in the process pool of S unless it
+ * already exists, e.g. from a previous configuration pass, and make it
+ * the global membuffer cache.  This runs in the httpd parent process such
+ * that all child processes inherit the same cache. */
+static svn_error_t *
+init_shared_cache(server_rec *s)
+{
+  apr_pool_t *process_pool = s->process->pool;
+  apr_uint64_t cache_size = svn_cache_config_get()->cache_size;
+  void *data = NULL;
+  svn_membuffer_t *cache;
+  apr_uint64_t *stored_size;
+
+  apr_pool_userdata_get(&data, SHARED_CACHE_USERDATA_KEY, process_pool);
+  if (data)
+    {
+      /* Child processes of the previous generation may still be using
+       * the cache, so we can't replace it with one of a different size. */
+      apr_pool_userdata_get((void **)&stored_size,
+                            SHARED_CACHE_SIZE_USERDATA_KEY, process_pool);
+      if (stored_size && *stored_size != cache_size)
+        ap_log_error(APLOG_MARK, APLOG_WARNING, 0, s,
+                     "mod_dav_svn: keeping the shared in-memory cache of "
+                     "%" APR_UINT64_T_FMT " kB; the new SVNInMemoryCacheSize "
+                     "of %" APR_UINT64_T_FMT " kB requires a full restart",
+                     *stored_size / 0x400, cache_size / 0x400);
+
+      return svn_error_trace(svn_cache__set_global_membuffer_cache(data));
+    }
+
+  SVN_ERR(svn_cache__create_shared_global_membuffer_cache(&cache,
+                                                          process_pool));
+  if (cache)
+    {
+      stored_size = apr_palloc(process_pool, sizeof(*stored_size));
+      *stored_size = cache_size;
+      apr_pool_userdata_set(stored_size, SHARED_CACHE_SIZE_USERDATA_KEY,
+                            NULL, process_pool);
+      apr_pool_userdata_set(cache, SHARED_CACHE_USERDATA_KEY, NULL,
+                            process_pool);
+    }
+
+  return SVN_NO_ERROR;
+}
+
 static int
 init(apr_pool_t *p, apr_pool_t *plog, apr_pool_t *ptemp, server_rec *s)
 {
@@ -146,6 +232,52 @@ init(apr_pool_t *p, apr_pool_t *plog, apr_pool_t *ptemp, server_rec *s)
       return HTTP_INTERNAL_SERVER_ERROR;
     }
 
+  if (shared_memory_cache)
+    {
+      /* Don't silently fall back to per-process caches; the admin asked
+       * for a shared one and sized the memory accordingly. */
+      serr = init_shared_cache(s);
+      if (serr)
+        {
+          ap_log_perror(APLOG_MARK, APLOG_ERR, serr->apr_err, p,
+                        "mod_dav_svn: can't create shared memory cache: '%s'",
+                        serr->message ? serr->message : "(no more info)");
+          svn_error_clear(serr);
+          return HTTP_INTERNAL_SERVER_ERROR;
+        }
+    }
+
+  if (warm_cache_paths)
+    {
+      apr_shm_t *shm;
+      apr_status_t status;
+
+      /* Every child process would fill its private cache all over
+       * again, reading the same data from disk many times in parallel. */
+      if (!shared_memory_cache)
+        {
+          ap_log_perror(APLOG_MARK, APLOG_ERR, 0, p,
+                        "mod_dav_svn: SVNCacheWarmup requires "
+                        "SVNInMemoryCacheShared On");
+          return HTTP_INTERNAL_SERVER_ERROR;
+        }
+
+      /* P gets cleared upon restart, so each generation of child
+       * processes gets a fresh flag and warms the cache once. */
+      status = apr_shm_create(&shm, sizeof(*warm_cache_claim), NULL, p);
+      if (status)
+        {
+          ap_log_perror(APLOG_MARK, APLOG_WARNING, status, p,
+                        "mod_dav_svn: can't create shared memory for "
+                        "SVNCacheWarmup; the cache will not be pre-loaded");
+        }
+      else
+        {
+          warm_cache_claim = apr_shm_baseaddr_get(shm);
+          *warm_cache_claim = 0;
+        }
+    }
+
   /* This returns void, so we can't check for error. */
   conf = ap_get_module_config(s->module_config, &dav_svn_module);
   svn_utf_initialize2(conf->use_utf8, p);
@@ -153,6 +285,131 @@ init(apr_pool_t *p, apr_pool_t *plog, apr_pool_t *ptemp, server_rec *s)
   return OK;
 }
 
+/* Pre-load the in-memory cache with the data of the repository at PATH
+ * using the default cache settings of mod_dav_svn.  Use SCRATCH_POOL for
+ * temporary allocations. */
+static svn_error_t *
+warm_cache(const char *path,
+           apr_pool_t *scratch_pool)
+{
+  apr_hash_t *fs_config = apr_hash_make(scratch_pool);
+  apr_uint64_t budget = warm_cache_budget;
+  svn_repos_t *repos;
+
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_DELTAS, "1");
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_FULLTEXTS, "1");
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_REVPROPS, "2");
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NODEPROPS, "1");
+
+  if (budget == 0)
+    budget = svn_cache_config_get()->cache_size;
+
+  SVN_ERR(svn_repos_open3(&repos, path, fs_config, scratch_pool,
+                          scratch_pool));
+
+  /* Fulltexts tend to be large and are usually sent only once per
+   * client, so we rather fill the cache with tree data. */
+  return svn_error_trace(svn_repos__warm_caches(NULL, NULL, repos, budget,
+                                                FALSE, NULL, NULL,
+                                                scratch_pool));
+}
+
+#if APR_HAS_THREADS
+/* Parameters of a warm_cache_thread. */
+typedef struct warm_cache_baton_t
+{
+  server_rec *s;
+  const char *path;
+} warm_cache_baton_t;
+
+/* Thread function calling warm_cache for the warm_cache_baton_t given by
+ * DATA and logging any error. */
+static void * APR_THREAD_FUNC
+warm_cache_thread(apr_thread_t *tid, void *data)
+{
+  warm_cache_baton_t *baton = data;
+  apr_pool_t *pool = svn_pool_create(NULL);
+  svn_error_t *serr = warm_cache(baton->path, pool);
+
+  if (serr)
+    {
+      ap_log_error(APLOG_MARK, APLOG_WARNING, serr->apr_err, baton->s,
+                   "mod_dav_svn: can't pre-load the cache for '%s': '%s'",
+                   baton->path,
+                   serr->message ? serr->message : "(no more info)");
+      svn_error_clear(serr);
+    }
+
+  svn_pool_destroy(pool);
+  return NULL;
+}
+#endif
+
+/* Implements the #child_init hook.  Re-attach the shared in-memory cache
+ * and start the response cache's background thread.  The first child
+ * process of each server generation also starts a background thread per
+ * repository given to SVNCacheWarmup. */
+static void
+child_init(apr_pool_t *p, server_rec *s)
+{
+#if APR_HAS_THREADS
+  int i;
+#endif
+
+  if (shared_memory_cache)
+    {
+      void *data = NULL;
+
+      apr_pool_userdata_get(&data, SHARED_CACHE_USERDATA_KEY,
+                            s->process->pool);
+      if (data)
+        {
+          svn_error_t *serr = svn_cache__membuffer_cache_child_init(data, p);
+          if (serr)
+            {
+              /* Without its locks, the cache would get corrupted. */
+              ap_log_error(APLOG_MARK, APLOG_CRIT, serr->apr_err, s,
+                           "mod_dav_svn: can't attach to shared memory "
+                           "cache: '%s'",
+                           serr->message ? serr->message : "(no more info)");
+              svn_error_clear(serr);
+              exit(APEXIT_CHILDFATAL);
+            }
+        }
+    }
+
+  dav_svn__response_cache_child_init(p, s);
+
+#if APR_HAS_THREADS
+  if (!warm_cache_claim)
+    return;
+
+  /* All child processes share the cache, so one warm-up is enough. */
+  if (svn_atomic_cas(warm_cache_claim, 1, 0) != 0)
+    return;
+
+  for (i = 0; i < warm_cache_paths->nelts; ++i)
+    {
+      warm_cache_baton_t *baton = apr_pcalloc(p, sizeof(*baton));
+      apr_threadattr_t *tattr;
+      apr_thread_t *tid;
+      apr_status_t status;
+
+      baton->s = s;
+      baton->path = APR_ARRAY_IDX(warm_cache_paths, i, const char *);
+
+      status = apr_threadattr_create(&tattr, p);
+      if (!status)
+        status = apr_threadattr_detach_set(tattr, 1);
+      if (!status)
+        status = apr_thread_create(&tid, tattr, warm_cache_thread, baton, p);
+      if (status)
+        ap_log_error(APLOG_MARK, APLOG_WARNING, status, s,
+                     "mod_dav_svn: can't create cache warm-up thread");
+    }
+#endif
+}
+
 static svn_error_t *
 malfunction_handler(svn_boolean_t can_return,
                     const char *file, int line,
@@ -182,6 +439,11 @@ init_dso(apr_pool_t *pconf, apr_pool_t *plog, apr_pool_t *ptemp)
 
   svn_error_t *serr = svn_dso_initialize2();
 
+  /* Forget the settings of the previous configuration pass. */
+  warm_cache_paths = NULL;
+  warm_cache_budget = 0;
+  warm_cache_claim = NULL;
+
   if (serr)
     {
       ap_log_perror(APLOG_MARK, APLOG_ERR, serr->apr_err, plog,
@@ -219,6 +481,10 @@ merge_server_config(apr_pool_t *p, void *base, void *overrides)
   newconf = apr_pcalloc(p, sizeof(*newconf));
 
   newconf->special_uri = INHERIT_VALUE(parent, child, special_uri);
+  newconf->response_cache_dir = INHERIT_VALUE(parent, child,
+                                              response_cache_dir);
+  newconf->response_cache_size = INHERIT_VALUE(parent, child,
+                                               response_cache_size);
 
   if (child->compression_level < 0)
     {
@@ -624,6 +890,42 @@ SVNInMemoryCacheSize_cmd(cmd_parms *cmd, void *config, const char *arg1)
   return NULL;
 }
 
+static const char *
+SVNInMemoryCacheShared_cmd(cmd_parms *cmd, void *config, int arg)
+{
+  shared_memory_cache = arg ? TRUE : FALSE;
+
+  return NULL;
+}
+
+static const char *
+SVNCacheWarmup_cmd(cmd_parms *cmd, void *config, const char *arg1)
+{
+  if (!warm_cache_paths)
+    warm_cache_paths = apr_array_make(cmd->pool, 1, sizeof(const char *));
+
+  APR_ARRAY_PUSH(warm_cache_paths, const char *)
+    = svn_dirent_internal_style(arg1, cmd->pool);
+
+  return NULL;
+}
+
+static const char *
+SVNCacheWarmupBudget_cmd(cmd_parms *cmd, void *config, const char *arg1)
+{
+  apr_uint64_t value = 0;
+  svn_error_t *err = svn_cstring_atoui64(&value, arg1);
+  if (err)
+    {
+      svn_error_clear(err);
+      return "Invalid decimal number for the SVN cache warm-up budget.";
+    }
+
+  warm_cache_budget = value * 0x400;
+
+  return NULL;
+}
+
 static const char *
 SVNCompressionLevel_cmd(cmd_parms *cmd, void *config, const char *arg1)
 {
@@ -652,6 +954,40 @@ SVNCompressionLevel_cmd(cmd_parms *cmd, void *config, const char *arg1)
   return NULL;
 }
 
+static const char *
+SVNResponseCacheDir_cmd(cmd_parms *cmd, void *config, const char *arg1)
+{
+  server_conf_t *conf;
+
+  conf = ap_get_module_config(cmd->server->module_config,
+                              &dav_svn_module);
+  conf->response_cache_dir = svn_dirent_internal_style(arg1, cmd->pool);
+
+  return NULL;
+}
+
+static const char *
+SVNResponseCacheSize_cmd(cmd_parms *cmd, void *config, const char *arg1)
+{
+  server_conf_t *conf;
+  apr_uint64_t value = 0;
+  svn_error_t *err = svn_cstring_atoui64(&value, arg1);
+  if (err)
+    {
+      svn_error_clear(err);
+      return "Invalid decimal number for the SVN response cache size.";
+    }
+
+  if (value == 0 || value > APR_INT64_MAX / 0x100000)
+    return "The SVN response cache size is out of range.";
+
+  conf = ap_get_module_config(cmd->server->module_config,
+                              &dav_svn_module);
+  conf->response_cache_size = (apr_int64_t)value * 0x100000;
+
+  return NULL;
+}
+
 static const char *
 SVNUseUTF8_cmd(cmd_parms *cmd, void *config, int arg)
 {
@@ -1060,6 +1396,30 @@ dav_svn__get_compression_level(request_rec *r)
     }
 }
 
+const char *
+dav_svn__get_response_cache_dir(request_rec *r)
+{
+  server_conf_t *conf;
+
+  conf = ap_get_module_config(r->server->module_config,
+                              &dav_svn_module);
+  return conf->response_cache_dir;
+}
+
+apr_int64_t
+dav_svn__get_response_cache_size(request_rec *r)
+{
+  server_conf_t *conf;
+
+  conf = ap_get_module_config(r->server->module_config,
+                              &dav_svn_module);
+
+  if (conf->response_cache_size == 0)
+    return DEFAULT_RESPONSE_CACHE_SIZE;
+  else
+    return conf->response_cache_size;
+}
+
 const char *
 dav_svn__get_hooks_env(request_rec *r)
 {
@@ -1404,12 +1764,47 @@ static const command_rec cmds[] =
                 "in-memory object cache (default value is 16384; 0 switches "
                 "to dynamically sized caches)."),
   /* per server */
+  AP_INIT_FLAG("SVNInMemoryCacheShared", SVNInMemoryCacheShared_cmd, NULL,
+               RSRC_CONF,
+               "enables a single in-memory object cache of "
+               "SVNInMemoryCacheSize shared by all httpd child processes "
+               "instead of one cache per process.  The cache survives "
+               "graceful restarts but not full ones, so changes to "
+               "SVNInMemoryCacheSize require a full restart (default is "
+               "Off)."),
+  /* per server */
+  AP_INIT_ITERATE("SVNCacheWarmup", SVNCacheWarmup_cmd, NULL,
+                  RSRC_CONF,
+                  "specifies the local paths of repositories whose HEAD "
+                  "tree and latest revisions get pre-loaded into the "
+                  "in-memory object cache by the first child process "
+                  "after each (re-)start.  Requires "
+                  "SVNInMemoryCacheShared On."),
+  /* per server */
+  AP_INIT_TAKE1("SVNCacheWarmupBudget", SVNCacheWarmupBudget_cmd, NULL,
+                RSRC_CONF,
+                "specifies the maximum amount of data in kB to pre-load "
+                "per SVNCacheWarmup repository (default is the "
+                "SVNInMemoryCacheSize)."),
+  /* per server */
   AP_INIT_TAKE1("SVNCompressionLevel", SVNCompressionLevel_cmd, NULL,
                 RSRC_CONF,
                 "specifies the compression level used before sending file "
                 "content over the network (0 for no compression, 9 for "
                 "maximum, 5 is default)."),
 
+  /* per server */
+  AP_INIT_TAKE1("SVNResponseCacheDir", SVNResponseCacheDir_cmd, NULL,
+                RSRC_CONF,
+                "specifies a directory in which file contents served at "
+                "fixed revisions get cached together with gzip-compressed "
+                "variants (default is no caching)."),
+  /* per server */
+  AP_INIT_TAKE1("SVNResponseCacheSize", SVNResponseCacheSize_cmd, NULL,
+                RSRC_CONF,
+                "specifies the maximum size in MB of the SVNResponseCacheDir "
+                "contents (default value is 1024)."),
+
   /* per server */
   AP_INIT_FLAG("SVNUseUTF8",
                SVNUseUTF8_cmd, NULL,
@@ -1444,6 +1839,7 @@ register_hooks(apr_pool_t *pconf)
 {
   ap_hook_pre_config(init_dso, NULL, NULL, APR_HOOK_REALLY_FIRST);
   ap_hook_post_config(init, NULL, NULL, APR_HOOK_MIDDLE);
+  ap_hook_child_init(child_init, NULL, NULL, APR_HOOK_MIDDLE);
 
   /* our provider */
   dav_register_provider(pconf, "svn", &provider);
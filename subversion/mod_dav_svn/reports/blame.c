@@ -0,0 +1,265 @@
+/*
+ * blame.c: mod_dav_svn REPORT handler for server-side blame
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#define APR_WANT_STRFUNC
+#include <apr_want.h> /* for strcmp() */
+
+#include <apr_tables.h>
+
+#include <httpd.h>
+#include <mod_dav.h>
+
+#include "svn_types.h"
+#include "svn_xml.h"
+#include "svn_pools.h"
+#include "svn_base64.h"
+#include "svn_diff.h"
+#include "svn_repos.h"
+#include "svn_dav.h"
+
+#include "private/svn_log.h"
+#include "private/svn_fspath.h"
+#include "private/svn_repos_private.h"
+
+#include "../dav_svn.h"
+
+
+/* Send the revision property NAME with value VAL.  Quote NAME and
+   base64-encode VAL if necessary. */
+static svn_error_t *
+send_rev_prop(dav_svn__output *output,
+              apr_bucket_brigade *bb,
+              const char *name,
+              const svn_string_t *val,
+              apr_pool_t *pool)
+{
+  name = apr_xml_quote_string(pool, name, 1);
+
+  if (svn_xml_is_xml_safe(val->data, val->len))
+    {
+      svn_stringbuf_t *tmp = NULL;
+      svn_xml_escape_cdata_string(&tmp, val, pool);
+      SVN_ERR(dav_svn__brigade_printf(bb, output,
+                                      "<S:rev-prop name=\"%s\">%s"
+                                      "</S:rev-prop>" DEBUG_CR,
+                                      name, tmp->data));
+    }
+  else
+    {
+      val = svn_base64_encode_string2(val, TRUE, pool);
+      SVN_ERR(dav_svn__brigade_printf(bb, output,
+                                      "<S:rev-prop name=\"%s\" "
+                                      "encoding=\"base64\">%s"
+                                      "</S:rev-prop>" DEBUG_CR,
+                                      name, val->data));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Send CHUNKS, an array of svn_repos__blame_chunk_t, followed by the
+   revision properties of every revision referenced by them, as the
+   blame-report for RESOURCE.  ARB controls revprop visibility. */
+static svn_error_t *
+send_blame_report(dav_svn__output *output,
+                  apr_bucket_brigade *bb,
+                  const dav_resource *resource,
+                  const apr_array_header_t *chunks,
+                  dav_svn__authz_read_baton *arb)
+{
+  apr_pool_t *pool = resource->pool;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  apr_hash_t *sent_revs = apr_hash_make(pool);
+  int i;
+
+  SVN_ERR(dav_svn__brigade_printf(
+                       bb, output,
+                       DAV_XML_HEADER DEBUG_CR
+                       "<S:blame-report xmlns:S=\"" SVN_XML_NAMESPACE
+                       "\" xmlns:D=\"DAV:\">" DEBUG_CR));
+
+  for (i = 0; i < chunks->nelts; ++i)
+    {
+      const svn_repos__blame_chunk_t *chunk
+        = &APR_ARRAY_IDX(chunks, i, svn_repos__blame_chunk_t);
+
+      if (SVN_IS_VALID_REVNUM(chunk->revision))
+        SVN_ERR(dav_svn__brigade_printf(bb, output,
+                                        "<S:chunk start=\"%" APR_INT64_T_FMT
+                                        "\" rev=\"%ld\"/>" DEBUG_CR,
+                                        chunk->start, chunk->revision));
+      else
+        SVN_ERR(dav_svn__brigade_printf(bb, output,
+                                        "<S:chunk start=\"%" APR_INT64_T_FMT
+                                        "\"/>" DEBUG_CR,
+                                        chunk->start));
+    }
+
+  for (i = 0; i < chunks->nelts; ++i)
+    {
+      const svn_repos__blame_chunk_t *chunk
+        = &APR_ARRAY_IDX(chunks, i, svn_repos__blame_chunk_t);
+      apr_hash_t *props;
+      apr_hash_index_t *hi;
+
+      if (!SVN_IS_VALID_REVNUM(chunk->revision)
+          || apr_hash_get(sent_revs, &chunk->revision,
+                          sizeof(chunk->revision)))
+        continue;
+
+      svn_pool_clear(iterpool);
+      apr_hash_set(sent_revs, &chunk->revision, sizeof(chunk->revision),
+                   (void *)chunk);
+
+      SVN_ERR(svn_repos_fs_revision_proplist(&props,
+                                             resource->info->repos->repos,
+                                             chunk->revision,
+                                             dav_svn__authz_read_func(arb),
+                                             arb, iterpool));
+
+      SVN_ERR(dav_svn__brigade_printf(bb, output,
+                                      "<S:revision rev=\"%ld\">" DEBUG_CR,
+                                      chunk->revision));
+      for (hi = apr_hash_first(iterpool, props); hi; hi = apr_hash_next(hi))
+        SVN_ERR(send_rev_prop(output, bb, apr_hash_this_key(hi),
+                              apr_hash_this_val(hi), iterpool));
+      SVN_ERR(dav_svn__brigade_puts(bb, output, "</S:revision>" DEBUG_CR));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  SVN_ERR(dav_svn__brigade_puts(bb, output, "</S:blame-report>" DEBUG_CR));
+  return SVN_NO_ERROR;
+}
+
+
+/* Respond to a client request for a REPORT of type blame-report for the
+   RESOURCE.  Get request body from DOC and send result to OUTPUT. */
+dav_error *
+dav_svn__blame_report(const dav_resource *resource,
+                      const apr_xml_doc *doc,
+                      dav_svn__output *output)
+{
+  svn_error_t *serr;
+  dav_error *derr = NULL;
+  apr_bucket_brigade *bb;
+  apr_xml_elem *child;
+  int ns;
+  dav_svn__authz_read_baton arb;
+  const char *abs_path = NULL;
+  apr_array_header_t *args;
+  apr_array_header_t *chunks;
+  svn_diff_file_options_t *diff_options;
+
+  /* These get determined from the request document. */
+  svn_revnum_t start = SVN_INVALID_REVNUM;
+  svn_revnum_t end = SVN_INVALID_REVNUM;
+
+  /* Construct the authz read check baton. */
+  arb.r = resource->info->r;
+  arb.repos = resource->info->repos;
+
+  /* Sanity check. */
+  if (!resource->info->repos_path)
+    return dav_svn__new_error(resource->pool, HTTP_BAD_REQUEST, 0, 0,
+                              "The request does not specify a repository path");
+  ns = dav_svn__find_ns(doc->namespaces, SVN_XML_NAMESPACE);
+  if (ns == -1)
+    {
+      return dav_svn__new_error_svn(resource->pool, HTTP_BAD_REQUEST, 0, 0,
+                                    "The request does not contain the 'svn:' "
+                                    "namespace, so it is not going to have "
+                                    "certain required elements");
+    }
+
+  /* Get request information. */
+  args = apr_array_make(resource->pool, 2, sizeof(const char *));
+  for (child = doc->root->first_child; child != NULL; child = child->next)
+    {
+      /* if this element isn't one of ours, then skip it */
+      if (child->ns != ns)
+        continue;
+
+      if (strcmp(child->name, "start-revision") == 0)
+        start = SVN_STR_TO_REV(dav_xml_get_cdata(child, resource->pool, 1));
+      else if (strcmp(child->name, "end-revision") == 0)
+        end = SVN_STR_TO_REV(dav_xml_get_cdata(child, resource->pool, 1));
+      else if (strcmp(child->name, "diff-option") == 0)
+        APR_ARRAY_PUSH(args, const char *)
+          = dav_xml_get_cdata(child, resource->pool, 1);
+      else if (strcmp(child->name, "path") == 0)
+        {
+          const char *rel_path = dav_xml_get_cdata(child, resource->pool, 0);
+          if ((derr = dav_svn__test_canonical(rel_path, resource->pool)))
+            return derr;
+
+          /* Force REL_PATH to be a relative path, not an fspath. */
+          rel_path = svn_relpath_canonicalize(rel_path, resource->pool);
+
+          /* Append the REL_PATH to the base FS path to get an
+             absolute repository path. */
+          abs_path = svn_fspath__join(resource->info->repos_path, rel_path,
+                                      resource->pool);
+        }
+      /* else unknown element; skip it */
+    }
+
+  /* Check that all parameters are present and valid. */
+  if (! abs_path)
+    return dav_svn__new_error_svn(resource->pool, HTTP_BAD_REQUEST, 0, 0,
+                                  "Not all parameters passed");
+
+  diff_options = svn_diff_file_options_create(resource->pool);
+  serr = svn_diff_file_options_parse(diff_options, args, resource->pool);
+  if (serr)
+    return dav_svn__convert_err(serr, HTTP_BAD_REQUEST,
+                                "Invalid diff option",
+                                resource->pool);
+
+  serr = svn_repos__blame(&chunks, resource->info->repos->repos, abs_path,
+                          start, end, diff_options,
+                          SVN_REPOS__BLAME_MAX_FILE_SIZE,
+                          dav_svn__authz_read_func(&arb), &arb,
+                          NULL, NULL, resource->pool, resource->pool);
+  if (serr)
+    return dav_svn__convert_err(serr, HTTP_INTERNAL_SERVER_ERROR, NULL,
+                                resource->pool);
+
+  bb = apr_brigade_create(resource->pool,
+                          dav_svn__output_get_bucket_alloc(output));
+
+  serr = send_blame_report(output, bb, resource, chunks, &arb);
+  if (serr)
+    derr = dav_svn__convert_err(serr,
+                                HTTP_INTERNAL_SERVER_ERROR,
+                                "Error writing REPORT response.",
+                                resource->pool);
+
+  /* We've detected a 'high level' svn action to log. */
+  dav_svn__operational_log(resource->info,
+                           svn_log__blame(abs_path, start, end,
+                                          resource->pool));
+
+  return dav_svn__final_flush_or_error(resource->info->r, bb, output,
+                                       derr, resource->pool);
+}
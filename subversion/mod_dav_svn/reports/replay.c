@@ -26,6 +26,7 @@
 #include <apr_xml.h>
 
 #include <http_request.h>
+#include <http_protocol.h>
 #include <http_log.h>
 #include <mod_dav.h>
 
@@ -38,6 +39,7 @@
 #include "svn_dav.h"
 #include "svn_props.h"
 #include "private/svn_log.h"
+#include "private/svn_dav_protocol.h"
 
 #include "../dav_svn.h"
 
@@ -49,16 +51,37 @@ typedef struct edit_baton_t {
   svn_boolean_t sending_textdelta;
   int compression_level;
   int svndiff_version;
+
+  /* The stream we write binary frames to or NULL to send XML. */
+  svn_stream_t *frames;
 } edit_baton_t;
 
 
 
+#define DIR_OR_FILE(is_dir) ((is_dir) ? "directory" : "file")
+
+
 /*** Helper Functions ***/
 
+/* Send a binary frame of type OP with the PAYLOAD to EB's output. */
+static svn_error_t *
+send_frame(edit_baton_t *eb, char op, const svn_stringbuf_t *payload)
+{
+  return svn_error_trace(svn_frames__write(eb->frames, op, payload->data,
+                                           payload->len));
+}
+
 static svn_error_t *
 maybe_start_report(edit_baton_t *eb)
 {
-  if (! eb->started)
+  if (! eb->started && eb->frames)
+    {
+      SVN_ERR(dav_svn__brigade_write(eb->bb, eb->output,
+                                     SVN_DAV__BINARY_UPDATE_MAGIC,
+                                     SVN_DAV__BINARY_UPDATE_MAGIC_LEN));
+      eb->started = TRUE;
+    }
+  else if (! eb->started)
     {
       SVN_ERR(dav_svn__brigade_puts(eb->bb, eb->output,
                                     DAV_XML_HEADER DEBUG_CR
@@ -73,6 +96,14 @@ maybe_start_report(edit_baton_t *eb)
 static svn_error_t *
 end_report(edit_baton_t *eb)
 {
+  if (eb->frames)
+    {
+      SVN_ERR(maybe_start_report(eb));
+      return svn_error_trace(svn_frames__write(eb->frames,
+                                               SVN_DAV__FRAME_END,
+                                               NULL, 0));
+    }
+
   SVN_ERR(dav_svn__brigade_puts(eb->bb, eb->output,
                                 "</S:editor-report>" DEBUG_CR));
 
@@ -95,7 +126,7 @@ maybe_close_textdelta(edit_baton_t *eb)
 
 
 static svn_error_t *
-add_file_or_directory(const char *file_or_directory,
+add_file_or_directory(svn_boolean_t is_dir,
                       const char *path,
                       edit_baton_t *eb,
                       const char *copyfrom_path,
@@ -103,44 +134,72 @@ add_file_or_directory(const char *file_or_directory,
                       apr_pool_t *pool,
                       void **added_baton)
 {
-  const char *qname = apr_xml_quote_string(pool, path, 1);
-  const char *qcopy =
-    copyfrom_path ? apr_xml_quote_string(pool, copyfrom_path, 1) : NULL;
+  const char *qname;
+  const char *qcopy;
 
   SVN_ERR(maybe_close_textdelta(eb));
 
   *added_baton = eb;
 
+  if (eb->frames)
+    {
+      svn_stringbuf_t *buf = svn_stringbuf_create_empty(pool);
+
+      svn_frames__append_cstring(buf, path);
+      svn_frames__append_cstring(buf, copyfrom_path);
+      svn_frames__append_int(buf, copyfrom_path ? copyfrom_rev
+                                                : SVN_INVALID_REVNUM);
+      return svn_error_trace(send_frame(eb, is_dir ? SVN_DAV__FRAME_ADD_DIR
+                                                   : SVN_DAV__FRAME_ADD_FILE,
+                                        buf));
+    }
+
+  qname = apr_xml_quote_string(pool, path, 1);
+  qcopy = copyfrom_path ? apr_xml_quote_string(pool, copyfrom_path, 1) : NULL;
+
   if (! copyfrom_path)
     SVN_ERR(dav_svn__brigade_printf(eb->bb, eb->output,
                                     "<S:add-%s name=\"%s\"/>" DEBUG_CR,
-                                    file_or_directory, qname));
+                                    DIR_OR_FILE(is_dir), qname));
   else
     SVN_ERR(dav_svn__brigade_printf(eb->bb, eb->output,
                                     "<S:add-%s name=\"%s\" "
                                     "copyfrom-path=\"%s\" "
                                     "copyfrom-rev=\"%ld\"/>" DEBUG_CR,
-                                    file_or_directory, qname,
+                                    DIR_OR_FILE(is_dir), qname,
                                     qcopy, copyfrom_rev));
 
   return SVN_NO_ERROR;
 }
 
 static svn_error_t *
-open_file_or_directory(const char *file_or_directory,
+open_file_or_directory(svn_boolean_t is_dir,
                        const char *path,
                        edit_baton_t *eb,
                        svn_revnum_t base_revision,
                        apr_pool_t *pool,
                        void **opened_baton)
 {
-  const char *qname = apr_xml_quote_string(pool, path, 1);
+  const char *qname;
   SVN_ERR(maybe_close_textdelta(eb));
   *opened_baton = eb;
+
+  if (eb->frames)
+    {
+      svn_stringbuf_t *buf = svn_stringbuf_create_empty(pool);
+
+      svn_frames__append_cstring(buf, path);
+      svn_frames__append_int(buf, base_revision);
+      return svn_error_trace(send_frame(eb, is_dir ? SVN_DAV__FRAME_OPEN_DIR
+                                                   : SVN_DAV__FRAME_OPEN_FILE,
+                                        buf));
+    }
+
+  qname = apr_xml_quote_string(pool, path, 1);
   return dav_svn__brigade_printf(eb->bb, eb->output,
                                  "<S:open-%s name=\"%s\" rev=\"%ld\"/>"
                                  DEBUG_CR,
-                                 file_or_directory, qname, base_revision);
+                                 DIR_OR_FILE(is_dir), qname, base_revision);
 }
 
 
@@ -151,10 +210,25 @@ change_file_or_dir_prop(const char *file_or_dir,
                         const svn_string_t *value,
                         apr_pool_t *pool)
 {
-  const char *qname = apr_xml_quote_string(pool, name, 1);
+  const char *qname;
 
   SVN_ERR(maybe_close_textdelta(eb));
 
+  if (eb->frames)
+    {
+      svn_stringbuf_t *buf = svn_stringbuf_create_empty(pool);
+
+      svn_frames__append_cstring(buf, name);
+      if (value)
+        svn_frames__append_string(buf, value->data, value->len);
+
+      return svn_error_trace(send_frame(eb, value ? SVN_DAV__FRAME_SET_PROP
+                                                  : SVN_DAV__FRAME_REMOVE_PROP,
+                                        buf));
+    }
+
+  qname = apr_xml_quote_string(pool, name, 1);
+
   if (value)
     {
       const svn_string_t *enc_value =
@@ -198,6 +272,16 @@ set_target_revision(void *edit_baton,
 {
   edit_baton_t *eb = edit_baton;
   SVN_ERR(maybe_start_report(eb));
+
+  if (eb->frames)
+    {
+      svn_stringbuf_t *buf = svn_stringbuf_create_empty(pool);
+
+      svn_frames__append_int(buf, target_revision);
+      return svn_error_trace(send_frame(eb, SVN_DAV__FRAME_TARGET_REVISION,
+                                        buf));
+    }
+
   return dav_svn__brigade_printf(eb->bb, eb->output,
                                  "<S:target-revision rev=\"%ld\"/>" DEBUG_CR,
                                  target_revision);
@@ -213,6 +297,15 @@ open_root(void *edit_baton,
   edit_baton_t *eb = edit_baton;
   *root_baton = edit_baton;
   SVN_ERR(maybe_start_report(eb));
+
+  if (eb->frames)
+    {
+      svn_stringbuf_t *buf = svn_stringbuf_create_empty(pool);
+
+      svn_frames__append_int(buf, base_revision);
+      return svn_error_trace(send_frame(eb, SVN_DAV__FRAME_OPEN_ROOT, buf));
+    }
+
   return dav_svn__brigade_printf(eb->bb, eb->output,
                                  "<S:open-root rev=\"%ld\"/>" DEBUG_CR,
                                  base_revision);
@@ -226,8 +319,20 @@ delete_entry(const char *path,
              apr_pool_t *pool)
 {
   edit_baton_t *eb = parent_baton;
-  const char *qname = apr_xml_quote_string(pool, path, 1);
+  const char *qname;
   SVN_ERR(maybe_close_textdelta(eb));
+
+  if (eb->frames)
+    {
+      svn_stringbuf_t *buf = svn_stringbuf_create_empty(pool);
+
+      svn_frames__append_cstring(buf, path);
+      svn_frames__append_int(buf, revision);
+      return svn_error_trace(send_frame(eb, SVN_DAV__FRAME_DELETE_ENTRY,
+                                        buf));
+    }
+
+  qname = apr_xml_quote_string(pool, path, 1);
   return dav_svn__brigade_printf(eb->bb, eb->output,
                                  "<S:delete-entry name=\"%s\" rev=\"%ld\"/>"
                                  DEBUG_CR,
@@ -243,7 +348,7 @@ add_directory(const char *path,
               apr_pool_t *pool,
               void **child_baton)
 {
-  return add_file_or_directory("directory", path, parent_baton,
+  return add_file_or_directory(TRUE, path, parent_baton,
                                copyfrom_path, copyfrom_rev, pool, child_baton);
 }
 
@@ -255,7 +360,7 @@ open_directory(const char *path,
                apr_pool_t *pool,
                void **child_baton)
 {
-  return open_file_or_directory("directory", path, parent_baton,
+  return open_file_or_directory(TRUE, path, parent_baton,
                                 base_revision, pool, child_baton);
 }
 
@@ -278,7 +383,7 @@ add_file(const char *path,
          apr_pool_t *pool,
          void **file_baton)
 {
-  return add_file_or_directory("file", path, parent_baton,
+  return add_file_or_directory(FALSE, path, parent_baton,
                                copyfrom_path, copyfrom_rev, pool, file_baton);
 }
 
@@ -290,7 +395,7 @@ open_file(const char *path,
           apr_pool_t *pool,
           void **file_baton)
 {
-  return open_file_or_directory("file", path, parent_baton,
+  return open_file_or_directory(FALSE, path, parent_baton,
                                 base_revision, pool, file_baton);
 }
 
@@ -314,6 +419,27 @@ apply_textdelta(void *file_baton,
 {
   edit_baton_t *eb = file_baton;
 
+  /* Binary frames carry the svndiff data as is. */
+  if (eb->frames)
+    {
+      svn_stringbuf_t *buf = svn_stringbuf_create_empty(pool);
+
+      svn_frames__append_cstring(buf, base_checksum);
+      SVN_ERR(send_frame(eb, SVN_DAV__FRAME_TXDELTA, buf));
+
+      svn_txdelta_to_svndiff3(handler, handler_baton,
+                              svn_frames__data_stream(
+                                              eb->frames,
+                                              SVN_DAV__FRAME_SVNDIFF,
+                                              SVN_DAV__FRAME_TXDELTA_END,
+                                              pool),
+                              eb->svndiff_version, eb->compression_level,
+                              pool);
+
+      /* Closing the svndiff stream ends the delta. */
+      return SVN_NO_ERROR;
+    }
+
   SVN_ERR(dav_svn__brigade_puts(eb->bb, eb->output, "<S:apply-textdelta"));
 
   if (base_checksum)
@@ -342,6 +468,15 @@ close_file(void *file_baton, const char *text_checksum, apr_pool_t *pool)
 {
   edit_baton_t *eb = file_baton;
   SVN_ERR(maybe_close_textdelta(eb));
+
+  if (eb->frames)
+    {
+      svn_stringbuf_t *buf = svn_stringbuf_create_empty(pool);
+
+      svn_frames__append_cstring(buf, text_checksum);
+      return svn_error_trace(send_frame(eb, SVN_DAV__FRAME_CLOSE_FILE, buf));
+    }
+
   SVN_ERR(dav_svn__brigade_puts(eb->bb, eb->output, "<S:close-file"));
 
   if (text_checksum)
@@ -359,6 +494,12 @@ static svn_error_t *
 close_directory(void *dir_baton, apr_pool_t *pool)
 {
   edit_baton_t *eb = dir_baton;
+
+  if (eb->frames)
+    return svn_error_trace(svn_frames__write(eb->frames,
+                                             SVN_DAV__FRAME_CLOSE_DIR,
+                                             NULL, 0));
+
   return dav_svn__brigade_puts(eb->bb, eb->output,
                                "<S:close-directory/>" DEBUG_CR);
 }
@@ -371,6 +512,7 @@ make_editor(const svn_delta_editor_t **editor,
             dav_svn__output *output,
             int compression_level,
             int svndiff_version,
+            svn_boolean_t binary_frames,
             apr_pool_t *pool)
 {
   edit_baton_t *eb = apr_pcalloc(pool, sizeof(*eb));
@@ -382,6 +524,8 @@ make_editor(const svn_delta_editor_t **editor,
   eb->sending_textdelta = FALSE;
   eb->compression_level = compression_level;
   eb->svndiff_version = svndiff_version;
+  eb->frames = binary_frames ? dav_svn__make_output_stream(bb, output, pool)
+                             : NULL;
 
   e->set_target_revision = set_target_revision;
   e->open_root = open_root;
@@ -423,10 +567,12 @@ dav_svn__replay_report(const dav_resource *resource,
   svn_revnum_t rev;
   const svn_delta_editor_t *editor;
   svn_boolean_t send_deltas = TRUE;
+  svn_boolean_t binary_frames = FALSE;
   dav_svn__authz_read_baton arb;
   const char *base_dir;
   apr_bucket_brigade *bb;
   apr_xml_elem *child;
+  apr_xml_attr *this_attr;
   svn_fs_root_t *root;
   svn_error_t *err;
   void *edit_baton;
@@ -464,6 +610,16 @@ dav_svn__replay_report(const dav_resource *resource,
                                   "svn:revision element. That element is "
                                   "required");
 
+  /* Honor the client's request for binary frames. */
+  for (this_attr = doc->root->attr; this_attr; this_attr = this_attr->next)
+    {
+      if ((strcmp(this_attr->name, SVN_DAV__BINARY_FRAMES) == 0)
+          && (strcmp(this_attr->value, "true") == 0))
+        {
+          binary_frames = TRUE;
+        }
+    }
+
   for (child = doc->root->first_child; child != NULL; child = child->next)
     {
       if (child->ns == ns)
@@ -545,9 +701,15 @@ dav_svn__replay_report(const dav_resource *resource,
       goto cleanup;
     }
 
+  /* Tell the client which format it is going to get; it falls back to
+     XML for anything but our MIME type. */
+  if (binary_frames)
+    ap_set_content_type(resource->info->r, SVN_DAV__BINARY_UPDATE_MIME_TYPE);
+
   make_editor(&editor, &edit_baton, bb, output,
               dav_svn__get_compression_level(resource->info->r),
               resource->info->svndiff_version,
+              binary_frames,
               resource->pool);
 
   if ((err = svn_repos_replay2(root, base_dir, low_water_mark,
@@ -555,6 +717,15 @@ dav_svn__replay_report(const dav_resource *resource,
                                dav_svn__authz_read_func(&arb), &arb,
                                resource->pool)))
     {
+      edit_baton_t *eb = edit_baton;
+
+      /* The response is already under way, so the client will only see
+         the HTTP status code if nothing has been sent yet.  Binary frames
+         let us tell it what went wrong in any case. */
+      if (eb->frames && eb->started)
+        svn_error_clear(svn_frames__write_error(eb->frames, err,
+                                                resource->pool));
+
       derr = dav_svn__convert_err(err, HTTP_INTERNAL_SERVER_ERROR,
                                   "Problem replaying revision",
                                   resource->pool);
@@ -26,6 +26,7 @@
 #include <apr_xml.h>
 
 #include <http_request.h>
+#include <http_protocol.h>
 #include <http_log.h>
 #include <mod_dav.h>
 
@@ -42,6 +43,7 @@
 
 #include "private/svn_log.h"
 #include "private/svn_fspath.h"
+#include "private/svn_dav_protocol.h"
 
 #include "../dav_svn.h"
 
@@ -86,6 +88,13 @@ typedef struct update_ctx_t {
      inline.  (This is implied when "send_all" is set.)  */
   svn_boolean_t include_props;
 
+  /* True iff we send binary frames instead of XML.  (This implies
+     "send_all" and excludes "resource_walk".)  */
+  svn_boolean_t binary;
+
+  /* The stream we write binary frames to, if BINARY is set.  */
+  svn_stream_t *frames;
+
   /* SVNDIFF version to send to client.  */
   int svndiff_version;
 
@@ -137,6 +146,22 @@ typedef struct item_baton_t {
 #define DIR_OR_FILE(is_dir) ((is_dir) ? "directory" : "file")
 
 
+/* Send a binary frame of type OP with the LEN bytes of PAYLOAD to UC's
+   output.  PAYLOAD may be NULL if LEN is 0. */
+static svn_error_t *
+send_frame(update_ctx_t *uc, char op, const char *payload, apr_size_t len)
+{
+  return svn_error_trace(svn_frames__write(uc->frames, op, payload, len));
+}
+
+/* Convenience wrapper around send_frame() taking a stringbuf PAYLOAD. */
+static svn_error_t *
+send_frame_buf(update_ctx_t *uc, char op, const svn_stringbuf_t *payload)
+{
+  return svn_error_trace(send_frame(uc, op, payload->data, payload->len));
+}
+
+
 /* add PATH to the pathmap HASH with a repository path of LINKPATH.
    if LINKPATH is NULL, PATH will map to itself. */
 static void
@@ -262,6 +287,15 @@ send_vsn_url(item_baton_t *baton, apr_pool_t *pool)
                                 revision, path, FALSE /* add_href */, pool);
     }
 
+  if (baton->uc->binary)
+    {
+      svn_stringbuf_t *buf = svn_stringbuf_create_empty(pool);
+
+      svn_frames__append_cstring(buf, href);
+      return svn_error_trace(send_frame_buf(baton->uc,
+                                            SVN_DAV__FRAME_CHECKED_IN, buf));
+    }
+
   return dav_svn__brigade_printf(baton->uc->bb, baton->uc->output,
                                  "<D:checked-in><D:href>%s</D:href>"
                                  "</D:checked-in>" DEBUG_CR,
@@ -277,7 +311,16 @@ absent_helper(svn_boolean_t is_dir,
 {
   update_ctx_t *uc = parent->uc;
 
-  if (! uc->resource_walk)
+  if (uc->binary)
+    {
+      svn_stringbuf_t *buf = svn_stringbuf_create_empty(pool);
+
+      svn_frames__append_cstring(buf, svn_relpath_basename(path, NULL));
+      SVN_ERR(send_frame_buf(uc, is_dir ? SVN_DAV__FRAME_ABSENT_DIR
+                                        : SVN_DAV__FRAME_ABSENT_FILE,
+                             buf));
+    }
+  else if (! uc->resource_walk)
     {
       SVN_ERR(dav_svn__brigade_printf
               (uc->bb, uc->output,
@@ -321,7 +364,33 @@ add_helper(svn_boolean_t is_dir,
   child = make_child_baton(parent, path, pool);
   child->added = TRUE;
 
-  if (uc->resource_walk)
+  if (uc->binary)
+    {
+      svn_stringbuf_t *buf = svn_stringbuf_create_empty(pool);
+
+      svn_frames__append_cstring(buf, child->name);
+      svn_frames__append_cstring(buf, copyfrom_path);
+      svn_frames__append_int(buf, copyfrom_path ? copyfrom_revision
+                                                : SVN_INVALID_REVNUM);
+
+      if (! is_dir)
+        {
+          svn_checksum_t *sha1_checksum;
+
+          SVN_ERR(svn_fs_file_checksum(&sha1_checksum, svn_checksum_sha1,
+                                       uc->rev_root,
+                                       get_real_fs_path(child, pool),
+                                       FALSE, pool));
+          svn_frames__append_cstring(buf,
+                                     svn_checksum_to_cstring(sha1_checksum,
+                                                             pool));
+        }
+
+      SVN_ERR(send_frame_buf(uc, is_dir ? SVN_DAV__FRAME_ADD_DIR
+                                        : SVN_DAV__FRAME_ADD_FILE,
+                             buf));
+    }
+  else if (uc->resource_walk)
     {
       SVN_ERR(dav_svn__brigade_printf(child->uc->bb, child->uc->output,
                                       "<S:resource path=\"%s\">" DEBUG_CR,
@@ -427,12 +496,27 @@ open_helper(svn_boolean_t is_dir,
             void **child_baton)
 {
   item_baton_t *child = make_child_baton(parent, path, pool);
-  const char *qname = apr_xml_quote_string(pool, child->name, 1);
 
-  SVN_ERR(dav_svn__brigade_printf(child->uc->bb, child->uc->output,
-                                  "<S:open-%s name=\"%s\""
-                                  " rev=\"%ld\">" DEBUG_CR,
-                                  DIR_OR_FILE(is_dir), qname, base_revision));
+  if (child->uc->binary)
+    {
+      svn_stringbuf_t *buf = svn_stringbuf_create_empty(pool);
+
+      svn_frames__append_cstring(buf, child->name);
+      svn_frames__append_int(buf, base_revision);
+      SVN_ERR(send_frame_buf(child->uc, is_dir ? SVN_DAV__FRAME_OPEN_DIR
+                                               : SVN_DAV__FRAME_OPEN_FILE,
+                             buf));
+    }
+  else
+    {
+      const char *qname = apr_xml_quote_string(pool, child->name, 1);
+
+      SVN_ERR(dav_svn__brigade_printf(child->uc->bb, child->uc->output,
+                                      "<S:open-%s name=\"%s\""
+                                      " rev=\"%ld\">" DEBUG_CR,
+                                      DIR_OR_FILE(is_dir), qname,
+                                      base_revision));
+    }
   SVN_ERR(send_vsn_url(child, pool));
   *child_baton = child;
   return SVN_NO_ERROR;
@@ -445,6 +529,12 @@ close_helper(svn_boolean_t is_dir, item_baton_t *baton, apr_pool_t *pool)
   if (baton->uc->resource_walk)
     return SVN_NO_ERROR;
 
+  /* Binary frames are only used in send-all mode, which transmits
+     property removals inline.  Files are closed by upd_close_file(). */
+  if (baton->uc->binary)
+    return svn_error_trace(send_frame(baton->uc, SVN_DAV__FRAME_CLOSE_DIR,
+                                      NULL, 0));
+
   /* ### ack!  binary names won't float here! */
   /* If this is a copied file/dir, we can have removed props. */
   if (baton->removed_props && baton->copyfrom)
@@ -480,7 +570,15 @@ close_helper(svn_boolean_t is_dir, item_baton_t *baton, apr_pool_t *pool)
 static svn_error_t *
 maybe_start_update_report(update_ctx_t *uc)
 {
-  if ((! uc->resource_walk) && (! uc->started_update))
+  if (uc->binary && (! uc->started_update))
+    {
+      SVN_ERR(dav_svn__brigade_write(uc->bb, uc->output,
+                                     SVN_DAV__BINARY_UPDATE_MAGIC,
+                                     SVN_DAV__BINARY_UPDATE_MAGIC_LEN));
+
+      uc->started_update = TRUE;
+    }
+  else if ((! uc->resource_walk) && (! uc->started_update))
     {
       SVN_ERR(dav_svn__brigade_printf(
                   uc->bb, uc->output,
@@ -506,7 +604,14 @@ upd_set_target_revision(void *edit_baton,
 
   SVN_ERR(maybe_start_update_report(uc));
 
-  if (! uc->resource_walk)
+  if (uc->binary)
+    {
+      svn_stringbuf_t *buf = svn_stringbuf_create_empty(pool);
+
+      svn_frames__append_int(buf, target_revision);
+      SVN_ERR(send_frame_buf(uc, SVN_DAV__FRAME_TARGET_REVISION, buf));
+    }
+  else if (! uc->resource_walk)
     SVN_ERR(dav_svn__brigade_printf(uc->bb, uc->output,
                                     "<S:target-revision rev=\"%ld\"/>"
                                     DEBUG_CR, target_revision));
@@ -537,7 +642,14 @@ upd_open_root(void *edit_baton,
 
   SVN_ERR(maybe_start_update_report(uc));
 
-  if (uc->resource_walk)
+  if (uc->binary)
+    {
+      svn_stringbuf_t *buf = svn_stringbuf_create_empty(pool);
+
+      svn_frames__append_int(buf, base_revision);
+      SVN_ERR(send_frame_buf(uc, SVN_DAV__FRAME_OPEN_ROOT, buf));
+    }
+  else if (uc->resource_walk)
     SVN_ERR(dav_svn__brigade_printf(uc->bb, uc->output,
                                     "<S:resource path=\"%s\">" DEBUG_CR,
                                     apr_xml_quote_string(pool, b->path3, 1)));
@@ -566,9 +678,20 @@ upd_delete_entry(const char *path,
                  apr_pool_t *pool)
 {
   item_baton_t *parent = parent_baton;
-  const char *qname = apr_xml_quote_string(pool,
-                                           svn_relpath_basename(path, NULL),
-                                           1);
+  const char *qname;
+
+  if (parent->uc->binary)
+    {
+      svn_stringbuf_t *buf = svn_stringbuf_create_empty(pool);
+
+      svn_frames__append_cstring(buf, svn_relpath_basename(path, NULL));
+      svn_frames__append_int(buf, revision);
+      return svn_error_trace(send_frame_buf(parent->uc,
+                                            SVN_DAV__FRAME_DELETE_ENTRY,
+                                            buf));
+    }
+
+  qname = apr_xml_quote_string(pool, svn_relpath_basename(path, NULL), 1);
   return dav_svn__brigade_printf(parent->uc->bb, parent->uc->output,
                                  "<S:delete-entry name=\"%s\" rev=\"%ld\"/>"
                                    DEBUG_CR, qname, revision);
@@ -609,6 +732,20 @@ send_propchange(item_baton_t *b,
 {
   const char *qname;
 
+  if (b->uc->binary)
+    {
+      svn_stringbuf_t *buf = svn_stringbuf_create_empty(pool);
+
+      svn_frames__append_cstring(buf, name);
+      if (value)
+        svn_frames__append_string(buf, value->data, value->len);
+
+      return svn_error_trace(send_frame_buf(b->uc,
+                                            value ? SVN_DAV__FRAME_SET_PROP
+                                                  : SVN_DAV__FRAME_REMOVE_PROP,
+                                            buf));
+    }
+
   /* Ensure that the property name is XML-safe. */
   qname = apr_xml_quote_string(pool, name, 1);
 
@@ -760,6 +897,8 @@ struct window_handler_baton
 
   const char *base_checksum; /* For transfer as part of the S:txdelta element */
 
+  apr_pool_t *pool; /* For the S:txdelta frame */
+
   /* The _real_ window handler and baton. */
   svn_txdelta_window_handler_t handler;
   void *handler_baton;
@@ -776,7 +915,14 @@ window_handler(svn_txdelta_window_t *window, void *baton)
     {
       wb->seen_first_window = TRUE;
 
-      if (!wb->base_checksum)
+      if (wb->uc->binary)
+        {
+          svn_stringbuf_t *buf = svn_stringbuf_create_empty(wb->pool);
+
+          svn_frames__append_cstring(buf, wb->base_checksum);
+          SVN_ERR(send_frame_buf(wb->uc, SVN_DAV__FRAME_TXDELTA, buf));
+        }
+      else if (!wb->base_checksum)
         SVN_ERR(dav_svn__brigade_puts(wb->uc->bb, wb->uc->output,
                                       "<S:txdelta>"));
       else
@@ -789,8 +935,10 @@ window_handler(svn_txdelta_window_t *window, void *baton)
 
   if (window == NULL)
     {
-      SVN_ERR(dav_svn__brigade_puts(wb->uc->bb, wb->uc->output,
-                                    "</S:txdelta>"));
+      /* Closing the svndiff stream sent SVN_DAV__FRAME_TXDELTA_END. */
+      if (! wb->uc->binary)
+        SVN_ERR(dav_svn__brigade_puts(wb->uc->bb, wb->uc->output,
+                                      "</S:txdelta>"));
     }
 
   return SVN_NO_ERROR;
@@ -805,7 +953,7 @@ upd_apply_textdelta(void *file_baton,
 {
   item_baton_t *file = file_baton;
   struct window_handler_baton *wb;
-  svn_stream_t *base64_stream;
+  svn_stream_t *svndiff_stream;
 
   /* Store the base checksum and the fact the file's text changed. */
   file->base_checksum = apr_pstrdup(file->pool, base_checksum);
@@ -824,12 +972,21 @@ upd_apply_textdelta(void *file_baton,
   wb->seen_first_window = FALSE;
   wb->uc = file->uc;
   wb->base_checksum = file->base_checksum;
-  base64_stream = dav_svn__make_base64_output_stream(wb->uc->bb,
-                                                     wb->uc->output,
-                                                     file->pool);
+  wb->pool = file->pool;
+
+  /* Binary frames carry the svndiff data as is. */
+  if (file->uc->binary)
+    svndiff_stream = svn_frames__data_stream(file->uc->frames,
+                                             SVN_DAV__FRAME_SVNDIFF,
+                                             SVN_DAV__FRAME_TXDELTA_END,
+                                             file->pool);
+  else
+    svndiff_stream = dav_svn__make_base64_output_stream(wb->uc->bb,
+                                                        wb->uc->output,
+                                                        file->pool);
 
   svn_txdelta_to_svndiff3(&(wb->handler), &(wb->handler_baton),
-                          base64_stream, file->uc->svndiff_version,
+                          svndiff_stream, file->uc->svndiff_version,
                           file->uc->compression_level, file->pool);
 
   *handler = window_handler;
@@ -844,6 +1001,15 @@ upd_close_file(void *file_baton, const char *text_checksum, apr_pool_t *pool)
 {
   item_baton_t *file = file_baton;
 
+  if (file->uc->binary)
+    {
+      svn_stringbuf_t *buf = svn_stringbuf_create_empty(pool);
+
+      svn_frames__append_cstring(buf, text_checksum);
+      return svn_error_trace(send_frame_buf(file->uc,
+                                            SVN_DAV__FRAME_CLOSE_FILE, buf));
+    }
+
   /* If we are not in "send all" mode, and this file is not a new
      addition or didn't otherwise have changed text, tell the client
      to fetch it. */
@@ -979,6 +1145,7 @@ dav_svn__update_report(const dav_resource *resource,
   svn_boolean_t resource_walk = FALSE;
   svn_boolean_t ignore_ancestry = FALSE;
   svn_boolean_t send_copyfrom_args = FALSE;
+  svn_boolean_t binary_frames = FALSE;
   dav_svn__authz_read_baton arb;
   apr_pool_t *subpool = svn_pool_create(resource->pool);
 
@@ -1021,7 +1188,11 @@ dav_svn__update_report(const dav_resource *resource,
             {
               uc.send_all = TRUE;
               uc.include_props = TRUE;
-              break;
+            }
+          else if ((strcmp(this_attr->name, SVN_DAV__BINARY_FRAMES) == 0)
+                   && (strcmp(this_attr->value, "true") == 0))
+            {
+              binary_frames = TRUE;
             }
         }
     }
@@ -1248,6 +1419,17 @@ dav_svn__update_report(const dav_resource *resource,
   if (! uc.send_all)
     text_deltas = FALSE;
 
+  /* Binary frames are only defined for send-all responses without the
+     (long obsolete) resource walk.  Tell the client which format it is
+     going to get; it falls back to XML for anything but our MIME type. */
+  if (binary_frames && uc.send_all && (! resource_walk))
+    {
+      uc.binary = TRUE;
+      uc.frames = dav_svn__make_output_stream(uc.bb, uc.output,
+                                              resource->pool);
+      ap_set_content_type(resource->info->r, SVN_DAV__BINARY_UPDATE_MIME_TYPE);
+    }
+
   /* When we call svn_repos_finish_report, it will ultimately run
      dir_delta() between REPOS_PATH/TARGET and TARGET_PATH.  In the
      case of an update or status, these paths should be identical.  In
@@ -1454,6 +1636,13 @@ dav_svn__update_report(const dav_resource *resource,
 
   if (serr)
     {
+      /* The response is already under way, so the client will only see
+         the HTTP status code if nothing has been sent yet.  Binary frames
+         let us tell it what went wrong in any case. */
+      if (uc.binary && uc.started_update)
+        svn_error_clear(svn_frames__write_error(uc.frames, serr,
+                                                resource->pool));
+
       derr = dav_svn__convert_err(serr, HTTP_INTERNAL_SERVER_ERROR,
                                   "A failure occurred while "
                                   "driving the update report editor",
@@ -1548,8 +1737,13 @@ dav_svn__update_report(const dav_resource *resource,
      started in the first place. */
   if (uc.started_update)
     {
-      if ((serr = dav_svn__brigade_puts(uc.bb, uc.output,
-                                        "</S:update-report>" DEBUG_CR)))
+      if (uc.binary)
+        serr = send_frame(&uc, SVN_DAV__FRAME_END, NULL, 0);
+      else
+        serr = dav_svn__brigade_puts(uc.bb, uc.output,
+                                     "</S:update-report>" DEBUG_CR);
+
+      if (serr)
         {
           derr = dav_svn__convert_err(serr, HTTP_INTERNAL_SERVER_ERROR,
                                       "Unable to complete update report.",
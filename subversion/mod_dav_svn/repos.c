@@ -1768,7 +1768,12 @@ negotiate_encoding_prefs(request_rec *r, int *svndiff_version)
     {
       struct accept_rec rec = APR_ARRAY_IDX(encoding_prefs, i,
                                             struct accept_rec);
-      if (strcmp(rec.name, "svndiff1") == 0)
+      if (strcmp(rec.name, "svndiff3") == 0)
+        {
+          *svndiff_version = 3;
+          break;
+        }
+      else if (strcmp(rec.name, "svndiff1") == 0)
         {
           *svndiff_version = 1;
           break;
@@ -3213,15 +3218,66 @@ set_headers(request_rec *r, const dav_resource *resource)
          Content-Length header. */
       if (! resource->info->keyword_subst)
         {
-          serr = svn_fs_file_length(&length,
-                                    resource->info->root.root,
-                                    resource->info->repos_path,
-                                    resource->pool);
-          if (serr != NULL)
+          svn_boolean_t gzipped = FALSE;
+
+          /* Bodies that never change may come from the response cache. */
+          if (is_cacheable(r, resource))
             {
-              return dav_svn__convert_err(serr, HTTP_INTERNAL_SERVER_ERROR,
-                                          "could not fetch the resource length",
-                                          resource->pool);
+              serr = dav_svn__response_cache_open(
+                                        &resource->info->cached_body,
+                                        &resource->info->cached_body_size,
+                                        &gzipped, resource, resource->pool);
+              if (serr != NULL)
+                {
+                  /* The cache is just an optimization. */
+                  ap_log_rerror(APLOG_MARK, APLOG_WARNING, serr->apr_err, r,
+                                "mod_dav_svn: response cache: %s",
+                                serr->message ? serr->message
+                                              : "(no more info)");
+                  svn_error_clear(serr);
+                  resource->info->cached_body = NULL;
+                  gzipped = FALSE;
+                }
+            }
+
+          if (resource->info->cached_body)
+            {
+              length = resource->info->cached_body_size;
+
+              if (dav_svn__get_compression_level(r) > 0)
+                apr_table_mergen(r->headers_out, "Vary", "Accept-Encoding");
+
+              if (gzipped)
+                {
+                  const char *etag = apr_table_get(r->headers_out, "ETag");
+                  apr_size_t etag_len = etag ? strlen(etag) : 0;
+
+                  apr_table_setn(r->headers_out, "Content-Encoding", "gzip");
+
+                  /* Different encodings need different strong ETags. */
+                  if (etag_len > 1 && etag[etag_len - 1] == '"')
+                    apr_table_setn(r->headers_out, "ETag",
+                                   apr_pstrcat(resource->pool,
+                                               apr_pstrndup(resource->pool,
+                                                            etag,
+                                                            etag_len - 1),
+                                               "-gzip\"", SVN_VA_NULL));
+                }
+            }
+          else
+            {
+              serr = svn_fs_file_length(&length,
+                                        resource->info->root.root,
+                                        resource->info->repos_path,
+                                        resource->pool);
+              if (serr != NULL)
+                {
+                  return dav_svn__convert_err(serr,
+                                              HTTP_INTERNAL_SERVER_ERROR,
+                                              "could not fetch the resource "
+                                              "length",
+                                              resource->pool);
+                }
             }
           ap_set_content_length(r, (apr_off_t) length);
         }
@@ -3700,6 +3756,27 @@ deliver(const dav_resource *resource, ap_filter_t *unused)
     }
 
 
+  /* set_headers() may have found the body in the response cache. */
+  if (resource->info->cached_body)
+    {
+      bb = apr_brigade_create(resource->pool,
+                              dav_svn__output_get_bucket_alloc(output));
+      apr_brigade_insert_file(bb, resource->info->cached_body, 0,
+                              resource->info->cached_body_size,
+                              resource->pool);
+
+      bkt = apr_bucket_eos_create(dav_svn__output_get_bucket_alloc(output));
+      APR_BRIGADE_INSERT_TAIL(bb, bkt);
+      serr = dav_svn__output_pass_brigade(output, bb);
+      apr_brigade_destroy(bb);
+      if (serr != NULL)
+        return dav_svn__convert_err(serr, HTTP_INTERNAL_SERVER_ERROR,
+                                    "Could not write data to filter.",
+                                    resource->pool);
+
+      return NULL;
+    }
+
   /* If we have a base for a delta, then we want to compute an svndiff
      between the provided base and the requested resource. For a simple
      request, then we just grab the file contents. */
@@ -0,0 +1,558 @@
+/*
+ * response_cache.c: on-disk cache of GET responses for immutable resources
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* The contents of a file at a fixed revision never change, so the body of
+ * a GET response for it may be stored on disk and served from there with
+ * a single file bucket instead of being reconstructed by the FS for every
+ * request.  Along with it, we store a gzip-encoded variant for clients
+ * sending "Accept-Encoding: gzip", saving mod_deflate the per-request
+ * compression.
+ *
+ * Entries are keyed by repository UUID and the SHA-1 of the contents:
+ *
+ *   SVNResponseCacheDir/UUID/XX/XXYYZZ...     the plain body
+ *   SVNResponseCacheDir/UUID/XX/XXYYZZ....gz  its gzip-encoded variant
+ *
+ * The variant is only kept if it is smaller than the plain body and it is
+ * installed first, i.e. the presence of the plain body indicates that the
+ * entry is complete.  The modification times of the files serve as LRU
+ * timestamps for svn_io__lru_dir_add() when evicting entries to keep the
+ * cache within its budget.
+ *
+ * Requests missing the cache are served from the FS as usual.  They only
+ * queue the entry for addition by a background thread, so that they don't
+ * have to wait for it being written and compressed.
+ *
+ * The cache may be shared by any number of httpd processes.  All updates
+ * are atomic renames and removals, and stale reads are impossible since
+ * the contents of an entry are determined by its name.
+ */
+
+#include <zlib.h>
+
+#include <apr_buckets.h>
+#include <apr_file_io.h>
+#include <apr_strings.h>
+#include <apr_thread_pool.h>
+
+#include <httpd.h>
+#include <http_log.h>
+#include <http_protocol.h>
+
+#include "svn_checksum.h"
+#include "svn_dirent_uri.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+#include "svn_repos.h"
+
+#include "private/svn_error_private.h"
+#include "private/svn_io_private.h"
+#include "private/svn_subr_private.h"
+
+#include "dav_svn.h"
+
+
+/* File name extension of the gzip-encoded variant of a cached body. */
+#define GZIP_EXT ".gz"
+
+/* Bodies larger than the cache budget divided by this won't be cached. */
+#define MAX_ENTRY_FRACTION 8
+
+/* Don't update the LRU timestamps of entries more often than this. */
+#define TOUCH_INTERVAL apr_time_from_sec(3600)
+
+
+/* Baton for a stream that gzip-encodes all data written to it and
+   passes the result on to TARGET. */
+typedef struct gzip_baton_t
+{
+  z_stream zs;
+  svn_stream_t *target;
+  char buffer[SVN__STREAM_CHUNK_SIZE];
+} gzip_baton_t;
+
+/* Run BATON's pending input through deflate() with the zlib FLUSH mode
+   and write the output to its target. */
+static svn_error_t *
+gzip_deflate(gzip_baton_t *baton,
+             int flush)
+{
+  int zerr;
+
+  do
+    {
+      apr_size_t len;
+
+      baton->zs.next_out = (Bytef *)baton->buffer;
+      baton->zs.avail_out = sizeof(baton->buffer);
+
+      zerr = deflate(&baton->zs, flush);
+      if (zerr != Z_OK && zerr != Z_STREAM_END && zerr != Z_BUF_ERROR)
+        return svn_error_trace(svn_error__wrap_zlib(zerr, "deflate",
+                                                    baton->zs.msg));
+
+      len = sizeof(baton->buffer) - baton->zs.avail_out;
+      if (len)
+        SVN_ERR(svn_stream_write(baton->target, baton->buffer, &len));
+    }
+  while (baton->zs.avail_out == 0
+         || (flush == Z_FINISH && zerr != Z_STREAM_END));
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_write_fn_t for gzip_baton_t. */
+static svn_error_t *
+write_gzip(void *baton,
+           const char *data,
+           apr_size_t *len)
+{
+  gzip_baton_t *gb = baton;
+
+  gb->zs.next_in = (Bytef *)data;
+  gb->zs.avail_in = (uInt)*len;
+
+  return svn_error_trace(gzip_deflate(gb, Z_NO_FLUSH));
+}
+
+/* Implements svn_close_fn_t for gzip_baton_t. */
+static svn_error_t *
+close_gzip(void *baton)
+{
+  gzip_baton_t *gb = baton;
+
+  gb->zs.next_in = NULL;
+  gb->zs.avail_in = 0;
+  SVN_ERR(gzip_deflate(gb, Z_FINISH));
+
+  return svn_error_trace(svn_stream_close(gb->target));
+}
+
+/* Pool cleanup function releasing the zlib state of a gzip_baton_t. */
+static apr_status_t
+cleanup_gzip(void *baton)
+{
+  gzip_baton_t *gb = baton;
+  deflateEnd(&gb->zs);
+
+  return APR_SUCCESS;
+}
+
+/* Set *STREAM to a writable stream, allocated in POOL, that gzip-encodes
+   all data at compression LEVEL and writes it to TARGET.  Closing *STREAM
+   closes TARGET as well. */
+static svn_error_t *
+gzip_stream_create(svn_stream_t **stream,
+                   svn_stream_t *target,
+                   int level,
+                   apr_pool_t *pool)
+{
+  gzip_baton_t *gb = apr_pcalloc(pool, sizeof(*gb));
+  int zerr;
+
+  /* Adding 16 to the window bits selects the gzip wrapper. */
+  zerr = deflateInit2(&gb->zs, level, Z_DEFLATED, 16 + MAX_WBITS, 8,
+                      Z_DEFAULT_STRATEGY);
+  if (zerr != Z_OK)
+    return svn_error_trace(svn_error__wrap_zlib(zerr, "deflateInit2",
+                                                gb->zs.msg));
+
+  apr_pool_cleanup_register(pool, gb, cleanup_gzip, apr_pool_cleanup_null);
+  gb->target = target;
+
+  *stream = svn_stream_create(gb, pool);
+  svn_stream_set_write(*stream, write_gzip);
+  svn_stream_set_close(*stream, close_gzip);
+
+  return SVN_NO_ERROR;
+}
+
+/* Store the contents of REPOS_PATH in ROOT in the cache as PATH.  If LEVEL
+   is not 0, also store its gzip-encoded variant, compressed at LEVEL, unless
+   that turns out to be no smaller.  Set *ADDED_SIZE to the number of bytes
+   added to the cache.  Use POOL for temporary allocations. */
+static svn_error_t *
+add_entry(svn_filesize_t *added_size,
+          const char *path,
+          svn_fs_root_t *root,
+          const char *repos_path,
+          int level,
+          apr_pool_t *pool)
+{
+  const char *dir = svn_dirent_dirname(path, pool);
+  svn_stream_t *contents;
+  svn_stream_t *plain;
+  svn_stream_t *target;
+  const char *plain_tmp;
+  const char *gzip_tmp = NULL;
+  apr_finfo_t plain_info;
+
+  SVN_ERR(svn_io_make_dir_recursively(dir, pool));
+  SVN_ERR(svn_fs_file_contents(&contents, root, repos_path, pool));
+
+  SVN_ERR(svn_stream_open_unique(&plain, &plain_tmp, dir,
+                                 svn_io_file_del_on_pool_cleanup,
+                                 pool, pool));
+  target = plain;
+
+  if (level > 0)
+    {
+      svn_stream_t *gzip_file;
+      svn_stream_t *gzipped;
+
+      SVN_ERR(svn_stream_open_unique(&gzip_file, &gzip_tmp, dir,
+                                     svn_io_file_del_on_pool_cleanup,
+                                     pool, pool));
+      SVN_ERR(gzip_stream_create(&gzipped, gzip_file, level, pool));
+      target = svn_stream_tee(plain, gzipped, pool);
+    }
+
+  SVN_ERR(svn_stream_copy3(contents, target, NULL, NULL, pool));
+
+  SVN_ERR(svn_io_stat(&plain_info, plain_tmp, APR_FINFO_SIZE, pool));
+  *added_size = plain_info.size;
+
+  if (gzip_tmp)
+    {
+      apr_finfo_t gzip_info;
+
+      SVN_ERR(svn_io_stat(&gzip_info, gzip_tmp, APR_FINFO_SIZE, pool));
+
+      if (gzip_info.size < plain_info.size)
+        {
+          SVN_ERR(svn_io_file_rename2(gzip_tmp,
+                                      apr_pstrcat(pool, path, GZIP_EXT,
+                                                  SVN_VA_NULL),
+                                      FALSE, pool));
+          *added_size += gzip_info.size;
+        }
+    }
+
+  /* This completes the entry. */
+  SVN_ERR(svn_io_file_rename2(plain_tmp, path, FALSE, pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* A cache entry to be added. */
+typedef struct add_job_t
+{
+  /* Pool containing this job, destroyed when the job is done. */
+  apr_pool_t *pool;
+
+  /* Where the entry goes and the cache it belongs to. */
+  const char *path;
+  const char *cache_dir;
+  apr_int64_t cache_size;
+
+  /* Compression level of the gzip variant, 0 for none. */
+  int level;
+
+  /* The repository on disk, the revision and the file in it. */
+  const char *fs_path;
+  svn_revnum_t rev;
+  const char *repos_path;
+} add_job_t;
+
+/* Add the entry described by JOB, taking its contents from ROOT, unless it
+   is present already.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+run_add_job(const add_job_t *job,
+            svn_fs_root_t *root,
+            apr_pool_t *scratch_pool)
+{
+  svn_node_kind_t kind;
+  svn_filesize_t added_size;
+
+  /* Requests for the same contents may have queued it several times. */
+  SVN_ERR(svn_io_check_path(job->path, &kind, scratch_pool));
+  if (kind != svn_node_none)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(add_entry(&added_size, job->path, root, job->repos_path,
+                    job->level, scratch_pool));
+
+  return svn_error_trace(svn_io__lru_dir_add(job->cache_dir, 2,
+                                             job->cache_size, added_size,
+                                             scratch_pool));
+}
+
+#if APR_HAS_THREADS
+
+/* Don't queue more than this many additions per process.  The bodies of
+   further responses will not be cached. */
+#define MAX_QUEUED_JOBS 16
+
+/* Runs the add_job_t instances of this process in the background, NULL if
+   it could not be created.  A single thread suffices and serializes the
+   calls to svn_io__lru_dir_add(), as they need to be within a process. */
+static apr_thread_pool_t *add_thread = NULL;
+
+/* The server to log background errors for. */
+static server_rec *add_thread_server = NULL;
+
+/* Pool pre-cleanup function stopping ADD_THREAD.  Queued jobs get
+   discarded. */
+static apr_status_t
+stop_add_thread(void *data)
+{
+  apr_thread_pool_t *thread = add_thread;
+  if (! thread)
+    return APR_SUCCESS;
+
+  add_thread = NULL;
+  return apr_thread_pool_destroy(thread);
+}
+
+/* Thread function executing the add_job_t given by DATA. */
+static void *APR_THREAD_FUNC
+add_job_thread(apr_thread_t *tid,
+               void *data)
+{
+  add_job_t *job = data;
+  svn_repos_t *repos;
+  svn_fs_root_t *root;
+  svn_error_t *serr;
+
+  serr = svn_repos_open3(&repos, job->fs_path, NULL, job->pool, job->pool);
+  if (! serr)
+    serr = svn_fs_revision_root(&root, svn_repos_fs(repos), job->rev,
+                                job->pool);
+  if (! serr)
+    serr = run_add_job(job, root, job->pool);
+
+  if (serr)
+    {
+      ap_log_error(APLOG_MARK, APLOG_WARNING, serr->apr_err,
+                   add_thread_server,
+                   "mod_dav_svn: response cache: %s",
+                   serr->message ? serr->message : "(no more info)");
+      svn_error_clear(serr);
+    }
+
+  svn_pool_destroy(job->pool);
+  return NULL;
+}
+
+#endif
+
+void
+dav_svn__response_cache_child_init(apr_pool_t *p,
+                                   server_rec *s)
+{
+#if APR_HAS_THREADS
+  apr_status_t status = apr_thread_pool_create(&add_thread, 0, 1, p);
+  if (status)
+    {
+      ap_log_error(APLOG_MARK, APLOG_WARNING, status, s,
+                   "mod_dav_svn: can't create response cache thread");
+      add_thread = NULL;
+      return;
+    }
+
+  /* The thread must be gone before the sub-pools of P, see batch_fsync.c. */
+  apr_pool_pre_cleanup_register(p, NULL, stop_add_thread);
+  add_thread_server = s;
+#endif
+}
+
+/* Add the contents of RESOURCE as entry PATH to CACHE_DIR, which is limited
+   to CACHE_SIZE bytes, with a gzip variant compressed at LEVEL.  Do that
+   in the background, if possible.  Use SCRATCH_POOL for temporary
+   allocations. */
+static svn_error_t *
+schedule_add_entry(const dav_resource *resource,
+                   const char *path,
+                   const char *cache_dir,
+                   apr_int64_t cache_size,
+                   int level,
+                   apr_pool_t *scratch_pool)
+{
+#if APR_HAS_THREADS
+  apr_pool_t *job_pool;
+  add_job_t *job;
+  apr_status_t status;
+
+  if (! add_thread || ! SVN_IS_VALID_REVNUM(resource->info->root.rev)
+      || apr_thread_pool_tasks_count(add_thread) >= MAX_QUEUED_JOBS)
+    return SVN_NO_ERROR;
+
+  /* The job outlives the request. */
+  job_pool = svn_pool_create(NULL);
+  job = apr_pcalloc(job_pool, sizeof(*job));
+  job->pool = job_pool;
+  job->path = apr_pstrdup(job_pool, path);
+  job->cache_dir = apr_pstrdup(job_pool, cache_dir);
+  job->cache_size = cache_size;
+  job->level = level;
+  job->fs_path = apr_pstrdup(job_pool, resource->info->repos->fs_path);
+  job->rev = resource->info->root.rev;
+  job->repos_path = apr_pstrdup(job_pool, resource->info->repos_path);
+
+  status = apr_thread_pool_push(add_thread, add_job_thread, job,
+                                APR_THREAD_TASK_PRIORITY_NORMAL, NULL);
+  if (status)
+    {
+      svn_pool_destroy(job_pool);
+      return svn_error_wrap_apr(status,
+                                "Can't queue response cache addition");
+    }
+
+  return SVN_NO_ERROR;
+#else
+  /* Single-threaded servers have nothing but the request to do it. */
+  add_job_t job = { 0 };
+
+  job.path = path;
+  job.cache_dir = cache_dir;
+  job.cache_size = cache_size;
+  job.level = level;
+  job.repos_path = resource->info->repos_path;
+
+  return svn_error_trace(run_add_job(&job, resource->info->root.root,
+                                     scratch_pool));
+#endif
+}
+
+/* Return TRUE if the client of request R accepts gzip-encoded responses. */
+static svn_boolean_t
+accepts_gzip(request_rec *r)
+{
+  const char *accept_encoding;
+
+  /* Honor the opt-out used with mod_deflate. */
+  if (apr_table_get(r->subprocess_env, "no-gzip"))
+    return FALSE;
+
+  accept_encoding = apr_table_get(r->headers_in, "Accept-Encoding");
+
+  return accept_encoding && ap_find_token(r->pool, accept_encoding, "gzip");
+}
+
+/* Open the cache file at PATH for reading as *FILE, allocated in POOL,
+   and set *SIZE to its length.  If it does not exist, set *FILE to NULL. */
+static svn_error_t *
+open_cache_file(apr_file_t **file,
+                apr_off_t *size,
+                const char *path,
+                apr_pool_t *pool)
+{
+  apr_finfo_t finfo;
+  svn_error_t *err;
+
+  err = svn_io_file_open(file, path, APR_READ | APR_BINARY, APR_OS_DEFAULT,
+                         pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      *file = NULL;
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  SVN_ERR(svn_io_file_info_get(&finfo, APR_FINFO_SIZE | APR_FINFO_MTIME,
+                               *file, pool));
+  *size = finfo.size;
+
+  /* Mark the entry as recently used. */
+  if (finfo.mtime + TOUCH_INTERVAL < apr_time_now())
+    svn_error_clear(svn_io_set_file_affected_time(apr_time_now(), path,
+                                                  pool));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+dav_svn__response_cache_open(apr_file_t **file,
+                             apr_off_t *size,
+                             svn_boolean_t *gzipped,
+                             const dav_resource *resource,
+                             apr_pool_t *pool)
+{
+  request_rec *r = resource->info->r;
+  const char *cache_dir = dav_svn__get_response_cache_dir(r);
+  int level = dav_svn__get_compression_level(r);
+  svn_checksum_t *checksum;
+  const char *uuid;
+  const char *hexdigest;
+  const char *path;
+
+  *file = NULL;
+  *size = 0;
+  *gzipped = FALSE;
+
+  if (! cache_dir)
+    return SVN_NO_ERROR;
+
+  /* Older repositories don't store SHA-1 checksums for all contents. */
+  SVN_ERR(svn_fs_file_checksum(&checksum, svn_checksum_sha1,
+                               resource->info->root.root,
+                               resource->info->repos_path, FALSE, pool));
+  if (! checksum)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_fs_get_uuid(resource->info->repos->fs, &uuid, pool));
+  hexdigest = svn_checksum_to_cstring_display(checksum, pool);
+  path = svn_dirent_join_many(pool, cache_dir, uuid,
+                              apr_pstrndup(pool, hexdigest, 2), hexdigest,
+                              SVN_VA_NULL);
+
+  SVN_ERR(open_cache_file(file, size, path, pool));
+  if (! *file)
+    {
+      apr_int64_t cache_size = dav_svn__get_response_cache_size(r);
+      svn_filesize_t length;
+
+      if (r->header_only)
+        return SVN_NO_ERROR;
+
+      SVN_ERR(svn_fs_file_length(&length, resource->info->root.root,
+                                 resource->info->repos_path, pool));
+      if (length > cache_size / MAX_ENTRY_FRACTION)
+        return SVN_NO_ERROR;
+
+      /* This request gets served from the FS.  Later ones will find the
+         entry, once added. */
+      return svn_error_trace(schedule_add_entry(resource, path, cache_dir,
+                                                cache_size, level, pool));
+    }
+
+  if (level > 0 && accepts_gzip(r))
+    {
+      apr_file_t *gzip_file;
+      apr_off_t gzip_size;
+
+      SVN_ERR(open_cache_file(&gzip_file, &gzip_size,
+                              apr_pstrcat(pool, path, GZIP_EXT, SVN_VA_NULL),
+                              pool));
+      if (gzip_file)
+        {
+          SVN_ERR(svn_io_file_close(*file, pool));
+          *file = gzip_file;
+          *size = gzip_size;
+          *gzipped = TRUE;
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
@@ -676,6 +676,33 @@ brigade_write_fn(void *baton, const char *data, apr_size_t *len)
 }
 
 
+/* This implements 'svn_write_fn_t'. */
+static svn_error_t *
+output_write_fn(void *baton, const char *data, apr_size_t *len)
+{
+  struct brigade_write_baton *wb = baton;
+
+  return svn_error_trace(dav_svn__brigade_write(wb->bb, wb->output,
+                                                data, *len));
+}
+
+
+svn_stream_t *
+dav_svn__make_output_stream(apr_bucket_brigade *bb,
+                            dav_svn__output *output,
+                            apr_pool_t *pool)
+{
+  struct brigade_write_baton *wb = apr_palloc(pool, sizeof(*wb));
+  svn_stream_t *stream = svn_stream_create(wb, pool);
+
+  wb->bb = bb;
+  wb->output = output;
+  svn_stream_set_write(stream, output_write_fn);
+
+  return stream;
+}
+
+
 svn_stream_t *
 dav_svn__make_base64_output_stream(apr_bucket_brigade *bb,
                                    dav_svn__output *output,
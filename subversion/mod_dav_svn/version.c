@@ -153,6 +153,9 @@ get_vsn_options(apr_pool_t *p, apr_text_header *phdr)
   apr_text_append(p, phdr, SVN_DAV_NS_DAV_SVN_INLINE_PROPS);
   apr_text_append(p, phdr, SVN_DAV_NS_DAV_SVN_REVERSE_FILE_REVS);
   apr_text_append(p, phdr, SVN_DAV_NS_DAV_SVN_SVNDIFF1);
+  apr_text_append(p, phdr, SVN_DAV_NS_DAV_SVN_SVNDIFF3);
+  apr_text_append(p, phdr, SVN_DAV_NS_DAV_SVN_SERVER_BLAME);
+  apr_text_append(p, phdr, SVN_DAV_NS_DAV_SVN_BINARY_UPDATE);
   /* Mergeinfo is a special case: here we merely say that the server
    * knows how to handle mergeinfo -- whether the repository does too
    * is a separate matter.
@@ -1132,6 +1135,10 @@ deliver_report(request_rec *r,
         {
           return dav_svn__file_revs_report(resource, doc, output);
         }
+      else if (strcmp(doc->root->name, "blame-report") == 0)
+        {
+          return dav_svn__blame_report(resource, doc, output);
+        }
       else if (strcmp(doc->root->name, "get-locks-report") == 0)
         {
           return dav_svn__get_locks_report(resource, doc, output);
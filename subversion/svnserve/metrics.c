@@ -0,0 +1,443 @@
+/*
+ * metrics.c : Implementation of the svnserve command statistics
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+
+
+#define APR_WANT_STRFUNC
+#include <apr_want.h>
+#include <apr_global_mutex.h>
+#include <apr_strings.h>
+
+#include "svn_error.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+#include "svn_string.h"
+#include "svn_time.h"
+
+#include "private/svn_cache.h"
+#include "private/svn_mutex.h"
+#include "private/svn_ra_svn_private.h"
+#include "private/svn_shm.h"
+#include "private/svn_string_private.h"
+
+#include "svn_private_config.h"
+#include "metrics.h"
+
+/* Maximum number of distinct command names we keep statistics for.
+ * This is comfortably more than the number of svnserve commands. */
+#define MAX_COMMANDS 64
+
+/* Command names longer than this get truncated. */
+#define MAX_NAME_LEN 32
+
+/* Number of log2 histogram buckets for latencies in microseconds
+ * (up to more than an hour) and for byte counts (up to 1 TB). */
+#define LATENCY_BUCKETS 32
+#define SIZE_BUCKETS 40
+
+/* Statistics for a single command name. */
+typedef struct command_stats_t
+{
+  char name[MAX_NAME_LEN];
+
+  /* Number of executions and how many of them returned an error. */
+  apr_uint64_t count;
+  apr_uint64_t failures;
+
+  /* Totals over all executions. */
+  apr_uint64_t usecs;
+  apr_uint64_t bytes_in;
+  apr_uint64_t bytes_out;
+  apr_uint64_t cache_gets;
+  apr_uint64_t cache_hits;
+
+  /* Histograms.  Bucket I counts executions with values in
+   * [2^I, 2^(I+1)), bucket 0 also counts 0. */
+  apr_uint64_t latency[LATENCY_BUCKETS];
+  apr_uint64_t sizes_in[SIZE_BUCKETS];
+  apr_uint64_t sizes_out[SIZE_BUCKETS];
+} command_stats_t;
+
+/* The statistics data.  This may be in shared memory, so it must not
+ * contain any pointers. */
+typedef struct metrics_data_t
+{
+  /* When we started to collect the data. */
+  apr_time_t start_time;
+
+  /* When we last wrote the data to the file. */
+  apr_time_t last_dump;
+
+  /* Number of used entries in COMMANDS. */
+  int command_count;
+  command_stats_t commands[MAX_COMMANDS];
+} metrics_data_t;
+
+struct metrics_t
+{
+  /* The actual statistics, guarded by SHARED_LOCK or LOCK. */
+  metrics_data_t *data;
+
+  /* Serializes access to DATA across threads and processes if DATA lives
+   * in shared memory, NULL otherwise. */
+  apr_global_mutex_t *shared_lock;
+
+  /* Serializes access to DATA across threads if SHARED_LOCK is NULL. */
+  svn_mutex__t *lock;
+
+  /* Where and how often to write the statistics. */
+  const char *filename;
+  apr_interval_time_t interval;
+};
+
+/* Per-connection state of the statistics collection. */
+typedef struct metrics_probe_t
+{
+  metrics_t *metrics;
+
+  /* Nesting level of the commands currently being executed. */
+  int depth;
+
+  /* Time, I/O totals and cache counters when the current top-level
+   * command started. */
+  apr_time_t start;
+  apr_uint64_t bytes_in;
+  apr_uint64_t bytes_out;
+  apr_uint64_t cache_gets;
+  apr_uint64_t cache_hits;
+
+  /* For temporary allocations when writing the statistics file. */
+  apr_pool_t *pool;
+} metrics_probe_t;
+
+svn_error_t *
+metrics__create(metrics_t **metrics,
+                const char *filename,
+                apr_interval_time_t interval,
+                svn_boolean_t shared,
+                apr_pool_t *pool)
+{
+  metrics_t *result = apr_pcalloc(pool, sizeof(*result));
+
+  if (shared)
+    {
+      SVN_ERR(svn_shm__alloc((void **)&result->data, sizeof(*result->data),
+                             pool));
+      SVN_ERR(svn_shm__mutex_create(&result->shared_lock, pool));
+    }
+  else
+    {
+      result->data = apr_pcalloc(pool, sizeof(*result->data));
+      SVN_ERR(svn_mutex__init(&result->lock, TRUE, pool));
+    }
+
+  result->data->start_time = apr_time_now();
+  result->data->last_dump = result->data->start_time;
+  result->filename = apr_pstrdup(pool, filename);
+  result->interval = interval;
+
+  *metrics = result;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+metrics__child_init(metrics_t *metrics,
+                    apr_pool_t *pool)
+{
+  if (metrics->shared_lock)
+    SVN_ERR(svn_shm__mutex_child_init(metrics->shared_lock, pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Acquire the lock that guards the data of METRICS. */
+static svn_error_t *
+lock_metrics(metrics_t *metrics)
+{
+  if (metrics->shared_lock)
+    {
+      apr_status_t status = apr_global_mutex_lock(metrics->shared_lock);
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't lock metrics mutex"));
+
+      return SVN_NO_ERROR;
+    }
+
+  return svn_error_trace(svn_mutex__lock(metrics->lock));
+}
+
+/* Release the lock acquired by lock_metrics().  Return ERR upon success. */
+static svn_error_t *
+unlock_metrics(metrics_t *metrics,
+               svn_error_t *err)
+{
+  if (metrics->shared_lock)
+    {
+      apr_status_t status = apr_global_mutex_unlock(metrics->shared_lock);
+      if (status && !err)
+        return svn_error_wrap_apr(status, _("Can't unlock metrics mutex"));
+
+      return err;
+    }
+
+  return svn_mutex__unlock(metrics->lock, err);
+}
+
+/* Return the histogram bucket for VALUE in a histogram with BUCKET_COUNT
+ * buckets. */
+static int
+bucket_index(apr_uint64_t value,
+             int bucket_count)
+{
+  int i = 0;
+  while (value > 1 && i < bucket_count - 1)
+    {
+      value >>= 1;
+      ++i;
+    }
+
+  return i;
+}
+
+/* Return the entry for command NAME in DATA, adding it if necessary.
+ * Return NULL if there is no room for another entry. */
+static command_stats_t *
+get_command_stats(metrics_data_t *data,
+                  const char *name)
+{
+  command_stats_t *stats;
+  int i;
+
+  for (i = 0; i < data->command_count; ++i)
+    if (strncmp(data->commands[i].name, name, MAX_NAME_LEN - 1) == 0)
+      return &data->commands[i];
+
+  if (data->command_count == MAX_COMMANDS)
+    return NULL;
+
+  stats = &data->commands[data->command_count++];
+  apr_cpystrn(stats->name, name, sizeof(stats->name));
+
+  return stats;
+}
+
+/* Append the non-empty buckets of HISTOGRAM with BUCKET_COUNT entries to
+ * BUFFER as a line starting with TITLE. */
+static void
+write_histogram(svn_stringbuf_t *buffer,
+                const char *title,
+                const apr_uint64_t *histogram,
+                int bucket_count)
+{
+  int i;
+
+  svn_stringbuf_appendcstr(buffer, "  ");
+  svn_stringbuf_appendcstr(buffer, title);
+  for (i = 0; i < bucket_count; ++i)
+    if (histogram[i])
+      {
+        char number[SVN_INT64_BUFFER_SIZE];
+
+        svn_stringbuf_appendbyte(buffer, ' ');
+        svn__ui64toa(number, i ? APR_UINT64_C(1) << i : 0);
+        svn_stringbuf_appendcstr(buffer, number);
+        svn_stringbuf_appendbyte(buffer, ':');
+        svn__ui64toa(number, histogram[i]);
+        svn_stringbuf_appendcstr(buffer, number);
+      }
+
+  svn_stringbuf_appendcstr(buffer, "\n");
+}
+
+svn_error_t *
+metrics__dump(metrics_t *metrics,
+              apr_pool_t *scratch_pool)
+{
+  metrics_data_t *data = apr_palloc(scratch_pool, sizeof(*data));
+  svn_stringbuf_t *buffer = svn_stringbuf_create_empty(scratch_pool);
+  int i;
+
+  /* Take a consistent snapshot and don't hold the lock during I/O. */
+  SVN_ERR(lock_metrics(metrics));
+  metrics->data->last_dump = apr_time_now();
+  memcpy(data, metrics->data, sizeof(*data));
+  SVN_ERR(unlock_metrics(metrics, SVN_NO_ERROR));
+
+  svn_stringbuf_appendcstr(buffer,
+    apr_psprintf(scratch_pool,
+                 "# svnserve command metrics\n"
+                 "# since %s\n"
+                 "# until %s\n"
+                 "# Histograms list <lower bound>:<count> for buckets of"
+                 " powers of 2.\n"
+                 "# cache-gets minus cache-hits approximates the number"
+                 " of repository reads.\n"
+                 "# The cache counters are process-wide: with threaded"
+                 " connections, they include\n"
+                 "# the lookups of all commands running concurrently.\n",
+                 svn_time_to_cstring(data->start_time, scratch_pool),
+                 svn_time_to_cstring(data->last_dump, scratch_pool)));
+
+  for (i = 0; i < data->command_count; ++i)
+    {
+      const command_stats_t *stats = &data->commands[i];
+
+      svn_stringbuf_appendcstr(buffer,
+        apr_psprintf(scratch_pool,
+                     "command %s\n"
+                     "  count %" APR_UINT64_T_FMT "\n"
+                     "  failures %" APR_UINT64_T_FMT "\n"
+                     "  usecs %" APR_UINT64_T_FMT "\n"
+                     "  bytes-in %" APR_UINT64_T_FMT "\n"
+                     "  bytes-out %" APR_UINT64_T_FMT "\n"
+                     "  cache-gets %" APR_UINT64_T_FMT "\n"
+                     "  cache-hits %" APR_UINT64_T_FMT "\n",
+                     stats->name, stats->count, stats->failures,
+                     stats->usecs, stats->bytes_in, stats->bytes_out,
+                     stats->cache_gets, stats->cache_hits));
+      write_histogram(buffer, "usecs-histogram", stats->latency,
+                      LATENCY_BUCKETS);
+      write_histogram(buffer, "bytes-in-histogram", stats->sizes_in,
+                      SIZE_BUCKETS);
+      write_histogram(buffer, "bytes-out-histogram", stats->sizes_out,
+                      SIZE_BUCKETS);
+    }
+
+  return svn_error_trace(svn_io_write_atomic2(metrics->filename,
+                                              buffer->data, buffer->len,
+                                              NULL, FALSE, scratch_pool));
+}
+
+/* Add the execution of the command NAME, described by the remaining
+ * arguments, to the statistics in METRICS.  Return TRUE if the statistics
+ * are due to be written to their file. */
+static svn_boolean_t
+record_command(metrics_t *metrics,
+               const char *name,
+               svn_boolean_t failed,
+               apr_time_t now,
+               apr_uint64_t usecs,
+               apr_uint64_t bytes_in,
+               apr_uint64_t bytes_out,
+               apr_uint64_t cache_gets,
+               apr_uint64_t cache_hits)
+{
+  command_stats_t *stats;
+  svn_boolean_t dump_due;
+  svn_error_t *err;
+
+  /* We can't report errors from here, so just skip the update if
+   * something went wrong. */
+  err = lock_metrics(metrics);
+  if (err)
+    {
+      svn_error_clear(err);
+      return FALSE;
+    }
+
+  stats = get_command_stats(metrics->data, name);
+  if (stats)
+    {
+      stats->count++;
+      if (failed)
+        stats->failures++;
+
+      stats->usecs += usecs;
+      stats->bytes_in += bytes_in;
+      stats->bytes_out += bytes_out;
+      stats->cache_gets += cache_gets;
+      stats->cache_hits += cache_hits;
+
+      stats->latency[bucket_index(usecs, LATENCY_BUCKETS)]++;
+      stats->sizes_in[bucket_index(bytes_in, SIZE_BUCKETS)]++;
+      stats->sizes_out[bucket_index(bytes_out, SIZE_BUCKETS)]++;
+    }
+
+  /* Make sure only one thread / process will write the file. */
+  dump_due = now - metrics->data->last_dump >= metrics->interval;
+  if (dump_due)
+    metrics->data->last_dump = now;
+
+  svn_error_clear(unlock_metrics(metrics, SVN_NO_ERROR));
+
+  return dump_due;
+}
+
+/* Implements svn_ra_svn__command_hook_t for a metrics_probe_t BATON. */
+static void
+command_hook(void *baton,
+             svn_ra_svn_conn_t *conn,
+             const char *cmdname,
+             svn_boolean_t finished,
+             svn_boolean_t failed)
+{
+  metrics_probe_t *probe = baton;
+  apr_uint64_t bytes_in, bytes_out, cache_gets, cache_hits;
+  apr_time_t now;
+
+  /* Nested commands are part of the top-level command's work. */
+  if (!finished)
+    {
+      if (probe->depth++ == 0)
+        {
+          svn_ra_svn__get_io_totals(conn, &probe->bytes_in,
+                                    &probe->bytes_out);
+          svn_cache__membuffer_get_global_counters(&probe->cache_gets,
+                                                   &probe->cache_hits);
+          probe->start = apr_time_now();
+        }
+
+      return;
+    }
+
+  if (--probe->depth > 0)
+    return;
+
+  now = apr_time_now();
+  svn_ra_svn__get_io_totals(conn, &bytes_in, &bytes_out);
+  svn_cache__membuffer_get_global_counters(&cache_gets, &cache_hits);
+
+  if (record_command(probe->metrics, cmdname, failed, now,
+                     now - probe->start,
+                     bytes_in - probe->bytes_in,
+                     bytes_out - probe->bytes_out,
+                     cache_gets - probe->cache_gets,
+                     cache_hits - probe->cache_hits))
+    {
+      svn_error_clear(metrics__dump(probe->metrics, probe->pool));
+      svn_pool_clear(probe->pool);
+    }
+}
+
+void
+metrics__attach(metrics_t *metrics,
+                svn_ra_svn_conn_t *conn,
+                apr_pool_t *pool)
+{
+  metrics_probe_t *probe = apr_pcalloc(pool, sizeof(*probe));
+  probe->metrics = metrics;
+  probe->pool = svn_pool_create(pool);
+
+  svn_ra_svn__set_command_hook(conn, command_hook, probe);
+}
@@ -0,0 +1,88 @@
+/*
+ * metrics.h : Public definitions for the svnserve command statistics
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "server.h"
+
+
+
+/* Opaque svnserve command statistics.  For every command name, they
+ * count executions and failures and keep totals as well as log2
+ * histograms of the latency and the bytes received and sent.  They also
+ * track how many lookups the global membuffer cache saw during the
+ * commands and how many of those were hits.  Those cache counters are
+ * process-wide, i.e. with threaded connections, they include the work
+ * of concurrent commands.
+ *
+ * The data may live in shared memory such that all connection processes
+ * forked after creating it will contribute to the same statistics.
+ * Access is serialized among threads and processes.
+ */
+typedef struct metrics_t metrics_t;
+
+/* In POOL, create an empty statistics object and return it in *METRICS.
+ * The statistics will be written to FILENAME at least every INTERVAL,
+ * as long as commands are being executed.  If SHARED is set, place the
+ * data in shared memory for use by forked connection processes, each of
+ * which must then call metrics__child_init().
+ */
+svn_error_t *
+metrics__create(metrics_t **metrics,
+                const char *filename,
+                apr_interval_time_t interval,
+                svn_boolean_t shared,
+                apr_pool_t *pool);
+
+/* Re-attach the shared METRICS in a freshly forked connection process.
+ * Use POOL for per-process resources.
+ */
+svn_error_t *
+metrics__child_init(metrics_t *metrics,
+                    apr_pool_t *pool);
+
+/* Make METRICS record the top-level commands handled on CONN.  Allocate
+ * the per-connection data in POOL, which must not outlive CONN.
+ */
+void
+metrics__attach(metrics_t *metrics,
+                svn_ra_svn_conn_t *conn,
+                apr_pool_t *pool);
+
+/* Write the current contents of METRICS to their file, replacing the
+ * previous contents atomically.  Use SCRATCH_POOL for temporaries.
+ */
+svn_error_t *
+metrics__dump(metrics_t *metrics,
+              apr_pool_t *scratch_pool);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* METRICS_H */
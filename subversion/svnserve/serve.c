@@ -47,6 +47,7 @@
 #include "svn_path.h"
 #include "svn_time.h"
 #include "svn_config.h"
+#include "svn_diff.h"
 #include "svn_props.h"
 #include "svn_mergeinfo.h"
 #include "svn_user.h"
@@ -54,6 +55,7 @@
 #include "private/svn_log.h"
 #include "private/svn_mergeinfo_private.h"
 #include "private/svn_ra_svn_private.h"
+#include "private/svn_repos_private.h"
 #include "private/svn_fspath.h"
 
 #ifdef HAVE_UNISTD_H
@@ -62,6 +64,7 @@
 
 #include "server.h"
 #include "logger.h"
+#include "metrics.h"
 
 typedef struct commit_callback_baton_t {
   apr_pool_t *pool;
@@ -1551,6 +1554,94 @@ commit(svn_ra_svn_conn_t *conn,
   return SVN_NO_ERROR;
 }
 
+/* The contents of a file to send to the client. */
+typedef struct file_contents_t
+{
+  /* If not NULL, the repository file that contains the fulltext
+   * verbatim at OFFSET and with LENGTH bytes. */
+  apr_file_t *file;
+  apr_off_t offset;
+  svn_filesize_t length;
+
+  /* Otherwise, the stream to read the contents from. */
+  svn_stream_t *stream;
+} file_contents_t;
+
+/* Set *CONTENTS to the contents of file PATH in ROOT, preferring a
+ * verbatim span of a repository file that we can send without copying.
+ * Allocate *CONTENTS in POOL. */
+static svn_error_t *
+open_file_contents(file_contents_t **contents,
+                   svn_fs_root_t *root,
+                   const char *path,
+                   apr_pool_t *pool)
+{
+  file_contents_t *result = apr_pcalloc(pool, sizeof(*result));
+
+  SVN_ERR(svn_fs_file_contents_span(&result->file, &result->offset,
+                                    &result->length, root, path,
+                                    pool, pool));
+  if (!result->file)
+    SVN_ERR(svn_fs_file_contents(&result->stream, root, path, pool));
+
+  *contents = result;
+  return SVN_NO_ERROR;
+}
+
+/* Send CONTENTS over CONN as a series of strings terminated by an empty
+ * string and close them.  Errors while reading the contents are
+ * returned as command errors after the terminator has been sent.  Use
+ * POOL for temporary allocations. */
+static svn_error_t *
+write_file_contents(svn_ra_svn_conn_t *conn,
+                    file_contents_t *contents,
+                    apr_pool_t *pool)
+{
+  svn_string_t write_str;
+  char buf[4096];
+  apr_size_t len;
+  svn_error_t *err, *write_err;
+
+  if (contents->file)
+    {
+      err = svn_ra_svn__write_file_span(conn, pool, contents->file,
+                                        contents->offset, contents->length);
+      err = svn_error_compose_create(err,
+                                     svn_io_file_close(contents->file, pool));
+    }
+  else
+    {
+      while (1)
+        {
+          len = sizeof(buf);
+          err = svn_stream_read_full(contents->stream, buf, &len);
+          if (err)
+            break;
+          if (len > 0)
+            {
+              write_str.data = buf;
+              write_str.len = len;
+              SVN_ERR(svn_ra_svn__write_string(conn, pool, &write_str));
+            }
+          if (len < sizeof(buf))
+            {
+              err = svn_stream_close(contents->stream);
+              break;
+            }
+        }
+    }
+
+  write_err = svn_ra_svn__write_cstring(conn, pool, "");
+  if (write_err)
+    {
+      svn_error_clear(err);
+      return write_err;
+    }
+  SVN_CMD_ERR(err);
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 get_file(svn_ra_svn_conn_t *conn,
          apr_pool_t *pool,
@@ -1561,16 +1652,12 @@ get_file(svn_ra_svn_conn_t *conn,
   const char *path, *full_path, *hex_digest;
   svn_revnum_t rev;
   svn_fs_root_t *root;
-  svn_stream_t *contents;
+  file_contents_t *contents;
   apr_hash_t *props = NULL;
   apr_array_header_t *inherited_props;
-  svn_string_t write_str;
-  char buf[4096];
-  apr_size_t len;
   svn_boolean_t want_props, want_contents;
   apr_uint64_t wants_inherited_props;
   svn_checksum_t *checksum;
-  svn_error_t *err, *write_err;
   int i;
   authz_baton_t ab;
 
@@ -1614,7 +1701,7 @@ get_file(svn_ra_svn_conn_t *conn,
                           &ab, root, full_path,
                           pool));
   if (want_contents)
-    SVN_CMD_ERR(svn_fs_file_contents(&contents, root, full_path, pool));
+    SVN_CMD_ERR(open_file_contents(&contents, root, full_path, pool));
 
   /* Send successful command response with revision and props. */
   SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "w((?c)r(!", "success",
@@ -1646,32 +1733,7 @@ get_file(svn_ra_svn_conn_t *conn,
   /* Now send the file's contents. */
   if (want_contents)
     {
-      err = SVN_NO_ERROR;
-      while (1)
-        {
-          len = sizeof(buf);
-          err = svn_stream_read_full(contents, buf, &len);
-          if (err)
-            break;
-          if (len > 0)
-            {
-              write_str.data = buf;
-              write_str.len = len;
-              SVN_ERR(svn_ra_svn__write_string(conn, pool, &write_str));
-            }
-          if (len < sizeof(buf))
-            {
-              err = svn_stream_close(contents);
-              break;
-            }
-        }
-      write_err = svn_ra_svn__write_cstring(conn, pool, "");
-      if (write_err)
-        {
-          svn_error_clear(err);
-          return write_err;
-        }
-      SVN_CMD_ERR(err);
+      SVN_ERR(write_file_contents(conn, contents, pool));
       SVN_ERR(svn_ra_svn__write_cmd_response(conn, pool, ""));
     }
 
@@ -1921,15 +1983,17 @@ update(svn_ra_svn_conn_t *conn,
   svn_boolean_t recurse;
   svn_tristate_t send_copyfrom_args; /* Optional; default FALSE */
   svn_tristate_t ignore_ancestry; /* Optional; default FALSE */
+  svn_tristate_t text_deltas; /* Optional; default TRUE */
   /* Default to unknown.  Old clients won't send depth, but we'll
      handle that by converting recurse if necessary. */
   svn_depth_t depth = svn_depth_unknown;
   svn_boolean_t is_checkout;
 
   /* Parse the arguments. */
-  SVN_ERR(svn_ra_svn__parse_tuple(params, "(?r)cb?w3?3", &rev, &target,
+  SVN_ERR(svn_ra_svn__parse_tuple(params, "(?r)cb?w3?3?3", &rev, &target,
                                   &recurse, &depth_word,
-                                  &send_copyfrom_args, &ignore_ancestry));
+                                  &send_copyfrom_args, &ignore_ancestry,
+                                  &text_deltas));
   target = svn_relpath_canonicalize(target, pool);
 
   if (depth_word)
@@ -1945,7 +2009,8 @@ update(svn_ra_svn_conn_t *conn,
     SVN_CMD_ERR(svn_fs_youngest_rev(&rev, b->repository->fs, pool));
 
   SVN_ERR(accept_report(&is_checkout, NULL,
-                        conn, pool, b, rev, target, NULL, TRUE,
+                        conn, pool, b, rev, target, NULL,
+                        (text_deltas != svn_tristate_false),
                         depth,
                         (send_copyfrom_args == svn_tristate_true),
                         (ignore_ancestry == svn_tristate_true)));
@@ -1967,6 +2032,96 @@ update(svn_ra_svn_conn_t *conn,
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+fetch_many(svn_ra_svn_conn_t *conn,
+           apr_pool_t *pool,
+           svn_ra_svn__list_t *params,
+           void *baton)
+{
+  server_baton_t *b = baton;
+  svn_revnum_t rev;
+  svn_ra_svn__list_t *paths;
+  apr_array_header_t *full_paths;
+  svn_fs_root_t *root;
+  apr_pool_t *iterpool;
+  int i;
+
+  SVN_ERR(svn_ra_svn__parse_tuple(params, "rl", &rev, &paths));
+
+  full_paths = apr_array_make(pool, paths->nelts, sizeof(const char *));
+  for (i = 0; i < paths->nelts; ++i)
+    {
+      svn_ra_svn__item_t *item = &SVN_RA_SVN__LIST_ITEM(paths, i);
+
+      if (item->kind != SVN_RA_SVN_STRING)
+        return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                                "Fetch path not a string");
+
+      APR_ARRAY_PUSH(full_paths, const char *)
+        = svn_fspath__join(b->repository->fs_path->data,
+                           svn_relpath_canonicalize(item->u.string.data,
+                                                    pool),
+                           pool);
+    }
+
+  /* Because we can only send a single auth reply per request, let
+     must_have_access() authenticate the user for the first path that
+     we may not read.  After that, all paths must be readable. */
+  for (i = 0; i < full_paths->nelts; ++i)
+    if (! lookup_access(pool, b, svn_authz_read,
+                        APR_ARRAY_IDX(full_paths, i, const char *), FALSE))
+      break;
+
+  SVN_ERR(must_have_access(conn, pool, b, svn_authz_read,
+                           i < full_paths->nelts
+                             ? APR_ARRAY_IDX(full_paths, i, const char *)
+                             : NULL,
+                           FALSE));
+
+  for (; i < full_paths->nelts; ++i)
+    if (! lookup_access(pool, b, svn_authz_read,
+                        APR_ARRAY_IDX(full_paths, i, const char *), FALSE))
+      return svn_error_create(SVN_ERR_RA_SVN_CMD_ERR,
+                              error_create_and_log(SVN_ERR_RA_NOT_AUTHORIZED,
+                                                   NULL, NULL, b),
+                              NULL);
+
+  SVN_ERR(log_command(b, conn, pool, "fetch-many r%ld (%d paths)",
+                      rev, full_paths->nelts));
+
+  SVN_CMD_ERR(svn_fs_revision_root(&root, b->repository->fs, rev, pool));
+  SVN_ERR(svn_ra_svn__write_cmd_response(conn, pool, ""));
+
+  /* Send the contents of all files, each followed by its own status. */
+  iterpool = svn_pool_create(pool);
+  for (i = 0; i < full_paths->nelts; ++i)
+    {
+      const char *full_path = APR_ARRAY_IDX(full_paths, i, const char *);
+      file_contents_t *contents;
+      svn_error_t *err, *write_err;
+
+      svn_pool_clear(iterpool);
+
+      err = open_file_contents(&contents, root, full_path, iterpool);
+      if (err)
+        {
+          write_err = svn_ra_svn__write_cstring(conn, iterpool, "");
+          if (write_err)
+            {
+              svn_error_clear(err);
+              return write_err;
+            }
+          SVN_CMD_ERR(err);
+        }
+
+      SVN_ERR(write_file_contents(conn, contents, iterpool));
+      SVN_ERR(svn_ra_svn__write_cmd_response(conn, iterpool, ""));
+    }
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 switch_cmd(svn_ra_svn_conn_t *conn,
            apr_pool_t *pool,
@@ -2821,15 +2976,10 @@ static svn_error_t *file_rev_handler(void *baton, const char *path,
       svn_stream_set_write(stream, svndiff_handler);
       svn_stream_set_close(stream, svndiff_close_handler);
 
-      /* If the connection does not support SVNDIFF1 or if we don't want to use
-       * compression, use the non-compressing "version 0" implementation */
-      if (   svn_ra_svn_compression_level(frb->conn) > 0
-          && svn_ra_svn_has_capability(frb->conn, SVN_RA_SVN_CAP_SVNDIFF1))
-        svn_txdelta_to_svndiff3(d_handler, d_baton, stream, 1,
-                                svn_ra_svn_compression_level(frb->conn), pool);
-      else
-        svn_txdelta_to_svndiff3(d_handler, d_baton, stream, 0,
-                                svn_ra_svn_compression_level(frb->conn), pool);
+      /* Use the most efficient compression that the client supports. */
+      svn_txdelta_to_svndiff3(d_handler, d_baton, stream,
+                              svn_ra_svn__svndiff_version(frb->conn),
+                              svn_ra_svn_compression_level(frb->conn), pool);
     }
   else
     SVN_ERR(svn_ra_svn__write_cstring(frb->conn, pool, ""));
@@ -2893,6 +3043,105 @@ get_file_revs(svn_ra_svn_conn_t *conn,
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+get_blame(svn_ra_svn_conn_t *conn,
+          apr_pool_t *pool,
+          svn_ra_svn__list_t *params,
+          void *baton)
+{
+  server_baton_t *b = baton;
+  svn_revnum_t start_rev, end_rev;
+  const char *path;
+  const char *full_path;
+  svn_ra_svn__list_t *option_list;
+  apr_array_header_t *args;
+  apr_array_header_t *chunks;
+  svn_diff_file_options_t *diff_options;
+  apr_hash_t *sent_revs;
+  apr_pool_t *iterpool;
+  authz_baton_t ab;
+  int i;
+
+  ab.server = b;
+  ab.conn = conn;
+
+  /* Parse arguments. */
+  SVN_ERR(svn_ra_svn__parse_tuple(params, "c(?r)(?r)l", &path, &start_rev,
+                                  &end_rev, &option_list));
+  path = svn_relpath_canonicalize(path, pool);
+  SVN_ERR(trivial_auth_request(conn, pool, b));
+  full_path = svn_fspath__join(b->repository->fs_path->data, path, pool);
+
+  args = apr_array_make(pool, option_list->nelts, sizeof(const char *));
+  for (i = 0; i < option_list->nelts; ++i)
+    {
+      svn_ra_svn__item_t *elt = &SVN_RA_SVN__LIST_ITEM(option_list, i);
+
+      if (elt->kind != SVN_RA_SVN_STRING)
+        return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                                "Diff option not a string");
+      APR_ARRAY_PUSH(args, const char *) = elt->u.string.data;
+    }
+
+  diff_options = svn_diff_file_options_create(pool);
+  SVN_CMD_ERR(svn_diff_file_options_parse(diff_options, args, pool));
+
+  SVN_ERR(log_command(b, conn, pool, "%s",
+                      svn_log__blame(full_path, start_rev, end_rev, pool)));
+
+  SVN_CMD_ERR(svn_repos__blame(&chunks, b->repository->repos, full_path,
+                               start_rev, end_rev, diff_options,
+                               SVN_REPOS__BLAME_MAX_FILE_SIZE,
+                               authz_check_access_cb_func(b), &ab,
+                               NULL, NULL, pool, pool));
+
+  /* Send the chunks, followed by the revprops of each revision that
+     they refer to. */
+  SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "w((!", "success"));
+  for (i = 0; i < chunks->nelts; ++i)
+    {
+      const svn_repos__blame_chunk_t *chunk
+        = &APR_ARRAY_IDX(chunks, i, svn_repos__blame_chunk_t);
+
+      SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "(n(?r))",
+                                      (apr_uint64_t)chunk->start,
+                                      chunk->revision));
+    }
+  SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "!)(!"));
+
+  sent_revs = apr_hash_make(pool);
+  iterpool = svn_pool_create(pool);
+  for (i = 0; i < chunks->nelts; ++i)
+    {
+      const svn_repos__blame_chunk_t *chunk
+        = &APR_ARRAY_IDX(chunks, i, svn_repos__blame_chunk_t);
+      apr_hash_t *props;
+
+      if (!SVN_IS_VALID_REVNUM(chunk->revision)
+          || apr_hash_get(sent_revs, &chunk->revision,
+                          sizeof(chunk->revision)))
+        continue;
+
+      svn_pool_clear(iterpool);
+      apr_hash_set(sent_revs, &chunk->revision, sizeof(chunk->revision),
+                   (void *)chunk);
+
+      SVN_ERR(svn_repos_fs_revision_proplist(&props, b->repository->repos,
+                                             chunk->revision,
+                                             authz_check_access_cb_func(b),
+                                             &ab, iterpool));
+      SVN_ERR(svn_ra_svn__write_tuple(conn, iterpool, "(r(!",
+                                      chunk->revision));
+      SVN_ERR(svn_ra_svn__write_proplist(conn, iterpool, props));
+      SVN_ERR(svn_ra_svn__write_tuple(conn, iterpool, "!))"));
+    }
+  svn_pool_destroy(iterpool);
+
+  SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "!))"));
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 lock(svn_ra_svn_conn_t *conn,
      apr_pool_t *pool,
@@ -3704,6 +3953,7 @@ static const svn_ra_svn__cmd_entry_t main_commands[] = {
   { "get-file",        get_file },
   { "get-dir",         get_dir },
   { "update",          update },
+  { "fetch-many",      fetch_many },
   { "switch",          switch_cmd },
   { "status",          status },
   { "diff",            diff },
@@ -3714,6 +3964,7 @@ static const svn_ra_svn__cmd_entry_t main_commands[] = {
   { "get-locations",   get_locations },
   { "get-location-segments",   get_location_segments },
   { "get-file-revs",   get_file_revs },
+  { "get-blame",       get_blame },
   { "lock",            lock },
   { "lock-many",       lock_many },
   { "unlock",          unlock },
@@ -3785,7 +4036,8 @@ repos_path_valid(const char *path)
  * and fs_path fields of REPOSITORY.  VHOST and READ_ONLY flags are the
  * same as in the server baton.
  *
- * CONFIG_POOL shall be used to load config objects.
+ * CONFIG_POOL shall be used to load config objects and REPOS_POOL to
+ * open the repository.
  *
  * Use SCRATCH_POOL for temporary allocations.
  *
@@ -3798,6 +4050,7 @@ find_repos(const char *url,
            svn_config_t *cfg,
            repository_t *repository,
            svn_repos__config_pool_t *config_pool,
+           svn_repos__repos_pool_t *repos_pool,
            apr_hash_t *fs_config,
            apr_pool_t *result_pool,
            apr_pool_t *scratch_pool)
@@ -3837,8 +4090,9 @@ find_repos(const char *url,
                              "No repository found in '%s'", url);
 
   /* Open the repository and fill in b with the resulting information. */
-  SVN_ERR(svn_repos_open3(&repository->repos, repository->repos_root,
-                          fs_config, result_pool, scratch_pool));
+  SVN_ERR(svn_repos__repos_pool_get(&repository->repos, repos_pool,
+                                    repository->repos_root, fs_config,
+                                    result_pool, scratch_pool));
   SVN_ERR(svn_repos_remember_client_capabilities(repository->repos,
                                                  repository->capabilities));
   repository->fs = svn_repos_fs(repository->repos);
@@ -4118,14 +4372,19 @@ construct_server_baton(server_baton_t **baton,
   b->logger = params->logger;
   b->client_info = get_client_info(conn, params, conn_pool);
 
+  if (params->metrics)
+    metrics__attach(params->metrics, conn, conn_pool);
+
   /* Send greeting.  We don't support version 1 any more, so we can
    * send an empty mechlist. */
   if (params->compression_level > 0)
     SVN_ERR(svn_ra_svn__write_cmd_response(conn, scratch_pool,
-                                           "nn()(wwwwwwwwwwww)",
+                                           "nn()(wwwwwwwwwwwwwww)",
                                            (apr_uint64_t) 2, (apr_uint64_t) 2,
                                            SVN_RA_SVN_CAP_EDIT_PIPELINE,
                                            SVN_RA_SVN_CAP_SVNDIFF1,
+                                           SVN_RA_SVN_CAP_ACCEPTS_SVNDIFF2,
+                                           SVN_RA_SVN_CAP_ACCEPTS_SVNDIFF3,
                                            SVN_RA_SVN_CAP_ABSENT_ENTRIES,
                                            SVN_RA_SVN_CAP_COMMIT_REVPROPS,
                                            SVN_RA_SVN_CAP_DEPTH,
@@ -4135,11 +4394,12 @@ construct_server_baton(server_baton_t **baton,
                                            SVN_RA_SVN_CAP_INHERITED_PROPS,
                                            SVN_RA_SVN_CAP_EPHEMERAL_TXNPROPS,
                                            SVN_RA_SVN_CAP_GET_FILE_REVS_REVERSE,
-                                           SVN_RA_SVN_CAP_LIST
+                                           SVN_RA_SVN_CAP_LIST,
+                                           SVN_RA_SVN_CAP_SERVER_BLAME
                                            ));
   else
     SVN_ERR(svn_ra_svn__write_cmd_response(conn, scratch_pool,
-                                           "nn()(wwwwwwwwwww)",
+                                           "nn()(wwwwwwwwwwww)",
                                            (apr_uint64_t) 2, (apr_uint64_t) 2,
                                            SVN_RA_SVN_CAP_EDIT_PIPELINE,
                                            SVN_RA_SVN_CAP_ABSENT_ENTRIES,
@@ -4151,7 +4411,8 @@ construct_server_baton(server_baton_t **baton,
                                            SVN_RA_SVN_CAP_INHERITED_PROPS,
                                            SVN_RA_SVN_CAP_EPHEMERAL_TXNPROPS,
                                            SVN_RA_SVN_CAP_GET_FILE_REVS_REVERSE,
-                                           SVN_RA_SVN_CAP_LIST
+                                           SVN_RA_SVN_CAP_LIST,
+                                           SVN_RA_SVN_CAP_SERVER_BLAME
                                            ));
 
   /* Read client response, which we assume to be in version 2 format:
@@ -4209,7 +4470,7 @@ construct_server_baton(server_baton_t **baton,
   err = handle_config_error(find_repos(client_url, params->root, b->vhost,
                                        b->read_only, params->cfg,
                                        b->repository, params->config_pool,
-                                       params->fs_config,
+                                       params->repos_pool, params->fs_config,
                                        conn_pool, scratch_pool),
                             b);
   if (!err)
@@ -4260,6 +4521,12 @@ construct_server_baton(server_baton_t **baton,
     if (supports_mergeinfo)
       SVN_ERR(svn_ra_svn__write_word(conn, scratch_pool,
                                      SVN_RA_SVN_CAP_MERGEINFO));
+
+    /* Clients would block on additional connections that we can't
+       accept while serving this one. */
+    if (params->concurrent_connections)
+      SVN_ERR(svn_ra_svn__write_word(conn, scratch_pool,
+                                     SVN_RA_SVN_CAP_FETCH_MANY));
     SVN_ERR(svn_ra_svn__write_tuple(conn, scratch_pool, "!))"));
     SVN_ERR(svn_ra_svn__flush(conn, scratch_pool));
   }
@@ -124,9 +124,15 @@ typedef struct serve_params_t {
   /* logging data structure; possibly NULL. */
   struct logger_t *logger;
 
+  /* command statistics; possibly NULL. */
+  struct metrics_t *metrics;
+
   /* all configurations should be opened through this factory */
   svn_repos__config_pool_t *config_pool;
 
+  /* all repositories should be opened through this factory */
+  svn_repos__repos_pool_t *repos_pool;
+
   /* The FS configuration to be applied to all repositories.
      It mainly contains things like cache settings. */
   apr_hash_t *fs_config;
@@ -159,6 +165,10 @@ typedef struct serve_params_t {
 
   /* Use virtual-host-based path to repo. */
   svn_boolean_t vhost;
+
+  /* True if other connections get served while serving this one, i.e.
+     clients may open additional connections in the middle of a command. */
+  svn_boolean_t concurrent_connections;
 } serve_params_t;
 
 /* This structure contains all data that describes a client / server
@@ -28,6 +28,7 @@
 #include <apr_general.h>
 #include <apr_getopt.h>
 #include <apr_network_io.h>
+#include <apr_poll.h>
 #include <apr_signal.h>
 #include <apr_thread_proc.h>
 #include <apr_portable.h>
@@ -55,7 +56,10 @@
 #include "private/svn_dep_compat.h"
 #include "private/svn_cmdline_private.h"
 #include "private/svn_atomic.h"
+#include "private/svn_cache.h"
 #include "private/svn_mutex.h"
+#include "private/svn_ra_svn_private.h"
+#include "private/svn_repos_private.h"
 #include "private/svn_subr_private.h"
 
 #if APR_HAS_THREADS
@@ -70,6 +74,7 @@
 
 #include "server.h"
 #include "logger.h"
+#include "metrics.h"
 
 /* The strategy for handling incoming connections.  Some of these may be
    unavailable due to platform limitations. */
@@ -145,6 +150,12 @@ enum run_mode {
  */
 #define THREADPOOL_THREAD_IDLE_LIMIT 1000000
 
+/* Size hint for the pollset in which idle connections wait for their next
+ * command in threaded mode.  This also limits the number of connections
+ * that can become active with a single poll call.
+ */
+#define IDLE_CONNECTIONS_POLLSET_SIZE 16384
+
 /* Number of client to server connections that may concurrently in the
  * TCP 3-way handshake state, i.e. are in the process of being created.
  *
@@ -164,6 +175,9 @@ enum run_mode {
  */
 #define MAX_REQUEST_SIZE 16
 
+/* Default interval in seconds between updates of the --metrics-file. */
+#define METRICS_INTERVAL 60
+
 #ifdef WIN32
 static apr_os_sock_t winservice_svnserve_accept_socket = INVALID_SOCKET;
 
@@ -222,6 +236,11 @@ void winservice_notify_stop(void)
 #define SVNSERVE_OPT_MAX_REQUEST     274
 #define SVNSERVE_OPT_MAX_RESPONSE    275
 #define SVNSERVE_OPT_CACHE_NODEPROPS 276
+#define SVNSERVE_OPT_CACHE_SHARED    277
+#define SVNSERVE_OPT_METRICS_FILE    278
+#define SVNSERVE_OPT_METRICS_INTERVAL 279
+#define SVNSERVE_OPT_WARM_CACHE      280
+#define SVNSERVE_OPT_WARM_CACHE_BUDGET 281
 
 /* Text macro because we can't use #ifdef sections inside a N_("...")
    macro expansion. */
@@ -286,7 +305,11 @@ static const apr_getopt_option_t svnserve__options[] =
         "                             "
         "[0 .. no compression, 5 .. default, \n"
         "                             "
-        " 9 .. maximum compression]")},
+        " 9 .. maximum compression]\n"
+        "                             "
+        "[clients that support it receive LZ4 compressed\n"
+        "                             "
+        " data for any level but 0]")},
     {"memory-cache-size", 'M', 1,
      N_("size of the extra in-memory cache in MB used to\n"
         "                             "
@@ -297,6 +320,30 @@ static const apr_getopt_option_t svnserve__options[] =
         "0 switches to dynamically sized caches.\n"
         "                             "
         "[used for FSFS and FSX repositories only]")},
+    {"memory-cache-shared", SVNSERVE_OPT_CACHE_SHARED, 0,
+     N_("share a single in-memory cache of the size given\n"
+        "                             "
+        "by --memory-cache-size between all forked\n"
+        "                             "
+        "connection processes instead of using one cache\n"
+        "                             "
+        "per process.\n"
+        "                             "
+        "[used only in the default, forking mode]")},
+    {"warm-cache",       SVNSERVE_OPT_WARM_CACHE, 1,
+     N_("pre-load the in-memory cache with the HEAD tree\n"
+        "                             "
+        "and the latest revisions of the repository at\n"
+        "                             "
+        "local path ARG at startup.  May be repeated.\n"
+        "                             "
+        "[mode: daemon, service]")},
+    {"warm-cache-budget", SVNSERVE_OPT_WARM_CACHE_BUDGET, 1,
+     N_("pre-load at most ARG MB per --warm-cache\n"
+        "                             "
+        "repository.\n"
+        "                             "
+        "Default is the --memory-cache-size.")},
     {"cache-txdeltas", SVNSERVE_OPT_CACHE_TXDELTAS, 1,
      N_("enable or disable caching of deltas between older\n"
         "                             "
@@ -396,6 +443,18 @@ static const apr_getopt_option_t svnserve__options[] =
         "process (useful for debugging)")},
     {"log-file",         SVNSERVE_OPT_LOG_FILE, 1,
      N_("svnserve log file")},
+    {"metrics-file",     SVNSERVE_OPT_METRICS_FILE, 1,
+     N_("periodically write per-command statistics\n"
+        "                             "
+        "(latency, bytes in/out, cache hits) to file ARG\n"
+        "                             "
+        "[mode: daemon, listen-once, service]")},
+    {"metrics-interval", SVNSERVE_OPT_METRICS_INTERVAL, 1,
+     N_("write the --metrics-file at most every ARG\n"
+        "                             "
+        "seconds while serving commands.\n"
+        "                             "
+        "Default is " APR_STRINGIFY(METRICS_INTERVAL) ".")},
     {"pid-file",         SVNSERVE_OPT_PID_FILE, 1,
 #ifdef WIN32
      N_("write server process ID to file ARG\n"
@@ -614,6 +673,15 @@ static svn_root_pools__t *connection_pools;
 /* The global thread pool serving all connections. */
 static apr_thread_pool_t *threads;
 
+/* Connections that are waiting for the next client command.  They don't
+   occupy any thread in THREADS until the client sends more data.
+
+   This is NULL if the platform's pollset implementation does not allow
+   for adding sockets while another thread is waiting on the pollset.
+   In that case, we fall back to round-robin scheduling controlled by
+   is_busy(). */
+static apr_pollset_t *idle_connections = NULL;
+
 /* Very simple load determination callback for serve_interruptable:
    With less than half the threads in THREADS in use, we can afford to
    wait in the socket read() function.  Otherwise, poll them round-robin. */
@@ -624,19 +692,79 @@ is_busy(connection_t *connection)
        > apr_thread_pool_thread_max_get(threads);
 }
 
+/* Load determination callback for serve_interruptable when we have
+   IDLE_CONNECTIONS:  Never block a worker thread waiting for the next
+   command.  The connection will be parked in IDLE_CONNECTIONS instead. */
+static svn_boolean_t
+never_wait(connection_t *connection)
+{
+  return TRUE;
+}
+
+/* Add CONNECTION to IDLE_CONNECTIONS, such that it gets scheduled again
+   as soon as the client sends data or closes the connection. */
+static apr_status_t
+park_connection(connection_t *connection)
+{
+  apr_pollfd_t pfd = { 0 };
+
+  pfd.p = connection->pool;
+  pfd.desc_type = APR_POLL_SOCKET;
+  pfd.reqevents = APR_POLLIN;
+  pfd.desc.s = connection->usock;
+  pfd.client_data = connection;
+
+  return apr_pollset_add(idle_connections, &pfd);
+}
+
+/* Block until the client of CONNECTION sends more data or closes the
+   connection.  This is the fallback if park_connection() fails, e.g.
+   because IDLE_CONNECTIONS is full.  Re-scheduling the connection right
+   away would make the workers spin on it. */
+static apr_status_t
+wait_for_command(connection_t *connection)
+{
+  apr_pollfd_t pfd = { 0 };
+  apr_int32_t count;
+  apr_status_t status;
+
+  pfd.p = connection->pool;
+  pfd.desc_type = APR_POLL_SOCKET;
+  pfd.reqevents = APR_POLLIN;
+  pfd.desc.s = connection->usock;
+
+  do
+    status = apr_poll(&pfd, 1, &count, -1);
+  while (APR_STATUS_IS_EINTR(status));
+
+  return status;
+}
+
 /* Serve the connection given by DATA.  Under high load, serve only
    the current command (if any) and then put the connection back into
-   THREAD's task pool. */
+   THREAD's task pool.  If we have IDLE_CONNECTIONS, always return after
+   the current command and park the connection there if the client has
+   not sent the next command, yet. */
 static void * APR_THREAD_FUNC serve_thread(apr_thread_t *tid, void *data)
 {
   svn_boolean_t done;
+  svn_boolean_t has_command = TRUE;
   connection_t *connection = data;
   svn_error_t *err;
 
   apr_pool_t *pool = svn_root_pools__acquire_pool(connection_pools);
 
   /* process the actual request and log errors */
-  err = serve_interruptable(&done, connection, is_busy, pool);
+  err = serve_interruptable(&done, connection,
+                            idle_connections ? never_wait : is_busy,
+                            pool);
+
+  /* The client may have sent more than one command at once.  Since those
+     are already in our receive buffer, the pollset would not report them. */
+  if (!err && !done && idle_connections)
+    err = svn_ra_svn__has_command(&has_command, &done, connection->conn,
+                                  pool);
+
   if (err)
     {
       logger__log_error(connection->params->logger, err, NULL,
@@ -647,15 +775,120 @@ static void * APR_THREAD_FUNC serve_thread(apr_thread_t *tid, void *data)
     }
   svn_root_pools__release_pool(pool, connection_pools);
 
-  /* Close or re-schedule connection. */
+  /* Close, park or re-schedule connection. */
   if (done)
     close_connection(connection);
+  else if (!has_command && park_connection(connection) == APR_SUCCESS)
+    ; /* CONNECTION is now owned by IDLE_CONNECTIONS. */
+  else if (!has_command && wait_for_command(connection) != APR_SUCCESS)
+    close_connection(connection);
   else
     apr_thread_pool_push(threads, serve_thread, connection, 0, NULL);
 
   return NULL;
 }
 
+/* Thread function waiting for activity on any of the IDLE_CONNECTIONS.
+   Hand those connections over to THREADS.  DATA is the server's
+   serve_params_t and is used for logging. */
+static void * APR_THREAD_FUNC
+dispatch_thread(apr_thread_t *tid, void *data)
+{
+  serve_params_t *params = data;
+
+  while (TRUE)
+    {
+      const apr_pollfd_t *ready;
+      apr_int32_t count, i;
+      apr_status_t status;
+
+      status = apr_pollset_poll(idle_connections, -1, &count, &ready);
+      if (status)
+        {
+          if (!APR_STATUS_IS_EINTR(status) && !APR_STATUS_IS_TIMEUP(status))
+            {
+              svn_error_t *err
+                = svn_error_wrap_apr(status, _("Can't poll idle connections"));
+              logger__log_error(params->logger, err, NULL, NULL);
+              svn_error_clear(err);
+            }
+
+          continue;
+        }
+
+      for (i = 0; i < count; ++i)
+        {
+          connection_t *connection = ready[i].client_data;
+
+          /* The connection will be parked again by the worker thread,
+             once the client's command has been processed. */
+          apr_pollset_remove(idle_connections, &ready[i]);
+          status = apr_thread_pool_push(threads, serve_thread, connection,
+                                        0, NULL);
+          if (status)
+            close_connection(connection);
+        }
+    }
+
+  /* NOTREACHED */
+  return NULL;
+}
+
+#endif
+
+/* Pre-load the FS caches with the data of the repository at PATH, opened
+   through the repos_pool in PARAMS.  Read no more than BUDGET bytes and
+   include file contents if INCLUDE_FULLTEXTS is set.  Use SCRATCH_POOL for
+   temporary allocations. */
+static svn_error_t *
+warm_cache(serve_params_t *params,
+           const char *path,
+           apr_uint64_t budget,
+           svn_boolean_t include_fulltexts,
+           apr_pool_t *scratch_pool)
+{
+  svn_repos_t *repos;
+
+  /* The warmed-up instance will serve the first connection afterwards. */
+  SVN_ERR(svn_repos__repos_pool_get(&repos, params->repos_pool, path,
+                                    params->fs_config, scratch_pool,
+                                    scratch_pool));
+  return svn_error_trace(svn_repos__warm_caches(NULL, NULL, repos, budget,
+                                                include_fulltexts,
+                                                NULL, NULL, scratch_pool));
+}
+
+#if APR_HAS_THREADS
+
+/* Parameters of a warm_cache_thread. */
+typedef struct warm_cache_baton_t
+{
+  serve_params_t *params;
+  const char *path;
+  apr_uint64_t budget;
+  svn_boolean_t include_fulltexts;
+} warm_cache_baton_t;
+
+/* Thread function calling warm_cache for the warm_cache_baton_t given by
+   DATA and logging any error. */
+static void * APR_THREAD_FUNC
+warm_cache_thread(apr_thread_t *tid, void *data)
+{
+  warm_cache_baton_t *baton = data;
+  apr_pool_t *pool = svn_root_pools__acquire_pool(connection_pools);
+  svn_error_t *err = warm_cache(baton->params, baton->path, baton->budget,
+                                baton->include_fulltexts, pool);
+
+  if (err)
+    {
+      logger__log_error(baton->params->logger, err, NULL, NULL);
+      svn_error_clear(err);
+    }
+
+  svn_root_pools__release_pool(pool, connection_pools);
+  return NULL;
+}
+
 #endif
 
 /* Write the PID of the current process as a decimal number, followed by a
@@ -724,6 +957,8 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   svn_boolean_t cache_nodeprops = TRUE;
   svn_boolean_t cache_txdeltas = TRUE;
   svn_boolean_t cache_revprops = FALSE;
+  svn_boolean_t cache_shared = FALSE;
+  svn_membuffer_t *shared_cache = NULL;
   svn_boolean_t use_block_read = FALSE;
   apr_uint16_t port = SVN_RA_SVN_PORT;
   const char *host = NULL;
@@ -739,6 +974,11 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   const char *config_filename = NULL;
   const char *pid_filename = NULL;
   const char *log_filename = NULL;
+  const char *metrics_filename = NULL;
+  apr_int64_t metrics_interval = METRICS_INTERVAL;
+  apr_array_header_t *warm_cache_paths = apr_array_make(pool, 0,
+                                                       sizeof(const char *));
+  apr_uint64_t warm_cache_budget = (apr_uint64_t)-1;
   svn_node_kind_t kind;
   apr_size_t min_thread_count = THREADPOOL_MIN_SIZE;
   apr_size_t max_thread_count = THREADPOOL_MAX_SIZE;
@@ -765,7 +1005,9 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   params.cfg = NULL;
   params.compression_level = SVN_DELTA_COMPRESSION_LEVEL_DEFAULT;
   params.logger = NULL;
+  params.metrics = NULL;
   params.config_pool = NULL;
+  params.repos_pool = NULL;
   params.fs_config = NULL;
   params.vhost = FALSE;
   params.username_case = CASE_ASIS;
@@ -774,6 +1016,7 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   params.error_check_interval = 4096;
   params.max_request_size = MAX_REQUEST_SIZE * 0x100000;
   params.max_response_size = 0;
+  params.concurrent_connections = FALSE;
 
   while (1)
     {
@@ -925,6 +1168,10 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
           cache_nodeprops = svn_tristate__from_word(arg) == svn_tristate_true;
           break;
 
+        case SVNSERVE_OPT_CACHE_SHARED:
+          cache_shared = TRUE;
+          break;
+
         case SVNSERVE_OPT_BLOCK_READ:
           use_block_read = svn_tristate__from_word(arg) == svn_tristate_true;
           break;
@@ -995,6 +1242,40 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
           SVN_ERR(svn_dirent_get_absolute(&log_filename, log_filename, pool));
           break;
 
+        case SVNSERVE_OPT_METRICS_FILE:
+          SVN_ERR(svn_utf_cstring_to_utf8(&metrics_filename, arg, pool));
+          metrics_filename = svn_dirent_internal_style(metrics_filename,
+                                                       pool);
+          SVN_ERR(svn_dirent_get_absolute(&metrics_filename,
+                                          metrics_filename, pool));
+          break;
+
+        case SVNSERVE_OPT_METRICS_INTERVAL:
+          SVN_ERR(svn_cstring_atoi64(&metrics_interval, arg));
+          if (metrics_interval < 0)
+            metrics_interval = 0;
+          break;
+
+        case SVNSERVE_OPT_WARM_CACHE:
+          {
+            const char *path;
+
+            SVN_ERR(svn_utf_cstring_to_utf8(&path, arg, pool));
+            path = svn_dirent_internal_style(path, pool);
+            SVN_ERR(svn_dirent_get_absolute(&path, path, pool));
+            APR_ARRAY_PUSH(warm_cache_paths, const char *) = path;
+          }
+          break;
+
+        case SVNSERVE_OPT_WARM_CACHE_BUDGET:
+          {
+            apr_uint64_t sz_val;
+            SVN_ERR(svn_cstring_atoui64(&sz_val, arg));
+
+            warm_cache_budget = 0x100000 * sz_val;
+          }
+          break;
+
         }
     }
 
@@ -1053,6 +1334,9 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   SVN_ERR(svn_repos__config_pool_create(&params.config_pool,
                                         is_multi_threaded,
                                         pool));
+  SVN_ERR(svn_repos__repos_pool_create(&params.repos_pool,
+                                       is_multi_threaded,
+                                       pool));
 
   /* If a configuration file is specified, load it and any referenced
    * password and authorization files. */
@@ -1079,6 +1363,16 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
                _("Option --tunnel-user is only valid in tunnel mode"));
     }
 
+  /* In inetd and tunnel mode, every connection runs in an independent
+   * process, so there is nothing to aggregate the statistics in. */
+  if (metrics_filename
+      && (run_mode == run_mode_inetd || run_mode == run_mode_tunnel))
+    {
+      return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+               _("Option --metrics-file is not valid in inetd or tunnel "
+                 "mode"));
+    }
+
   if (run_mode == run_mode_inetd || run_mode == run_mode_tunnel)
     {
       apr_pool_t *connection_pool;
@@ -1087,6 +1381,9 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
       svn_stream_t *stdout_stream;
 
       params.tunnel = (run_mode == run_mode_tunnel);
+
+      /* Every further connection will get its own process. */
+      params.concurrent_connections = TRUE;
       apr_pool_cleanup_register(pool, pool, apr_pool_cleanup_null,
                                 redirect_stdout);
 
@@ -1295,8 +1592,28 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
       }
 
     svn_cache_config_set(&settings);
+
+    /* Don't let the warm-up evict its own data. */
+    if (warm_cache_budget == (apr_uint64_t)-1)
+      warm_cache_budget = settings.cache_size;
   }
 
+  params.concurrent_connections = (run_mode != run_mode_listen_once
+                                   && handling_mode != connection_mode_single);
+
+  /* Like the shared cache below, the statistics must exist before the
+   * first connection process gets forked. */
+  if (metrics_filename)
+    SVN_ERR(metrics__create(&params.metrics, metrics_filename,
+                            apr_time_from_sec(metrics_interval),
+                            handling_mode == connection_mode_fork, pool));
+
+  /* In forking mode, create the cache before accepting the first
+   * connection such that all connection processes inherit it. */
+  if (cache_shared && handling_mode == connection_mode_fork)
+    SVN_ERR(svn_cache__create_shared_global_membuffer_cache(&shared_cache,
+                                                            pool));
+
 #if APR_HAS_THREADS
   SVN_ERR(svn_root_pools__create(&connection_pools));
 
@@ -1323,6 +1640,33 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
 
       /* don't queue requests unless we reached the worker thread limit */
       apr_thread_pool_threshold_set(threads, 0);
+
+      /* Idle connections wait in a pollset instead of blocking a worker
+         thread.  Thus, the number of threads depends on the number of
+         concurrent requests rather than on the number of open connections.
+         Not all pollset implementations support this, though. */
+      status = apr_pollset_create(&idle_connections,
+                                  IDLE_CONNECTIONS_POLLSET_SIZE, pool,
+                                  APR_POLLSET_THREADSAFE);
+      if (status == APR_SUCCESS)
+        {
+          apr_threadattr_t *tattr;
+          apr_thread_t *tid;
+
+          status = apr_threadattr_create(&tattr, pool);
+          if (!status)
+            status = apr_threadattr_detach_set(tattr, 1);
+          if (!status)
+            status = apr_thread_create(&tid, tattr, dispatch_thread,
+                                       &params, pool);
+          if (status)
+            return svn_error_wrap_apr(status,
+                                      _("Can't create dispatcher thread"));
+        }
+      else
+        {
+          idle_connections = NULL;
+        }
     }
   else
     {
@@ -1330,6 +1674,58 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
     }
 #endif
 
+  /* Pre-load the caches.  There are no caches to share between the
+   * connections in inetd and tunnel mode.  With threads, do it in the
+   * background.  Forked connection processes inherit the cache, so fill
+   * it before accepting the first connection. */
+  if (run_mode == run_mode_daemon || run_mode == run_mode_service)
+    {
+      int i;
+      apr_pool_t *iterpool = svn_pool_create(pool);
+
+      for (i = 0; i < warm_cache_paths->nelts; ++i)
+        {
+          const char *path = APR_ARRAY_IDX(warm_cache_paths, i, const char *);
+
+          svn_pool_clear(iterpool);
+#if APR_HAS_THREADS
+          if (handling_mode == connection_mode_thread)
+            {
+              warm_cache_baton_t *baton = apr_pcalloc(pool, sizeof(*baton));
+              apr_threadattr_t *tattr;
+              apr_thread_t *tid;
+
+              baton->params = &params;
+              baton->path = path;
+              baton->budget = warm_cache_budget;
+              baton->include_fulltexts = cache_fulltexts;
+
+              status = apr_threadattr_create(&tattr, pool);
+              if (!status)
+                status = apr_threadattr_detach_set(tattr, 1);
+              if (!status)
+                status = apr_thread_create(&tid, tattr, warm_cache_thread,
+                                           baton, pool);
+              if (status)
+                return svn_error_wrap_apr(status,
+                                          _("Can't create warm-up thread"));
+
+              continue;
+            }
+#endif
+
+          err = warm_cache(&params, path, warm_cache_budget, cache_fulltexts,
+                           iterpool);
+          if (err)
+            {
+              logger__log_error(params.logger, err, NULL, NULL);
+              svn_error_clear(err);
+            }
+        }
+
+      svn_pool_destroy(iterpool);
+    }
+
   while (1)
     {
       connection_t *connection = NULL;
@@ -1339,6 +1735,10 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
         {
           err = serve_socket(connection, connection->pool);
           close_connection(connection);
+          if (params.metrics)
+            err = svn_error_compose_create(err,
+                                           metrics__dump(params.metrics,
+                                                         pool));
           return err;
         }
 
@@ -1352,6 +1752,21 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
               /* the child would't listen to the main server's socket */
               apr_socket_close(sock);
 
+              /* Re-attach the shared cache and statistics first. */
+              err = shared_cache
+                  ? svn_cache__membuffer_cache_child_init(shared_cache,
+                                                          connection->pool)
+                  : SVN_NO_ERROR;
+              if (!err && params.metrics)
+                err = metrics__child_init(params.metrics, connection->pool);
+              if (err)
+                {
+                  logger__log_error(params.logger, err, NULL, NULL);
+                  svn_error_clear(err);
+                  close_connection(connection);
+                  return SVN_NO_ERROR;
+                }
+
               /* serve_socket() logs any error it returns, so ignore it. */
               svn_error_clear(serve_socket(connection, connection->pool));
               close_connection(connection);
@@ -3113,6 +3113,103 @@ def commit_xml(sbox):
   sbox.simple_append('index.html', '<Q></R>', True)
   sbox.simple_commit()
 
+@SkipUnless(svntest.main.is_ra_type_dav)
+def commit_many_files_pipelined(sbox):
+  "commit many files with and without pipelining"
+
+  sbox.build()
+  wc_dir = sbox.wc_dir
+
+  names = ['file%d' % i for i in range(100)]
+  for name in names:
+    svntest.main.file_write(sbox.ospath(name), "This is %s.\n" % name)
+  sbox.simple_add(*names)
+  sbox.simple_propset('prop', 'value', *names[::3])
+
+  expected_output = svntest.wc.State(wc_dir, {})
+  expected_status = svntest.actions.get_virginal_state(wc_dir, 1)
+  for name in names:
+    expected_output.add({ name : Item(verb='Adding') })
+    expected_status.add({ name : Item(status='  ', wc_rev=2) })
+
+  # The file changes get pipelined by default.
+  svntest.actions.run_and_verify_commit(wc_dir, expected_output,
+                                        expected_status)
+
+  for name in names:
+    sbox.simple_append(name, "More of %s.\n" % name)
+  sbox.simple_propset('prop', 'changed', *names[1::3])
+
+  expected_output = svntest.wc.State(wc_dir, {})
+  for name in names:
+    expected_output.add({ name : Item(verb='Sending') })
+    expected_status.tweak(name, wc_rev=3)
+
+  # Commit with pipelining disabled.
+  svntest.actions.run_and_verify_commit(wc_dir, expected_output,
+                                        expected_status, [], wc_dir,
+                                        '--config-option',
+                                        'servers:global:'
+                                        'http-commit-pipeline-size=0')
+
+  # Both commits must have sent the same data.
+  expected_disk = svntest.main.greek_state.copy()
+  for name in names:
+    expected_disk.add({ name : Item("This is %s.\nMore of %s.\n"
+                                    % (name, name)) })
+  for name in names[::3]:
+    expected_disk.tweak(name, props={ 'prop' : 'value' })
+  for name in names[1::3]:
+    expected_disk.tweak(name, props={ 'prop' : 'changed' })
+
+  other_wc_dir = sbox.add_wc_path('other')
+  svntest.actions.run_and_verify_svn(None, [], 'checkout', '-q',
+                                     sbox.repo_url, other_wc_dir)
+  svntest.actions.verify_disk(other_wc_dir, expected_disk, True)
+
+@SkipUnless(svntest.main.is_ra_type_dav)
+def commit_pipelined_out_of_date(sbox):
+  "pipelined commit reports the first failure"
+
+  sbox.build()
+  wc_dir = sbox.wc_dir
+
+  other_wc_dir = sbox.add_wc_path('other')
+  svntest.actions.duplicate_dir(wc_dir, other_wc_dir)
+
+  # Make two files out of date in the other working copy.
+  sbox.simple_append('A/B/lambda', "New line in lambda.\n")
+  sbox.simple_append('A/D/G/rho', "New line in rho.\n")
+  sbox.simple_commit()
+
+  # Change many files around them, such that the failing PUTs happen
+  # in the middle of the commit.
+  for path in ['iota', 'A/mu', 'A/B/E/alpha', 'A/B/E/beta', 'A/B/lambda',
+               'A/D/gamma', 'A/D/G/pi', 'A/D/G/rho', 'A/D/G/tau',
+               'A/D/H/chi', 'A/D/H/omega', 'A/D/H/psi']:
+    svntest.main.file_append(os.path.join(other_wc_dir, path),
+                             "Other change.\n")
+  svntest.actions.run_and_verify_svn(None, [], 'propset', 'prop', 'value',
+                                     os.path.join(other_wc_dir, 'A/D/gamma'),
+                                     os.path.join(other_wc_dir, 'A/D/H/psi'))
+
+  for pipeline_size in ['16384', '0']:
+    exit_code, output, errput = svntest.main.run_svn(
+      1, 'commit', '-m', 'log msg', other_wc_dir,
+      '--config-option',
+      'servers:global:http-commit-pipeline-size=' + pipeline_size)
+
+    # The editor drive sends lambda before rho, so that is the failure
+    # to report, independent of when the responses arrived.
+    if not any(re.search("lambda.*out of date", line) for line in errput):
+      raise svntest.Failure("Expected lambda to be out of date")
+    if any('rho' in line for line in errput):
+      raise svntest.Failure("Only the first failure should be reported")
+
+    # The aborted commit must have removed its transaction.
+    svntest.actions.run_and_verify_svnadmin([], [],
+                                            'lstxns', sbox.repo_dir)
+
 ########################################################################
 # Run the tests
 
@@ -3190,6 +3287,8 @@ test_list = [ None,
               commit_mergeinfo_ood,
               mkdir_conflict_proper_error,
               commit_xml,
+              commit_many_files_pipelined,
+              commit_pipelined_out_of_date,
              ]
 
 if __name__ == '__main__':
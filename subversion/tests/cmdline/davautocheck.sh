@@ -342,6 +342,8 @@ HTTPD_ACCESS_LOG="$HTTPD_ROOT/access_log"
 HTTPD_ERROR_LOG="$HTTPD_ROOT/error_log"
 HTTPD_MIME_TYPES="$HTTPD_ROOT/mime.types"
 HTTPD_DONTDOTHAT="$HTTPD_ROOT/dontdothat"
+# mod_dav_svn_tests.py looks for the response cache at this location.
+HTTPD_RESPONSE_CACHE="$ABS_BUILDDIR/subversion/tests/cmdline/svn-test-work/response-cache"
 if [ -z "$BASE_URL" ]; then
   BASE_URL="http://localhost:$HTTPD_PORT"
 else
@@ -354,6 +356,8 @@ HTTPD_GROUPS="$HTTPD_ROOT/groups"
 
 mkdir "$HTTPD_ROOT" \
   || fail "couldn't create temporary directory '$HTTPD_ROOT'"
+mkdir -p "$HTTPD_RESPONSE_CACHE" \
+  || fail "couldn't create response cache directory '$HTTPD_RESPONSE_CACHE'"
 
 say "Using directory '$HTTPD_ROOT'..."
 
@@ -506,6 +510,8 @@ HostNameLookups     Off
 LogFormat           "%h %l %u %t \"%r\" %>s %b \"%{Referer}i\" \"%{User-Agent}i\"" format
 CustomLog           "$HTTPD_ROOT/req" format
 CustomLog           "$HTTPD_ROOT/ops" "%t %u %{SVN-REPOS-NAME}e %{SVN-ACTION}e" env=SVN-ACTION
+SVNResponseCacheDir "$HTTPD_RESPONSE_CACHE"
+SVNResponseCacheSize 1
 
 <Directory />
   AllowOverride     none
@@ -25,7 +25,7 @@
 ######################################################################
 
 # General modules
-import os, logging, base64, functools
+import os, logging, base64, functools, hashlib, time, zlib
 
 try:
   # Python <3.0
@@ -133,6 +133,46 @@ def verify_xml_response(expected_xml, actual_xml):
                           % (ET.tostring(expected_elem),
                              ET.tostring(actual_elem)))
 
+
+def response_cache_dir():
+  """Return the directory that davautocheck.sh configures as
+  SVNResponseCacheDir."""
+  return os.path.abspath(os.path.join(svntest.main.work_dir,
+                                      'response-cache'))
+
+def is_response_cache_enabled():
+  "Is the server's response cache available to our tests?"
+  return (svntest.main.is_ra_type_dav()
+          and os.path.isdir(response_cache_dir()))
+
+def response_cache_entry(sbox, contents):
+  """Return the path of the response cache entry for CONTENTS, a byte
+  string, in the repository of SBOX."""
+  exit_code, output, errput = svntest.main.run_svnlook('uuid', sbox.repo_dir)
+  uuid = output[0].strip()
+  sha1 = hashlib.sha1(contents).hexdigest()
+  return os.path.join(response_cache_dir(), uuid, sha1[:2], sha1)
+
+def wait_for_path(path, exists=True, timeout=30):
+  """Wait until the response cache's background thread made PATH exist or,
+  if EXISTS is False, vanish.  Raise svntest.Failure after TIMEOUT
+  seconds."""
+  deadline = time.time() + timeout
+  while os.path.exists(path) != exists:
+    if time.time() > deadline:
+      raise svntest.Failure("Timeout waiting for '%s' to %s"
+                            % (path, exists and 'appear' or 'vanish'))
+    time.sleep(0.1)
+
+def get_body(h, url, headers):
+  """GET URL through the connection H with HEADERS and return the
+  response along with its body."""
+  h.request('GET', url, None, headers)
+  r = h.getresponse()
+  if r.status != httplib.OK:
+    raise svntest.Failure('Request failed: %d %s' % (r.status, r.reason))
+  return r, r.read()
+
 ######################################################################
 # Tests
 
@@ -640,6 +680,127 @@ def propfind_propname(sbox):
   actual_response = r.read()
   verify_xml_response(expected_response, actual_response)
 
+
+@SkipUnless(is_response_cache_enabled)
+def response_cache_hit(sbox):
+  "serve file bodies from the response cache"
+
+  sbox.build()
+
+  headers = {
+    'Authorization': 'Basic ' + base64.b64encode(b'jconstant:rayjandom').decode(),
+  }
+
+  # Unique contents keep other tests from finding our cache entry.
+  contents = b'response cache ' + base64.b16encode(os.urandom(16)) + b'\n'
+  svntest.main.file_write(sbox.ospath('cached'), contents, 'wb')
+  sbox.simple_add('cached')
+  sbox.simple_commit()
+  entry = response_cache_entry(sbox, contents)
+
+  h = svntest.main.create_http_connection(sbox.repo_url)
+  url = sbox.repo_url + '/!svn/rvr/2/cached'
+
+  # The first request misses the cache and queues the entry for addition.
+  r, body = get_body(h, url, headers)
+  if body != contents:
+    raise svntest.Failure('Unexpected body: %s' % body)
+  wait_for_path(entry)
+
+  # Tampering with the entry shows that later requests are served from it.
+  svntest.main.file_write(entry, b'tampered\n', 'wb')
+  try:
+    r, body = get_body(h, url, headers)
+    if body != b'tampered\n':
+      raise svntest.Failure('Response not served from the cache')
+  finally:
+    os.remove(entry)
+
+
+@SkipUnless(is_response_cache_enabled)
+def response_cache_gzip(sbox):
+  "serve gzip variants from the response cache"
+
+  sbox.build()
+
+  headers = {
+    'Authorization': 'Basic ' + base64.b64encode(b'jconstant:rayjandom').decode(),
+  }
+  gzip_headers = dict(headers)
+  gzip_headers['Accept-Encoding'] = 'gzip'
+
+  contents = (b'compressible ' + base64.b16encode(os.urandom(16)) + b'\n') \
+             * 1000
+  svntest.main.file_write(sbox.ospath('compressible'), contents, 'wb')
+  sbox.simple_add('compressible')
+  sbox.simple_commit()
+  entry = response_cache_entry(sbox, contents)
+
+  h = svntest.main.create_http_connection(sbox.repo_url)
+  url = sbox.repo_url + '/!svn/rvr/2/compressible'
+
+  r, body = get_body(h, url, gzip_headers)
+  if body != contents or r.getheader('Content-Encoding'):
+    raise svntest.Failure('Unexpected response on cache miss')
+
+  # The gzip variant gets installed before the plain body.
+  wait_for_path(entry)
+  if not os.path.isfile(entry + '.gz'):
+    raise svntest.Failure('No gzip variant in the cache')
+
+  r, body = get_body(h, url, gzip_headers)
+  svntest.verify.compare_and_display_lines(None, 'Content-Encoding',
+                                           'gzip',
+                                           r.getheader('Content-Encoding'))
+  if not r.getheader('ETag').endswith('-gzip"'):
+    raise svntest.Failure('Unexpected ETag: %s' % r.getheader('ETag'))
+  if zlib.decompress(body, 16 + zlib.MAX_WBITS) != contents:
+    raise svntest.Failure('Unexpected gzip-encoded body')
+
+  # Clients that don't accept gzip get the plain body.
+  r, body = get_body(h, url, headers)
+  if body != contents or r.getheader('Content-Encoding'):
+    raise svntest.Failure('Unexpected response without gzip')
+  if r.getheader('ETag').endswith('-gzip"'):
+    raise svntest.Failure('Unexpected ETag: %s' % r.getheader('ETag'))
+
+
+@SkipUnless(is_response_cache_enabled)
+def response_cache_eviction(sbox):
+  "evict LRU entries from the response cache"
+
+  sbox.build()
+
+  headers = {
+    'Authorization': 'Basic ' + base64.b64encode(b'jconstant:rayjandom').decode(),
+  }
+
+  # davautocheck.sh limits the cache to 1 MB.  Random contents don't get
+  # gzip variants, so these files exceed that limit by 20%.
+  names = ['file%d' % i for i in range(12)]
+  entries = []
+  for name in names:
+    contents = os.urandom(100 * 1024)
+    svntest.main.file_write(sbox.ospath(name), contents, 'wb')
+    entries.append(response_cache_entry(sbox, contents))
+  sbox.simple_add(*names)
+  sbox.simple_commit()
+
+  h = svntest.main.create_http_connection(sbox.repo_url)
+  for i in range(len(names)):
+    get_body(h, sbox.repo_url + '/!svn/rvr/2/' + names[i], headers)
+    wait_for_path(entries[i])
+
+    # Make our entries older than any others, the first one being the
+    # oldest, such that concurrent tests can't disturb the LRU order.
+    os.utime(entries[i], (946684800 + i, 946684800 + i))
+
+  # Adding the last entries pushed the cache beyond its limit.
+  wait_for_path(entries[0], exists=False)
+  if not os.path.isfile(entries[-1]):
+    raise svntest.Failure('Most recently used entry got evicted')
+
+
 ########################################################################
 # Run the tests
 
@@ -652,6 +813,9 @@ test_list = [ None,
               propfind_404,
               propfind_allprop,
               propfind_propname,
+              response_cache_hit,
+              response_cache_gzip,
+              response_cache_eviction,
              ]
 serial_only = True
 
@@ -261,6 +261,14 @@ def is_sharded(repo_dir):
 
   return False
 
+def expected_pack_output(shards):
+  """Return the expected output of 'svnadmin pack' packing SHARDS.
+  Depending on the backend, the lines may include the packing speed."""
+
+  return svntest.verify.RegexListOutput(
+    [r'Packing revisions in shard %d\.\.\.done( \([0-9.]+ MB/s\))?\.\n'
+     % shard for shard in shards])
+
 def load_and_verify_dumpstream(sbox, expected_stdout, expected_stderr,
                                revs, check_props, dump, *varargs):
   """Load the array of lines passed in DUMP into the current tests'
@@ -1856,7 +1864,7 @@ def hotcopy_incremental_packed(sbox):
   if not (svntest.main.is_fs_type_fsfs and svntest.main.options.fsfs_packing
           and svntest.main.options.fsfs_sharding == 2):
     svntest.actions.run_and_verify_svnadmin(
-      ['Packing revisions in shard 0...done.\n'], [], "pack",
+      expected_pack_output([0]), [], "pack",
       os.path.join(cwd, sbox.repo_dir))
 
   # Commit 5 more revs, hotcopy and pack after each commit.
@@ -1875,7 +1883,7 @@ def hotcopy_incremental_packed(sbox):
       sbox.simple_commit()
       if (svntest.main.is_fs_type_fsfs and not svntest.main.options.fsfs_packing
           and not i % 2):
-        expected_output = ['Packing revisions in shard %d...done.\n' % (i/2)]
+        expected_output = expected_pack_output([i // 2])
       else:
         expected_output = []
       svntest.actions.run_and_verify_svnadmin(
@@ -2719,11 +2727,8 @@ def verify_packed(sbox):
     # can skip this part.
     pass
   else:
-    expected_output = ["Packing revisions in shard 0...done.\n",
-                       "Packing revisions in shard 1...done.\n",
-                       "Packing revisions in shard 2...done.\n"]
-    svntest.actions.run_and_verify_svnadmin(expected_output, [],
-                                            "pack", sbox.repo_dir)
+    svntest.actions.run_and_verify_svnadmin(expected_pack_output([0, 1, 2]),
+                                            [], "pack", sbox.repo_dir)
 
   if svntest.main.is_fs_log_addressing():
     expected_output = ["* Verifying metadata at revision 0 ...\n",
@@ -3436,6 +3441,59 @@ def load_from_file(sbox):
                                      'update', sbox.wc_dir)
   svntest.actions.verify_disk(sbox.wc_dir, expected_tree, check_props=True)
 
+def verify_parallel(sbox):
+  "verify with multiple jobs"
+
+  sbox.build()
+  if not svntest.main.is_fs_type_bdb():
+    patch_format(sbox.repo_dir, shard_size=2)
+
+  # Create a few more revisions, spanning multiple shards.
+  for i in range(5):
+    sbox.simple_append('iota', "Line %d.\n" % i)
+    sbox.simple_propset('prop', 'value %d' % i, 'A/mu')
+    sbox.simple_commit(message='r%d' % (i + 2))
+
+  exit_code, expected_output, errput = svntest.main.run_svnadmin(
+                                                        "verify",
+                                                        sbox.repo_dir)
+  if errput:
+    raise SVNUnexpectedStderr(errput)
+
+  # The output must not depend on the number of worker threads.
+  svntest.actions.run_and_verify_svnadmin(expected_output, [],
+                                          "verify", "--jobs", "3",
+                                          sbox.repo_dir)
+
+@SkipUnless(svntest.main.is_fs_type_fsfs)
+@SkipUnless(svntest.main.fs_has_pack)
+def pack_parallel(sbox):
+  "pack with multiple jobs"
+
+  # Configure two files per shard to trigger packing.
+  sbox.build(create_wc=False)
+  patch_format(sbox.repo_dir, shard_size=2)
+
+  # Create a few more revisions, spanning multiple shards.
+  for i in range(6):
+    svntest.actions.run_and_verify_svnmucc(None, [],
+                                           '-U', sbox.repo_url,
+                                           '-m', 'r%d' % (i + 2),
+                                           'mkdir', 'dir-%d' % i)
+
+  if svntest.main.options.fsfs_packing:
+    # With --fsfs-packing, everything is already packed.
+    expected_output = []
+  else:
+    # Shards get reported in order, no matter which one finished first.
+    expected_output = expected_pack_output(range(4))
+
+  svntest.actions.run_and_verify_svnadmin(expected_output, [],
+                                          "pack", "--jobs", "3",
+                                          sbox.repo_dir)
+  svntest.actions.run_and_verify_svnadmin(None, [],
+                                          "verify", "-q", sbox.repo_dir)
+
 ########################################################################
 # Run the tests
 
@@ -3500,7 +3558,9 @@ test_list = [ None,
               dump_no_op_prop_change,
               load_no_flush_to_disk,
               dump_to_file,
-              load_from_file
+              load_from_file,
+              verify_parallel,
+              pack_parallel,
              ]
 
 if __name__ == '__main__':
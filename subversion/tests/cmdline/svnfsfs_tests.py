@@ -248,7 +248,8 @@ def load_index_sharded(sbox):
   sbox.build(create_wc=False)
   patch_format(sbox.repo_dir, shard_size=2)
 
-  expected_output = ["Packing revisions in shard 0...done.\n"]
+  expected_output = svntest.verify.RegexListOutput(
+    [r'Packing revisions in shard 0\.\.\.done( \([0-9.]+ MB/s\))?\.\n'])
   svntest.actions.run_and_verify_svnadmin(expected_output, [],
                                           "pack", sbox.repo_dir)
 
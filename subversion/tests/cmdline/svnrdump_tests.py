@@ -982,6 +982,34 @@ def load_non_deltas_with_props(sbox):
     actual = map(str.strip, out)
     svntest.verify.compare_and_display_lines(None, 'PROPS', expected, actual)
 
+@SkipUnless(svntest.main.is_ra_type_dav)
+def dump_binary_frames(sbox):
+  "dump with and without binary frames"
+  sbox.build()
+
+  sbox.simple_append('A/mu', 'appended\n')
+  sbox.simple_propset('p', 'v', 'A/mu', 'A/B')
+  sbox.simple_copy('A/D/G', 'A/G2')
+  sbox.simple_rm('A/C')
+  sbox.simple_commit()
+  sbox.simple_propdel('p', 'A/B')
+  sbox.simple_add_text('new\n', 'A/new')
+  sbox.simple_commit()
+
+  # Replay the history once as XML and once as binary frames.
+  dumps = []
+  for frames in ['no', 'yes']:
+    dumps.append(svntest.actions.run_and_verify_svnrdump(
+                   None, svntest.verify.AnyOutput, [], 0,
+                   '-q', 'dump', sbox.repo_url,
+                   '--config-option',
+                   'servers:global:http-binary-frames=' + frames))
+
+  svntest.verify.compare_dump_files(
+    "Dump files", "DUMP", dumps[0], dumps[1])
+  compare_repos_dumps(sbox, dumps[1])
+
+
 ########################################################################
 # Run the tests
 
@@ -1043,6 +1071,7 @@ test_list = [ None,
               load_non_deltas_replace_copy_with_props,
               dump_replace_with_copy,
               load_non_deltas_with_props,
+              dump_binary_frames,
              ]
 
 if __name__ == '__main__':
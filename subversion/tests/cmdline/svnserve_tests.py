@@ -0,0 +1,182 @@
+#!/usr/bin/env python
+#
+#  svnserve_tests.py:  testing svnserve specific features.
+#
+#  Subversion is a tool for revision control.
+#  See http://subversion.apache.org for more information.
+#
+# ====================================================================
+#    Licensed to the Apache Software Foundation (ASF) under one
+#    or more contributor license agreements.  See the NOTICE file
+#    distributed with this work for additional information
+#    regarding copyright ownership.  The ASF licenses this file
+#    to you under the Apache License, Version 2.0 (the
+#    "License"); you may not use this file except in compliance
+#    with the License.  You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing,
+#    software distributed under the License is distributed on an
+#    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+#    KIND, either express or implied.  See the License for the
+#    specific language governing permissions and limitations
+#    under the License.
+######################################################################
+
+# General modules
+import os
+import socket
+import subprocess
+import time
+import logging
+
+logger = logging.getLogger()
+
+# Our testing module
+import svntest
+
+# (abbreviation)
+Skip = svntest.testcase.Skip_deco
+SkipUnless = svntest.testcase.SkipUnless_deco
+XFail = svntest.testcase.XFail_deco
+Issues = svntest.testcase.Issues_deco
+Issue = svntest.testcase.Issue_deco
+Wimp = svntest.testcase.Wimp_deco
+
+######################################################################
+# Helpers
+
+def svnserve_available():
+  return os.path.exists(svntest.main.svnserve_binary)
+
+def start_svnserve(sbox, *args):
+  """Run svnserve as a daemon in the foreground, serving the repository
+  of SBOX and passing ARGS.  Return the process and the root URL."""
+
+  # Let the OS pick a free port.
+  sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+  sock.bind(('127.0.0.1', 0))
+  port = sock.getsockname()[1]
+  sock.close()
+
+  proc = subprocess.Popen([svntest.main.svnserve_binary,
+                           '-d', '--foreground',
+                           '--listen-host', '127.0.0.1',
+                           '--listen-port', str(port),
+                           '-r', sbox.repo_dir] + list(args))
+
+  # Wait until the server accepts connections.
+  for i in range(100):
+    try:
+      socket.create_connection(('127.0.0.1', port)).close()
+      return proc, 'svn://127.0.0.1:%d' % port
+    except socket.error:
+      time.sleep(0.1)
+
+  proc.kill()
+  proc.wait()
+  raise svntest.Failure("svnserve did not start listening")
+
+def parse_metrics(path):
+  """Return the header lines and a dict mapping command names to dicts
+  of their fields from the svnserve metrics file at PATH.  Histograms
+  are dicts mapping bucket lower bounds to counts."""
+
+  header = []
+  commands = {}
+  fields = None
+  for line in open(path):
+    words = line.split()
+    if line.startswith('#'):
+      header.append(line)
+    elif words[0] == 'command':
+      fields = commands.setdefault(words[1], {})
+    elif words[0].endswith('-histogram'):
+      fields[words[0]] = dict((int(k), int(v)) for k, v in
+                              (w.split(':') for w in words[1:]))
+    else:
+      fields[words[0]] = int(words[1])
+
+  return header, commands
+
+######################################################################
+# Tests
+
+@SkipUnless(svnserve_available)
+def metrics_file(sbox):
+  "svnserve --metrics-file"
+
+  sbox.build(create_wc=False)
+  metrics_path = sbox.get_tempname('metrics')
+
+  proc, url = start_svnserve(sbox,
+                             '--metrics-file', metrics_path,
+                             '--metrics-interval', '0')
+  try:
+    for i in range(3):
+      svntest.actions.run_and_verify_svn(svntest.verify.AnyOutput, [],
+                                         'log', url)
+    svntest.actions.run_and_verify_svn(["This is the file 'iota'.\n"], [],
+                                       'cat', url + '/iota')
+
+    # The server records a command only after sending its response, so
+    # wait for the file to catch up with our last command.
+    for i in range(100):
+      if os.path.exists(metrics_path):
+        header, commands = parse_metrics(metrics_path)
+        if ('get-file' in commands
+            and commands.get('log', {}).get('count') == 3):
+          break
+      time.sleep(0.1)
+    else:
+      raise svntest.Failure("Metrics file does not cover all commands")
+  finally:
+    proc.terminate()
+    proc.wait()
+
+  if not header[0].startswith('# svnserve command metrics'):
+    raise svntest.Failure("Unexpected metrics header: %s" % header[0])
+
+  for name, fields in commands.items():
+    logger.info("%s: %s", name, fields)
+
+    for field in ['count', 'failures', 'usecs', 'bytes-in', 'bytes-out',
+                  'cache-gets', 'cache-hits']:
+      if field not in fields:
+        raise svntest.Failure("Command %s lacks '%s'" % (name, field))
+
+    # Every execution lands in exactly one bucket of each histogram.
+    for histogram in ['usecs-histogram', 'bytes-in-histogram',
+                      'bytes-out-histogram']:
+      if sum(fields[histogram].values()) != fields['count']:
+        raise svntest.Failure("Command %s: %s does not match count %d"
+                              % (name, histogram, fields['count']))
+      for bound in fields[histogram]:
+        if bound & (bound - 1):
+          raise svntest.Failure("Command %s: %s bound %d is no power of 2"
+                                % (name, histogram, bound))
+
+  if commands['log']['failures'] != 0:
+    raise svntest.Failure("Unexpected log failures")
+  if commands['get-file']['count'] != 1:
+    raise svntest.Failure("Expected exactly one get-file")
+  if commands['get-file']['bytes-out'] < len("This is the file 'iota'.\n"):
+    raise svntest.Failure("get-file sent less than the file contents")
+
+
+########################################################################
+# Run the tests
+
+
+# list all tests here, starting with None:
+test_list = [ None,
+              metrics_file,
+             ]
+
+if __name__ == '__main__':
+  svntest.main.run_tests(test_list)
+  # NOTREACHED
+
+
+### End of file.
@@ -6838,6 +6838,35 @@ def update_delete_switched(sbox):
   svntest.actions.run_and_verify_update(wc_dir, None, None, expected_status,
                                         [], False, sbox.ospath('A'), '-r', 0)
 
+@SkipUnless(svntest.main.is_ra_type_dav)
+def update_binary_frames(sbox):
+  "update with and without binary frames"
+  sbox.build()
+
+  sbox.simple_append('A/mu', 'appended\n')
+  sbox.simple_propset('p', 'v', 'A/mu', 'A/B')
+  sbox.simple_copy('A/D/G', 'A/G2')
+  sbox.simple_rm('A/C')
+  sbox.simple_commit()
+  sbox.simple_propdel('p', 'A/B')
+  sbox.simple_add_text('new\n', 'A/new')
+  sbox.simple_commit()
+
+  # Check out r1 and update to HEAD, once as XML and once as binary frames.
+  # Frames are only used for send-all responses.
+  trees = []
+  for frames in ['no', 'yes']:
+    wc_dir = sbox.add_wc_path(frames)
+    options = ['--config-option', 'servers:global:http-bulk-updates=yes',
+               '--config-option', 'servers:global:http-binary-frames=' + frames]
+    svntest.actions.run_and_verify_svn(None, [], 'checkout', '-r1',
+                                       sbox.repo_url, wc_dir, *options)
+    svntest.actions.run_and_verify_svn(None, [], 'update', wc_dir, *options)
+    trees.append(svntest.tree.build_tree_from_wc(wc_dir, load_props=True))
+
+  svntest.tree.compare_trees("disk", trees[1], trees[0])
+
+
 #######################################################################
 # Run the tests
 
@@ -6928,6 +6957,7 @@ test_list = [ None,
               update_add_conflicted_deep,
               missing_tmp_update,
               update_delete_switched,
+              update_binary_frames,
              ]
 
 if __name__ == '__main__':
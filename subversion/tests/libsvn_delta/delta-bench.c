@@ -0,0 +1,210 @@
+/* delta-bench.c -- microbenchmark for the text delta match finding
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <apr_general.h>
+#include <apr_time.h>
+
+#include "svn_delta.h"
+#include "svn_error.h"
+#include "svn_pools.h"
+#include "svn_string.h"
+
+#include "private/svn_string_private.h"
+
+
+/* Default size of the test data in kBytes and number of repetitions. */
+#define DEFAULT_SIZE 16384
+#define DEFAULT_ITERATIONS 10
+
+/* Simple linear congruential generator, so that runs are reproducible. */
+static apr_uint32_t
+next_random(apr_uint32_t *seed)
+{
+  *seed = *seed * 1103515245 + 12345;
+  return *seed >> 8;
+}
+
+/* Return SIZE bytes of source data with a mix of repetitive and random
+   content, roughly resembling a binary file.  Allocate it in POOL. */
+static svn_string_t *
+make_source(apr_size_t size,
+            apr_uint32_t *seed,
+            apr_pool_t *pool)
+{
+  char *data = apr_palloc(pool, size + 1);
+  apr_size_t i;
+
+  for (i = 0; i < size; ++i)
+    data[i] = (i & 0x1000) ? (char)next_random(seed) : (char)(i % 251);
+  data[size] = '\0';
+
+  return svn_string_ncreate(data, size, pool);
+}
+
+/* Return a modified copy of SOURCE: replace a few bytes every couple of
+   kBytes and insert some data now and then.  Allocate it in POOL. */
+static svn_string_t *
+make_target(const svn_string_t *source,
+            apr_uint32_t *seed,
+            apr_pool_t *pool)
+{
+  svn_stringbuf_t *target = svn_stringbuf_create_ensure(source->len + 0x1000,
+                                                        pool);
+  apr_size_t pos = 0;
+
+  while (pos < source->len)
+    {
+      apr_size_t chunk = 0x800 + next_random(seed) % 0x2000;
+      apr_size_t k;
+
+      if (chunk > source->len - pos)
+        chunk = source->len - pos;
+
+      svn_stringbuf_appendbytes(target, source->data + pos, chunk);
+      pos += chunk;
+
+      for (k = next_random(seed) % 32; k > 0; --k)
+        svn_stringbuf_appendbyte(target, (char)next_random(seed));
+      pos += next_random(seed) % 16;
+    }
+
+  return svn_stringbuf__morph_into_string(target);
+}
+
+/* Print the throughput for processing SIZE bytes ITERATIONS times within
+   DURATION microseconds, prefixed with NAME. */
+static void
+print_throughput(const char *name,
+                 apr_size_t size,
+                 int iterations,
+                 apr_interval_time_t duration)
+{
+  double mb = (double)size * iterations / (1024.0 * 1024.0);
+  double seconds = duration / (double)APR_USEC_PER_SEC;
+
+  printf("%-28s %10.1f MB/s  (%.3f s)\n", name,
+         seconds > 0 ? mb / seconds : 0.0, seconds);
+}
+
+/* Deltify TARGET against SOURCE ITERATIONS times and report the speed. */
+static svn_error_t *
+bench_deltify(const svn_string_t *source,
+              const svn_string_t *target,
+              int iterations,
+              apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  apr_time_t start = apr_time_now();
+  int i;
+
+  for (i = 0; i < iterations; ++i)
+    {
+      svn_txdelta_stream_t *stream;
+
+      svn_pool_clear(iterpool);
+      svn_txdelta2(&stream,
+                   svn_stream_from_string(source, iterpool),
+                   svn_stream_from_string(target, iterpool),
+                   FALSE, iterpool);
+      SVN_ERR(svn_txdelta_send_txstream(stream, svn_delta_noop_window_handler,
+                                        NULL, iterpool));
+    }
+
+  print_throughput("deltification", target->len, iterations,
+                   apr_time_now() - start);
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Scan the common prefix and suffix of two copies of SOURCE ITERATIONS
+   times and report the speed. */
+static void
+bench_match_length(const svn_string_t *source,
+                   int iterations,
+                   apr_pool_t *pool)
+{
+  char *copy = apr_pmemdup(pool, source->data, source->len);
+  apr_size_t total = 0;
+  apr_time_t start;
+  int i;
+
+  start = apr_time_now();
+  for (i = 0; i < iterations; ++i)
+    total += svn_cstring__match_length(source->data, copy, source->len);
+  print_throughput("svn_cstring__match_length", source->len, iterations,
+                   apr_time_now() - start);
+
+  start = apr_time_now();
+  for (i = 0; i < iterations; ++i)
+    total += svn_cstring__reverse_match_length(source->data + source->len,
+                                               copy + source->len,
+                                               source->len);
+  print_throughput("svn_cstring__reverse_match", source->len, iterations,
+                   apr_time_now() - start);
+
+  /* Keep the compiler from optimizing the scans away. */
+  if (total != 2 * (apr_size_t)iterations * source->len)
+    printf("unexpected match length\n");
+}
+
+int
+main(int argc, char **argv)
+{
+  apr_pool_t *pool;
+  svn_string_t *source, *target;
+  apr_uint32_t seed = 0x5eed;
+  apr_size_t size = DEFAULT_SIZE;
+  int iterations = DEFAULT_ITERATIONS;
+  svn_error_t *err;
+
+  if (argc > 1)
+    size = (apr_size_t)atol(argv[1]);
+  if (argc > 2)
+    iterations = atoi(argv[2]);
+  if (argc > 3 || size == 0 || iterations <= 0)
+    {
+      printf("usage: %s [size in kB] [iterations]\n", argv[0]);
+      exit(0);
+    }
+
+  apr_initialize();
+  pool = svn_pool_create(NULL);
+
+  source = make_source(size * 1024, &seed, pool);
+  target = make_target(source, &seed, pool);
+
+  printf("%lu kB of data, %d iterations\n", (unsigned long)size, iterations);
+
+  err = bench_deltify(source, target, iterations, pool);
+  if (err)
+    svn_handle_error2(err, stderr, TRUE, "delta-bench: ");
+
+  bench_match_length(source, iterations, pool);
+
+  svn_pool_destroy(pool);
+  apr_terminate();
+  exit(0);
+}
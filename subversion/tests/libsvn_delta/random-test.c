@@ -37,6 +37,7 @@
 #include "svn_pools.h"
 #include "svn_error.h"
 
+#include "private/svn_delta_private.h"
 #include "../../libsvn_delta/delta.h"
 #include "delta-window-test.h"
 
@@ -280,10 +281,12 @@ copy_tempfile(apr_file_t *fp, apr_pool_t *pool)
 
 
 
-/* (Note: *LAST_SEED is an output parameter.) */
+/* Run the random delta test, transmitting the deltas in SVNDIFF_VERSION.
+   (Note: *LAST_SEED is an output parameter.) */
 static svn_error_t *
 do_random_test(apr_pool_t *pool,
-               apr_uint32_t *last_seed)
+               apr_uint32_t *last_seed,
+               int svndiff_version)
 {
   apr_uint32_t seed, maxlen;
   apr_size_t bytes_range;
@@ -330,8 +333,8 @@ do_random_test(apr_pool_t *pool,
 
       /* Make stage 2: encode the text delta in svndiff format using
                        varying compression levels. */
-      svn_txdelta_to_svndiff3(&handler, &handler_baton, stream, 1, i % 10,
-                              delta_pool);
+      svn_txdelta_to_svndiff3(&handler, &handler_baton, stream,
+                              svndiff_version, i % 10, delta_pool);
 
       /* Make stage 1: create the text delta.  */
       svn_txdelta2(&txdelta_stream,
@@ -363,7 +366,18 @@ static svn_error_t *
 random_test(apr_pool_t *pool)
 {
   apr_uint32_t seed;
-  svn_error_t *err = do_random_test(pool, &seed);
+  svn_error_t *err = do_random_test(pool, &seed, 1);
+  if (err)
+    fprintf(stderr, "SEED: %lu\n", (unsigned long)seed);
+  return err;
+}
+
+/* Implements svn_test_driver_t. */
+static svn_error_t *
+random_svndiff2_test(apr_pool_t *pool)
+{
+  apr_uint32_t seed;
+  svn_error_t *err = do_random_test(pool, &seed, 2);
   if (err)
     fprintf(stderr, "SEED: %lu\n", (unsigned long)seed);
   return err;
@@ -521,6 +535,211 @@ random_combine_test(apr_pool_t *pool)
 #endif
 
 
+/* Return LEN pseudo-random bytes based on *SEED, allocated in POOL. */
+static svn_string_t *
+make_random_string(apr_size_t len,
+                   apr_uint32_t *seed,
+                   apr_pool_t *pool)
+{
+  char *data = apr_palloc(pool, len + 1);
+  apr_size_t i;
+
+  for (i = 0; i < len; ++i)
+    data[i] = (char)svn_test_rand(seed);
+  data[len] = '\0';
+
+  return svn_string_ncreate(data, len, pool);
+}
+
+/* Deltify TARGET against SOURCE using windows of up to WINDOW_SIZE bytes,
+   sliding the source view if SLIDE_SOURCE is set.  Encode the delta in
+   SVNDIFF_VERSION at COMPRESSION_LEVEL and return it in *SVNDIFF. */
+static svn_error_t *
+encode_delta(svn_stringbuf_t **svndiff,
+             const svn_string_t *source,
+             const svn_string_t *target,
+             apr_size_t window_size,
+             svn_boolean_t slide_source,
+             int svndiff_version,
+             int compression_level,
+             apr_pool_t *pool)
+{
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+  svn_stream_t *stream;
+  apr_size_t len = target->len;
+
+  *svndiff = svn_stringbuf_create_empty(pool);
+  svn_txdelta_to_svndiff3(&handler, &handler_baton,
+                          svn_stream_from_stringbuf(*svndiff, pool),
+                          svndiff_version, compression_level, pool);
+  stream = svn_txdelta__target_push(handler, handler_baton,
+                                    svn_stream_from_string(source, pool),
+                                    window_size, slide_source, pool);
+  SVN_ERR(svn_stream_write(stream, target->data, &len));
+  return svn_error_trace(svn_stream_close(stream));
+}
+
+/* Parse SVNDIFF, apply it to SOURCE and return the result in *RESULT. */
+static svn_error_t *
+decode_delta(svn_stringbuf_t **result,
+             const svn_string_t *source,
+             const svn_stringbuf_t *svndiff,
+             apr_pool_t *pool)
+{
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+  svn_stream_t *stream;
+  apr_size_t len = svndiff->len;
+
+  *result = svn_stringbuf_create_empty(pool);
+  svn_txdelta_apply(svn_stream_from_string(source, pool),
+                    svn_stream_from_stringbuf(*result, pool),
+                    NULL, NULL, pool, &handler, &handler_baton);
+  stream = svn_txdelta_parse_svndiff(handler, handler_baton, TRUE, pool);
+  SVN_ERR(svn_stream_write(stream, svndiff->data, &len));
+  return svn_error_trace(svn_stream_close(stream));
+}
+
+/* Implements svn_test_driver_t. */
+static svn_error_t *
+large_window_test(apr_pool_t *pool)
+{
+  apr_uint32_t seed = 0x1234;
+  svn_string_t *source, *insertion;
+  svn_stringbuf_t *target, *small_delta, *large_delta, *result;
+
+  /* Insert more than a standard window's worth of data in front of some
+     incompressible source.  Standard windows will not find any matches. */
+  source = make_random_string(4 * SVN_DELTA_WINDOW_SIZE, &seed, pool);
+  insertion = make_random_string(2 * SVN_DELTA_WINDOW_SIZE, &seed, pool);
+  target = svn_stringbuf_create_from_string(insertion, pool);
+  svn_stringbuf_appendbytes(target, source->data, source->len);
+
+  SVN_ERR(encode_delta(&small_delta, source,
+                       svn_string_create_from_buf(target, pool),
+                       SVN_DELTA_WINDOW_SIZE, FALSE, 2,
+                       SVN_DELTA_COMPRESSION_LEVEL_DEFAULT, pool));
+  SVN_ERR(encode_delta(&large_delta, source,
+                       svn_string_create_from_buf(target, pool),
+                       SVN_DELTA_LARGE_WINDOW_SIZE, FALSE, 3,
+                       SVN_DELTA_COMPRESSION_LEVEL_DEFAULT, pool));
+
+  /* Large windows find the moved source data. */
+  SVN_TEST_ASSERT(large_delta->len < insertion->len + SVN_DELTA_WINDOW_SIZE);
+  SVN_TEST_ASSERT(large_delta->len < small_delta->len / 2);
+
+  /* Both round-trip. */
+  SVN_ERR(decode_delta(&result, source, small_delta, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(result, target));
+  SVN_ERR(decode_delta(&result, source, large_delta, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(result, target));
+
+  /* Older svndiff versions must not contain large windows. */
+  SVN_ERR(encode_delta(&large_delta, source,
+                       svn_string_create_from_buf(target, pool),
+                       SVN_DELTA_LARGE_WINDOW_SIZE, FALSE, 2,
+                       SVN_DELTA_COMPRESSION_LEVEL_DEFAULT, pool));
+  SVN_TEST_ASSERT_ERROR(decode_delta(&result, source, large_delta, pool),
+                        SVN_ERR_SVNDIFF_CORRUPT_WINDOW);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_test_driver_t. */
+static svn_error_t *
+compact_instructions_test(apr_pool_t *pool)
+{
+  apr_uint32_t seed = 0x4321;
+  svn_string_t *source;
+  svn_stringbuf_t *target, *v2_delta, *v3_delta, *result;
+  apr_size_t i;
+
+  /* Scattered single byte changes produce many source copies far into
+     the window, each continuing right behind the previous one. */
+  source = make_random_string(4 * SVN_DELTA_WINDOW_SIZE, &seed, pool);
+  target = svn_stringbuf_create_from_string(source, pool);
+  for (i = 0; i < target->len; i += 1000)
+    target->data[i] ^= 0x55;
+
+  /* Without compression, only the instruction encoding differs. */
+  SVN_ERR(encode_delta(&v2_delta, source,
+                       svn_string_create_from_buf(target, pool),
+                       SVN_DELTA_WINDOW_SIZE, FALSE, 2,
+                       SVN_DELTA_COMPRESSION_LEVEL_NONE, pool));
+  SVN_ERR(encode_delta(&v3_delta, source,
+                       svn_string_create_from_buf(target, pool),
+                       SVN_DELTA_WINDOW_SIZE, FALSE, 3,
+                       SVN_DELTA_COMPRESSION_LEVEL_NONE, pool));
+
+  /* Relative source offsets take 1 byte instead of up to 3. */
+  SVN_TEST_ASSERT(v3_delta->len + target->len / 1000 < v2_delta->len);
+
+  SVN_ERR(decode_delta(&result, source, v3_delta, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(result, target));
+
+  return SVN_NO_ERROR;
+}
+/* Implements svn_test_driver_t. */
+static svn_error_t *
+sliding_window_test(apr_pool_t *pool)
+{
+  apr_uint32_t seed = 0x5678;
+  svn_string_t *source, *insertion;
+  svn_stringbuf_t *target, *fixed_delta, *sliding_delta, *result;
+
+  /* Insert more than a large window's worth of data in front of some
+     incompressible source.  Even large windows find nothing when their
+     source views stay in lockstep with the target. */
+  source = make_random_string(6 * SVN_DELTA_LARGE_WINDOW_SIZE, &seed, pool);
+  insertion = make_random_string(3 * SVN_DELTA_LARGE_WINDOW_SIZE / 2,
+                                 &seed, pool);
+  target = svn_stringbuf_create_from_string(insertion, pool);
+  svn_stringbuf_appendbytes(target, source->data, source->len);
+
+  SVN_ERR(encode_delta(&fixed_delta, source,
+                       svn_string_create_from_buf(target, pool),
+                       SVN_DELTA_LARGE_WINDOW_SIZE, FALSE, 3,
+                       SVN_DELTA_COMPRESSION_LEVEL_DEFAULT, pool));
+  SVN_ERR(encode_delta(&sliding_delta, source,
+                       svn_string_create_from_buf(target, pool),
+                       SVN_DELTA_LARGE_WINDOW_SIZE, TRUE, 3,
+                       SVN_DELTA_COMPRESSION_LEVEL_DEFAULT, pool));
+
+  /* The sliding view stays on the insertion until it finds the source
+     data again and then follows it. */
+  SVN_TEST_ASSERT(sliding_delta->len
+                  < insertion->len + SVN_DELTA_LARGE_WINDOW_SIZE / 8);
+  SVN_TEST_ASSERT(sliding_delta->len < fixed_delta->len / 2);
+
+  SVN_ERR(decode_delta(&result, source, sliding_delta, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(result, target));
+
+  /* Replacing a long stretch of data makes the view catch up with the
+     target, skipping source data. */
+  target = svn_stringbuf_ncreate(source->data,
+                                 SVN_DELTA_LARGE_WINDOW_SIZE / 2, pool);
+  insertion = make_random_string(9 * SVN_DELTA_LARGE_WINDOW_SIZE / 2,
+                                 &seed, pool);
+  svn_stringbuf_appendbytes(target, insertion->data, insertion->len);
+  svn_stringbuf_appendbytes(target,
+                            source->data + 5 * SVN_DELTA_LARGE_WINDOW_SIZE,
+                            SVN_DELTA_LARGE_WINDOW_SIZE);
+
+  SVN_ERR(encode_delta(&sliding_delta, source,
+                       svn_string_create_from_buf(target, pool),
+                       SVN_DELTA_LARGE_WINDOW_SIZE, TRUE, 3,
+                       SVN_DELTA_COMPRESSION_LEVEL_DEFAULT, pool));
+  SVN_TEST_ASSERT(sliding_delta->len
+                  < insertion->len + SVN_DELTA_LARGE_WINDOW_SIZE / 8);
+
+  SVN_ERR(decode_delta(&result, source, sliding_delta, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(result, target));
+
+  return SVN_NO_ERROR;
+}
+
+
 
 /* The test table.  */
 
@@ -531,8 +750,16 @@ static struct svn_test_descriptor_t test_funcs[] =
     SVN_TEST_NULL,
     SVN_TEST_PASS2(random_test,
                    "random delta test"),
+    SVN_TEST_PASS2(random_svndiff2_test,
+                   "random delta test using svndiff2"),
     SVN_TEST_PASS2(random_combine_test,
                    "random combine delta test"),
+    SVN_TEST_PASS2(large_window_test,
+                   "delta windows of up to 1 MB using svndiff3"),
+    SVN_TEST_PASS2(compact_instructions_test,
+                   "relative instruction offsets in svndiff3"),
+    SVN_TEST_PASS2(sliding_window_test,
+                   "sliding svndiff3 source views"),
 #ifdef SVN_RANGE_INDEX_TEST_H
     SVN_TEST_PASS2(random_range_index_test,
                    "random range index test"),
@@ -0,0 +1,147 @@
+/* commit-bench.c -- measure the commit latency of FSFS repositories
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <apr_general.h>
+#include <apr_time.h>
+
+#include "svn_error.h"
+#include "svn_fs.h"
+#include "svn_hash.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+
+
+/* Default number of commits to time. */
+#define DEFAULT_COMMITS 100
+
+/* Compare two apr_interval_time_t values.  Implements the qsort()
+   comparison function type. */
+static int
+compare_durations(const void *lhs,
+                  const void *rhs)
+{
+  apr_interval_time_t a = *(const apr_interval_time_t *)lhs;
+  apr_interval_time_t b = *(const apr_interval_time_t *)rhs;
+
+  return a < b ? -1 : (a > b ? 1 : 0);
+}
+
+/* Create a new FSFS repository at PATH and commit COMMITS revisions to it,
+   each one modifying a file and adding another one.  Flush the data to
+   disk unless NO_FLUSH has been set.  Print the commit latencies.  */
+static svn_error_t *
+bench_commits(const char *path,
+              int commits,
+              svn_boolean_t no_flush,
+              apr_pool_t *pool)
+{
+  apr_hash_t *fs_config = apr_hash_make(pool);
+  apr_interval_time_t *durations;
+  apr_interval_time_t total = 0;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_fs_t *fs;
+  int i;
+
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FS_TYPE, SVN_FS_TYPE_FSFS);
+  if (no_flush)
+    svn_hash_sets(fs_config, SVN_FS_CONFIG_NO_FLUSH_TO_DISK, "1");
+
+  SVN_ERR(svn_fs_create2(&fs, path, fs_config, pool, iterpool));
+
+  durations = apr_pcalloc(pool, commits * sizeof(*durations));
+  for (i = 0; i < commits; ++i)
+    {
+      svn_fs_txn_t *txn;
+      svn_fs_root_t *root;
+      svn_revnum_t rev;
+      const char *conflict;
+      const char *name;
+      apr_time_t start;
+
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(svn_fs_begin_txn2(&txn, fs, i, 0, iterpool));
+      SVN_ERR(svn_fs_txn_root(&root, txn, iterpool));
+
+      name = apr_psprintf(iterpool, "/file-%d", i);
+      SVN_ERR(svn_fs_make_file(root, name, iterpool));
+      if (i > 0)
+        {
+          svn_stream_t *stream;
+          SVN_ERR(svn_fs_apply_text(&stream, root, "/file-0", NULL,
+                                    iterpool));
+          SVN_ERR(svn_stream_printf(stream, iterpool, "revision %d\n", i));
+          SVN_ERR(svn_stream_close(stream));
+        }
+
+      /* Only the actual commit is being timed. */
+      start = apr_time_now();
+      SVN_ERR(svn_fs_commit_txn(&conflict, &rev, txn, iterpool));
+      durations[i] = apr_time_now() - start;
+      total += durations[i];
+    }
+
+  svn_pool_destroy(iterpool);
+
+  qsort(durations, commits, sizeof(*durations), compare_durations);
+  printf("%d commits%s\n", commits, no_flush ? " without fsync" : "");
+  printf("  average %8.3f ms\n", total / 1000.0 / commits);
+  printf("  median  %8.3f ms\n", durations[commits / 2] / 1000.0);
+  printf("  maximum %8.3f ms\n", durations[commits - 1] / 1000.0);
+
+  return SVN_NO_ERROR;
+}
+
+int
+main(int argc, char **argv)
+{
+  apr_pool_t *pool;
+  int commits = DEFAULT_COMMITS;
+  svn_boolean_t no_flush = FALSE;
+  svn_error_t *err;
+
+  if (argc > 2)
+    commits = atoi(argv[2]);
+  if (argc > 3)
+    no_flush = !strcmp(argv[3], "--no-flush");
+  if (argc < 2 || argc > 4 || commits <= 0)
+    {
+      printf("usage: %s REPOS_PATH [commits] [--no-flush]\n", argv[0]);
+      exit(0);
+    }
+
+  apr_initialize();
+  pool = svn_pool_create(NULL);
+
+  err = svn_fs_initialize(pool);
+  if (!err)
+    err = bench_commits(argv[1], commits, no_flush, pool);
+  if (err)
+    svn_handle_error2(err, stderr, TRUE, "commit-bench: ");
+
+  svn_pool_destroy(pool);
+  apr_terminate();
+  exit(0);
+}
@@ -30,6 +30,7 @@
 #include "../../libsvn_fs_fs/fs_fs.h"
 #include "../../libsvn_fs_fs/low_level.h"
 #include "../../libsvn_fs_fs/pack.h"
+#include "../../libsvn_fs_fs/transaction.h"
 #include "../../libsvn_fs_fs/util.h"
 
 #include "svn_hash.h"
@@ -1795,7 +1796,7 @@ pack_with_limited_memory(const svn_test_opts_t *opts,
 
       /* Pack it with a narrow memory budget. */
       SVN_ERR(svn_fs_open2(&fs, dir, NULL, iterpool, iterpool));
-      SVN_ERR(svn_fs_fs__pack(fs, max_mem, NULL, NULL, NULL, NULL,
+      SVN_ERR(svn_fs_fs__pack(fs, max_mem, 1, NULL, NULL, NULL, NULL,
                               iterpool));
 
       /* To be sure: Verify that we didn't break the repo. */
@@ -1887,6 +1888,562 @@ large_delta_against_plain(const svn_test_opts_t *opts,
 
 #undef REPO_NAME
 
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-lz4_compressed_deltas"
+
+static svn_error_t *
+lz4_compressed_deltas(const svn_test_opts_t *opts,
+                      apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  svn_stringbuf_t *contents;
+  svn_stringbuf_t *contents_read;
+  int i;
+  apr_hash_t *fs_config;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  if (opts->server_minor_version && (opts->server_minor_version < 10))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.10 SVN doesn't support svndiff2");
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  ffd = fs->fsap_data;
+
+  /* Store all deltas as svndiff2. */
+  ffd->delta_compression_type = compression_type_lz4;
+
+  /* Construct compressible contents larger than 2 txdelta windows. */
+  contents = svn_stringbuf_create_empty(pool);
+  for (i = 0; contents->len <= 2 * 102400; ++i)
+    svn_stringbuf_appendcstr(contents,
+                             apr_psprintf(pool, "line %d of the file\n", i));
+
+  /* Revision 1: add the file (self-delta). */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_file(root, "foo", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "foo", contents->data, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* Revision 2: modify it (delta against r1). */
+  svn_stringbuf_insert(contents, 1000, "inserted text", 13);
+  svn_stringbuf_appendcstr(contents, "tail\n");
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(root, "foo", contents->data, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* Reconstructing the contents must work.  To make sure we actually read
+   * from disk, use a new FS instance with disjoint caches. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                           svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+  SVN_ERR(svn_test__get_file_contents(root, "foo", &contents_read, pool));
+  SVN_TEST_STRING_ASSERT(contents_read->data, contents->data);
+
+  /* The repository must still be consistent. */
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, SVN_INVALID_REVNUM, NULL, NULL,
+                        NULL, NULL, pool));
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-sliding_delta_windows"
+
+static svn_error_t *
+sliding_delta_windows(const svn_test_opts_t *opts,
+                      apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  svn_stringbuf_t *contents, *insertion;
+  svn_stringbuf_t *contents_read;
+  int i;
+  apr_hash_t *fs_config;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  ffd = fs->fsap_data;
+  if (ffd->format < SVN_FS_FS__MIN_SVNDIFF3_FORMAT)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "format doesn't support svndiff3");
+
+  /* Store all deltas as svndiff3 with 1MB windows. */
+  ffd->delta_window_size = 1024 * 1024;
+
+  /* Construct contents of several windows. */
+  contents = svn_stringbuf_create_empty(pool);
+  for (i = 0; contents->len <= 3 * 1024 * 1024; ++i)
+    svn_stringbuf_appendcstr(contents,
+                             apr_psprintf(pool, "line %d of the file\n", i));
+
+  /* Revision 1: add the file (self-delta). */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_file(root, "foo", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "foo", contents->data, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* Revision 2: insert more than a window in front of it.  The source
+   * views of the delta against r1 must slide to find the old contents. */
+  insertion = svn_stringbuf_create_empty(pool);
+  for (i = 0; insertion->len <= 3 * 1024 * 1024 / 2; ++i)
+    svn_stringbuf_appendcstr(insertion,
+                             apr_psprintf(pool, "new line %d\n", i));
+  svn_stringbuf_insert(contents, 0, insertion->data, insertion->len);
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(root, "foo", contents->data, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* Revision 3: a standard delta on top of the svndiff3 chain. */
+  ffd->delta_window_size = 102400;
+  svn_stringbuf_appendcstr(contents, "tail\n");
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(root, "foo", contents->data, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* Reconstructing the contents must work.  To make sure we actually read
+   * from disk, use a new FS instance with disjoint caches. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                           svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+  SVN_ERR(svn_test__get_file_contents(root, "foo", &contents_read, pool));
+  SVN_TEST_STRING_ASSERT(contents_read->data, contents->data);
+
+  svn_stringbuf_chop(contents, 5);
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev - 1, pool));
+  SVN_ERR(svn_test__get_file_contents(root, "foo", &contents_read, pool));
+  SVN_TEST_STRING_ASSERT(contents_read->data, contents->data);
+
+  /* The repository must still be consistent. */
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, SVN_INVALID_REVNUM, NULL, NULL,
+                        NULL, NULL, pool));
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-large_file_storage"
+#define SHARD_SIZE 2
+
+/* Set *CONTENTS to a string of LEN bytes that depends on SEED. */
+static void
+large_file_contents(svn_stringbuf_t **contents,
+                    apr_size_t len,
+                    int seed,
+                    apr_pool_t *pool)
+{
+  int i;
+
+  *contents = svn_stringbuf_create_empty(pool);
+  for (i = 0; (*contents)->len < len; ++i)
+    svn_stringbuf_appendcstr(*contents,
+                             apr_psprintf(pool, "%d: line %d\n", seed, i));
+}
+
+static svn_error_t *
+large_file_storage(const svn_test_opts_t *opts,
+                   apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  svn_stringbuf_t *contents1;
+  svn_stringbuf_t *contents2;
+  svn_stringbuf_t *contents_read;
+  apr_hash_t *fs_config;
+  apr_hash_t *dirents;
+  apr_file_t *file;
+  apr_off_t offset;
+  svn_filesize_t length;
+  int pass;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  if (opts->server_minor_version && (opts->server_minor_version < 10))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.10 SVN doesn't support large file storage");
+
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_SHARD_SIZE,
+                apr_itoa(pool, SHARD_SIZE));
+  SVN_ERR(svn_test__create_fs2(&fs, REPO_NAME, opts, fs_config, pool));
+  ffd = fs->fsap_data;
+
+  /* Store everything from 4kB upwards out-of-line. */
+  ffd->large_file_threshold = 0x1000;
+  large_file_contents(&contents1, 0x4000, 1, pool);
+  large_file_contents(&contents2, 0x4000, 2, pool);
+
+  /* Revision 1: add a large and a small file. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_file(root, "big", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "big", contents1->data, pool));
+  SVN_ERR(svn_fs_make_file(root, "small", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "small", "small\n", pool));
+
+  /* Large reps must be readable within the txn. */
+  SVN_ERR(svn_test__get_file_contents(root, "big", &contents_read, pool));
+  SVN_TEST_STRING_ASSERT(contents_read->data, contents1->data);
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* Revision 2: modify the large file and add a copy of its contents,
+   * which may share the same large rep. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(root, "big", contents2->data, pool));
+  SVN_ERR(svn_fs_make_file(root, "big2", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "big2", contents2->data, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* Revision 3: complete the second shard. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(root, "small", "smaller\n", pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* The contents went into the large rep shards. */
+  SVN_ERR(svn_io_get_dirents3(&dirents,
+                              svn_fs_fs__path_large_shard(fs, 1, pool),
+                              TRUE, pool, pool));
+  SVN_TEST_ASSERT(apr_hash_count(dirents) >= 1);
+  SVN_ERR(svn_io_get_dirents3(&dirents,
+                              svn_fs_fs__path_large_shard(fs, 2, pool),
+                              TRUE, pool, pool));
+  SVN_TEST_ASSERT(apr_hash_count(dirents) >= 1);
+
+  /* Read everything back before and after packing.  To make sure we
+   * actually read from disk, use new FS instances with disjoint caches. */
+  for (pass = 0; pass < 2; ++pass)
+    {
+      fs_config = apr_hash_make(pool);
+      svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                               svn_uuid_generate(pool));
+      SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+
+      SVN_ERR(svn_fs_revision_root(&root, fs, 1, pool));
+      SVN_ERR(svn_test__get_file_contents(root, "big", &contents_read,
+                                          pool));
+      SVN_TEST_STRING_ASSERT(contents_read->data, contents1->data);
+
+      SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+      SVN_ERR(svn_test__get_file_contents(root, "big", &contents_read,
+                                          pool));
+      SVN_TEST_STRING_ASSERT(contents_read->data, contents2->data);
+      SVN_ERR(svn_test__get_file_contents(root, "big2", &contents_read,
+                                          pool));
+      SVN_TEST_STRING_ASSERT(contents_read->data, contents2->data);
+      SVN_ERR(svn_test__get_file_contents(root, "small", &contents_read,
+                                          pool));
+      SVN_TEST_STRING_ASSERT(contents_read->data, "smaller\n");
+
+      /* Only large reps can be sent verbatim. */
+      SVN_ERR(svn_fs_file_contents_span(&file, &offset, &length, root,
+                                        "big2", pool, pool));
+      SVN_TEST_ASSERT(file != NULL);
+      SVN_TEST_ASSERT(length == contents2->len);
+      contents_read = svn_stringbuf_create_ensure(contents2->len, pool);
+      SVN_ERR(svn_io_file_seek(file, APR_SET, &offset, pool));
+      SVN_ERR(svn_io_file_read_full2(file, contents_read->data,
+                                     contents2->len, &contents_read->len,
+                                     NULL, pool));
+      contents_read->data[contents_read->len] = '\0';
+      SVN_TEST_STRING_ASSERT(contents_read->data, contents2->data);
+      SVN_ERR(svn_io_file_close(file, pool));
+
+      SVN_ERR(svn_fs_file_contents_span(&file, &offset, &length, root,
+                                        "small", pool, pool));
+      SVN_TEST_ASSERT(file == NULL);
+
+      SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, SVN_INVALID_REVNUM,
+                            NULL, NULL, NULL, NULL, pool));
+
+      if (pass == 0)
+        SVN_ERR(svn_fs_pack(REPO_NAME, NULL, NULL, NULL, NULL, pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef SHARD_SIZE
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-large_rep_superseded"
+#define SHARD_SIZE 2
+
+/* Set *COUNT to the number of large rep files in directory DIR.
+ * Use POOL for temporary allocations. */
+static svn_error_t *
+count_large_reps(int *count,
+                 const char *dir,
+                 apr_pool_t *pool)
+{
+  apr_hash_t *dirents;
+  apr_hash_index_t *hi;
+
+  SVN_ERR(svn_io_get_dirents3(&dirents, dir, TRUE, pool, pool));
+
+  *count = 0;
+  for (hi = apr_hash_first(pool, dirents); hi; hi = apr_hash_next(hi))
+    {
+      const char *name = apr_hash_this_key(hi);
+      if (   strcmp(name, PATH_LARGE_TMP)
+          && !strncmp(name, PATH_PREFIX_LARGE, strlen(PATH_PREFIX_LARGE)))
+        ++*count;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+large_rep_superseded(const svn_test_opts_t *opts,
+                     apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  svn_stringbuf_t *contents1;
+  svn_stringbuf_t *contents2;
+  svn_stringbuf_t *contents3;
+  svn_stringbuf_t *contents_read;
+  apr_hash_t *fs_config;
+  const char *txn_dir;
+  int count;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  if (opts->server_minor_version && (opts->server_minor_version < 10))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.10 SVN doesn't support large file storage");
+
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_SHARD_SIZE,
+                apr_itoa(pool, SHARD_SIZE));
+  SVN_ERR(svn_test__create_fs2(&fs, REPO_NAME, opts, fs_config, pool));
+  ffd = fs->fsap_data;
+
+  ffd->large_file_threshold = 0x1000;
+  large_file_contents(&contents1, 0x4000, 1, pool);
+  large_file_contents(&contents2, 0x4000, 2, pool);
+  large_file_contents(&contents3, 0x4000, 3, pool);
+
+  /* Without rep sharing, superseded and deleted contents get removed
+   * right away. */
+  ffd->rep_sharing_allowed = FALSE;
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  txn_dir = svn_fs_fs__path_txn_dir(fs, svn_fs_fs__txn_get_id(txn), pool);
+
+  SVN_ERR(svn_fs_make_file(root, "big", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "big", contents1->data, pool));
+  SVN_ERR(svn_test__set_file_contents(root, "big", contents2->data, pool));
+  SVN_ERR(count_large_reps(&count, txn_dir, pool));
+  SVN_TEST_INT_ASSERT(count, 1);
+
+  SVN_ERR(svn_fs_make_file(root, "gone", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "gone", contents3->data, pool));
+  SVN_ERR(svn_fs_delete(root, "gone", pool));
+  SVN_ERR(count_large_reps(&count, txn_dir, pool));
+  SVN_TEST_INT_ASSERT(count, 1);
+
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+  SVN_ERR(count_large_reps(&count, svn_fs_fs__path_large_shard(fs, rev, pool),
+                           pool));
+  SVN_TEST_INT_ASSERT(count, 1);
+
+  /* With rep sharing, other nodes might use superseded contents, so those
+   * only get dropped at commit time. */
+  ffd->rep_sharing_allowed = TRUE;
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(root, "big", contents1->data, pool));
+  SVN_ERR(svn_fs_make_file(root, "big2", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "big2", contents1->data, pool));
+  SVN_ERR(svn_test__set_file_contents(root, "big", contents3->data, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  SVN_ERR(count_large_reps(&count, svn_fs_fs__path_large_shard(fs, rev, pool),
+                           pool));
+  SVN_TEST_INT_ASSERT(count, 2);
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+  SVN_ERR(svn_test__get_file_contents(root, "big", &contents_read, pool));
+  SVN_TEST_STRING_ASSERT(contents_read->data, contents3->data);
+  SVN_ERR(svn_test__get_file_contents(root, "big2", &contents_read, pool));
+  SVN_TEST_STRING_ASSERT(contents_read->data, contents1->data);
+
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, SVN_INVALID_REVNUM,
+                        NULL, NULL, NULL, NULL, pool));
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef SHARD_SIZE
+
+/* ------------------------------------------------------------------------ */
+#define REPO_NAME "test-repo-batch-fsync-shards"
+#define SHARD_SIZE 4
+#define MAX_REV 7
+
+/* Assert that the node at REPO_NAME/SUBDIR/NAME is of KIND.
+   Use POOL for temporary allocations. */
+static svn_error_t *
+check_repo_node(const char *subdir,
+                const char *name,
+                svn_node_kind_t kind,
+                apr_pool_t *pool)
+{
+  svn_node_kind_t actual_kind;
+  const char *path = svn_dirent_join_many(pool, REPO_NAME, subdir, name,
+                                          SVN_VA_NULL);
+
+  SVN_ERR(svn_io_check_path(path, &actual_kind, pool));
+  if (actual_kind != kind)
+    return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                             "Expected '%s' to be a %s, found a %s", path,
+                             svn_node_kind_to_word(kind),
+                             svn_node_kind_to_word(actual_kind));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+batch_fsync_across_shards(const svn_test_opts_t *opts,
+                          apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  svn_string_t *prop_value;
+  svn_stringbuf_t *contents;
+  apr_pool_t *iterpool;
+
+  if (opts->server_minor_version && (opts->server_minor_version < 8))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.8 SVN doesn't support packed revprops");
+
+  /* Start with two packed shards, i.e. the next commit opens a new one. */
+  SVN_ERR(create_packed_filesystem(REPO_NAME, opts, MAX_REV, SHARD_SIZE,
+                                   pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  ffd = fs->fsap_data;
+  SVN_TEST_ASSERT(ffd->flush_to_disk);
+
+  /* Fill the new shard.  Its first commit creates the shard directories
+     and every commit puts the rev file, its revprops and the directory
+     entries into one fsync batch. */
+  iterpool = svn_pool_create(pool);
+  for (rev = MAX_REV; rev < MAX_REV + SHARD_SIZE; )
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, iterpool));
+      SVN_ERR(svn_fs_txn_root(&root, txn, iterpool));
+      SVN_ERR(svn_test__set_file_contents(root, "iota",
+                                          get_rev_contents(rev + 1,
+                                                           iterpool),
+                                          iterpool));
+      SVN_ERR(svn_fs_change_txn_prop(txn, SVN_PROP_REVISION_LOG,
+                                     default_log(rev + 1, iterpool),
+                                     iterpool));
+      SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, iterpool));
+      SVN_TEST_ASSERT(SVN_IS_VALID_REVNUM(rev));
+
+      SVN_ERR(check_repo_node("revs", apr_psprintf(iterpool, "%d/%ld",
+                                                   2, rev),
+                              svn_node_file, iterpool));
+      SVN_ERR(check_repo_node("revprops", apr_psprintf(iterpool, "%d/%ld",
+                                                       2, rev),
+                              svn_node_file, iterpool));
+    }
+  svn_pool_destroy(iterpool);
+
+  /* Pack the new shard, which flushes the rev and revprop pack files in
+     batches as well. */
+  SVN_ERR(svn_fs_pack(REPO_NAME, NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(check_repo_node("revs", "2.pack", svn_node_dir, pool));
+  SVN_ERR(check_repo_node("revs", "2", svn_node_none, pool));
+  SVN_ERR(check_repo_node("revprops", "2.pack", svn_node_dir, pool));
+  SVN_ERR(check_repo_node("revprops", "2", svn_node_none, pool));
+
+  /* Change a packed revprop with flushing enabled. */
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  SVN_ERR(svn_fs_change_rev_prop2(fs, MAX_REV + 2, SVN_PROP_REVISION_AUTHOR,
+                                  NULL,
+                                  svn_string_create("tweaked-author", pool),
+                                  pool));
+
+  /* Everything must be readable from a fresh FS instance. */
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  SVN_ERR(svn_fs_youngest_rev(&rev, fs, pool));
+  SVN_TEST_ASSERT(rev == MAX_REV + SHARD_SIZE);
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+  SVN_ERR(svn_test__get_file_contents(root, "iota", &contents, pool));
+  SVN_TEST_STRING_ASSERT(contents->data, get_rev_contents(rev, pool));
+
+  for (rev = MAX_REV + 1; rev <= MAX_REV + SHARD_SIZE; ++rev)
+    {
+      SVN_ERR(svn_fs_revision_prop(&prop_value, fs, rev,
+                                   SVN_PROP_REVISION_LOG, pool));
+      SVN_TEST_STRING_ASSERT(prop_value->data,
+                             default_log(rev, pool)->data);
+    }
+
+  SVN_ERR(svn_fs_revision_prop(&prop_value, fs, MAX_REV + 2,
+                               SVN_PROP_REVISION_AUTHOR, pool));
+  SVN_TEST_STRING_ASSERT(prop_value->data, "tweaked-author");
+
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, SVN_INVALID_REVNUM,
+                        NULL, NULL, NULL, NULL, pool));
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef SHARD_SIZE
+#undef MAX_REV
 
 
 /* The test table.  */
@@ -1942,6 +2499,16 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "pack with limited memory for metadata"),
     SVN_TEST_OPTS_PASS(large_delta_against_plain,
                        "large deltas against PLAIN, issue #4658"),
+    SVN_TEST_OPTS_PASS(lz4_compressed_deltas,
+                       "read and write LZ4 compressed deltas"),
+    SVN_TEST_OPTS_PASS(sliding_delta_windows,
+                       "read svndiff3 deltas with sliding source views"),
+    SVN_TEST_OPTS_PASS(large_file_storage,
+                       "store large files outside the rev files"),
+    SVN_TEST_OPTS_PASS(large_rep_superseded,
+                       "drop superseded large file contents"),
+    SVN_TEST_OPTS_PASS(batch_fsync_across_shards,
+                       "batch fsync when committing across shards"),
     SVN_TEST_NULL
   };
 
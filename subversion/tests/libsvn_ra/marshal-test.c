@@ -0,0 +1,1018 @@
+/*
+ * marshal-test.c :  tests and throughput benchmark for the ra_svn
+ *                   protocol parser
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <apr_network_io.h>
+#include <apr_thread_proc.h>
+#include <apr_time.h>
+
+#include "svn_delta.h"
+#include "svn_dirent_uri.h"
+#include "svn_error.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+#include "svn_ra_svn.h"
+#include "svn_sorts.h"
+#include "svn_string.h"
+
+#include "private/svn_ra_svn_private.h"
+#include "private/svn_string_private.h"
+
+#include "../svn_test.h"
+
+
+/*** Helper routines. ***/
+
+/* Return a connection in *CONN that reads from IN and writes to OUT.
+ * Allocate it in POOL. */
+static void
+make_conn(svn_ra_svn_conn_t **conn,
+          const svn_string_t *in,
+          svn_stringbuf_t *out,
+          apr_pool_t *pool)
+{
+  *conn = svn_ra_svn_create_conn5(NULL,
+                                  svn_stream_from_string(in, pool),
+                                  svn_stream_from_stringbuf(out, pool),
+                                  SVN_DELTA_COMPRESSION_LEVEL_DEFAULT,
+                                  0, 0, 0, 0, pool);
+}
+
+/* Return the path used for the I-th editor command. */
+static const char *
+make_path(int i,
+          apr_pool_t *pool)
+{
+  return apr_psprintf(pool, "trunk/subversion/libsvn_ra_svn/file-%d.c", i);
+}
+
+/* Serialize COUNT editor-like commands and return them in *DATA.  Every
+ * 100th command gets a string parameter of LARGE_SIZE bytes.  Allocate
+ * the result in POOL. */
+static svn_error_t *
+write_commands(svn_string_t **data,
+               int count,
+               apr_size_t large_size,
+               apr_pool_t *pool)
+{
+  svn_stringbuf_t *out = svn_stringbuf_create_empty(pool);
+  svn_ra_svn_conn_t *conn;
+  svn_stringbuf_t *buffer = svn_stringbuf_create_ensure(large_size, pool);
+  svn_string_t *large;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  memset(buffer->data, 'x', large_size);
+  buffer->data[large_size] = '\0';
+  buffer->len = large_size;
+  large = svn_stringbuf__morph_into_string(buffer);
+  make_conn(&conn, svn_string_create_empty(pool), out, pool);
+
+  for (i = 0; i < count; ++i)
+    {
+      svn_pool_clear(iterpool);
+      if (i % 100 == 99)
+        SVN_ERR(svn_ra_svn__write_tuple(conn, iterpool, "w(cs)",
+                                        "textdelta-chunk", "c1", large));
+      else
+        SVN_ERR(svn_ra_svn__write_tuple(conn, iterpool, "w(ccc(?r))",
+                                        "open-file", make_path(i, iterpool),
+                                        "d1", "c2", (svn_revnum_t)i));
+    }
+
+  SVN_ERR(svn_ra_svn__flush(conn, pool));
+  svn_pool_destroy(iterpool);
+
+  *data = svn_stringbuf__morph_into_string(out);
+  return SVN_NO_ERROR;
+}
+
+/* Return the size of the I-th chunk sent by write_chunks.  Every fourth
+ * chunk is small enough to be buffered. */
+static apr_size_t
+chunk_size(int i,
+           apr_size_t large_size)
+{
+  return i % 4 ? large_size : 100;
+}
+
+#if APR_HAS_THREADS
+/* Parameters and result of write_chunks_thread. */
+typedef struct write_chunks_baton_t
+{
+  apr_socket_t *sock;
+  int count;
+  apr_size_t large_size;
+  svn_error_t *err;
+} write_chunks_baton_t;
+
+/* Send BATON->COUNT textdelta-chunk commands over BATON->SOCK.  The I-th
+ * chunk has chunk_size(I) bytes, all set to 'a' + I % 26.  Use POOL for
+ * all allocations. */
+static svn_error_t *
+write_chunks(write_chunks_baton_t *baton,
+             apr_pool_t *pool)
+{
+  svn_ra_svn_conn_t *conn;
+  svn_stringbuf_t *buffer = svn_stringbuf_create_ensure(baton->large_size,
+                                                        pool);
+  const svn_string_t *token = svn_string_create("c1", pool);
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  conn = svn_ra_svn_create_conn5(baton->sock, NULL, NULL,
+                                 SVN_DELTA_COMPRESSION_LEVEL_NONE,
+                                 0, 0, 0, 0, pool);
+
+  for (i = 0; i < baton->count; ++i)
+    {
+      svn_string_t chunk;
+
+      svn_pool_clear(iterpool);
+      chunk.len = chunk_size(i, baton->large_size);
+      chunk.data = buffer->data;
+      memset(buffer->data, 'a' + i % 26, chunk.len);
+
+      SVN_ERR(svn_ra_svn__write_cmd_textdelta_chunk(conn, iterpool, token,
+                                                    &chunk));
+    }
+
+  SVN_ERR(svn_ra_svn__flush(conn, pool));
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Thread function calling write_chunks for the write_chunks_baton_t given
+ * by DATA. */
+static void * APR_THREAD_FUNC
+write_chunks_thread(apr_thread_t *tid,
+                    void *data)
+{
+  write_chunks_baton_t *baton = data;
+  apr_pool_t *pool = svn_pool_create(NULL);
+
+  baton->err = write_chunks(baton, pool);
+  apr_socket_close(baton->sock);
+  svn_pool_destroy(pool);
+
+  apr_thread_exit(tid, APR_SUCCESS);
+  return NULL;
+}
+#endif
+
+/* Connect *CLIENT and *SERVER over the loopback interface.  Allocate them
+ * in POOL. */
+static apr_status_t
+connect_loopback(apr_socket_t **client,
+                 apr_socket_t **server,
+                 apr_pool_t *pool)
+{
+  apr_sockaddr_t *sa;
+  apr_socket_t *listener;
+  apr_status_t status;
+
+  status = apr_sockaddr_info_get(&sa, "127.0.0.1", APR_INET, 0, 0, pool);
+  if (!status)
+    status = apr_socket_create(&listener, sa->family, SOCK_STREAM,
+                               APR_PROTO_TCP, pool);
+  if (status)
+    return status;
+
+  status = apr_socket_bind(listener, sa);
+  if (!status)
+    status = apr_socket_listen(listener, 1);
+  if (!status)
+    status = apr_socket_addr_get(&sa, APR_LOCAL, listener);
+  if (!status)
+    status = apr_socket_create(client, sa->family, SOCK_STREAM,
+                               APR_PROTO_TCP, pool);
+  if (!status)
+    status = apr_socket_connect(*client, sa);
+  if (!status)
+    status = apr_socket_accept(server, listener, pool);
+
+  /* We don't accept any further connections. */
+  apr_socket_close(listener);
+
+  return status;
+}
+
+/* Create a file of SIZE bytes in a sandbox directory named after TEST_NAME
+ * and open it for reading in *FILE.  Return its contents in *CONTENTS.
+ * Allocate everything in POOL. */
+static svn_error_t *
+create_span_file(apr_file_t **file,
+                 svn_stringbuf_t **contents,
+                 const char *test_name,
+                 apr_size_t size,
+                 apr_pool_t *pool)
+{
+  const char *dir, *path;
+  apr_size_t i;
+
+  *contents = svn_stringbuf_create_ensure(size, pool);
+  for (i = 0; i < size; ++i)
+    svn_stringbuf_appendbyte(*contents, (char)(i * 7 + i / 251));
+
+  SVN_ERR(svn_test_make_sandbox_dir(&dir, test_name, pool));
+  path = svn_dirent_join(dir, "span", pool);
+  SVN_ERR(svn_io_file_create_bytes(path, (*contents)->data, size, pool));
+
+  return svn_error_trace(svn_io_file_open(file, path, APR_READ,
+                                          APR_OS_DEFAULT, pool));
+}
+
+/* Read a sequence of strings terminated by an empty string from CONN and
+ * return their concatenation in *DATA.  Allocate it in POOL. */
+static svn_error_t *
+read_file_span(svn_stringbuf_t **data,
+               svn_ra_svn_conn_t *conn,
+               apr_pool_t *pool)
+{
+  svn_ra_svn__item_t *item;
+
+  *data = svn_stringbuf_create_empty(pool);
+  while (1)
+    {
+      SVN_ERR(svn_ra_svn__read_item(conn, pool, &item));
+      SVN_TEST_ASSERT(item->kind == SVN_RA_SVN_STRING);
+      if (item->u.string.len == 0)
+        break;
+
+      svn_stringbuf_appendbytes(*data, item->u.string.data,
+                                item->u.string.len);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+#if APR_HAS_THREADS
+/* Parameters and result of write_file_span_thread. */
+typedef struct write_file_span_baton_t
+{
+  apr_socket_t *sock;
+  apr_file_t *file;
+  apr_off_t offset;
+  svn_filesize_t length;
+  svn_error_t *err;
+} write_file_span_baton_t;
+
+/* Thread function sending the file span given by the
+ * write_file_span_baton_t DATA as a terminated sequence of strings. */
+static void * APR_THREAD_FUNC
+write_file_span_thread(apr_thread_t *tid,
+                       void *data)
+{
+  write_file_span_baton_t *baton = data;
+  apr_pool_t *pool = svn_pool_create(NULL);
+  svn_ra_svn_conn_t *conn;
+
+  conn = svn_ra_svn_create_conn5(baton->sock, NULL, NULL,
+                                 SVN_DELTA_COMPRESSION_LEVEL_NONE,
+                                 0, 0, 0, 0, pool);
+  baton->err = svn_ra_svn__write_file_span(conn, pool, baton->file,
+                                           baton->offset, baton->length);
+  if (!baton->err)
+    baton->err = svn_ra_svn__write_cstring(conn, pool, "");
+  if (!baton->err)
+    baton->err = svn_ra_svn__flush(conn, pool);
+
+  apr_socket_close(baton->sock);
+  svn_pool_destroy(pool);
+
+  apr_thread_exit(tid, APR_SUCCESS);
+  return NULL;
+}
+#endif
+
+/* Baton of a stream that delivers DATA only up to AVAILABLE bytes. */
+typedef struct trickle_baton_t
+{
+  const char *data;
+  apr_size_t available;
+  apr_size_t pos;
+} trickle_baton_t;
+
+/* Implements svn_read_fn_t for a trickle_baton_t BATON. */
+static svn_error_t *
+trickle_read(void *baton,
+             char *buffer,
+             apr_size_t *len)
+{
+  trickle_baton_t *b = baton;
+
+  *len = MIN(*len, b->available - b->pos);
+  memcpy(buffer, b->data + b->pos, *len);
+  b->pos += *len;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_stream_data_available_fn_t for a trickle_baton_t BATON.
+ * Like a closed socket, report data being available at the end of
+ * DATA. */
+static svn_error_t *
+trickle_data_available(void *baton,
+                       svn_boolean_t *data_available)
+{
+  trickle_baton_t *b = baton;
+
+  *data_available = b->pos < b->available || b->available == strlen(b->data);
+  return SVN_NO_ERROR;
+}
+
+
+/*** Tests. ***/
+
+static svn_error_t *
+test_read_commands(apr_pool_t *pool)
+{
+  svn_string_t *data;
+  svn_ra_svn_conn_t *conn;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  const apr_size_t large_size = 3 * 16384 + 7;
+  int i;
+
+  /* Enough commands to span many read buffers, with some strings that
+   * don't fit into a single buffer. */
+  SVN_ERR(write_commands(&data, 2000, large_size, pool));
+  make_conn(&conn, data, svn_stringbuf_create_empty(pool), pool);
+
+  for (i = 0; i < 2000; ++i)
+    {
+      const char *cmd;
+      svn_ra_svn__list_t *params;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_ra_svn__read_tuple(conn, iterpool, "wl", &cmd, &params));
+
+      if (i % 100 == 99)
+        {
+          const char *token;
+          svn_string_t *chunk;
+
+          SVN_TEST_STRING_ASSERT(cmd, "textdelta-chunk");
+          SVN_ERR(svn_ra_svn__parse_tuple(params, "cs", &token, &chunk));
+          SVN_TEST_STRING_ASSERT(token, "c1");
+          SVN_TEST_ASSERT(chunk->len == large_size);
+          SVN_TEST_ASSERT(strlen(chunk->data) == large_size);
+        }
+      else
+        {
+          const char *path, *parent_token, *token;
+          svn_revnum_t rev;
+
+          SVN_TEST_STRING_ASSERT(cmd, "open-file");
+          SVN_ERR(svn_ra_svn__parse_tuple(params, "ccc(?r)", &path,
+                                          &parent_token, &token, &rev));
+          SVN_TEST_STRING_ASSERT(path, make_path(i, iterpool));
+          SVN_TEST_STRING_ASSERT(parent_token, "d1");
+          SVN_TEST_STRING_ASSERT(token, "c2");
+          SVN_TEST_INT_ASSERT(rev, i);
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_read_items(apr_pool_t *pool)
+{
+  svn_ra_svn_conn_t *conn;
+  svn_ra_svn__item_t *item;
+  svn_ra_svn__list_t *list;
+  int i;
+
+  /* Nested and empty lists, empty strings and a list with more elements
+   * than the parser keeps on its stack. */
+  make_conn(&conn,
+            svn_string_create("( ( ( ) ) 0: 3:a b word 42 ) "
+                              "( 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 ) ",
+                              pool),
+            svn_stringbuf_create_empty(pool), pool);
+
+  SVN_ERR(svn_ra_svn__read_item(conn, pool, &item));
+  SVN_TEST_ASSERT(item->kind == SVN_RA_SVN_LIST);
+  list = &item->u.list;
+  SVN_TEST_INT_ASSERT(list->nelts, 5);
+
+  item = &SVN_RA_SVN__LIST_ITEM(list, 0);
+  SVN_TEST_ASSERT(item->kind == SVN_RA_SVN_LIST);
+  SVN_TEST_INT_ASSERT(item->u.list.nelts, 1);
+  item = &SVN_RA_SVN__LIST_ITEM(&item->u.list, 0);
+  SVN_TEST_ASSERT(item->kind == SVN_RA_SVN_LIST);
+  SVN_TEST_INT_ASSERT(item->u.list.nelts, 0);
+
+  item = &SVN_RA_SVN__LIST_ITEM(list, 1);
+  SVN_TEST_ASSERT(item->kind == SVN_RA_SVN_STRING);
+  SVN_TEST_STRING_ASSERT(item->u.string.data, "");
+
+  item = &SVN_RA_SVN__LIST_ITEM(list, 2);
+  SVN_TEST_ASSERT(item->kind == SVN_RA_SVN_STRING);
+  SVN_TEST_STRING_ASSERT(item->u.string.data, "a b");
+
+  item = &SVN_RA_SVN__LIST_ITEM(list, 3);
+  SVN_TEST_ASSERT(item->kind == SVN_RA_SVN_WORD);
+  SVN_TEST_STRING_ASSERT(item->u.word.data, "word");
+
+  item = &SVN_RA_SVN__LIST_ITEM(list, 4);
+  SVN_TEST_ASSERT(item->kind == SVN_RA_SVN_NUMBER);
+  SVN_TEST_ASSERT(item->u.number == 42);
+
+  SVN_ERR(svn_ra_svn__read_item(conn, pool, &item));
+  SVN_TEST_ASSERT(item->kind == SVN_RA_SVN_LIST);
+  SVN_TEST_INT_ASSERT(item->u.list.nelts, 16);
+  for (i = 0; i < 16; ++i)
+    SVN_TEST_ASSERT(SVN_RA_SVN__LIST_ITEM(&item->u.list, i).u.number
+                    == (apr_uint64_t)i + 1);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_read_malformed(apr_pool_t *pool)
+{
+  const char *malformed[] =
+    {
+      "( foo$ ) ",
+      "( 123456789012345678901234567890 ) ",
+      "( abcdefghijklmnopqrstuvwxyz0123 ) ",
+      "( 3:abcd ) ",
+      "( ( ) )( ) ",
+    };
+  svn_ra_svn_conn_t *conn;
+  svn_ra_svn__item_t *item;
+  apr_size_t i;
+
+  for (i = 0; i < sizeof(malformed) / sizeof(malformed[0]); ++i)
+    {
+      make_conn(&conn, svn_string_create(malformed[i], pool),
+                svn_stringbuf_create_empty(pool), pool);
+      SVN_TEST_ASSERT_ERROR(svn_ra_svn__read_item(conn, pool, &item),
+                            SVN_ERR_RA_SVN_MALFORMED_DATA);
+    }
+
+  /* Truncated data. */
+  make_conn(&conn, svn_string_create("( 5:ab", pool),
+            svn_stringbuf_create_empty(pool), pool);
+  SVN_TEST_ASSERT_ERROR(svn_ra_svn__read_item(conn, pool, &item),
+                        SVN_ERR_RA_SVN_CONNECTION_CLOSED);
+
+  return SVN_NO_ERROR;
+}
+
+/* Return TRUE if the peeked command word WORD equals EXPECTED. */
+static svn_boolean_t
+peeked(const svn_string_t *word,
+       const char *expected)
+{
+  return word->data
+      && word->len == strlen(expected)
+      && memcmp(word->data, expected, word->len) == 0;
+}
+
+static svn_error_t *
+test_read_command_tuples(apr_pool_t *pool)
+{
+  svn_string_t *data;
+  svn_ra_svn_conn_t *conn;
+  svn_string_t next_cmd;
+  const char *path, *parent_token, *token, *name;
+  svn_string_t *value;
+  svn_revnum_t rev;
+  svn_ra_svn__list_t *list;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  const apr_size_t large_size = 3 * 16384 + 7;
+  int i;
+
+  /* Optional and missing elements, extra elements and a mismatch. */
+  make_conn(&conn,
+            svn_string_create("( open-file ( 3:a/b 2:d1 2:c2 ( 5 ) ) ) "
+                              "( close-file ( 2:c2 ( ) ) ) "
+                              "( change-file-prop ( 2:c2 4:name ( 1:v ) "
+                              "x ( 1 ) ) y ) "
+                              "( open-file ( 3:a/c 2:d1 ( ( 2 ) ) ) ) "
+                              "( close-file ( 42 ) ) "
+                              "( open-file 3:a/d ) "
+                              "3:foo ",
+                              pool),
+            svn_stringbuf_create_empty(pool), pool);
+
+  SVN_ERR(svn_ra_svn__peek_command(&next_cmd, conn, pool));
+  SVN_TEST_ASSERT(peeked(&next_cmd, "open-file"));
+  SVN_ERR(svn_ra_svn__read_command_tuple(conn, pool, "ccc(?r)", &path,
+                                         &parent_token, &token, &rev));
+  SVN_TEST_STRING_ASSERT(path, "a/b");
+  SVN_TEST_STRING_ASSERT(parent_token, "d1");
+  SVN_TEST_STRING_ASSERT(token, "c2");
+  SVN_TEST_INT_ASSERT(rev, 5);
+
+  SVN_ERR(svn_ra_svn__peek_command(&next_cmd, conn, pool));
+  SVN_TEST_ASSERT(peeked(&next_cmd, "close-file"));
+  SVN_ERR(svn_ra_svn__read_command_tuple(conn, pool, "c(?c)", &token,
+                                         &name));
+  SVN_TEST_STRING_ASSERT(token, "c2");
+  SVN_TEST_ASSERT(name == NULL);
+
+  SVN_ERR(svn_ra_svn__peek_command(&next_cmd, conn, pool));
+  SVN_TEST_ASSERT(peeked(&next_cmd, "change-file-prop"));
+  SVN_ERR(svn_ra_svn__read_command_tuple(conn, pool, "cc(?s)", &token,
+                                         &name, &value));
+  SVN_TEST_STRING_ASSERT(token, "c2");
+  SVN_TEST_STRING_ASSERT(name, "name");
+  SVN_TEST_STRING_ASSERT(value->data, "v");
+
+  /* Lists that are not sub-tuples. */
+  SVN_ERR(svn_ra_svn__read_command_tuple(conn, pool, "ccl", &path,
+                                         &parent_token, &list));
+  SVN_TEST_STRING_ASSERT(path, "a/c");
+  SVN_TEST_INT_ASSERT(list->nelts, 1);
+  list = &SVN_RA_SVN__LIST_ITEM(list, 0).u.list;
+  SVN_TEST_INT_ASSERT(list->nelts, 1);
+  SVN_TEST_ASSERT(SVN_RA_SVN__LIST_ITEM(list, 0).u.number == 2);
+
+  /* Type mismatches and missing parameter lists. */
+  SVN_TEST_ASSERT_ERROR(svn_ra_svn__read_command_tuple(conn, pool, "c",
+                                                       &token),
+                        SVN_ERR_RA_SVN_MALFORMED_DATA);
+  SVN_ERR(svn_ra_svn__peek_command(&next_cmd, conn, pool));
+  SVN_TEST_ASSERT(peeked(&next_cmd, "open-file"));
+  SVN_TEST_ASSERT_ERROR(svn_ra_svn__read_command_tuple(conn, pool, "c",
+                                                       &path),
+                        SVN_ERR_RA_SVN_MALFORMED_DATA);
+
+  SVN_ERR(svn_ra_svn__peek_command(&next_cmd, conn, pool));
+  SVN_TEST_ASSERT(next_cmd.data == NULL);
+
+  /* Commands spanning several buffers and strings that don't fit into
+   * a single buffer. */
+  SVN_ERR(write_commands(&data, 300, large_size, pool));
+  make_conn(&conn, data, svn_stringbuf_create_empty(pool), pool);
+
+  for (i = 0; i < 300; ++i)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_ra_svn__peek_command(&next_cmd, conn, iterpool));
+
+      if (i % 100 == 99)
+        {
+          SVN_TEST_ASSERT(next_cmd.data == NULL
+                          || peeked(&next_cmd, "textdelta-chunk"));
+          SVN_ERR(svn_ra_svn__read_command_tuple(conn, iterpool, "cs",
+                                                 &token, &value));
+          SVN_TEST_STRING_ASSERT(token, "c1");
+          SVN_TEST_ASSERT(value->len == large_size);
+          SVN_TEST_ASSERT(strlen(value->data) == large_size);
+        }
+      else
+        {
+          SVN_TEST_ASSERT(next_cmd.data == NULL
+                          || peeked(&next_cmd, "open-file"));
+          SVN_ERR(svn_ra_svn__read_command_tuple(conn, iterpool, "ccc(?r)",
+                                                 &path, &parent_token,
+                                                 &token, &rev));
+          SVN_TEST_STRING_ASSERT(path, make_path(i, iterpool));
+          SVN_TEST_STRING_ASSERT(parent_token, "d1");
+          SVN_TEST_STRING_ASSERT(token, "c2");
+          SVN_TEST_INT_ASSERT(rev, i);
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_has_command(apr_pool_t *pool)
+{
+  static const char data[]
+    = "( get-latest-rev ( ) ) ( stat ( 3:foo ( ) ) ) ";
+  const apr_size_t first = strlen("( get-latest-rev ( ) ) ");
+  trickle_baton_t baton = { data, 0, 0 };
+  svn_stream_t *in = svn_stream_create(&baton, pool);
+  svn_ra_svn_conn_t *conn;
+  svn_boolean_t has_command, terminated;
+  const char *cmd;
+  svn_ra_svn__list_t *params;
+
+  svn_stream_set_read2(in, trickle_read, NULL);
+  svn_stream_set_data_available(in, trickle_data_available);
+  conn = svn_ra_svn_create_conn5(NULL, in,
+                                 svn_stream_empty(pool),
+                                 SVN_DELTA_COMPRESSION_LEVEL_DEFAULT,
+                                 0, 0, 0, 0, pool);
+
+  /* Nothing received, yet. */
+  SVN_ERR(svn_ra_svn__has_command(&has_command, &terminated, conn, pool));
+  SVN_TEST_ASSERT(!has_command && !terminated);
+
+  /* A partial command is not enough. */
+  baton.available = 10;
+  SVN_ERR(svn_ra_svn__has_command(&has_command, &terminated, conn, pool));
+  SVN_TEST_ASSERT(!has_command && !terminated);
+
+  /* The rest arrives later. */
+  baton.available = first;
+  SVN_ERR(svn_ra_svn__has_command(&has_command, &terminated, conn, pool));
+  SVN_TEST_ASSERT(has_command && !terminated);
+  SVN_ERR(svn_ra_svn__read_tuple(conn, pool, "wl", &cmd, &params));
+  SVN_TEST_STRING_ASSERT(cmd, "get-latest-rev");
+
+  /* Stop in the middle of a string. */
+  baton.available = first + strlen("( stat ( 3:f");
+  SVN_ERR(svn_ra_svn__has_command(&has_command, &terminated, conn, pool));
+  SVN_TEST_ASSERT(!has_command && !terminated);
+
+  baton.available = strlen(data);
+  SVN_ERR(svn_ra_svn__has_command(&has_command, &terminated, conn, pool));
+  SVN_TEST_ASSERT(has_command && !terminated);
+  SVN_ERR(svn_ra_svn__read_tuple(conn, pool, "wl", &cmd, &params));
+  SVN_TEST_STRING_ASSERT(cmd, "stat");
+
+  /* Only whitespace left and the connection is closed. */
+  SVN_ERR(svn_ra_svn__has_command(&has_command, &terminated, conn, pool));
+  SVN_TEST_ASSERT(terminated);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_idle_buffers(apr_pool_t *pool)
+{
+  static const char command[] = "( stat ( 3:foo ( ) ) ) ";
+  static const char last[] = "( get-latest-rev ( ) ) ";
+  const int count = 20000;
+  svn_stringbuf_t *data = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *out = svn_stringbuf_create_empty(pool);
+  trickle_baton_t baton = { NULL, 0, 0 };
+  svn_stream_t *in = svn_stream_create(&baton, pool);
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_ra_svn_conn_t *conn;
+  svn_boolean_t has_command, terminated;
+  const char *cmd;
+  svn_ra_svn__list_t *params;
+  int i;
+
+  for (i = 0; i < count; ++i)
+    svn_stringbuf_appendcstr(data, command);
+  svn_stringbuf_appendcstr(data, last);
+
+  /* Everything but the end of the last command has arrived. */
+  baton.data = data->data;
+  baton.available = data->len - 5;
+  svn_stream_set_read2(in, trickle_read, NULL);
+  svn_stream_set_data_available(in, trickle_data_available);
+  conn = svn_ra_svn_create_conn5(NULL, in,
+                                 svn_stream_from_stringbuf(out, pool),
+                                 SVN_DELTA_COMPRESSION_LEVEL_DEFAULT,
+                                 0, 0, 0, 0, pool);
+
+  /* Bulk traffic in both directions makes the buffers grow. */
+  for (i = 0; i < count; ++i)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_ra_svn__read_tuple(conn, iterpool, "wl", &cmd, &params));
+      SVN_TEST_STRING_ASSERT(cmd, "stat");
+    }
+
+  for (i = 0; i < count; ++i)
+    SVN_ERR(svn_ra_svn__write_word(conn, iterpool, "success"));
+  SVN_ERR(svn_ra_svn__flush(conn, iterpool));
+  SVN_TEST_INT_ASSERT(out->len, count * strlen("success "));
+
+  /* The connection goes idle with a partial command in its buffer. */
+  SVN_ERR(svn_ra_svn__has_command(&has_command, &terminated, conn, pool));
+  SVN_TEST_ASSERT(!has_command && !terminated);
+
+  /* Buffered data must survive shrinking the buffers. */
+  baton.available = data->len;
+  SVN_ERR(svn_ra_svn__has_command(&has_command, &terminated, conn, pool));
+  SVN_TEST_ASSERT(has_command && !terminated);
+  SVN_ERR(svn_ra_svn__read_tuple(conn, pool, "wl", &cmd, &params));
+  SVN_TEST_STRING_ASSERT(cmd, "get-latest-rev");
+
+  SVN_ERR(svn_ra_svn__write_word(conn, pool, "done"));
+  SVN_ERR(svn_ra_svn__flush(conn, pool));
+  SVN_TEST_INT_ASSERT(out->len, count * strlen("success ") + strlen("done "));
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_parse_throughput(const svn_test_opts_t *opts,
+                      apr_pool_t *pool)
+{
+  enum { COMMAND_COUNT = 200000 };
+  svn_string_t *data;
+  svn_ra_svn_conn_t *conn;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  apr_time_t start;
+  double seconds;
+  int i;
+
+  SVN_ERR(write_commands(&data, COMMAND_COUNT, 1000, pool));
+  make_conn(&conn, data, svn_stringbuf_create_empty(pool), pool);
+
+  start = apr_time_now();
+  for (i = 0; i < COMMAND_COUNT; ++i)
+    {
+      const char *cmd;
+      svn_ra_svn__list_t *params;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_ra_svn__read_tuple(conn, iterpool, "wl", &cmd, &params));
+    }
+  seconds = (apr_time_now() - start) / (double)APR_USEC_PER_SEC;
+
+  if (opts->verbose)
+    printf("parsed %d commands, %.1f MB in %.3f s: %.1f MB/s\n",
+           COMMAND_COUNT, data->len / (1024.0 * 1024.0), seconds,
+           seconds > 0 ? data->len / (1024.0 * 1024.0) / seconds : 0.0);
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+#if APR_HAS_THREADS
+/* Read COUNT chunks sent by write_chunks from CONN, verify them and add
+ * their sizes to *TOTAL.  LARGE_SIZE is the one given to write_chunks.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+read_chunks(apr_uint64_t *total,
+            svn_ra_svn_conn_t *conn,
+            int count,
+            apr_size_t large_size,
+            apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int i;
+
+  for (i = 0; i < count; ++i)
+    {
+      const char *cmd, *token;
+      svn_string_t *chunk;
+      apr_size_t expected_size = chunk_size(i, large_size);
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_ra_svn__read_tuple(conn, iterpool, "w(cs)", &cmd, &token,
+                                     &chunk));
+      SVN_TEST_STRING_ASSERT(cmd, "textdelta-chunk");
+      SVN_TEST_STRING_ASSERT(token, "c1");
+      SVN_TEST_ASSERT(chunk->len == expected_size);
+      SVN_TEST_ASSERT(chunk->data[0] == 'a' + i % 26);
+      SVN_TEST_ASSERT(chunk->data[expected_size - 1] == 'a' + i % 26);
+
+      *total += chunk->len;
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+/* Discard all data arriving on SOCK until the peer closes it.  This lets
+ * a writer thread run to completion after the reader gave up early. */
+static void
+drain_socket(apr_socket_t *sock)
+{
+  char buffer[16384];
+  apr_size_t len;
+
+  do
+    len = sizeof(buffer);
+  while (apr_socket_recv(sock, buffer, &len) == APR_SUCCESS);
+}
+#endif
+
+static svn_error_t *
+test_write_file_span_buffered(apr_pool_t *pool)
+{
+  enum { FILE_SIZE = 600000, OFFSET = 1000 };
+  apr_file_t *file;
+  svn_stringbuf_t *contents, *out, *data;
+  svn_ra_svn_conn_t *conn;
+
+  SVN_ERR(create_span_file(&file, &contents, "marshal-span-buffered",
+                           FILE_SIZE, pool));
+
+  /* A connection without a socket reads the file into the write buffer.
+   * The span covers several chunks, the last of which is partial. */
+  out = svn_stringbuf_create_empty(pool);
+  make_conn(&conn, svn_string_create_empty(pool), out, pool);
+  SVN_ERR(svn_ra_svn__write_file_span(conn, pool, file, OFFSET,
+                                      FILE_SIZE - 2 * OFFSET));
+  SVN_ERR(svn_ra_svn__write_cstring(conn, pool, ""));
+  SVN_ERR(svn_ra_svn__flush(conn, pool));
+
+  make_conn(&conn, svn_stringbuf__morph_into_string(out),
+            svn_stringbuf_create_empty(pool), pool);
+  SVN_ERR(read_file_span(&data, conn, pool));
+  SVN_TEST_INT_ASSERT(data->len, FILE_SIZE - 2 * OFFSET);
+  SVN_TEST_ASSERT(memcmp(data->data, contents->data + OFFSET, data->len)
+                  == 0);
+
+  /* A span beyond the end of the file gets rejected before anything is
+   * written.  The caller can still terminate the sequence, i.e. there
+   * must not be a dangling length prefix. */
+  out = svn_stringbuf_create_empty(pool);
+  make_conn(&conn, svn_string_create_empty(pool), out, pool);
+  SVN_TEST_ASSERT_ERROR(svn_ra_svn__write_file_span(conn, pool, file,
+                                                    OFFSET, FILE_SIZE),
+                        SVN_ERR_STREAM_UNEXPECTED_EOF);
+  SVN_ERR(svn_ra_svn__write_cstring(conn, pool, ""));
+  SVN_ERR(svn_ra_svn__flush(conn, pool));
+
+  make_conn(&conn, svn_stringbuf__morph_into_string(out),
+            svn_stringbuf_create_empty(pool), pool);
+  SVN_ERR(read_file_span(&data, conn, pool));
+  SVN_TEST_INT_ASSERT(data->len, 0);
+
+  return svn_error_trace(svn_io_file_close(file, pool));
+}
+
+static svn_error_t *
+test_write_file_span_socket(apr_pool_t *pool)
+{
+#if APR_HAS_THREADS
+  enum { FILE_SIZE = 600000, OFFSET = 1000 };
+  write_file_span_baton_t baton = { 0 };
+  apr_file_t *file;
+  svn_stringbuf_t *contents, *data;
+  apr_socket_t *server;
+  apr_thread_t *thread;
+  apr_status_t status, thread_status;
+  svn_ra_svn_conn_t *conn;
+  svn_error_t *err;
+
+  SVN_ERR(create_span_file(&file, &contents, "marshal-span-socket",
+                           FILE_SIZE, pool));
+
+  status = connect_loopback(&baton.sock, &server, pool);
+  if (status)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED,
+                            svn_error_wrap_apr(status, NULL),
+                            "loopback connection not available");
+
+  /* Where available, a socket connection uses sendfile.  Either way, the
+   * peer must see the same strings as with buffered writes. */
+  baton.file = file;
+  baton.offset = OFFSET;
+  baton.length = FILE_SIZE - 2 * OFFSET;
+  status = apr_thread_create(&thread, NULL, write_file_span_thread, &baton,
+                             pool);
+  if (status)
+    {
+      apr_socket_close(baton.sock);
+      apr_socket_close(server);
+      return svn_error_wrap_apr(status, "Can't create writer thread");
+    }
+
+  conn = svn_ra_svn_create_conn5(server, NULL, NULL,
+                                 SVN_DELTA_COMPRESSION_LEVEL_NONE,
+                                 0, 0, 0, 0, pool);
+  err = read_file_span(&data, conn, pool);
+
+  if (err)
+    drain_socket(server);
+  apr_thread_join(&thread_status, thread);
+  apr_socket_close(server);
+
+  SVN_ERR(svn_error_compose_create(err, baton.err));
+  SVN_TEST_INT_ASSERT(data->len, FILE_SIZE - 2 * OFFSET);
+  SVN_TEST_ASSERT(memcmp(data->data, contents->data + OFFSET, data->len)
+                  == 0);
+
+  return svn_error_trace(svn_io_file_close(file, pool));
+#else
+  return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                          "threads not available");
+#endif
+}
+
+static svn_error_t *
+test_loopback_throughput(const svn_test_opts_t *opts,
+                         apr_pool_t *pool)
+{
+#if APR_HAS_THREADS
+  enum { CHUNK_COUNT = 2000 };
+  const apr_size_t large_size = 100 * 1024;
+  write_chunks_baton_t baton = { 0 };
+  apr_socket_t *server;
+  apr_thread_t *thread;
+  apr_status_t status, thread_status;
+  svn_ra_svn_conn_t *conn;
+  apr_uint64_t total = 0;
+  apr_time_t start;
+  double seconds;
+  svn_error_t *err;
+
+  /* This is a benchmark that moves about 150 MB. */
+  if (!opts->verbose)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "benchmark only runs in verbose mode");
+
+  /* Connect two sockets over the loopback interface. */
+  status = connect_loopback(&baton.sock, &server, pool);
+  if (status)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED,
+                            svn_error_wrap_apr(status, NULL),
+                            "loopback connection not available");
+
+  baton.count = CHUNK_COUNT;
+  baton.large_size = large_size;
+
+  start = apr_time_now();
+  status = apr_thread_create(&thread, NULL, write_chunks_thread, &baton,
+                             pool);
+  if (status)
+    {
+      apr_socket_close(baton.sock);
+      apr_socket_close(server);
+      return svn_error_wrap_apr(status, "Can't create writer thread");
+    }
+
+  conn = svn_ra_svn_create_conn5(server, NULL, NULL,
+                                 SVN_DELTA_COMPRESSION_LEVEL_NONE,
+                                 0, 0, 0, 0, pool);
+  err = read_chunks(&total, conn, CHUNK_COUNT, large_size, pool);
+  seconds = (apr_time_now() - start) / (double)APR_USEC_PER_SEC;
+
+  /* Always let the writer finish before we leave.  It closes its socket
+   * when done, even if it failed, so draining will terminate. */
+  if (err)
+    drain_socket(server);
+  apr_thread_join(&thread_status, thread);
+  apr_socket_close(server);
+
+  SVN_ERR(svn_error_compose_create(err, baton.err));
+
+  printf("received %d chunks, %.1f MB in %.3f s: %.1f MB/s\n",
+         CHUNK_COUNT, total / (1024.0 * 1024.0), seconds,
+         seconds > 0 ? total / (1024.0 * 1024.0) / seconds : 0.0);
+
+  return SVN_NO_ERROR;
+#else
+  return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                          "threads not available");
+#endif
+}
+
+
+
+
+/* The test table.  */
+
+static int max_threads = 1;
+
+static struct svn_test_descriptor_t test_funcs[] =
+  {
+    SVN_TEST_NULL,
+    SVN_TEST_PASS2(test_read_commands,
+                   "read commands spanning several buffers"),
+    SVN_TEST_PASS2(test_read_items,
+                   "read all kinds of items"),
+    SVN_TEST_PASS2(test_read_malformed,
+                   "reject malformed items"),
+    SVN_TEST_PASS2(test_read_command_tuples,
+                   "parse commands straight from the read buffer"),
+    SVN_TEST_PASS2(test_has_command,
+                   "detect complete commands only"),
+    SVN_TEST_PASS2(test_idle_buffers,
+                   "shrink I/O buffers of idle connections"),
+    SVN_TEST_PASS2(test_write_file_span_buffered,
+                   "write file spans through the buffer"),
+    SVN_TEST_PASS2(test_write_file_span_socket,
+                   "write file spans to a socket"),
+    SVN_TEST_OPTS_PASS(test_parse_throughput,
+                       "measure the command parser throughput"),
+    SVN_TEST_OPTS_PASS(test_loopback_throughput,
+                       "measure the ra_svn loopback throughput"),
+    SVN_TEST_NULL
+  };
+
+SVN_TEST_MAIN
@@ -34,8 +34,10 @@
 #include "svn_time.h"
 #include "svn_pools.h"
 #include "svn_cmdline.h"
+#include "svn_config.h"
 #include "svn_dirent_uri.h"
 #include "svn_hash.h"
+#include "private/svn_request_sched.h"
 
 #include "../svn_test.h"
 #include "../svn_test_fs.h"
@@ -1682,6 +1684,340 @@ commit_empty_last_change(const svn_test_opts_t *opts,
   return SVN_NO_ERROR;
 }
 
+/* Baton for the fetch_test_* editor functions. */
+typedef struct fetch_test_baton_t
+{
+  /* Maps paths of received files to their contents (svn_stringbuf_t *). */
+  apr_hash_t *contents;
+
+  /* Paths of the directories that have been closed. */
+  apr_hash_t *closed_dirs;
+
+  apr_pool_t *pool;
+} fetch_test_baton_t;
+
+/* Directory and file baton for the fetch_test_* editor functions. */
+typedef struct fetch_test_node_t
+{
+  fetch_test_baton_t *eb;
+  const char *path;
+  const char *parent_path;
+} fetch_test_node_t;
+
+static fetch_test_node_t *
+fetch_test_make_node(fetch_test_baton_t *eb,
+                     const char *path,
+                     fetch_test_node_t *parent)
+{
+  fetch_test_node_t *node = apr_pcalloc(eb->pool, sizeof(*node));
+
+  node->eb = eb;
+  node->path = apr_pstrdup(eb->pool, path);
+  node->parent_path = parent ? parent->path : NULL;
+
+  return node;
+}
+
+static svn_error_t *
+fetch_test_open_root(void *edit_baton,
+                     svn_revnum_t base_revision,
+                     apr_pool_t *dir_pool,
+                     void **root_baton)
+{
+  *root_baton = fetch_test_make_node(edit_baton, "", NULL);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+fetch_test_add_node(const char *path,
+                    void *parent_baton,
+                    const char *copyfrom_path,
+                    svn_revnum_t copyfrom_revision,
+                    apr_pool_t *pool,
+                    void **child_baton)
+{
+  fetch_test_node_t *parent = parent_baton;
+
+  SVN_TEST_ASSERT(!svn_hash_gets(parent->eb->closed_dirs, parent->path));
+  *child_baton = fetch_test_make_node(parent->eb, path, parent);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+fetch_test_apply_textdelta(void *file_baton,
+                           const char *base_checksum,
+                           apr_pool_t *pool,
+                           svn_txdelta_window_handler_t *handler,
+                           void **handler_baton)
+{
+  fetch_test_node_t *node = file_baton;
+  svn_stringbuf_t *contents = svn_stringbuf_create_empty(node->eb->pool);
+
+  svn_hash_sets(node->eb->contents, node->path, contents);
+  svn_txdelta_apply(svn_stream_empty(pool),
+                    svn_stream_from_stringbuf(contents, pool),
+                    NULL, node->path, pool, handler, handler_baton);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+fetch_test_close_file(void *file_baton,
+                      const char *text_checksum,
+                      apr_pool_t *pool)
+{
+  fetch_test_node_t *node = file_baton;
+
+  /* Files must be closed before their parent directory. */
+  SVN_TEST_ASSERT(!svn_hash_gets(node->eb->closed_dirs, node->parent_path));
+  SVN_TEST_ASSERT(svn_hash_gets(node->eb->contents, node->path));
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+fetch_test_close_directory(void *dir_baton,
+                           apr_pool_t *pool)
+{
+  fetch_test_node_t *node = dir_baton;
+
+  if (node->parent_path)
+    SVN_TEST_ASSERT(!svn_hash_gets(node->eb->closed_dirs,
+                                   node->parent_path));
+  svn_hash_sets(node->eb->closed_dirs, node->path, node);
+  return SVN_NO_ERROR;
+}
+
+/* Return the contents of file number I in directory DIR. */
+static const char *
+fetch_test_contents(const char *dir,
+                    int i,
+                    apr_pool_t *pool)
+{
+  return apr_psprintf(pool, "This is file %d in %s.\n", i, dir);
+}
+
+/* Add COUNT files with fetch_test_contents() to directory DIR with
+   DIR_BATON using the commit EDITOR. */
+static svn_error_t *
+fetch_test_add_files(const svn_delta_editor_t *editor,
+                     void *dir_baton,
+                     const char *dir,
+                     int count,
+                     apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  for (i = 0; i < count; ++i)
+    {
+      void *file_baton;
+      svn_txdelta_window_handler_t handler;
+      void *handler_baton;
+      const char *contents;
+
+      svn_pool_clear(iterpool);
+      contents = fetch_test_contents(dir, i, iterpool);
+      SVN_ERR(editor->add_file(apr_psprintf(iterpool, "%s/f%d", dir, i),
+                               dir_baton, NULL, SVN_INVALID_REVNUM,
+                               iterpool, &file_baton));
+      SVN_ERR(editor->apply_textdelta(file_baton, NULL, iterpool,
+                                      &handler, &handler_baton));
+      SVN_ERR(svn_txdelta_send_string(svn_string_create(contents, iterpool),
+                                      handler, handler_baton, iterpool));
+      SVN_ERR(editor->close_file(file_baton, NULL, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+/* Test ra_svn checkouts that fetch the file contents over additional
+   connections. */
+
+static svn_error_t *
+tunnel_fetch_checkout(const svn_test_opts_t *opts,
+                      apr_pool_t *pool)
+{
+  tunnel_baton_t *b = apr_pcalloc(pool, sizeof(*b));
+  apr_pool_t *scratch_pool = svn_pool_create(pool);
+  const char *url;
+  svn_ra_callbacks2_t *cbtable;
+  svn_ra_session_t *session;
+  const char tunnel_repos_name[] = "test-fetch_checkout";
+  const int file_count = 100;
+  apr_hash_t *config = apr_hash_make(pool);
+  svn_config_t *servers;
+  const svn_delta_editor_t *editor;
+  void *edit_baton;
+  void *root_baton, *a_baton, *b_baton, *c_baton;
+  svn_delta_editor_t *fetch_test_editor;
+  fetch_test_baton_t *eb;
+  const svn_ra_reporter3_t *reporter;
+  void *report_baton;
+  int k;
+
+  b->magic = TUNNEL_MAGIC;
+
+  SVN_ERR(svn_test__create_repos(NULL, tunnel_repos_name, opts, scratch_pool));
+
+  /* Immediately close the repository to avoid race condition with svnserve
+  (and then the cleanup code) with BDB when our pool is cleared. */
+  svn_pool_clear(scratch_pool);
+
+  url = apr_pstrcat(pool, "svn+test://localhost/", tunnel_repos_name,
+                    SVN_VA_NULL);
+  SVN_ERR(svn_ra_create_callbacks(&cbtable, pool));
+  cbtable->check_tunnel_func = check_tunnel;
+  cbtable->open_tunnel_func = open_tunnel;
+  cbtable->tunnel_baton = b;
+  SVN_ERR(svn_cmdline_create_auth_baton2(&cbtable->auth_baton,
+                                         TRUE  /* non_interactive */,
+                                         "jrandom", "rayjandom",
+                                         NULL,
+                                         TRUE  /* no_auth_cache */,
+                                         FALSE /* trust_server_cert */,
+                                         FALSE, FALSE, FALSE, FALSE,
+                                         NULL, NULL, NULL, pool));
+
+  SVN_ERR(svn_config_create2(&servers, FALSE, FALSE, pool));
+  svn_config_set(servers, SVN_CONFIG_SECTION_GLOBAL,
+                 SVN_CONFIG_OPTION_SVN_FETCH_CONNECTIONS, "2");
+  svn_hash_sets(config, SVN_CONFIG_CATEGORY_SERVERS, servers);
+
+  SVN_ERR(svn_ra_open4(&session, NULL, url, NULL, cbtable, NULL, config,
+                       pool));
+
+  /* Commit enough files to need several fetch-many requests. */
+  SVN_ERR(svn_ra_get_commit_editor3(session, &editor, &edit_baton,
+                                    apr_hash_make(pool), NULL, NULL, NULL,
+                                    FALSE, pool));
+  SVN_ERR(editor->open_root(edit_baton, SVN_INVALID_REVNUM, pool,
+                            &root_baton));
+  SVN_ERR(editor->add_directory("A", root_baton, NULL, SVN_INVALID_REVNUM,
+                                pool, &a_baton));
+  SVN_ERR(editor->add_directory("A/B", a_baton, NULL, SVN_INVALID_REVNUM,
+                                pool, &b_baton));
+  SVN_ERR(editor->close_directory(b_baton, pool));
+  SVN_ERR(fetch_test_add_files(editor, a_baton, "A", file_count, pool));
+  SVN_ERR(editor->close_directory(a_baton, pool));
+  SVN_ERR(editor->add_directory("C", root_baton, NULL, SVN_INVALID_REVNUM,
+                                pool, &c_baton));
+  SVN_ERR(fetch_test_add_files(editor, c_baton, "C", file_count, pool));
+  SVN_ERR(editor->close_directory(c_baton, pool));
+  SVN_ERR(editor->close_directory(root_baton, pool));
+  SVN_ERR(editor->close_edit(edit_baton, pool));
+
+  /* Check out everything. */
+  eb = apr_pcalloc(pool, sizeof(*eb));
+  eb->contents = apr_hash_make(pool);
+  eb->closed_dirs = apr_hash_make(pool);
+  eb->pool = pool;
+
+  fetch_test_editor = svn_delta_default_editor(pool);
+  fetch_test_editor->open_root = fetch_test_open_root;
+  fetch_test_editor->add_directory = fetch_test_add_node;
+  fetch_test_editor->add_file = fetch_test_add_node;
+  fetch_test_editor->apply_textdelta = fetch_test_apply_textdelta;
+  fetch_test_editor->close_file = fetch_test_close_file;
+  fetch_test_editor->close_directory = fetch_test_close_directory;
+
+  SVN_ERR(svn_ra_do_update3(session, &reporter, &report_baton,
+                            SVN_INVALID_REVNUM, "", svn_depth_infinity,
+                            FALSE, FALSE, fetch_test_editor, eb,
+                            pool, pool));
+  SVN_ERR(reporter->set_path(report_baton, "", 0, svn_depth_infinity, TRUE,
+                             NULL, pool));
+  SVN_ERR(reporter->finish_report(report_baton, pool));
+
+  /* All files must have been received with their full contents and all
+     directories must have been closed. */
+  SVN_TEST_INT_ASSERT(apr_hash_count(eb->contents), 2 * file_count);
+  SVN_TEST_INT_ASSERT(apr_hash_count(eb->closed_dirs), 4);
+  for (k = 0; k < file_count; ++k)
+    {
+      svn_stringbuf_t *contents;
+
+      contents = svn_hash_gets(eb->contents,
+                               apr_psprintf(scratch_pool, "A/f%d", k));
+      SVN_TEST_ASSERT(contents);
+      SVN_TEST_STRING_ASSERT(contents->data,
+                             fetch_test_contents("A", k, scratch_pool));
+
+      contents = svn_hash_gets(eb->contents,
+                               apr_psprintf(scratch_pool, "C/f%d", k));
+      SVN_TEST_ASSERT(contents);
+      SVN_TEST_STRING_ASSERT(contents->data,
+                             fetch_test_contents("C", k, scratch_pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+
+/* Let SCHED see the 16 requests of a measurement window, each of them
+ * completing 20 ms after the previous one with BYTES of data and after
+ * a round trip of 100 ms.  Keep all active connections busy.  Advance
+ * *NOW accordingly.
+ */
+static void
+simulate_sched_window(svn_request_sched__t *sched,
+                      apr_time_t *now,
+                      apr_uint64_t bytes)
+{
+  int i;
+
+  for (i = 0; i < 16; ++i)
+    {
+      *now += APR_USEC_PER_SEC / 50;
+      svn_request_sched__request_done(sched, *now, APR_USEC_PER_SEC / 10,
+                                      bytes, sched->active_conns
+                                             * sched->pipeline_depth);
+    }
+}
+
+static svn_error_t *
+request_sched_adapts(apr_pool_t *pool)
+{
+  svn_request_sched__t sched;
+  apr_time_t now = apr_time_from_sec(1000);
+  int i;
+
+  /* On a high-latency link, every connection adds the same throughput,
+     so the scheduler uses as many as it may. */
+  svn_request_sched__init(&sched, 3, FALSE);
+  SVN_TEST_INT_ASSERT(sched.active_conns, 1);
+  for (i = 0; i < 10; ++i)
+    simulate_sched_window(&sched, &now, 10000 * sched.active_conns);
+
+  SVN_TEST_ASSERT(sched.measured);
+  SVN_TEST_INT_ASSERT(sched.active_conns, 3);
+  SVN_TEST_ASSERT(sched.pipeline_depth
+                  >= SVN_REQUEST_SCHED__MIN_PIPELINE_DEPTH);
+
+  /* On a link with limited bandwidth, connections that don't add to the
+     throughput get retired again. */
+  svn_request_sched__init(&sched, 8, FALSE);
+  for (i = 0; i < 10; ++i)
+    simulate_sched_window(&sched, &now, 10000);
+
+  SVN_TEST_INT_ASSERT(sched.active_conns, 2);
+
+  /* When the link slows down, the scheduler probes again but retires the
+     extra connection once it turns out to be useless. */
+  simulate_sched_window(&sched, &now, 5000);
+  simulate_sched_window(&sched, &now, 5000);
+  SVN_TEST_INT_ASSERT(sched.active_conns, 3);
+  simulate_sched_window(&sched, &now, 5000);
+  SVN_TEST_INT_ASSERT(sched.active_conns, 2);
+
+  /* Multiplexed connections only adapt the number of streams. */
+  svn_request_sched__init(&sched, 8, TRUE);
+  for (i = 0; i < 10; ++i)
+    simulate_sched_window(&sched, &now, 10000 * sched.active_conns);
+
+  SVN_TEST_INT_ASSERT(sched.active_conns, 1);
+
+  return SVN_NO_ERROR;
+}
 
 /* The test table.  */
 
@@ -1716,6 +2052,10 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "verify checkout over a tunnel"),
     SVN_TEST_OPTS_PASS(commit_empty_last_change,
                        "check how last change applies to empty commit"),
+    SVN_TEST_OPTS_PASS(tunnel_fetch_checkout,
+                       "checkout fetching contents over extra connections"),
+    SVN_TEST_PASS2(request_sched_adapts,
+                   "request scheduler adapts connections to the link"),
     SVN_TEST_NULL
   };
 
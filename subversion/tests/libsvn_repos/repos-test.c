@@ -44,6 +44,7 @@
 
 /* be able to look into svn_config_t */
 #include "../../libsvn_subr/config_impl.h"
+#include "../../libsvn_repos/repos.h"
 
 #include "../svn_test_fs.h"
 
@@ -4466,6 +4467,418 @@ test_list(const svn_test_opts_t *opts,
   return SVN_NO_ERROR;
 }
 
+/* Verify that CHUNKS, an array of svn_repos__blame_chunk_t, matches the
+   EXPECTED list of line, revision pairs terminated by -1. */
+static svn_error_t *
+check_blame_chunks(const apr_array_header_t *chunks,
+                   const svn_revnum_t *expected)
+{
+  int i;
+
+  for (i = 0; i < chunks->nelts; ++i, expected += 2)
+    {
+      const svn_repos__blame_chunk_t *chunk
+        = &APR_ARRAY_IDX(chunks, i, svn_repos__blame_chunk_t);
+
+      SVN_TEST_ASSERT(expected[0] != -1);
+      SVN_TEST_ASSERT(chunk->start == expected[0]);
+      SVN_TEST_ASSERT(chunk->revision == expected[1]);
+    }
+
+  SVN_TEST_ASSERT(expected[0] == -1);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_blame(const svn_test_opts_t *opts,
+           apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_revnum_t youngest_rev;
+  apr_array_header_t *chunks;
+  const svn_revnum_t full_results[] = {
+    0, 5,
+    1, 2,
+    2, 3,
+    3, 2,
+    -1
+  };
+  const svn_revnum_t partial_results[] = {
+    0, 5,
+    1, SVN_INVALID_REVNUM,
+    2, 3,
+    3, SVN_INVALID_REVNUM,
+    -1
+  };
+
+  /* Create yet another greek tree repository. */
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-blame", opts, pool));
+  fs = svn_repos_fs(repos);
+
+  /* r1: the greek tree. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+  SVN_TEST_ASSERT(SVN_IS_VALID_REVNUM(youngest_rev));
+
+  /* r2: replace all of iota. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "/iota",
+                                      "line 1\nline 2\nline 3\n", pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  /* r3: modify the middle line. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "/iota",
+                                      "line 1\nline two\nline 3\n", pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  /* r4: property change only, which must not show up in the blame. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_fs_change_node_prop(txn_root, "/iota", "propname",
+                                  svn_string_create("propval", pool), pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  /* r5: prepend a line. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "/iota",
+                                      "line 0\nline 1\nline two\nline 3\n",
+                                      pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+  SVN_TEST_ASSERT(youngest_rev == 5);
+
+  /* Blame the whole history. */
+  SVN_ERR(svn_repos__blame(&chunks, repos, "/iota", 1, youngest_rev, NULL,
+                           0, NULL, NULL, NULL, NULL, pool, pool));
+  SVN_ERR(check_blame_chunks(chunks, full_results));
+
+  /* Lines last changed before the start revision don't get blamed. */
+  SVN_ERR(svn_repos__blame(&chunks, repos, "/iota", 3, youngest_rev, NULL,
+                           0, NULL, NULL, NULL, NULL, pool, pool));
+  SVN_ERR(check_blame_chunks(chunks, partial_results));
+
+  /* Reverse ranges are not supported. */
+  SVN_TEST_ASSERT_ERROR(svn_repos__blame(&chunks, repos, "/iota",
+                                         youngest_rev, 1, NULL,
+                                         0, NULL, NULL, NULL, NULL,
+                                         pool, pool),
+                        SVN_ERR_UNSUPPORTED_FEATURE);
+
+  /* Neither are files larger than the limit ... */
+  SVN_TEST_ASSERT_ERROR(svn_repos__blame(&chunks, repos, "/iota",
+                                         1, youngest_rev, NULL,
+                                         10, NULL, NULL, NULL, NULL,
+                                         pool, pool),
+                        SVN_ERR_UNSUPPORTED_FEATURE);
+
+  /* ... or binary files.  r6: mark iota as binary. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_fs_change_node_prop(txn_root, "/iota", SVN_PROP_MIME_TYPE,
+                                  svn_string_create("application/x-foo",
+                                                    pool),
+                                  pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "/iota", "line 0\n",
+                                      pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  SVN_TEST_ASSERT_ERROR(svn_repos__blame(&chunks, repos, "/iota",
+                                         1, youngest_rev, NULL,
+                                         0, NULL, NULL, NULL, NULL,
+                                         pool, pool),
+                        SVN_ERR_UNSUPPORTED_FEATURE);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_repos_log_entry_receiver_t, appending the revision
+   numbers to the svn_stringbuf_t BATON. */
+static svn_error_t *
+log_index_receiver(void *baton,
+                   svn_repos_log_entry_t *log_entry,
+                   apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *revs = baton;
+
+  svn_stringbuf_appendcstr(revs, apr_psprintf(scratch_pool, " r%ld",
+                                              log_entry->revision));
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_repos_notify_func_t, counting the indexed revisions in
+   the int BATON. */
+static void
+log_index_notify(void *baton,
+                 const svn_repos_notify_t *notify,
+                 apr_pool_t *scratch_pool)
+{
+  if (notify->action == svn_repos_notify_log_index_rev_end)
+    ++*(int *)baton;
+}
+
+/* Return the revisions reported by every combination of log parameters
+   on PATHS in REPOS as a single string allocated in POOL. */
+static svn_error_t *
+log_index_logs(const char **logs,
+               svn_repos_t *repos,
+               const char *const *paths,
+               apr_pool_t *pool)
+{
+  svn_stringbuf_t *revs = svn_stringbuf_create_empty(pool);
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_revnum_t youngest_rev;
+  int i, strict, limit, descending;
+
+  SVN_ERR(svn_fs_youngest_rev(&youngest_rev, svn_repos_fs(repos), pool));
+
+  for (i = 0; paths[i]; ++i)
+    for (strict = 0; strict < 2; ++strict)
+      for (limit = 0; limit < 2; ++limit)
+        for (descending = 0; descending < 2; ++descending)
+          {
+            apr_array_header_t *targets
+              = apr_array_make(iterpool, 1, sizeof(const char *));
+
+            svn_pool_clear(iterpool);
+            APR_ARRAY_PUSH(targets, const char *) = paths[i];
+            svn_stringbuf_appendcstr(revs, "\n");
+            svn_stringbuf_appendcstr(revs, paths[i]);
+
+            SVN_ERR(svn_repos_get_logs5(repos, targets,
+                                        descending ? youngest_rev : 2,
+                                        descending ? 2 : youngest_rev,
+                                        limit, strict, FALSE, NULL,
+                                        NULL, NULL, NULL, NULL,
+                                        log_index_receiver, revs,
+                                        iterpool));
+          }
+
+  svn_pool_destroy(iterpool);
+  *logs = revs->data;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_log_index(const svn_test_opts_t *opts,
+               apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root, *rev_root;
+  svn_revnum_t youngest_rev;
+  const char *expected;
+  const char *actual;
+  int notified = 0;
+  const char *paths[] = {
+    "/A/mu", "/A/B", "/A2/B/E", "/A2/B/E/alpha", "/A2/D/gamma", "/A2",
+    "/iota", NULL
+  };
+
+  /* Create yet another greek tree repository. */
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-log-index", opts, pool));
+  fs = svn_repos_fs(repos);
+
+  /* r1: the greek tree. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  /* r2: tweak A/mu and A/B/E/alpha. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "A/mu", "r2", pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "A/B/E/alpha", "r2", pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  /* r3: copy A to A2. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_fs_revision_root(&rev_root, fs, youngest_rev, pool));
+  SVN_ERR(svn_fs_copy(rev_root, "A", txn_root, "A2", pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  /* r4: tweak A2/B/E/beta and A/B/E/alpha. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "A2/B/E/beta", "r4", pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "A/B/E/alpha", "r4", pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  /* Build the index. */
+  SVN_ERR(svn_repos_build_log_index(repos, log_index_notify, &notified,
+                                    NULL, NULL, pool));
+  SVN_TEST_INT_ASSERT(notified, 5);
+
+  /* r5: tweak iota.  The commit must add it to the index. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "iota", "r5", pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  notified = 0;
+  SVN_ERR(svn_repos_build_log_index(repos, log_index_notify, &notified,
+                                    NULL, NULL, pool));
+  SVN_TEST_INT_ASSERT(notified, 0);
+
+  /* r6: tweak A/mu behind the repos layer's back, leaving the index
+     behind.  r7: tweak A2/D/gamma.  The commit of r7 must catch up with
+     the missing r6. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "A/mu", "r6", pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &youngest_rev, txn, pool));
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "A2/D/gamma", "r7", pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  notified = 0;
+  SVN_ERR(svn_repos_build_log_index(repos, log_index_notify, &notified,
+                                    NULL, NULL, pool));
+  SVN_TEST_INT_ASSERT(notified, 0);
+
+  /* r8 and r9: tweak iota and A/mu.  Simulate concurrent commits that
+     update the index in reverse order. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "iota", "r8", pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &youngest_rev, txn, pool));
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "A/mu", "r9", pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &youngest_rev, txn, pool));
+
+  SVN_ERR(svn_repos__log_index_update(repos, youngest_rev, pool));
+  SVN_ERR(svn_repos__log_index_update(repos, youngest_rev - 1, pool));
+
+  notified = 0;
+  SVN_ERR(svn_repos_build_log_index(repos, log_index_notify, &notified,
+                                    NULL, NULL, pool));
+  SVN_TEST_INT_ASSERT(notified, 0);
+  SVN_ERR(log_index_logs(&actual, repos, paths, pool));
+
+  /* Without the index, the history walk must report the same revisions. */
+  SVN_ERR(svn_io_remove_file2(svn_dirent_join(svn_repos_db_env(repos, pool),
+                                              "log-index.db", pool),
+                              FALSE, pool));
+  SVN_ERR(log_index_logs(&expected, repos, paths, pool));
+
+  SVN_TEST_STRING_ASSERT(actual, expected);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_warm_caches(const svn_test_opts_t *opts,
+                 apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_revnum_t youngest_rev;
+  apr_uint64_t nodes, bytes, total;
+
+  /* Create yet another greek tree repository. */
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-warm-caches", opts,
+                                 pool));
+  fs = svn_repos_fs(repos);
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  /* Without a budget, visit the root and all 20 nodes below it. */
+  SVN_ERR(svn_repos__warm_caches(&nodes, &total, repos, 0, TRUE,
+                                 NULL, NULL, pool));
+  SVN_TEST_ASSERT(nodes == 21);
+  SVN_TEST_ASSERT(total > 0);
+
+  /* A tiny budget gets exhausted by the latest changes already. */
+  SVN_ERR(svn_repos__warm_caches(&nodes, &bytes, repos, 1, TRUE,
+                                 NULL, NULL, pool));
+  SVN_TEST_ASSERT(nodes == 0);
+
+  /* Revprops, changed paths and directory entries all count against the
+     budget.  Falling just short of it, we miss only the last node. */
+  SVN_ERR(svn_repos__warm_caches(&nodes, &total, repos, 0, FALSE,
+                                 NULL, NULL, pool));
+  SVN_TEST_ASSERT(nodes == 21);
+  SVN_ERR(svn_repos__warm_caches(&nodes, &bytes, repos, total - 1, FALSE,
+                                 NULL, NULL, pool));
+  SVN_TEST_ASSERT(nodes > 0 && nodes < 21);
+  SVN_TEST_ASSERT(bytes <= total);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_repos_pool(const svn_test_opts_t *opts,
+                apr_pool_t *pool)
+{
+  svn_repos__repos_pool_t *repos_pool;
+  svn_repos_t *repos, *first, *second;
+  svn_fs_access_t *access;
+  const char *path;
+  apr_pool_t *first_pool = svn_pool_create(pool);
+  apr_pool_t *second_pool = svn_pool_create(pool);
+
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-repos-pool", opts,
+                                 pool));
+  path = svn_repos_path(repos, pool);
+
+  SVN_ERR(svn_repos__repos_pool_create(&repos_pool, FALSE, pool));
+
+  /* Released instances get re-used but don't keep per-session state. */
+  SVN_ERR(svn_repos__repos_pool_get(&first, repos_pool, path, NULL,
+                                    first_pool, pool));
+  SVN_ERR(svn_fs_create_access(&access, "jrandom", first_pool));
+  SVN_ERR(svn_fs_set_access(svn_repos_fs(first), access));
+  svn_pool_clear(first_pool);
+  SVN_ERR(svn_repos__repos_pool_get(&second, repos_pool, path, NULL,
+                                    second_pool, pool));
+  SVN_TEST_ASSERT(first == second);
+  SVN_ERR(svn_fs_get_access(&access, svn_repos_fs(second)));
+  SVN_TEST_ASSERT(access == NULL);
+
+  /* Instances in use are never handed out twice. */
+  SVN_ERR(svn_repos__repos_pool_get(&first, repos_pool, path, NULL,
+                                    first_pool, pool));
+  SVN_TEST_ASSERT(first != second);
+  svn_pool_clear(first_pool);
+  svn_pool_clear(second_pool);
+
+  /* A new filesystem identity makes all instances stale.  BDB keeps its
+     UUID in the database, so we can't detect that change there. */
+  if (strcmp(opts->fs_type, SVN_FS_TYPE_BDB) != 0)
+    {
+      SVN_ERR(svn_fs_set_uuid(svn_repos_fs(repos), NULL, pool));
+      SVN_ERR(svn_repos__repos_pool_get(&repos, repos_pool, path, NULL,
+                                        first_pool, pool));
+      SVN_TEST_ASSERT(repos != first && repos != second);
+    }
+
+  svn_pool_destroy(first_pool);
+  svn_pool_destroy(second_pool);
+
+  return SVN_NO_ERROR;
+}
+
 /* The test table.  */
 
 static int max_threads = 4;
@@ -4537,6 +4950,14 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "optional authz wildcard performance test"),
     SVN_TEST_OPTS_PASS(test_list,
                        "test svn_repos_list"),
+    SVN_TEST_OPTS_PASS(test_blame,
+                       "test svn_repos__blame"),
+    SVN_TEST_OPTS_PASS(test_log_index,
+                       "test svn_repos_build_log_index"),
+    SVN_TEST_OPTS_PASS(test_warm_caches,
+                       "test svn_repos__warm_caches"),
+    SVN_TEST_OPTS_PASS(test_repos_pool,
+                       "test svn_repos__repos_pool_get"),
     SVN_TEST_NULL
   };
 
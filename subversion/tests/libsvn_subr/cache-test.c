@@ -26,14 +26,20 @@
 #include <apr_general.h>
 #include <apr_lib.h>
 #include <apr_time.h>
+#include <apr_thread_proc.h>
 
 #include "svn_pools.h"
+#include "svn_sorts.h"
 
 #include "private/svn_cache.h"
 #include "svn_private_config.h"
 
 #include "../svn_test.h"
 
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>   /* For _exit() */
+#endif
+
 /* Create memcached cache if configured */
 static svn_error_t *
 create_memcache(svn_memcache_t **memcache,
@@ -590,6 +596,349 @@ test_membuffer_unaligned_fixed_keys(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+test_membuffer_cache_shared(apr_pool_t *pool)
+{
+  svn_cache__t *cache;
+  svn_membuffer_t *membuffer;
+  svn_revnum_t fifty = 50;
+  svn_revnum_t *answer;
+  svn_boolean_t found = FALSE;
+  svn_error_t *err;
+
+  err = svn_cache__membuffer_cache_create_shared(&membuffer, 10*1024, 1, 0,
+                                                 TRUE, pool);
+  if (err && err->apr_err == SVN_ERR_UNSUPPORTED_FEATURE)
+    {
+      svn_error_clear(err);
+      return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                              "shared memory not supported");
+    }
+  SVN_ERR(err);
+
+  /* String keys. */
+  SVN_ERR(svn_cache__create_membuffer_cache(&cache,
+                                            membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            APR_HASH_KEY_STRING,
+                                            "cache:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE,
+                                            FALSE,
+                                            pool, pool));
+  SVN_ERR(basic_cache_test(cache, FALSE, pool));
+
+  /* Fixed-length keys, which would normally use the prefix pool. */
+  SVN_ERR(svn_cache__create_membuffer_cache(
+            &cache, membuffer, serialize_revnum, deserialize_revnum,
+            8 /* klen*/,
+            "fixed:",
+            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY, FALSE, FALSE,
+            pool, pool));
+
+  SVN_ERR(svn_cache__set(cache, "12345678", &fifty, pool));
+  SVN_ERR(svn_cache__get((void **) &answer, &found, cache, "12345678",
+                         pool));
+
+  if (! found)
+    return svn_error_create(SVN_ERR_TEST_FAILED, NULL,
+                            "cache failed to find entry for '12345678'");
+  if (*answer != 50)
+    return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                             "expected 50 but found '%ld'", *answer);
+
+#if APR_HAS_FORK && defined(HAVE_UNISTD_H)
+  /* Entries added by a child process must be visible to the parent. */
+  {
+    apr_proc_t proc;
+    int exit_code;
+    apr_exit_why_e exit_why;
+    apr_status_t status = apr_proc_fork(&proc, pool);
+
+    if (status == APR_INCHILD)
+      {
+        svn_revnum_t sixty = 60;
+
+        err = svn_cache__membuffer_cache_child_init(membuffer, pool);
+        if (!err)
+          err = svn_cache__set(cache, "87654321", &sixty, pool);
+
+        /* Don't run the parent's exit handlers. */
+        _exit(err ? 1 : 0);
+      }
+    else if (status != APR_INPARENT)
+      return svn_error_wrap_apr(status, "apr_proc_fork");
+
+    status = apr_proc_wait(&proc, &exit_code, &exit_why, APR_WAIT);
+    if (status != APR_CHILD_DONE)
+      return svn_error_wrap_apr(status, "apr_proc_wait");
+
+    SVN_TEST_ASSERT(APR_PROC_CHECK_EXIT(exit_why));
+    SVN_TEST_INT_ASSERT(exit_code, 0);
+
+    SVN_ERR(svn_cache__get((void **) &answer, &found, cache, "87654321",
+                           pool));
+    SVN_TEST_ASSERT(found);
+    SVN_TEST_INT_ASSERT(*answer, 60);
+  }
+#endif
+
+  /* Clearing must work with the cross-process locks as well. */
+  SVN_ERR(svn_cache__membuffer_clear(membuffer));
+  SVN_ERR(svn_cache__get((void **) &answer, &found, cache, "12345678",
+                         pool));
+  SVN_TEST_ASSERT(!found);
+
+  return SVN_NO_ERROR;
+}
+
+
+#if APR_HAS_THREADS
+
+/* Parameters of the membuffer read contention benchmark. */
+enum
+{
+  CONTENTION_HOT_KEYS = 64,
+  CONTENTION_COLD_KEYS = 4096,
+  CONTENTION_LOOKUPS = 200000,
+  CONTENTION_MAX_READERS = 8
+};
+
+/* Per-thread baton for the contention benchmark. */
+typedef struct contention_baton_t
+{
+  /* The shared cache backend. */
+  svn_membuffer_t *membuffer;
+
+  /* If set, this thread keeps overwriting cold entries instead of
+   * reading hot ones. */
+  svn_boolean_t writer;
+
+  /* Set by the readers to tell the writer to stop. */
+  volatile svn_boolean_t *done;
+
+  /* Result of the thread's work. */
+  svn_error_t *err;
+} contention_baton_t;
+
+/* Return the key string for the hot item IDX, allocated in POOL. */
+static const char *
+hot_key(int idx, apr_pool_t *pool)
+{
+  return apr_psprintf(pool, "hot-%d", idx);
+}
+
+/* Body of the contention benchmark threads as described by BATON.
+ * Every thread uses its own cache front-end and pools. */
+static svn_error_t *
+contention_worker(contention_baton_t *baton)
+{
+  apr_pool_t *pool = svn_pool_create(NULL);
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_cache__t *cache;
+  svn_error_t *err;
+  int i;
+
+  err = svn_cache__create_membuffer_cache(&cache, baton->membuffer,
+                                          serialize_revnum,
+                                          deserialize_revnum,
+                                          APR_HASH_KEY_STRING,
+                                          "contention:",
+                                          SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                          FALSE, FALSE, pool, pool);
+
+  for (i = 0; !err && (baton->writer ? !*baton->done
+                                     : i < CONTENTION_LOOKUPS); ++i)
+    {
+      if ((i % 1000) == 0)
+        svn_pool_clear(iterpool);
+
+      if (baton->writer)
+        {
+          svn_revnum_t value = i % CONTENTION_COLD_KEYS;
+          err = svn_cache__set(cache,
+                               apr_psprintf(iterpool, "cold-%ld", value),
+                               &value, iterpool);
+        }
+      else
+        {
+          svn_revnum_t *answer;
+          svn_boolean_t found;
+          int idx = i % CONTENTION_HOT_KEYS;
+
+          err = svn_cache__get((void **) &answer, &found, cache,
+                               hot_key(idx, iterpool), iterpool);
+
+          /* Hot items may get evicted but must never be corrupted. */
+          if (!err && found && *answer != idx)
+            err = svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                                    "expected %d but found '%ld'",
+                                    idx, *answer);
+        }
+    }
+
+  svn_pool_destroy(pool);
+  return err;
+}
+
+static void *
+APR_THREAD_FUNC contention_thread_func(apr_thread_t *tid, void *data)
+{
+  contention_baton_t *baton = data;
+  baton->err = contention_worker(baton);
+
+  apr_thread_exit(tid, APR_SUCCESS);
+  return NULL;
+}
+
+/* Run the contention benchmark on MEMBUFFER with READER_COUNT reader
+ * threads plus one writer thread.  Return the number of lookups per
+ * second in *RATE.  Use POOL for temporary allocations. */
+static svn_error_t *
+run_contention_benchmark(double *rate,
+                         svn_membuffer_t *membuffer,
+                         int reader_count,
+                         apr_pool_t *pool)
+{
+  apr_thread_t *threads[CONTENTION_MAX_READERS + 1];
+  contention_baton_t batons[CONTENTION_MAX_READERS + 1];
+  volatile svn_boolean_t done = FALSE;
+  svn_error_t *err = SVN_NO_ERROR;
+  apr_time_t start;
+  apr_status_t status;
+  int i;
+
+  start = apr_time_now();
+  for (i = 0; i <= reader_count; ++i)
+    {
+      batons[i].membuffer = membuffer;
+      batons[i].writer = (i == reader_count);
+      batons[i].done = &done;
+      batons[i].err = SVN_NO_ERROR;
+
+      status = apr_thread_create(&threads[i], NULL, contention_thread_func,
+                                 &batons[i], pool);
+      if (status)
+        return svn_error_wrap_apr(status, NULL);
+    }
+
+  /* Wait for the readers, then stop the writer. */
+  for (i = 0; i <= reader_count; ++i)
+    {
+      apr_status_t retval;
+
+      if (i == reader_count)
+        done = TRUE;
+
+      status = apr_thread_join(&retval, threads[i]);
+      if (status)
+        return svn_error_wrap_apr(status, NULL);
+
+      err = svn_error_compose_create(err, batons[i].err);
+    }
+
+  SVN_ERR(err);
+
+  *rate = (double)CONTENTION_LOOKUPS * reader_count * APR_USEC_PER_SEC
+        / MAX(apr_time_now() - start, 1);
+  return SVN_NO_ERROR;
+}
+
+#endif
+
+static svn_error_t *
+test_membuffer_statistics(apr_pool_t *pool)
+{
+  svn_cache__t *cache;
+  svn_membuffer_t *membuffer = svn_cache__get_global_membuffer_cache();
+  svn_cache__info_t *before, *after;
+  svn_revnum_t value = 42;
+  void *item;
+  int i;
+
+  if (membuffer == NULL)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "global membuffer cache not available");
+
+  SVN_ERR(svn_cache__create_membuffer_cache(&cache, membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            APR_HASH_KEY_STRING,
+                                            "statistics:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            TRUE, FALSE, pool, pool));
+  SVN_ERR(svn_cache__set(cache, "hit", &value, pool));
+
+  /* Lock-free lookups get accounted for in batches, which must add up
+   * exactly once enough lookups have been made. */
+  before = svn_cache__membuffer_get_global_info(pool);
+  for (i = 0; i < 64; ++i)
+    {
+      SVN_ERR(svn_cache__get(&item, NULL, cache, "hit", pool));
+      SVN_TEST_ASSERT(item && *(svn_revnum_t *)item == 42);
+    }
+  for (i = 0; i < 64; ++i)
+    {
+      SVN_ERR(svn_cache__get(&item, NULL, cache, "miss", pool));
+      SVN_TEST_ASSERT(item == NULL);
+    }
+  after = svn_cache__membuffer_get_global_info(pool);
+
+  SVN_TEST_INT_ASSERT(after->gets - before->gets, 128);
+  SVN_TEST_INT_ASSERT(after->hits - before->hits, 64);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_membuffer_read_contention(const svn_test_opts_t *opts,
+                               apr_pool_t *pool)
+{
+#if APR_HAS_THREADS
+  svn_cache__t *cache;
+  svn_membuffer_t *membuffer;
+  int readers;
+  int i;
+
+  /* Use the same configuration as the global cache in threaded servers. */
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 4 * 1024 * 1024,
+                                            1024 * 1024, 0, TRUE, FALSE,
+                                            pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(&cache, membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            APR_HASH_KEY_STRING,
+                                            "contention:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE, FALSE, pool, pool));
+
+  /* Populate the hot items. */
+  for (i = 0; i < CONTENTION_HOT_KEYS; ++i)
+    {
+      svn_revnum_t value = i;
+      SVN_ERR(svn_cache__set(cache, hot_key(i, pool), &value, pool));
+    }
+
+  /* Lookups per second should scale with the number of reader threads
+   * (given enough cores) despite a concurrent writer. */
+  for (readers = 1; readers <= CONTENTION_MAX_READERS; readers *= 2)
+    {
+      double rate;
+      SVN_ERR(run_contention_benchmark(&rate, membuffer, readers, pool));
+
+      if (opts->verbose)
+        printf("%d reader thread(s): %.0f lookups/s\n", readers, rate);
+    }
+
+  return SVN_NO_ERROR;
+#else
+  return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                          "threads not supported");
+#endif
+}
+
+
 
 /* The test table.  */
 
@@ -616,6 +965,12 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test membuffer cache with unaligned string keys"),
     SVN_TEST_PASS2(test_membuffer_unaligned_fixed_keys,
                    "test membuffer cache with unaligned fixed keys"),
+    SVN_TEST_PASS2(test_membuffer_cache_shared,
+                   "test membuffer cache in shared memory"),
+    SVN_TEST_PASS2(test_membuffer_statistics,
+                   "test membuffer cache statistics"),
+    SVN_TEST_OPTS_PASS(test_membuffer_read_contention,
+                       "membuffer cache read contention benchmark"),
     SVN_TEST_NULL
   };
 
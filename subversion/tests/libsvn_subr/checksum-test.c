@@ -27,6 +27,10 @@
 
 #include "svn_error.h"
 #include "svn_io.h"
+#include "svn_pools.h"
+#include "svn_sorts.h"
+
+#include "private/svn_subr_private.h"
 
 #include "../svn_test.h"
 
@@ -296,6 +300,118 @@ test_checksum_parse_all_zero(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Return LEN bytes of deterministic, non-repetitive test data allocated
+ * in POOL. */
+static char *
+make_test_data(apr_size_t len,
+               apr_pool_t *pool)
+{
+  char *data = apr_palloc(pool, len);
+  apr_size_t i;
+
+  for (i = 0; i < len; ++i)
+    data[i] = (char)(i * 131 + (i >> 8));
+
+  return data;
+}
+
+static svn_error_t *
+test_sha1_vectors(apr_pool_t *pool)
+{
+  /* The FIPS 180 test vectors plus a few lengths around the padding
+   * boundaries. */
+  static const struct
+  {
+    const char *data;
+    const char *digest;
+  } vectors[] =
+    {
+      { "abc",
+        "a9993e364706816aba3e25717850c26c9cd0d89d" },
+      { "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+        "84983e441c3bd26ebaae4aa1f95129e5e54670f1" },
+      { "0123456789012345678901234567890123456789012345678901234",
+        "9f3a4ce7f66b1b74c34da2c5d732c39f81e0f8df" },
+      { "0123456789012345678901234567890123456789012345678901234567890123",
+        "cf0800f7644ace3cb4c3fa33388d3ba0ea3c8b6e" },
+    };
+  const apr_size_t million = 1000000;
+  char *data = apr_palloc(pool, million);
+  svn_checksum_ctx_t *ctx;
+  svn_checksum_t *checksum;
+  apr_size_t pos, step;
+  int i;
+
+  for (i = 0; i < sizeof(vectors) / sizeof(vectors[0]); ++i)
+    {
+      SVN_ERR(svn_checksum(&checksum, svn_checksum_sha1, vectors[i].data,
+                           strlen(vectors[i].data), pool));
+      SVN_TEST_STRING_ASSERT(svn_checksum_to_cstring(checksum, pool),
+                             vectors[i].digest);
+    }
+
+  /* One million 'a's, fed in chunks of varying sizes such that partial
+   * blocks get buffered in all possible ways. */
+  memset(data, 'a', million);
+  SVN_ERR(svn_checksum(&checksum, svn_checksum_sha1, data, million, pool));
+  SVN_TEST_STRING_ASSERT(svn_checksum_to_cstring(checksum, pool),
+                         "34aa973cd4c4daa4f61eeb2bdbad27316534016f");
+
+  ctx = svn_checksum_ctx_create(svn_checksum_sha1, pool);
+  for (pos = 0, step = 1; pos < million; pos += step, step = step % 199 + 1)
+    SVN_ERR(svn_checksum_update(ctx, data + pos,
+                                MIN(step, million - pos)));
+  SVN_ERR(svn_checksum_final(&checksum, ctx, pool));
+  SVN_TEST_STRING_ASSERT(svn_checksum_to_cstring(checksum, pool),
+                         "34aa973cd4c4daa4f61eeb2bdbad27316534016f");
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_md5_sha1_stream(apr_pool_t *pool)
+{
+  apr_size_t lengths[] = { 0, 1, 55, 56, 64, 1000, 100000 };
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  for (i = 0; i < sizeof(lengths) / sizeof(lengths[0]); ++i)
+    {
+      apr_size_t len = lengths[i];
+      char *data;
+      svn_checksum_t *expected_md5, *expected_sha1;
+      svn_checksum_t *md5 = NULL, *sha1 = NULL;
+      svn_stream_t *stream;
+      apr_size_t pos, chunk;
+
+      svn_pool_clear(iterpool);
+      data = make_test_data(len, iterpool);
+
+      SVN_ERR(svn_checksum(&expected_md5, svn_checksum_md5, data, len,
+                           iterpool));
+      SVN_ERR(svn_checksum(&expected_sha1, svn_checksum_sha1, data, len,
+                           iterpool));
+
+      stream = svn_checksum__wrap_write_stream_md5_sha1(
+                 &md5, &sha1, svn_stream_empty(iterpool), iterpool);
+      for (pos = 0; pos < len; pos += chunk)
+        {
+          chunk = MIN(777, len - pos);
+          SVN_ERR(svn_stream_write(stream, data + pos, &chunk));
+        }
+      SVN_ERR(svn_stream_close(stream));
+
+      SVN_TEST_ASSERT(md5 && md5->kind == svn_checksum_md5);
+      SVN_TEST_ASSERT(sha1 && sha1->kind == svn_checksum_sha1);
+      SVN_TEST_ASSERT(svn_checksum_match(md5, expected_md5));
+      SVN_TEST_ASSERT(svn_checksum_match(sha1, expected_sha1));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 /* An array of all test functions */
 
 static int max_threads = 1;
@@ -317,6 +433,10 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "checksum (de-)serialization"),
     SVN_TEST_PASS2(test_checksum_parse_all_zero,
                    "checksum parse all zero"),
+    SVN_TEST_PASS2(test_sha1_vectors,
+                   "SHA-1 test vectors"),
+    SVN_TEST_PASS2(test_md5_sha1_stream,
+                   "combined MD5 and SHA-1 write stream"),
     SVN_TEST_NULL
   };
 
@@ -0,0 +1,334 @@
+/*
+ * frames-test.c:  a collection of svn_frames__* tests
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* ====================================================================
+   To add tests, look toward the bottom of this file.
+
+*/
+
+
+
+#include <string.h>
+#include <apr_pools.h>
+
+#include "../svn_test.h"
+
+#include "svn_error.h"
+#include "svn_io.h"
+#include "svn_sorts.h"
+#include "svn_string.h"   /* This includes <apr_*.h> */
+#include "private/svn_frames.h"
+
+#define TEST_MAGIC "TEST\1"
+#define TEST_MAGIC_LEN 5
+
+/* Frame with a C string and a number as payload. */
+#define OP_RECORD 'r'
+/* Frame with raw data as payload. */
+#define OP_DATA   'd'
+/* Empty frame terminating a sequence of OP_DATA frames. */
+#define OP_CLOSE  'c'
+
+/* Implements svn_frames__handler_t.  Append a textual representation of
+ * the frame to the stringbuf LOG.  Decode the payload of OP_RECORD frames.
+ */
+static svn_error_t *
+log_frame(void *baton,
+          char op,
+          const unsigned char *payload,
+          const unsigned char *end,
+          apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *log = baton;
+
+  if (op == OP_RECORD)
+    {
+      const char *str;
+      apr_int64_t val;
+
+      SVN_ERR(svn_frames__read_cstring(&str, &payload, end, scratch_pool));
+      SVN_ERR(svn_frames__read_int(&val, &payload, end));
+      SVN_TEST_ASSERT(payload == end);
+
+      svn_stringbuf_appendcstr(log, apr_psprintf(scratch_pool,
+                                                 "r(%s,%" APR_INT64_T_FMT ")",
+                                                 str ? str : "NULL", val));
+    }
+  else
+    {
+      svn_stringbuf_appendbyte(log, op);
+      svn_stringbuf_appendbyte(log, '[');
+      svn_stringbuf_appendbytes(log, (const char *)payload, end - payload);
+      svn_stringbuf_appendbyte(log, ']');
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Write an OP_RECORD frame with STR and VAL to OUT.  Use POOL for
+ * temporary allocations.
+ */
+static svn_error_t *
+write_record(svn_stream_t *out,
+             const char *str,
+             apr_int64_t val,
+             apr_pool_t *pool)
+{
+  svn_stringbuf_t *payload = svn_stringbuf_create_empty(pool);
+
+  svn_frames__append_cstring(payload, str);
+  svn_frames__append_int(payload, val);
+
+  return svn_error_trace(svn_frames__write(out, OP_RECORD, payload->data,
+                                           payload->len));
+}
+
+/* Return a new stream in *OUT that writes to *BUFFER and starts with the
+ * test magic.  Allocate both in POOL.
+ */
+static svn_error_t *
+start_stream(svn_stream_t **out,
+             svn_stringbuf_t **buffer,
+             apr_pool_t *pool)
+{
+  apr_size_t len = TEST_MAGIC_LEN;
+
+  *buffer = svn_stringbuf_create_empty(pool);
+  *out = svn_stream_from_stringbuf(*buffer, pool);
+
+  return svn_error_trace(svn_stream_write(*out, TEST_MAGIC, &len));
+}
+
+/* Create a parser in *PARSER that logs into *LOG and feed it the frames in
+ * BUFFER in chunks of CHUNK_SIZE bytes.  Return the first error returned
+ * by the parser.  Allocate the results in POOL.
+ */
+static svn_error_t *
+parse(svn_frames__parser_t **parser,
+      svn_stringbuf_t **log,
+      const svn_stringbuf_t *buffer,
+      apr_size_t chunk_size,
+      apr_pool_t *pool)
+{
+  apr_size_t offset;
+
+  *log = svn_stringbuf_create_empty(pool);
+  *parser = svn_frames__parser_create(TEST_MAGIC, TEST_MAGIC_LEN, log_frame,
+                                      *log, pool);
+
+  for (offset = 0; offset < buffer->len; offset += chunk_size)
+    SVN_ERR(svn_frames__parser_feed(*parser, buffer->data + offset,
+                                    MIN(chunk_size, buffer->len - offset),
+                                    pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_round_trip(apr_pool_t *pool)
+{
+  static const char expected[]
+    = "r(foo,-5)r(NULL,1234567890123)d[\0\1\2]q[]";
+
+  svn_stream_t *out;
+  svn_stringbuf_t *buffer;
+  apr_size_t chunk_size;
+
+  SVN_ERR(start_stream(&out, &buffer, pool));
+  SVN_ERR(write_record(out, "foo", -5, pool));
+  SVN_ERR(write_record(out, NULL, APR_INT64_C(1234567890123), pool));
+  SVN_ERR(svn_frames__write(out, OP_DATA, "\0\1\2", 3));
+  SVN_ERR(svn_frames__write(out, 'q', NULL, 0));
+  SVN_ERR(svn_frames__write(out, SVN_FRAMES__END, NULL, 0));
+
+  /* The result must not depend on how the data gets split up. */
+  for (chunk_size = 1; chunk_size <= buffer->len; chunk_size *= 2)
+    {
+      svn_frames__parser_t *parser;
+      svn_stringbuf_t *log;
+
+      SVN_ERR(parse(&parser, &log, buffer, chunk_size, pool));
+      SVN_TEST_ASSERT(svn_frames__parser_done(parser));
+      SVN_ERR(svn_frames__parser_finish(parser));
+
+      SVN_TEST_INT_ASSERT(log->len, sizeof(expected) - 1);
+      SVN_TEST_ASSERT(memcmp(log->data, expected, log->len) == 0);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_data_stream(apr_pool_t *pool)
+{
+  svn_stream_t *out;
+  svn_stream_t *data;
+  svn_stringbuf_t *buffer;
+  svn_frames__parser_t *parser;
+  svn_stringbuf_t *log;
+
+  SVN_ERR(start_stream(&out, &buffer, pool));
+  data = svn_frames__data_stream(out, OP_DATA, OP_CLOSE, pool);
+  SVN_ERR(svn_stream_puts(data, "abc"));
+  SVN_ERR(svn_stream_puts(data, "de"));
+  SVN_ERR(svn_stream_close(data));
+
+  /* Without a close op, there is no extra frame. */
+  data = svn_frames__data_stream(out, OP_DATA, 0, pool);
+  SVN_ERR(svn_stream_puts(data, "f"));
+  SVN_ERR(svn_stream_close(data));
+
+  /* OUT must still be usable. */
+  SVN_ERR(svn_frames__write(out, SVN_FRAMES__END, NULL, 0));
+
+  SVN_ERR(parse(&parser, &log, buffer, buffer->len, pool));
+  SVN_ERR(svn_frames__parser_finish(parser));
+  SVN_TEST_STRING_ASSERT(log->data, "d[abc]d[de]c[]d[f]");
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_error_frames(apr_pool_t *pool)
+{
+  svn_stream_t *out;
+  svn_stringbuf_t *buffer;
+  svn_frames__parser_t *parser;
+  svn_stringbuf_t *log;
+  svn_error_t *sent;
+  svn_error_t *err;
+
+  sent = svn_error_create(SVN_ERR_FS_NOT_FOUND, NULL, "inner");
+  sent = svn_error_trace(sent);
+  sent = svn_error_create(SVN_ERR_RA_DAV_REQUEST_FAILED, sent, "outer");
+  sent = svn_error_create(SVN_ERR_CANCELLED, sent, NULL);
+
+  SVN_ERR(start_stream(&out, &buffer, pool));
+  SVN_ERR(write_record(out, "before", 1, pool));
+  SVN_ERR(svn_frames__write_error(out, sent, pool));
+  svn_error_clear(sent);
+
+  /* Frames before the error get processed but the stream is not done. */
+  SVN_ERR(parse(&parser, &log, buffer, 1, pool));
+  SVN_TEST_STRING_ASSERT(log->data, "r(before,1)");
+  SVN_TEST_ASSERT(!svn_frames__parser_done(parser));
+
+  /* The chain arrives in order, without tracing links and with a generic
+   * message where there was none. */
+  err = svn_frames__parser_finish(parser);
+  SVN_TEST_ASSERT(err != NULL);
+  SVN_TEST_INT_ASSERT(err->apr_err, SVN_ERR_CANCELLED);
+  SVN_TEST_ASSERT(err->message != NULL);
+
+  SVN_TEST_ASSERT(err->child != NULL);
+  SVN_TEST_INT_ASSERT(err->child->apr_err, SVN_ERR_RA_DAV_REQUEST_FAILED);
+  SVN_TEST_STRING_ASSERT(err->child->message, "outer");
+
+  SVN_TEST_ASSERT(err->child->child != NULL);
+  SVN_TEST_INT_ASSERT(err->child->child->apr_err, SVN_ERR_FS_NOT_FOUND);
+  SVN_TEST_STRING_ASSERT(err->child->child->message, "inner");
+  SVN_TEST_ASSERT(err->child->child->child == NULL);
+  svn_error_clear(err);
+
+  /* Only more error frames may follow an error frame. */
+  SVN_ERR(svn_frames__write(out, SVN_FRAMES__END, NULL, 0));
+  SVN_TEST_ASSERT_ERROR(parse(&parser, &log, buffer, buffer->len, pool),
+                        SVN_ERR_STREAM_MALFORMED_DATA);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_malformed_streams(apr_pool_t *pool)
+{
+  svn_stream_t *out;
+  svn_stringbuf_t *buffer;
+  svn_frames__parser_t *parser;
+  svn_stringbuf_t *log;
+  svn_stringbuf_t *payload;
+
+  /* Wrong magic. */
+  buffer = svn_stringbuf_create("TEST\2E\0", pool);
+  SVN_TEST_ASSERT_ERROR(parse(&parser, &log, buffer, buffer->len, pool),
+                        SVN_ERR_STREAM_MALFORMED_DATA);
+
+  /* Missing end frame. */
+  SVN_ERR(start_stream(&out, &buffer, pool));
+  SVN_ERR(write_record(out, "foo", 1, pool));
+  SVN_ERR(parse(&parser, &log, buffer, buffer->len, pool));
+  SVN_TEST_ASSERT_ERROR(svn_frames__parser_finish(parser),
+                        SVN_ERR_STREAM_MALFORMED_DATA);
+
+  /* Truncated frame. */
+  svn_stringbuf_chop(buffer, 1);
+  SVN_ERR(parse(&parser, &log, buffer, buffer->len, pool));
+  SVN_TEST_STRING_ASSERT(log->data, "");
+  SVN_TEST_ASSERT_ERROR(svn_frames__parser_finish(parser),
+                        SVN_ERR_STREAM_MALFORMED_DATA);
+
+  /* Frames after the end frame. */
+  SVN_ERR(start_stream(&out, &buffer, pool));
+  SVN_ERR(svn_frames__write(out, SVN_FRAMES__END, NULL, 0));
+  SVN_ERR(write_record(out, "foo", 1, pool));
+  SVN_TEST_ASSERT_ERROR(parse(&parser, &log, buffer, buffer->len, pool),
+                        SVN_ERR_STREAM_MALFORMED_DATA);
+
+  /* Trailing garbage after the end frame. */
+  SVN_ERR(start_stream(&out, &buffer, pool));
+  SVN_ERR(svn_frames__write(out, SVN_FRAMES__END, NULL, 0));
+  SVN_ERR(svn_stream_puts(out, "x"));
+  SVN_ERR(parse(&parser, &log, buffer, buffer->len, pool));
+  SVN_TEST_ASSERT_ERROR(svn_frames__parser_finish(parser),
+                        SVN_ERR_STREAM_MALFORMED_DATA);
+
+  /* String exceeding the frame payload. */
+  payload = svn_stringbuf_create_empty(pool);
+  svn_frames__append_cstring(payload, "foo");
+  SVN_ERR(start_stream(&out, &buffer, pool));
+  SVN_ERR(svn_frames__write(out, OP_RECORD, payload->data,
+                            payload->len - 1));
+  SVN_TEST_ASSERT_ERROR(parse(&parser, &log, buffer, buffer->len, pool),
+                        SVN_ERR_STREAM_MALFORMED_DATA);
+
+  return SVN_NO_ERROR;
+}
+
+/* An array of all test functions */
+
+static int max_threads = 1;
+
+static struct svn_test_descriptor_t test_funcs[] =
+  {
+    SVN_TEST_NULL,
+    SVN_TEST_PASS2(test_round_trip,
+                   "test frames round trip"),
+    SVN_TEST_PASS2(test_data_stream,
+                   "test frame data streams"),
+    SVN_TEST_PASS2(test_error_frames,
+                   "test error frames"),
+    SVN_TEST_PASS2(test_malformed_streams,
+                   "test malformed frame streams"),
+    SVN_TEST_NULL
+  };
+
+SVN_TEST_MAIN
@@ -872,6 +872,45 @@ test_string_matching(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Exercise the chunked scans in svn_cstring__match_length() and
+   svn_cstring__reverse_match_length() with strings long enough for the
+   SIMD code paths, placing a single mismatch at every position. */
+static svn_error_t *
+test_long_string_matching(apr_pool_t *pool)
+{
+  enum { LEN = 200, OFFSET = 3 };
+  char a[LEN + 2 * OFFSET];
+  char b[LEN + 2 * OFFSET];
+  apr_size_t i, mismatch, max_len;
+
+  /* Use different alignments for both strings. */
+  for (i = 0; i < sizeof(a); ++i)
+    a[i] = b[i] = (char)(i * 7);
+
+  for (mismatch = 0; mismatch < LEN; ++mismatch)
+    {
+      b[OFFSET + mismatch] ^= 1;
+
+      for (max_len = 0; max_len <= LEN; ++max_len)
+        {
+          apr_size_t rmismatch = LEN - 1 - mismatch;
+
+          SVN_TEST_INT_ASSERT(svn_cstring__match_length(a + OFFSET,
+                                                        b + OFFSET,
+                                                        max_len),
+                              MIN(mismatch, max_len));
+          SVN_TEST_INT_ASSERT(svn_cstring__reverse_match_length(
+                                a + OFFSET + LEN, b + OFFSET + LEN,
+                                max_len),
+                              MIN(rmismatch, max_len));
+        }
+
+      b[OFFSET + mismatch] ^= 1;
+    }
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 test_cstring_skip_prefix(apr_pool_t *pool)
 {
@@ -1087,6 +1126,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test string similarity scores"),
     SVN_TEST_PASS2(test_string_matching,
                    "test string matching"),
+    SVN_TEST_PASS2(test_long_string_matching,
+                   "test string matching with long strings"),
     SVN_TEST_PASS2(test_cstring_skip_prefix,
                    "test svn_cstring_skip_prefix()"),
     SVN_TEST_PASS2(test_stringbuf_replace_all,
@@ -34,6 +34,7 @@
 #define SVN_DEPRECATED
 #include "svn_io.h"
 
+#include "svn_config.h"
 #include "svn_dirent_uri.h"
 #include "svn_pools.h"
 #include "svn_repos.h"
@@ -307,6 +308,241 @@ reject_mismatching_text(const svn_test_opts_t *opts,
 }
 
 
+/* Set *DB to a new DB context whose machine-wide pristine cache lives in
+ * the new directory *CACHE_DIR, named after TEST_NAME, and is limited to
+ * SIZE_MB megabytes. */
+static svn_error_t *
+open_db_with_cache(svn_wc__db_t **db,
+                   const char **cache_dir,
+                   const char *test_name,
+                   apr_int64_t size_mb,
+                   apr_pool_t *pool)
+{
+  svn_config_t *config;
+
+  SVN_ERR(svn_test_make_sandbox_dir(cache_dir,
+                                    apr_pstrcat(pool, test_name, "-cache",
+                                                SVN_VA_NULL),
+                                    pool));
+
+  SVN_ERR(svn_config_create2(&config, FALSE, FALSE, pool));
+  svn_config_set(config, SVN_CONFIG_SECTION_WORKING_COPY,
+                 SVN_CONFIG_OPTION_PRISTINE_CACHE_DIR, *cache_dir);
+  svn_config_set_int64(config, SVN_CONFIG_SECTION_WORKING_COPY,
+                       SVN_CONFIG_OPTION_PRISTINE_CACHE_SIZE, size_mb);
+
+  SVN_ERR(svn_wc__db_open(db, config, FALSE, TRUE, pool, pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Install the text DATA of LEN bytes into the pristine store of the WC at
+ * WC_ABSPATH through DB and set *SHA1 to its checksum. */
+static svn_error_t *
+install_text(svn_checksum_t **sha1,
+             svn_wc__db_t *db,
+             const char *wc_abspath,
+             const char *data,
+             apr_size_t len,
+             apr_pool_t *pool)
+{
+  svn_wc__db_install_data_t *install_data;
+  svn_stream_t *pristine_stream;
+  svn_checksum_t *md5;
+
+  SVN_ERR(svn_wc__db_pristine_prepare_install(&pristine_stream,
+                                              &install_data,
+                                              sha1, &md5,
+                                              db, wc_abspath,
+                                              pool, pool));
+  SVN_ERR(svn_stream_write(pristine_stream, data, &len));
+  SVN_ERR(svn_stream_close(pristine_stream));
+
+  return svn_error_trace(svn_wc__db_pristine_install(install_data, *sha1,
+                                                     md5, pool));
+}
+
+/* Return the location of the text identified by SHA1 in the pristine
+ * cache at CACHE_DIR.
+ *
+ * White-box knowledge: The cache uses the layout of the pristine store. */
+static const char *
+cache_entry_path(const char *cache_dir,
+                 const svn_checksum_t *sha1,
+                 apr_pool_t *pool)
+{
+  const char *hexdigest = svn_checksum_to_cstring(sha1, pool);
+
+  return svn_dirent_join_many(pool, cache_dir,
+                              apr_pstrndup(pool, hexdigest, 2),
+                              apr_pstrcat(pool, hexdigest, ".svn-base",
+                                          SVN_VA_NULL),
+                              SVN_VA_NULL);
+}
+
+/* Test that installed texts can be read back from the pristine cache,
+ * even without a working copy, and that other texts are not found. */
+static svn_error_t *
+pristine_cache_hit_miss(const svn_test_opts_t *opts,
+                        apr_pool_t *pool)
+{
+  svn_test__sandbox_t sandbox;
+  svn_wc__db_t *db;
+  svn_wc_context_t *wc_ctx;
+  const char *cache_dir;
+  svn_stream_t *contents;
+  svn_stringbuf_t *read_back;
+
+  const char data[] = "Blah";
+  const char other_data[] = "Baz";
+  svn_checksum_t *data_sha1, *other_sha1;
+
+  SVN_ERR(svn_test__sandbox_create(&sandbox, "pristine_cache_hit_miss",
+                                   opts, pool));
+  SVN_ERR(open_db_with_cache(&db, &cache_dir, "pristine_cache_hit_miss", 1,
+                             pool));
+  SVN_ERR(install_text(&data_sha1, db, sandbox.wc_abspath,
+                       data, strlen(data), pool));
+
+  /* A checkout has no working copy to look into yet. */
+  SVN_ERR(svn_wc__context_create_with_db(&wc_ctx, NULL, db, pool));
+  SVN_ERR(svn_wc__get_pristine_contents_by_checksum(&contents, wc_ctx, NULL,
+                                                    data_sha1, pool, pool));
+  SVN_TEST_ASSERT(contents != NULL);
+  SVN_ERR(svn_stringbuf_from_stream(&read_back, contents, 0, pool));
+  SVN_TEST_STRING_ASSERT(read_back->data, data);
+
+  SVN_ERR(svn_checksum(&other_sha1, svn_checksum_sha1,
+                       other_data, strlen(other_data), pool));
+  SVN_ERR(svn_wc__get_pristine_contents_by_checksum(&contents, wc_ctx, NULL,
+                                                    other_sha1, pool, pool));
+  SVN_TEST_ASSERT(contents == NULL);
+
+  SVN_ERR(svn_wc__db_close(db));
+
+  return SVN_NO_ERROR;
+}
+
+/* Test that pristine cache entries with wrong contents are neither used
+ * nor kept. */
+static svn_error_t *
+pristine_cache_corrupt(const svn_test_opts_t *opts,
+                       apr_pool_t *pool)
+{
+  svn_test__sandbox_t sandbox;
+  svn_wc__db_t *db;
+  const char *cache_dir;
+  const char *entry_path;
+  svn_stream_t *contents;
+  svn_node_kind_t kind;
+  svn_boolean_t present;
+
+  const char data[] = "Blah";
+  svn_checksum_t *data_sha1;
+
+  SVN_ERR(svn_test__sandbox_create(&sandbox, "pristine_cache_corrupt",
+                                   opts, pool));
+  SVN_ERR(open_db_with_cache(&db, &cache_dir, "pristine_cache_corrupt", 1,
+                             pool));
+  SVN_ERR(install_text(&data_sha1, db, sandbox.wc_abspath,
+                       data, strlen(data), pool));
+
+  /* Replace the entry rather than modifying it, since it may be a hard
+   * link to the pristine of our working copy. */
+  entry_path = cache_entry_path(cache_dir, data_sha1, pool);
+  SVN_ERR(svn_io_remove_file2(entry_path, FALSE, pool));
+  SVN_ERR(svn_io_file_create(entry_path, "Bla!", pool));
+
+  SVN_ERR(svn_wc__db_pristine_cache_read(&contents, db, data_sha1,
+                                         pool, pool));
+  SVN_TEST_ASSERT(contents == NULL);
+
+  SVN_ERR(svn_io_check_path(entry_path, &kind, pool));
+  SVN_TEST_ASSERT(kind == svn_node_none);
+
+  /* The working copy itself is not affected. */
+  SVN_ERR(svn_wc__db_pristine_check(&present, db, sandbox.wc_abspath,
+                                    data_sha1, pool));
+  SVN_TEST_ASSERT(present);
+
+  SVN_ERR(svn_wc__db_close(db));
+
+  return SVN_NO_ERROR;
+}
+
+/* Test that the pristine cache evicts its least recently used entries
+ * once it exceeds its size limit. */
+static svn_error_t *
+pristine_cache_eviction(const svn_test_opts_t *opts,
+                        apr_pool_t *pool)
+{
+  /* Four entries of that size exceed the cache limit of 1 MB but
+   * three of them fit below the 10% slack left by the eviction. */
+  const apr_size_t text_size = 300 * 1024;
+  const int text_count = 5;
+
+  svn_test__sandbox_t sandbox;
+  svn_wc__db_t *db;
+  const char *cache_dir;
+  const char **entry_paths;
+  svn_stream_t *contents;
+  svn_node_kind_t kind;
+  int i;
+
+  SVN_ERR(svn_test__sandbox_create(&sandbox, "pristine_cache_eviction",
+                                   opts, pool));
+  SVN_ERR(open_db_with_cache(&db, &cache_dir, "pristine_cache_eviction", 1,
+                             pool));
+
+  entry_paths = apr_pcalloc(pool, text_count * sizeof(*entry_paths));
+  for (i = 0; i < text_count; ++i)
+    {
+      svn_stringbuf_t *text = svn_stringbuf_create_ensure(text_size, pool);
+      svn_checksum_t *sha1;
+
+      svn_stringbuf_appendfill(text, (char)('a' + i), text_size);
+      SVN_ERR(install_text(&sha1, db, sandbox.wc_abspath,
+                           text->data, text->len, pool));
+      entry_paths[i] = cache_entry_path(cache_dir, sha1, pool);
+
+      /* Give each entry a distinct age, the first one being the oldest. */
+      SVN_ERR(svn_io_set_file_affected_time(
+                  apr_time_now() - apr_time_from_sec(3600 * (10 - i)),
+                  entry_paths[i], pool));
+
+      /* Using the second entry makes it the most recently used one. */
+      if (i == 3)
+        {
+          svn_checksum_t *second_sha1;
+
+          svn_stringbuf_setempty(text);
+          svn_stringbuf_appendfill(text, 'b', text_size);
+          SVN_ERR(svn_checksum(&second_sha1, svn_checksum_sha1,
+                               text->data, text->len, pool));
+          SVN_ERR(svn_wc__db_pristine_cache_read(&contents, db, second_sha1,
+                                                 pool, pool));
+          SVN_TEST_ASSERT(contents != NULL);
+          SVN_ERR(svn_stream_close(contents));
+        }
+    }
+
+  /* Adding the fourth entry evicted the first, adding the fifth one the
+   * third, since the second one had been used in the meantime. */
+  for (i = 0; i < text_count; ++i)
+    {
+      SVN_ERR(svn_io_check_path(entry_paths[i], &kind, pool));
+      if (i == 0 || i == 2)
+        SVN_TEST_ASSERT(kind == svn_node_none);
+      else
+        SVN_TEST_ASSERT(kind == svn_node_file);
+    }
+
+  SVN_ERR(svn_wc__db_close(db));
+
+  return SVN_NO_ERROR;
+}
+
+
 static int max_threads = -1;
 
 static struct svn_test_descriptor_t test_funcs[] =
@@ -318,6 +554,12 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "pristine_delete_while_open"),
     SVN_TEST_OPTS_PASS(reject_mismatching_text,
                        "reject_mismatching_text"),
+    SVN_TEST_OPTS_PASS(pristine_cache_hit_miss,
+                       "pristine_cache_hit_miss"),
+    SVN_TEST_OPTS_PASS(pristine_cache_corrupt,
+                       "pristine_cache_corrupt"),
+    SVN_TEST_OPTS_PASS(pristine_cache_eviction,
+                       "pristine_cache_eviction"),
     SVN_TEST_NULL
   };
 